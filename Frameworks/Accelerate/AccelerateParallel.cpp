@@ -0,0 +1,143 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include "AccelerateParallel.h"
+
+// The pool has one thread fewer than the processor, the calling thread making up the rest, started on first use and
+// kept for the life of the process. It runs one caller's tasks at a time: each call publishes its tasks under a new
+// generation, and the workers and the caller claim them by index until none are left. The caller returns once every
+// task has finished and no worker is still claiming, so that the next call can reuse the counters.
+
+namespace {
+
+thread_local bool t_isPoolThread = false;
+
+class ThreadPool {
+public:
+    ThreadPool() : _workers(0), _generation(0), _task(nullptr), _tasks(0), _next(0), _completed(0), _claiming(0) {
+        const unsigned processors = std::thread::hardware_concurrency();
+        for (unsigned i = 1; i < processors; ++i) {
+            try {
+                std::thread(&ThreadPool::_work, this).detach();
+            } catch (const std::system_error&) {
+                break;
+            }
+            ++_workers;
+        }
+    }
+
+    size_t workers() const {
+        return _workers;
+    }
+
+    void run(size_t tasks, const std::function<void(size_t)>& task) {
+        std::unique_lock<std::mutex> running(_running, std::try_to_lock);
+        if (!running.owns_lock() || t_isPoolThread || _workers == 0) {
+            for (size_t i = 0; i < tasks; ++i) {
+                task(i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _task = &task;
+            _tasks = tasks;
+            _next = 0;
+            _completed = 0;
+            ++_generation;
+        }
+        _wake.notify_all();
+
+        _claim(task, tasks);
+
+        std::unique_lock<std::mutex> guard(_lock);
+        _done.wait(guard, [this]() { return _completed == _tasks && _claiming == 0; });
+        _task = nullptr;
+    }
+
+private:
+    void _claim(const std::function<void(size_t)>& task, size_t tasks) {
+        for (size_t i = _next++; i < tasks; i = _next++) {
+            task(i);
+            std::lock_guard<std::mutex> guard(_lock);
+            if (++_completed == tasks) {
+                _done.notify_all();
+            }
+        }
+    }
+
+    void _work() {
+        t_isPoolThread = true;
+        unsigned long long seen = 0;
+        std::unique_lock<std::mutex> guard(_lock);
+        for (;;) {
+            _wake.wait(guard, [this, seen]() { return _generation != seen; });
+            seen = _generation;
+
+            // The caller may have finished without this thread, in which case there is nothing left to claim.
+            if (_task == nullptr) {
+                continue;
+            }
+            const std::function<void(size_t)>* task = _task;
+            const size_t tasks = _tasks;
+            ++_claiming;
+            guard.unlock();
+
+            _claim(*task, tasks);
+
+            guard.lock();
+            if (--_claiming == 0) {
+                _done.notify_all();
+            }
+        }
+    }
+
+    size_t _workers;
+    std::mutex _running;
+    std::mutex _lock;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    unsigned long long _generation;
+    const std::function<void(size_t)>* _task;
+    size_t _tasks;
+    std::atomic<size_t> _next;
+    size_t _completed;
+    size_t _claiming;
+};
+
+// Never destroyed: its threads are detached and still waiting on it when the process exits.
+ThreadPool& pool() {
+    static ThreadPool* s_pool = new ThreadPool();
+    return *s_pool;
+}
+
+} // namespace
+
+size_t AccelerateParallelThreads(size_t count, size_t minimumPerThread) {
+    const size_t threads = std::min(pool().workers() + 1, count / std::max<size_t>(minimumPerThread, 1));
+    return std::max<size_t>(threads, 1);
+}
+
+void AccelerateParallelRun(size_t tasks, const std::function<void(size_t)>& task) {
+    pool().run(tasks, task);
+}
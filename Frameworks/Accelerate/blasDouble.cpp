@@ -172,13 +172,6 @@ void __dspr2__(char* Uplo, const int* N, const double* alpha, const double* X, c
 }
 
 
-void __dgemm__(char* TransA, char* TransB, const int* M, const int* N, const int* K, const double* alpha, const double* A, 
-               const int* lda, const double* B, const int* ldb, const double* beta, double* C, const int* ldc) {
-    EigenFunc_dgemm(TransA, TransB, INTCAST(M), INTCAST(N), INTCAST(K), DOUBLECAST(alpha), DOUBLECAST(A), 
-                    INTCAST(lda), DOUBLECAST(B), INTCAST(ldb), DOUBLECAST(beta), DOUBLECAST(C), INTCAST(ldc));
-}
-
-
 void __dsymm__(char* Side, char* Uplo, const int* M, const int* N, const double* alpha, const double* A, const int* lda, 
                const double* B, const int* ldb, const double* beta, double* C, const int* ldc) {
     EigenFunc_dsymm(Side, Uplo, INTCAST(M), INTCAST(N), DOUBLECAST(alpha), DOUBLECAST(A), INTCAST(lda), 
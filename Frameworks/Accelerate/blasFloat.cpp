@@ -172,13 +172,6 @@ void __sspr2__(char* Uplo, const int* N, const float* alpha, const float* X, con
 }
 
 
-void __sgemm__(char* TransA, char* TransB, const int* M, const int* N, const int* K, const float* alpha, const float* A, const int* lda,
-               const float* B, const int* ldb, const float* beta, float* C, const int* ldc) {
-    EigenFunc_sgemm(TransA, TransB, INTCAST(M), INTCAST(N), INTCAST(K), FLOATCAST(alpha), FLOATCAST(A), INTCAST(lda), FLOATCAST(B),
-                    INTCAST(ldb), FLOATCAST(beta), FLOATCAST(C), INTCAST(ldc));
-}
-
-
 void __ssymm__(char* Side, char* Uplo, const int* M, const int* N, const float* alpha, const float* A, const int* lda, const float* B,
                const int* ldb, const float* beta, float* C, const int* ldc) {
     EigenFunc_ssymm(Side, Uplo, INTCAST(M), INTCAST(N), FLOATCAST(alpha), FLOATCAST(A), INTCAST(lda), FLOATCAST(B), INTCAST(ldb), 
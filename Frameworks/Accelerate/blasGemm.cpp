@@ -0,0 +1,703 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+#include "Accelerate\cblas.h"
+#include "CBLAS/cblas_f77.h"
+#include "vDSPInternal.h"
+#include "AccelerateParallel.h"
+
+// The real matrix multiplications sgemm and dgemm, in place of Eigen's, which the rest of level 3 still uses.
+//
+// C = alpha * op(A) * op(B) + beta * C is computed a block at a time, so that each block's operands stay in cache:
+// c_blockN columns of op(B) at a time and c_blockK of the inner dimension, packed into panels of vDSPGemmColumns
+// columns, and within those rowsPerBlock<T>() rows of op(A) at a time, packed into panels of vDSPGemmRows rows. The
+// vector kernel of vDSPKernels.inc then multiplies a panel of each into a tile of C. Packing takes care of the
+// transposes and pads the panels at the edges with zeros, and the tiles those cover go through a copy.
+//
+// Large products are split across threads by columns of C, or by rows when there are more of those, each thread
+// packing its own operands. The batched functions instead give each thread a share of the products, each product on a
+// single thread, when that keeps more threads busy. SetBLASThreadCount limits either way.
+
+extern "C" int xerbla_(const char* msg, int* info, int);
+
+namespace {
+
+const size_t c_blockK = 256;
+const size_t c_blockN = 2048;
+
+// The size of the packed block of A, for the L2 cache.
+const size_t c_blockBytes = 128 * 1024;
+
+// Work, in multiply-adds, to give each thread at least.
+const double c_parallelWork = 1 << 20;
+
+std::atomic<int> s_threadCount(0);
+
+template <typename T>
+size_t rowsPerBlock() {
+    return c_blockBytes / (c_blockK * sizeof(T));
+}
+
+const vDSPKernelSet<float>& kernelsFor(const vDSPKernels& kernels, float) {
+    return kernels.f;
+}
+
+const vDSPKernelSet<double>& kernelsFor(const vDSPKernels& kernels, double) {
+    return kernels.d;
+}
+
+size_t roundUp(size_t count, size_t multiple) {
+    return (count + multiple - 1) / multiple * multiple;
+}
+
+size_t maximumThreads() {
+    const int count = s_threadCount.load();
+    return (count > 0) ? static_cast<size_t>(count) : SIZE_MAX;
+}
+
+// One column-major product C = alpha * op(A) * op(B) + beta * C, with C M by N and op(A) M by K.
+template <typename T>
+struct Gemm {
+    bool transA;
+    bool transB;
+    size_t M;
+    size_t N;
+    size_t K;
+    T alpha;
+    const T* A;
+    size_t lda;
+    const T* B;
+    size_t ldb;
+    T beta;
+    T* C;
+    size_t ldc;
+
+    double work() const {
+        return static_cast<double>(M) * N * (K + 1);
+    }
+};
+
+// Rows i0 to i0 + mc and columns p0 to p0 + kc of op(A), a panel of vDSPGemmRows rows after another, each a column at
+// a time. The copies are plain loops rather than calls, which would cost more than the copying for small products.
+template <typename T>
+void packA(const Gemm<T>& g, size_t i0, size_t mc, size_t p0, size_t kc, T* out) {
+    for (size_t i = 0; i < mc; i += vDSPGemmRows, out += kc * vDSPGemmRows) {
+        const size_t rows = std::min<size_t>(vDSPGemmRows, mc - i);
+        const size_t step = g.transA ? 1 : g.lda;
+        const size_t next = g.transA ? g.lda : 1;
+        const T* A = g.A + (g.transA ? p0 + (i0 + i) * g.lda : i0 + i + p0 * g.lda);
+        for (size_t p = 0; p < kc; ++p, A += step) {
+            T* column = out + p * vDSPGemmRows;
+            size_t r = 0;
+            for (; r < rows; ++r) {
+                column[r] = A[r * next];
+            }
+            for (; r < vDSPGemmRows; ++r) {
+                column[r] = 0;
+            }
+        }
+    }
+}
+
+// Rows p0 to p0 + kc and columns j0 to j0 + nc of op(B), a panel of vDSPGemmColumns columns after another, each a
+// row at a time.
+template <typename T>
+void packB(const Gemm<T>& g, size_t p0, size_t kc, size_t j0, size_t nc, T* out) {
+    for (size_t j = 0; j < nc; j += vDSPGemmColumns, out += kc * vDSPGemmColumns) {
+        const size_t columns = std::min<size_t>(vDSPGemmColumns, nc - j);
+        const size_t step = g.transB ? g.ldb : 1;
+        const size_t next = g.transB ? 1 : g.ldb;
+        const T* B = g.B + (g.transB ? j0 + j + p0 * g.ldb : p0 + (j0 + j) * g.ldb);
+        for (size_t p = 0; p < kc; ++p, B += step) {
+            T* row = out + p * vDSPGemmColumns;
+            size_t c = 0;
+            for (; c < columns; ++c) {
+                row[c] = B[c * next];
+            }
+            for (; c < vDSPGemmColumns; ++c) {
+                row[c] = 0;
+            }
+        }
+    }
+}
+
+// C += alpha * the packed mc by kc block of A times the packed kc by nc block of B.
+template <typename T>
+void multiplyBlock(const vDSPKernelSet<T>& kernels, const T* A, const T* B, size_t mc, size_t nc, size_t kc, T alpha, T* C, size_t ldc) {
+    for (size_t i = 0; i < mc; i += vDSPGemmRows, A += kc * vDSPGemmRows) {
+        const size_t rows = std::min<size_t>(vDSPGemmRows, mc - i);
+        size_t j = 0;
+        if (rows == vDSPGemmRows) {
+            j = kernels.gemm(A, B, kc, alpha, C + i, ldc, nc);
+        }
+
+        for (; j < nc; j += vDSPGemmColumns) {
+            T tile[vDSPGemmRows * vDSPGemmColumns] = {};
+            kernels.gemm(A, B + j * kc, kc, alpha, tile, vDSPGemmRows, vDSPGemmColumns);
+            const size_t columns = std::min<size_t>(vDSPGemmColumns, nc - j);
+            for (size_t c = 0; c < columns; ++c) {
+                T* out = C + i + (j + c) * ldc;
+                for (size_t r = 0; r < rows; ++r) {
+                    out[r] += tile[c * vDSPGemmRows + r];
+                }
+            }
+        }
+    }
+}
+
+// Rows m0 to m1 and columns n0 to n1 of the product, on the calling thread.
+template <typename T>
+void multiplyPart(const Gemm<T>& g, size_t m0, size_t m1, size_t n0, size_t n1) {
+    if (g.beta != T(1)) {
+        for (size_t j = n0; j < n1; ++j) {
+            T* column = g.C + j * g.ldc;
+            for (size_t i = m0; i < m1; ++i) {
+                column[i] = (g.beta == T(0)) ? T(0) : column[i] * g.beta;
+            }
+        }
+    }
+    if (g.K == 0 || g.alpha == T(0)) {
+        return;
+    }
+
+    // Kept from one call to the next, since a batch of small products would otherwise spend its time allocating them.
+    thread_local std::vector<T> packedA;
+    thread_local std::vector<T> packedB;
+
+    const vDSPKernelSet<T>& kernels = kernelsFor(vDSPGetKernels(), T());
+    const size_t blockRows = rowsPerBlock<T>();
+    for (size_t j = n0; j < n1; j += c_blockN) {
+        const size_t nc = std::min(c_blockN, n1 - j);
+        for (size_t p = 0; p < g.K; p += c_blockK) {
+            const size_t kc = std::min(c_blockK, g.K - p);
+            packedB.resize(std::max(packedB.size(), roundUp(nc, vDSPGemmColumns) * kc));
+            packB(g, p, kc, j, nc, packedB.data());
+            for (size_t i = m0; i < m1; i += blockRows) {
+                const size_t mc = std::min(blockRows, m1 - i);
+                packedA.resize(std::max(packedA.size(), roundUp(mc, vDSPGemmRows) * kc));
+                packA(g, i, mc, p, kc, packedA.data());
+                multiplyBlock(kernels, packedA.data(), packedB.data(), mc, nc, kc, g.alpha, g.C + i + j * g.ldc, g.ldc);
+            }
+        }
+    }
+}
+
+// How many threads to split the product across, up to maximum, and whether by columns rather than rows, in steps of
+// whole tiles.
+template <typename T>
+size_t threadsFor(const Gemm<T>& g, size_t maximum, bool* byColumns, size_t* steps) {
+    *byColumns = g.N >= g.M;
+    const size_t step = *byColumns ? vDSPGemmColumns : vDSPGemmRows;
+    const size_t extent = *byColumns ? g.N : g.M;
+    *steps = (extent + step - 1) / step;
+    if (maximum <= 1 || g.work() < 2 * c_parallelWork) {
+        return 1;
+    }
+    const double stepWork = g.work() * step / std::max<size_t>(extent, 1);
+    const size_t minimumSteps = static_cast<size_t>(std::max(c_parallelWork / std::max(stepWork, 1.0), 1.0));
+    return std::min(maximum, AccelerateParallelThreads(*steps, minimumSteps));
+}
+
+template <typename T>
+void multiply(const Gemm<T>& g, size_t maximum) {
+    if (g.M == 0 || g.N == 0) {
+        return;
+    }
+
+    bool byColumns;
+    size_t steps;
+    const size_t threads = threadsFor(g, maximum, &byColumns, &steps);
+    if (threads <= 1) {
+        multiplyPart(g, 0, g.M, 0, g.N);
+        return;
+    }
+
+    const size_t step = byColumns ? vDSPGemmColumns : vDSPGemmRows;
+    AccelerateParallelFor(threads, 1, [&](size_t begin, size_t end) {
+        for (size_t thread = begin; thread < end; ++thread) {
+            const size_t first = steps * thread / threads * step;
+            const size_t last = steps * (thread + 1) / threads * step;
+            if (byColumns) {
+                multiplyPart(g, 0, g.M, first, std::min(last, g.N));
+            } else {
+                multiplyPart(g, first, std::min(last, g.M), 0, g.N);
+            }
+        }
+    });
+}
+
+// count products alike in size, product(i) giving each. Spread across threads one product to a thread when that keeps
+// at least as many threads busy as splitting each product would.
+template <typename T, typename Product>
+void multiplyBatch(size_t count, const Product& product) {
+    if (count == 0) {
+        return;
+    }
+
+    const size_t maximum = maximumThreads();
+    const Gemm<T> first = product(0);
+    bool byColumns;
+    size_t steps;
+    const size_t within = threadsFor(first, maximum, &byColumns, &steps);
+    const size_t minimumProducts = static_cast<size_t>(std::max(c_parallelWork / std::max(first.work(), 1.0), 1.0));
+    const size_t across = std::min(maximum, AccelerateParallelThreads(count, minimumProducts));
+    if (across <= 1 || across < within) {
+        for (size_t i = 0; i < count; ++i) {
+            multiply(product(i), maximum);
+        }
+        return;
+    }
+
+    AccelerateParallelFor(across, 1, [&](size_t begin, size_t end) {
+        for (size_t thread = begin; thread < end; ++thread) {
+            for (size_t i = count * thread / across; i < count * (thread + 1) / across; ++i) {
+                multiply(product(i), 1);
+            }
+        }
+    });
+}
+
+// The product as column-major, for the arguments of cblas_?gemm once checked. A row-major product is the column-major
+// product of the transposes the other way round.
+template <typename T>
+Gemm<T> columnMajor(const enum CBLAS_ORDER Order,
+                    const enum CBLAS_TRANSPOSE TransA,
+                    const enum CBLAS_TRANSPOSE TransB,
+                    const int M,
+                    const int N,
+                    const int K,
+                    const T alpha,
+                    const T* A,
+                    const int lda,
+                    const T* B,
+                    const int ldb,
+                    const T beta,
+                    T* C,
+                    const int ldc) {
+    if (Order == CblasRowMajor) {
+        return { TransB != CblasNoTrans, TransA != CblasNoTrans, size_t(N), size_t(M), size_t(K), alpha, B, size_t(ldb), A,
+                 size_t(lda), beta, C, size_t(ldc) };
+    }
+    return { TransA != CblasNoTrans, TransB != CblasNoTrans, size_t(M), size_t(N), size_t(K), alpha, A, size_t(lda), B,
+             size_t(ldb), beta, C, size_t(ldc) };
+}
+
+bool isTranspose(const enum CBLAS_TRANSPOSE Trans) {
+    return Trans == CblasNoTrans || Trans == CblasTrans || Trans == CblasConjTrans;
+}
+
+// The position of the first bad argument to cblas_?gemm, or 0 if there is none.
+int checkArguments(const enum CBLAS_ORDER Order,
+                   const enum CBLAS_TRANSPOSE TransA,
+                   const enum CBLAS_TRANSPOSE TransB,
+                   const int M,
+                   const int N,
+                   const int K,
+                   const int lda,
+                   const int ldb,
+                   const int ldc) {
+    if (Order != CblasRowMajor && Order != CblasColMajor) {
+        return 1;
+    } else if (!isTranspose(TransA)) {
+        return 2;
+    } else if (!isTranspose(TransB)) {
+        return 3;
+    } else if (M < 0) {
+        return 4;
+    } else if (N < 0) {
+        return 5;
+    } else if (K < 0) {
+        return 6;
+    }
+
+    const bool rowMajor = Order == CblasRowMajor;
+    const int rowsA = ((TransA == CblasNoTrans) != rowMajor) ? M : K;
+    const int rowsB = ((TransB == CblasNoTrans) != rowMajor) ? K : N;
+    if (lda < std::max(1, rowsA)) {
+        return 9;
+    } else if (ldb < std::max(1, rowsB)) {
+        return 11;
+    } else if (ldc < std::max(1, rowMajor ? N : M)) {
+        return 14;
+    }
+    return 0;
+}
+
+template <typename T>
+void stridedBatch(const char* name,
+                  const enum CBLAS_ORDER Order,
+                  const enum CBLAS_TRANSPOSE TransA,
+                  const enum CBLAS_TRANSPOSE TransB,
+                  const int M,
+                  const int N,
+                  const int K,
+                  const T alpha,
+                  const T* A,
+                  const int lda,
+                  const int stridea,
+                  const T* B,
+                  const int ldb,
+                  const int strideb,
+                  const T beta,
+                  T* C,
+                  const int ldc,
+                  const int stridec,
+                  const int batch_size) {
+    // The strides come after each leading dimension.
+    int position = checkArguments(Order, TransA, TransB, M, N, K, lda, ldb, ldc);
+    if (position == 11) {
+        position = 12;
+    } else if (position == 14) {
+        position = 16;
+    } else if (position == 0 && batch_size < 0) {
+        position = 18;
+    }
+    if (position != 0) {
+        cblas_xerbla(position, name, "");
+        return;
+    }
+
+    const Gemm<T> g = columnMajor(Order, TransA, TransB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+    const bool rowMajor = Order == CblasRowMajor;
+    const ptrdiff_t strideA = rowMajor ? strideb : stridea;
+    const ptrdiff_t strideB = rowMajor ? stridea : strideb;
+    multiplyBatch<T>(batch_size, [&](size_t i) {
+        Gemm<T> product = g;
+        product.A += strideA * static_cast<ptrdiff_t>(i);
+        product.B += strideB * static_cast<ptrdiff_t>(i);
+        product.C += stridec * static_cast<ptrdiff_t>(i);
+        return product;
+    });
+}
+
+template <typename T>
+void groupedBatch(const char* name,
+                  const enum CBLAS_ORDER Order,
+                  const enum CBLAS_TRANSPOSE* TransA_Array,
+                  const enum CBLAS_TRANSPOSE* TransB_Array,
+                  const int* M_Array,
+                  const int* N_Array,
+                  const int* K_Array,
+                  const T* alpha_Array,
+                  const T** A_Array,
+                  const int* lda_Array,
+                  const T** B_Array,
+                  const int* ldb_Array,
+                  const T* beta_Array,
+                  T** C_Array,
+                  const int* ldc_Array,
+                  const int group_count,
+                  const int* group_size) {
+    // Nothing is multiplied unless every group is good.
+    if (group_count < 0) {
+        cblas_xerbla(15, name, "");
+        return;
+    }
+    for (int group = 0; group < group_count; ++group) {
+        int position = checkArguments(Order,
+                                      TransA_Array[group],
+                                      TransB_Array[group],
+                                      M_Array[group],
+                                      N_Array[group],
+                                      K_Array[group],
+                                      lda_Array[group],
+                                      ldb_Array[group],
+                                      ldc_Array[group]);
+        if (position == 0 && group_size[group] < 0) {
+            position = 16;
+        }
+        if (position != 0) {
+            cblas_xerbla(position, name, "");
+            return;
+        }
+    }
+
+    size_t first = 0;
+    for (int group = 0; group < group_count; ++group) {
+        const Gemm<T> g = columnMajor(Order,
+                                      TransA_Array[group],
+                                      TransB_Array[group],
+                                      M_Array[group],
+                                      N_Array[group],
+                                      K_Array[group],
+                                      alpha_Array[group],
+                                      static_cast<const T*>(nullptr),
+                                      lda_Array[group],
+                                      static_cast<const T*>(nullptr),
+                                      ldb_Array[group],
+                                      beta_Array[group],
+                                      static_cast<T*>(nullptr),
+                                      ldc_Array[group]);
+        const bool rowMajor = Order == CblasRowMajor;
+        multiplyBatch<T>(group_size[group], [&](size_t i) {
+            Gemm<T> product = g;
+            product.A = rowMajor ? B_Array[first + i] : A_Array[first + i];
+            product.B = rowMajor ? A_Array[first + i] : B_Array[first + i];
+            product.C = C_Array[first + i];
+            return product;
+        });
+        first += group_size[group];
+    }
+}
+
+// 0 for no transpose, 1 for a transpose, which for real matrices is the same as the conjugate transpose, and -1 if
+// neither.
+int fortranTranspose(const char* Trans) {
+    switch (*Trans) {
+        case 'N':
+        case 'n':
+            return 0;
+        case 'T':
+        case 't':
+        case 'C':
+        case 'c':
+            return 1;
+        default:
+            return -1;
+    }
+}
+
+// The Fortran interface behind cblas_?gemm, with the same checks and error numbers as the reference BLAS.
+template <typename T>
+void fortranGemm(const char* name,
+                 const char* TransA,
+                 const char* TransB,
+                 const int* M,
+                 const int* N,
+                 const int* K,
+                 const T* alpha,
+                 const T* A,
+                 const int* lda,
+                 const T* B,
+                 const int* ldb,
+                 const T* beta,
+                 T* C,
+                 const int* ldc) {
+    const int transA = fortranTranspose(TransA);
+    const int transB = fortranTranspose(TransB);
+    int info = 0;
+    if (transA < 0) {
+        info = 1;
+    } else if (transB < 0) {
+        info = 2;
+    } else if (*M < 0) {
+        info = 3;
+    } else if (*N < 0) {
+        info = 4;
+    } else if (*K < 0) {
+        info = 5;
+    } else if (*lda < std::max(1, transA ? *K : *M)) {
+        info = 8;
+    } else if (*ldb < std::max(1, transB ? *N : *K)) {
+        info = 10;
+    } else if (*ldc < std::max(1, *M)) {
+        info = 13;
+    }
+    if (info != 0) {
+        xerbla_(name, &info, 6);
+        return;
+    }
+
+    const Gemm<T> g = { transA != 0, transB != 0, size_t(*M),   size_t(*N), size_t(*K), *alpha,     A,
+                        size_t(*lda), B,          size_t(*ldb), *beta,      C,          size_t(*ldc) };
+    multiply(g, maximumThreads());
+}
+
+} // namespace
+
+extern "C" {
+
+void __sgemm__(char* TransA, char* TransB, const int* M, const int* N, const int* K, const float* alpha, const float* A, const int* lda,
+               const float* B, const int* ldb, const float* beta, float* C, const int* ldc) {
+    fortranGemm("SGEMM ", TransA, TransB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+void __dgemm__(char* TransA, char* TransB, const int* M, const int* N, const int* K, const double* alpha, const double* A,
+               const int* lda, const double* B, const int* ldb, const double* beta, double* C, const int* ldc) {
+    fortranGemm("DGEMM ", TransA, TransB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+// batch_size products of the same size, the matrices of each stridea, strideb and stridec elements on from those of the
+// one before, as in Intel MKL. A stride of 0 uses the same matrix for every product.
+void cblas_sgemm_batch_strided(const enum CBLAS_ORDER Order,
+                               const enum CBLAS_TRANSPOSE TransA,
+                               const enum CBLAS_TRANSPOSE TransB,
+                               const int M,
+                               const int N,
+                               const int K,
+                               const float alpha,
+                               const float* A,
+                               const int lda,
+                               const int stridea,
+                               const float* B,
+                               const int ldb,
+                               const int strideb,
+                               const float beta,
+                               float* C,
+                               const int ldc,
+                               const int stridec,
+                               const int batch_size) {
+    stridedBatch("cblas_sgemm_batch_strided",
+                 Order,
+                 TransA,
+                 TransB,
+                 M,
+                 N,
+                 K,
+                 alpha,
+                 A,
+                 lda,
+                 stridea,
+                 B,
+                 ldb,
+                 strideb,
+                 beta,
+                 C,
+                 ldc,
+                 stridec,
+                 batch_size);
+}
+
+// batch_size products of the same size, the matrices of each stridea, strideb and stridec elements on from those of the
+// one before, as in Intel MKL. A stride of 0 uses the same matrix for every product.
+void cblas_dgemm_batch_strided(const enum CBLAS_ORDER Order,
+                               const enum CBLAS_TRANSPOSE TransA,
+                               const enum CBLAS_TRANSPOSE TransB,
+                               const int M,
+                               const int N,
+                               const int K,
+                               const double alpha,
+                               const double* A,
+                               const int lda,
+                               const int stridea,
+                               const double* B,
+                               const int ldb,
+                               const int strideb,
+                               const double beta,
+                               double* C,
+                               const int ldc,
+                               const int stridec,
+                               const int batch_size) {
+    stridedBatch("cblas_dgemm_batch_strided",
+                 Order,
+                 TransA,
+                 TransB,
+                 M,
+                 N,
+                 K,
+                 alpha,
+                 A,
+                 lda,
+                 stridea,
+                 B,
+                 ldb,
+                 strideb,
+                 beta,
+                 C,
+                 ldc,
+                 stridec,
+                 batch_size);
+}
+
+// group_count groups of group_size[i] products, each group with its own sizes, transposes and scalars and the matrices
+// of each product listed one after another, as in Intel MKL.
+void cblas_sgemm_batch(const enum CBLAS_ORDER Order,
+                       const enum CBLAS_TRANSPOSE* TransA_Array,
+                       const enum CBLAS_TRANSPOSE* TransB_Array,
+                       const int* M_Array,
+                       const int* N_Array,
+                       const int* K_Array,
+                       const float* alpha_Array,
+                       const float** A_Array,
+                       const int* lda_Array,
+                       const float** B_Array,
+                       const int* ldb_Array,
+                       const float* beta_Array,
+                       float** C_Array,
+                       const int* ldc_Array,
+                       const int group_count,
+                       const int* group_size) {
+    groupedBatch("cblas_sgemm_batch",
+                 Order,
+                 TransA_Array,
+                 TransB_Array,
+                 M_Array,
+                 N_Array,
+                 K_Array,
+                 alpha_Array,
+                 A_Array,
+                 lda_Array,
+                 B_Array,
+                 ldb_Array,
+                 beta_Array,
+                 C_Array,
+                 ldc_Array,
+                 group_count,
+                 group_size);
+}
+
+// group_count groups of group_size[i] products, each group with its own sizes, transposes and scalars and the matrices
+// of each product listed one after another, as in Intel MKL.
+void cblas_dgemm_batch(const enum CBLAS_ORDER Order,
+                       const enum CBLAS_TRANSPOSE* TransA_Array,
+                       const enum CBLAS_TRANSPOSE* TransB_Array,
+                       const int* M_Array,
+                       const int* N_Array,
+                       const int* K_Array,
+                       const double* alpha_Array,
+                       const double** A_Array,
+                       const int* lda_Array,
+                       const double** B_Array,
+                       const int* ldb_Array,
+                       const double* beta_Array,
+                       double** C_Array,
+                       const int* ldc_Array,
+                       const int group_count,
+                       const int* group_size) {
+    groupedBatch("cblas_dgemm_batch",
+                 Order,
+                 TransA_Array,
+                 TransB_Array,
+                 M_Array,
+                 N_Array,
+                 K_Array,
+                 alpha_Array,
+                 A_Array,
+                 lda_Array,
+                 B_Array,
+                 ldb_Array,
+                 beta_Array,
+                 C_Array,
+                 ldc_Array,
+                 group_count,
+                 group_size);
+}
+
+// Sets how many threads sgemm and dgemm may use, counting the calling thread. 0 or less leaves it to the number of
+// processors, and 1 keeps them on the calling thread.
+void SetBLASThreadCount(int count) {
+    s_threadCount.store(std::max(count, 0));
+}
+
+int GetBLASThreadCount(void) {
+    return s_threadCount.load();
+}
+
+} // extern "C"
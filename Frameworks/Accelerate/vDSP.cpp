@@ -20,17 +20,20 @@
 #include <cmath>
 #include <algorithm>
 #include "Accelerate\vDSP.h"
+#include "vDSPInternal.h"
 
 
 void vDSP_vabs(const float* A, vDSP_Stride IA, float* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vabs(A, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = abs(A[i*IA]);
     }
 }
 
 
 void vDSP_vabsD(const double* A, vDSP_Stride IA, double* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vabs(A, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = abs(A[i*IA]);
     }
 }
@@ -58,28 +61,32 @@ void vDSP_zvabsD(const DSPDoubleSplitComplex* A, vDSP_Stride IA, double* C, vDSP
 
 
 void vDSP_vnabs(const float* A, vDSP_Stride IA, float* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vnabs(A, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = -abs(A[i*IA]);
     }
 }
 
 
 void vDSP_vnabsD(const double* A, vDSP_Stride IA, double* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vnabs(A, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = -abs(A[i*IA]);
     }
 }
 
 
 void vDSP_vneg(const float* A, vDSP_Stride IA, float* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vneg(A, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = -A[i*IA];
     }
 }
 
 
 void vDSP_vnegD(const double* A, vDSP_Stride IA, double* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vneg(A, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = -A[i*IA];
     }
 }
@@ -103,7 +110,8 @@ void vDSP_zvnegD(const DSPDoubleSplitComplex* A, vDSP_Stride IA, const DSPDouble
 
 void vDSP_vfill(const float* A, float* C, vDSP_Stride IC, vDSP_Length N) {
     float a = *A;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vfill(a, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = a;
     }
 }
@@ -111,7 +119,8 @@ void vDSP_vfill(const float* A, float* C, vDSP_Stride IC, vDSP_Length N) {
 
 void vDSP_vfillD(const double* A, double* C, vDSP_Stride IC, vDSP_Length N) {
     double a = *A;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vfill(a, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = a;
     }
 }
@@ -146,14 +155,16 @@ void vDSP_zvfillD(const DSPDoubleSplitComplex* A, const DSPDoubleSplitComplex* C
 
 
 void vDSP_vclr(float* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vfill(0.0f, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = 0.0;
     }
 }
 
 
 void vDSP_vclrD(double* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vfill(0.0, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = 0.0;
     }
 }
@@ -278,49 +289,56 @@ void vDSP_vgenD(const double* A, const double* B, double* C, vDSP_Stride IC, vDS
 
 
 void vDSP_vsq(const float* A, vDSP_Stride IA, float* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vsq(A, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] * A[i*IA];
     }
 }
 
 
 void vDSP_vsqD(const double* A, vDSP_Stride IA, double* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vsq(A, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] * A[i*IA];
     }
 }
 
 
 void vDSP_vssq(const float* A, vDSP_Stride IA, float* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vssq(A, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] * abs(A[i*IA]);
     }
 }
 
 
 void vDSP_vssqD(const double* A, vDSP_Stride IA, double* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vssq(A, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] * abs(A[i*IA]);
     }
 }
 
 
 void vDSP_zvmags(const DSPSplitComplex* A, vDSP_Stride IA, float* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.zvmags(A->realp, A->imagp, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A->realp[i*IA] * A->realp[i*IA] + A->imagp[i*IA] * A->imagp[i*IA];
     }
 }
 
 
 void vDSP_zvmagsD(const DSPDoubleSplitComplex* A, vDSP_Stride IA, double* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.zvmags(A->realp, A->imagp, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A->realp[i*IA] * A->realp[i*IA] + A->imagp[i*IA] * A->imagp[i*IA];
     }
 }
 
 
 void vDSP_zvmgsa(const DSPSplitComplex* A, vDSP_Stride IA, const float* B, vDSP_Stride IB, float* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.zvmgsa(A->realp, A->imagp, IA, B, IB, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A->realp[i*IA] * A->realp[i*IA] + A->imagp[i*IA] * A->imagp[i*IA] + B[i*IB];
     }
 }
@@ -328,21 +346,24 @@ void vDSP_zvmgsa(const DSPSplitComplex* A, vDSP_Stride IA, const float* B, vDSP_
 
 void vDSP_zvmgsaD(const DSPDoubleSplitComplex* A, vDSP_Stride IA, const double* B, vDSP_Stride IB, double* C, vDSP_Stride IC, 
                   vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.zvmgsa(A->realp, A->imagp, IA, B, IB, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A->realp[i*IA] * A->realp[i*IA] + A->imagp[i*IA] * A->imagp[i*IA] + B[i*IB];
     }
 }
 
 
 void vDSP_vfrac(const float* A, vDSP_Stride IA, float* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vfrac(A, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] - trunc(A[i*IA]);
     }
 }
 
 
 void vDSP_vfracD(const double* A, vDSP_Stride IA, double* C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vfrac(A, IA, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] - trunc(A[i*IA]);
     }
 }
@@ -351,7 +372,8 @@ void vDSP_vfracD(const double* A, vDSP_Stride IA, double* C, vDSP_Stride IC, vDS
 void vDSP_vclip(const float* A, vDSP_Stride IA, const float* B, const float* C, float* D, vDSP_Stride ID, vDSP_Length N) {
     float b = *B;
     float c = *C;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (ID == 1) ? vDSPGetKernels().f.vclip(A, IA, b, c, D, N) : 0;
+    for (; i < N; ++i) {
         D[i*ID] = (A[i*IA] < b) ? b : ((A[i*IA] > c) ? c : A[i*IA]);
     }
 }
@@ -360,7 +382,8 @@ void vDSP_vclip(const float* A, vDSP_Stride IA, const float* B, const float* C,
 void vDSP_vclipD(const double* A, vDSP_Stride IA, const double* B, const double* C, double* D, vDSP_Stride ID, vDSP_Length N) {
     double b = *B;
     double c = *C;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (ID == 1) ? vDSPGetKernels().d.vclip(A, IA, b, c, D, N) : 0;
+    for (; i < N; ++i) {
         D[i*ID] = (A[i*IA] < b) ? b : ((A[i*IA] > c) ? c : A[i*IA]);
     }
 }
@@ -415,7 +438,8 @@ void vDSP_viclipD(const double* A, vDSP_Stride IA, const double* B, const double
 void vDSP_vlim(const float* A, vDSP_Stride IA, const float* B, const float* C, float* D, vDSP_Stride ID, vDSP_Length N) {
     float b = *B;
     float c = *C;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (ID == 1) ? vDSPGetKernels().f.vlim(A, IA, b, c, D, N) : 0;
+    for (; i < N; ++i) {
         D[i*ID] = (A[i*IA] >=  b) ? c : -c;
     }
 }
@@ -424,7 +448,8 @@ void vDSP_vlim(const float* A, vDSP_Stride IA, const float* B, const float* C, f
 void vDSP_vlimD(const double* A, vDSP_Stride IA, const double* B, const double* C, double* D, vDSP_Stride ID, vDSP_Length N) {
     double b = *B;
     double c = *C;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (ID == 1) ? vDSPGetKernels().d.vlim(A, IA, b, c, D, N) : 0;
+    for (; i < N; ++i) {
         D[i*ID] = (A[i*IA] >=  b) ? c : -c;
     }
 }
@@ -432,7 +457,8 @@ void vDSP_vlimD(const double* A, vDSP_Stride IA, const double* B, const double*
 
 void vDSP_vthr(const float* A, vDSP_Stride IA, const float* B, float* C, vDSP_Stride IC, vDSP_Length N) {
     float  b = *B;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vthr(A, IA, b, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = (A[i*IA] >=  b) ? A[i*IA] : b;
     }
 }
@@ -440,7 +466,8 @@ void vDSP_vthr(const float* A, vDSP_Stride IA, const float* B, float* C, vDSP_St
 
 void vDSP_vthrD(const double* A, vDSP_Stride IA, const double* B, double* C, vDSP_Stride IC, vDSP_Length N) {
     double  b = *B;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vthr(A, IA, b, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = (A[i*IA] >=  b) ? A[i*IA] : b;
     }
 }
@@ -448,7 +475,8 @@ void vDSP_vthrD(const double* A, vDSP_Stride IA, const double* B, double* C, vDS
 
 void vDSP_vthres(const float* A, vDSP_Stride IA, const float* B, float* C, vDSP_Stride IC, vDSP_Length N) {
     float  b = *B;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vthres(A, IA, b, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = (A[i*IA] >=  b) ? A[i*IA] : 0;
     }
 }
@@ -456,7 +484,8 @@ void vDSP_vthres(const float* A, vDSP_Stride IA, const float* B, float* C, vDSP_
 
 void vDSP_vthresD(const double* A, vDSP_Stride IA, const double* B, double* C, vDSP_Stride IC, vDSP_Length N) {
     double  b = *B;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vthres(A, IA, b, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = (A[i*IA] >=  b) ? A[i*IA] : 0;
     }
 }
@@ -465,7 +494,8 @@ void vDSP_vthresD(const double* A, vDSP_Stride IA, const double* B, double* C, v
 void vDSP_vthrsc(const float* A, vDSP_Stride IA, const float* B, const float* C, float* D, vDSP_Stride ID, vDSP_Length N) {
     float b = *B;
     float c = *C;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (ID == 1) ? vDSPGetKernels().f.vlim(A, IA, b, c, D, N) : 0;
+    for (; i < N; ++i) {
         D[i*ID] = (A[i*IA] >=  b) ? c : -c;
     }
 }
@@ -474,7 +504,8 @@ void vDSP_vthrsc(const float* A, vDSP_Stride IA, const float* B, const float* C,
 void vDSP_vthrscD(const double* A, vDSP_Stride IA, const double* B, const double* C, double* D, vDSP_Stride ID, vDSP_Length N) {
     double b = *B;
     double c = *C;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (ID == 1) ? vDSPGetKernels().d.vlim(A, IA, b, c, D, N) : 0;
+    for (; i < N; ++i) {
         D[i*ID] = (A[i*IA] >=  b) ? c : -c;
     }
 }
@@ -672,7 +703,8 @@ void vDSP_vdbconD(const double *A, vDSP_Stride IA, const double *B, double *C, v
 
 void vDSP_vsadd(const float *A, vDSP_Stride IA, const float *B, float *C, vDSP_Stride IC, vDSP_Length N) {
     float b = *B;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vsadd(A, IA, b, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] + b;
     }
 }
@@ -680,7 +712,8 @@ void vDSP_vsadd(const float *A, vDSP_Stride IA, const float *B, float *C, vDSP_S
 
 void vDSP_vsaddD(const double *A, vDSP_Stride IA, const double *B, double *C, vDSP_Stride IC, vDSP_Length N) {
     double b = *B;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vsadd(A, IA, b, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] + b;
     }
 }
@@ -696,7 +729,8 @@ void vDSP_vsaddi(const int *A, vDSP_Stride IA, const int *B, int *C, vDSP_Stride
 
 void vDSP_vsmul(const float *A, vDSP_Stride IA, const float *B, float *C, vDSP_Stride IC, vDSP_Length N) {
     float b = *B;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vsmul(A, IA, b, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] * b;
     }
 }
@@ -704,7 +738,8 @@ void vDSP_vsmul(const float *A, vDSP_Stride IA, const float *B, float *C, vDSP_S
 
 void vDSP_vsmulD(const double *A, vDSP_Stride IA, const double *B, double *C, vDSP_Stride IC, vDSP_Length N) {
     double b = *B;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vsmul(A, IA, b, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] * b;
     }
 }
@@ -733,14 +768,16 @@ void vDSP_zvzsmlD(const DSPDoubleSplitComplex *A, vDSP_Stride IA, const DSPDoubl
 
 
 void vDSP_vadd(const float *A, vDSP_Stride IA, const float *B, vDSP_Stride IB, float *C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vadd(A, IA, B, IB, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] + B[i*IB];
     }
 }
 
 
 void vDSP_vaddD(const double *A, vDSP_Stride IA, const double *B, vDSP_Stride IB, double *C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vadd(A, IA, B, IB, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] + B[i*IB];
     }
 }
@@ -748,7 +785,8 @@ void vDSP_vaddD(const double *A, vDSP_Stride IA, const double *B, vDSP_Stride IB
 
 void vDSP_vasm(const float *A, vDSP_Stride IA, const float *B, vDSP_Stride IB, const float *C, float *D, vDSP_Stride ID, vDSP_Length N) {
     float c = *C;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (ID == 1) ? vDSPGetKernels().f.vasm(A, IA, B, IB, c, D, N) : 0;
+    for (; i < N; ++i) {
         D[i*ID] = (A[i*IA] + B[i*IB]) * c;
     }
 }
@@ -757,21 +795,24 @@ void vDSP_vasm(const float *A, vDSP_Stride IA, const float *B, vDSP_Stride IB, c
 void vDSP_vasmD(const double *A, vDSP_Stride IA, const double *B, vDSP_Stride IB, const double *C, double *D, vDSP_Stride ID, 
                 vDSP_Length N) {
     double c = *C;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (ID == 1) ? vDSPGetKernels().d.vasm(A, IA, B, IB, c, D, N) : 0;
+    for (; i < N; ++i) {
         D[i*ID] = (A[i*IA] + B[i*IB]) * c;
     }
 }
 
 
 void vDSP_vmul(const float *A, vDSP_Stride IA, const float *B, vDSP_Stride IB, float *C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().f.vmul(A, IA, B, IB, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] * B[i*IB];
     }
 }
 
 
 void vDSP_vmulD(const double *A, vDSP_Stride IA, const double *B, vDSP_Stride IB, double *C, vDSP_Stride IC, vDSP_Length N) {
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = (IC == 1) ? vDSPGetKernels().d.vmul(A, IA, B, IB, C, N) : 0;
+    for (; i < N; ++i) {
         C[i*IC] = A[i*IA] * B[i*IB];
     }
 }
@@ -779,7 +820,8 @@ void vDSP_vmulD(const double *A, vDSP_Stride IA, const double *B, vDSP_Stride IB
 
 void vDSP_maxv(const float *A, vDSP_Stride IA, float *C, vDSP_Length N) {
     float c = FLT_MIN;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = vDSPGetKernels().f.maxv(A, IA, N, &c);
+    for (; i < N; ++i) {
         if (c < A[i*IA]) {
             c = A[i*IA];
         }
@@ -790,7 +832,8 @@ void vDSP_maxv(const float *A, vDSP_Stride IA, float *C, vDSP_Length N) {
 
 void vDSP_maxvD(const double *A, vDSP_Stride IA, double *C, vDSP_Length N) {
     double c = DBL_MIN;
-    for (vDSP_Length i = 0; i < N; ++i) {
+    vDSP_Length i = vDSPGetKernels().d.maxv(A, IA, N, &c);
+    for (; i < N; ++i) {
         if (c < A[i*IA]) {
             c = A[i*IA];
         }
@@ -804,7 +847,8 @@ void vDSP_measqv(const float *A, vDSP_Stride IA, float *C, vDSP_Length N) {
     float t;
     if (N > 0) {
         float scale = 1.0f / sqrtf(static_cast<float>(N));
-        for (vDSP_Length i = 0; i < N; ++i) {
+        vDSP_Length i = vDSPGetKernels().f.svesq(A, IA, scale, N, &c);
+        for (; i < N; ++i) {
             t = A[i*IA] * scale;
             c += t*t;
         }
@@ -821,7 +865,8 @@ void vDSP_measqvD(const double *A, vDSP_Stride IA, double *C, vDSP_Length N) {
     double t;
     if (N > 0) {
         double scale = 1.0 / sqrt(N);
-        for (vDSP_Length i = 0; i < N; ++i) {
+        vDSP_Length i = vDSPGetKernels().d.svesq(A, IA, scale, N, &c);
+        for (; i < N; ++i) {
             t = A[i*IA] * scale;
             c += t*t;
         }
@@ -838,7 +883,8 @@ void vDSP_rmsqv(const float *A, vDSP_Stride IA, float *C, vDSP_Length N) {
     float t;
     if (N > 0) {
         float max = FP_ZERO;
-        for (vDSP_Length i = 0; i < N; ++i) {
+        vDSP_Length i = vDSPGetKernels().f.maxmgv(A, IA, N, &max);
+        for (; i < N; ++i) {
             float val = fabs(A[i*IA]);
             if (val > max) {
                 max = val;
@@ -846,7 +892,8 @@ void vDSP_rmsqv(const float *A, vDSP_Stride IA, float *C, vDSP_Length N) {
         }
         if (max > 0) {
             float scale = 1.0f / (max * sqrtf(static_cast<float>(N)));
-            for (vDSP_Length i = 0; i < N; ++i) {
+            i = vDSPGetKernels().f.svesq(A, IA, scale, N, &c);
+            for (; i < N; ++i) {
                 t = A[i*IA] * scale;
                 c += t*t;
             }
@@ -865,7 +912,8 @@ void vDSP_rmsqvD(const double *A, vDSP_Stride IA, double *C, vDSP_Length N) {
     double t;
     if (N > 0) {
         double max = FP_ZERO;
-        for (vDSP_Length i = 0; i < N; ++i) {
+        vDSP_Length i = vDSPGetKernels().d.maxmgv(A, IA, N, &max);
+        for (; i < N; ++i) {
             double val = fabs(A[i*IA]);
             if (val > max) {
                 max = val;
@@ -873,7 +921,8 @@ void vDSP_rmsqvD(const double *A, vDSP_Stride IA, double *C, vDSP_Length N) {
         }
         if (max > 0) {
             double scale = 1.0 / (max * sqrt(N));
-            for (vDSP_Length i = 0; i < N; ++i) {
+            i = vDSPGetKernels().d.svesq(A, IA, scale, N, &c);
+            for (; i < N; ++i) {
                 t = A[i*IA] * scale;
                 c += t*t;
             }
@@ -917,304 +966,3 @@ void vDSP_blkman_windowD(double *C, vDSP_Length N, int Flag) {
         C[i] = 0.42 - (0.5 * cos(2 * M_PI * i / N)) + (0.08 * cos(4 * M_PI * i / N));
     }
 }
-
-
-static inline int isPowerOfTwo(vDSP_Length length) {
-    return !(length & (length - 1));
-}
-
-
-static inline int isValidDFTLength(vDSP_Length length, unsigned int minLength) {
-    return isPowerOfTwo(length) ||
-           ((length % 3 == 0) && isPowerOfTwo(length / 3) && (length >= 3 * minLength)) ||
-           ((length % 5 == 0) && isPowerOfTwo(length / 5) && (length >= 5 * minLength)) ||
-           ((length % 15 == 0) && isPowerOfTwo(length / 15) && (length >= 15 * minLength));
-}
-
-
-//Creates a setup object to be used for complex-to-complex single-precision DFT/IDFT computation
-vDSP_DFT_Setup vDSP_DFT_zop_CreateSetup(vDSP_DFT_Setup __Previous, vDSP_Length __Length, vDSP_DFT_Direction __Direction) {
-    vDSP_DFT_Setup DFTObject;
-    if (!__Previous) {
-        DFTObject = new vDSP_DFT_SetupStruct;
-    } else {
-        DFTObject = __Previous;
-    }
-
-    if (!DFTObject || __Length <= 0 || (__Direction != vDSP_DFT_FORWARD && __Direction != vDSP_DFT_INVERSE)) {
-        return nullptr;
-    }
-
-    //Check for length requirements - Power of Two (or) Power of Two multiplied by 3, 5, or 15
-    if (!isValidDFTLength(__Length, 8)) {
-        return nullptr;
-    }
-
-    DFTObject->transformLength = __Length;
-    DFTObject->transformDirection = __Direction;
-    DFTObject->transformType = ZOP;
-    return DFTObject;
-}
-
-
-//Creates a setup object to be used for complex-to-complex double-precision DFT/IDFT computation
-vDSP_DFT_SetupD vDSP_DFT_zop_CreateSetupD(vDSP_DFT_SetupD __Previous, vDSP_Length __Length, vDSP_DFT_Direction __Direction) {
-    vDSP_DFT_SetupD DFTDObject;
-    if (!__Previous) {
-        DFTDObject = new vDSP_DFT_SetupStructD;
-    } else {
-        DFTDObject = __Previous;
-    }
-
-    if (!DFTDObject || __Length <= 0 || (__Direction != vDSP_DFT_FORWARD && __Direction != vDSP_DFT_INVERSE)) {
-        return nullptr;
-    }
-
-    //Check for length requirements - Power of Two (or) Power of Two multiplied by 3, 5, or 15
-    if (!isValidDFTLength(__Length, 8)) {
-        return nullptr;
-    }
-
-    DFTDObject->transformLength = __Length;
-    DFTDObject->transformDirection = __Direction;
-    DFTDObject->transformType = ZOP;
-    return DFTDObject;
-}
-
-
-//Creates a setup object to be used for real-to-complex (complex-to-real) single-precision DFT (IDFT) computation
-vDSP_DFT_Setup vDSP_DFT_zrop_CreateSetup(vDSP_DFT_Setup __Previous, vDSP_Length __Length, vDSP_DFT_Direction __Direction) {
-    vDSP_DFT_Setup DFTObject;
-    if (!__Previous) {
-        DFTObject = new vDSP_DFT_SetupStruct;
-    } else {
-        DFTObject = __Previous;
-    }
-
-    if (!DFTObject || __Length <= 0 || (__Direction != vDSP_DFT_FORWARD && __Direction != vDSP_DFT_INVERSE)) {
-        return nullptr;
-    }
-
-    //Check for length requirements - Power of Two (or) Power of Two multiplied by 3, 5, or 15
-    if (!isValidDFTLength(__Length, 16)) {
-        return nullptr;
-    }
-
-    DFTObject->transformLength = __Length;
-    DFTObject->transformDirection = __Direction;
-    DFTObject->transformType = ZROP;
-    return DFTObject;
-}
-
-
-//Creates a setup object to be used for real-to-complex (complex-to-real) double-precision DFT (IDFT) computation
-vDSP_DFT_SetupD vDSP_DFT_zrop_CreateSetupD(vDSP_DFT_SetupD __Previous, vDSP_Length __Length, vDSP_DFT_Direction __Direction) {
-    vDSP_DFT_SetupD DFTDObject;
-    if (!__Previous) {
-        DFTDObject = new vDSP_DFT_SetupStructD;
-    } else {
-        DFTDObject = __Previous;
-    }
-
-    if (!DFTDObject || __Length <= 0 || (__Direction != vDSP_DFT_FORWARD && __Direction != vDSP_DFT_INVERSE)) {
-        return nullptr;
-    }
-
-    //Check for length requirements - Power of Two (or) Power of Two multiplied by 3, 5, or 15
-    if (!isValidDFTLength(__Length, 16)) {
-        return nullptr;
-    }
-
-    DFTDObject->transformLength = __Length;
-    DFTDObject->transformDirection = __Direction;
-    DFTDObject->transformType = ZROP;
-    return DFTDObject;
-}
-
-
-//Computes the single-precision DFT for a vector
-void vDSP_DFT_Execute(const struct vDSP_DFT_SetupStruct *__Setup, const float *__Ir, const float *__Ii, float *__Or, float *__Oi) {
-    if (!__Setup) {
-        return;
-    }
-
-    int length = __Setup->transformLength;
-    int direction = __Setup->transformDirection;
-    float scale;
-    float kscale;
-    float real;
-    float imaginary;
-
-    if (__Setup->transformType == ZOP) {
-        scale = 2 * static_cast<float>(M_PI) * direction / length;
-        for (int k = 0; k < length; k++) {
-            real = 0;
-            imaginary = 0;
-            kscale = k * scale;
-            for (int n = 0; n < length; n++) {
-                real += (__Ir[n] * cos(n * kscale)) + (__Ii[n] * sin(n * kscale));
-                imaginary += (__Ii[n] * cos(n * kscale)) - (__Ir[n] * sin(n * kscale));
-            }
-
-            __Or[k] = real;
-            __Oi[k] = imaginary;
-        }
-    } else if (__Setup->transformType == ZROP) {
-        if (direction == vDSP_DFT_FORWARD) {
-            float* realInput = new float[length];
-            for (int i = 0; i < length / 2; i++) {
-                realInput[2 * i + 0] = __Ir[i];
-                realInput[2 * i + 1] = __Ii[i];
-            }
-
-            scale = 2 * static_cast<float>(M_PI) / length;
-            for (int k = 0; k < length / 2; k++) {
-                real = 0;
-                imaginary = 0;
-                kscale = k * scale;
-                for (int n = 0; n < length; n++) {
-                    real += realInput[n] * cos(n * kscale);
-
-                    //Block added to match Apple's special case for the first imaginary output
-                    if (k == 0) {
-                        imaginary += realInput[n] * cos(static_cast<float>(M_PI) * n);
-                    } else {
-                        imaginary -= realInput[n] * sin(n * kscale);
-                    }
-                }
-
-                __Or[k] = real * 2;
-                __Oi[k] = imaginary * 2;
-            }
-
-            delete realInput;
-        } else if (direction == vDSP_DFT_INVERSE) {
-            float* realOutput = new float[length];
-            scale = 2 * static_cast<float>(M_PI) / length;
-            for (int k = 0; k < length; k++) {
-                real = 0;
-                kscale = k * scale;
-                for (int n = 0; n < length; n++) {
-                    real += (__Ir[n] * cos(n * kscale)) - (__Ii[n] * sin(n * kscale));
-                }
-
-                realOutput[k] = real;
-            }
-
-            for (int i = 0; i < length / 2; i++) {
-                __Or[i] = realOutput[2 * i + 0];
-                __Oi[i] = realOutput[2 * i + 1];
-
-                //Block added to match iOS behavior
-                __Or[i] -= __Ir[length / 2];
-                __Oi[i] += __Ir[length / 2];
-            }
-
-            delete realOutput;
-        }
-    }
-}
-
-
-//Computes the double-precision DFT for a vector
-void vDSP_DFT_ExecuteD(const struct vDSP_DFT_SetupStructD *__Setup, const double *__Ir, const double *__Ii, double *__Or, double *__Oi) {
-    if (!__Setup) {
-        return;
-    }
-
-    int length = __Setup->transformLength;
-    int direction = __Setup->transformDirection;
-    double scale;
-    double kscale;
-    double real;
-    double imaginary;
-
-    if (__Setup->transformType == ZOP) {
-        scale = 2 * M_PI * direction / length;
-        for (int k = 0; k < length; k++) {
-            real = 0;
-            imaginary = 0;
-            kscale = k * scale;
-            for (int n = 0; n < length; n++) {
-                real += (__Ir[n] * cos(n * kscale)) + (__Ii[n] * sin(n * kscale));
-                imaginary += (__Ii[n] * cos(n * kscale)) - (__Ir[n] * sin(n * kscale));
-            }
-
-            __Or[k] = real;
-            __Oi[k] = imaginary;
-        }
-    } else if (__Setup->transformType == ZROP) {
-        if (direction == vDSP_DFT_FORWARD) {
-            double* realInput = new double[length];
-            for (int i = 0; i < length / 2; i++) {
-                realInput[2 * i + 0] = __Ir[i];
-                realInput[2 * i + 1] = __Ii[i];
-            }
-
-            scale = 2 * M_PI / length;
-            for (int k = 0; k < length / 2; k++) {
-                real = 0;
-                imaginary = 0;
-                kscale = k * scale;
-                for (int n = 0; n < length; n++) {
-                    real += realInput[n] * cos(n * kscale);
-
-                    //Block added to match Apple's special case for the first imaginary output
-                    if (k == 0) {
-                        imaginary += realInput[n] * cos(M_PI * n);
-                    } else {
-                        imaginary -= realInput[n] * sin(n * kscale);
-                    }
-                }
-
-                __Or[k] = real * 2;
-                __Oi[k] = imaginary * 2;
-            }
-
-            delete realInput;
-        } else if (direction == vDSP_DFT_INVERSE) {
-            double* realOutput = new double[length];
-            scale = 2 * M_PI / length;
-            for (int k = 0; k < length; k++) {
-                real = 0;
-                kscale = k * scale;
-                for (int n = 0; n < length; n++) {
-                    real += (__Ir[n] * cos(n * kscale)) - (__Ii[n] * sin(n * kscale));
-                }
-
-                realOutput[k] = real;
-            }
-
-            for (int i = 0; i < length / 2; i++) {
-                __Or[i] = realOutput[2 * i + 0];
-                __Oi[i] = realOutput[2 * i + 1];
-
-                //Block added to match iOS behavior
-                __Or[i] -= __Ir[length / 2];
-                __Oi[i] += __Ir[length / 2];
-            }
-
-            delete realOutput;
-        }
-    }
-}
-
-
-//Releases a single-precision setup object
-void vDSP_DFT_DestroySetup(vDSP_DFT_Setup __Setup) {
-    if (__Setup) {
-        delete __Setup;
-    }
-
-    return;
-}
-
-
-//Releases a double-precision setup object
-void vDSP_DFT_DestroySetupD(vDSP_DFT_SetupD __Setup) {
-    if (__Setup) {
-        delete __Setup;
-    }
-
-    return;
-}
\ No newline at end of file
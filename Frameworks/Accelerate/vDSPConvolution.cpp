@@ -0,0 +1,387 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+#include "Accelerate\vDSP.h"
+#include "vDSPInternal.h"
+#include "AccelerateParallel.h"
+
+// vDSP_conv and vDSP_desamp are both the correlation
+//
+//     C[n] = sum over p < P of A[n * DF + p] * F[p]
+//
+// with DF = 1 for vDSP_conv, which convolves instead when F is walked backwards. Short filters run on the vector kernels,
+// a few registers of outputs at a time. Long ones run overlap-save: each block of M - P + 1 consecutive values of the
+// correlation is the start of the circular correlation of the M inputs from there with the filter, which takes a real
+// FFT of the inputs, a product with the filter's conjugated spectrum and an inverse FFT. Which is used depends on what
+// each would cost, N * P multiply-adds against the FFTs of the blocks; see c_fftCost.
+//
+// Either way the outputs are independent of each other, so large filters are split across threads by outputs or by
+// blocks, with nothing to combine afterwards.
+
+namespace {
+
+// The time of the forward and inverse real FFTs of an overlap-save block of M points, per point and per log2 M, and
+// the time spent on each block besides, in multiply-adds of the direct filter. Fitted by timing both methods over 2^20
+// points, for filters of 4 to 8192 taps, so that the FFT takes over where it starts being faster.
+const double c_fftCost = 11;
+const double c_blockCost = 4096;
+
+// Work, in multiply-adds, to give each thread at least.
+const size_t c_parallelWork = 1 << 20;
+
+// The largest overlap-save block, in points.
+const vDSP_Length c_maximumLog2M = 20;
+
+const vDSPKernelSet<float>& kernelsFor(const vDSPKernels& kernels, float) {
+    return kernels.f;
+}
+
+const vDSPKernelSet<double>& kernelsFor(const vDSPKernels& kernels, double) {
+    return kernels.d;
+}
+
+template <typename T>
+struct RealFFT;
+
+template <>
+struct RealFFT<float> {
+    typedef std::remove_pointer<FFTSetup>::type Setup;
+    typedef DSPSplitComplex Split;
+
+    static Setup* create(vDSP_Length log2n) {
+        return vDSP_create_fftsetup(log2n, kFFTRadix2);
+    }
+
+    static void destroy(Setup* setup) {
+        vDSP_destroy_fftsetup(setup);
+    }
+
+    static void transform(Setup* setup, float* re, float* im, vDSP_Length log2n, FFTDirection direction) {
+        Split split = { re, im };
+        vDSP_fft_zrip(setup, &split, 1, log2n, direction);
+    }
+};
+
+template <>
+struct RealFFT<double> {
+    typedef std::remove_pointer<FFTSetupD>::type Setup;
+    typedef DSPDoubleSplitComplex Split;
+
+    static Setup* create(vDSP_Length log2n) {
+        return vDSP_create_fftsetupD(log2n, kFFTRadix2);
+    }
+
+    static void destroy(Setup* setup) {
+        vDSP_destroy_fftsetupD(setup);
+    }
+
+    static void transform(Setup* setup, double* re, double* im, vDSP_Length log2n, FFTDirection direction) {
+        Split split = { re, im };
+        vDSP_fft_zripD(setup, &split, 1, log2n, direction);
+    }
+};
+
+// A setup for FFTs of 2^log2n points or fewer, shared by all filters. It is replaced by a larger one when needed; the
+// old one goes once the filters using it are done. Null if it cannot be created.
+template <typename T>
+std::shared_ptr<typename RealFFT<T>::Setup> sharedSetup(vDSP_Length log2n) {
+    static std::mutex lock;
+    static std::shared_ptr<typename RealFFT<T>::Setup> setup;
+    static vDSP_Length setupLog2n = 0;
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (!setup || setupLog2n < log2n) {
+        typename RealFFT<T>::Setup* created = RealFFT<T>::create(log2n);
+        if (!created) {
+            return nullptr;
+        }
+        setup.reset(created, RealFFT<T>::destroy);
+        setupLog2n = log2n;
+    }
+    return setup;
+}
+
+// The overlap-save blocks for span consecutive values of the correlation with P taps: the FFT length, at least 2 P,
+// with the least total cost in multiply-adds.
+struct OverlapSave {
+    vDSP_Length log2M;
+    vDSP_Length blocks;
+    double cost;
+};
+
+OverlapSave planOverlapSave(vDSP_Length span, vDSP_Length P) {
+    OverlapSave best = { 0, 0, std::numeric_limits<double>::infinity() };
+    vDSP_Length log2M = 1;
+    while (log2M <= c_maximumLog2M && (static_cast<vDSP_Length>(1) << log2M) < 2 * P) {
+        ++log2M;
+    }
+
+    for (; log2M <= c_maximumLog2M; ++log2M) {
+        const vDSP_Length M = static_cast<vDSP_Length>(1) << log2M;
+        const vDSP_Length L = M - P + 1;
+        const vDSP_Length blocks = (span + L - 1) / L;
+        const double cost = blocks * (c_fftCost * M * log2M + c_blockCost);
+        if (cost < best.cost) {
+            best = { log2M, blocks, cost };
+        }
+        if (L >= span) {
+            break;
+        }
+    }
+    return best;
+}
+
+// C[n * IC] = the sum over p < P of A[(n * DF + p) * IA] * F[p * IF], for n < N.
+template <typename T>
+void correlateDirect(
+    const T* A, vDSP_Stride IA, vDSP_Stride DF, const T* F, vDSP_Stride IF, T* C, vDSP_Stride IC, vDSP_Length N, vDSP_Length P) {
+    const vDSPKernelSet<T>& kernels = kernelsFor(vDSPGetKernels(), T());
+    vDSP_Length n = 0;
+    if (DF == 1 && IA == 1 && IC == 1) {
+        n = kernels.conv(A, F, IF, C, N, P);
+    } else if (IA == 1 && IF == 1 && IC == 1) {
+        n = kernels.desamp(A, DF, F, C, N, P);
+    }
+
+    for (; n < N; ++n) {
+        T sum = 0;
+        for (vDSP_Length p = 0; p < P; ++p) {
+            sum += A[(n * DF + p) * IA] * F[p * IF];
+        }
+        C[n * IC] = sum;
+    }
+}
+
+template <typename T>
+void correlateDirectInParallel(
+    const T* A, vDSP_Stride IA, vDSP_Stride DF, const T* F, vDSP_Stride IF, T* C, vDSP_Stride IC, vDSP_Length N, vDSP_Length P) {
+    AccelerateParallelFor(N, std::max<size_t>(c_parallelWork / std::max<vDSP_Length>(P, 1), 1), [&](size_t begin, size_t end) {
+        correlateDirect(A + begin * DF * IA, IA, DF, F, IF, C + begin * IC, IC, end - begin, P);
+    });
+}
+
+// The same as correlateDirect, by overlap-save. False if the FFT setup could not be created.
+template <typename T>
+bool correlateFFT(const T* A,
+                  vDSP_Stride IA,
+                  vDSP_Stride DF,
+                  const T* F,
+                  vDSP_Stride IF,
+                  T* C,
+                  vDSP_Stride IC,
+                  vDSP_Length N,
+                  vDSP_Length P,
+                  const OverlapSave& plan) {
+    std::shared_ptr<typename RealFFT<T>::Setup> setup = sharedSetup<T>(plan.log2M);
+    if (!setup) {
+        return false;
+    }
+
+    const vDSP_Length M = static_cast<vDSP_Length>(1) << plan.log2M;
+    const vDSP_Length half = M / 2;
+    const vDSP_Length L = M - P + 1;
+    const vDSP_Length span = (N - 1) * DF + 1;
+
+    // The filter's spectrum, scaled by 1 / (4 M) for the factor of 2 from each forward transform and M from the inverse.
+    std::vector<T> filterR(half, 0);
+    std::vector<T> filterI(half, 0);
+    for (vDSP_Length p = 0; p < P; ++p) {
+        ((p % 2 == 0) ? filterR : filterI)[p / 2] = F[p * IF];
+    }
+    RealFFT<T>::transform(setup.get(), filterR.data(), filterI.data(), plan.log2M, kFFTDirection_Forward);
+    const T scale = static_cast<T>(1) / (4 * M);
+    for (vDSP_Length k = 0; k < half; ++k) {
+        filterR[k] *= scale;
+        filterI[k] *= scale;
+    }
+
+    const size_t blockWork = static_cast<size_t>(c_fftCost * M * plan.log2M + c_blockCost);
+    AccelerateParallelFor(plan.blocks, std::max<size_t>(c_parallelWork / blockWork, 1), [&](size_t begin, size_t end) {
+        std::vector<T> re(half);
+        std::vector<T> im(half);
+        for (vDSP_Length block = begin; block < end; ++block) {
+            const vDSP_Length start = block * L;
+            const vDSP_Length count = std::min(M, span + P - 1 - start);
+            for (vDSP_Length i = 0; i < M; ++i) {
+                ((i % 2 == 0) ? re : im)[i / 2] = (i < count) ? A[(start + i) * IA] : 0;
+            }
+
+            // The first element holds the purely real DC and Nyquist terms; the rest are multiplied by the conjugate.
+            RealFFT<T>::transform(setup.get(), re.data(), im.data(), plan.log2M, kFFTDirection_Forward);
+            re[0] *= filterR[0];
+            im[0] *= filterI[0];
+            for (vDSP_Length k = 1; k < half; ++k) {
+                const T xr = re[k];
+                const T xi = im[k];
+                re[k] = xr * filterR[k] + xi * filterI[k];
+                im[k] = xi * filterR[k] - xr * filterI[k];
+            }
+            RealFFT<T>::transform(setup.get(), re.data(), im.data(), plan.log2M, kFFTDirection_Inverse);
+
+            const vDSP_Length stop = std::min(start + L, span);
+            for (vDSP_Length n = (start + DF - 1) / DF; n * DF < stop; ++n) {
+                const vDSP_Length i = n * DF - start;
+                C[n * IC] = ((i % 2 == 0) ? re : im)[i / 2];
+            }
+        }
+    });
+    return true;
+}
+
+template <typename T>
+void correlate(const T* A,
+               vDSP_Stride IA,
+               vDSP_Stride DF,
+               const T* F,
+               vDSP_Stride IF,
+               T* C,
+               vDSP_Stride IC,
+               vDSP_Length N,
+               vDSP_Length P,
+               vDSPFilterMethod method) {
+    if (N == 0) {
+        return;
+    }
+
+    if (method != vDSPFilterDirect && P > 1) {
+        const OverlapSave plan = planOverlapSave((N - 1) * DF + 1, P);
+        const bool cheaper = plan.cost < static_cast<double>(N) * P;
+        if (plan.blocks != 0 && (method == vDSPFilterFFT || cheaper) && correlateFFT(A, IA, DF, F, IF, C, IC, N, P, plan)) {
+            return;
+        }
+    }
+    correlateDirectInParallel(A, IA, DF, F, IF, C, IC, N, P);
+}
+
+// The K x K filter of an NR x NC image, whose edges, where the filter would reach past the image, are set to zero.
+template <typename T>
+void filterImage(const T* A, vDSP_Length NR, vDSP_Length NC, const T* F, vDSP_Length K, T* C) {
+    const vDSP_Length edge = K / 2;
+    if (NR < K || NC < K) {
+        std::fill(C, C + NR * NC, static_cast<T>(0));
+        return;
+    }
+
+    std::fill(C, C + edge * NC, static_cast<T>(0));
+    std::fill(C + (NR - edge) * NC, C + NR * NC, static_cast<T>(0));
+
+    const vDSPKernelSet<T>& kernels = kernelsFor(vDSPGetKernels(), T());
+    const vDSP_Length width = NC - K + 1;
+    AccelerateParallelFor(NR - K + 1, std::max<size_t>(c_parallelWork / (width * K * K), 1), [&](size_t begin, size_t end) {
+        for (vDSP_Length row = begin; row < end; ++row) {
+            const T* window = A + row * NC;
+            T* out = C + (row + edge) * NC;
+            std::fill(out, out + edge, static_cast<T>(0));
+            std::fill(out + edge + width, out + NC, static_cast<T>(0));
+
+            for (vDSP_Length n = kernels.imgfir(window, NC, F, K, K, out + edge, width); n < width; ++n) {
+                T sum = 0;
+                for (vDSP_Length i = 0; i < K; ++i) {
+                    for (vDSP_Length j = 0; j < K; ++j) {
+                        sum += window[i * NC + n + j] * F[i * K + j];
+                    }
+                }
+                out[edge + n] = sum;
+            }
+        }
+    });
+}
+
+} // namespace
+
+void vDSPFilter(const float* A,
+                vDSP_Stride IA,
+                vDSP_Stride DF,
+                const float* F,
+                vDSP_Stride IF,
+                float* C,
+                vDSP_Stride IC,
+                vDSP_Length N,
+                vDSP_Length P,
+                vDSPFilterMethod method) {
+    correlate(A, IA, DF, F, IF, C, IC, N, P, method);
+}
+
+void vDSPFilter(const double* A,
+                vDSP_Stride IA,
+                vDSP_Stride DF,
+                const double* F,
+                vDSP_Stride IF,
+                double* C,
+                vDSP_Stride IC,
+                vDSP_Length N,
+                vDSP_Length P,
+                vDSPFilterMethod method) {
+    correlate(A, IA, DF, F, IF, C, IC, N, P, method);
+}
+
+
+//Computes N outputs of the single-precision correlation of A with the P taps of F, or the convolution for a negative IF,
+//F then pointing at the last tap
+void vDSP_conv(const float *__A, vDSP_Stride __IA, const float *__F, vDSP_Stride __IF, float *__C, vDSP_Stride __IC, vDSP_Length __N,
+               vDSP_Length __P) {
+    correlate(__A, __IA, 1, __F, __IF, __C, __IC, __N, __P, vDSPFilterAutomatic);
+}
+
+
+//Computes N outputs of the double-precision correlation of A with the P taps of F, or the convolution for a negative IF,
+//F then pointing at the last tap
+void vDSP_convD(const double *__A, vDSP_Stride __IA, const double *__F, vDSP_Stride __IF, double *__C, vDSP_Stride __IC,
+                vDSP_Length __N, vDSP_Length __P) {
+    correlate(__A, __IA, 1, __F, __IF, __C, __IC, __N, __P, vDSPFilterAutomatic);
+}
+
+
+//Filters single-precision A with the P taps of F and keeps every DF-th output: C[n] = sum of A[n * DF + p] * F[p]
+void vDSP_desamp(const float *__A, vDSP_Stride __DF, const float *__F, float *__C, vDSP_Length __N, vDSP_Length __P) {
+    correlate(__A, 1, __DF, __F, 1, __C, 1, __N, __P, vDSPFilterAutomatic);
+}
+
+
+//Filters double-precision A with the P taps of F and keeps every DF-th output: C[n] = sum of A[n * DF + p] * F[p]
+void vDSP_desampD(const double *__A, vDSP_Stride __DF, const double *__F, double *__C, vDSP_Length __N, vDSP_Length __P) {
+    correlate(__A, 1, __DF, __F, 1, __C, 1, __N, __P, vDSPFilterAutomatic);
+}
+
+
+//Filters a single-precision NR x NC image with a 3 x 3 kernel, setting the outermost rows and columns to zero
+void vDSP_f3x3(const float *__A, vDSP_Length __NR, vDSP_Length __NC, const float *__F, float *__C) {
+    filterImage(__A, __NR, __NC, __F, 3, __C);
+}
+
+
+//Filters a double-precision NR x NC image with a 3 x 3 kernel, setting the outermost rows and columns to zero
+void vDSP_f3x3D(const double *__A, vDSP_Length __NR, vDSP_Length __NC, const double *__F, double *__C) {
+    filterImage(__A, __NR, __NC, __F, 3, __C);
+}
+
+
+//Filters a single-precision NR x NC image with a 5 x 5 kernel, setting the two outermost rows and columns to zero
+void vDSP_f5x5(const float *__A, vDSP_Length __NR, vDSP_Length __NC, const float *__F, float *__C) {
+    filterImage(__A, __NR, __NC, __F, 5, __C);
+}
+
+
+//Filters a double-precision NR x NC image with a 5 x 5 kernel, setting the two outermost rows and columns to zero
+void vDSP_f5x5D(const double *__A, vDSP_Length __NR, vDSP_Length __NC, const double *__F, double *__C) {
+    filterImage(__A, __NR, __NC, __F, 5, __C);
+}
@@ -0,0 +1,531 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#define _USE_MATH_DEFINES // for C++
+#include <cmath>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "Accelerate\vDSP.h"
+#include "vDSPInternal.h"
+
+// The FFT and DFT functions all run on one complex FFT of split-complex data, a Stockham FFT: each pass reads one
+// buffer and writes the other, and the result comes out in order, with no bit reversal. A pass for length n and radix
+// r splits the transform into r of length m = n / r,
+//
+//     y[q + s * (r * p + k)] = w_n^(p * k) * DFT_r(x[q + s * (p + j * m)], j < r)[k]     p < m, q < s, k < r
+//
+// with w_n = e^(-2 pi i / n). The stride s starts at 1 and is multiplied by r with each pass, so after the first pass
+// every butterfly works on runs of s contiguous elements, which the vector kernels take a register at a time.
+//
+// Lengths are 2^a, taken in radix 8 passes with radix 4 or 2 for the rest, times 3, 5 or 15 for the DFT setups, which
+// add radix 3 and 5 passes. Inverse transforms are forward ones with the real and imaginary parts swapped on the way
+// in and out, and real transforms of length 2n are complex ones of length n on the even and odd samples, untangled
+// afterwards.
+//
+// Setups are not changed once created and every transform allocates its own work buffer, so any number of threads
+// can use a setup at the same time.
+
+namespace {
+
+// One pass, with its twiddle factors w_n^(p * k) at (k - 1) * m + p, for k from 1.
+template <typename T>
+struct PlanPass {
+    unsigned radix;
+    vDSP_Length m;
+    std::vector<T> wr;
+    std::vector<T> wi;
+};
+
+// The passes of a complex FFT of some length, and w_2n^k for k <= length / 2, which untangle the real FFT of twice
+// the length.
+template <typename T>
+struct FFTPlan {
+    vDSP_Length length;
+    std::vector<PlanPass<T>> passes;
+    std::vector<T> realWr;
+    std::vector<T> realWi;
+};
+
+// Radix 8 for as long as it goes, then 4 (twice rather than 8 and 2) or 2; the odd factors last.
+unsigned radixFor(vDSP_Length n) {
+    const vDSP_Length powerOfTwo = n & (~n + 1);
+    if (powerOfTwo == 8 || powerOfTwo >= 32) {
+        return 8;
+    } else if (powerOfTwo == 4 || powerOfTwo == 16) {
+        return 4;
+    } else if (powerOfTwo == 2) {
+        return 2;
+    }
+    return (n % 3 == 0) ? 3 : 5;
+}
+
+template <typename T>
+std::shared_ptr<const FFTPlan<T>> makePlan(vDSP_Length length) {
+    std::shared_ptr<FFTPlan<T>> plan = std::make_shared<FFTPlan<T>>();
+    plan->length = length;
+
+    for (vDSP_Length n = length; n > 1; n /= plan->passes.back().radix) {
+        PlanPass<T> pass;
+        pass.radix = radixFor(n);
+        pass.m = n / pass.radix;
+        pass.wr.resize((pass.radix - 1) * pass.m);
+        pass.wi.resize((pass.radix - 1) * pass.m);
+        for (unsigned k = 1; k < pass.radix; ++k) {
+            for (vDSP_Length p = 0; p < pass.m; ++p) {
+                const double angle = 2 * M_PI * static_cast<double>(p * k) / n;
+                pass.wr[(k - 1) * pass.m + p] = static_cast<T>(cos(angle));
+                pass.wi[(k - 1) * pass.m + p] = static_cast<T>(-sin(angle));
+            }
+        }
+        plan->passes.push_back(std::move(pass));
+    }
+
+    plan->realWr.resize(length / 2 + 1);
+    plan->realWi.resize(length / 2 + 1);
+    for (vDSP_Length k = 0; k <= length / 2; ++k) {
+        const double angle = M_PI * static_cast<double>(k) / length;
+        plan->realWr[k] = static_cast<T>(cos(angle));
+        plan->realWi[k] = static_cast<T>(-sin(angle));
+    }
+    return plan;
+}
+
+const vDSPKernelSet<float>& kernelsFor(const vDSPKernels& kernels, float) {
+    return kernels.f;
+}
+
+const vDSPKernelSet<double>& kernelsFor(const vDSPKernels& kernels, double) {
+    return kernels.d;
+}
+
+template <typename T>
+typename vDSPKernelSet<T>::FFTPass passFor(const vDSPKernelSet<T>& kernels, unsigned radix) {
+    switch (radix) {
+        case 2:
+            return kernels.fft2;
+        case 3:
+            return kernels.fft3;
+        case 4:
+            return kernels.fft4;
+        case 5:
+            return kernels.fft5;
+        default:
+            return kernels.fft8;
+    }
+}
+
+// The forward transform of x into y, which may be x. work has room for the length in each part.
+template <typename T>
+void fft(const FFTPlan<T>& plan, const T* xr, const T* xi, T* yr, T* yi, T* workR, T* workI) {
+    const vDSPKernelSet<T>& kernels = kernelsFor(vDSPGetKernels(), T());
+    const vDSPKernelSet<T>& loops = kernelsFor(*vDSPGetAvailableKernels().back(), T());
+    const size_t count = plan.passes.size();
+
+    // The passes alternate between y and work, ending in y; so with an odd number, the first one reads from x and
+    // writes to y, and x has to be moved out of the way if it is y.
+    if (count % 2 == 1 && (xr == yr || xi == yi)) {
+        std::copy(xr, xr + plan.length, workR);
+        std::copy(xi, xi + plan.length, workI);
+        xr = workR;
+        xi = workI;
+    } else if (count == 0 && xr != yr) {
+        std::copy(xr, xr + plan.length, yr);
+        std::copy(xi, xi + plan.length, yi);
+    }
+
+    vDSP_Length s = 1;
+    for (size_t i = 0; i < count; ++i) {
+        const PlanPass<T>& pass = plan.passes[i];
+        T* outR = ((count - i) % 2 == 1) ? yr : workR;
+        T* outI = ((count - i) % 2 == 1) ? yi : workI;
+
+        vDSP_Length q = passFor(kernels, pass.radix)(xr, xi, outR, outI, pass.wr.data(), pass.wi.data(), s, pass.m, 0);
+        if (q < s) {
+            passFor(loops, pass.radix)(xr, xi, outR, outI, pass.wr.data(), pass.wi.data(), s, pass.m, q);
+        }
+
+        xr = outR;
+        xi = outI;
+        s *= pass.radix;
+    }
+}
+
+// Turns the complex FFT Z of the even and odd samples of a real signal into twice the first half of its FFT X, in
+// place, with X[n] in the imaginary part of X[0]:
+//     2 X[k] = Z[k] + conj(Z[n - k]) - i w_2n^k (Z[k] - conj(Z[n - k]))
+template <typename T>
+void untangle(const FFTPlan<T>& plan, T* re, T* im) {
+    const vDSP_Length n = plan.length;
+    const T r0 = re[0];
+    const T i0 = im[0];
+    re[0] = 2 * (r0 + i0);
+    im[0] = 2 * (r0 - i0);
+
+    const vDSPKernelSet<T>& kernels = kernelsFor(vDSPGetKernels(), T());
+    for (vDSP_Length k = kernels.fftUntangle(re, im, plan.realWr.data(), plan.realWi.data(), n); k <= n / 2; ++k) {
+        const vDSP_Length j = n - k;
+        const T sumR = re[k] + re[j];
+        const T sumI = im[k] - im[j];
+        const T diffR = re[k] - re[j];
+        const T diffI = im[k] + im[j];
+        const T turnedR = plan.realWr[k] * diffR - plan.realWi[k] * diffI;
+        const T turnedI = plan.realWr[k] * diffI + plan.realWi[k] * diffR;
+        re[k] = sumR + turnedI;
+        im[k] = sumI - turnedR;
+        re[j] = sumR - turnedI;
+        im[j] = -sumI - turnedR;
+    }
+}
+
+// The other way: from the first half of X, with X[n] in the imaginary part of X[0], to the Z whose inverse FFT has
+// the even samples of the inverse of X in its real part and the odd ones in its imaginary part:
+//     Z[k] = X[k] + conj(X[n - k]) + i conj(w_2n^k) (X[k] - conj(X[n - k]))
+// x may be z.
+template <typename T>
+void tangle(const FFTPlan<T>& plan, const T* xr, const T* xi, T* zr, T* zi) {
+    const vDSP_Length n = plan.length;
+    const T r0 = xr[0];
+    const T i0 = xi[0];
+    zr[0] = r0 + i0;
+    zi[0] = r0 - i0;
+
+    const vDSPKernelSet<T>& kernels = kernelsFor(vDSPGetKernels(), T());
+    for (vDSP_Length k = kernels.fftTangle(xr, xi, zr, zi, plan.realWr.data(), plan.realWi.data(), n); k <= n / 2; ++k) {
+        const vDSP_Length j = n - k;
+        const T sumR = xr[k] + xr[j];
+        const T sumI = xi[k] - xi[j];
+        const T diffR = xr[k] - xr[j];
+        const T diffI = xi[k] + xi[j];
+        const T turnedR = plan.realWr[k] * diffR + plan.realWi[k] * diffI;
+        const T turnedI = plan.realWr[k] * diffI - plan.realWi[k] * diffR;
+        zr[k] = sumR - turnedI;
+        zi[k] = sumI + turnedR;
+        zr[j] = sumR + turnedI;
+        zi[j] = -sumI + turnedR;
+    }
+}
+
+template <typename T>
+void copyStrided(const T* A, vDSP_Stride IA, T* C, vDSP_Stride IC, vDSP_Length N) {
+    for (vDSP_Length i = 0; i < N; ++i) {
+        C[i * IC] = A[i * IA];
+    }
+}
+
+// The complex transforms, on plans of their own length.
+template <typename T, typename Split>
+void fftComplex(const FFTPlan<T>& plan, const Split* A, vDSP_Stride IA, const Split* C, vDSP_Stride IC, FFTDirection direction) {
+    const vDSP_Length n = plan.length;
+    const bool strided = (IA != 1 || IC != 1);
+    std::unique_ptr<T[]> buffer(new T[strided ? 4 * n : 2 * n]);
+
+    const T* xr = A->realp;
+    const T* xi = A->imagp;
+    T* yr = C->realp;
+    T* yi = C->imagp;
+    if (strided) {
+        yr = buffer.get() + 2 * n;
+        yi = yr + n;
+        copyStrided(A->realp, IA, yr, 1, n);
+        copyStrided(A->imagp, IA, yi, 1, n);
+        xr = yr;
+        xi = yi;
+    }
+
+    if (direction == kFFTDirection_Forward) {
+        fft(plan, xr, xi, yr, yi, buffer.get(), buffer.get() + n);
+    } else {
+        fft(plan, xi, xr, yi, yr, buffer.get(), buffer.get() + n);
+    }
+
+    if (strided) {
+        copyStrided(yr, 1, C->realp, IC, n);
+        copyStrided(yi, 1, C->imagp, IC, n);
+    }
+}
+
+// The real transforms in place, on plans of half their length.
+template <typename T, typename Split>
+void fftReal(const FFTPlan<T>& plan, const Split* C, vDSP_Stride IC, FFTDirection direction) {
+    const vDSP_Length n = plan.length;
+    std::unique_ptr<T[]> buffer(new T[(IC != 1) ? 4 * n : 2 * n]);
+
+    T* re = C->realp;
+    T* im = C->imagp;
+    if (IC != 1) {
+        re = buffer.get() + 2 * n;
+        im = re + n;
+        copyStrided(C->realp, IC, re, 1, n);
+        copyStrided(C->imagp, IC, im, 1, n);
+    }
+
+    if (direction == kFFTDirection_Forward) {
+        fft(plan, re, im, re, im, buffer.get(), buffer.get() + n);
+        untangle(plan, re, im);
+    } else {
+        tangle(plan, re, im, re, im);
+        fft(plan, im, re, im, re, buffer.get(), buffer.get() + n);
+    }
+
+    if (IC != 1) {
+        copyStrided(re, 1, C->realp, IC, n);
+        copyStrided(im, 1, C->imagp, IC, n);
+    }
+}
+
+template <typename T>
+struct FFTSetupPlans {
+    // The plans for 2^0 to 2^Log2n points
+    std::vector<std::shared_ptr<const FFTPlan<T>>> plans;
+};
+
+template <typename T, typename Setup>
+Setup* createFFTSetup(vDSP_Length log2n, FFTRadix radix) {
+    if (log2n >= sizeof(vDSP_Length) * 8 - 1 || (radix != kFFTRadix2 && radix != kFFTRadix3 && radix != kFFTRadix5)) {
+        return nullptr;
+    }
+
+    Setup* setup = new Setup;
+    for (vDSP_Length log2 = 0; log2 <= log2n; ++log2) {
+        setup->plans.push_back(makePlan<T>(static_cast<vDSP_Length>(1) << log2));
+    }
+    return setup;
+}
+
+template <typename Setup, typename Split>
+void executeComplex(Setup* setup, const Split* A, vDSP_Stride IA, const Split* C, vDSP_Stride IC, vDSP_Length log2N, FFTDirection direction) {
+    if (setup && log2N < setup->plans.size() && (direction == kFFTDirection_Forward || direction == kFFTDirection_Inverse)) {
+        fftComplex(*setup->plans[log2N], A, IA, C, IC, direction);
+    }
+}
+
+template <typename Setup, typename Split>
+void executeReal(Setup* setup, const Split* C, vDSP_Stride IC, vDSP_Length log2N, FFTDirection direction) {
+    if (setup && log2N >= 1 && log2N <= setup->plans.size() &&
+        (direction == kFFTDirection_Forward || direction == kFFTDirection_Inverse)) {
+        fftReal(*setup->plans[log2N - 1], C, IC, direction);
+    }
+}
+
+template <typename T, typename Base>
+struct DFTSetup : Base {
+    std::shared_ptr<const FFTPlan<T>> plan;
+};
+
+static inline int isPowerOfTwo(vDSP_Length length) {
+    return !(length & (length - 1));
+}
+
+static inline int isValidDFTLength(vDSP_Length length, unsigned int minLength) {
+    return isPowerOfTwo(length) ||
+           ((length % 3 == 0) && isPowerOfTwo(length / 3) && (length >= 3 * minLength)) ||
+           ((length % 5 == 0) && isPowerOfTwo(length / 5) && (length >= 5 * minLength)) ||
+           ((length % 15 == 0) && isPowerOfTwo(length / 15) && (length >= 15 * minLength));
+}
+
+// A new setup, sharing the previous one's twiddle factors when it has the same complex length.
+template <typename T, typename Base>
+Base* createDFTSetup(Base* previous, vDSP_Length length, vDSP_DFT_Direction direction, vDSP_DFT_TransformType type) {
+    if (length == 0 || (direction != vDSP_DFT_FORWARD && direction != vDSP_DFT_INVERSE)) {
+        return nullptr;
+    }
+
+    //Check for length requirements - Power of Two (or) Power of Two multiplied by 3, 5, or 15
+    if (!isValidDFTLength(length, (type == ZOP) ? 8 : 16) || (type == ZROP && length < 2)) {
+        return nullptr;
+    }
+
+    const vDSP_Length complexLength = (type == ZOP) ? length : length / 2;
+    DFTSetup<T, Base>* setup = new DFTSetup<T, Base>;
+    setup->transformLength = length;
+    setup->transformDirection = direction;
+    setup->transformType = type;
+
+    const DFTSetup<T, Base>* shared = static_cast<const DFTSetup<T, Base>*>(previous);
+    if (shared && shared->plan->length == complexLength) {
+        setup->plan = shared->plan;
+    } else {
+        setup->plan = makePlan<T>(complexLength);
+    }
+    return setup;
+}
+
+template <typename T, typename Base>
+void executeDFT(const Base* base, const T* Ir, const T* Ii, T* Or, T* Oi) {
+    if (!base) {
+        return;
+    }
+
+    const FFTPlan<T>& plan = *static_cast<const DFTSetup<T, Base>*>(base)->plan;
+    std::unique_ptr<T[]> work(new T[2 * plan.length]);
+    if (base->transformType == ZOP) {
+        if (base->transformDirection == vDSP_DFT_FORWARD) {
+            fft(plan, Ir, Ii, Or, Oi, work.get(), work.get() + plan.length);
+        } else {
+            fft(plan, Ii, Ir, Oi, Or, work.get(), work.get() + plan.length);
+        }
+    } else if (base->transformType == ZROP) {
+        if (base->transformDirection == vDSP_DFT_FORWARD) {
+            fft(plan, Ir, Ii, Or, Oi, work.get(), work.get() + plan.length);
+            untangle(plan, Or, Oi);
+        } else {
+            tangle(plan, Ir, Ii, Or, Oi);
+            fft(plan, Oi, Or, Oi, Or, work.get(), work.get() + plan.length);
+        }
+    }
+}
+
+} // namespace
+
+struct OpaqueFFTSetup : FFTSetupPlans<float> {};
+struct OpaqueFFTSetupD : FFTSetupPlans<double> {};
+
+
+//Creates a setup object with the twiddle factors for single-precision FFTs of up to 2^Log2n points
+FFTSetup vDSP_create_fftsetup(vDSP_Length __Log2n, FFTRadix __Radix) {
+    return createFFTSetup<float, OpaqueFFTSetup>(__Log2n, __Radix);
+}
+
+
+//Creates a setup object with the twiddle factors for double-precision FFTs of up to 2^Log2n points
+FFTSetupD vDSP_create_fftsetupD(vDSP_Length __Log2n, FFTRadix __Radix) {
+    return createFFTSetup<double, OpaqueFFTSetupD>(__Log2n, __Radix);
+}
+
+
+//Releases a single-precision FFT setup object
+void vDSP_destroy_fftsetup(FFTSetup __setup) {
+    delete __setup;
+}
+
+
+//Releases a double-precision FFT setup object
+void vDSP_destroy_fftsetupD(FFTSetupD __setup) {
+    delete __setup;
+}
+
+
+//Computes the in-place single-precision complex FFT, or its inverse, unscaled, of 2^Log2N points
+void vDSP_fft_zip(FFTSetup __Setup, const DSPSplitComplex *__C, vDSP_Stride __IC, vDSP_Length __Log2N, FFTDirection __Direction) {
+    executeComplex(__Setup, __C, __IC, __C, __IC, __Log2N, __Direction);
+}
+
+
+//Computes the in-place double-precision complex FFT, or its inverse, unscaled, of 2^Log2N points
+void vDSP_fft_zipD(FFTSetupD __Setup, const DSPDoubleSplitComplex *__C, vDSP_Stride __IC, vDSP_Length __Log2N, FFTDirection __Direction) {
+    executeComplex(__Setup, __C, __IC, __C, __IC, __Log2N, __Direction);
+}
+
+
+//Computes the out-of-place single-precision complex FFT, or its inverse, unscaled, of 2^Log2N points
+void vDSP_fft_zop(FFTSetup __Setup, const DSPSplitComplex *__A, vDSP_Stride __IA, const DSPSplitComplex *__C, vDSP_Stride __IC,
+                  vDSP_Length __Log2N, FFTDirection __Direction) {
+    executeComplex(__Setup, __A, __IA, __C, __IC, __Log2N, __Direction);
+}
+
+
+//Computes the out-of-place double-precision complex FFT, or its inverse, unscaled, of 2^Log2N points
+void vDSP_fft_zopD(FFTSetupD __Setup, const DSPDoubleSplitComplex *__A, vDSP_Stride __IA, const DSPDoubleSplitComplex *__C,
+                   vDSP_Stride __IC, vDSP_Length __Log2N, FFTDirection __Direction) {
+    executeComplex(__Setup, __A, __IA, __C, __IC, __Log2N, __Direction);
+}
+
+
+//Computes the in-place single-precision real FFT of 2^Log2N points, held as even samples in realp and odd ones in
+//imagp. Forward, the result is twice the first half of the FFT, with the Nyquist term in imagp[0]; inverse, the unscaled
+//inverse of such a half spectrum
+void vDSP_fft_zrip(FFTSetup __Setup, const DSPSplitComplex *__C, vDSP_Stride __IC, vDSP_Length __Log2N, FFTDirection __Direction) {
+    executeReal(__Setup, __C, __IC, __Log2N, __Direction);
+}
+
+
+//Computes the in-place double-precision real FFT of 2^Log2N points, packed as for vDSP_fft_zrip
+void vDSP_fft_zripD(FFTSetupD __Setup, const DSPDoubleSplitComplex *__C, vDSP_Stride __IC, vDSP_Length __Log2N, FFTDirection __Direction) {
+    executeReal(__Setup, __C, __IC, __Log2N, __Direction);
+}
+
+
+//Computes the out-of-place single-precision real FFT of 2^Log2N points, packed as for vDSP_fft_zrip
+void vDSP_fft_zrop(FFTSetup __Setup, const DSPSplitComplex *__A, vDSP_Stride __IA, const DSPSplitComplex *__C, vDSP_Stride __IC,
+                   vDSP_Length __Log2N, FFTDirection __Direction) {
+    if (__Setup && __Log2N >= 1 && __Log2N <= __Setup->plans.size()) {
+        const vDSP_Length n = static_cast<vDSP_Length>(1) << (__Log2N - 1);
+        copyStrided(__A->realp, __IA, __C->realp, __IC, n);
+        copyStrided(__A->imagp, __IA, __C->imagp, __IC, n);
+        executeReal(__Setup, __C, __IC, __Log2N, __Direction);
+    }
+}
+
+
+//Computes the out-of-place double-precision real FFT of 2^Log2N points, packed as for vDSP_fft_zrip
+void vDSP_fft_zropD(FFTSetupD __Setup, const DSPDoubleSplitComplex *__A, vDSP_Stride __IA, const DSPDoubleSplitComplex *__C,
+                    vDSP_Stride __IC, vDSP_Length __Log2N, FFTDirection __Direction) {
+    if (__Setup && __Log2N >= 1 && __Log2N <= __Setup->plans.size()) {
+        const vDSP_Length n = static_cast<vDSP_Length>(1) << (__Log2N - 1);
+        copyStrided(__A->realp, __IA, __C->realp, __IC, n);
+        copyStrided(__A->imagp, __IA, __C->imagp, __IC, n);
+        executeReal(__Setup, __C, __IC, __Log2N, __Direction);
+    }
+}
+
+
+//Creates a setup object to be used for complex-to-complex single-precision DFT/IDFT computation
+vDSP_DFT_Setup vDSP_DFT_zop_CreateSetup(vDSP_DFT_Setup __Previous, vDSP_Length __Length, vDSP_DFT_Direction __Direction) {
+    return createDFTSetup<float>(__Previous, __Length, __Direction, ZOP);
+}
+
+
+//Creates a setup object to be used for complex-to-complex double-precision DFT/IDFT computation
+vDSP_DFT_SetupD vDSP_DFT_zop_CreateSetupD(vDSP_DFT_SetupD __Previous, vDSP_Length __Length, vDSP_DFT_Direction __Direction) {
+    return createDFTSetup<double>(__Previous, __Length, __Direction, ZOP);
+}
+
+
+//Creates a setup object to be used for real-to-complex (complex-to-real) single-precision DFT (IDFT) computation
+vDSP_DFT_Setup vDSP_DFT_zrop_CreateSetup(vDSP_DFT_Setup __Previous, vDSP_Length __Length, vDSP_DFT_Direction __Direction) {
+    return createDFTSetup<float>(__Previous, __Length, __Direction, ZROP);
+}
+
+
+//Creates a setup object to be used for real-to-complex (complex-to-real) double-precision DFT (IDFT) computation
+vDSP_DFT_SetupD vDSP_DFT_zrop_CreateSetupD(vDSP_DFT_SetupD __Previous, vDSP_Length __Length, vDSP_DFT_Direction __Direction) {
+    return createDFTSetup<double>(__Previous, __Length, __Direction, ZROP);
+}
+
+
+//Computes the single-precision DFT for a vector
+void vDSP_DFT_Execute(const struct vDSP_DFT_SetupStruct *__Setup, const float *__Ir, const float *__Ii, float *__Or, float *__Oi) {
+    executeDFT(__Setup, __Ir, __Ii, __Or, __Oi);
+}
+
+
+//Computes the double-precision DFT for a vector
+void vDSP_DFT_ExecuteD(const struct vDSP_DFT_SetupStructD *__Setup, const double *__Ir, const double *__Ii, double *__Or, double *__Oi) {
+    executeDFT(__Setup, __Ir, __Ii, __Or, __Oi);
+}
+
+
+//Releases a single-precision setup object
+void vDSP_DFT_DestroySetup(vDSP_DFT_Setup __Setup) {
+    delete static_cast<DFTSetup<float, vDSP_DFT_SetupStruct>*>(__Setup);
+}
+
+
+//Releases a double-precision setup object
+void vDSP_DFT_DestroySetupD(vDSP_DFT_SetupD __Setup) {
+    delete static_cast<DFTSetup<double, vDSP_DFT_SetupStructD>*>(__Setup);
+}
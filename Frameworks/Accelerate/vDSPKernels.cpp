@@ -0,0 +1,1177 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include <cstring>
+#include "vDSPInternal.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define VDSP_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VDSP_NEON 1
+#include <arm_neon.h>
+#if defined(_M_ARM64) || defined(__aarch64__)
+#define VDSP_NEON_DOUBLE 1
+#endif
+#endif
+
+// Plain loops: one element per "register", for processors without vector units and for the doubles on 32-bit ARM.
+namespace scalar {
+
+template <typename Type>
+struct Scalar {
+    typedef Type T;
+    typedef Type R;
+    typedef bool M;
+    static const vDSP_Length width = 1;
+
+    static R load(const T* p) {
+        return *p;
+    }
+    static bool canGather(vDSP_Stride stride) {
+        return true;
+    }
+    static R gather(const T* p, vDSP_Stride stride) {
+        return *p;
+    }
+    static void store(T* p, R a) {
+        *p = a;
+    }
+    static R set1(T a) {
+        return a;
+    }
+    static R add(R a, R b) {
+        return a + b;
+    }
+    static R sub(R a, R b) {
+        return a - b;
+    }
+    static R mul(R a, R b) {
+        return a * b;
+    }
+    static R abs(R a) {
+        return std::fabs(a);
+    }
+    static R nabs(R a) {
+        return -std::fabs(a);
+    }
+    static R neg(R a) {
+        return -a;
+    }
+    static R trunc(R a) {
+        return std::trunc(a);
+    }
+    static M lt(R a, R b) {
+        return a < b;
+    }
+    static M gt(R a, R b) {
+        return a > b;
+    }
+    static M ge(R a, R b) {
+        return a >= b;
+    }
+    static R select(M m, R a, R b) {
+        return m ? a : b;
+    }
+    static R reverse(R a) {
+        return a;
+    }
+    static R loadBytes(const uint8_t* p) {
+        return static_cast<T>(*p);
+    }
+    static void storeBytes(uint8_t* p, R a) {
+        // Written like the vector min and max, which give 0 for NaN
+        const T clamped = (a > T(0)) ? ((a < T(255)) ? a : T(255)) : T(0);
+        *p = static_cast<uint8_t>(clamped + T(0.5));
+    }
+    static R gatherIndexed(const T* p, const int32_t* indices) {
+        return p[indices[0]];
+    }
+    static R div(R a, R b) {
+        return a / b;
+    }
+    static R loadHalves(const uint16_t* p) {
+        return vImageHalfToFloat(*p);
+    }
+    static void storeHalves(uint16_t* p, R a) {
+        *p = vImageFloatToHalf(a);
+    }
+
+    // One pixel, its bytes in memory order from the lowest
+    typedef uint32_t I;
+
+    static uint8_t byte(I a, unsigned int i) {
+        return static_cast<uint8_t>(a >> (8 * i));
+    }
+    static I loadPixels(const uint8_t* p) {
+        I a;
+        memcpy(&a, p, sizeof(a));
+        return a;
+    }
+    static void storePixels(uint8_t* p, I a) {
+        memcpy(p, &a, sizeof(a));
+    }
+    static I loadPacked3(const uint8_t* p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16);
+    }
+    static void storePacked3(uint8_t* p, I a) {
+        p[0] = byte(a, 0);
+        p[1] = byte(a, 1);
+        p[2] = byte(a, 2);
+    }
+    static I setPixels(const uint8_t pixel[4]) {
+        return loadPixels(pixel);
+    }
+    static I pixelPattern(const uint8_t map[4]) {
+        return loadPixels(map);
+    }
+    static I shufflePixels(I a, I pattern) {
+        I shuffled = 0;
+        for (unsigned int i = 0; i < 4; ++i) {
+            if (byte(pattern, i) < 4) {
+                shuffled |= static_cast<I>(byte(a, byte(pattern, i))) << (8 * i);
+            }
+        }
+        return shuffled;
+    }
+    static I orPixels(I a, I b) {
+        return a | b;
+    }
+    static I multiplyBytes(I a, I b) {
+        I product = 0;
+        for (unsigned int i = 0; i < 4; ++i) {
+            const unsigned int t = byte(a, i) * byte(b, i) + 128;
+            product |= static_cast<I>((t + (t >> 8)) >> 8) << (8 * i);
+        }
+        return product;
+    }
+    static void bytesToFloats(I a, R out[4]) {
+        for (unsigned int i = 0; i < 4; ++i) {
+            out[i] = static_cast<T>(byte(a, i));
+        }
+    }
+    static I floatsToBytes(const R in[4]) {
+        I a = 0;
+        for (unsigned int i = 0; i < 4; ++i) {
+            const T clamped = (in[i] > T(0)) ? ((in[i] < T(255)) ? in[i] : T(255)) : T(0);
+            a |= static_cast<I>(clamped) << (8 * i);
+        }
+        return a;
+    }
+    static void transposeBytes(I r[4]) {
+        I transposed[4] = {};
+        for (unsigned int i = 0; i < 4; ++i) {
+            for (unsigned int j = 0; j < 4; ++j) {
+                transposed[j] |= static_cast<I>(byte(r[i], j)) << (8 * i);
+            }
+        }
+        memcpy(r, transposed, sizeof(transposed));
+    }
+    static void deinterleave(I r[4]) {
+        transposeBytes(r);
+    }
+    static void interleave(I r[4]) {
+        transposeBytes(r);
+    }
+};
+
+#include "vDSPKernels.inc"
+#include "vImageKernels.inc"
+
+} // namespace scalar
+
+#if VDSP_X86
+
+// MSVC compiles intrinsics for any instruction set anywhere; clang and gcc need the functions that use them marked
+// for it, which the pragmas around each namespace do.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+#endif
+
+namespace sse41 {
+
+struct Float {
+    typedef float T;
+    typedef __m128 R;
+    typedef __m128 M;
+    static const vDSP_Length width = 4;
+
+    static R load(const T* p) {
+        return _mm_loadu_ps(p);
+    }
+    static bool canGather(vDSP_Stride stride) {
+        return true;
+    }
+    static R gather(const T* p, vDSP_Stride stride) {
+        return _mm_setr_ps(p[0], p[stride], p[2 * stride], p[3 * stride]);
+    }
+    static void store(T* p, R a) {
+        _mm_storeu_ps(p, a);
+    }
+    static R set1(T a) {
+        return _mm_set1_ps(a);
+    }
+    static R add(R a, R b) {
+        return _mm_add_ps(a, b);
+    }
+    static R sub(R a, R b) {
+        return _mm_sub_ps(a, b);
+    }
+    static R mul(R a, R b) {
+        return _mm_mul_ps(a, b);
+    }
+    static R abs(R a) {
+        return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+    }
+    static R nabs(R a) {
+        return _mm_or_ps(_mm_set1_ps(-0.0f), a);
+    }
+    static R neg(R a) {
+        return _mm_xor_ps(_mm_set1_ps(-0.0f), a);
+    }
+    static R trunc(R a) {
+        return _mm_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    }
+    static M lt(R a, R b) {
+        return _mm_cmplt_ps(a, b);
+    }
+    static M gt(R a, R b) {
+        return _mm_cmpgt_ps(a, b);
+    }
+    static M ge(R a, R b) {
+        return _mm_cmpge_ps(a, b);
+    }
+    static R select(M m, R a, R b) {
+        return _mm_blendv_ps(b, a, m);
+    }
+    static R reverse(R a) {
+        return _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 1, 2, 3));
+    }
+    static R loadBytes(const uint8_t* p) {
+        int32_t bytes;
+        memcpy(&bytes, p, sizeof(bytes));
+        return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes)));
+    }
+    static void storeBytes(uint8_t* p, R a) {
+        R clamped = _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+        __m128i words = _mm_cvttps_epi32(_mm_add_ps(clamped, _mm_set1_ps(0.5f)));
+        words = _mm_packs_epi32(words, words);
+        int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+        memcpy(p, &bytes, sizeof(bytes));
+    }
+    static R gatherIndexed(const T* p, const int32_t* indices) {
+        return _mm_setr_ps(p[indices[0]], p[indices[1]], p[indices[2]], p[indices[3]]);
+    }
+    static R div(R a, R b) {
+        return _mm_div_ps(a, b);
+    }
+    static R loadHalves(const uint16_t* p) {
+        return halvesToFloats(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))));
+    }
+    static void storeHalves(uint16_t* p, R a) {
+        __m128i halves = floatsToHalves(a);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packus_epi32(halves, halves));
+    }
+
+    // Four pixels
+    typedef __m128i I;
+
+    static I loadPixels(const uint8_t* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    static void storePixels(uint8_t* p, I a) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a);
+    }
+    static I loadPacked3(const uint8_t* p) {
+        int32_t last;
+        memcpy(&last, p + 8, sizeof(last));
+        I packed = _mm_insert_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), last, 2);
+        return _mm_shuffle_epi8(packed, _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1));
+    }
+    static void storePacked3(uint8_t* p, I a) {
+        I packed = _mm_shuffle_epi8(a, _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), packed);
+        int32_t last = _mm_extract_epi32(packed, 2);
+        memcpy(p + 8, &last, sizeof(last));
+    }
+    static I setPixels(const uint8_t pixel[4]) {
+        int32_t a;
+        memcpy(&a, pixel, sizeof(a));
+        return _mm_set1_epi32(a);
+    }
+    static I pixelPattern(const uint8_t map[4]) {
+        int8_t pattern[16];
+        for (int i = 0; i < 16; ++i) {
+            const uint8_t from = map[i % 4];
+            pattern[i] = (from < 4) ? static_cast<int8_t>(i - i % 4 + from) : -1;
+        }
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern));
+    }
+    static I shufflePixels(I a, I pattern) {
+        return _mm_shuffle_epi8(a, pattern);
+    }
+    static I orPixels(I a, I b) {
+        return _mm_or_si128(a, b);
+    }
+    static I multiplyBytes(I a, I b) {
+        const I zero = _mm_setzero_si128();
+        const I half = _mm_set1_epi16(128);
+        I low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)), half);
+        I high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)), half);
+        low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+        return _mm_packus_epi16(low, high);
+    }
+    static void bytesToFloats(I a, R out[4]) {
+        out[0] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(a));
+        out[1] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(a, 4)));
+        out[2] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(a, 8)));
+        out[3] = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(a, 12)));
+    }
+    static I floatsToBytes(const R in[4]) {
+        I low = _mm_packs_epi32(_mm_cvttps_epi32(in[0]), _mm_cvttps_epi32(in[1]));
+        I high = _mm_packs_epi32(_mm_cvttps_epi32(in[2]), _mm_cvttps_epi32(in[3]));
+        return _mm_packus_epi16(low, high);
+    }
+    static void transpose(I r[4]) {
+        I t0 = _mm_unpacklo_epi32(r[0], r[1]);
+        I t1 = _mm_unpacklo_epi32(r[2], r[3]);
+        I t2 = _mm_unpackhi_epi32(r[0], r[1]);
+        I t3 = _mm_unpackhi_epi32(r[2], r[3]);
+        r[0] = _mm_unpacklo_epi64(t0, t1);
+        r[1] = _mm_unpackhi_epi64(t0, t1);
+        r[2] = _mm_unpacklo_epi64(t2, t3);
+        r[3] = _mm_unpackhi_epi64(t2, t3);
+    }
+    static void deinterleave(I r[4]) {
+        const I channels = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+        for (int i = 0; i < 4; ++i) {
+            r[i] = _mm_shuffle_epi8(r[i], channels);
+        }
+        transpose(r);
+    }
+    static void interleave(I r[4]) {
+        const I pixels = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+        transpose(r);
+        for (int i = 0; i < 4; ++i) {
+            r[i] = _mm_shuffle_epi8(r[i], pixels);
+        }
+    }
+
+    // The exact conversions of vImageHalfToFloat and vImageFloatToHalf, on 32-bit lanes.
+    static R halvesToFloats(__m128i h) {
+        const __m128i infinity = _mm_set1_epi32(0x7c00 << 13);
+        __m128i bits = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+        __m128i exponent = _mm_and_si128(bits, infinity);
+        bits = _mm_add_epi32(bits, _mm_set1_epi32((127 - 15) << 23));
+        bits = _mm_add_epi32(bits, _mm_and_si128(_mm_cmpeq_epi32(exponent, infinity), _mm_set1_epi32((128 - 16) << 23)));
+        __m128 subnormal =
+            _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(1 << 23))), _mm_castsi128_ps(_mm_set1_epi32(113 << 23)));
+        __m128i isSubnormal = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+        bits = _mm_blendv_epi8(bits, _mm_castps_si128(subnormal), isSubnormal);
+        return _mm_castsi128_ps(_mm_or_si128(bits, _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16)));
+    }
+    static __m128i floatsToHalves(R f) {
+        const __m128i subnormalMagic = _mm_set1_epi32(126 << 23);
+        __m128i bits = _mm_castps_si128(f);
+        __m128i sign = _mm_and_si128(bits, _mm_set1_epi32(0x80000000));
+        bits = _mm_xor_si128(bits, sign);
+        __m128i special =
+            _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(_mm_cmpgt_epi32(bits, _mm_set1_epi32(255 << 23)), _mm_set1_epi32(0x200)));
+        __m128i subnormal =
+            _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+        __m128i normal = _mm_add_epi32(bits, _mm_set1_epi32(0xfff - ((127 - 15) << 23)));
+        normal = _mm_srli_epi32(_mm_add_epi32(normal, _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1))), 13);
+        __m128i halves = _mm_blendv_epi8(normal, subnormal, _mm_cmplt_epi32(bits, _mm_set1_epi32(113 << 23)));
+        halves = _mm_blendv_epi8(halves, special, _mm_cmpgt_epi32(bits, _mm_set1_epi32((143 << 23) - 1)));
+        return _mm_or_si128(halves, _mm_srli_epi32(sign, 16));
+    }
+};
+
+struct Double {
+    typedef double T;
+    typedef __m128d R;
+    typedef __m128d M;
+    static const vDSP_Length width = 2;
+
+    static R load(const T* p) {
+        return _mm_loadu_pd(p);
+    }
+    static bool canGather(vDSP_Stride stride) {
+        return true;
+    }
+    static R gather(const T* p, vDSP_Stride stride) {
+        return _mm_setr_pd(p[0], p[stride]);
+    }
+    static void store(T* p, R a) {
+        _mm_storeu_pd(p, a);
+    }
+    static R set1(T a) {
+        return _mm_set1_pd(a);
+    }
+    static R add(R a, R b) {
+        return _mm_add_pd(a, b);
+    }
+    static R sub(R a, R b) {
+        return _mm_sub_pd(a, b);
+    }
+    static R mul(R a, R b) {
+        return _mm_mul_pd(a, b);
+    }
+    static R abs(R a) {
+        return _mm_andnot_pd(_mm_set1_pd(-0.0), a);
+    }
+    static R nabs(R a) {
+        return _mm_or_pd(_mm_set1_pd(-0.0), a);
+    }
+    static R neg(R a) {
+        return _mm_xor_pd(_mm_set1_pd(-0.0), a);
+    }
+    static R trunc(R a) {
+        return _mm_round_pd(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    }
+    static M lt(R a, R b) {
+        return _mm_cmplt_pd(a, b);
+    }
+    static M gt(R a, R b) {
+        return _mm_cmpgt_pd(a, b);
+    }
+    static M ge(R a, R b) {
+        return _mm_cmpge_pd(a, b);
+    }
+    static R select(M m, R a, R b) {
+        return _mm_blendv_pd(b, a, m);
+    }
+    static R reverse(R a) {
+        return _mm_shuffle_pd(a, a, 1);
+    }
+};
+
+#include "vDSPKernels.inc"
+#include "vImageKernels.inc"
+
+} // namespace sse41
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace avx2 {
+
+// Gathers take 32-bit element offsets.
+static bool strideFitsGather(vDSP_Stride stride, vDSP_Length width) {
+    return stride >= -(INT_MAX / static_cast<vDSP_Stride>(width)) && stride <= INT_MAX / static_cast<vDSP_Stride>(width);
+}
+
+// Strided inputs are read with the AVX2 gather instructions where they are quick, and otherwise element by element:
+// on AMD processors gathers are microcoded and lose to plain loads.
+template <bool HardwareGather>
+struct Float {
+    typedef float T;
+    typedef __m256 R;
+    typedef __m256 M;
+    static const vDSP_Length width = 8;
+
+    static R load(const T* p) {
+        return _mm256_loadu_ps(p);
+    }
+    static bool canGather(vDSP_Stride stride) {
+        return !HardwareGather || strideFitsGather(stride, width);
+    }
+    static R gather(const T* p, vDSP_Stride stride) {
+        if (HardwareGather) {
+            __m256i offsets = _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(stride)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+            return _mm256_i32gather_ps(p, offsets, sizeof(T));
+        }
+        return _mm256_setr_ps(p[0], p[stride], p[2 * stride], p[3 * stride], p[4 * stride], p[5 * stride], p[6 * stride], p[7 * stride]);
+    }
+    static void store(T* p, R a) {
+        _mm256_storeu_ps(p, a);
+    }
+    static R set1(T a) {
+        return _mm256_set1_ps(a);
+    }
+    static R add(R a, R b) {
+        return _mm256_add_ps(a, b);
+    }
+    static R sub(R a, R b) {
+        return _mm256_sub_ps(a, b);
+    }
+    static R mul(R a, R b) {
+        return _mm256_mul_ps(a, b);
+    }
+    static R abs(R a) {
+        return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);
+    }
+    static R nabs(R a) {
+        return _mm256_or_ps(_mm256_set1_ps(-0.0f), a);
+    }
+    static R neg(R a) {
+        return _mm256_xor_ps(_mm256_set1_ps(-0.0f), a);
+    }
+    static R trunc(R a) {
+        return _mm256_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    }
+    static M lt(R a, R b) {
+        return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+    }
+    static M gt(R a, R b) {
+        return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+    }
+    static M ge(R a, R b) {
+        return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+    }
+    static R select(M m, R a, R b) {
+        return _mm256_blendv_ps(b, a, m);
+    }
+    static R reverse(R a) {
+        return _mm256_permutevar8x32_ps(a, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    }
+    static R loadBytes(const uint8_t* p) {
+        return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))));
+    }
+    static void storeBytes(uint8_t* p, R a) {
+        R clamped = _mm256_min_ps(_mm256_max_ps(a, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+        __m256i words = _mm256_cvttps_epi32(_mm256_add_ps(clamped, _mm256_set1_ps(0.5f)));
+        __m128i halves = _mm_packs_epi32(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packus_epi16(halves, halves));
+    }
+    static R gatherIndexed(const T* p, const int32_t* indices) {
+        if (HardwareGather) {
+            return _mm256_i32gather_ps(p, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices)), sizeof(T));
+        }
+        return _mm256_setr_ps(p[indices[0]],
+                              p[indices[1]],
+                              p[indices[2]],
+                              p[indices[3]],
+                              p[indices[4]],
+                              p[indices[5]],
+                              p[indices[6]],
+                              p[indices[7]]);
+    }
+    static R div(R a, R b) {
+        return _mm256_div_ps(a, b);
+    }
+    static R loadHalves(const uint16_t* p) {
+        return halvesToFloats(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+    }
+    static void storeHalves(uint16_t* p, R a) {
+        __m256i halves = floatsToHalves(a);
+        halves = _mm256_permute4x64_epi64(_mm256_packus_epi32(halves, halves), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(halves));
+    }
+
+    // Eight pixels. The byte shuffles and unpacks stay within each 128-bit half.
+    typedef __m256i I;
+
+    static I loadPixels(const uint8_t* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    static void storePixels(uint8_t* p, I a) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a);
+    }
+    static I loadPacked3(const uint8_t* p) {
+        return _mm256_inserti128_si256(_mm256_castsi128_si256(sse41::Float::loadPacked3(p)), sse41::Float::loadPacked3(p + 12), 1);
+    }
+    static void storePacked3(uint8_t* p, I a) {
+        sse41::Float::storePacked3(p, _mm256_castsi256_si128(a));
+        sse41::Float::storePacked3(p + 12, _mm256_extracti128_si256(a, 1));
+    }
+    static I setPixels(const uint8_t pixel[4]) {
+        int32_t a;
+        memcpy(&a, pixel, sizeof(a));
+        return _mm256_set1_epi32(a);
+    }
+    static I pixelPattern(const uint8_t map[4]) {
+        return _mm256_broadcastsi128_si256(sse41::Float::pixelPattern(map));
+    }
+    static I shufflePixels(I a, I pattern) {
+        return _mm256_shuffle_epi8(a, pattern);
+    }
+    static I orPixels(I a, I b) {
+        return _mm256_or_si256(a, b);
+    }
+    static I multiplyBytes(I a, I b) {
+        const I zero = _mm256_setzero_si256();
+        const I half = _mm256_set1_epi16(128);
+        I low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero)), half);
+        I high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero)), half);
+        low = _mm256_srli_epi16(_mm256_add_epi16(low, _mm256_srli_epi16(low, 8)), 8);
+        high = _mm256_srli_epi16(_mm256_add_epi16(high, _mm256_srli_epi16(high, 8)), 8);
+        return _mm256_packus_epi16(low, high);
+    }
+    static void bytesToFloats(I a, R out[4]) {
+        __m128i low = _mm256_castsi256_si128(a);
+        __m128i high = _mm256_extracti128_si256(a, 1);
+        out[0] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(low));
+        out[1] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(low, 8)));
+        out[2] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(high));
+        out[3] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(high, 8)));
+    }
+    static I floatsToBytes(const R in[4]) {
+        I low = _mm256_packs_epi32(_mm256_cvttps_epi32(in[0]), _mm256_cvttps_epi32(in[1]));
+        I high = _mm256_packs_epi32(_mm256_cvttps_epi32(in[2]), _mm256_cvttps_epi32(in[3]));
+        return _mm256_permutevar8x32_epi32(_mm256_packus_epi16(low, high), _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    }
+    static void transpose(I r[4]) {
+        I t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+        I t1 = _mm256_unpacklo_epi32(r[2], r[3]);
+        I t2 = _mm256_unpackhi_epi32(r[0], r[1]);
+        I t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+        r[0] = _mm256_unpacklo_epi64(t0, t1);
+        r[1] = _mm256_unpackhi_epi64(t0, t1);
+        r[2] = _mm256_unpacklo_epi64(t2, t3);
+        r[3] = _mm256_unpackhi_epi64(t2, t3);
+    }
+
+    // The transpose leaves each channel's groups of four pixels with the first halves of the four registers in the
+    // first half and the second halves in the second, which the permutes put in order and back.
+    static void deinterleave(I r[4]) {
+        const I channels = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+        for (int i = 0; i < 4; ++i) {
+            r[i] = _mm256_shuffle_epi8(r[i], channels);
+        }
+        transpose(r);
+        for (int i = 0; i < 4; ++i) {
+            r[i] = _mm256_permutevar8x32_epi32(r[i], _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+        }
+    }
+    static void interleave(I r[4]) {
+        for (int i = 0; i < 4; ++i) {
+            r[i] = _mm256_permutevar8x32_epi32(r[i], _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+        }
+        transpose(r);
+        const I pixels = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+        for (int i = 0; i < 4; ++i) {
+            r[i] = _mm256_shuffle_epi8(r[i], pixels);
+        }
+    }
+
+    static R halvesToFloats(__m256i h) {
+        const __m256i infinity = _mm256_set1_epi32(0x7c00 << 13);
+        __m256i bits = _mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(0x7fff)), 13);
+        __m256i exponent = _mm256_and_si256(bits, infinity);
+        bits = _mm256_add_epi32(bits, _mm256_set1_epi32((127 - 15) << 23));
+        bits = _mm256_add_epi32(bits, _mm256_and_si256(_mm256_cmpeq_epi32(exponent, infinity), _mm256_set1_epi32((128 - 16) << 23)));
+        __m256 subnormal = _mm256_sub_ps(_mm256_castsi256_ps(_mm256_add_epi32(bits, _mm256_set1_epi32(1 << 23))),
+                                         _mm256_castsi256_ps(_mm256_set1_epi32(113 << 23)));
+        __m256i isSubnormal = _mm256_cmpeq_epi32(exponent, _mm256_setzero_si256());
+        bits = _mm256_blendv_epi8(bits, _mm256_castps_si256(subnormal), isSubnormal);
+        return _mm256_castsi256_ps(_mm256_or_si256(bits, _mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(0x8000)), 16)));
+    }
+    static __m256i floatsToHalves(R f) {
+        const __m256i subnormalMagic = _mm256_set1_epi32(126 << 23);
+        __m256i bits = _mm256_castps_si256(f);
+        __m256i sign = _mm256_and_si256(bits, _mm256_set1_epi32(0x80000000));
+        bits = _mm256_xor_si256(bits, sign);
+        __m256i isNaN = _mm256_cmpgt_epi32(bits, _mm256_set1_epi32(255 << 23));
+        __m256i special = _mm256_or_si256(_mm256_set1_epi32(0x7c00), _mm256_and_si256(isNaN, _mm256_set1_epi32(0x200)));
+        __m256i subnormal = _mm256_sub_epi32(
+            _mm256_castps_si256(_mm256_add_ps(_mm256_castsi256_ps(bits), _mm256_castsi256_ps(subnormalMagic))), subnormalMagic);
+        __m256i normal = _mm256_add_epi32(bits, _mm256_set1_epi32(0xfff - ((127 - 15) << 23)));
+        normal = _mm256_srli_epi32(_mm256_add_epi32(normal, _mm256_and_si256(_mm256_srli_epi32(bits, 13), _mm256_set1_epi32(1))), 13);
+        __m256i halves = _mm256_blendv_epi8(normal, subnormal, _mm256_cmpgt_epi32(_mm256_set1_epi32(113 << 23), bits));
+        halves = _mm256_blendv_epi8(halves, special, _mm256_cmpgt_epi32(bits, _mm256_set1_epi32((143 << 23) - 1)));
+        return _mm256_or_si256(halves, _mm256_srli_epi32(sign, 16));
+    }
+};
+
+template <bool HardwareGather>
+struct Double {
+    typedef double T;
+    typedef __m256d R;
+    typedef __m256d M;
+    static const vDSP_Length width = 4;
+
+    static R load(const T* p) {
+        return _mm256_loadu_pd(p);
+    }
+    static bool canGather(vDSP_Stride stride) {
+        return !HardwareGather || strideFitsGather(stride, width);
+    }
+    static R gather(const T* p, vDSP_Stride stride) {
+        if (HardwareGather) {
+            __m128i offsets = _mm_mullo_epi32(_mm_set1_epi32(static_cast<int>(stride)), _mm_setr_epi32(0, 1, 2, 3));
+            return _mm256_i32gather_pd(p, offsets, sizeof(T));
+        }
+        return _mm256_setr_pd(p[0], p[stride], p[2 * stride], p[3 * stride]);
+    }
+    static void store(T* p, R a) {
+        _mm256_storeu_pd(p, a);
+    }
+    static R set1(T a) {
+        return _mm256_set1_pd(a);
+    }
+    static R add(R a, R b) {
+        return _mm256_add_pd(a, b);
+    }
+    static R sub(R a, R b) {
+        return _mm256_sub_pd(a, b);
+    }
+    static R mul(R a, R b) {
+        return _mm256_mul_pd(a, b);
+    }
+    static R abs(R a) {
+        return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);
+    }
+    static R nabs(R a) {
+        return _mm256_or_pd(_mm256_set1_pd(-0.0), a);
+    }
+    static R neg(R a) {
+        return _mm256_xor_pd(_mm256_set1_pd(-0.0), a);
+    }
+    static R trunc(R a) {
+        return _mm256_round_pd(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    }
+    static M lt(R a, R b) {
+        return _mm256_cmp_pd(a, b, _CMP_LT_OQ);
+    }
+    static M gt(R a, R b) {
+        return _mm256_cmp_pd(a, b, _CMP_GT_OQ);
+    }
+    static M ge(R a, R b) {
+        return _mm256_cmp_pd(a, b, _CMP_GE_OQ);
+    }
+    static R select(M m, R a, R b) {
+        return _mm256_blendv_pd(b, a, m);
+    }
+    static R reverse(R a) {
+        return _mm256_permute4x64_pd(a, _MM_SHUFFLE(0, 1, 2, 3));
+    }
+};
+
+#include "vDSPKernels.inc"
+#include "vImageKernels.inc"
+
+} // namespace avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+static void cpuid(int leaf, int registers[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    __cpuidex(registers, leaf, 0);
+#else
+    unsigned int eax, ebx, ecx, edx;
+    __cpuid_count(leaf, 0, eax, ebx, ecx, edx);
+    registers[0] = eax;
+    registers[1] = ebx;
+    registers[2] = ecx;
+    registers[3] = edx;
+#endif
+}
+
+static bool isIntel() {
+    int registers[4];
+    cpuid(0, registers);
+    return registers[1] == 0x756e6547 && registers[3] == 0x49656e69 && registers[2] == 0x6c65746e; // "GenuineIntel"
+}
+
+static bool hasSSE41() {
+    int registers[4];
+    cpuid(1, registers);
+    return (registers[2] & (1 << 19)) != 0;
+}
+
+static bool hasAVX2() {
+    int registers[4];
+    cpuid(0, registers);
+    if (registers[0] < 7) {
+        return false;
+    }
+
+    // The OS has to save the upper halves of the ymm registers (OSXSAVE, then XCR0 bits 1 and 2) as well
+    cpuid(1, registers);
+    const int osxsaveAndAVX = (1 << 27) | (1 << 28);
+    if ((registers[2] & osxsaveAndAVX) != osxsaveAndAVX) {
+        return false;
+    }
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned int xcr0Low, xcr0High;
+    __asm__ __volatile__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    unsigned long long xcr0 = xcr0Low;
+#endif
+    if ((xcr0 & 0x6) != 0x6) {
+        return false;
+    }
+
+    cpuid(7, registers);
+    return (registers[1] & (1 << 5)) != 0;
+}
+
+#elif VDSP_NEON
+
+namespace neon {
+
+struct Float {
+    typedef float T;
+    typedef float32x4_t R;
+    typedef uint32x4_t M;
+    static const vDSP_Length width = 4;
+
+    static R load(const T* p) {
+        return vld1q_f32(p);
+    }
+    static bool canGather(vDSP_Stride stride) {
+        return true;
+    }
+    static R gather(const T* p, vDSP_Stride stride) {
+        R a = vdupq_n_f32(p[0]);
+        a = vsetq_lane_f32(p[stride], a, 1);
+        a = vsetq_lane_f32(p[2 * stride], a, 2);
+        return vsetq_lane_f32(p[3 * stride], a, 3);
+    }
+    static void store(T* p, R a) {
+        vst1q_f32(p, a);
+    }
+    static R set1(T a) {
+        return vdupq_n_f32(a);
+    }
+    static R add(R a, R b) {
+        return vaddq_f32(a, b);
+    }
+    static R sub(R a, R b) {
+        return vsubq_f32(a, b);
+    }
+    static R mul(R a, R b) {
+        return vmulq_f32(a, b);
+    }
+    static R abs(R a) {
+        return vabsq_f32(a);
+    }
+    static R nabs(R a) {
+        return vnegq_f32(vabsq_f32(a));
+    }
+    static R neg(R a) {
+        return vnegq_f32(a);
+    }
+    static R trunc(R a) {
+#if VDSP_NEON_DOUBLE
+        return vrndq_f32(a);
+#else
+        // ARMv7 has no vector rounding. Floats of 2^23 and up are whole already and kept as they are, like NaN;
+        // the rest go through a truncating integer conversion, taking the sign from a so that -0.5 gives -0.
+        M whole = vorrq_u32(vcageq_f32(a, vdupq_n_f32(8388608.0f)), vmvnq_u32(vceqq_f32(a, a)));
+        R truncated = vbslq_f32(vdupq_n_u32(0x80000000), a, vcvtq_f32_s32(vcvtq_s32_f32(a)));
+        return vbslq_f32(whole, a, truncated);
+#endif
+    }
+    static M lt(R a, R b) {
+        return vcltq_f32(a, b);
+    }
+    static M gt(R a, R b) {
+        return vcgtq_f32(a, b);
+    }
+    static M ge(R a, R b) {
+        return vcgeq_f32(a, b);
+    }
+    static R select(M m, R a, R b) {
+        return vbslq_f32(m, a, b);
+    }
+    static R reverse(R a) {
+        R pairs = vrev64q_f32(a);
+        return vcombine_f32(vget_high_f32(pairs), vget_low_f32(pairs));
+    }
+    static R loadBytes(const uint8_t* p) {
+        uint32_t bytes;
+        memcpy(&bytes, p, sizeof(bytes));
+        uint16x8_t words = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(bytes)));
+        return vcvtq_f32_u32(vmovl_u16(vget_low_u16(words)));
+    }
+    static void storeBytes(uint8_t* p, R a) {
+        R clamped = vminq_f32(vmaxq_f32(a, vdupq_n_f32(0.0f)), vdupq_n_f32(255.0f));
+        uint16x4_t words = vmovn_u32(vcvtq_u32_f32(vaddq_f32(clamped, vdupq_n_f32(0.5f))));
+        uint32_t bytes = vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(words, words))), 0);
+        memcpy(p, &bytes, sizeof(bytes));
+    }
+    static R gatherIndexed(const T* p, const int32_t* indices) {
+        R a = vdupq_n_f32(p[indices[0]]);
+        a = vsetq_lane_f32(p[indices[1]], a, 1);
+        a = vsetq_lane_f32(p[indices[2]], a, 2);
+        return vsetq_lane_f32(p[indices[3]], a, 3);
+    }
+    static R div(R a, R b) {
+#if VDSP_NEON_DOUBLE
+        return vdivq_f32(a, b);
+#else
+        // ARMv7 only has a reciprocal estimate, which would not round like the plain loops.
+        R q = vdupq_n_f32(vgetq_lane_f32(a, 0) / vgetq_lane_f32(b, 0));
+        q = vsetq_lane_f32(vgetq_lane_f32(a, 1) / vgetq_lane_f32(b, 1), q, 1);
+        q = vsetq_lane_f32(vgetq_lane_f32(a, 2) / vgetq_lane_f32(b, 2), q, 2);
+        return vsetq_lane_f32(vgetq_lane_f32(a, 3) / vgetq_lane_f32(b, 3), q, 3);
+#endif
+    }
+
+    // Uses the same bit manipulation as the other instruction sets rather than the hardware conversions, so that NaN
+    // payloads and rounding come out the same everywhere.
+    static R loadHalves(const uint16_t* p) {
+        const uint32x4_t infinity = vdupq_n_u32(0x7c00 << 13);
+        uint32x4_t h = vmovl_u16(vld1_u16(p));
+        uint32x4_t bits = vshlq_n_u32(vandq_u32(h, vdupq_n_u32(0x7fff)), 13);
+        uint32x4_t exponent = vandq_u32(bits, infinity);
+        bits = vaddq_u32(bits, vdupq_n_u32((127 - 15) << 23));
+        bits = vaddq_u32(bits, vandq_u32(vceqq_u32(exponent, infinity), vdupq_n_u32((128 - 16) << 23)));
+        R subnormal =
+            vsubq_f32(vreinterpretq_f32_u32(vaddq_u32(bits, vdupq_n_u32(1 << 23))), vreinterpretq_f32_u32(vdupq_n_u32(113 << 23)));
+        bits = vbslq_u32(vceqq_u32(exponent, vdupq_n_u32(0)), vreinterpretq_u32_f32(subnormal), bits);
+        return vreinterpretq_f32_u32(vorrq_u32(bits, vshlq_n_u32(vandq_u32(h, vdupq_n_u32(0x8000)), 16)));
+    }
+    static void storeHalves(uint16_t* p, R f) {
+        const uint32x4_t subnormalMagic = vdupq_n_u32(126 << 23);
+        uint32x4_t bits = vreinterpretq_u32_f32(f);
+        uint32x4_t sign = vandq_u32(bits, vdupq_n_u32(0x80000000));
+        bits = veorq_u32(bits, sign);
+        uint32x4_t special = vorrq_u32(vdupq_n_u32(0x7c00), vandq_u32(vcgtq_u32(bits, vdupq_n_u32(255 << 23)), vdupq_n_u32(0x200)));
+        uint32x4_t subnormal =
+            vsubq_u32(vreinterpretq_u32_f32(vaddq_f32(vreinterpretq_f32_u32(bits), vreinterpretq_f32_u32(subnormalMagic))), subnormalMagic);
+        uint32x4_t normal = vaddq_u32(bits, vdupq_n_u32(0xfff - ((127 - 15) << 23)));
+        normal = vshrq_n_u32(vaddq_u32(normal, vandq_u32(vshrq_n_u32(bits, 13), vdupq_n_u32(1))), 13);
+        uint32x4_t halves = vbslq_u32(vcltq_u32(bits, vdupq_n_u32(113 << 23)), subnormal, normal);
+        halves = vbslq_u32(vcgeq_u32(bits, vdupq_n_u32(143 << 23)), special, halves);
+        vst1_u16(p, vmovn_u32(vorrq_u32(halves, vshrq_n_u32(sign, 16))));
+    }
+
+    // Four pixels
+    typedef uint8x16_t I;
+
+    // A table lookup giving 0 for indices of 16 and up.
+    static I lookup(I a, I indices) {
+#if VDSP_NEON_DOUBLE
+        return vqtbl1q_u8(a, indices);
+#else
+        uint8x8x2_t table = { { vget_low_u8(a), vget_high_u8(a) } };
+        return vcombine_u8(vtbl2_u8(table, vget_low_u8(indices)), vtbl2_u8(table, vget_high_u8(indices)));
+#endif
+    }
+    static I loadPixels(const uint8_t* p) {
+        return vld1q_u8(p);
+    }
+    static void storePixels(uint8_t* p, I a) {
+        vst1q_u8(p, a);
+    }
+    static I loadPacked3(const uint8_t* p) {
+        static const uint8_t spread[16] = { 0, 1, 2, 255, 3, 4, 5, 255, 6, 7, 8, 255, 9, 10, 11, 255 };
+        uint32_t last;
+        memcpy(&last, p + 8, sizeof(last));
+        I packed = vcombine_u8(vld1_u8(p), vreinterpret_u8_u32(vdup_n_u32(last)));
+        return lookup(packed, vld1q_u8(spread));
+    }
+    static void storePacked3(uint8_t* p, I a) {
+        static const uint8_t compact[16] = { 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 255, 255, 255, 255 };
+        I packed = lookup(a, vld1q_u8(compact));
+        vst1_u8(p, vget_low_u8(packed));
+        uint32_t last = vgetq_lane_u32(vreinterpretq_u32_u8(packed), 2);
+        memcpy(p + 8, &last, sizeof(last));
+    }
+    static I setPixels(const uint8_t pixel[4]) {
+        uint32_t a;
+        memcpy(&a, pixel, sizeof(a));
+        return vreinterpretq_u8_u32(vdupq_n_u32(a));
+    }
+    static I pixelPattern(const uint8_t map[4]) {
+        uint8_t pattern[16];
+        for (int i = 0; i < 16; ++i) {
+            const uint8_t from = map[i % 4];
+            pattern[i] = (from < 4) ? static_cast<uint8_t>(i - i % 4 + from) : 255;
+        }
+        return vld1q_u8(pattern);
+    }
+    static I shufflePixels(I a, I pattern) {
+        return lookup(a, pattern);
+    }
+    static I orPixels(I a, I b) {
+        return vorrq_u8(a, b);
+    }
+    static I multiplyBytes(I a, I b) {
+        const uint16x8_t half = vdupq_n_u16(128);
+        uint16x8_t low = vaddq_u16(vmull_u8(vget_low_u8(a), vget_low_u8(b)), half);
+        uint16x8_t high = vaddq_u16(vmull_u8(vget_high_u8(a), vget_high_u8(b)), half);
+        return vcombine_u8(vaddhn_u16(low, vshrq_n_u16(low, 8)), vaddhn_u16(high, vshrq_n_u16(high, 8)));
+    }
+    static void bytesToFloats(I a, R out[4]) {
+        uint16x8_t low = vmovl_u8(vget_low_u8(a));
+        uint16x8_t high = vmovl_u8(vget_high_u8(a));
+        out[0] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(low)));
+        out[1] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(low)));
+        out[2] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(high)));
+        out[3] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(high)));
+    }
+    static I floatsToBytes(const R in[4]) {
+        uint16x4_t words[4];
+        for (int i = 0; i < 4; ++i) {
+            words[i] = vqmovn_u32(vcvtq_u32_f32(vminq_f32(in[i], vdupq_n_f32(255.0f))));
+        }
+        return vcombine_u8(vqmovn_u16(vcombine_u16(words[0], words[1])), vqmovn_u16(vcombine_u16(words[2], words[3])));
+    }
+    static void transpose(I r[4]) {
+        uint32x4x2_t t0 = vtrnq_u32(vreinterpretq_u32_u8(r[0]), vreinterpretq_u32_u8(r[1]));
+        uint32x4x2_t t1 = vtrnq_u32(vreinterpretq_u32_u8(r[2]), vreinterpretq_u32_u8(r[3]));
+        r[0] = vreinterpretq_u8_u32(vcombine_u32(vget_low_u32(t0.val[0]), vget_low_u32(t1.val[0])));
+        r[1] = vreinterpretq_u8_u32(vcombine_u32(vget_low_u32(t0.val[1]), vget_low_u32(t1.val[1])));
+        r[2] = vreinterpretq_u8_u32(vcombine_u32(vget_high_u32(t0.val[0]), vget_high_u32(t1.val[0])));
+        r[3] = vreinterpretq_u8_u32(vcombine_u32(vget_high_u32(t0.val[1]), vget_high_u32(t1.val[1])));
+    }
+    static void deinterleave(I r[4]) {
+        static const uint8_t channels[16] = { 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 };
+        for (int i = 0; i < 4; ++i) {
+            r[i] = lookup(r[i], vld1q_u8(channels));
+        }
+        transpose(r);
+    }
+    static void interleave(I r[4]) {
+        static const uint8_t pixels[16] = { 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 };
+        transpose(r);
+        for (int i = 0; i < 4; ++i) {
+            r[i] = lookup(r[i], vld1q_u8(pixels));
+        }
+    }
+};
+
+#if VDSP_NEON_DOUBLE
+struct Double {
+    typedef double T;
+    typedef float64x2_t R;
+    typedef uint64x2_t M;
+    static const vDSP_Length width = 2;
+
+    static R load(const T* p) {
+        return vld1q_f64(p);
+    }
+    static bool canGather(vDSP_Stride stride) {
+        return true;
+    }
+    static R gather(const T* p, vDSP_Stride stride) {
+        return vsetq_lane_f64(p[stride], vdupq_n_f64(p[0]), 1);
+    }
+    static void store(T* p, R a) {
+        vst1q_f64(p, a);
+    }
+    static R set1(T a) {
+        return vdupq_n_f64(a);
+    }
+    static R add(R a, R b) {
+        return vaddq_f64(a, b);
+    }
+    static R sub(R a, R b) {
+        return vsubq_f64(a, b);
+    }
+    static R mul(R a, R b) {
+        return vmulq_f64(a, b);
+    }
+    static R abs(R a) {
+        return vabsq_f64(a);
+    }
+    static R nabs(R a) {
+        return vnegq_f64(vabsq_f64(a));
+    }
+    static R neg(R a) {
+        return vnegq_f64(a);
+    }
+    static R trunc(R a) {
+        return vrndq_f64(a);
+    }
+    static M lt(R a, R b) {
+        return vcltq_f64(a, b);
+    }
+    static M gt(R a, R b) {
+        return vcgtq_f64(a, b);
+    }
+    static M ge(R a, R b) {
+        return vcgeq_f64(a, b);
+    }
+    static R select(M m, R a, R b) {
+        return vbslq_f64(m, a, b);
+    }
+    static R reverse(R a) {
+        return vextq_f64(a, a, 1);
+    }
+};
+#else
+// 32-bit ARM has no double precision vectors.
+typedef scalar::Scalar<double> Double;
+#endif
+
+#include "vDSPKernels.inc"
+#include "vImageKernels.inc"
+
+} // namespace neon
+
+#endif
+
+template <class F, class D, class I>
+static vDSPKernels makeKernels(const char* name) {
+    vDSPKernels kernels = { name, F::kernelSet(), D::kernelSet(), I::kernelSet() };
+    return kernels;
+}
+
+static std::vector<const vDSPKernels*> findKernels() {
+    std::vector<const vDSPKernels*> available;
+#if VDSP_X86
+    static const vDSPKernels s_avx2Gather =
+        makeKernels<avx2::Kernels<avx2::Float<true>>, avx2::Kernels<avx2::Double<true>>, avx2::ImageKernels<avx2::Float<true>>>(
+            "AVX2 with gathers");
+    static const vDSPKernels s_avx2 =
+        makeKernels<avx2::Kernels<avx2::Float<false>>, avx2::Kernels<avx2::Double<false>>, avx2::ImageKernels<avx2::Float<false>>>(
+            "AVX2");
+    static const vDSPKernels s_sse41 =
+        makeKernels<sse41::Kernels<sse41::Float>, sse41::Kernels<sse41::Double>, sse41::ImageKernels<sse41::Float>>("SSE4.1");
+    if (hasAVX2()) {
+        if (isIntel()) {
+            available.push_back(&s_avx2Gather);
+        }
+        available.push_back(&s_avx2);
+    }
+    if (hasSSE41()) {
+        available.push_back(&s_sse41);
+    }
+#elif VDSP_NEON
+    static const vDSPKernels s_neon =
+        makeKernels<neon::Kernels<neon::Float>, neon::Kernels<neon::Double>, neon::ImageKernels<neon::Float>>("NEON");
+    available.push_back(&s_neon);
+#endif
+    static const vDSPKernels s_scalar =
+        makeKernels<scalar::Kernels<scalar::Scalar<float>>,
+                    scalar::Kernels<scalar::Scalar<double>>,
+                    scalar::ImageKernels<scalar::Scalar<float>>>("Scalar");
+    available.push_back(&s_scalar);
+    return available;
+}
+
+const std::vector<const vDSPKernels*>& vDSPGetAvailableKernels() {
+    static const std::vector<const vDSPKernels*> s_available = findKernels();
+    return s_available;
+}
@@ -0,0 +1,430 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include <algorithm>
+#include <cstring>
+#include "Accelerate\vImage.h"
+#include "vDSPInternal.h"
+#include "AccelerateParallel.h"
+
+// The conversions between pixel formats go a row at a time: the vector kernels in vImageKernels.inc shuffle the bytes of
+// as many pixels as fill their registers, and the loops here finish each row with the same arithmetic. Rows are
+// independent, so every conversion that keeps or shrinks the size of a pixel also works with dest the same buffer as
+// src.
+//
+// Unless kvImageDoNotTile is passed, the rows are split into bands, one per thread.
+
+namespace {
+
+// Bytes to give each thread at least.
+const size_t c_parallelWork = 1 << 18;
+
+// The channel orders of the 4-byte formats, as indices into a pixel, and where each keeps its alpha.
+const uint8_t c_fromRGB[3][4] = { { 4, 0, 1, 2 }, { 0, 1, 2, 4 }, { 2, 1, 0, 4 } };
+const uint8_t c_toRGB[3][3] = { { 1, 2, 3 }, { 0, 1, 2 }, { 2, 1, 0 } };
+const unsigned int c_alphaOf[3] = { 0, 3, 3 };
+enum Format { ARGB, RGBA, BGRA };
+
+bool sameSize(const vImage_Buffer* a, const vImage_Buffer* b) {
+    return a->height == b->height && a->width == b->width;
+}
+
+// Calls row(y) for every row y < height, in bands across threads unless flags has kvImageDoNotTile.
+template <typename Row>
+void eachRow(vImagePixelCount height, size_t rowWork, vImage_Flags flags, const Row& row) {
+    const size_t minimumRows = (flags & kvImageDoNotTile) ? height : c_parallelWork / std::max<size_t>(rowWork, 1);
+    AccelerateParallelFor(height, minimumRows, [&row](size_t begin, size_t end) {
+        for (vImagePixelCount y = begin; y < end; ++y) {
+            row(y);
+        }
+    });
+}
+
+template <typename T>
+T* rowOf(const vImage_Buffer* buffer, vImagePixelCount y) {
+    return reinterpret_cast<T*>(static_cast<uint8_t*>(buffer->data) + y * buffer->rowBytes);
+}
+
+// The byte storeBytes rounds a float to, clamping NaN to 0 like the vector minimum and maximum.
+uint8_t roundToByte(float a) {
+    const float clamped = (a > 0.0f) ? ((a < 255.0f) ? a : 255.0f) : 0.0f;
+    return static_cast<uint8_t>(clamped + 0.5f);
+}
+
+void premultiplyPixels(const uint8_t* in, uint8_t* out, unsigned int alpha, vImagePixelCount width) {
+    vImagePixelCount i = vDSPGetKernels().image.premultiply32(in, out, alpha, width);
+    for (; i < width; ++i) {
+        const unsigned int a = in[4 * i + alpha];
+        for (unsigned int k = 0; k < 4; ++k) {
+            out[4 * i + k] = (k == alpha) ? a : static_cast<uint8_t>((in[4 * i + k] * a + 127) / 255);
+        }
+    }
+}
+
+void unpremultiplyPixels(const uint8_t* in, uint8_t* out, unsigned int alpha, vImagePixelCount width) {
+    vImagePixelCount i = vDSPGetKernels().image.unpremultiply32(in, out, alpha, width);
+    for (; i < width; ++i) {
+        const unsigned int a = in[4 * i + alpha];
+        for (unsigned int k = 0; k < 4; ++k) {
+            if (k != alpha) {
+                out[4 * i + k] = (a == 0) ? 0 : static_cast<uint8_t>(std::min(255u, (in[4 * i + k] * 255 + a / 2) / a));
+            }
+        }
+        out[4 * i + alpha] = a;
+    }
+}
+
+vImage_Error premultiply(const vImage_Buffer* src, const vImage_Buffer* dest, unsigned int alpha, bool inverse, vImage_Flags flags) {
+    if (src == nullptr || dest == nullptr || src->data == nullptr || dest->data == nullptr) {
+        return kvImageNullPointerArgument;
+    } else if (!sameSize(src, dest)) {
+        return kvImageBufferSizeMismatch;
+    }
+
+    eachRow(src->height, 4 * src->width, flags, [&](vImagePixelCount y) {
+        if (inverse) {
+            unpremultiplyPixels(rowOf<const uint8_t>(src, y), rowOf<uint8_t>(dest, y), alpha, src->width);
+        } else {
+            premultiplyPixels(rowOf<const uint8_t>(src, y), rowOf<uint8_t>(dest, y), alpha, src->width);
+        }
+    });
+    return kvImageNoError;
+}
+
+// Spreads 3-byte RGB pixels to 4 bytes in the order given, with alpha from aSrc if there is one and otherwise alpha.
+vImage_Error fromRGB888(const vImage_Buffer* src,
+                        const vImage_Buffer* aSrc,
+                        Pixel_8 alpha,
+                        const vImage_Buffer* dest,
+                        Format format,
+                        bool premultiplied,
+                        vImage_Flags flags) {
+    if (src == nullptr || dest == nullptr || src->data == nullptr || dest->data == nullptr ||
+        (aSrc != nullptr && aSrc->data == nullptr)) {
+        return kvImageNullPointerArgument;
+    } else if (!sameSize(src, dest) || (aSrc != nullptr && !sameSize(aSrc, dest))) {
+        return kvImageBufferSizeMismatch;
+    }
+
+    const vImageKernelSet& kernels = vDSPGetKernels().image;
+    const uint8_t* map = c_fromRGB[format];
+    const unsigned int alphaIndex = c_alphaOf[format];
+    uint8_t fill[4] = {};
+    fill[alphaIndex] = alpha;
+    const vImagePixelCount width = src->width;
+    eachRow(src->height, 4 * width, flags, [&](vImagePixelCount y) {
+        const uint8_t* in = rowOf<const uint8_t>(src, y);
+        uint8_t* out = rowOf<uint8_t>(dest, y);
+        vImagePixelCount i = kernels.expand24(in, out, map, fill, width);
+        for (; i < width; ++i) {
+            for (unsigned int k = 0; k < 4; ++k) {
+                out[4 * i + k] = (map[k] < 3) ? in[3 * i + map[k]] : fill[k];
+            }
+        }
+
+        if (aSrc != nullptr) {
+            const uint8_t* alphas = rowOf<const uint8_t>(aSrc, y);
+            for (i = 0; i < width; ++i) {
+                out[4 * i + alphaIndex] = alphas[i];
+            }
+        }
+        if (premultiplied && (aSrc != nullptr || alpha != 255)) {
+            premultiplyPixels(out, out, alphaIndex, width);
+        }
+    });
+    return kvImageNoError;
+}
+
+// Drops alpha from 4-byte pixels in the order given, leaving 3-byte RGB.
+vImage_Error toRGB888(const vImage_Buffer* src, const vImage_Buffer* dest, Format format, vImage_Flags flags) {
+    if (src == nullptr || dest == nullptr || src->data == nullptr || dest->data == nullptr) {
+        return kvImageNullPointerArgument;
+    } else if (!sameSize(src, dest)) {
+        return kvImageBufferSizeMismatch;
+    }
+
+    const vImageKernelSet& kernels = vDSPGetKernels().image;
+    const uint8_t* map = c_toRGB[format];
+    const vImagePixelCount width = src->width;
+    eachRow(src->height, 4 * width, flags, [&](vImagePixelCount y) {
+        const uint8_t* in = rowOf<const uint8_t>(src, y);
+        uint8_t* out = rowOf<uint8_t>(dest, y);
+        vImagePixelCount i = kernels.pack32(in, out, map, width);
+        for (; i < width; ++i) {
+            const uint8_t pixel[4] = { in[4 * i], in[4 * i + 1], in[4 * i + 2], in[4 * i + 3] };
+            for (unsigned int k = 0; k < 3; ++k) {
+                out[3 * i + k] = pixel[map[k]];
+            }
+        }
+    });
+    return kvImageNoError;
+}
+
+// Converts each element of a planar buffer of In to Out, with the kernel and then convert for what it leaves.
+template <typename In, typename Out, typename Convert>
+vImage_Error convertPlanar(const vImage_Buffer* src,
+                           const vImage_Buffer* dest,
+                           vDSP_Length (*kernel)(const In*, Out*, vDSP_Length),
+                           const Convert& convert,
+                           vImage_Flags flags) {
+    if (src == nullptr || dest == nullptr || src->data == nullptr || dest->data == nullptr) {
+        return kvImageNullPointerArgument;
+    } else if (!sameSize(src, dest)) {
+        return kvImageBufferSizeMismatch;
+    }
+
+    const vImagePixelCount width = src->width;
+    eachRow(src->height, std::max(sizeof(In), sizeof(Out)) * width, flags, [&](vImagePixelCount y) {
+        const In* in = rowOf<const In>(src, y);
+        Out* out = rowOf<Out>(dest, y);
+        for (vImagePixelCount i = kernel(in, out, width); i < width; ++i) {
+            out[i] = convert(in[i]);
+        }
+    });
+    return kvImageNoError;
+}
+
+} // namespace
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageConvert_ARGB8888toPlanar8(const vImage_Buffer* srcARGB,
+                                             const vImage_Buffer* destA,
+                                             const vImage_Buffer* destR,
+                                             const vImage_Buffer* destG,
+                                             const vImage_Buffer* destB,
+                                             vImage_Flags flags) {
+    const vImage_Buffer* planes[4] = { destA, destR, destG, destB };
+    if (srcARGB == nullptr || srcARGB->data == nullptr) {
+        return kvImageNullPointerArgument;
+    }
+    for (const vImage_Buffer* plane : planes) {
+        if (plane == nullptr || plane->data == nullptr) {
+            return kvImageNullPointerArgument;
+        } else if (!sameSize(srcARGB, plane)) {
+            return kvImageBufferSizeMismatch;
+        }
+    }
+
+    const vImageKernelSet& kernels = vDSPGetKernels().image;
+    const vImagePixelCount width = srcARGB->width;
+    eachRow(srcARGB->height, 4 * width, flags, [&](vImagePixelCount y) {
+        const uint8_t* in = rowOf<const uint8_t>(srcARGB, y);
+        uint8_t* const out[4] = { rowOf<uint8_t>(destA, y), rowOf<uint8_t>(destR, y), rowOf<uint8_t>(destG, y), rowOf<uint8_t>(destB, y) };
+        for (vImagePixelCount i = kernels.deinterleave32(in, out, width); i < width; ++i) {
+            for (unsigned int k = 0; k < 4; ++k) {
+                out[k][i] = in[4 * i + k];
+            }
+        }
+    });
+    return kvImageNoError;
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageConvert_Planar8toARGB8888(const vImage_Buffer* srcA,
+                                             const vImage_Buffer* srcR,
+                                             const vImage_Buffer* srcG,
+                                             const vImage_Buffer* srcB,
+                                             const vImage_Buffer* dest,
+                                             vImage_Flags flags) {
+    const vImage_Buffer* planes[4] = { srcA, srcR, srcG, srcB };
+    if (dest == nullptr || dest->data == nullptr) {
+        return kvImageNullPointerArgument;
+    }
+    for (const vImage_Buffer* plane : planes) {
+        if (plane == nullptr || plane->data == nullptr) {
+            return kvImageNullPointerArgument;
+        } else if (!sameSize(dest, plane)) {
+            return kvImageBufferSizeMismatch;
+        }
+    }
+
+    const vImageKernelSet& kernels = vDSPGetKernels().image;
+    const vImagePixelCount width = dest->width;
+    eachRow(dest->height, 4 * width, flags, [&](vImagePixelCount y) {
+        const uint8_t* const in[4] = {
+            rowOf<const uint8_t>(srcA, y), rowOf<const uint8_t>(srcR, y), rowOf<const uint8_t>(srcG, y), rowOf<const uint8_t>(srcB, y)
+        };
+        uint8_t* out = rowOf<uint8_t>(dest, y);
+        for (vImagePixelCount i = kernels.interleave32(in, out, width); i < width; ++i) {
+            for (unsigned int k = 0; k < 4; ++k) {
+                out[4 * i + k] = in[k][i];
+            }
+        }
+    });
+    return kvImageNoError;
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageConvert_RGB888toARGB8888(const vImage_Buffer* rgbSrc,
+                                            const vImage_Buffer* aSrc,
+                                            Pixel_8 alpha,
+                                            const vImage_Buffer* argbDest,
+                                            bool premultiply,
+                                            vImage_Flags flags) {
+    return fromRGB888(rgbSrc, aSrc, alpha, argbDest, ARGB, premultiply, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageConvert_RGB888toRGBA8888(const vImage_Buffer* rgbSrc,
+                                            const vImage_Buffer* aSrc,
+                                            Pixel_8 alpha,
+                                            const vImage_Buffer* rgbaDest,
+                                            bool premultiply,
+                                            vImage_Flags flags) {
+    return fromRGB888(rgbSrc, aSrc, alpha, rgbaDest, RGBA, premultiply, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageConvert_RGB888toBGRA8888(const vImage_Buffer* rgbSrc,
+                                            const vImage_Buffer* aSrc,
+                                            Pixel_8 alpha,
+                                            const vImage_Buffer* bgraDest,
+                                            bool premultiply,
+                                            vImage_Flags flags) {
+    return fromRGB888(rgbSrc, aSrc, alpha, bgraDest, BGRA, premultiply, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageConvert_ARGB8888toRGB888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    return toRGB888(src, dest, ARGB, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageConvert_RGBA8888toRGB888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    return toRGB888(src, dest, RGBA, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageConvert_BGRA8888toRGB888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    return toRGB888(src, dest, BGRA, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImagePermuteChannels_ARGB8888(const vImage_Buffer* src,
+                                            const vImage_Buffer* dest,
+                                            const uint8_t permuteMap[4],
+                                            vImage_Flags flags) {
+    if (src == nullptr || dest == nullptr || src->data == nullptr || dest->data == nullptr || permuteMap == nullptr) {
+        return kvImageNullPointerArgument;
+    } else if (!sameSize(src, dest)) {
+        return kvImageBufferSizeMismatch;
+    }
+    for (unsigned int k = 0; k < 4; ++k) {
+        if (permuteMap[k] > 3) {
+            return kvImageInvalidParameter;
+        }
+    }
+
+    const vImageKernelSet& kernels = vDSPGetKernels().image;
+    const uint8_t map[4] = { permuteMap[0], permuteMap[1], permuteMap[2], permuteMap[3] };
+    const uint8_t fill[4] = {};
+    const vImagePixelCount width = src->width;
+    eachRow(src->height, 4 * width, flags, [&](vImagePixelCount y) {
+        const uint8_t* in = rowOf<const uint8_t>(src, y);
+        uint8_t* out = rowOf<uint8_t>(dest, y);
+        for (vImagePixelCount i = kernels.shuffle32(in, out, map, fill, width); i < width; ++i) {
+            const uint8_t pixel[4] = { in[4 * i], in[4 * i + 1], in[4 * i + 2], in[4 * i + 3] };
+            for (unsigned int k = 0; k < 4; ++k) {
+                out[4 * i + k] = pixel[map[k]];
+            }
+        }
+    });
+    return kvImageNoError;
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImagePremultiplyData_ARGB8888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    return premultiply(src, dest, 0, false, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImagePremultiplyData_RGBA8888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    return premultiply(src, dest, 3, false, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageUnpremultiplyData_ARGB8888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    return premultiply(src, dest, 0, true, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageUnpremultiplyData_RGBA8888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    return premultiply(src, dest, 3, true, flags);
+}
+
+/**
+@Status Caveat
+@Notes Maps 0 to 255 onto 0.0 to 1.0, rounding to the nearest half.
+*/
+vImage_Error vImageConvert_Planar8toPlanar16F(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    return convertPlanar(src,
+                         dest,
+                         vDSPGetKernels().image.bytesToHalves,
+                         [](uint8_t a) { return vImageFloatToHalf(a * (1.0f / 255.0f)); },
+                         flags);
+}
+
+/**
+@Status Caveat
+@Notes Maps 0.0 to 1.0 onto 0 to 255, rounding half up and clamping whatever is outside, NaN to 0.
+*/
+vImage_Error vImageConvert_Planar16FtoPlanar8(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    return convertPlanar(src,
+                         dest,
+                         vDSPGetKernels().image.halvesToBytes,
+                         [](uint16_t a) { return roundToByte(vImageHalfToFloat(a) * 255.0f); },
+                         flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageConvert_PlanarFtoPlanar16F(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    return convertPlanar(src, dest, vDSPGetKernels().image.floatsToHalves, vImageFloatToHalf, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageConvert_Planar16FtoPlanarF(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    return convertPlanar(src, dest, vDSPGetKernels().image.halvesToFloats, vImageHalfToFloat, flags);
+}
@@ -0,0 +1,958 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include "Accelerate\vImage.h"
+#include "vDSPInternal.h"
+#include "AccelerateParallel.h"
+
+// The convolutions work down the destination a row at a time, each row first summed down the source rows around it into
+// a line of sums, one per channel of each source pixel it needs, and then along that line. The source rows are read
+// widened by the kernel's reach on either side, with whatever lies past the edges of the source filled in as the edge
+// mode asks, so that neither pass has to test for the edges.
+//
+// Box filters keep running sums: each row of sums is the one before plus the row entering the window less the one
+// leaving it, and the same along the line, so a pixel costs the same whatever the size of the box. A tent filter is two
+// boxes half its size one after the other, each pass summing the sums of the one before. Other kernels that are the
+// product of a column and a row of whole numbers, like Gaussians, go through the vector kernels one pass at a time, and
+// the rest in a single pass over all of their taps.
+//
+// Every sum is of whole numbers, so as long as they stay under 2^22 floats hold them exactly and the result comes out the
+// same as with integers; past that, sums are made in doubles, with plain loops.
+//
+// Unless kvImageDoNotTile is passed, the destination is split into bands of rows, one per thread.
+
+namespace {
+
+// Work, in additions, to give each thread at least.
+const size_t c_parallelWork = 1 << 18;
+
+// Sizes of 2^31 and up are not supported.
+const vImagePixelCount c_maximumSize = 2147483647;
+
+// The largest sum, divisor included, that is worked out in floats.
+const double c_floatSums = 1 << 22;
+
+enum Edge { CopyInPlace, TruncateKernel, BackgroundColorFill, EdgeExtend };
+
+enum Shape { Boxes, Separable, General };
+
+// The offsets [first, last] from a pixel that one pass of a box filter sums.
+struct Window {
+    ptrdiff_t first;
+    ptrdiff_t last;
+};
+
+size_t roundUpToCacheLine(size_t size) {
+    return (size + 63) & ~static_cast<size_t>(63);
+}
+
+// Everything about one call that the threads share. The weights point into the temp buffer.
+struct Convolution {
+    const vImage_Buffer* src;
+    const vImage_Buffer* dest;
+    ptrdiff_t offsetX;
+    ptrdiff_t offsetY;
+    size_t channels;
+    Edge edge;
+    uint8_t background[4];
+    bool leaveAlpha;
+
+    Shape shape;
+    size_t passes;
+    Window rowWindows[2];
+    Window columnWindows[2];
+    size_t height;
+    size_t width;
+    ptrdiff_t top;
+    ptrdiff_t left;
+    double divisor;
+    double weight;
+    bool inFloats;
+
+    // Down the rows and along the columns for Boxes and Separable, all height * width taps for General.
+    float* rowWeights;
+    float* columnWeights;
+    float* taps;
+
+    // Running sums of the weights, to normalize by those of the taps that land in the source with kvImageTruncateKernel.
+    double* rowSums;
+    double* columnSums;
+    double* tapSums;
+
+    // Whether the widened source rows are all in the source, and so read in place.
+    bool inPlace;
+    size_t extendedElements;
+    size_t ringRows;
+    size_t lines;
+};
+
+// Where each part of the temp buffer goes, after rounding its start up to a cache line. The weights come first, then
+// every thread's rows and lines.
+struct ConvolveLayout {
+    size_t threads;
+    size_t rowWeights;
+    size_t columnWeights;
+    size_t taps;
+    size_t rowSums;
+    size_t columnSums;
+    size_t tapSums;
+    size_t threadStart;
+    size_t rowPointers;
+    size_t ring;
+    size_t ringTags;
+    size_t line;
+    size_t divisors;
+    size_t perThread;
+    size_t size;
+
+    ConvolveLayout(const Convolution& c, vImage_Flags flags) {
+        const size_t elements = c.dest->width * c.channels;
+        const size_t sample = c.inFloats ? sizeof(float) : sizeof(double);
+        const bool truncate = c.edge == TruncateKernel;
+
+        size_t rowWork = c.extendedElements;
+        size_t minimumRows = 1;
+        if (c.shape == Boxes) {
+            rowWork *= 4 * c.passes;
+            minimumRows = c.height;
+        } else if (c.shape == Separable) {
+            rowWork = c.height * c.extendedElements + c.width * elements;
+        } else {
+            rowWork = c.height * c.width * elements;
+        }
+        minimumRows = std::max(minimumRows, c_parallelWork / std::max<size_t>(rowWork, 1));
+        threads = (flags & kvImageDoNotTile) ? 1 : AccelerateParallelThreads(c.dest->height, minimumRows);
+
+        rowWeights = 0;
+        columnWeights = rowWeights + roundUpToCacheLine(c.height * sizeof(float));
+        taps = columnWeights + roundUpToCacheLine(c.width * sizeof(float));
+        rowSums = taps + roundUpToCacheLine(c.shape == General ? c.height * c.width * sizeof(float) : 0);
+        columnSums = rowSums + roundUpToCacheLine(truncate ? (c.height + 1) * sizeof(double) : 0);
+        tapSums = columnSums + roundUpToCacheLine(truncate ? (c.width + 1) * sizeof(double) : 0);
+        threadStart = tapSums + roundUpToCacheLine((truncate && c.shape == General) ? (c.height + 1) * (c.width + 1) * sizeof(double) : 0);
+
+        // The ring of widened source rows has two more for the rows past the top and bottom edges and for a row of zeros.
+        rowPointers = 0;
+        ring = rowPointers + roundUpToCacheLine(c.height * sizeof(const uint8_t*));
+        ringTags = ring + (c.ringRows + 2) * roundUpToCacheLine(c.extendedElements);
+        line = ringTags + roundUpToCacheLine(c.ringRows * sizeof(ptrdiff_t));
+        divisors = line + c.lines * roundUpToCacheLine(c.extendedElements * sample);
+        perThread = divisors + roundUpToCacheLine(elements * sample);
+        size = threadStart + threads * perThread + 63;
+    }
+};
+
+ptrdiff_t wrap(ptrdiff_t i, size_t count) {
+    const ptrdiff_t n = static_cast<ptrdiff_t>(count);
+    return ((i % n) + n) % n;
+}
+
+// The hooks into the vector kernels, which only take floats: the double overloads leave everything to the plain loops.
+vDSP_Length slideRows(const vImageKernelSet& k, const float* prev, const uint8_t* A, const uint8_t* B, float* C, vDSP_Length N) {
+    return k.slideRows(prev, A, B, C, N);
+}
+
+vDSP_Length slideRows(const vImageKernelSet&, const double*, const uint8_t*, const uint8_t*, double*, vDSP_Length) {
+    return 0;
+}
+
+vDSP_Length slideLines(const vImageKernelSet& k, const float* prev, const float* A, const float* B, float* C, vDSP_Length N) {
+    return k.slideLines(prev, A, B, C, N);
+}
+
+vDSP_Length slideLines(const vImageKernelSet&, const double*, const double*, const double*, double*, vDSP_Length) {
+    return 0;
+}
+
+vDSP_Length scaleRows(
+    const vImageKernelSet& k, const uint8_t* const* rows, const float* weights, vDSP_Length taps, float* C, vDSP_Length N) {
+    return k.scaleRows(rows, weights, taps, C, N);
+}
+
+vDSP_Length scaleRows(const vImageKernelSet&, const uint8_t* const*, const float*, vDSP_Length, double*, vDSP_Length) {
+    return 0;
+}
+
+vDSP_Length filterLine(const vImageKernelSet& k,
+                       const float* A,
+                       const float* weights,
+                       vDSP_Length taps,
+                       vDSP_Length stride,
+                       float* C,
+                       vDSP_Length N) {
+    return k.filterLine(A, weights, taps, stride, C, N);
+}
+
+vDSP_Length filterLine(const vImageKernelSet&, const double*, const float*, vDSP_Length, vDSP_Length, double*, vDSP_Length) {
+    return 0;
+}
+
+vDSP_Length filterRows(const vImageKernelSet& k,
+                       const uint8_t* const* rows,
+                       const float* weights,
+                       vDSP_Length count,
+                       vDSP_Length taps,
+                       vDSP_Length stride,
+                       float* C,
+                       vDSP_Length N) {
+    return k.filterRows(rows, weights, count, taps, stride, C, N);
+}
+
+vDSP_Length filterRows(
+    const vImageKernelSet&, const uint8_t* const*, const float*, vDSP_Length, vDSP_Length, vDSP_Length, double*, vDSP_Length) {
+    return 0;
+}
+
+vDSP_Length divideToBytes(const vImageKernelSet& k, const float* A, const float* divisors, uint8_t* C, vDSP_Length N) {
+    return k.divideToBytes(A, divisors, C, N);
+}
+
+vDSP_Length divideToBytes(const vImageKernelSet&, const double*, const double*, uint8_t*, vDSP_Length) {
+    return 0;
+}
+
+// Convolves the destination rows [first, last) with sums of type T, in one thread's part of the temp buffer.
+template <typename T>
+class Convolver {
+public:
+    Convolver(const Convolution& c, const ConvolveLayout& layout, uint8_t* scratch)
+        : m_c(c), m_kernels(vDSPGetKernels().image), m_elements(c.dest->width * c.channels) {
+        m_rows = reinterpret_cast<const uint8_t**>(scratch + layout.rowPointers);
+        m_ring = scratch + layout.ring;
+        m_ringStride = roundUpToCacheLine(c.extendedElements);
+        m_tags = reinterpret_cast<ptrdiff_t*>(scratch + layout.ringTags);
+        m_lineStride = roundUpToCacheLine(c.extendedElements * sizeof(T)) / sizeof(T);
+        m_lines = reinterpret_cast<T*>(scratch + layout.line);
+        m_divisors = reinterpret_cast<T*>(scratch + layout.divisors);
+
+        std::fill(m_tags, m_tags + c.ringRows, PTRDIFF_MIN);
+        m_fill = m_ring + c.ringRows * m_ringStride;
+        m_zeros = m_fill + m_ringStride;
+        memset(m_zeros, 0, c.extendedElements);
+        for (size_t i = 0; i < c.extendedElements; ++i) {
+            m_fill[i] = (c.edge == BackgroundColorFill) ? c.background[i % c.channels] : 0;
+        }
+        if (c.edge != TruncateKernel) {
+            std::fill(m_divisors, m_divisors + m_elements, static_cast<T>(c.divisor));
+        }
+    }
+
+    void run(ptrdiff_t first, ptrdiff_t last) {
+        const Convolution& c = m_c;
+        if (c.shape == Boxes) {
+            // Each pass down the rows keeps as many of its lines as the one after it needs, and the last just one.
+            T* lines = m_lines;
+            m_zeroLine = lines;
+            std::fill(m_zeroLine, m_zeroLine + c.extendedElements, T(0));
+            lines += m_lineStride;
+            for (size_t k = 1; k <= c.passes; ++k) {
+                m_stage[k] = lines;
+                m_stageLines[k] = (k < c.passes) ? c.rowWindows[k].last - c.rowWindows[k].first + 2 : 1;
+                lines += m_stageLines[k] * m_lineStride;
+            }
+            m_across[0] = lines;
+            m_across[1] = lines + m_lineStride;
+
+            m_next[c.passes] = first;
+            for (size_t k = c.passes; k > 1; --k) {
+                m_next[k - 1] = m_next[k] + c.rowWindows[k - 1].first;
+            }
+            for (size_t k = 1; k <= c.passes; ++k) {
+                m_start[k] = m_next[k];
+            }
+        }
+
+        for (ptrdiff_t y = first; y < last; ++y) {
+            const T* sums;
+            if (c.shape == Boxes) {
+                advance(c.passes, y);
+                sums = acrossBoxes(stageLine(c.passes, y));
+            } else if (c.shape == Separable) {
+                sums = acrossTaps(down(y));
+            } else {
+                sums = everyTap(y);
+            }
+            finish(y, sums);
+        }
+    }
+
+private:
+    // The widened source row for destination row y: the pixels from kernel_width / 2 left of the destination's to as
+    // far right of it, with the edges filled in.
+    const uint8_t* sourceRow(ptrdiff_t y) {
+        const Convolution& c = m_c;
+        const ptrdiff_t height = static_cast<ptrdiff_t>(c.src->height);
+        ptrdiff_t row = c.offsetY + y;
+        if (row < 0 || row >= height) {
+            if (c.edge == BackgroundColorFill || c.edge == TruncateKernel) {
+                return m_fill;
+            }
+            row = std::min(std::max<ptrdiff_t>(row, 0), height - 1);
+        }
+
+        const uint8_t* in = static_cast<const uint8_t*>(c.src->data) + row * c.src->rowBytes;
+        if (c.inPlace) {
+            return in + (c.offsetX - c.left) * c.channels;
+        }
+
+        const ptrdiff_t slot = wrap(row, c.ringRows);
+        uint8_t* out = m_ring + slot * m_ringStride;
+        if (m_tags[slot] != row) {
+            m_tags[slot] = row;
+            const ptrdiff_t width = static_cast<ptrdiff_t>(c.src->width);
+            const ptrdiff_t start = c.offsetX - c.left;
+            const ptrdiff_t end = start + static_cast<ptrdiff_t>(c.extendedElements / c.channels);
+            const ptrdiff_t inFirst = std::min(std::max<ptrdiff_t>(start, 0), width);
+            const ptrdiff_t inLast = std::max(std::min(end, width), inFirst);
+            for (ptrdiff_t x = start; x < inFirst; ++x) {
+                outside(out + (x - start) * c.channels, in);
+            }
+            memcpy(out + (inFirst - start) * c.channels, in + inFirst * c.channels, (inLast - inFirst) * c.channels);
+            for (ptrdiff_t x = inLast; x < end; ++x) {
+                outside(out + (x - start) * c.channels, in + (width - 1) * c.channels);
+            }
+        }
+        return out;
+    }
+
+    // Fills in a pixel past the left or right edge, next to the pixel edge.
+    void outside(uint8_t* out, const uint8_t* edge) const {
+        const Convolution& c = m_c;
+        for (size_t i = 0; i < c.channels; ++i) {
+            out[i] = (c.edge == BackgroundColorFill) ? c.background[i] : (c.edge == TruncateKernel) ? 0 : edge[i];
+        }
+    }
+
+    T* stageLine(size_t k, ptrdiff_t y) {
+        return m_stage[k] + wrap(y, m_stageLines[k]) * m_lineStride;
+    }
+
+    // out = prev + pass k - 1's line at add - its line at sub, where pass 0 is the source rows.
+    void slide(size_t k, const T* prev, ptrdiff_t add, ptrdiff_t sub, T* out) {
+        const size_t N = m_c.extendedElements;
+        if (k == 1) {
+            const uint8_t* A = (add == PTRDIFF_MIN) ? m_zeros : sourceRow(add);
+            const uint8_t* B = (sub == PTRDIFF_MIN) ? m_zeros : sourceRow(sub);
+            for (size_t i = slideRows(m_kernels, prev, A, B, out, N); i < N; ++i) {
+                out[i] = prev[i] + static_cast<T>(A[i]) - static_cast<T>(B[i]);
+            }
+        } else {
+            const T* A = (add == PTRDIFF_MIN) ? m_zeroLine : stageLine(k - 1, add);
+            const T* B = (sub == PTRDIFF_MIN) ? m_zeroLine : stageLine(k - 1, sub);
+            for (size_t i = slideLines(m_kernels, prev, A, B, out, N); i < N; ++i) {
+                out[i] = prev[i] + A[i] - B[i];
+            }
+        }
+    }
+
+    // Sums down the rows with pass k of a box filter through row y, running the passes before it as far as it needs.
+    void advance(size_t k, ptrdiff_t through) {
+        const Window window = m_c.rowWindows[k - 1];
+        for (; m_next[k] <= through; ++m_next[k]) {
+            const ptrdiff_t y = m_next[k];
+            if (k > 1) {
+                advance(k - 1, y + window.last);
+            }
+            T* out = stageLine(k, y);
+            if (y == m_start[k]) {
+                slide(k, m_zeroLine, y + window.first, PTRDIFF_MIN, out);
+                for (ptrdiff_t j = window.first + 1; j <= window.last; ++j) {
+                    slide(k, out, y + j, PTRDIFF_MIN, out);
+                }
+            } else {
+                slide(k, stageLine(k, y - 1), y + window.last, y + window.first - 1, out);
+            }
+        }
+    }
+
+    // The box passes along a line of sums down the rows, each a running sum of the one before for each channel.
+    const T* acrossBoxes(const T* in) {
+        const Convolution& c = m_c;
+        const ptrdiff_t channels = static_cast<ptrdiff_t>(c.channels);
+        ptrdiff_t begin = 0;
+        ptrdiff_t end = static_cast<ptrdiff_t>(c.extendedElements / c.channels);
+        for (size_t k = 0; k < c.passes; ++k) {
+            const Window window = c.columnWindows[k];
+            T* out = m_across[k % 2];
+            begin -= window.first;
+            end -= window.last;
+            for (ptrdiff_t i = begin * channels; i < (begin + 1) * channels; ++i) {
+                T sum = 0;
+                for (ptrdiff_t j = window.first; j <= window.last; ++j) {
+                    sum += in[i + j * channels];
+                }
+                out[i] = sum;
+            }
+            const ptrdiff_t add = window.last * channels;
+            const ptrdiff_t sub = (window.first - 1) * channels;
+            for (ptrdiff_t i = (begin + 1) * channels; i < end * channels; ++i) {
+                out[i] = out[i - channels] + in[i + add] - in[i + sub];
+            }
+            in = out;
+        }
+        return in + c.left * channels;
+    }
+
+    // The weighted sum down the rows for destination row y, for a separable kernel.
+    const T* down(ptrdiff_t y) {
+        const Convolution& c = m_c;
+        const size_t N = c.extendedElements;
+        for (size_t k = 0; k < c.height; ++k) {
+            m_rows[k] = sourceRow(y - c.top + static_cast<ptrdiff_t>(k));
+        }
+        T* line = m_lines;
+        for (size_t i = scaleRows(m_kernels, m_rows, c.rowWeights, c.height, line, N); i < N; ++i) {
+            T sum = 0;
+            for (size_t k = 0; k < c.height; ++k) {
+                sum += static_cast<T>(c.rowWeights[k]) * static_cast<T>(m_rows[k][i]);
+            }
+            line[i] = sum;
+        }
+        return line;
+    }
+
+    const T* acrossTaps(const T* in) {
+        const Convolution& c = m_c;
+        T* out = m_lines + m_lineStride;
+        for (size_t i = filterLine(m_kernels, in, c.columnWeights, c.width, c.channels, out, m_elements); i < m_elements; ++i) {
+            T sum = 0;
+            for (size_t k = 0; k < c.width; ++k) {
+                sum += static_cast<T>(c.columnWeights[k]) * in[i + k * c.channels];
+            }
+            out[i] = sum;
+        }
+        return out;
+    }
+
+    const T* everyTap(ptrdiff_t y) {
+        const Convolution& c = m_c;
+        for (size_t k = 0; k < c.height; ++k) {
+            m_rows[k] = sourceRow(y - c.top + static_cast<ptrdiff_t>(k));
+        }
+        T* out = m_lines;
+        for (size_t i = filterRows(m_kernels, m_rows, c.taps, c.height, c.width, c.channels, out, m_elements); i < m_elements; ++i) {
+            T sum = 0;
+            for (size_t j = 0; j < c.height; ++j) {
+                for (size_t k = 0; k < c.width; ++k) {
+                    sum += static_cast<T>(c.taps[j * c.width + k]) * static_cast<T>(m_rows[j][i + k * c.channels]);
+                }
+            }
+            out[i] = sum;
+        }
+        return out;
+    }
+
+    // With kvImageTruncateKernel, the divisor scaled down by the share of the kernel's weight that lands in the source.
+    void truncatedDivisors(ptrdiff_t y) {
+        const Convolution& c = m_c;
+        const ptrdiff_t row = c.offsetY + y;
+        const ptrdiff_t rowFirst = std::max(-c.top, -row);
+        const ptrdiff_t rowLast = std::min(c.top, static_cast<ptrdiff_t>(c.src->height) - 1 - row);
+        const double rowWeight = c.rowSums[rowLast + c.top + 1] - c.rowSums[rowFirst + c.top];
+
+        for (vImagePixelCount x = 0; x < c.dest->width; ++x) {
+            const ptrdiff_t column = c.offsetX + static_cast<ptrdiff_t>(x);
+            const ptrdiff_t first = std::max(-c.left, -column);
+            const ptrdiff_t last = std::min(c.left, static_cast<ptrdiff_t>(c.src->width) - 1 - column);
+            double weight;
+            if (c.shape == General) {
+                const size_t stride = c.width + 1;
+                const double* top = c.tapSums + (rowFirst + c.top) * stride;
+                const double* bottom = c.tapSums + (rowLast + c.top + 1) * stride;
+                weight = bottom[last + c.left + 1] - bottom[first + c.left] - top[last + c.left + 1] + top[first + c.left];
+            } else {
+                weight = rowWeight * (c.columnSums[last + c.left + 1] - c.columnSums[first + c.left]);
+            }
+            const double divisor = (weight == 0 || c.weight == 0) ? c.divisor : c.divisor * weight / c.weight;
+            for (size_t i = 0; i < c.channels; ++i) {
+                m_divisors[x * c.channels + i] = static_cast<T>(divisor);
+            }
+        }
+    }
+
+    void finish(ptrdiff_t y, const T* sums) {
+        const Convolution& c = m_c;
+        if (c.edge == TruncateKernel) {
+            truncatedDivisors(y);
+        }
+
+        uint8_t* out = static_cast<uint8_t*>(c.dest->data) + y * c.dest->rowBytes;
+        for (size_t i = divideToBytes(m_kernels, sums, m_divisors, out, m_elements); i < m_elements; ++i) {
+            // As storeBytes rounds
+            const T quotient = (sums[i] + m_divisors[i] * T(0.5)) / m_divisors[i] - T(0.5);
+            const T clamped = (quotient > T(0)) ? ((quotient < T(255)) ? quotient : T(255)) : T(0);
+            out[i] = static_cast<uint8_t>(clamped + T(0.5));
+        }
+
+        const ptrdiff_t row = c.offsetY + y;
+        const uint8_t* in = static_cast<const uint8_t*>(c.src->data) + row * c.src->rowBytes + c.offsetX * c.channels;
+        if (c.leaveAlpha) {
+            for (size_t i = 0; i < m_elements; i += 4) {
+                out[i] = in[i];
+            }
+        }
+
+        // Pixels the kernel does not fit around are copied as they are.
+        if (c.edge == CopyInPlace) {
+            const ptrdiff_t width = static_cast<ptrdiff_t>(c.dest->width);
+            if (row < c.top || row + c.top >= static_cast<ptrdiff_t>(c.src->height)) {
+                memcpy(out, in, m_elements);
+            } else {
+                const ptrdiff_t left = std::min(std::max<ptrdiff_t>(c.left - c.offsetX, 0), width);
+                const ptrdiff_t right =
+                    std::min(std::max<ptrdiff_t>(static_cast<ptrdiff_t>(c.src->width) - c.left - c.offsetX, left), width);
+                memcpy(out, in, left * c.channels);
+                memcpy(out + right * c.channels, in + right * c.channels, (width - right) * c.channels);
+            }
+        }
+    }
+
+    const Convolution& m_c;
+    const vImageKernelSet& m_kernels;
+    const size_t m_elements;
+    const uint8_t** m_rows;
+    uint8_t* m_ring;
+    size_t m_ringStride;
+    ptrdiff_t* m_tags;
+    uint8_t* m_fill;
+    uint8_t* m_zeros;
+    size_t m_lineStride;
+    T* m_lines;
+    T* m_divisors;
+
+    T* m_zeroLine;
+    T* m_stage[3];
+    size_t m_stageLines[3];
+    ptrdiff_t m_next[3];
+    ptrdiff_t m_start[3];
+    T* m_across[2];
+};
+
+// Whether kernel is a column times a row of whole numbers, and if so those, as floats.
+bool separate(const int16_t* kernel, size_t height, size_t width, float* rowWeights, float* columnWeights) {
+    size_t pivot = 0;
+    while (pivot < height * width && kernel[pivot] == 0) {
+        ++pivot;
+    }
+    if (pivot == height * width) {
+        return false;
+    }
+
+    // The row through the first nonzero tap, divided through by its greatest common divisor, is the row to factor out.
+    const int16_t* row = kernel + pivot / width * width;
+    const size_t column = pivot % width;
+    int64_t divisor = 0;
+    for (size_t i = 0; i < width; ++i) {
+        int64_t a = std::abs(static_cast<int64_t>(row[i]));
+        while (a != 0) {
+            const int64_t b = divisor % a;
+            divisor = a;
+            a = b;
+        }
+    }
+
+    for (size_t j = 0; j < height; ++j) {
+        const int64_t factor = kernel[j * width + column] * divisor / row[column];
+        if (factor * row[column] != kernel[j * width + column] * divisor) {
+            return false;
+        }
+        for (size_t i = 0; i < width; ++i) {
+            if (factor * (row[i] / divisor) != kernel[j * width + i]) {
+                return false;
+            }
+        }
+        if (rowWeights) {
+            rowWeights[j] = static_cast<float>(factor);
+        }
+    }
+    for (size_t i = 0; columnWeights && i < width; ++i) {
+        columnWeights[i] = static_cast<float>(row[i] / divisor);
+    }
+    return true;
+}
+
+// The weights of one dimension of a box or tent filter.
+void boxWeights(const Window* windows, size_t passes, size_t size, float* weights) {
+    const ptrdiff_t reach = static_cast<ptrdiff_t>(size / 2);
+    for (ptrdiff_t d = -reach; d <= reach; ++d) {
+        // The number of ways to reach d with one offset from each window
+        float weight = 0;
+        if (passes == 1) {
+            weight = 1;
+        } else {
+            for (ptrdiff_t a = windows[0].first; a <= windows[0].last; ++a) {
+                weight += (d - a >= windows[1].first && d - a <= windows[1].last) ? 1.0f : 0.0f;
+            }
+        }
+        weights[d + reach] = weight;
+    }
+}
+
+// The edge mode flags asks for, the first of them when it has more than one.
+Edge edgeOf(vImage_Flags flags) {
+    if (flags & kvImageCopyInPlace) {
+        return CopyInPlace;
+    } else if (flags & kvImageTruncateKernel) {
+        return TruncateKernel;
+    } else if (flags & kvImageBackgroundColorFill) {
+        return BackgroundColorFill;
+    }
+    return EdgeExtend;
+}
+
+enum Filter { Box, Tent, Kernel };
+
+vImage_Error convolve(const vImage_Buffer* src,
+                      const vImage_Buffer* dest,
+                      void* tempBuffer,
+                      vImagePixelCount srcOffsetToROI_X,
+                      vImagePixelCount srcOffsetToROI_Y,
+                      Filter filter,
+                      const int16_t* kernel,
+                      uint32_t kernel_height,
+                      uint32_t kernel_width,
+                      int32_t divisor,
+                      const uint8_t* backgroundColor,
+                      size_t channels,
+                      vImage_Flags flags) {
+    if (src == nullptr || dest == nullptr || src->data == nullptr || dest->data == nullptr || (filter == Kernel && kernel == nullptr)) {
+        return kvImageNullPointerArgument;
+    } else if (!(kernel_height & kernel_width & 1)) {
+        return kvImageInvalidKernelSize;
+    } else if (srcOffsetToROI_X > src->width) {
+        return kvImageInvalidOffset_X;
+    } else if (srcOffsetToROI_Y > src->height) {
+        return kvImageInvalidOffset_Y;
+    } else if ((srcOffsetToROI_Y + dest->height > src->height) || (srcOffsetToROI_X + dest->width > src->width)) {
+        return kvImageRoiLargerThanInputBuffer;
+    } else if (!(flags & kvImageCopyInPlace) && !(flags & kvImageBackgroundColorFill) && !(flags & kvImageEdgeExtend) &&
+               !(flags & kvImageTruncateKernel)) {
+        return kvImageInvalidEdgeStyle;
+    } else if (src->height > c_maximumSize || src->width > c_maximumSize || dest->height > c_maximumSize ||
+               dest->width > c_maximumSize || kernel_height > c_maximumSize || kernel_width > c_maximumSize) {
+        return kvImageInvalidParameter;
+    }
+
+    if (dest->height == 0 || dest->width == 0) {
+        return (flags & kvImageGetTempBufferSize) ? 0 : kvImageNoError;
+    }
+
+    Convolution c = {};
+    c.src = src;
+    c.dest = dest;
+    c.offsetX = static_cast<ptrdiff_t>(srcOffsetToROI_X);
+    c.offsetY = static_cast<ptrdiff_t>(srcOffsetToROI_Y);
+    c.channels = channels;
+    c.edge = edgeOf(flags);
+    // Callers may pass no background color unless it is used.
+    if (c.edge == BackgroundColorFill) {
+        memcpy(c.background, backgroundColor, channels);
+    }
+    c.leaveAlpha = channels == 4 && (flags & kvImageLeaveAlphaUnchanged);
+    c.height = kernel_height;
+    c.width = kernel_width;
+    c.top = static_cast<ptrdiff_t>(kernel_height / 2);
+    c.left = static_cast<ptrdiff_t>(kernel_width / 2);
+
+    // The sum of the magnitudes of the weights, for the largest sum of 255s they can make.
+    double magnitude;
+    if (filter == Kernel) {
+        c.shape = separate(kernel, c.height, c.width, nullptr, nullptr) ? Separable : General;
+        c.divisor = (divisor == 0) ? 1 : divisor;
+        c.weight = 0;
+        magnitude = 0;
+        for (size_t i = 0; i < c.height * c.width; ++i) {
+            c.weight += kernel[i];
+            magnitude += std::abs(static_cast<double>(kernel[i]));
+        }
+    } else {
+        // A tent filter k wide is two boxes (k + 1) / 2 wide, the second turned around when that is even.
+        c.shape = Boxes;
+        c.passes = (filter == Box) ? 1 : 2;
+        const ptrdiff_t sizes[2] = { c.top, c.left };
+        Window* windows[2] = { c.rowWindows, c.columnWindows };
+        double area = 1;
+        for (size_t d = 0; d < 2; ++d) {
+            if (filter == Box) {
+                windows[d][0] = { -sizes[d], sizes[d] };
+                area *= 2 * sizes[d] + 1;
+            } else {
+                const ptrdiff_t box = sizes[d] + 1;
+                const ptrdiff_t before = (box - 1) / 2;
+                windows[d][0] = { -before, box - 1 - before };
+                windows[d][1] = { -(box - 1 - before), before };
+                area *= box * box;
+            }
+        }
+        c.divisor = area;
+        c.weight = area;
+        magnitude = area;
+    }
+    c.inFloats = 255 * magnitude + std::fabs(c.divisor) <= c_floatSums;
+
+    c.inPlace = c.offsetX >= c.left && c.offsetX + static_cast<ptrdiff_t>(dest->width) + c.left <= static_cast<ptrdiff_t>(src->width);
+    c.extendedElements = (dest->width + c.width - 1) * channels;
+    c.ringRows = (c.shape == Boxes) ? c.rowWindows[0].last - c.rowWindows[0].first + 2 : c.height;
+    if (c.shape == Boxes) {
+        c.lines = 3 + ((c.passes == 2) ? c.rowWindows[1].last - c.rowWindows[1].first + 3 : 1);
+    } else {
+        c.lines = (c.shape == Separable) ? 2 : 1;
+    }
+
+    const ConvolveLayout layout(c, flags);
+    if (flags & kvImageGetTempBufferSize) {
+        return layout.size;
+    }
+
+    std::unique_ptr<uint8_t[]> allocated;
+    if (tempBuffer == nullptr) {
+        allocated.reset(new (std::nothrow) uint8_t[layout.size]);
+        if (allocated == nullptr) {
+            return kvImageMemoryAllocationError;
+        }
+        tempBuffer = allocated.get();
+    }
+    uint8_t* temp = reinterpret_cast<uint8_t*>(roundUpToCacheLine(reinterpret_cast<uintptr_t>(tempBuffer)));
+
+    c.rowWeights = reinterpret_cast<float*>(temp + layout.rowWeights);
+    c.columnWeights = reinterpret_cast<float*>(temp + layout.columnWeights);
+    c.taps = reinterpret_cast<float*>(temp + layout.taps);
+    if (c.shape == Boxes) {
+        boxWeights(c.rowWindows, c.passes, c.height, c.rowWeights);
+        boxWeights(c.columnWindows, c.passes, c.width, c.columnWeights);
+    } else if (c.shape == Separable) {
+        separate(kernel, c.height, c.width, c.rowWeights, c.columnWeights);
+    } else {
+        std::copy(kernel, kernel + c.height * c.width, c.taps);
+    }
+
+    if (c.edge == TruncateKernel) {
+        c.rowSums = reinterpret_cast<double*>(temp + layout.rowSums);
+        c.columnSums = reinterpret_cast<double*>(temp + layout.columnSums);
+        if (c.shape == General) {
+            c.tapSums = reinterpret_cast<double*>(temp + layout.tapSums);
+            const size_t stride = c.width + 1;
+            std::fill(c.tapSums, c.tapSums + stride, 0.0);
+            for (size_t j = 0; j < c.height; ++j) {
+                double* sums = c.tapSums + (j + 1) * stride;
+                sums[0] = 0;
+                for (size_t i = 0; i < c.width; ++i) {
+                    sums[i + 1] = sums[i] + sums[i - stride + 1] - sums[i - stride] + c.taps[j * c.width + i];
+                }
+            }
+        } else {
+            c.rowSums[0] = 0;
+            for (size_t j = 0; j < c.height; ++j) {
+                c.rowSums[j + 1] = c.rowSums[j] + c.rowWeights[j];
+            }
+            c.columnSums[0] = 0;
+            for (size_t i = 0; i < c.width; ++i) {
+                c.columnSums[i + 1] = c.columnSums[i] + c.columnWeights[i];
+            }
+        }
+    }
+
+    const size_t threads = layout.threads;
+    const ptrdiff_t height = static_cast<ptrdiff_t>(dest->height);
+    AccelerateParallelFor(threads, 1, [&](size_t begin, size_t end) {
+        for (size_t thread = begin; thread < end; ++thread) {
+            uint8_t* scratch = temp + layout.threadStart + thread * layout.perThread;
+            const ptrdiff_t first = height * static_cast<ptrdiff_t>(thread) / static_cast<ptrdiff_t>(threads);
+            const ptrdiff_t last = height * static_cast<ptrdiff_t>(thread + 1) / static_cast<ptrdiff_t>(threads);
+            if (c.inFloats) {
+                Convolver<float>(c, layout, scratch).run(first, last);
+            } else {
+                Convolver<double>(c, layout, scratch).run(first, last);
+            }
+        }
+    });
+    return kvImageNoError;
+}
+
+} // namespace
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageBoxConvolve_ARGB8888(const vImage_Buffer* src,
+                                        const vImage_Buffer* dest,
+                                        void* tempBuffer,
+                                        vImagePixelCount srcOffsetToROI_X,
+                                        vImagePixelCount srcOffsetToROI_Y,
+                                        uint32_t kernel_height,
+                                        uint32_t kernel_width,
+                                        const Pixel_8888 backgroundColor,
+                                        vImage_Flags flags) {
+    return convolve(src,
+                    dest,
+                    tempBuffer,
+                    srcOffsetToROI_X,
+                    srcOffsetToROI_Y,
+                    Box,
+                    nullptr,
+                    kernel_height,
+                    kernel_width,
+                    0,
+                    backgroundColor,
+                    4,
+                    flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageBoxConvolve_Planar8(const vImage_Buffer* src,
+                                       const vImage_Buffer* dest,
+                                       void* tempBuffer,
+                                       vImagePixelCount srcOffsetToROI_X,
+                                       vImagePixelCount srcOffsetToROI_Y,
+                                       uint32_t kernel_height,
+                                       uint32_t kernel_width,
+                                       Pixel_8 backgroundColor,
+                                       vImage_Flags flags) {
+    return convolve(src,
+                    dest,
+                    tempBuffer,
+                    srcOffsetToROI_X,
+                    srcOffsetToROI_Y,
+                    Box,
+                    nullptr,
+                    kernel_height,
+                    kernel_width,
+                    0,
+                    &backgroundColor,
+                    1,
+                    flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageTentConvolve_ARGB8888(const vImage_Buffer* src,
+                                         const vImage_Buffer* dest,
+                                         void* tempBuffer,
+                                         vImagePixelCount srcOffsetToROI_X,
+                                         vImagePixelCount srcOffsetToROI_Y,
+                                         uint32_t kernel_height,
+                                         uint32_t kernel_width,
+                                         const Pixel_8888 backgroundColor,
+                                         vImage_Flags flags) {
+    return convolve(src,
+                    dest,
+                    tempBuffer,
+                    srcOffsetToROI_X,
+                    srcOffsetToROI_Y,
+                    Tent,
+                    nullptr,
+                    kernel_height,
+                    kernel_width,
+                    0,
+                    backgroundColor,
+                    4,
+                    flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageTentConvolve_Planar8(const vImage_Buffer* src,
+                                        const vImage_Buffer* dest,
+                                        void* tempBuffer,
+                                        vImagePixelCount srcOffsetToROI_X,
+                                        vImagePixelCount srcOffsetToROI_Y,
+                                        uint32_t kernel_height,
+                                        uint32_t kernel_width,
+                                        Pixel_8 backgroundColor,
+                                        vImage_Flags flags) {
+    return convolve(src,
+                    dest,
+                    tempBuffer,
+                    srcOffsetToROI_X,
+                    srcOffsetToROI_Y,
+                    Tent,
+                    nullptr,
+                    kernel_height,
+                    kernel_width,
+                    0,
+                    &backgroundColor,
+                    1,
+                    flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageConvolve_ARGB8888(const vImage_Buffer* src,
+                                     const vImage_Buffer* dest,
+                                     void* tempBuffer,
+                                     vImagePixelCount srcOffsetToROI_X,
+                                     vImagePixelCount srcOffsetToROI_Y,
+                                     const int16_t* kernel,
+                                     uint32_t kernel_height,
+                                     uint32_t kernel_width,
+                                     int32_t divisor,
+                                     const Pixel_8888 backgroundColor,
+                                     vImage_Flags flags) {
+    return convolve(src,
+                    dest,
+                    tempBuffer,
+                    srcOffsetToROI_X,
+                    srcOffsetToROI_Y,
+                    Kernel,
+                    kernel,
+                    kernel_height,
+                    kernel_width,
+                    divisor,
+                    backgroundColor,
+                    4,
+                    flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageConvolve_Planar8(const vImage_Buffer* src,
+                                    const vImage_Buffer* dest,
+                                    void* tempBuffer,
+                                    vImagePixelCount srcOffsetToROI_X,
+                                    vImagePixelCount srcOffsetToROI_Y,
+                                    const int16_t* kernel,
+                                    uint32_t kernel_height,
+                                    uint32_t kernel_width,
+                                    int32_t divisor,
+                                    Pixel_8 backgroundColor,
+                                    vImage_Flags flags) {
+    return convolve(src,
+                    dest,
+                    tempBuffer,
+                    srcOffsetToROI_X,
+                    srcOffsetToROI_Y,
+                    Kernel,
+                    kernel,
+                    kernel_height,
+                    kernel_width,
+                    divisor,
+                    &backgroundColor,
+                    1,
+                    flags);
+}
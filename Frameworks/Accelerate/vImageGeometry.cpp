@@ -0,0 +1,387 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <new>
+#include "Accelerate\vImage.h"
+#include "vDSPInternal.h"
+#include "AccelerateParallel.h"
+
+// vImageScale resamples with a Lanczos filter, separably: each destination row is first the weighted sum of the source
+// rows around it, in floats, and then each of its pixels the weighted sum of the pixels of that row around it, rounded
+// back to bytes. The weights only depend on the sizes, so they are worked out once per call into the temp buffer, for
+// the columns already spread out per channel so that the vector kernels can gather them. Going down the rows first
+// leaves the second pass at the destination's height, which is the smaller one when shrinking.
+//
+// Rotations and reflections only move pixels. Rotations copy them a tile at a time so that the reads down the source's
+// columns stay in the cache; see c_rotateTileWidth.
+//
+// Unless kvImageDoNotTile is passed, the destination is split into bands of rows, one per thread.
+
+namespace {
+
+// Work, in multiply-adds or pixels moved, to give each thread at least.
+const size_t c_parallelWork = 1 << 18;
+
+// The tiles rotations copy, in pixels: a run of rows, each reading down as many of the source's rows as the tile is wide.
+// The cache lines read for one row are read again by the rows after it, so those are kept to what fits in the level 2
+// cache. Writing whole rows at a time is quicker than square tiles, which spread the writes over many rows.
+const vImagePixelCount c_rotateTileWidth = 1024;
+const vImagePixelCount c_rotateTileHeight = 16;
+
+// Like vImageBoxConvolve_ARGB8888, sizes of 2^31 and up are not supported.
+const vImagePixelCount c_maximumSize = 2147483647;
+
+const double c_pi = 3.14159265358979323846;
+
+double lanczos(double t, int radius) {
+    if (t == 0) {
+        return 1;
+    } else if (std::fabs(t) >= radius) {
+        return 0;
+    }
+    const double x = c_pi * t;
+    return radius * std::sin(x) * std::sin(x / radius) / (x * x);
+}
+
+// The number of source samples each destination sample is a sum of, when resampling from samples to to: the filter is
+// widened by the factor when shrinking, to average over all of the samples it leaves out.
+vDSP_Length lanczosTaps(vImagePixelCount from, vImagePixelCount to, int radius) {
+    const double support = radius * std::max(1.0, static_cast<double>(from) / to);
+    return std::max<vDSP_Length>(static_cast<vDSP_Length>(std::ceil(2 * support)), 1);
+}
+
+// The taps of destination sample i: index[k * step] and weight[k * step] for k < taps, with samples that would lie past
+// the edges taken from the edges and the weights normalized to add up to 1. Sample centres line up with the edges of the
+// two images.
+void lanczosWeights(vImagePixelCount from,
+                    vImagePixelCount to,
+                    int radius,
+                    vDSP_Length taps,
+                    vImagePixelCount i,
+                    int32_t* index,
+                    float* weight,
+                    size_t step) {
+    const double scale = std::max(1.0, static_cast<double>(from) / to);
+    const double center = (i + 0.5) * from / to - 0.5;
+    const double first = std::floor(center - radius * scale) + 1;
+
+    double sum = 0;
+    for (vDSP_Length k = 0; k < taps; ++k) {
+        sum += lanczos((first + k - center) / scale, radius);
+    }
+
+    for (vDSP_Length k = 0; k < taps; ++k) {
+        const double sample = std::min(std::max(first + k, 0.0), static_cast<double>(from - 1));
+        index[k * step] = static_cast<int32_t>(sample);
+        weight[k * step] = static_cast<float>(lanczos((first + k - center) / scale, radius) / sum);
+    }
+}
+
+size_t roundUpToCacheLine(size_t size) {
+    return (size + 63) & ~static_cast<size_t>(63);
+}
+
+// Where each part of vImageScale's temp buffer goes, after rounding its start up to a cache line.
+struct ScaleLayout {
+    vDSP_Length rowTaps;
+    vDSP_Length columnTaps;
+    size_t threads;
+    size_t rowIndex;
+    size_t rowWeight;
+    size_t columnIndex;
+    size_t columnWeight;
+    size_t perThread;
+    size_t size;
+
+    ScaleLayout(const vImage_Buffer* src, const vImage_Buffer* dest, size_t channels, vImage_Flags flags) {
+        const int radius = (flags & kvImageHighQualityResampling) ? 5 : 3;
+        rowTaps = lanczosTaps(src->height, dest->height, radius);
+        columnTaps = lanczosTaps(src->width, dest->width, radius);
+
+        const size_t srcElements = src->width * channels;
+        const size_t destElements = dest->width * channels;
+        const size_t rowWork = rowTaps * srcElements + columnTaps * destElements;
+        threads = (flags & kvImageDoNotTile) ? 1 : AccelerateParallelThreads(dest->height, std::max<size_t>(c_parallelWork / rowWork, 1));
+
+        rowIndex = 0;
+        rowWeight = rowIndex + roundUpToCacheLine(dest->height * rowTaps * sizeof(int32_t));
+        columnIndex = rowWeight + roundUpToCacheLine(dest->height * rowTaps * sizeof(float));
+        columnWeight = columnIndex + roundUpToCacheLine(columnTaps * destElements * sizeof(int32_t));
+        perThread = roundUpToCacheLine(rowTaps * sizeof(const uint8_t*)) + roundUpToCacheLine(srcElements * sizeof(float));
+        size = columnWeight + roundUpToCacheLine(columnTaps * destElements * sizeof(float)) + threads * perThread + 63;
+    }
+};
+
+vImage_Error scale(const vImage_Buffer* src, const vImage_Buffer* dest, void* tempBuffer, size_t channels, vImage_Flags flags) {
+    if (src == nullptr || dest == nullptr || src->data == nullptr || dest->data == nullptr) {
+        return kvImageNullPointerArgument;
+    } else if (src->height > c_maximumSize || src->width > c_maximumSize || dest->height > c_maximumSize ||
+               dest->width > c_maximumSize || src->width * channels > INT_MAX) {
+        return kvImageInvalidParameter;
+    } else if ((src->height == 0 || src->width == 0) && dest->height != 0 && dest->width != 0) {
+        return kvImageInvalidParameter;
+    }
+
+    if (dest->height == 0 || dest->width == 0) {
+        return (flags & kvImageGetTempBufferSize) ? 0 : kvImageNoError;
+    }
+
+    const ScaleLayout layout(src, dest, channels, flags);
+    if (flags & kvImageGetTempBufferSize) {
+        return layout.size;
+    }
+
+    std::unique_ptr<uint8_t[]> allocated;
+    if (tempBuffer == nullptr) {
+        allocated.reset(new (std::nothrow) uint8_t[layout.size]);
+        if (allocated == nullptr) {
+            return kvImageMemoryAllocationError;
+        }
+        tempBuffer = allocated.get();
+    }
+    uint8_t* temp = reinterpret_cast<uint8_t*>(roundUpToCacheLine(reinterpret_cast<uintptr_t>(tempBuffer)));
+
+    const int radius = (flags & kvImageHighQualityResampling) ? 5 : 3;
+    const vDSP_Length rowTaps = layout.rowTaps;
+    const vDSP_Length columnTaps = layout.columnTaps;
+    int32_t* rowIndex = reinterpret_cast<int32_t*>(temp + layout.rowIndex);
+    float* rowWeight = reinterpret_cast<float*>(temp + layout.rowWeight);
+    for (vImagePixelCount y = 0; y < dest->height; ++y) {
+        lanczosWeights(src->height, dest->height, radius, rowTaps, y, rowIndex + y * rowTaps, rowWeight + y * rowTaps, 1);
+    }
+
+    const size_t srcElements = src->width * channels;
+    const size_t destElements = dest->width * channels;
+    int32_t* columnIndex = reinterpret_cast<int32_t*>(temp + layout.columnIndex);
+    float* columnWeight = reinterpret_cast<float*>(temp + layout.columnWeight);
+    for (vImagePixelCount x = 0; x < dest->width; ++x) {
+        int32_t* index = columnIndex + x * channels;
+        float* weight = columnWeight + x * channels;
+        lanczosWeights(src->width, dest->width, radius, columnTaps, x, index, weight, destElements);
+        for (vDSP_Length k = 0; k < columnTaps; ++k) {
+            index[k * destElements] *= static_cast<int32_t>(channels);
+            for (size_t c = 1; c < channels; ++c) {
+                index[k * destElements + c] = index[k * destElements] + static_cast<int32_t>(c);
+                weight[k * destElements + c] = weight[k * destElements];
+            }
+        }
+    }
+
+    const vImageKernelSet& kernels = vDSPGetKernels().image;
+    const uint8_t* srcData = static_cast<const uint8_t*>(src->data);
+    uint8_t* destData = static_cast<uint8_t*>(dest->data);
+    const size_t threads = layout.threads;
+    AccelerateParallelFor(threads, 1, [&](size_t begin, size_t end) {
+        for (size_t thread = begin; thread < end; ++thread) {
+            uint8_t* scratch = temp + layout.columnWeight + roundUpToCacheLine(columnTaps * destElements * sizeof(float)) +
+                               thread * layout.perThread;
+            const uint8_t** rows = reinterpret_cast<const uint8_t**>(scratch);
+            float* line = reinterpret_cast<float*>(scratch + roundUpToCacheLine(rowTaps * sizeof(const uint8_t*)));
+
+            for (vImagePixelCount y = dest->height * thread / threads; y < dest->height * (thread + 1) / threads; ++y) {
+                const float* weights = rowWeight + y * rowTaps;
+                for (vDSP_Length k = 0; k < rowTaps; ++k) {
+                    rows[k] = srcData + rowIndex[y * rowTaps + k] * src->rowBytes;
+                }
+                for (size_t i = kernels.scaleRows(rows, weights, rowTaps, line, srcElements); i < srcElements; ++i) {
+                    float sum = 0;
+                    for (vDSP_Length k = 0; k < rowTaps; ++k) {
+                        sum += weights[k] * static_cast<float>(rows[k][i]);
+                    }
+                    line[i] = sum;
+                }
+
+                uint8_t* out = destData + y * dest->rowBytes;
+                for (size_t j = kernels.scaleColumns(line, columnIndex, columnWeight, columnTaps, out, destElements); j < destElements;
+                     ++j) {
+                    float sum = 0;
+                    for (vDSP_Length k = 0; k < columnTaps; ++k) {
+                        sum += line[columnIndex[k * destElements + j]] * columnWeight[k * destElements + j];
+                    }
+                    out[j] = static_cast<uint8_t>(std::min(std::max(sum, 0.0f), 255.0f) + 0.5f);
+                }
+            }
+        }
+    });
+    return kvImageNoError;
+}
+
+struct Pixel1 {
+    uint8_t value[1];
+};
+
+struct Pixel4 {
+    uint8_t value[4];
+};
+
+// Rotates src by rotation quarter turns counterclockwise into the middle of dest, filling whatever it leaves uncovered
+// with background.
+template <typename Pixel>
+vImage_Error rotate90(const vImage_Buffer* src, const vImage_Buffer* dest, uint8_t rotation, Pixel background, vImage_Flags flags) {
+    if (src == nullptr || dest == nullptr || src->data == nullptr || dest->data == nullptr) {
+        return kvImageNullPointerArgument;
+    } else if (rotation > 3) {
+        return kvImageInvalidParameter;
+    } else if (src->height > c_maximumSize || src->width > c_maximumSize || dest->height > c_maximumSize ||
+               dest->width > c_maximumSize) {
+        return kvImageInvalidParameter;
+    }
+
+    const ptrdiff_t width = src->width;
+    const ptrdiff_t height = src->height;
+    const ptrdiff_t rotatedWidth = (rotation & 1) ? height : width;
+    const ptrdiff_t rotatedHeight = (rotation & 1) ? width : height;
+    const ptrdiff_t left = (static_cast<ptrdiff_t>(dest->width) - rotatedWidth) / 2;
+    const ptrdiff_t top = (static_cast<ptrdiff_t>(dest->height) - rotatedHeight) / 2;
+    const uint8_t* srcData = static_cast<const uint8_t*>(src->data);
+    uint8_t* destData = static_cast<uint8_t*>(dest->data);
+
+    // The source pixel of the rotated image's pixel (rx, ry) is origin + rx * stepX + ry * stepY bytes into src.
+    const ptrdiff_t pixel = sizeof(Pixel);
+    const ptrdiff_t rowBytes = src->rowBytes;
+    const ptrdiff_t origins[] = { 0, (width - 1) * pixel, (height - 1) * rowBytes + (width - 1) * pixel, (height - 1) * rowBytes };
+    const ptrdiff_t stepsX[] = { pixel, rowBytes, -pixel, -rowBytes };
+    const ptrdiff_t stepsY[] = { rowBytes, -pixel, -rowBytes, pixel };
+    const ptrdiff_t origin = origins[rotation];
+    const ptrdiff_t stepX = stepsX[rotation];
+    const ptrdiff_t stepY = stepsY[rotation];
+
+    const vImagePixelCount bands = (dest->height + c_rotateTileHeight - 1) / c_rotateTileHeight;
+    const size_t bandWork = c_rotateTileHeight * dest->width;
+    const size_t minimumBands = (flags & kvImageDoNotTile) ? bands : c_parallelWork / std::max<size_t>(bandWork, 1);
+    AccelerateParallelFor(bands, minimumBands, [&](size_t begin, size_t end) {
+        for (vImagePixelCount tileTop = begin * c_rotateTileHeight; tileTop < std::min(end * c_rotateTileHeight, dest->height);
+             tileTop += c_rotateTileHeight) {
+            const vImagePixelCount tileBottom = std::min(tileTop + c_rotateTileHeight, dest->height);
+            for (vImagePixelCount tileLeft = 0; tileLeft < dest->width; tileLeft += c_rotateTileWidth) {
+                const vImagePixelCount tileRight = std::min(tileLeft + c_rotateTileWidth, dest->width);
+                for (vImagePixelCount y = tileTop; y < tileBottom; ++y) {
+                    Pixel* out = reinterpret_cast<Pixel*>(destData + y * dest->rowBytes);
+                    const ptrdiff_t ry = static_cast<ptrdiff_t>(y) - top;
+                    ptrdiff_t coveredLeft = static_cast<ptrdiff_t>(tileLeft);
+                    ptrdiff_t coveredRight = coveredLeft;
+                    if (ry >= 0 && ry < rotatedHeight) {
+                        coveredLeft = std::min(std::max(coveredLeft, left), static_cast<ptrdiff_t>(tileRight));
+                        coveredRight = std::max(coveredLeft, std::min(static_cast<ptrdiff_t>(tileRight), left + rotatedWidth));
+                    }
+
+                    std::fill(out + tileLeft, out + coveredLeft, background);
+                    if (coveredLeft < coveredRight) {
+                        const uint8_t* in = srcData + origin + (coveredLeft - left) * stepX + ry * stepY;
+                        for (ptrdiff_t x = coveredLeft; x < coveredRight; ++x, in += stepX) {
+                            out[x] = *reinterpret_cast<const Pixel*>(in);
+                        }
+                    }
+                    std::fill(out + coveredRight, out + tileRight, background);
+                }
+            }
+        }
+    });
+    return kvImageNoError;
+}
+
+// Mirrors src left to right into dest, which may be src. Each row swaps its pixels from the two ends inwards.
+template <typename Pixel>
+vImage_Error horizontalReflect(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    if (src == nullptr || dest == nullptr || src->data == nullptr || dest->data == nullptr) {
+        return kvImageNullPointerArgument;
+    } else if (src->height != dest->height || src->width != dest->width) {
+        return kvImageBufferSizeMismatch;
+    }
+
+    const vImageKernelSet& kernels = vDSPGetKernels().image;
+    const uint8_t* srcData = static_cast<const uint8_t*>(src->data);
+    uint8_t* destData = static_cast<uint8_t*>(dest->data);
+    const vImagePixelCount width = src->width;
+    const size_t minimumRows = (flags & kvImageDoNotTile) ? src->height : c_parallelWork / std::max<size_t>(width, 1);
+    AccelerateParallelFor(src->height, minimumRows, [&](size_t begin, size_t end) {
+        for (vImagePixelCount y = begin; y < end; ++y) {
+            const uint8_t* in = srcData + y * src->rowBytes;
+            uint8_t* out = destData + y * dest->rowBytes;
+            vImagePixelCount i = (sizeof(Pixel) == 4) ? kernels.reflect32(in, out, width) : 0;
+            for (; 2 * i < width; ++i) {
+                Pixel left;
+                Pixel right;
+                memcpy(&left, in + i * sizeof(Pixel), sizeof(Pixel));
+                memcpy(&right, in + (width - 1 - i) * sizeof(Pixel), sizeof(Pixel));
+                memcpy(out + i * sizeof(Pixel), &right, sizeof(Pixel));
+                memcpy(out + (width - 1 - i) * sizeof(Pixel), &left, sizeof(Pixel));
+            }
+        }
+    });
+    return kvImageNoError;
+}
+
+} // namespace
+
+/**
+@Status Caveat
+@Notes Lanczos-3 resampling, or Lanczos-5 with kvImageHighQualityResampling. Samples past the edges of src are taken
+       from the edges whatever the flags.
+*/
+vImage_Error vImageScale_ARGB8888(const vImage_Buffer* src, const vImage_Buffer* dest, void* tempBuffer, vImage_Flags flags) {
+    return scale(src, dest, tempBuffer, 4, flags);
+}
+
+/**
+@Status Caveat
+@Notes Lanczos-3 resampling, or Lanczos-5 with kvImageHighQualityResampling. Samples past the edges of src are taken
+       from the edges whatever the flags.
+*/
+vImage_Error vImageScale_Planar8(const vImage_Buffer* src, const vImage_Buffer* dest, void* tempBuffer, vImage_Flags flags) {
+    return scale(src, dest, tempBuffer, 1, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageRotate90_ARGB8888(
+    const vImage_Buffer* src, const vImage_Buffer* dest, uint8_t rotationConstant, const Pixel_8888 backColor, vImage_Flags flags) {
+    if (backColor == nullptr) {
+        return kvImageNullPointerArgument;
+    }
+    Pixel4 background;
+    memcpy(background.value, backColor, sizeof(background.value));
+    return rotate90(src, dest, rotationConstant, background, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageRotate90_Planar8(
+    const vImage_Buffer* src, const vImage_Buffer* dest, uint8_t rotationConstant, Pixel_8 backColor, vImage_Flags flags) {
+    Pixel1 background = { { backColor } };
+    return rotate90(src, dest, rotationConstant, background, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageHorizontalReflect_ARGB8888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    return horizontalReflect<Pixel4>(src, dest, flags);
+}
+
+/**
+@Status Interoperable
+*/
+vImage_Error vImageHorizontalReflect_Planar8(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags) {
+    return horizontalReflect<Pixel1>(src, dest, flags);
+}
@@ -827,6 +827,253 @@ CF_PRIVATE void _CFAllocatorDeallocateGC(CFAllocatorRef allocator, void *ptr)
 
 // -------- -------- -------- -------- -------- -------- -------- --------
 
+/* Arena allocators. Each thread has a bump allocator which carves blocks out of large chunks, and which callers pass
+   explicitly for the duration of a scope; the default allocator is left alone. Deallocating a block is a no-op; the
+   chunks are reset in bulk when the scope ends, provided nothing created in the scope is still alive. CF objects keep a
+   reference to their allocator, so objects that outlive their scope keep the arena, and its chunks, alive until the
+   last of them is deallocated. Memory obtained directly from the arena must be deallocated before the scope ends.
+*/
+
+#define __kCFArenaChunkSize (64 * 1024)
+#define __kCFArenaAlignment 16
+#define __kCFArenaLargeBlockSize (__kCFArenaChunkSize / 4)
+#define __kCFArenaMaximumIdleChunks 16
+
+CF_INLINE CFIndex __CFArenaRound(CFIndex size) {
+    return (size + __kCFArenaAlignment - 1) & ~(CFIndex)(__kCFArenaAlignment - 1);
+}
+
+typedef struct __CFArenaChunk {
+    struct __CFArenaChunk *next;
+    uint8_t *cursor;
+    uint8_t *last;  // the most recently allocated block, which can be resized in place
+    uint8_t *end;
+} __CFArenaChunk;
+
+// Each block is preceded by its size, padded to keep the block aligned.
+#define __kCFArenaChunkHeaderSize __CFArenaRound(sizeof(__CFArenaChunk))
+#define __kCFArenaBlockHeaderSize __kCFArenaAlignment
+
+CF_INLINE uint8_t *__CFArenaChunkStart(__CFArenaChunk *chunk) {
+    return (uint8_t *)chunk + __kCFArenaChunkHeaderSize;
+}
+
+CF_INLINE CFIndex *__CFArenaBlockSize(void *ptr) {
+    return (CFIndex *)((uint8_t *)ptr - __kCFArenaBlockHeaderSize);
+}
+
+typedef struct __CFThreadArenas __CFThreadArenas;
+
+typedef struct {
+    __CFThreadArenas *owner;    // NULL once the arena outlived its scope; only the owner thread allocates from chunks
+    __CFArenaChunk *chunks;
+    __CFArenaChunk *current;
+    _CFArenaStatistics statistics;
+} __CFArena;
+
+struct __CFThreadArenas {
+    CFIndex depth;
+    CFAllocatorRef arena;       // in scope when depth > 0, otherwise idle
+    _CFArenaStatistics totals;
+};
+
+CF_INLINE Boolean __CFArenaIsOwnedByCurrentThread(__CFArena *arena) {
+    return arena->owner && arena->owner == (__CFThreadArenas *)_CFGetTSD(__CFTSDKeyArena);
+}
+
+static Boolean __CFArenaContains(__CFArena *arena, const void *ptr) {
+    for (__CFArenaChunk *chunk = arena->chunks; chunk; chunk = chunk->next) {
+        if (__CFArenaChunkStart(chunk) < (uint8_t *)ptr && (uint8_t *)ptr < chunk->end) return true;
+    }
+    return false;
+}
+
+static __CFArenaChunk *__CFArenaNextChunk(__CFArena *arena) {
+    __CFArenaChunk *chunk = arena->current ? arena->current->next : arena->chunks;
+    if (!chunk) {
+        chunk = (__CFArenaChunk *)CFAllocatorAllocate(kCFAllocatorSystemDefault, __kCFArenaChunkSize, 0);
+        if (!chunk) return NULL;
+        chunk->next = NULL;
+        chunk->end = (uint8_t *)chunk + __kCFArenaChunkSize;
+        // Other threads may be walking the list to deallocate blocks, so the chunk is linked in only once it is set up.
+        if (arena->current) {
+            arena->current->next = chunk;
+        } else {
+            arena->chunks = chunk;
+        }
+        arena->statistics.chunks++;
+    }
+    chunk->cursor = __CFArenaChunkStart(chunk);
+    chunk->last = NULL;
+    arena->current = chunk;
+    return chunk;
+}
+
+static void *__CFArenaAllocate(CFIndex size, CFOptionFlags hint, void *info) {
+    __CFArena *arena = (__CFArena *)info;
+    if (!__CFArenaIsOwnedByCurrentThread(arena)) {
+        return CFAllocatorAllocate(kCFAllocatorSystemDefault, size, hint);
+    }
+    if (__kCFArenaLargeBlockSize < size) {
+        arena->statistics.fallbackAllocations++;
+        return CFAllocatorAllocate(kCFAllocatorSystemDefault, size, hint);
+    }
+    CFIndex needed = __kCFArenaBlockHeaderSize + __CFArenaRound(size);
+    __CFArenaChunk *chunk = arena->current;
+    if (!chunk || chunk->end - chunk->cursor < needed) {
+        chunk = __CFArenaNextChunk(arena);
+        if (!chunk) return NULL;
+    }
+    uint8_t *block = chunk->cursor + __kCFArenaBlockHeaderSize;
+    *__CFArenaBlockSize(block) = size;
+    chunk->cursor += needed;
+    chunk->last = block;
+    arena->statistics.allocations++;
+    arena->statistics.allocatedBytes += size;
+    return block;
+}
+
+static void *__CFArenaReallocate(void *ptr, CFIndex newsize, CFOptionFlags hint, void *info) {
+    __CFArena *arena = (__CFArena *)info;
+    if (!__CFArenaContains(arena, ptr)) {
+        return CFAllocatorReallocate(kCFAllocatorSystemDefault, ptr, newsize, hint);
+    }
+    CFIndex size = *__CFArenaBlockSize(ptr);
+    if (newsize <= size) return ptr;
+    if (__CFArenaIsOwnedByCurrentThread(arena) && newsize <= __kCFArenaLargeBlockSize) {
+        __CFArenaChunk *chunk = arena->current;
+        if (chunk && chunk->last == ptr && __CFArenaRound(newsize) <= chunk->end - (uint8_t *)ptr) {
+            chunk->cursor = (uint8_t *)ptr + __CFArenaRound(newsize);
+            *__CFArenaBlockSize(ptr) = newsize;
+            arena->statistics.allocatedBytes += newsize - size;
+            return ptr;
+        }
+    }
+    void *newptr = __CFArenaAllocate(newsize, hint, info);
+    if (newptr) memmove(newptr, ptr, size);
+    return newptr;
+}
+
+static void __CFArenaDeallocate(void *ptr, void *info) {
+    __CFArena *arena = (__CFArena *)info;
+    if (__CFArenaContains(arena, ptr)) {
+        if (__CFArenaIsOwnedByCurrentThread(arena)) arena->statistics.deallocations++;
+        return;
+    }
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, ptr);
+}
+
+// Called once the allocator itself is deallocated, which is after every object created from it.
+static void __CFArenaRelease(const void *info) {
+    __CFArena *arena = (__CFArena *)info;
+    __CFArenaChunk *chunk = arena->chunks;
+    while (chunk) {
+        __CFArenaChunk *next = chunk->next;
+        CFAllocatorDeallocate(kCFAllocatorSystemDefault, chunk);
+        chunk = next;
+    }
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, arena);
+}
+
+static CFAllocatorRef __CFArenaCreate(__CFThreadArenas *owner) {
+    __CFArena *arena = (__CFArena *)CFAllocatorAllocate(kCFAllocatorSystemDefault, sizeof(__CFArena), 0);
+    if (!arena) return NULL;
+    memset(arena, 0, sizeof(__CFArena));
+    arena->owner = owner;
+    CFAllocatorContext context = {0, arena, NULL, __CFArenaRelease, NULL, __CFArenaAllocate, __CFArenaReallocate, __CFArenaDeallocate, NULL};
+    CFAllocatorRef allocator = CFAllocatorCreate(kCFAllocatorSystemDefault, &context);
+    if (!allocator) CFAllocatorDeallocate(kCFAllocatorSystemDefault, arena);
+    return allocator;
+}
+
+// Rewinds the arena to its first chunk, keeping a few chunks around for the next scope.
+static void __CFArenaReset(__CFArena *arena) {
+    CFIndex kept = 0;
+    for (__CFArenaChunk *chunk = arena->chunks; chunk; chunk = chunk->next) {
+        if (++kept == __kCFArenaMaximumIdleChunks) {
+            __CFArenaChunk *extra = chunk->next;
+            chunk->next = NULL;
+            while (extra) {
+                __CFArenaChunk *next = extra->next;
+                CFAllocatorDeallocate(kCFAllocatorSystemDefault, extra);
+                extra = next;
+            }
+            break;
+        }
+    }
+    arena->current = NULL;
+}
+
+static void __CFArenaAddStatistics(_CFArenaStatistics *total, const _CFArenaStatistics *statistics) {
+    total->allocations += statistics->allocations;
+    total->allocatedBytes += statistics->allocatedBytes;
+    total->fallbackAllocations += statistics->fallbackAllocations;
+    total->deallocations += statistics->deallocations;
+    total->chunks += statistics->chunks;
+    total->resets += statistics->resets;
+    total->retainedScopes += statistics->retainedScopes;
+}
+
+static void __CFThreadArenasDestroy(void *value) {
+    __CFThreadArenas *arenas = (__CFThreadArenas *)value;
+    if (arenas->arena) {
+        ((__CFArena *)arenas->arena->_context.info)->owner = NULL;
+        CFRelease(arenas->arena);
+    }
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, arenas);
+}
+
+CFAllocatorRef _CFArenaScopeBegin(void) {
+    __CFThreadArenas *arenas = (__CFThreadArenas *)_CFGetTSD(__CFTSDKeyArena);
+    if (!arenas) {
+        arenas = (__CFThreadArenas *)CFAllocatorAllocate(kCFAllocatorSystemDefault, sizeof(__CFThreadArenas), 0);
+        if (!arenas) HALT;
+        memset(arenas, 0, sizeof(__CFThreadArenas));
+        _CFSetTSD(__CFTSDKeyArena, arenas, __CFThreadArenasDestroy);
+    }
+    // Nested scopes share the outermost arena.
+    if (0 < arenas->depth++) return arenas->arena;
+    if (!arenas->arena) {
+        arenas->arena = __CFArenaCreate(arenas);
+        if (!arenas->arena) HALT;
+    }
+    return arenas->arena;
+}
+
+void _CFArenaScopeEnd(void) {
+    __CFThreadArenas *arenas = (__CFThreadArenas *)_CFGetTSD(__CFTSDKeyArena);
+    if (!arenas || arenas->depth <= 0) {
+        CFLog(kCFLogLevelWarning, CFSTR("_CFArenaScopeEnd() called without a matching _CFArenaScopeBegin()"));
+        return;
+    }
+    if (0 < --arenas->depth) return;
+
+    CFAllocatorRef allocator = arenas->arena;
+    __CFArena *arena = (__CFArena *)allocator->_context.info;
+    if (1 == CFGetRetainCount(allocator)) {
+        __CFArenaReset(arena);
+        arena->statistics.resets++;
+    } else {
+        // Objects created in the scope are still alive; they own the arena from now on, and release it when they die.
+        arena->owner = NULL;
+        arena->statistics.retainedScopes++;
+        arenas->arena = NULL;
+    }
+    __CFArenaAddStatistics(&arenas->totals, &arena->statistics);
+    memset(&arena->statistics, 0, sizeof(_CFArenaStatistics));
+    if (!arenas->arena) CFRelease(allocator);
+}
+
+void _CFArenaGetStatistics(_CFArenaStatistics *statistics) {
+    memset(statistics, 0, sizeof(_CFArenaStatistics));
+    __CFThreadArenas *arenas = (__CFThreadArenas *)_CFGetTSD(__CFTSDKeyArena);
+    if (!arenas) return;
+    __CFArenaAddStatistics(statistics, &arenas->totals);
+    if (arenas->arena) __CFArenaAddStatistics(statistics, &((__CFArena *)arenas->arena->_context.info)->statistics);
+}
+
+// -------- -------- -------- -------- -------- -------- -------- --------
+
 
 CFRange __CFRangeMake(CFIndex loc, CFIndex len) {
     CFRange range;
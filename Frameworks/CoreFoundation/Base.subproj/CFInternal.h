@@ -254,6 +254,7 @@ enum {
         __CFTSDKeyMachMessageBoost = 12, // valid only in the context of a CFMachPort callout
         __CFTSDKeyMachMessageHasVoucher = 13,
         __CFTSDKeyWeakReferenceHandler = 14,
+    __CFTSDKeyArena = 15,
     // autorelease pool stuff must be higher than run loop constants
     __CFTSDKeyAutoreleaseData2 = 61,
     __CFTSDKeyAutoreleaseData1 = 62,
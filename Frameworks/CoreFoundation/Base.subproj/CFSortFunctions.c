@@ -24,11 +24,6 @@
 #endif
 #endif
 
-enum {
-    kCFSortConcurrent = (1 << 0),
-    kCFSortStable = (1 << 4),
-};
-
 typedef CFIndex VALUE_TYPE;
 typedef CFIndex INDEX_TYPE;
 typedef CFComparisonResult CMP_RESULT_TYPE;
@@ -122,9 +117,202 @@ static void __CFSimpleMergeSort(VALUE_TYPE listp[], INDEX_TYPE cnt, VALUE_TYPE t
     }
 }
 
-#if __HAS_DISPATCH__
-// Excluded from linux for dispatch dependency
+/* Pattern-defeating quicksort, after "Pattern-defeating Quicksort", Orson R. L. Peters.
+   Used for sorts that need not be stable: it sorts in place without a temporary buffer,
+   finishes sorted, reversed and other patterned inputs in about linear time, and falls back
+   to heapsort when partitioning keeps going badly, so it is never worse than O(n log n).
+*/
+enum {
+    __kCFSortInsertionThreshold = 24,
+    __kCFSortNintherThreshold = 128,
+    __kCFSortPartialInsertionLimit = 8,
+};
+
+CF_INLINE void __CFSortSwap(VALUE_TYPE *a, VALUE_TYPE *b) {
+    VALUE_TYPE t = *a;
+    *a = *b;
+    *b = t;
+}
+
+CF_INLINE void __CFSortTwo(VALUE_TYPE *a, VALUE_TYPE *b, COMPARATOR_BLOCK cmp) {
+    if (cmp(*b, *a) < 0) __CFSortSwap(a, b);
+}
+
+CF_INLINE void __CFSortThree(VALUE_TYPE *a, VALUE_TYPE *b, VALUE_TYPE *c, COMPARATOR_BLOCK cmp) {
+    __CFSortTwo(a, b, cmp);
+    __CFSortTwo(b, c, cmp);
+    __CFSortTwo(a, b, cmp);
+}
+
+// if unguarded, an element no larger than any in the list must sit just before it
+static void __CFInsertionSort(VALUE_TYPE *begin, VALUE_TYPE *end, Boolean unguarded, COMPARATOR_BLOCK cmp) {
+    if (begin == end) return;
+    for (VALUE_TYPE *cur = begin + 1; cur != end; cur++) {
+        VALUE_TYPE *sift = cur, *sift_1 = cur - 1;
+        if (cmp(*sift, *sift_1) < 0) {
+            VALUE_TYPE v = *sift;
+            do {
+                *sift-- = *sift_1;
+            } while ((unguarded || sift != begin) && cmp(v, *--sift_1) < 0);
+            *sift = v;
+        }
+    }
+}
+
+// gives up, returning false, once more than a few elements have had to move
+static Boolean __CFPartialInsertionSort(VALUE_TYPE *begin, VALUE_TYPE *end, COMPARATOR_BLOCK cmp) {
+    if (begin == end) return true;
+    INDEX_TYPE moved = 0;
+    for (VALUE_TYPE *cur = begin + 1; cur != end; cur++) {
+        VALUE_TYPE *sift = cur, *sift_1 = cur - 1;
+        if (cmp(*sift, *sift_1) < 0) {
+            VALUE_TYPE v = *sift;
+            do {
+                *sift-- = *sift_1;
+            } while (sift != begin && cmp(v, *--sift_1) < 0);
+            *sift = v;
+            moved += cur - sift;
+        }
+        if (__kCFSortPartialInsertionLimit < moved) return false;
+    }
+    return true;
+}
+
+static void __CFHeapSort(VALUE_TYPE *listp, INDEX_TYPE cnt, COMPARATOR_BLOCK cmp) {
+    for (INDEX_TYPE start = cnt / 2; 0 < start--;) {
+        for (INDEX_TYPE root = start, child; (child = 2 * root + 1) < cnt; root = child) {
+            if (child + 1 < cnt && cmp(listp[child], listp[child + 1]) < 0) child++;
+            if (cmp(listp[root], listp[child]) >= 0) break;
+            __CFSortSwap(listp + root, listp + child);
+        }
+    }
+    for (INDEX_TYPE end = cnt - 1; 0 < end; end--) {
+        __CFSortSwap(listp, listp + end);
+        for (INDEX_TYPE root = 0, child; (child = 2 * root + 1) < end; root = child) {
+            if (child + 1 < end && cmp(listp[child], listp[child + 1]) < 0) child++;
+            if (cmp(listp[root], listp[child]) >= 0) break;
+            __CFSortSwap(listp + root, listp + child);
+        }
+    }
+}
+
+// partitions around the pivot at *begin, putting elements equal to it on the right; returns where the pivot ends up
+static VALUE_TYPE *__CFPartitionRight(VALUE_TYPE *begin, VALUE_TYPE *end, Boolean *alreadyPartitioned, COMPARATOR_BLOCK cmp) {
+    VALUE_TYPE pivot = *begin;
+    VALUE_TYPE *first = begin, *last = end;
+    // the median-of-3 pivot selection leaves an element no smaller than the pivot at the end
+    while (cmp(*++first, pivot) < 0);
+    if (first - 1 == begin) {
+        while (first < last && cmp(*--last, pivot) >= 0);
+    } else {
+        while (cmp(*--last, pivot) >= 0);
+    }
+    *alreadyPartitioned = (last <= first);
+    while (first < last) {
+        __CFSortSwap(first, last);
+        while (cmp(*++first, pivot) < 0);
+        while (cmp(*--last, pivot) >= 0);
+    }
+    VALUE_TYPE *pivotp = first - 1;
+    *begin = *pivotp;
+    *pivotp = pivot;
+    return pivotp;
+}
+
+// partitions around the pivot at *begin, putting elements equal to it on the left; used when many elements are equal
+static VALUE_TYPE *__CFPartitionLeft(VALUE_TYPE *begin, VALUE_TYPE *end, COMPARATOR_BLOCK cmp) {
+    VALUE_TYPE pivot = *begin;
+    VALUE_TYPE *first = begin, *last = end;
+    while (cmp(pivot, *--last) < 0);
+    if (last + 1 == end) {
+        while (first < last && cmp(pivot, *++first) >= 0);
+    } else {
+        while (cmp(pivot, *++first) >= 0);
+    }
+    while (first < last) {
+        __CFSortSwap(first, last);
+        while (cmp(pivot, *--last) < 0);
+        while (cmp(pivot, *++first) >= 0);
+    }
+    *begin = *last;
+    *last = pivot;
+    return last;
+}
+
+// swaps a few elements of a side that came out too small, to break up whatever pattern caused it
+static void __CFBreakPatterns(VALUE_TYPE *begin, VALUE_TYPE *end) {
+    INDEX_TYPE cnt = end - begin;
+    if (cnt < __kCFSortInsertionThreshold) return;
+    INDEX_TYPE q = cnt / 4;
+    __CFSortSwap(begin, begin + q);
+    __CFSortSwap(end - 1, end - q);
+    if (__kCFSortNintherThreshold < cnt) {
+        __CFSortSwap(begin + 1, begin + (q + 1));
+        __CFSortSwap(begin + 2, begin + (q + 2));
+        __CFSortSwap(end - 2, end - (q + 1));
+        __CFSortSwap(end - 3, end - (q + 2));
+    }
+}
+
+// if !leftmost, the element just before begin is no larger than any element in the list
+static void __CFPatternDefeatingSort(VALUE_TYPE *begin, VALUE_TYPE *end, int32_t badAllowed, Boolean leftmost, COMPARATOR_BLOCK cmp) {
+    for (;;) {
+        INDEX_TYPE cnt = end - begin;
+        if (cnt < __kCFSortInsertionThreshold) {
+            __CFInsertionSort(begin, end, !leftmost, cmp);
+            return;
+        }
 
+        INDEX_TYPE half_cnt = cnt / 2;
+        if (__kCFSortNintherThreshold < cnt) {
+            __CFSortThree(begin, begin + half_cnt, end - 1, cmp);
+            __CFSortThree(begin + 1, begin + (half_cnt - 1), end - 2, cmp);
+            __CFSortThree(begin + 2, begin + (half_cnt + 1), end - 3, cmp);
+            __CFSortThree(begin + (half_cnt - 1), begin + half_cnt, begin + (half_cnt + 1), cmp);
+            __CFSortSwap(begin, begin + half_cnt);
+        } else {
+            __CFSortThree(begin + half_cnt, begin, end - 1, cmp);
+        }
+
+        // the pivot equals the element before the list, so nothing here is smaller; peel off the run of equal elements
+        if (!leftmost && cmp(*(begin - 1), *begin) >= 0) {
+            begin = __CFPartitionLeft(begin, end, cmp) + 1;
+            continue;
+        }
+
+        Boolean alreadyPartitioned = false;
+        VALUE_TYPE *pivotp = __CFPartitionRight(begin, end, &alreadyPartitioned, cmp);
+        INDEX_TYPE left_cnt = pivotp - begin, right_cnt = end - (pivotp + 1);
+        if (left_cnt < cnt / 8 || right_cnt < cnt / 8) {
+            if (--badAllowed == 0) {
+                __CFHeapSort(begin, cnt, cmp);
+                return;
+            }
+            __CFBreakPatterns(begin, pivotp);
+            __CFBreakPatterns(pivotp + 1, end);
+        } else if (alreadyPartitioned && __CFPartialInsertionSort(begin, pivotp, cmp) && __CFPartialInsertionSort(pivotp + 1, end, cmp)) {
+            return;
+        }
+
+        // recurse into the smaller side and loop on the larger, to bound the stack depth
+        if (left_cnt < right_cnt) {
+            __CFPatternDefeatingSort(begin, pivotp, badAllowed, leftmost, cmp);
+            begin = pivotp + 1;
+            leftmost = false;
+        } else {
+            __CFPatternDefeatingSort(pivotp + 1, end, badAllowed, false, cmp);
+            end = pivotp;
+        }
+    }
+}
+
+static void __CFUnstableSort(VALUE_TYPE listp[], INDEX_TYPE cnt, COMPARATOR_BLOCK cmp) {
+    int32_t badAllowed = 1;
+    for (INDEX_TYPE n = cnt; 1 < n; n >>= 1) badAllowed++;
+    __CFPatternDefeatingSort(listp, listp + cnt, badAllowed, true, cmp);
+}
+
+#if __HAS_DISPATCH__
 // if !right, put the cnt1 smallest values in tmp, else put the cnt2 largest values in tmp
 static void __CFSortIndexesNMerge(VALUE_TYPE listp1[], INDEX_TYPE cnt1, VALUE_TYPE listp2[], INDEX_TYPE cnt2, VALUE_TYPE tmp[], size_t right, COMPARATOR_BLOCK cmp) {
     // if the last element of listp1 <= the first of listp2, lists are already ordered
@@ -240,15 +428,14 @@ static void __CFSortIndexesN(VALUE_TYPE listp[], INDEX_TYPE count, int32_t ncore
 }
 #endif
 
-// fills an array of indexes (of length count) giving the indexes 0 - count-1, as sorted by the comparator block
-void CFSortIndexes(CFIndex *indexBuffer, CFIndex count, CFOptionFlags opts, CFComparisonResult (^cmp)(CFIndex, CFIndex)) {
-    if (count < 1) return;
-    if (INTPTR_MAX / sizeof(CFIndex) < count) return;
+// sorts a list of values in place, by the comparator block
+static void __CFSortValues(VALUE_TYPE *listp, CFIndex count, CFOptionFlags opts, COMPARATOR_BLOCK cmp) {
     int32_t ncores = 0;
     if (opts & kCFSortConcurrent) {
         ncores = __CFActiveProcessorCount();
         if (count < 160 || ncores < 2) {
-            opts = (opts & ~kCFSortConcurrent);
+            // concurrent sorts are stable, so keep to that when sorting serially
+            opts = (opts & ~kCFSortConcurrent) | kCFSortStable;
         } else if (count < 640 && 2 < ncores) {
             ncores = 2;
         } else if (count < 3200 && 4 < ncores) {
@@ -260,6 +447,31 @@ void CFSortIndexes(CFIndex *indexBuffer, CFIndex count, CFOptionFlags opts, CFCo
             ncores = 16;
         }
     }
+#if __HAS_DISPATCH__
+    if (opts & kCFSortConcurrent) {
+        __CFSortIndexesN(listp, count, ncores, cmp); // naturally stable
+        return;
+    }
+#else
+    if (opts & kCFSortConcurrent) {
+        // without libdispatch, concurrent sorts run serially but are still stable
+        opts = (opts & ~kCFSortConcurrent) | kCFSortStable;
+    }
+#endif
+    if (!(opts & kCFSortStable)) {
+        __CFUnstableSort(listp, count, cmp);
+        return;
+    }
+    STACK_BUFFER_DECL(VALUE_TYPE, local, count <= 4096 ? count : 1);
+    VALUE_TYPE *tmp = (count <= 4096) ? local : (VALUE_TYPE *)malloc(count * sizeof(VALUE_TYPE));
+    __CFSimpleMergeSort(listp, count, tmp, cmp); // naturally stable
+    if (local != tmp) free(tmp);
+}
+
+// fills an array of indexes (of length count) giving the indexes 0 - count-1, as sorted by the comparator block
+void CFSortIndexes(CFIndex *indexBuffer, CFIndex count, CFOptionFlags opts, CFComparisonResult (^cmp)(CFIndex, CFIndex)) {
+    if (count < 1) return;
+    if (INTPTR_MAX / sizeof(CFIndex) < count) return;
 #if __HAS_DISPATCH__
     if (count <= 65536) {
         for (CFIndex idx = 0; idx < count; idx++) indexBuffer[idx] = idx;
@@ -274,34 +486,24 @@ void CFSortIndexes(CFIndex *indexBuffer, CFIndex count, CFOptionFlags opts, CFCo
 #else
     for (CFIndex idx = 0; idx < count; idx++) indexBuffer[idx] = idx;
 #endif
-#if __HAS_DISPATCH__
-    if (opts & kCFSortConcurrent) {
-        __CFSortIndexesN(indexBuffer, count, ncores, cmp); // naturally stable
-        return;
-    }
-#endif
-    STACK_BUFFER_DECL(VALUE_TYPE, local, count <= 4096 ? count : 1);
-    VALUE_TYPE *tmp = (count <= 4096) ? local : (VALUE_TYPE *)malloc(count * sizeof(VALUE_TYPE));
-    __CFSimpleMergeSort(indexBuffer, count, tmp, cmp); // naturally stable
-    if (local != tmp) free(tmp);
+    __CFSortValues(indexBuffer, count, opts, cmp);
 }
 
-/* Comparator is passed the address of the values. */
-void CFQSortArray(void *list, CFIndex count, CFIndex elementSize, CFComparatorFunction comparator, void *context) {
+// Lists of pointer-sized values, which is what CFArray, CFTree and NSArray sort, are sorted directly rather than
+// through an array of indexes that then has to be applied; the comparator sees the addresses of copies of the values.
+void _CFSortArray(void *list, CFIndex count, CFIndex elementSize, CFOptionFlags opts, CFComparatorFunction comparator, void *context) {
     if (count < 2 || elementSize < 1) return;
+    if (sizeof(VALUE_TYPE) == elementSize) {
+        __CFSortValues((VALUE_TYPE *)list, count, opts, ^(VALUE_TYPE a, VALUE_TYPE b) { return comparator(&a, &b, context); });
+        return;
+    }
     STACK_BUFFER_DECL(CFIndex, locali, count <= 4096 ? count : 1);
     CFIndex *indexes = (count <= 4096) ? locali : (CFIndex *)malloc(count * sizeof(CFIndex));
-    CFSortIndexes(indexes, count, 0, ^(CFIndex a, CFIndex b) { return comparator((char *)list + a * elementSize, (char *)list + b * elementSize, context); });
+    CFSortIndexes(indexes, count, opts, ^(CFIndex a, CFIndex b) { return comparator((char *)list + a * elementSize, (char *)list + b * elementSize, context); });
     STACK_BUFFER_DECL(uint8_t, locals, count <= (16 * 1024 / elementSize) ? count * elementSize : 1);
     void *store = (count <= (16 * 1024 / elementSize)) ? locals : malloc(count * elementSize);
     for (CFIndex idx = 0; idx < count; idx++) {
-        if (sizeof(uintptr_t) == elementSize) {
-            uintptr_t *a = (uintptr_t *)list + indexes[idx];
-            uintptr_t *b = (uintptr_t *)store + idx;
-            *b = *a;
-        } else {
-            memmove((char *)store + idx * elementSize, (char *)list + indexes[idx] * elementSize, elementSize);
-        }
+        memmove((char *)store + idx * elementSize, (char *)list + indexes[idx] * elementSize, elementSize);
     }
     // no swapping or modification of the original list has occurred until this point
     objc_memmove_collectable(list, store, count * elementSize);
@@ -309,27 +511,15 @@ void CFQSortArray(void *list, CFIndex count, CFIndex elementSize, CFComparatorFu
     if (locali != indexes) free(indexes);
 }
 
+/* Comparator is passed the address of the values.
+   Despite the name, this has always been a stable merge sort, and CFArraySortValues and CFTree rely on that. */
+void CFQSortArray(void *list, CFIndex count, CFIndex elementSize, CFComparatorFunction comparator, void *context) {
+    _CFSortArray(list, count, elementSize, kCFSortStable, comparator, context);
+}
+
 /* Comparator is passed the address of the values. */
 void CFMergeSortArray(void *list, CFIndex count, CFIndex elementSize, CFComparatorFunction comparator, void *context) {
-    if (count < 2 || elementSize < 1) return;
-    STACK_BUFFER_DECL(CFIndex, locali, count <= 4096 ? count : 1);
-    CFIndex *indexes = (count <= 4096) ? locali : (CFIndex *)malloc(count * sizeof(CFIndex));
-    CFSortIndexes(indexes, count, kCFSortStable, ^(CFIndex a, CFIndex b) { return comparator((char *)list + a * elementSize, (char *)list + b * elementSize, context); });
-    STACK_BUFFER_DECL(uint8_t, locals, count <= (16 * 1024 / elementSize) ? count * elementSize : 1);
-    void *store = (count <= (16 * 1024 / elementSize)) ? locals : malloc(count * elementSize);
-    for (CFIndex idx = 0; idx < count; idx++) {
-        if (sizeof(uintptr_t) == elementSize) {
-            uintptr_t *a = (uintptr_t *)list + indexes[idx];
-            uintptr_t *b = (uintptr_t *)store + idx;
-            *b = *a;
-        } else {
-            memmove((char *)store + idx * elementSize, (char *)list + indexes[idx] * elementSize, elementSize);
-        }
-    }
-    // no swapping or modification of the original list has occurred until this point
-    objc_memmove_collectable(list, store, count * elementSize);
-    if (locals != store) free(store);
-    if (locali != indexes) free(indexes);
+    _CFSortArray(list, count, elementSize, kCFSortStable, comparator, context);
 }
 
 // clang-format on
@@ -173,6 +173,54 @@ CF_EXPORT void _CFApplicationPreferencesRemoveDomain(_CFApplicationPreferences *
 CF_EXPORT CFTypeRef  _CFApplicationPreferencesSearchDownToDomain(_CFApplicationPreferences *self, CFPreferencesDomainRef stopper, CFStringRef key);
 _CF_EXPORT_SCOPE_END
 
+// ---- CFSort material ----------------------------------------
+
+_CF_EXPORT_SCOPE_BEGIN
+
+enum {
+    kCFSortConcurrent = (1 << 0), // same value as NSSortConcurrent; the comparator must be safe to call from several threads
+    kCFSortStable = (1 << 4),     // same value as NSSortStable
+};
+
+#if __BLOCKS__
+/* Fills indexBuffer with the indexes 0 - count-1, as sorted by the comparator block. Concurrent sorts are stable;
+   otherwise the order of equal elements is only kept if kCFSortStable is passed. */
+CF_EXPORT void CFSortIndexes(CFIndex *indexBuffer, CFIndex count, CFOptionFlags opts, CFComparisonResult (^cmp)(CFIndex, CFIndex));
+#endif
+
+/* Sorts count elements of elementSize bytes in place. The comparator is passed the addresses of the values. Concurrent
+   sorts are stable; otherwise the order of equal elements is only kept if kCFSortStable is passed, and without it a
+   pattern-defeating quicksort that needs no temporary buffer is used. CFQSortArray and CFMergeSortArray are both stable. */
+CF_EXPORT void _CFSortArray(void *list, CFIndex count, CFIndex elementSize, CFOptionFlags opts, CFComparatorFunction comparator, void *context);
+
+_CF_EXPORT_SCOPE_END
+
+// ---- CFAllocator arena material ----------------------------------------
+
+_CF_EXPORT_SCOPE_BEGIN
+
+typedef struct {
+    CFIndex allocations;            // blocks carved out of arena chunks
+    CFIndex allocatedBytes;
+    CFIndex fallbackAllocations;    // blocks too large for a chunk, passed on to the system allocator
+    CFIndex deallocations;          // deallocations that were skipped
+    CFIndex chunks;                 // chunks obtained from the system allocator
+    CFIndex resets;                 // scopes that ended with their arena reset for reuse
+    CFIndex retainedScopes;         // scopes that ended with objects still alive, which then own the arena
+} _CFArenaStatistics;
+
+/* Returns a thread-local bump allocator, which stays in scope until the matching _CFArenaScopeEnd(). Only allocations
+   that are passed the arena explicitly use it; the default allocator is not changed. Scopes nest, and share the
+   outermost arena. Deallocation from the arena is a no-op; its memory is reused once a scope ends with none of its
+   objects alive. Memory obtained directly from the arena must be deallocated before the scope ends. */
+CF_EXPORT CFAllocatorRef _CFArenaScopeBegin(void);
+CF_EXPORT void _CFArenaScopeEnd(void);
+
+// Totals for the arenas of the current thread, including the scope in progress.
+CF_EXPORT void _CFArenaGetStatistics(_CFArenaStatistics *statistics);
+
+_CF_EXPORT_SCOPE_END
+
 // ---- CFString material ----------------------------------------
 
 #define NSSTRING_BOUNDSERROR \
@@ -19,6 +19,11 @@
 #include "CFRuntime.h"
 #include <CoreFoundation/CFSet.h>
 #include <math.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 #if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED
 #if __HAS_DISPATCH__
 #include <dispatch/dispatch.h>
@@ -318,7 +323,7 @@ struct __CFBasicHash {
         uint64_t __vret:10;
         uint64_t __krel:10;
         uint64_t __vrel:10;
-        uint64_t __:1;
+        uint64_t tags:1;
         uint64_t null_rc:1;
         uint64_t fast_grow:1;
         uint64_t finalized:1;
@@ -683,6 +688,81 @@ CF_INLINE void __CFBasicHashSetHashes(CFBasicHashRef ht, uintptr_t *ptr) {
     __AssignWithWriteBarrier(&ht->pointers[ht->bits.hashes_offset], ptr);
 }
 
+// The tag store holds one control byte per bucket: empty, deleted, or the top 7 bits
+// of the scrambled hash of the key in the bucket. Lookups compare a whole group of
+// control bytes against the key's tag at once and only call the equality callback on
+// the buckets whose tag matches. The first (group size - 1) control bytes are repeated
+// after the last bucket, so a group can be loaded at any bucket without wrapping.
+#define __CFBasicHashTagEmpty 0x80
+#define __CFBasicHashTagDeleted 0xFE
+#define __CFBasicHashTagGroupSize 16
+
+CF_INLINE Boolean __CFBasicHashHasTags(CFConstBasicHashRef ht) {
+    return ht->bits.tags ? true : false;
+}
+
+// the tag store follows the other stores, after the hash cache if there is one
+CF_INLINE CFIndex __CFBasicHashGetTagsOffset(CFConstBasicHashRef ht) {
+    return 1 + (ht->bits.keys_offset ? 1 : 0) + (ht->bits.counts_offset ? 1 : 0) + (__CFBasicHashHasHashCache(ht) ? 1 : 0);
+}
+
+CF_INLINE uint8_t *__CFBasicHashGetTags(CFConstBasicHashRef ht) {
+    return (uint8_t *)ht->pointers[__CFBasicHashGetTagsOffset(ht)];
+}
+
+CF_INLINE void __CFBasicHashSetTags(CFBasicHashRef ht, uint8_t *ptr) {
+    __AssignWithWriteBarrier(&ht->pointers[__CFBasicHashGetTagsOffset(ht)], ptr);
+}
+
+CF_INLINE uint8_t __CFBasicHashTagForHash(CFHashCode hash_code) {
+    // Numbers and pointers hash to small or sequential values; scramble them so
+    // that neighbouring keys get different tags.
+    return (uint8_t)(((uint64_t)hash_code * 0x9E3779B97F4A7C15ULL) >> 57);
+}
+
+CF_INLINE void __CFBasicHashSetTag(CFBasicHashRef ht, CFIndex idx, uint8_t tag) {
+    uint8_t *tags = __CFBasicHashGetTags(ht);
+    CFIndex num_buckets = __CFBasicHashTableSizes[ht->bits.num_buckets_idx];
+    for (CFIndex copy_idx = idx; copy_idx < num_buckets + __CFBasicHashTagGroupSize - 1; copy_idx += num_buckets) {
+        tags[copy_idx] = tag;
+    }
+}
+
+// Compares the group of control bytes starting at group with tag, and returns
+// bit masks of the bytes that match it, that are empty, and that are deleted.
+// Empty and deleted are the only control bytes with the top bit set.
+CF_INLINE void __CFBasicHashMatchTagGroup(const uint8_t *group, uint8_t tag, uint32_t *matches, uint32_t *empties, uint32_t *deleteds) {
+#if defined(__SSE2__)
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    uint32_t specials = (uint32_t)_mm_movemask_epi8(ctrl);
+    *matches = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)tag)));
+    *empties = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)__CFBasicHashTagEmpty)));
+    *deleteds = specials & ~*empties;
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+    static const uint8_t bit_weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t ctrl = vld1q_u8(group);
+    uint8x16_t weights = vld1q_u8(bit_weights);
+#define __CFBasicHashMoveMask(eq) ({ \
+        uint8x16_t bits = vandq_u8((eq), weights); \
+        uint8x8_t sums = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits)); \
+        sums = vpadd_u8(sums, sums); \
+        sums = vpadd_u8(sums, sums); \
+        (uint32_t)vget_lane_u8(sums, 0) | ((uint32_t)vget_lane_u8(sums, 1) << 8); })
+    uint32_t specials = __CFBasicHashMoveMask(vtstq_u8(ctrl, vdupq_n_u8(0x80)));
+    *matches = __CFBasicHashMoveMask(vceqq_u8(ctrl, vdupq_n_u8(tag)));
+    *empties = __CFBasicHashMoveMask(vceqq_u8(ctrl, vdupq_n_u8(__CFBasicHashTagEmpty)));
+    *deleteds = specials & ~*empties;
+#undef __CFBasicHashMoveMask
+#else
+    *matches = *empties = *deleteds = 0;
+    for (CFIndex idx = 0; idx < __CFBasicHashTagGroupSize; idx++) {
+        if (group[idx] == tag) *matches |= (1U << idx);
+        if (group[idx] == __CFBasicHashTagEmpty) *empties |= (1U << idx);
+        if (group[idx] == __CFBasicHashTagDeleted) *deleteds |= (1U << idx);
+    }
+#endif
+}
+
 
 // to expose the load factor, expose this function to customization
 CF_INLINE CFIndex __CFBasicHashGetCapacityForNumBuckets(CFConstBasicHashRef ht, CFIndex num_buckets_idx) {
@@ -778,72 +858,112 @@ static uintptr_t __CFBasicHashFold(uintptr_t dividend, uint8_t idx) {
 #define FIND_BUCKET_HASH_STYLE      1
 #define FIND_BUCKET_FOR_REHASH      0
 #define FIND_BUCKET_FOR_INDIRECT_KEY    0
+#define FIND_BUCKET_TAGGED      0
 #include "CFBasicHashFindBucket.m"
 
 #define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Linear_NoCollision
 #define FIND_BUCKET_HASH_STYLE      1
 #define FIND_BUCKET_FOR_REHASH      1
 #define FIND_BUCKET_FOR_INDIRECT_KEY    0
+#define FIND_BUCKET_TAGGED      0
 #include "CFBasicHashFindBucket.m"
 
 #define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Linear_Indirect
 #define FIND_BUCKET_HASH_STYLE      1
 #define FIND_BUCKET_FOR_REHASH      0
 #define FIND_BUCKET_FOR_INDIRECT_KEY    1
+#define FIND_BUCKET_TAGGED      0
 #include "CFBasicHashFindBucket.m"
 
 #define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Linear_Indirect_NoCollision
 #define FIND_BUCKET_HASH_STYLE      1
 #define FIND_BUCKET_FOR_REHASH      1
 #define FIND_BUCKET_FOR_INDIRECT_KEY    1
+#define FIND_BUCKET_TAGGED      0
 #include "CFBasicHashFindBucket.m"
 
 #define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Double
 #define FIND_BUCKET_HASH_STYLE      2
 #define FIND_BUCKET_FOR_REHASH      0
 #define FIND_BUCKET_FOR_INDIRECT_KEY    0
+#define FIND_BUCKET_TAGGED      0
 #include "CFBasicHashFindBucket.m"
 
 #define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Double_NoCollision
 #define FIND_BUCKET_HASH_STYLE      2
 #define FIND_BUCKET_FOR_REHASH      1
 #define FIND_BUCKET_FOR_INDIRECT_KEY    0
+#define FIND_BUCKET_TAGGED      0
 #include "CFBasicHashFindBucket.m"
 
 #define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Double_Indirect
 #define FIND_BUCKET_HASH_STYLE      2
 #define FIND_BUCKET_FOR_REHASH      0
 #define FIND_BUCKET_FOR_INDIRECT_KEY    1
+#define FIND_BUCKET_TAGGED      0
 #include "CFBasicHashFindBucket.m"
 
 #define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Double_Indirect_NoCollision
 #define FIND_BUCKET_HASH_STYLE      2
 #define FIND_BUCKET_FOR_REHASH      1
 #define FIND_BUCKET_FOR_INDIRECT_KEY    1
+#define FIND_BUCKET_TAGGED      0
 #include "CFBasicHashFindBucket.m"
 
 #define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Exponential
 #define FIND_BUCKET_HASH_STYLE      3
 #define FIND_BUCKET_FOR_REHASH      0
 #define FIND_BUCKET_FOR_INDIRECT_KEY    0
+#define FIND_BUCKET_TAGGED      0
 #include "CFBasicHashFindBucket.m"
 
 #define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Exponential_NoCollision
 #define FIND_BUCKET_HASH_STYLE      3
 #define FIND_BUCKET_FOR_REHASH      1
 #define FIND_BUCKET_FOR_INDIRECT_KEY    0
+#define FIND_BUCKET_TAGGED      0
 #include "CFBasicHashFindBucket.m"
 
 #define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Exponential_Indirect
 #define FIND_BUCKET_HASH_STYLE      3
 #define FIND_BUCKET_FOR_REHASH      0
 #define FIND_BUCKET_FOR_INDIRECT_KEY    1
+#define FIND_BUCKET_TAGGED      0
 #include "CFBasicHashFindBucket.m"
 
 #define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Exponential_Indirect_NoCollision
 #define FIND_BUCKET_HASH_STYLE      3
 #define FIND_BUCKET_FOR_REHASH      1
 #define FIND_BUCKET_FOR_INDIRECT_KEY    1
+#define FIND_BUCKET_TAGGED      0
+#include "CFBasicHashFindBucket.m"
+
+#define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Tagged
+#define FIND_BUCKET_HASH_STYLE      1
+#define FIND_BUCKET_FOR_REHASH      0
+#define FIND_BUCKET_FOR_INDIRECT_KEY    0
+#define FIND_BUCKET_TAGGED      1
+#include "CFBasicHashFindBucket.m"
+
+#define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Tagged_NoCollision
+#define FIND_BUCKET_HASH_STYLE      1
+#define FIND_BUCKET_FOR_REHASH      1
+#define FIND_BUCKET_FOR_INDIRECT_KEY    0
+#define FIND_BUCKET_TAGGED      1
+#include "CFBasicHashFindBucket.m"
+
+#define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Tagged_Indirect
+#define FIND_BUCKET_HASH_STYLE      1
+#define FIND_BUCKET_FOR_REHASH      0
+#define FIND_BUCKET_FOR_INDIRECT_KEY    1
+#define FIND_BUCKET_TAGGED      1
+#include "CFBasicHashFindBucket.m"
+
+#define FIND_BUCKET_NAME        ___CFBasicHashFindBucket_Tagged_Indirect_NoCollision
+#define FIND_BUCKET_HASH_STYLE      1
+#define FIND_BUCKET_FOR_REHASH      1
+#define FIND_BUCKET_FOR_INDIRECT_KEY    1
+#define FIND_BUCKET_TAGGED      1
 #include "CFBasicHashFindBucket.m"
 
 
@@ -852,6 +972,9 @@ CF_INLINE CFBasicHashBucket __CFBasicHashFindBucket(CFConstBasicHashRef ht, uint
         CFBasicHashBucket result = {kCFNotFound, 0UL, 0UL, 0};
         return result;
     }
+    if (__CFBasicHashHasTags(ht)) {
+        return ht->bits.indirect_keys ? ___CFBasicHashFindBucket_Tagged_Indirect(ht, stack_key) : ___CFBasicHashFindBucket_Tagged(ht, stack_key);
+    }
     if (ht->bits.indirect_keys) {
         switch (ht->bits.hash_style) {
         case __kCFBasicHashLinearHashingValue: return ___CFBasicHashFindBucket_Linear_Indirect(ht, stack_key);
@@ -874,6 +997,9 @@ CF_INLINE CFIndex __CFBasicHashFindBucket_NoCollision(CFConstBasicHashRef ht, ui
     if (0 == ht->bits.num_buckets_idx) {
         return kCFNotFound;
     }
+    if (__CFBasicHashHasTags(ht)) {
+        return ht->bits.indirect_keys ? ___CFBasicHashFindBucket_Tagged_Indirect_NoCollision(ht, stack_key, key_hash) : ___CFBasicHashFindBucket_Tagged_NoCollision(ht, stack_key, key_hash);
+    }
     if (ht->bits.indirect_keys) {
         switch (ht->bits.hash_style) {
         case __kCFBasicHashLinearHashingValue: return ___CFBasicHashFindBucket_Linear_Indirect_NoCollision(ht, stack_key, key_hash);
@@ -915,6 +1041,7 @@ CF_PRIVATE CFOptionFlags CFBasicHashGetFlags(CFConstBasicHashRef ht) {
     if (ht->bits.keys_offset) flags |= kCFBasicHashHasKeys;
     if (ht->bits.counts_offset) flags |= kCFBasicHashHasCounts;
     if (__CFBasicHashHasHashCache(ht)) flags |= kCFBasicHashHasHashCache;
+    if (__CFBasicHashHasTags(ht)) flags |= kCFBasicHashHasTags;
     return flags;
 }
 
@@ -1062,6 +1189,7 @@ static void __CFBasicHashDrain(CFBasicHashRef ht, Boolean forFinalization) {
     CFBasicHashValue *old_values = NULL, *old_keys = NULL;
     void *old_counts = NULL;
     uintptr_t *old_hashes = NULL;
+    uint8_t *old_tags = NULL;
 
     old_values = __CFBasicHashGetValues(ht);
     if (nullify) __CFBasicHashSetValues(ht, NULL);
@@ -1077,6 +1205,10 @@ static void __CFBasicHashDrain(CFBasicHashRef ht, Boolean forFinalization) {
         old_hashes = __CFBasicHashGetHashes(ht);
         if (nullify) __CFBasicHashSetHashes(ht, NULL);
     }
+    if (__CFBasicHashHasTags(ht)) {
+        old_tags = __CFBasicHashGetTags(ht);
+        if (nullify) __CFBasicHashSetTags(ht, NULL);
+    }
 
     if (nullify) {
         ht->bits.mutations++;
@@ -1106,6 +1238,7 @@ static void __CFBasicHashDrain(CFBasicHashRef ht, Boolean forFinalization) {
         CFAllocatorDeallocate(allocator, old_keys);
         CFAllocatorDeallocate(allocator, old_counts);
         CFAllocatorDeallocate(allocator, old_hashes);
+        CFAllocatorDeallocate(allocator, old_tags);
     }
 
 #if ENABLE_MEMORY_COUNTERS
@@ -1138,6 +1271,7 @@ static void __CFBasicHashRehash(CFBasicHashRef ht, CFIndex newItemCount) {
     CFBasicHashValue *new_values = NULL, *new_keys = NULL;
     void *new_counts = NULL;
     uintptr_t *new_hashes = NULL;
+    uint8_t *new_tags = NULL;
 
     if (0 < new_num_buckets) {
         new_values = (CFBasicHashValue *)__CFBasicHashAllocateMemory(ht, new_num_buckets, sizeof(CFBasicHashValue), CFBasicHashHasStrongValues(ht), 0);
@@ -1162,6 +1296,12 @@ static void __CFBasicHashRehash(CFBasicHashRef ht, CFIndex newItemCount) {
             __SetLastAllocationEventName(new_hashes, "CFBasicHash (hash-store)");
             memset(new_hashes, 0, new_num_buckets * sizeof(uintptr_t));
         }
+        if (__CFBasicHashHasTags(ht)) {
+            new_tags = (uint8_t *)__CFBasicHashAllocateMemory(ht, new_num_buckets + __CFBasicHashTagGroupSize - 1, sizeof(uint8_t), false, false);
+            if (!new_tags) HALT;
+            __SetLastAllocationEventName(new_tags, "CFBasicHash (tag-store)");
+            memset(new_tags, __CFBasicHashTagEmpty, new_num_buckets + __CFBasicHashTagGroupSize - 1);
+        }
     }
 
     ht->bits.num_buckets_idx = new_num_buckets_idx;
@@ -1170,6 +1310,7 @@ static void __CFBasicHashRehash(CFBasicHashRef ht, CFIndex newItemCount) {
     CFBasicHashValue *old_values = NULL, *old_keys = NULL;
     void *old_counts = NULL;
     uintptr_t *old_hashes = NULL;
+    uint8_t *old_tags = NULL;
 
     old_values = __CFBasicHashGetValues(ht);
     __CFBasicHashSetValues(ht, new_values);
@@ -1185,6 +1326,10 @@ static void __CFBasicHashRehash(CFBasicHashRef ht, CFIndex newItemCount) {
         old_hashes = __CFBasicHashGetHashes(ht);
         __CFBasicHashSetHashes(ht, new_hashes);
     }
+    if (__CFBasicHashHasTags(ht)) {
+        old_tags = __CFBasicHashGetTags(ht);
+        __CFBasicHashSetTags(ht, new_tags);
+    }
 
     if (0 < old_num_buckets) {
         for (CFIndex idx = 0; idx < old_num_buckets; idx++) {
@@ -1217,6 +1362,10 @@ static void __CFBasicHashRehash(CFBasicHashRef ht, CFIndex newItemCount) {
                 if (old_hashes) {
                     new_hashes[bkt_idx] = old_hashes[idx];
                 }
+                if (old_tags) {
+                    // a tag depends only on the hash code, so it moves with its key
+                    __CFBasicHashSetTag(ht, bkt_idx, old_tags[idx]);
+                }
             }
         }
     }
@@ -1227,6 +1376,7 @@ static void __CFBasicHashRehash(CFBasicHashRef ht, CFIndex newItemCount) {
         CFAllocatorDeallocate(allocator, old_keys);
         CFAllocatorDeallocate(allocator, old_counts);
         CFAllocatorDeallocate(allocator, old_hashes);
+        CFAllocatorDeallocate(allocator, old_tags);
     }
 
     if (COCOA_HASHTABLE_REHASH_END_ENABLED()) COCOA_HASHTABLE_REHASH_END(ht, CFBasicHashGetNumBuckets(ht), CFBasicHashGetSize(ht, true));
@@ -1248,16 +1398,16 @@ CF_PRIVATE void CFBasicHashSetCapacity(CFBasicHashRef ht, CFIndex capacity) {
 
 static void __CFBasicHashAddValue(CFBasicHashRef ht, CFIndex bkt_idx, uintptr_t stack_key, uintptr_t stack_value) {
     ht->bits.mutations++;
+    uintptr_t key_hash = 0;
+    if (__CFBasicHashHasHashCache(ht) || __CFBasicHashHasTags(ht)) {
+        key_hash = __CFBasicHashHashKey(ht, stack_key);
+    }
     if (CFBasicHashGetCapacity(ht) < ht->bits.used_buckets + 1) {
         __CFBasicHashRehash(ht, 1);
-        bkt_idx = __CFBasicHashFindBucket_NoCollision(ht, stack_key, 0);
+        bkt_idx = __CFBasicHashFindBucket_NoCollision(ht, stack_key, key_hash);
     } else if (__CFBasicHashIsDeleted(ht, bkt_idx)) {
         ht->bits.deleted--;
     }
-    uintptr_t key_hash = 0;
-    if (__CFBasicHashHasHashCache(ht)) {
-        key_hash = __CFBasicHashHashKey(ht, stack_key);
-    }
     stack_value = __CFBasicHashImportValue(ht, stack_value);
     if (ht->bits.keys_offset) {
         stack_key = __CFBasicHashImportKey(ht, stack_key);
@@ -1272,6 +1422,9 @@ static void __CFBasicHashAddValue(CFBasicHashRef ht, CFIndex bkt_idx, uintptr_t
     if (__CFBasicHashHasHashCache(ht)) {
         __CFBasicHashGetHashes(ht)[bkt_idx] = key_hash;
     }
+    if (__CFBasicHashHasTags(ht)) {
+        __CFBasicHashSetTag(ht, bkt_idx, __CFBasicHashTagForHash(key_hash));
+    }
     ht->bits.used_buckets++;
 }
 
@@ -1299,6 +1452,9 @@ static void __CFBasicHashRemoveValue(CFBasicHashRef ht, CFIndex bkt_idx) {
     if (__CFBasicHashHasHashCache(ht)) {
         __CFBasicHashGetHashes(ht)[bkt_idx] = 0;
     }
+    if (__CFBasicHashHasTags(ht)) {
+        __CFBasicHashSetTag(ht, bkt_idx, __CFBasicHashTagDeleted);
+    }
     ht->bits.used_buckets--;
     ht->bits.deleted++;
     Boolean do_shrink = false;
@@ -1459,6 +1615,7 @@ CF_PRIVATE size_t CFBasicHashGetSize(CFConstBasicHashRef ht, Boolean total) {
     if (ht->bits.keys_offset) size += sizeof(CFBasicHashValue *);
     if (ht->bits.counts_offset) size += sizeof(void *);
     if (__CFBasicHashHasHashCache(ht)) size += sizeof(uintptr_t *);
+    if (__CFBasicHashHasTags(ht)) size += sizeof(uint8_t *);
     if (total) {
         CFIndex num_buckets = __CFBasicHashTableSizes[ht->bits.num_buckets_idx];
         if (0 < num_buckets) {
@@ -1466,6 +1623,7 @@ CF_PRIVATE size_t CFBasicHashGetSize(CFConstBasicHashRef ht, Boolean total) {
             if (ht->bits.keys_offset) size += malloc_size(__CFBasicHashGetKeys(ht));
             if (ht->bits.counts_offset) size += malloc_size(__CFBasicHashGetCounts(ht));
             if (__CFBasicHashHasHashCache(ht)) size += malloc_size(__CFBasicHashGetHashes(ht));
+            if (__CFBasicHashHasTags(ht)) size += malloc_size(__CFBasicHashGetTags(ht));
         }
     }
     return size;
@@ -1476,7 +1634,7 @@ CF_PRIVATE CFStringRef CFBasicHashCopyDescription(CFConstBasicHashRef ht, Boolea
     CFStringAppendFormat(result, NULL, CFSTR("%@{type = %s %s%s, count = %ld,\n"), prefix, (CFBasicHashIsMutable(ht) ? "mutable" : "immutable"), ((ht->bits.counts_offset) ? "multi" : ""), ((ht->bits.keys_offset) ? "dict" : "set"), CFBasicHashGetCount(ht));
     if (detailed) {
         const char *cb_type = "custom";
-        CFStringAppendFormat(result, NULL, CFSTR("%@hash cache = %s, strong values = %s, strong keys = %s, cb = %s,\n"), prefix, (__CFBasicHashHasHashCache(ht) ? "yes" : "no"), (CFBasicHashHasStrongValues(ht) ? "yes" : "no"), (CFBasicHashHasStrongKeys(ht) ? "yes" : "no"), cb_type);
+        CFStringAppendFormat(result, NULL, CFSTR("%@hash cache = %s, tags = %s, strong values = %s, strong keys = %s, cb = %s,\n"), prefix, (__CFBasicHashHasHashCache(ht) ? "yes" : "no"), (__CFBasicHashHasTags(ht) ? "yes" : "no"), (CFBasicHashHasStrongValues(ht) ? "yes" : "no"), (CFBasicHashHasStrongKeys(ht) ? "yes" : "no"), cb_type);
         CFStringAppendFormat(result, NULL, CFSTR("%@num bucket index = %d, num buckets = %ld, capacity = %ld, num buckets used = %u,\n"), prefix, ht->bits.num_buckets_idx, CFBasicHashGetNumBuckets(ht), (long)CFBasicHashGetCapacity(ht), ht->bits.used_buckets);
         CFStringAppendFormat(result, NULL, CFSTR("%@counts width = %d, finalized = %s,\n"), prefix,((ht->bits.counts_offset) ? (1 << ht->bits.counts_width) : 0), (ht->bits.finalized ? "yes" : "no"));
         CFStringAppendFormat(result, NULL, CFSTR("%@num mutations = %ld, num deleted = %ld, size = %ld, total size = %ld,\n"), prefix, (long)ht->bits.mutations, (long)ht->bits.deleted, CFBasicHashGetSize(ht, false), CFBasicHashGetSize(ht, true));
@@ -1575,6 +1733,7 @@ CF_PRIVATE CFBasicHashRef CFBasicHashCreate(CFAllocatorRef allocator, CFOptionFl
     if (flags & kCFBasicHashHasKeys) size += sizeof(CFBasicHashValue *); // keys
     if (flags & kCFBasicHashHasCounts) size += sizeof(void *); // counts
     if (flags & kCFBasicHashHasHashCache) size += sizeof(uintptr_t *); // hashes
+    if (flags & kCFBasicHashHasTags) size += sizeof(uint8_t *); // tags
     CFBasicHashRef ht = (CFBasicHashRef)_CFRuntimeCreateInstance(allocator, CFBasicHashGetTypeID(), size, NULL);
     if (NULL == ht) return NULL;
 
@@ -1589,6 +1748,7 @@ CF_PRIVATE CFBasicHashRef CFBasicHashCreate(CFAllocatorRef allocator, CFOptionFl
     ht->bits.int_values = (flags & kCFBasicHashIntegerValues) ? 1 : 0;
     ht->bits.int_keys = (flags & kCFBasicHashIntegerKeys) ? 1 : 0;
     ht->bits.indirect_keys = (flags & kCFBasicHashIndirectKeys) ? 1 : 0;
+    ht->bits.tags = ((flags & kCFBasicHashHasTags) && __kCFBasicHashLinearHashingValue == ht->bits.hash_style) ? 1 : 0;
     ht->bits.num_buckets_idx = 0;
     ht->bits.used_buckets = 0;
     ht->bits.deleted = 0;
@@ -1616,6 +1776,7 @@ CF_PRIVATE CFBasicHashRef CFBasicHashCreate(CFAllocatorRef allocator, CFOptionFl
     ht->bits.weak_values = 0;
     ht->bits.weak_keys = 0;
 #endif
+    if (flags & kCFBasicHashHasTags) offset++;
 
     ht->bits.__kret = CFBasicHashGetPtrIndex((void *)cb->retainKey);
     ht->bits.__vret = CFBasicHashGetPtrIndex((void *)cb->retainValue);
@@ -1649,6 +1810,7 @@ CF_PRIVATE CFBasicHashRef CFBasicHashCreateCopy(CFAllocatorRef allocator, CFCons
     CFBasicHashValue *new_values = NULL, *new_keys = NULL;
     void *new_counts = NULL;
     uintptr_t *new_hashes = NULL;
+    uint8_t *new_tags = NULL;
 
     if (0 < new_num_buckets) {
         Boolean strongValues = CFBasicHashHasStrongValues(src_ht) && !(kCFUseCollectableAllocator && !CF_IS_COLLECTABLE_ALLOCATOR(allocator));
@@ -1671,6 +1833,11 @@ CF_PRIVATE CFBasicHashRef CFBasicHashCreateCopy(CFAllocatorRef allocator, CFCons
             if (!new_hashes) return NULL; // in this unusual circumstance, leak previously allocated blocks for now
             __SetLastAllocationEventName(new_hashes, "CFBasicHash (hash-store)");
         }
+        if (__CFBasicHashHasTags(src_ht)) {
+            new_tags = (uint8_t *)__CFBasicHashAllocateMemory2(allocator, new_num_buckets + __CFBasicHashTagGroupSize - 1, sizeof(uint8_t), false, false);
+            if (!new_tags) return NULL; // in this unusual circumstance, leak previously allocated blocks for now
+            __SetLastAllocationEventName(new_tags, "CFBasicHash (tag-store)");
+        }
     }
 
     CFBasicHashRef ht = (CFBasicHashRef)_CFRuntimeCreateInstance(allocator, CFBasicHashGetTypeID(), size, NULL);
@@ -1722,6 +1889,9 @@ CF_PRIVATE CFBasicHashRef CFBasicHashCreateCopy(CFAllocatorRef allocator, CFCons
     if (new_hashes) {
         __CFBasicHashSetHashes(ht, new_hashes);
     }
+    if (new_tags) {
+        __CFBasicHashSetTags(ht, new_tags);
+    }
 
     for (CFIndex idx = 0; idx < new_num_buckets; idx++) {
         uintptr_t stack_value = old_values[idx].neutral;
@@ -1745,6 +1915,7 @@ CF_PRIVATE CFBasicHashRef CFBasicHashCreateCopy(CFAllocatorRef allocator, CFCons
     }
     if (new_counts) memmove(new_counts, old_counts, new_num_buckets * (1 << ht->bits.counts_width));
     if (new_hashes) memmove(new_hashes, old_hashes, new_num_buckets * sizeof(uintptr_t));
+    if (new_tags) memmove(new_tags, __CFBasicHashGetTags(src_ht), new_num_buckets + __CFBasicHashTagGroupSize - 1);
 
 #if ENABLE_MEMORY_COUNTERS
     int64_t size_now = OSAtomicAdd64Barrier((int64_t) CFBasicHashGetSize(ht, true), & __CFBasicHashTotalSize);
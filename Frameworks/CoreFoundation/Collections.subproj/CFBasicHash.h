@@ -37,6 +37,7 @@ enum {
     kCFBasicHashHasKeys = (1UL << 0),
     kCFBasicHashHasCounts = (1UL << 1),
     kCFBasicHashHasHashCache = (1UL << 2),
+    kCFBasicHashHasTags = (1UL << 3), // a control byte per bucket holding 7 bits of the key's hash; linear hashing only
 
     kCFBasicHashIntegerValues = (1UL << 6),
     kCFBasicHashIntegerKeys = (1UL << 7),
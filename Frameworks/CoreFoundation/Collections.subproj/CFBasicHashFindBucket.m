@@ -28,8 +28,12 @@
 */
 
 
-#if !defined(FIND_BUCKET_NAME) || !defined(FIND_BUCKET_HASH_STYLE) || !defined(FIND_BUCKET_FOR_REHASH) || !defined(FIND_BUCKET_FOR_INDIRECT_KEY)
-#error All of FIND_BUCKET_NAME, FIND_BUCKET_HASH_STYLE, FIND_BUCKET_FOR_REHASH, and FIND_BUCKET_FOR_INDIRECT_KEY must be defined before #including this file.
+#if !defined(FIND_BUCKET_NAME) || !defined(FIND_BUCKET_HASH_STYLE) || !defined(FIND_BUCKET_FOR_REHASH) || !defined(FIND_BUCKET_FOR_INDIRECT_KEY) || !defined(FIND_BUCKET_TAGGED)
+#error All of FIND_BUCKET_NAME, FIND_BUCKET_HASH_STYLE, FIND_BUCKET_FOR_REHASH, FIND_BUCKET_FOR_INDIRECT_KEY, and FIND_BUCKET_TAGGED must be defined before #including this file.
+#endif
+
+#if FIND_BUCKET_TAGGED && FIND_BUCKET_HASH_STYLE != 1
+#error Tagged buckets are only probed linearly.
 #endif
 
 
@@ -55,6 +59,100 @@ FIND_BUCKET_NAME (CFConstBasicHashRef ht, uintptr_t stack_key
     CFHashCode hash_code = __CFBasicHashHashKey(ht, stack_key);
 #endif
 
+#if FIND_BUCKET_TAGGED
+    // Linear probing over the tag store, a group of buckets at a time
+    // probe[0] = h1(k), a group covers probe[i] .. probe[i + 15]
+    // h1(k) = k mod num_buckets
+    // Only buckets whose tag matches the key's tag are compared with the key;
+    // the first empty bucket ends the probe sequence.
+#if defined(__arm__)
+    uintptr_t probe = __CFBasicHashFold(hash_code, num_buckets_idx);
+#else
+    uintptr_t probe = hash_code % num_buckets;
+#endif
+
+    COCOA_HASHTABLE_PROBING_START(ht, num_buckets);
+    const uint8_t *tags = __CFBasicHashGetTags(ht);
+#if FIND_BUCKET_FOR_REHASH
+    uint8_t tag = __CFBasicHashTagEmpty;
+#else
+    uint8_t tag = __CFBasicHashTagForHash(hash_code);
+    CFBasicHashValue *keys = (ht->bits.keys_offset) ? __CFBasicHashGetKeys(ht) : __CFBasicHashGetValues(ht);
+    uintptr_t *hashes = (__CFBasicHashHasHashCache(ht)) ? __CFBasicHashGetHashes(ht) : NULL;
+#endif
+    CFIndex deleted_idx = kCFNotFound;
+    for (CFIndex idx = 0; idx < num_buckets; idx += __CFBasicHashTagGroupSize) {
+        uint32_t matches, empties, deleteds;
+        __CFBasicHashMatchTagGroup(tags + probe, tag, &matches, &empties, &deleteds);
+        if (num_buckets - idx < __CFBasicHashTagGroupSize) {
+            // the group runs past the end of the probe sequence
+            uint32_t remaining = (1U << (num_buckets - idx)) - 1;
+            matches &= remaining;
+            empties &= remaining;
+            deleteds &= remaining;
+        }
+        if (empties) {
+            uint32_t before_empty = (empties & (0U - empties)) - 1;
+            matches &= before_empty;
+            deleteds &= before_empty;
+        }
+#if !FIND_BUCKET_FOR_REHASH
+        while (matches) {
+            uintptr_t match_idx = probe + __builtin_ctz(matches);
+            if (num_buckets <= match_idx) {
+                match_idx -= num_buckets;
+            }
+            matches &= matches - 1;
+            COCOA_HASHTABLE_PROBE_VALID(ht, match_idx);
+            uintptr_t curr_key = keys[match_idx].neutral;
+            if (__CFBasicHashSubABZero == curr_key) curr_key = 0UL;
+            if (__CFBasicHashSubABOne == curr_key) curr_key = ~0UL;
+#if FIND_BUCKET_FOR_INDIRECT_KEY
+            // curr_key holds the value coming in here
+            curr_key = __CFBasicHashGetIndirectKey(ht, curr_key);
+#endif
+            if (curr_key == stack_key || ((!hashes || hashes[match_idx] == hash_code) && __CFBasicHashTestEqualKey(ht, curr_key, stack_key))) {
+                COCOA_HASHTABLE_PROBING_END(ht, idx + 1);
+                CFBasicHashBucket result;
+                result.idx = match_idx;
+                result.weak_value = __CFBasicHashGetValue(ht, match_idx);
+                result.weak_key = curr_key;
+                result.count = (ht->bits.counts_offset) ? __CFBasicHashGetSlotCount(ht, match_idx) : 1;
+                return result;
+            }
+        }
+        if (kCFNotFound == deleted_idx && deleteds) {
+            deleted_idx = probe + __builtin_ctz(deleteds);
+            if (num_buckets <= deleted_idx) {
+                deleted_idx -= num_buckets;
+            }
+            COCOA_HASHTABLE_PROBE_DELETED(ht, deleted_idx);
+        }
+#endif
+        if (empties) {
+            uintptr_t empty_idx = probe + __builtin_ctz(empties);
+            if (num_buckets <= empty_idx) {
+                empty_idx -= num_buckets;
+            }
+            COCOA_HASHTABLE_PROBE_EMPTY(ht, empty_idx);
+#if FIND_BUCKET_FOR_REHASH
+            CFIndex result = (kCFNotFound == deleted_idx) ? empty_idx : deleted_idx;
+#else
+            CFBasicHashBucket result;
+            result.idx = (kCFNotFound == deleted_idx) ? empty_idx : deleted_idx;
+            result.count = 0;
+#endif
+            COCOA_HASHTABLE_PROBING_END(ht, idx + 1);
+            return result;
+        }
+
+        probe += __CFBasicHashTagGroupSize;
+        if (num_buckets <= probe) {
+            probe -= num_buckets;
+        }
+    }
+#else
+
 #if FIND_BUCKET_HASH_STYLE == 1 // __kCFBasicHashLinearHashingValue
     // Linear probing, with c = 1
     // probe[0] = h1(k)
@@ -181,6 +279,7 @@ FIND_BUCKET_NAME (CFConstBasicHashRef ht, uintptr_t stack_key
 #endif
 
     }
+#endif
     COCOA_HASHTABLE_PROBING_END(ht, num_buckets);
 #if FIND_BUCKET_FOR_REHASH
     CFIndex result = deleted_idx;
@@ -196,5 +295,6 @@ FIND_BUCKET_NAME (CFConstBasicHashRef ht, uintptr_t stack_key
 #undef FIND_BUCKET_HASH_STYLE
 #undef FIND_BUCKET_FOR_REHASH
 #undef FIND_BUCKET_FOR_INDIRECT_KEY
+#undef FIND_BUCKET_TAGGED
 
 // clang-format on
\ No newline at end of file
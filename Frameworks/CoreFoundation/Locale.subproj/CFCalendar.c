@@ -21,6 +21,7 @@
 #include "CFInternal.h"
 #include "CFPriv.h"
 #include <unicode/ucal.h>
+#include "CFICUCache.h"
 
 // WINOBJC: extra includes for bridging
 #include <Foundation/NSCalendar.h>
@@ -108,7 +109,7 @@ CF_PRIVATE UCalendar *__CFCalendarCreateUCalendar(CFStringRef calendarID, CFStri
     CFStringGetCharacters(tznam, CFRangeMake(0, cnt), (UniChar *)ubuffer);
 
     UErrorCode status = U_ZERO_ERROR;
-    UCalendar *cal = ucal_open(ubuffer, cnt, cstr, UCAL_DEFAULT, &status);
+    UCalendar *cal = __CFICUCacheOpenCalendar(ubuffer, cnt, cstr, UCAL_DEFAULT, &status);
     if (calendarID) CFRelease(localeID);
     return cal;
 }
@@ -26,6 +26,7 @@
 #include "CFInternal.h"
 #include "CFLocaleInternal.h"
 #include "CFICULogging.h"
+#include "CFICUCache.h"
 #include <math.h>
 #include <float.h>
 #include "unicode\udat.h"
@@ -628,7 +629,7 @@ static void __ResetUDateFormat(CFDateFormatterRef df, Boolean goingToHaveCustomF
     }
 
     UErrorCode status = U_ZERO_ERROR;
-    UDateFormat *icudf = __cficu_udat_open((UDateFormatStyle)utstyle, (UDateFormatStyle)udstyle, loc_buffer, tz_buffer, CFStringGetLength(tmpTZName), NULL, 0, &status);
+    UDateFormat *icudf = __CFICUCacheOpenDateFormat((UDateFormatStyle)utstyle, (UDateFormatStyle)udstyle, loc_buffer, tz_buffer, CFStringGetLength(tmpTZName), &status);
 
     if (NULL == icudf || U_FAILURE(status)) {
         return;
@@ -952,7 +953,7 @@ static void __substituteFormatStringFromPrefsDF(CFDateFormatterRef formatter, bo
                 if (CFStringGetCString(localeName, buffer, BUFFER_SIZE, kCFStringEncodingASCII)) cstr = buffer;
             }
             UErrorCode status = U_ZERO_ERROR;
-            UDateFormat *df = __cficu_udat_open((UDateFormatStyle)(doTime ? icustyle : UDAT_NONE), (UDateFormatStyle)(doTime ? UDAT_NONE : icustyle), cstr, NULL, 0, NULL, 0, &status);
+            UDateFormat *df = __CFICUCacheOpenDateFormat((UDateFormatStyle)(doTime ? icustyle : UDAT_NONE), (UDateFormatStyle)(doTime ? UDAT_NONE : icustyle), cstr, NULL, 0, &status);
             if (NULL != df) {
                 UChar ubuffer[BUFFER_SIZE];
                 status = U_ZERO_ERROR;
@@ -0,0 +1,236 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+// clang-format off
+
+#include "CFInternal.h"
+#include "CFICUCache.h"
+#include <unicode/ustring.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    __kCFICUCacheDateFormat = 1,
+    __kCFICUCacheNumberFormat,
+    __kCFICUCacheCalendar,
+};
+
+#define __kCFICUCacheDefaultCapacity 32
+#define __kCFICUCacheMaxKeyLength 512
+
+// The kind of object followed by the arguments it was opened with. Keys that do not fit are not cached.
+typedef struct {
+    uint8_t bytes[__kCFICUCacheMaxKeyLength];
+    CFIndex length;
+    Boolean overflow;
+} __CFICUCacheKey;
+
+typedef struct {
+    uint8_t *key;
+    CFIndex keyLength;
+    void *object;       // Only ever cloned, never handed out.
+    UErrorCode status;  // What opening object reported, such as U_USING_DEFAULT_WARNING; returned with every clone.
+    uint64_t lastUse;
+} __CFICUCacheEntry;
+
+static CFLock_t __CFICUCacheLock = CFLockInit;
+static __CFICUCacheEntry *__CFICUCacheEntries = NULL;
+static CFIndex __CFICUCacheCount = 0;
+static CFIndex __CFICUCacheCapacity = -1;
+static uint64_t __CFICUCacheClock = 0;
+
+static void __CFICUCacheKeyInit(__CFICUCacheKey *key, uint8_t kind) {
+    key->bytes[0] = kind;
+    key->length = 1;
+    key->overflow = false;
+}
+
+static void __CFICUCacheKeyAppend(__CFICUCacheKey *key, const void *bytes, CFIndex length) {
+    if (key->overflow || length > __kCFICUCacheMaxKeyLength - key->length) {
+        key->overflow = true;
+        return;
+    }
+    memmove(key->bytes + key->length, bytes, length);
+    key->length += length;
+}
+
+// Strings are appended with their length, so that consecutive ones cannot run into each other. NULL strings, which
+// stand for ICU defaults, are appended with a length of -1 to tell them apart from empty ones.
+static void __CFICUCacheKeyAppendString(__CFICUCacheKey *key, const void *bytes, int32_t length, CFIndex characterSize) {
+    if (!bytes) length = -1;
+    __CFICUCacheKeyAppend(key, &length, sizeof(length));
+    if (0 < length) __CFICUCacheKeyAppend(key, bytes, length * characterSize);
+}
+
+static void *__CFICUCacheCloneKind(uint8_t kind, const void *object, UErrorCode *status) {
+    switch (kind) {
+    case __kCFICUCacheDateFormat: return __cficu_udat_clone((const UDateFormat *)object, status);
+    case __kCFICUCacheNumberFormat: return __cficu_unum_clone((const UNumberFormat *)object, status);
+    case __kCFICUCacheCalendar: return __cficu_ucal_clone((const UCalendar *)object, status);
+    }
+    return NULL;
+}
+
+// Clones the object of entry and sets status to what opening it reported, as if the clone had just been opened; unless
+// cloning fails, in which case status is set to that error.
+static void *__CFICUCacheClone(uint8_t kind, const __CFICUCacheEntry *entry, UErrorCode *status) {
+    UErrorCode cloneStatus = U_ZERO_ERROR;
+    void *result = __CFICUCacheCloneKind(kind, entry->object, &cloneStatus);
+    *status = U_FAILURE(cloneStatus) ? cloneStatus : entry->status;
+    return result;
+}
+
+static void __CFICUCacheClose(uint8_t kind, void *object) {
+    switch (kind) {
+    case __kCFICUCacheDateFormat: __cficu_udat_close((UDateFormat *)object); break;
+    case __kCFICUCacheNumberFormat: __cficu_unum_close((UNumberFormat *)object); break;
+    case __kCFICUCacheCalendar: __cficu_ucal_close((UCalendar *)object); break;
+    }
+}
+
+// Must be called with the lock held.
+static __CFICUCacheEntry *__CFICUCacheFind(const __CFICUCacheKey *key) {
+    for (CFIndex idx = 0; idx < __CFICUCacheCount; idx++) {
+        __CFICUCacheEntry *entry = &__CFICUCacheEntries[idx];
+        if (entry->keyLength == key->length && memcmp(entry->key, key->bytes, key->length) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Returns a clone of the cached object for key, or NULL if there is none.
+static void *__CFICUCacheCheckout(const __CFICUCacheKey *key, UErrorCode *status) {
+    if (key->overflow) return NULL;
+
+    void *result = NULL;
+    __CFLock(&__CFICUCacheLock);
+    if (__CFICUCacheCapacity < 0) {
+        const char *value = __CFgetenv("CFICUCacheSize");
+        __CFICUCacheCapacity = value ? strtol(value, NULL, 10) : __kCFICUCacheDefaultCapacity;
+        if (__CFICUCacheCapacity < 0) __CFICUCacheCapacity = 0;
+    }
+    __CFICUCacheEntry *entry = __CFICUCacheFind(key);
+    if (entry) {
+        entry->lastUse = ++__CFICUCacheClock;
+        result = __CFICUCacheClone(key->bytes[0], entry, status);
+    }
+    __CFUnlock(&__CFICUCacheLock);
+    return result;
+}
+
+// Takes ownership of object, which was just opened for key with the given status, and returns an object for the
+// caller: a clone of it if it went into the cache, or object itself if it did not.
+static void *__CFICUCacheCheckin(const __CFICUCacheKey *key, void *object, UErrorCode *status) {
+    if (key->overflow) return object;
+
+    uint8_t kind = key->bytes[0];
+    void *result = object;
+    void *evicted = NULL;
+    uint8_t evictedKind = 0;
+    __CFLock(&__CFICUCacheLock);
+    __CFICUCacheEntry *entry = __CFICUCacheFind(key);
+    if (entry) {
+        // Another thread opened the same object in the meantime; keep using ours.
+        entry->lastUse = ++__CFICUCacheClock;
+    } else if (0 < __CFICUCacheCapacity) {
+        if (!__CFICUCacheEntries) {
+            __CFICUCacheEntries = (__CFICUCacheEntry *)calloc(__CFICUCacheCapacity, sizeof(__CFICUCacheEntry));
+        }
+        uint8_t *keyCopy = (uint8_t *)malloc(key->length);
+        if (__CFICUCacheEntries && keyCopy) {
+            if (__CFICUCacheCount < __CFICUCacheCapacity) {
+                entry = &__CFICUCacheEntries[__CFICUCacheCount++];
+            } else {
+                entry = &__CFICUCacheEntries[0];
+                for (CFIndex idx = 1; idx < __CFICUCacheCount; idx++) {
+                    if (__CFICUCacheEntries[idx].lastUse < entry->lastUse) entry = &__CFICUCacheEntries[idx];
+                }
+                evicted = entry->object;
+                evictedKind = entry->key[0];
+                free(entry->key);
+            }
+            memmove(keyCopy, key->bytes, key->length);
+            entry->key = keyCopy;
+            entry->keyLength = key->length;
+            entry->object = object;
+            entry->status = *status;
+            entry->lastUse = ++__CFICUCacheClock;
+            result = __CFICUCacheClone(kind, entry, status);
+        } else {
+            free(keyCopy);
+        }
+    }
+    __CFUnlock(&__CFICUCacheLock);
+
+    if (evicted) __CFICUCacheClose(evictedKind, evicted);
+    return result;
+}
+
+UDateFormat *__CFICUCacheOpenDateFormat(UDateFormatStyle timeStyle, UDateFormatStyle dateStyle, const char *locale, const UChar *tzID, int32_t tzIDLength, UErrorCode *status) {
+    if (U_FAILURE(*status)) return NULL;
+    if (tzID && tzIDLength < 0) tzIDLength = u_strlen(tzID);
+
+    __CFICUCacheKey key;
+    __CFICUCacheKeyInit(&key, __kCFICUCacheDateFormat);
+    __CFICUCacheKeyAppend(&key, &timeStyle, sizeof(timeStyle));
+    __CFICUCacheKeyAppend(&key, &dateStyle, sizeof(dateStyle));
+    __CFICUCacheKeyAppendString(&key, locale, locale ? (int32_t)strlen(locale) : 0, sizeof(char));
+    __CFICUCacheKeyAppendString(&key, tzID, tzIDLength, sizeof(UChar));
+
+    UDateFormat *result = (UDateFormat *)__CFICUCacheCheckout(&key, status);
+    if (result || U_FAILURE(*status)) return result;
+
+    result = __cficu_udat_open(timeStyle, dateStyle, locale, tzID, tzIDLength, NULL, 0, status);
+    if (!result || U_FAILURE(*status)) return result;
+    return (UDateFormat *)__CFICUCacheCheckin(&key, result, status);
+}
+
+UNumberFormat *__CFICUCacheOpenNumberFormat(UNumberFormatStyle style, const char *locale, UErrorCode *status) {
+    if (U_FAILURE(*status)) return NULL;
+
+    __CFICUCacheKey key;
+    __CFICUCacheKeyInit(&key, __kCFICUCacheNumberFormat);
+    __CFICUCacheKeyAppend(&key, &style, sizeof(style));
+    __CFICUCacheKeyAppendString(&key, locale, locale ? (int32_t)strlen(locale) : 0, sizeof(char));
+
+    UNumberFormat *result = (UNumberFormat *)__CFICUCacheCheckout(&key, status);
+    if (result || U_FAILURE(*status)) return result;
+
+    result = __cficu_unum_open(style, NULL, 0, locale, NULL, status);
+    if (!result || U_FAILURE(*status)) return result;
+    return (UNumberFormat *)__CFICUCacheCheckin(&key, result, status);
+}
+
+UCalendar *__CFICUCacheOpenCalendar(const UChar *zoneID, int32_t zoneIDLength, const char *locale, UCalendarType type, UErrorCode *status) {
+    if (U_FAILURE(*status)) return NULL;
+    if (zoneID && zoneIDLength < 0) zoneIDLength = u_strlen(zoneID);
+
+    __CFICUCacheKey key;
+    __CFICUCacheKeyInit(&key, __kCFICUCacheCalendar);
+    __CFICUCacheKeyAppend(&key, &type, sizeof(type));
+    __CFICUCacheKeyAppendString(&key, locale, locale ? (int32_t)strlen(locale) : 0, sizeof(char));
+    __CFICUCacheKeyAppendString(&key, zoneID, zoneIDLength, sizeof(UChar));
+
+    UCalendar *result = (UCalendar *)__CFICUCacheCheckout(&key, status);
+    if (result || U_FAILURE(*status)) return result;
+
+    result = __cficu_ucal_open(zoneID, zoneIDLength, locale, type, status);
+    if (!result || U_FAILURE(*status)) return result;
+    return (UCalendar *)__CFICUCacheCheckin(&key, result, status);
+}
+
+// clang-format on
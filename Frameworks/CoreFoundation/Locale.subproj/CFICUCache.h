@@ -0,0 +1,49 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+// clang-format off
+
+/*
+ This file is for the use of the CoreFoundation project only.
+*/
+
+#if !defined(__COREFOUNDATION_CFICUCACHE__)
+#define __COREFOUNDATION_CFICUCACHE__ 1
+
+#include "CFICULogging.h"
+
+CF_EXTERN_C_BEGIN
+
+/*
+ Drop-in replacements for udat_open, unum_open and ucal_open (without patterns or parse errors) that
+ keep a pristine copy of each object they open in a process-wide pool, keyed by their arguments,
+ and return clones of it to later callers. Cloning is much cheaper than opening: the locale data,
+ symbols and patterns do not need to be loaded and parsed again. The returned objects belong to
+ the caller and are closed as usual. Each clone comes with the status its original was opened with, so
+ warnings such as U_USING_DEFAULT_WARNING are reported as they would be without the pool.
+
+ The pool holds up to 32 objects, least recently used ones being closed first. Set CFICUCacheSize
+ in the environment to change that; 0 turns the pool off.
+*/
+CF_PRIVATE UDateFormat *__CFICUCacheOpenDateFormat(UDateFormatStyle timeStyle, UDateFormatStyle dateStyle, const char *locale, const UChar *tzID, int32_t tzIDLength, UErrorCode *status);
+CF_PRIVATE UNumberFormat *__CFICUCacheOpenNumberFormat(UNumberFormatStyle style, const char *locale, UErrorCode *status);
+CF_PRIVATE UCalendar *__CFICUCacheOpenCalendar(const UChar *zoneID, int32_t zoneIDLength, const char *locale, UCalendarType type, UErrorCode *status);
+
+CF_EXTERN_C_END
+
+#endif
+
+// clang-format on
@@ -21,6 +21,7 @@
 #include "CFInternal.h"
 #include "CFLocaleInternal.h"
 #include "CFICULogging.h"
+#include "CFICUCache.h"
 #include <math.h>
 #include <float.h>
 
@@ -137,7 +138,7 @@ CFNumberFormatterRef CFNumberFormatterCreate(CFAllocatorRef allocator, CFLocaleR
     return NULL;
     }
     UErrorCode status = U_ZERO_ERROR;
-    memory->_nf = __cficu_unum_open((UNumberFormatStyle)ustyle, NULL, 0, cstr, NULL, &status);
+    memory->_nf = __CFICUCacheOpenNumberFormat((UNumberFormatStyle)ustyle, cstr, &status);
     CFAssert2(memory->_nf, __kCFLogAssertion, "%s(): error (%d) creating number formatter", __PRETTY_FUNCTION__, status);
     if (NULL == memory->_nf) {
     CFRelease(memory);
@@ -234,7 +235,7 @@ static void __substituteFormatStringFromPrefsNF(CFNumberFormatterRef formatter)
         if (CFStringGetCString(localeName, buffer, BUFFER_SIZE, kCFStringEncodingASCII)) cstr = buffer;
         }
         UErrorCode status = U_ZERO_ERROR;
-        UNumberFormat *nf = __cficu_unum_open((UNumberFormatStyle)icustyle, NULL, 0, cstr, NULL, &status);
+        UNumberFormat *nf = __CFICUCacheOpenNumberFormat((UNumberFormatStyle)icustyle, cstr, &status);
         if (NULL != nf) {
         UChar ubuffer[BUFFER_SIZE];
         status = U_ZERO_ERROR;
@@ -1033,7 +1034,7 @@ CFTypeRef CFNumberFormatterCopyProperty(CFNumberFormatterRef formatter, CFString
             return NULL;
         }
         UErrorCode status = U_ZERO_ERROR;
-        UNumberFormat *nf = __cficu_unum_open(UNUM_CURRENCY, NULL, 0, cstr, NULL, &status);
+        UNumberFormat *nf = __CFICUCacheOpenNumberFormat(UNUM_CURRENCY, cstr, &status);
         if (NULL != nf) {
         cnt = __cficu_unum_getTextAttribute(nf, UNUM_CURRENCY_CODE, ubuffer, BUFFER_SIZE, &status);
         __cficu_unum_close(nf);
@@ -599,6 +599,11 @@ static CFTypeID __kCFRunLoopTimerTypeID = _kCFRuntimeNotATypeID;
 
 typedef struct __CFRunLoopMode *CFRunLoopModeRef;
 
+typedef struct __CFTimerWheel __CFTimerWheel;
+static void __CFTimerWheelDestroy(__CFTimerWheel *wheel);
+static CFIndex __CFTimerWheelGetCount(const __CFTimerWheel *wheel);
+static CFArrayRef __CFTimerWheelCopyTimers(const __CFTimerWheel *wheel);
+
 struct __CFRunLoopMode {
     CFRuntimeBase _base;
     pthread_mutex_t _lock;  /* must have the run loop locked before locking this */
@@ -608,7 +613,7 @@ struct __CFRunLoopMode {
     CFMutableSetRef _sources0;
     CFMutableSetRef _sources1;
     CFMutableArrayRef _observers;
-    CFMutableArrayRef _timers;
+    __CFTimerWheel *_timers;
     CFMutableDictionaryRef _portToV1SourceMap;
     __CFPortSet _portSet;
     CFIndex _observerMask;
@@ -667,7 +672,9 @@ static CFStringRef __CFRunLoopModeCopyDescription(CFTypeRef cf) {
 #if DEPLOYMENT_TARGET_WINDOWS
     CFStringAppendFormat(result, NULL, CFSTR("MSGQ mask = %p, "), rlm->_msgQMask);
 #endif
-    CFStringAppendFormat(result, NULL, CFSTR("\n    sources0 = %@,\n    sources1 = %@,\n    observers = %@,\n    timers = %@,\n    currently %0.09g (%lld) / soft deadline in: %0.09g sec (@ %lld) / hard deadline in: %0.09g sec (@ %lld)\n},\n"), rlm->_sources0, rlm->_sources1, rlm->_observers, rlm->_timers, CFAbsoluteTimeGetCurrent(), mach_absolute_time(), __CFTSRToTimeInterval(rlm->_timerSoftDeadline - mach_absolute_time()), rlm->_timerSoftDeadline, __CFTSRToTimeInterval(rlm->_timerHardDeadline - mach_absolute_time()), rlm->_timerHardDeadline);
+    CFArrayRef timers = rlm->_timers ? __CFTimerWheelCopyTimers(rlm->_timers) : NULL;
+    CFStringAppendFormat(result, NULL, CFSTR("\n    sources0 = %@,\n    sources1 = %@,\n    observers = %@,\n    timers = %@,\n    currently %0.09g (%lld) / soft deadline in: %0.09g sec (@ %lld) / hard deadline in: %0.09g sec (@ %lld)\n},\n"), rlm->_sources0, rlm->_sources1, rlm->_observers, timers, CFAbsoluteTimeGetCurrent(), mach_absolute_time(), __CFTSRToTimeInterval(rlm->_timerSoftDeadline - mach_absolute_time()), rlm->_timerSoftDeadline, __CFTSRToTimeInterval(rlm->_timerHardDeadline - mach_absolute_time()), rlm->_timerHardDeadline);
+    if (timers) CFRelease(timers);
     return result;
 }
 
@@ -676,7 +683,7 @@ static void __CFRunLoopModeDeallocate(CFTypeRef cf) {
     if (NULL != rlm->_sources0) CFRelease(rlm->_sources0);
     if (NULL != rlm->_sources1) CFRelease(rlm->_sources1);
     if (NULL != rlm->_observers) CFRelease(rlm->_observers);
-    if (NULL != rlm->_timers) CFRelease(rlm->_timers);
+    if (NULL != rlm->_timers) __CFTimerWheelDestroy(rlm->_timers);
     if (NULL != rlm->_portToV1SourceMap) CFRelease(rlm->_portToV1SourceMap);
     CFRelease(rlm->_name);
     __CFPortSetFree(rlm->_portSet);
@@ -920,7 +927,7 @@ static Boolean __CFRunLoopModeIsEmpty(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFR
 #endif
     if (NULL != rlm->_sources0 && 0 < CFSetGetCount(rlm->_sources0)) return false;
     if (NULL != rlm->_sources1 && 0 < CFSetGetCount(rlm->_sources1)) return false;
-    if (NULL != rlm->_timers && 0 < CFArrayGetCount(rlm->_timers)) return false;
+    if (NULL != rlm->_timers && 0 < __CFTimerWheelGetCount(rlm->_timers)) return false;
     struct _block_item *item = rl->_blocks_head;
     while (item) {
         struct _block_item *curr = item;
@@ -1190,6 +1197,281 @@ CF_INLINE void __CFRunLoopTimerFireTSRUnlock(void) {
     __CFUnlock(&__CFRLTFireTSRLock);
 }
 
+#pragma mark Timer Wheels
+
+/* Each mode keeps its timers in a hierarchical timer wheel, so adding, removing and repositioning a
+ timer are O(1) no matter how many timers the mode holds. Fire times are bucketed into ticks of
+ about a millisecond. A timer lives at the level of the most significant base-64 digit in which its
+ tick differs from the wheel's current tick, in the slot named by that digit: every timer on level n
+ fires before every timer on level n + 1, and the slots of a level are in fire order. Advancing the
+ current tick cascades the slots it reaches down to lower levels; timers whose tick has been reached
+ wait on the expired list until they fire or are repositioned. Ticks beyond the top level are kept
+ on an overflow list, which is re-filed whenever the current tick crosses into a new top-level span. */
+
+#define __CFTimerWheelBits 6
+#define __CFTimerWheelSlots (1 << __CFTimerWheelBits)
+#define __CFTimerWheelLevels 6
+#define __CFTimerWheelOverflow __CFTimerWheelLevels
+#define __CFTimerWheelExpired (__CFTimerWheelLevels + 1)
+
+typedef struct __CFTimerWheelEntry {
+    struct __CFTimerWheelEntry *_next;
+    struct __CFTimerWheelEntry **_prevNext;
+    CFRunLoopTimerRef _timer;
+    uint64_t _tick;
+    uint8_t _level;
+    uint8_t _slot;
+} __CFTimerWheelEntry;
+
+struct __CFTimerWheel {
+    uint64_t _tickTSR;
+    uint64_t _tick;
+    uint64_t _occupied[__CFTimerWheelLevels];
+    __CFTimerWheelEntry *_slots[__CFTimerWheelLevels][__CFTimerWheelSlots];
+    __CFTimerWheelEntry *_overflow;
+    __CFTimerWheelEntry *_expired;
+    CFMutableDictionaryRef _entries;    /* timer (retained) -> entry */
+};
+
+static __CFTimerWheel *__CFTimerWheelCreate(void) {
+    __CFTimerWheel *wheel = (__CFTimerWheel *)CFAllocatorAllocate(kCFAllocatorSystemDefault, sizeof(__CFTimerWheel), 0);
+    memset(wheel, 0, sizeof(__CFTimerWheel));
+    wheel->_tickTSR = __CFTimeIntervalToTSR(0.001);
+    if (0 == wheel->_tickTSR) wheel->_tickTSR = 1;
+    wheel->_tick = mach_absolute_time() / wheel->_tickTSR;
+    CFDictionaryKeyCallBacks cb = kCFTypeDictionaryKeyCallBacks;
+    cb.equal = NULL;
+    cb.hash = NULL;
+    wheel->_entries = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, &cb, NULL);
+    return wheel;
+}
+
+static void __CFTimerWheelFreeEntry(const void *key, const void *value, void *context) {
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, (void *)value);
+}
+
+static void __CFTimerWheelDestroy(__CFTimerWheel *wheel) {
+    CFDictionaryApplyFunction(wheel->_entries, __CFTimerWheelFreeEntry, NULL);
+    CFRelease(wheel->_entries);
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, wheel);
+}
+
+static CFIndex __CFTimerWheelGetCount(const __CFTimerWheel *wheel) {
+    return CFDictionaryGetCount(wheel->_entries);
+}
+
+static Boolean __CFTimerWheelContainsTimer(const __CFTimerWheel *wheel, CFRunLoopTimerRef rlt) {
+    return CFDictionaryContainsKey(wheel->_entries, rlt);
+}
+
+static CFArrayRef __CFTimerWheelCopyTimers(const __CFTimerWheel *wheel) {
+    CFIndex cnt = CFDictionaryGetCount(wheel->_entries);
+    const void **timers, *buffer[256];
+    timers = (const void **)((cnt <= 256) ? buffer : CFAllocatorAllocate(kCFAllocatorSystemDefault, cnt * sizeof(void *), 0));
+    CFDictionaryGetKeysAndValues(wheel->_entries, timers, NULL);
+    CFArrayRef result = CFArrayCreate(kCFAllocatorSystemDefault, timers, cnt, &kCFTypeArrayCallBacks);
+    if (timers != buffer) CFAllocatorDeallocate(kCFAllocatorSystemDefault, timers);
+    return result;
+}
+
+CF_INLINE uint64_t __CFTimerWheelSlotStartTick(const __CFTimerWheel *wheel, CFIndex level, CFIndex slot) {
+    CFIndex shift = level * __CFTimerWheelBits;
+    return ((wheel->_tick >> (shift + __CFTimerWheelBits)) << (shift + __CFTimerWheelBits)) | ((uint64_t)slot << shift);
+}
+
+CF_INLINE void __CFTimerWheelLink(__CFTimerWheelEntry **head, __CFTimerWheelEntry *entry) {
+    entry->_next = *head;
+    if (entry->_next) entry->_next->_prevNext = &entry->_next;
+    entry->_prevNext = head;
+    *head = entry;
+}
+
+static void __CFTimerWheelUnlink(__CFTimerWheel *wheel, __CFTimerWheelEntry *entry) {
+    *entry->_prevNext = entry->_next;
+    if (entry->_next) entry->_next->_prevNext = entry->_prevNext;
+    if (entry->_level < __CFTimerWheelLevels && NULL == wheel->_slots[entry->_level][entry->_slot]) {
+        wheel->_occupied[entry->_level] &= ~(1ULL << entry->_slot);
+    }
+}
+
+static void __CFTimerWheelPlace(__CFTimerWheel *wheel, __CFTimerWheelEntry *entry) {
+    if (entry->_tick <= wheel->_tick) {
+        entry->_level = __CFTimerWheelExpired;
+        __CFTimerWheelLink(&wheel->_expired, entry);
+        return;
+    }
+    CFIndex level = (63 - __builtin_clzll(entry->_tick ^ wheel->_tick)) / __CFTimerWheelBits;
+    if (__CFTimerWheelLevels <= level) {
+        entry->_level = __CFTimerWheelOverflow;
+        __CFTimerWheelLink(&wheel->_overflow, entry);
+        return;
+    }
+    CFIndex slot = (entry->_tick >> (level * __CFTimerWheelBits)) & (__CFTimerWheelSlots - 1);
+    entry->_level = (uint8_t)level;
+    entry->_slot = (uint8_t)slot;
+    __CFTimerWheelLink(&wheel->_slots[level][slot], entry);
+    wheel->_occupied[level] |= (1ULL << slot);
+}
+
+CF_INLINE void __CFTimerWheelPlaceList(__CFTimerWheel *wheel, __CFTimerWheelEntry *list) {
+    while (list) {
+        __CFTimerWheelEntry *next = list->_next;
+        __CFTimerWheelPlace(wheel, list);
+        list = next;
+    }
+}
+
+// Moves the wheel's current tick forward to that of nowTSR, cascading the slots it has reached.
+static void __CFTimerWheelAdvance(__CFTimerWheel *wheel, uint64_t nowTSR) {
+    uint64_t tick = nowTSR / wheel->_tickTSR;
+    uint64_t oldTick = wheel->_tick;
+    if (tick <= oldTick) return;
+    wheel->_tick = tick;
+    if ((oldTick >> (__CFTimerWheelBits * __CFTimerWheelLevels)) != (tick >> (__CFTimerWheelBits * __CFTimerWheelLevels))) {
+        __CFTimerWheelEntry *list = wheel->_overflow;
+        wheel->_overflow = NULL;
+        __CFTimerWheelPlaceList(wheel, list);
+    }
+    for (CFIndex level = __CFTimerWheelLevels - 1; 0 <= level; level--) {
+        CFIndex shift = level * __CFTimerWheelBits;
+        uint64_t reached;
+        if ((oldTick >> (shift + __CFTimerWheelBits)) != (tick >> (shift + __CFTimerWheelBits))) {
+            // the whole level lies behind the new tick
+            reached = wheel->_occupied[level];
+        } else {
+            CFIndex digit = (tick >> shift) & (__CFTimerWheelSlots - 1);
+            reached = wheel->_occupied[level] & ((__CFTimerWheelSlots - 1 == digit) ? ~0ULL : ((2ULL << digit) - 1));
+        }
+        while (reached) {
+            CFIndex slot = __builtin_ctzll(reached);
+            reached &= reached - 1;
+            __CFTimerWheelEntry *list = wheel->_slots[level][slot];
+            wheel->_slots[level][slot] = NULL;
+            wheel->_occupied[level] &= ~(1ULL << slot);
+            __CFTimerWheelPlaceList(wheel, list);
+        }
+    }
+}
+
+static void __CFTimerWheelAddTimer(__CFTimerWheel *wheel, CFRunLoopTimerRef rlt) {
+    __CFTimerWheelEntry *entry = (__CFTimerWheelEntry *)CFAllocatorAllocate(kCFAllocatorSystemDefault, sizeof(__CFTimerWheelEntry), 0);
+    entry->_timer = rlt;
+    entry->_tick = rlt->_fireTSR / wheel->_tickTSR;
+    __CFTimerWheelPlace(wheel, entry);
+    CFDictionarySetValue(wheel->_entries, rlt, entry);
+}
+
+// Re-files a timer whose fire TSR has changed; returns false if the timer is not in the wheel.
+static Boolean __CFTimerWheelRepositionTimer(__CFTimerWheel *wheel, CFRunLoopTimerRef rlt) {
+    __CFTimerWheelEntry *entry = (__CFTimerWheelEntry *)CFDictionaryGetValue(wheel->_entries, rlt);
+    if (!entry) return false;
+    __CFTimerWheelUnlink(wheel, entry);
+    entry->_tick = rlt->_fireTSR / wheel->_tickTSR;
+    __CFTimerWheelPlace(wheel, entry);
+    return true;
+}
+
+static Boolean __CFTimerWheelRemoveTimer(__CFTimerWheel *wheel, CFRunLoopTimerRef rlt) {
+    __CFTimerWheelEntry *entry = (__CFTimerWheelEntry *)CFDictionaryGetValue(wheel->_entries, rlt);
+    if (!entry) return false;
+    __CFTimerWheelUnlink(wheel, entry);
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, entry);
+    CFDictionaryRemoveValue(wheel->_entries, rlt);
+    return true;
+}
+
+static void __CFTimerWheelRemoveAllTimers(__CFTimerWheel *wheel) {
+    CFDictionaryApplyFunction(wheel->_entries, __CFTimerWheelFreeEntry, NULL);
+    CFDictionaryRemoveAllValues(wheel->_entries);
+    memset(wheel->_occupied, 0, sizeof(wheel->_occupied));
+    memset(wheel->_slots, 0, sizeof(wheel->_slots));
+    wheel->_overflow = NULL;
+    wheel->_expired = NULL;
+}
+
+CF_INLINE void __CFTimerWheelAccumulateDeadlines(CFRunLoopTimerRef t, uint64_t *softDeadline, uint64_t *hardDeadline) {
+    // discount timers currently firing
+    if (__CFRunLoopTimerIsFiring(t)) return;
+    // Later timers can only matter while they could share the firing of the earliest ones.
+    if (t->_fireTSR > *hardDeadline) return;
+
+    int32_t err = CF_NO_ERROR;
+    uint64_t oneTimerSoftDeadline = t->_fireTSR;
+    uint64_t oneTimerHardDeadline = __check_uint64_add_unsigned_unsigned(t->_fireTSR, __CFTimeIntervalToTSR(t->_tolerance), &err);
+    if (err != CF_NO_ERROR) oneTimerHardDeadline = UINT64_MAX;
+    if (oneTimerSoftDeadline < *softDeadline) *softDeadline = oneTimerSoftDeadline;
+    if (oneTimerHardDeadline < *hardDeadline) *hardDeadline = oneTimerHardDeadline;
+}
+
+// Computes the window in which the next timers may fire: the soft deadline is the first time any timer may fire,
+// the hard deadline the last time at which the earliest timers are still within their tolerance. Only the expired
+// list and single-tick slots are examined timer by timer; when the next timers sit in a coarser slot, the window
+// closes at the start of that slot, and waking up there cascades the slot into finer ones.
+static void __CFTimerWheelGetDeadlines(const __CFTimerWheel *wheel, uint64_t *softDeadline, uint64_t *hardDeadline) {
+    for (__CFTimerWheelEntry *entry = wheel->_expired; entry; entry = entry->_next) {
+        __CFTimerWheelAccumulateDeadlines(entry->_timer, softDeadline, hardDeadline);
+    }
+    for (CFIndex level = 0; level < __CFTimerWheelLevels; level++) {
+        uint64_t occupied = wheel->_occupied[level];
+        while (occupied) {
+            CFIndex slot = __builtin_ctzll(occupied);
+            occupied &= occupied - 1;
+            uint64_t startTSR = __CFTimerWheelSlotStartTick(wheel, level, slot) * wheel->_tickTSR;
+            if (startTSR > *hardDeadline) return;
+            if (0 < level) {
+                if (startTSR < *softDeadline) *softDeadline = startTSR;
+                *hardDeadline = startTSR;
+                return;
+            }
+            for (__CFTimerWheelEntry *entry = wheel->_slots[level][slot]; entry; entry = entry->_next) {
+                __CFTimerWheelAccumulateDeadlines(entry->_timer, softDeadline, hardDeadline);
+            }
+        }
+    }
+    for (__CFTimerWheelEntry *entry = wheel->_overflow; entry; entry = entry->_next) {
+        __CFTimerWheelAccumulateDeadlines(entry->_timer, softDeadline, hardDeadline);
+    }
+}
+
+// Returns the timer with the earliest fire TSR, firing or not.
+static CFRunLoopTimerRef __CFTimerWheelGetFirstTimer(const __CFTimerWheel *wheel) {
+    __CFTimerWheelEntry *list = wheel->_expired;
+    for (CFIndex level = 0; !list && level < __CFTimerWheelLevels; level++) {
+        if (wheel->_occupied[level]) list = wheel->_slots[level][__builtin_ctzll(wheel->_occupied[level])];
+    }
+    if (!list) list = wheel->_overflow;
+    CFRunLoopTimerRef first = NULL;
+    for (__CFTimerWheelEntry *entry = list; entry; entry = entry->_next) {
+        if (!first || entry->_timer->_fireTSR < first->_fireTSR) first = entry->_timer;
+    }
+    return first;
+}
+
+static CFComparisonResult __CFTimerWheelCompareFireTSR(const void *val1, const void *val2, void *context) {
+    CFRunLoopTimerRef rlt1 = (CFRunLoopTimerRef)val1;
+    CFRunLoopTimerRef rlt2 = (CFRunLoopTimerRef)val2;
+    if (rlt1->_fireTSR < rlt2->_fireTSR) return kCFCompareLessThan;
+    if (rlt1->_fireTSR > rlt2->_fireTSR) return kCFCompareGreaterThan;
+    return kCFCompareEqualTo;
+}
+
+// Advances the wheel to limitTSR and returns the valid, not firing timers due by then in fire order, or NULL if there are none.
+static CFMutableArrayRef __CFTimerWheelCopyDueTimers(__CFTimerWheel *wheel, uint64_t limitTSR) {
+    __CFTimerWheelAdvance(wheel, limitTSR);
+    CFMutableArrayRef timers = NULL;
+    for (__CFTimerWheelEntry *entry = wheel->_expired; entry; entry = entry->_next) {
+        CFRunLoopTimerRef rlt = entry->_timer;
+        if (__CFIsValid(rlt) && !__CFRunLoopTimerIsFiring(rlt) && rlt->_fireTSR <= limitTSR) {
+            if (!timers) timers = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
+            CFArrayAppendValue(timers, rlt);
+        }
+    }
+    if (timers && 1 < CFArrayGetCount(timers)) {
+        CFArraySortValues(timers, CFRangeMake(0, CFArrayGetCount(timers)), __CFTimerWheelCompareFireTSR, NULL);
+    }
+    return timers;
+}
+
 #pragma mark -
 
 /* CFRunLoop */
@@ -1292,32 +1574,20 @@ static void __CFRunLoopDeallocateObservers(const void *value, void *context) {
 
 static void __CFRunLoopDeallocateTimers(const void *value, void *context) {
     CFRunLoopModeRef rlm = (CFRunLoopModeRef)value;
-    if (NULL == rlm->_timers) return;
-    void (^deallocateTimers)(CFMutableArrayRef timers) = ^(CFMutableArrayRef timers) {
-        CFIndex idx, cnt;
-        const void **list, *buffer[256];
-        cnt = CFArrayGetCount(timers);
-        list = (const void **)((cnt <= 256) ? buffer : CFAllocatorAllocate(kCFAllocatorSystemDefault, cnt * sizeof(void *), 0));
-        CFArrayGetValues(timers, CFRangeMake(0, CFArrayGetCount(timers)), list);
-        for (idx = 0; idx < cnt; idx++) {
-            CFRetain(list[idx]);
-        }
-        CFArrayRemoveAllValues(timers);
-        for (idx = 0; idx < cnt; idx++) {
-            CFRunLoopTimerRef rlt = (CFRunLoopTimerRef)list[idx];
-            __CFRunLoopTimerLock(rlt);
-            // if the run loop is deallocating, and since a timer can only be in one
-            // run loop, we're going to be removing the timer from all modes, so be
-            // a little heavy-handed and direct
-            CFSetRemoveAllValues(rlt->_rlModes);
-            rlt->_runLoop = NULL;
-            __CFRunLoopTimerUnlock(rlt);
-            CFRelease(list[idx]);
-        }
-        if (list != buffer) CFAllocatorDeallocate(kCFAllocatorSystemDefault, list);
-    };
-    
-    if (rlm->_timers && CFArrayGetCount(rlm->_timers)) deallocateTimers(rlm->_timers);
+    if (NULL == rlm->_timers || 0 == __CFTimerWheelGetCount(rlm->_timers)) return;
+    CFArrayRef timers = __CFTimerWheelCopyTimers(rlm->_timers);
+    __CFTimerWheelRemoveAllTimers(rlm->_timers);
+    for (CFIndex idx = 0, cnt = CFArrayGetCount(timers); idx < cnt; idx++) {
+        CFRunLoopTimerRef rlt = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(timers, idx);
+        __CFRunLoopTimerLock(rlt);
+        // if the run loop is deallocating, and since a timer can only be in one
+        // run loop, we're going to be removing the timer from all modes, so be
+        // a little heavy-handed and direct
+        CFSetRemoveAllValues(rlt->_rlModes);
+        rlt->_runLoop = NULL;
+        __CFRunLoopTimerUnlock(rlt);
+    }
+    CFRelease(timers);
 }
 
 CF_EXPORT CFRunLoopRef _CFRunLoopGet0b(pthread_t t);
@@ -1957,73 +2227,16 @@ static Boolean __CFRunLoopDoSource1(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRun
     return sourceHandled;
 }
 
-static CFIndex __CFRunLoopInsertionIndexInTimerArray(CFArrayRef array, CFRunLoopTimerRef rlt) __attribute__((noinline));
-static CFIndex __CFRunLoopInsertionIndexInTimerArray(CFArrayRef array, CFRunLoopTimerRef rlt) {
-    CFIndex cnt = CFArrayGetCount(array);
-    if (cnt <= 0) {
-        return 0;
-    }
-    if (256 < cnt) {
-        CFRunLoopTimerRef item = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(array, cnt - 1);
-        if (item->_fireTSR <= rlt->_fireTSR) {
-            return cnt;
-        }
-        item = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(array, 0);
-        if (rlt->_fireTSR < item->_fireTSR) {
-            return 0;
-        }
-    }
-
-    CFIndex add = (1 << flsl(cnt)) * 2;
-    CFIndex idx = 0;
-    Boolean lastTestLEQ;
-    do {
-        add = add / 2;
-    lastTestLEQ = false;
-        CFIndex testIdx = idx + add;
-        if (testIdx < cnt) {
-            CFRunLoopTimerRef item = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(array, testIdx);
-            if (item->_fireTSR <= rlt->_fireTSR) {
-                idx = testIdx;
-        lastTestLEQ = true;
-            }
-        }
-    } while (0 < add);
-
-    return lastTestLEQ ? idx + 1 : idx;
-}
-
 static void __CFArmNextTimerInMode(CFRunLoopModeRef rlm, CFRunLoopRef rl) {    
     uint64_t nextHardDeadline = UINT64_MAX;
     uint64_t nextSoftDeadline = UINT64_MAX;
 
     if (rlm->_timers) {
-        // Look at the list of timers. We will calculate two TSR values; the next soft and next hard deadline.
-        // The next soft deadline is the first time we can fire any timer. This is the fire date of the first timer in our sorted list of timers.
-        // The next hard deadline is the last time at which we can fire the timer before we've moved out of the allowable tolerance of the timers in our list.
-        for (CFIndex idx = 0, cnt = CFArrayGetCount(rlm->_timers); idx < cnt; idx++) {
-            CFRunLoopTimerRef t = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(rlm->_timers , idx);
-            // discount timers currently firing
-            if (__CFRunLoopTimerIsFiring(t)) continue;
-            
-            int32_t err = CF_NO_ERROR;
-            uint64_t oneTimerSoftDeadline = t->_fireTSR;
-            uint64_t oneTimerHardDeadline = __check_uint64_add_unsigned_unsigned(t->_fireTSR, __CFTimeIntervalToTSR(t->_tolerance), &err);
-            if (err != CF_NO_ERROR) oneTimerHardDeadline = UINT64_MAX;
-            
-            // We can stop searching if the soft deadline for this timer exceeds the current hard deadline. Otherwise, later timers with lower tolerance could still have earlier hard deadlines.
-            if (oneTimerSoftDeadline > nextHardDeadline) {
-                break;
-            }
-            
-            if (oneTimerSoftDeadline < nextSoftDeadline) {
-                nextSoftDeadline = oneTimerSoftDeadline;
-            }
-            
-            if (oneTimerHardDeadline < nextHardDeadline) {
-                nextHardDeadline = oneTimerHardDeadline;
-            }
-        }
+        // Look at the wheel of timers. We will calculate two TSR values; the next soft and next hard deadline.
+        // The next soft deadline is the first time we can fire any timer.
+        // The next hard deadline is the last time at which we can fire the timer before we've moved out of the allowable tolerance of the timers in the wheel.
+        // Timers whose tolerance windows overlap are coalesced into the single wakeup at the hard deadline.
+        __CFTimerWheelGetDeadlines(rlm->_timers, &nextSoftDeadline, &nextHardDeadline);
         
         if (nextSoftDeadline < UINT64_MAX && (nextHardDeadline != rlm->_timerHardDeadline || nextSoftDeadline != rlm->_timerSoftDeadline)) {
             if (CFRUNLOOP_NEXT_TIMER_ARMED_ENABLED()) {
@@ -2069,8 +2282,9 @@ static void __CFArmNextTimerInMode(CFRunLoopModeRef rlm, CFRunLoopRef rl) {
             // WINOBJC: USE_MK_TIMER_TOO controls the existence of these members. Must guard use.
             #if USE_MK_TIMER_TOO
             if (rlm->_timerPort) {
+                // The port timer has no leeway, so arm it at the hard deadline to fire every timer in the window at once.
                 LARGE_INTEGER deadline = {};
-                deadline.QuadPart = nextSoftDeadline;
+                deadline.QuadPart = nextHardDeadline;
                 mk_timer_arm(rlm->_timerPort, deadline);
             }
             #endif
@@ -2104,24 +2318,18 @@ static void __CFRepositionTimerInMode(CFRunLoopModeRef rlm, CFRunLoopTimerRef rl
 static void __CFRepositionTimerInMode(CFRunLoopModeRef rlm, CFRunLoopTimerRef rlt, Boolean isInArray) {
     if (!rlt) return;
     
-    CFMutableArrayRef timerArray = rlm->_timers;
-    if (!timerArray) return;
-    Boolean found = false;
+    __CFTimerWheel *wheel = rlm->_timers;
+    if (!wheel) return;
     
-    // If we know in advance that the timer is not in the array (just being added now) then we can skip this search
+    // If we know in advance that the timer is not in the wheel (just being added now) then we can skip the lookup
     if (isInArray) {
-        CFIndex idx = CFArrayGetFirstIndexOfValue(timerArray, CFRangeMake(0, CFArrayGetCount(timerArray)), rlt);
-        if (kCFNotFound != idx) {
-            CFRetain(rlt);
-            CFArrayRemoveValueAtIndex(timerArray, idx);
-            found = true;
-        }
+        if (!__CFTimerWheelRepositionTimer(wheel, rlt)) return;
+    } else {
+        __CFTimerWheelAddTimer(wheel, rlt);
+        // A new timer that fires after the armed window cannot change the next wakeup
+        if (UINT64_MAX != rlm->_timerSoftDeadline && rlm->_timerHardDeadline < rlt->_fireTSR) return;
     }
-    if (!found && isInArray) return;
-    CFIndex newIdx = __CFRunLoopInsertionIndexInTimerArray(timerArray, rlt);
-    CFArrayInsertValueAtIndex(timerArray, newIdx, rlt);
     __CFArmNextTimerInMode(rlm, rlt->_runLoop);
-    if (isInArray) CFRelease(rlt);
 }
 
 
@@ -2261,17 +2469,9 @@ static Boolean __CFRunLoopDoTimer(CFRunLoopRef rl, CFRunLoopModeRef rlm, CFRunLo
 // rl and rlm are locked on entry and exit
 static Boolean __CFRunLoopDoTimers(CFRunLoopRef rl, CFRunLoopModeRef rlm, uint64_t limitTSR) {  /* DOES CALLOUT */
     Boolean timerHandled = false;
-    CFMutableArrayRef timers = NULL;
-    for (CFIndex idx = 0, cnt = rlm->_timers ? CFArrayGetCount(rlm->_timers) : 0; idx < cnt; idx++) {
-        CFRunLoopTimerRef rlt = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(rlm->_timers, idx);
-        
-        if (__CFIsValid(rlt) && !__CFRunLoopTimerIsFiring(rlt)) {
-            if (rlt->_fireTSR <= limitTSR) {
-                if (!timers) timers = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
-                CFArrayAppendValue(timers, rlt);
-            }
-        }
-    }
+    // Advancing the wheel cascades the timers due by limitTSR onto its expired list; an early wakeup at the start of a
+    // coarse slot just re-files that slot's timers, finds none due and lets the caller re-arm for the finer deadline.
+    CFMutableArrayRef timers = rlm->_timers ? __CFTimerWheelCopyDueTimers(rlm->_timers, limitTSR) : NULL;
     
     for (CFIndex idx = 0, cnt = timers ? CFArrayGetCount(timers) : 0; idx < cnt; idx++) {
         CFRunLoopTimerRef rlt = (CFRunLoopTimerRef)CFArrayGetValueAtIndex(timers, idx);
@@ -2902,7 +3102,7 @@ CFAbsoluteTime CFRunLoopGetNextTimerFireDate(CFRunLoopRef rl, CFStringRef modeNa
     __CFRunLoopLock(rl);
     CFRunLoopModeRef rlm = __CFRunLoopFindMode(rl, modeName, false);
     CFAbsoluteTime at = 0.0;
-    CFRunLoopTimerRef nextTimer = (rlm && rlm->_timers && 0 < CFArrayGetCount(rlm->_timers)) ? (CFRunLoopTimerRef)CFArrayGetValueAtIndex(rlm->_timers, 0) : NULL;
+    CFRunLoopTimerRef nextTimer = (rlm && rlm->_timers) ? __CFTimerWheelGetFirstTimer(rlm->_timers) : NULL;
     if (nextTimer) {
         at = CFRunLoopTimerGetNextFireDate(nextTimer);
     }
@@ -3334,8 +3534,7 @@ Boolean CFRunLoopContainsTimer(CFRunLoopRef rl, CFRunLoopTimerRef rlt, CFStringR
     CFRunLoopModeRef rlm = __CFRunLoopFindMode(rl, modeName, false);
     if (NULL != rlm) {
             if (NULL != rlm->_timers) {
-                CFIndex idx = CFArrayGetFirstIndexOfValue(rlm->_timers, CFRangeMake(0, CFArrayGetCount(rlm->_timers)), rlt);
-                hasValue = (kCFNotFound != idx);
+                hasValue = __CFTimerWheelContainsTimer(rlm->_timers, rlt);
             }
         __CFRunLoopModeUnlock(rlm);
     }
@@ -3365,9 +3564,7 @@ void CFRunLoopAddTimer(CFRunLoopRef rl, CFRunLoopTimerRef rlt, CFStringRef modeN
     CFRunLoopModeRef rlm = __CFRunLoopFindMode(rl, modeName, true);
     if (NULL != rlm) {
             if (NULL == rlm->_timers) {
-                CFArrayCallBacks cb = kCFTypeArrayCallBacks;
-                cb.equal = NULL;
-                rlm->_timers = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &cb);
+                rlm->_timers = __CFTimerWheelCreate();
             }
     }
     if (NULL != rlm && !CFSetContainsValue(rlt->_rlModes, rlm->_name)) {
@@ -3415,22 +3612,14 @@ void CFRunLoopRemoveTimer(CFRunLoopRef rl, CFRunLoopTimerRef rlt, CFStringRef mo
     }
     } else {
     CFRunLoopModeRef rlm = __CFRunLoopFindMode(rl, modeName, false);
-        CFIndex idx = kCFNotFound;
-        CFMutableArrayRef timerList = NULL;
-        if (NULL != rlm) {
-            timerList = rlm->_timers;
-            if (NULL != timerList) {
-                idx = CFArrayGetFirstIndexOfValue(timerList, CFRangeMake(0, CFArrayGetCount(timerList)), rlt);
-            }
-        }
-        if (kCFNotFound != idx) {
+        if (NULL != rlm && NULL != rlm->_timers && __CFTimerWheelContainsTimer(rlm->_timers, rlt)) {
             __CFRunLoopTimerLock(rlt);
             CFSetRemoveValue(rlt->_rlModes, rlm->_name);
             if (0 == CFSetGetCount(rlt->_rlModes)) {
                 rlt->_runLoop = NULL;
             }
             __CFRunLoopTimerUnlock(rlt);
-        CFArrayRemoveValueAtIndex(timerList, idx);
+            __CFTimerWheelRemoveTimer(rlm->_timers, rlt);
             __CFArmNextTimerInMode(rlm, rl);
         }
         if (NULL != rlm) {
@@ -990,6 +990,14 @@ typedef int socklen_t;
 #include <CoreFoundation/CFPropertyList.h>
 #include "CFInternal.h"
 
+#if DEPLOYMENT_TARGET_LINUX
+#include <sys/epoll.h>
+/* the socket manager waits on an epoll instance instead of select() when one can be created */
+#define USE_EPOLL_SOCKET_MANAGER 1
+#else
+#define USE_EPOLL_SOCKET_MANAGER 0
+#endif
+
 #ifndef NBBY
 #define NBBY 8
 #endif
@@ -1098,6 +1106,17 @@ static Boolean __CFReadSocketsTimeoutInvalid = true;  /* rebuild the timeout val
 static CFSocketNativeHandle __CFWakeupSocketPair[2] = {INVALID_SOCKET, INVALID_SOCKET};
 static void *__CFSocketManagerThread = NULL;
 
+#if USE_EPOLL_SOCKET_MANAGER
+/* With epoll, the read/write fd bitmaps still record what each socket is armed for, but the kernel
+ holds the interest list: every socket with a bit set is registered edge-triggered and one-shot,
+ so arming, disarming and re-arming after an event are each a single epoll_ctl() and the manager
+ never walks the full socket lists. __CFEpollSockets maps registered descriptors to their
+ (unretained) CFSocket. Both are controlled by __CFActiveSocketsLock. */
+static int __CFSocketEpollFd = -1;
+static CFMutableDictionaryRef __CFEpollSockets = NULL;
+#define EPOLL_EVENT_BATCH 256
+#endif
+
 static void __CFSocketDoCallback(CFSocketRef s, CFDataRef data, CFDataRef address, CFSocketNativeHandle sock);
 
 struct __CFSocket {
@@ -1259,6 +1278,51 @@ CF_INLINE Boolean __CFSocketFdClr(CFSocketNativeHandle sock, CFMutableDataRef fd
     return retval;
 }
 
+#if USE_EPOLL_SOCKET_MANAGER
+CF_INLINE Boolean __CFSocketFdIsSet(CFSocketNativeHandle sock, CFDataRef fdSet) {
+    if (INVALID_SOCKET != sock && 0 <= sock && sock < NBBY * CFDataGetLength(fdSet)) {
+        return FD_ISSET(sock, (fd_set *)CFDataGetBytePtr(fdSet)) ? true : false;
+    }
+    return false;
+}
+
+/* Brings the epoll registration for s in line with its bits in the read/write fd bitmaps.
+ Called with __CFActiveSocketsLock held. */
+static void __CFSocketEpollUpdate(CFSocketRef s) {
+    CFSocketNativeHandle sock = s->_socket;
+    if (0 > __CFSocketEpollFd || INVALID_SOCKET == sock || 0 > sock) return;
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    if (__CFSocketFdIsSet(sock, __CFReadSocketsFds)) event.events |= EPOLLIN | EPOLLRDHUP;
+    if (__CFSocketFdIsSet(sock, __CFWriteSocketsFds)) event.events |= EPOLLOUT;
+    event.data.fd = sock;
+    Boolean registered = CFDictionaryContainsKey(__CFEpollSockets, (void *)(uintptr_t)sock);
+    if (0 == event.events) {
+        if (registered) {
+            epoll_ctl(__CFSocketEpollFd, EPOLL_CTL_DEL, sock, &event);
+            CFDictionaryRemoveValue(__CFEpollSockets, (void *)(uintptr_t)sock);
+        }
+        return;
+    }
+    event.events |= EPOLLET | EPOLLONESHOT;
+    int error = epoll_ctl(__CFSocketEpollFd, registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, sock, &event);
+    if (0 > error && ENOENT == errno) {
+        /* the descriptor was closed (and maybe reused) behind our back, which drops it from the epoll set */
+        error = epoll_ctl(__CFSocketEpollFd, EPOLL_CTL_ADD, sock, &event);
+    } else if (0 > error && EEXIST == errno) {
+        error = epoll_ctl(__CFSocketEpollFd, EPOLL_CTL_MOD, sock, &event);
+    }
+    if (0 > error) {
+#if defined(LOG_CFSOCKET)
+        fprintf(stdout, "epoll_ctl failed for socket %d, errno %d\n", sock, errno);
+#endif
+        CFDictionaryRemoveValue(__CFEpollSockets, (void *)(uintptr_t)sock);
+    } else {
+        CFDictionarySetValue(__CFEpollSockets, (void *)(uintptr_t)sock, s);
+    }
+}
+#endif
+
 static SInt32 __CFSocketCreateWakeupSocketPair(void) {
 #if DEPLOYMENT_TARGET_MACOSX || DEPLOYMENT_TARGET_EMBEDDED || DEPLOYMENT_TARGET_EMBEDDED_MINI
     SInt32 error;
@@ -1304,9 +1368,28 @@ static SInt32 __CFSocketCreateWakeupSocketPair(void) {
 
 // Version 0 RunLoopSources set a mask in an FD set to control what socket activity we hear about.
 // Changes to the master fs_sets occur via these 4 functions.
+#if USE_EPOLL_SOCKET_MANAGER
+// With epoll the change is handed straight to the kernel, so the manager thread only needs waking
+// when the socket takes part in the read timeout calculation. Returns true if no wakeup is needed.
+CF_INLINE Boolean __CFSocketEpollArmed(CFSocketRef s, Boolean isRead) {
+    __CFSocketEpollUpdate(s);
+    if (isRead && (timerisset(&s->_readBufferTimeout) || s->_leftoverBytes)) {
+        __CFReadSocketsTimeoutInvalid = true;
+        return false;
+    }
+    return true;
+}
+#endif
+
 CF_INLINE Boolean __CFSocketSetFDForRead(CFSocketRef s) {
+#if USE_EPOLL_SOCKET_MANAGER
+    Boolean b = __CFSocketFdSet(s->_socket, __CFReadSocketsFds);
+    if (0 > __CFSocketEpollFd) __CFReadSocketsTimeoutInvalid = true;
+    else if (b && __CFSocketEpollArmed(s, true)) return b;
+#else
     __CFReadSocketsTimeoutInvalid = true;
     Boolean b = __CFSocketFdSet(s->_socket, __CFReadSocketsFds);
+#endif
     if (b && INVALID_SOCKET != __CFWakeupSocketPair[0]) {
         uint8_t c = 'r';
         send(__CFWakeupSocketPair[0], (const char *)&c, sizeof(c), 0);
@@ -1315,8 +1398,14 @@ CF_INLINE Boolean __CFSocketSetFDForRead(CFSocketRef s) {
 }
 
 CF_INLINE Boolean __CFSocketClearFDForRead(CFSocketRef s) {
+#if USE_EPOLL_SOCKET_MANAGER
+    Boolean b = __CFSocketFdClr(s->_socket, __CFReadSocketsFds);
+    if (0 > __CFSocketEpollFd) __CFReadSocketsTimeoutInvalid = true;
+    else if (b && __CFSocketEpollArmed(s, true)) return b;
+#else
     __CFReadSocketsTimeoutInvalid = true;
     Boolean b = __CFSocketFdClr(s->_socket, __CFReadSocketsFds);
+#endif
     if (b && INVALID_SOCKET != __CFWakeupSocketPair[0]) {
         uint8_t c = 's';
         send(__CFWakeupSocketPair[0], (const char *)&c, sizeof(c), 0);
@@ -1327,6 +1416,9 @@ CF_INLINE Boolean __CFSocketClearFDForRead(CFSocketRef s) {
 CF_INLINE Boolean __CFSocketSetFDForWrite(CFSocketRef s) {
     // CFLog(5, CFSTR("__CFSocketSetFDForWrite(%p)"), s);
     Boolean b = __CFSocketFdSet(s->_socket, __CFWriteSocketsFds);
+#if USE_EPOLL_SOCKET_MANAGER
+    if (b && 0 <= __CFSocketEpollFd && __CFSocketEpollArmed(s, false)) return b;
+#endif
     if (b && INVALID_SOCKET != __CFWakeupSocketPair[0]) {
         uint8_t c = 'w';
         send(__CFWakeupSocketPair[0], (const char *)&c, sizeof(c), 0);
@@ -1337,6 +1429,9 @@ CF_INLINE Boolean __CFSocketSetFDForWrite(CFSocketRef s) {
 CF_INLINE Boolean __CFSocketClearFDForWrite(CFSocketRef s) {
     // CFLog(5, CFSTR("__CFSocketClearFDForWrite(%p)"), s);
     Boolean b = __CFSocketFdClr(s->_socket, __CFWriteSocketsFds);
+#if USE_EPOLL_SOCKET_MANAGER
+    if (b && 0 <= __CFSocketEpollFd && __CFSocketEpollArmed(s, false)) return b;
+#endif
     if (b && INVALID_SOCKET != __CFWakeupSocketPair[0]) {
         uint8_t c = 'x';
         send(__CFWakeupSocketPair[0], (const char *)&c, sizeof(c), 0);
@@ -1401,6 +1496,26 @@ static void __CFSocketInitializeSockets(void) {
         ioctlsocket(__CFWakeupSocketPair[0], FIONBIO, (u_long *)&yes);
         ioctlsocket(__CFWakeupSocketPair[1], FIONBIO, (u_long *)&yes);
         __CFSocketFdSet(__CFWakeupSocketPair[1], __CFReadSocketsFds);
+#if USE_EPOLL_SOCKET_MANAGER
+        /* CFSocketUseSelect keeps the select() manager, e.g. to compare the two */
+        if (NULL == __CFgetenv("CFSocketUseSelect")) {
+            __CFSocketEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        }
+        if (0 <= __CFSocketEpollFd) {
+            /* the wakeup socket stays level-triggered; the manager drains it whenever it fires */
+            struct epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.fd = __CFWakeupSocketPair[1];
+            if (0 > epoll_ctl(__CFSocketEpollFd, EPOLL_CTL_ADD, __CFWakeupSocketPair[1], &event)) {
+                close(__CFSocketEpollFd);
+                __CFSocketEpollFd = -1;
+            }
+        }
+        if (0 <= __CFSocketEpollFd) {
+            __CFEpollSockets = CFDictionaryCreateMutable(kCFAllocatorSystemDefault, 0, NULL, NULL);
+        }
+#endif
     }
 }
 
@@ -1450,9 +1565,27 @@ static CFRunLoopRef __CFSocketCopyRunLoopToWakeUp(CFRunLoopSourceRef src, CFMuta
     return rl;
 }
 
+// The socket manager signals every ready socket's source before waking anything, collecting the run loops
+// in wakeUps so that a run loop serving many sockets is woken once per batch rather than once per socket.
+static void __CFSocketWakeUpRunLoop(CFRunLoopRef rl, CFMutableArrayRef wakeUps) {
+    if (NULL == wakeUps) {
+        CFRunLoopWakeUp(rl);
+    } else if (!CFArrayContainsValue(wakeUps, CFRangeMake(0, CFArrayGetCount(wakeUps)), rl)) {
+        CFArrayAppendValue(wakeUps, rl);
+    }
+}
+
+static void __CFSocketWakeUpRunLoops(CFMutableArrayRef wakeUps) {
+    CFIndex idx, cnt = CFArrayGetCount(wakeUps);
+    for (idx = 0; idx < cnt; idx++) {
+        CFRunLoopWakeUp((CFRunLoopRef)CFArrayGetValueAtIndex(wakeUps, idx));
+    }
+    CFArrayRemoveAllValues(wakeUps);
+}
+
 // If callBackNow, we immediately do client callbacks, else we have to signal a v0 RunLoopSource so the
-// callbacks can happen in another thread.
-static void __CFSocketHandleWrite(CFSocketRef s, Boolean callBackNow) {
+// callbacks can happen in another thread; the run loop to wake is added to wakeUps if it is non-NULL.
+static void __CFSocketHandleWrite(CFSocketRef s, Boolean callBackNow, CFMutableArrayRef wakeUps) {
     SInt32 errorCode = 0;
     int errorSize = sizeof(errorCode);
     CFOptionFlags writeCallBacksAvailable;
@@ -1491,7 +1624,7 @@ static void __CFSocketHandleWrite(CFSocketRef s, Boolean callBackNow) {
         CFRunLoopRef rl = __CFSocketCopyRunLoopToWakeUp(source0, runLoopsCopy);
         if (source0) CFRelease(source0);
         if (NULL != rl) {
-            CFRunLoopWakeUp(rl);
+            __CFSocketWakeUpRunLoop(rl, wakeUps);
             CFRelease(rl);
         }
         __CFSocketLock(s);
@@ -1562,7 +1695,7 @@ CFStringRef copyLocalAddress(CFAllocatorRef alloc, CFSocketNativeHandle s)
 
 #endif
 
-static void __CFSocketHandleRead(CFSocketRef s, Boolean causedByTimeout)
+static void __CFSocketHandleRead(CFSocketRef s, Boolean causedByTimeout, CFMutableArrayRef wakeUps)
 {
     CFDataRef data = NULL, address = NULL;
     CFSocketNativeHandle sock = INVALID_SOCKET;
@@ -1772,7 +1905,7 @@ static void __CFSocketHandleRead(CFSocketRef s, Boolean causedByTimeout)
     CFRunLoopRef rl = __CFSocketCopyRunLoopToWakeUp(source0, runLoopsCopy);
     if (source0) CFRelease(source0);
     if (NULL != rl) {
-        CFRunLoopWakeUp(rl);
+        __CFSocketWakeUpRunLoop(rl, wakeUps);
         CFRelease(rl);
     }
     __CFSocketLock(s);
@@ -2096,6 +2229,136 @@ manageSelectError()
     }
 }
 
+#if USE_EPOLL_SOCKET_MANAGER
+/* Same contract as the select() loop below, but the kernel keeps the interest list. Every socket is
+ registered one-shot, so a reported socket is dropped from the bitmap it fired for exactly as the select()
+ loop does, and re-armed by the read/write handling or the perform function through the usual
+ __CFSocketSetFDFor* calls. The socket lists are only walked when read timeouts are in play. */
+static void *__CFSocketEpollManager(void *arg)
+{
+    struct epoll_event events[EPOLL_EVENT_BATCH];
+    SInt32 idx, cnt, nevents;
+    uint8_t buffer[256];
+    CFMutableArrayRef selectedWriteSockets = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
+    CFMutableArrayRef selectedReadSockets = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
+    CFMutableArrayRef wakeUps = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
+    
+    struct timeval tv;
+    struct timeval* pTimeout = NULL;
+    
+    for (;;) {
+        __CFLock(&__CFActiveSocketsLock);
+        __CFSocketManagerIteration++;
+        if (__CFReadSocketsTimeoutInvalid) {
+            struct timeval* minTimeout = NULL;
+            __CFReadSocketsTimeoutInvalid = false;
+            CFArrayApplyFunction(__CFReadSockets, CFRangeMake(0, CFArrayGetCount(__CFReadSockets)), _calcMinTimeout_locked, (void*) &minTimeout);
+            if (minTimeout == NULL) {
+                pTimeout = NULL;
+            } else {
+                tv = *minTimeout;
+                pTimeout = &tv;
+            }
+        }
+        __CFUnlock(&__CFActiveSocketsLock);
+        
+        int timeoutMs = -1;
+        if (pTimeout) {
+            timeoutMs = (INT_MAX / 1000 <= pTimeout->tv_sec) ? INT_MAX : (int)(pTimeout->tv_sec * 1000 + (pTimeout->tv_usec + 999) / 1000);
+        }
+        nevents = epoll_wait(__CFSocketEpollFd, events, EPOLL_EVENT_BATCH, timeoutMs);
+        
+#if defined(LOG_CFSOCKET)
+        fprintf(stdout, "socket manager woke from epoll_wait, ret=%ld\n", (long)nevents);
+#endif
+        if (0 > nevents) {
+            /* EINTR; nothing was reported */
+            continue;
+        }
+        
+        Boolean timedOut = (0 == nevents);
+        __CFLock(&__CFActiveSocketsLock);
+        if (timedOut) {
+            /* expire every socket with a read timeout, as the select() loop does */
+            cnt = CFArrayGetCount(__CFReadSockets);
+            for (idx = 0; idx < cnt; idx++) {
+                CFSocketRef s = (CFSocketRef)CFArrayGetValueAtIndex(__CFReadSockets, idx);
+                if ((timerisset(&s->_readBufferTimeout) || s->_leftoverBytes) && INVALID_SOCKET != s->_socket) {
+#if defined(LOG_CFSOCKET)
+                    fprintf(stdout, "Expiring socket %d (delta %ld, %d)\n", s->_socket, s->_readBufferTimeout.tv_sec, s->_readBufferTimeout.tv_usec);
+#endif
+                    CFArrayAppendValue(selectedReadSockets, s);
+                    /* socket is removed from fds here, will be restored in read handling or in perform function */
+                    __CFSocketFdClr(s->_socket, __CFReadSocketsFds);
+                    __CFSocketEpollUpdate(s);
+                }
+            }
+        }
+        for (idx = 0; idx < nevents; idx++) {
+            CFSocketNativeHandle sock = events[idx].data.fd;
+            if (sock == __CFWakeupSocketPair[1]) {
+                while (0 < recv(__CFWakeupSocketPair[1], (char *)buffer, sizeof(buffer), 0)) {
+                }
+                continue;
+            }
+            CFSocketRef s = (CFSocketRef)CFDictionaryGetValue(__CFEpollSockets, (void *)(uintptr_t)sock);
+            if (NULL == s) continue;
+            /* errors and hangups are reported to whichever directions the socket is armed for */
+            uint32_t fired = events[idx].events;
+            Boolean failed = (0 != (fired & (EPOLLERR | EPOLLHUP)));
+            if ((failed || (fired & EPOLLOUT)) && __CFSocketFdClr(sock, __CFWriteSocketsFds)) {
+                CFArrayAppendValue(selectedWriteSockets, s);
+            }
+            if ((failed || (fired & (EPOLLIN | EPOLLRDHUP))) && __CFSocketFdClr(sock, __CFReadSocketsFds)) {
+                s->_hitTheTimeout = false;
+                CFArrayAppendValue(selectedReadSockets, s);
+            }
+            /* the one-shot registration is spent; re-arm whatever the socket still waits for */
+            __CFSocketEpollUpdate(s);
+        }
+        if (pTimeout && !timedOut) {
+            struct timeval timeNow;
+            gettimeofday(&timeNow, NULL);
+            cnt = CFArrayGetCount(__CFReadSockets);
+            for (idx = 0; idx < cnt; idx++) {
+                CFSocketRef s = (CFSocketRef)CFArrayGetValueAtIndex(__CFReadSockets, idx);
+                if (timerisset(&s->_readBufferTimeoutNotificationTime) &&
+                    timercmp(&timeNow, &s->_readBufferTimeoutNotificationTime, >) &&
+                    __CFSocketFdClr(s->_socket, __CFReadSocketsFds))
+                {
+                    s->_hitTheTimeout = true;
+                    CFArrayAppendValue(selectedReadSockets, s);
+                    __CFSocketEpollUpdate(s);
+                }
+            }
+        }
+        __CFUnlock(&__CFActiveSocketsLock);
+        
+        cnt = CFArrayGetCount(selectedWriteSockets);
+        for (idx = 0; idx < cnt; idx++) {
+            CFSocketRef s = (CFSocketRef)CFArrayGetValueAtIndex(selectedWriteSockets, idx);
+#if defined(LOG_CFSOCKET)
+            fprintf(stdout, "socket manager signaling socket %d for write\n", s->_socket);
+#endif
+            __CFSocketHandleWrite(s, FALSE, wakeUps);
+        }
+        CFArrayRemoveAllValues(selectedWriteSockets);
+        
+        cnt = CFArrayGetCount(selectedReadSockets);
+        for (idx = 0; idx < cnt; idx++) {
+            CFSocketRef s = (CFSocketRef)CFArrayGetValueAtIndex(selectedReadSockets, idx);
+#if defined(LOG_CFSOCKET)
+            fprintf(stdout, "socket manager signaling socket %d for read\n", s->_socket);
+#endif
+            __CFSocketHandleRead(s, timedOut || s->_hitTheTimeout, wakeUps);
+        }
+        CFArrayRemoveAllValues(selectedReadSockets);
+        __CFSocketWakeUpRunLoops(wakeUps);
+    }
+    return NULL;
+}
+#endif
+
 static void *__CFSocketManager(void * arg)
 {
 #if DEPLOYMENT_TARGET_LINUX || DEPLOYMENT_TARGET_FREEBSD
@@ -2104,6 +2367,9 @@ static void *__CFSocketManager(void * arg)
     pthread_setname_np("com.apple.CFSocket.private");
 #endif
     if (objc_collectingEnabled()) objc_registerThreadWithCollector();
+#if USE_EPOLL_SOCKET_MANAGER
+    if (0 <= __CFSocketEpollFd) return __CFSocketEpollManager(arg);
+#endif
     SInt32 nrfds, maxnrfds, fdentries = 1;
     SInt32 rfds, wfds;
     fd_set *exceptfds = NULL;
@@ -2115,6 +2381,7 @@ static void *__CFSocketManager(void * arg)
     CFMutableArrayRef selectedWriteSockets = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
     CFMutableArrayRef selectedReadSockets = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
     CFIndex selectedWriteSocketsIndex = 0, selectedReadSocketsIndex = 0;
+    CFMutableArrayRef wakeUps = CFArrayCreateMutable(kCFAllocatorSystemDefault, 0, &kCFTypeArrayCallBacks);
     
     struct timeval tv;
     struct timeval* pTimeout = NULL;
@@ -2303,7 +2570,7 @@ static void *__CFSocketManager(void * arg)
 #if defined(LOG_CFSOCKET)
             fprintf(stdout, "socket manager signaling socket %d for write\n", s->_socket);
 #endif
-            __CFSocketHandleWrite(s, FALSE);
+            __CFSocketHandleWrite(s, FALSE, wakeUps);
             CFArraySetValueAtIndex(selectedWriteSockets, idx, kCFNull);
         }
         selectedWriteSocketsIndex = 0;
@@ -2314,10 +2581,11 @@ static void *__CFSocketManager(void * arg)
 #if defined(LOG_CFSOCKET)
             fprintf(stdout, "socket manager signaling socket %d for read\n", s->_socket);
 #endif
-            __CFSocketHandleRead(s, nrfds == 0 || s->_hitTheTimeout);
+            __CFSocketHandleRead(s, nrfds == 0 || s->_hitTheTimeout, wakeUps);
             CFArraySetValueAtIndex(selectedReadSockets, idx, kCFNull);
         }
         selectedReadSocketsIndex = 0;
+        __CFSocketWakeUpRunLoops(wakeUps);
     }
     return NULL;
 }
@@ -139,6 +139,16 @@ typedef struct _PageEntry {
     UInt8 string[];
 } PageEntry;
 
+CF_INLINE uint32_t getPackedPageEntrySize(PageEntryPacked *entry)
+{
+    return sizeof(PageEntryPacked) + entry->strlen;
+}
+
+CF_INLINE uint32_t getPageEntrySize(PageEntry *entry)
+{
+    return sizeof(PageEntry) + entry->strlen;
+}
+
 typedef struct _TrieHeader {
     uint32_t signature;
     uint32_t rootOffset; 
@@ -254,7 +264,7 @@ struct _CFBurstTrie {
     uint32_t cflags;
     uint32_t count;
     uint32_t containerSize;
-    int retain;
+    volatile int32_t retain;
 #if DEPLOYMENT_TARGET_WINDOWS
     HANDLE mapHandle;
     HANDLE mappedFileHandle;
@@ -357,20 +367,37 @@ CFBurstTrieRef CFBurstTrieCreateFromFile(CFStringRef path) {
     /* Check if file exists */
     if (stat(filename, &sb) != 0) return NULL;
 
+    /* Check that the file is large enough to hold a header */
+    if (sb.st_size < sizeof(fileHeader) || sb.st_size > UINT32_MAX) return NULL;
+
     /* Check if file can be opened */
     if ((fd=open(filename, CF_OPENFLGS|O_RDONLY)) < 0) return NULL;
     
 #if DEPLOYMENT_TARGET_WINDOWS
     HANDLE mappedFileHandle = (HANDLE)_get_osfhandle(fd);   
-    if (!mappedFileHandle) return NULL;
+    if (!mappedFileHandle) {
+        close(fd);
+        return NULL;
+    }
     
     HANDLE mapHandle = CreateFileMapping(mappedFileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
-    if (!mapHandle) return NULL;
+    if (!mapHandle) {
+        close(fd);
+        return NULL;
+    }
     
     char *map = (char *)MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, sb.st_size);
-    if (!map) return NULL;
+    if (!map) {
+        CloseHandle(mapHandle);
+        close(fd);
+        return NULL;
+    }
 #else            
-    char *map = mmap(0, sb.st_size, PROT_READ, MAP_FILE|MAP_SHARED, fd, 0);
+    char *map = (char *)mmap(0, sb.st_size, PROT_READ, MAP_FILE|MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
 #endif
     
     CFBurstTrieRef trie = NULL;
@@ -391,7 +418,7 @@ CFBurstTrieRef CFBurstTrieCreateFromFile(CFStringRef path) {
         // On Windows, the file being mapped must stay open as long as the map exists. Don't close it early. Other platforms close it here.
         close(fd);
 #endif
-    } else if (header->signature == 0xcafebabe || header->signature == 0x0ddba11) {
+    } else if (sb.st_size >= sizeof(TrieHeader) && (header->signature == 0xcafebabe || header->signature == 0x0ddba11)) {
         trie = (CFBurstTrieRef) calloc(1, sizeof(struct _CFBurstTrie));
         trie->mapBase = map;
         trie->mapSize = CFSwapInt32LittleToHost(sb.st_size); 
@@ -406,6 +433,12 @@ CFBurstTrieRef CFBurstTrieCreateFromFile(CFStringRef path) {
         close(fd);
 #endif
     } else {
+#if DEPLOYMENT_TARGET_WINDOWS
+        UnmapViewOfFile(map);
+        CloseHandle(mapHandle);
+#else
+        munmap(map, sb.st_size);
+#endif
         close(fd);
     }
     return trie;
@@ -416,7 +449,7 @@ CFBurstTrieRef CFBurstTrieCreateFromMapBytes(char *mapBase) {
     TrieHeader *header = (TrieHeader *)mapBase;
 
     if (mapBase && ((uint32_t*)mapBase)[0] == 0xbabeface) {
-        trie = (CFBurstTrieRef) malloc(sizeof(struct _CFBurstTrie));
+        trie = (CFBurstTrieRef) calloc(1, sizeof(struct _CFBurstTrie));
         trie->mapBase = mapBase;
         trie->mapSize = CFSwapInt32LittleToHost(((fileHeader*)trie->mapBase)->size);
         trie->mapOffset = CFSwapInt32LittleToHost(((fileHeader*)trie->mapBase)->rootOffset);
@@ -424,7 +457,7 @@ CFBurstTrieRef CFBurstTrieCreateFromMapBytes(char *mapBase) {
         trie->count = CFSwapInt32LittleToHost(((fileHeader*)trie->mapBase)->count);
         trie->retain = 1;
     } else if (mapBase && (header->signature == 0xcafebabe || header->signature == 0x0ddba11)) {
-        trie = (CFBurstTrieRef) malloc(sizeof(struct _CFBurstTrie));
+        trie = (CFBurstTrieRef) calloc(1, sizeof(struct _CFBurstTrie));
         trie->mapBase = mapBase;
         trie->mapSize = CFSwapInt32LittleToHost(header->size);
         trie->cflags = CFSwapInt32LittleToHost(header->flags);
@@ -654,7 +687,14 @@ Boolean CFBurstTrieSerializeWithFileDescriptor(CFBurstTrieRef trie, int fd, CFBu
         trie->mapHandle = mapHandle;
         trie->mappedFileHandle = mappedFileHandle;
 #else
-        trie->mapBase = mmap(0, trie->mapSize, PROT_READ, MAP_FILE|MAP_SHARED, fd, start_offset);
+        char *map = (char *)mmap(0, trie->mapSize, PROT_READ, MAP_FILE|MAP_SHARED, fd, start_offset);
+        if (map == MAP_FAILED) {
+            // The in-memory levels were consumed by serialization, so the trie is left empty.
+            bzero(&trie->root, sizeof(trie->root));
+            trie->count = 0;
+            return success;
+        }
+        trie->mapBase = map;
 #endif
         success = true;
     }
@@ -688,13 +728,12 @@ CFIndex CFBurstTrieGetCount(CFBurstTrieRef trie) {
 }
 
 CFBurstTrieRef CFBurstTrieRetain(CFBurstTrieRef trie) {
-    trie->retain++;
+    OSAtomicIncrement32Barrier(&trie->retain);
     return trie;
 }
 
 void CFBurstTrieRelease(CFBurstTrieRef trie) {
-    trie->retain--;
-    if (trie->retain == 0) destroyCFBurstTrie(trie);
+    if (OSAtomicDecrement32Barrier(&trie->retain) == 0) destroyCFBurstTrie(trie);
     return;
 }
 
@@ -826,6 +865,132 @@ void CFBurstTrieTraverseFromCursor(CFBurstTrieCursorRef cursor, void *ctx, CFBur
     free(bytes);
 }
 
+typedef struct _PrefixTraverseContext {
+    void *context;
+    CFBurstTrieTraversalCallback callback;
+} PrefixTraverseContext;
+
+static bool foundKeyWithPrefix(void *context, const uint8_t *key, uint32_t payload, bool exact)
+{
+    PrefixTraverseContext *ctx = (PrefixTraverseContext *)context;
+    Boolean stop = FALSE;
+    ctx->callback(ctx->context, key, (uint32_t)strlen((const char *)key), payload, &stop);
+    return stop;
+}
+
+// The mapped traversals build keys in a buffer with a byte to spare, which terminates them before they are passed on.
+static void foundMappedKeyWithPrefix(void *context, const UInt8 *key, uint32_t keyLength, uint32_t payload, Boolean *stop)
+{
+    PrefixTraverseContext *ctx = (PrefixTraverseContext *)context;
+    ((UInt8 *)key)[keyLength] = 0;
+    ctx->callback(ctx->context, key, keyLength, payload, stop);
+}
+
+/*
+ The cursor only stops on page entries part way through a key, so prefixes are followed through the levels here and
+ the page they end in is scanned in full, rebuilding each key in place after the bytes already matched.
+ */
+static void traverseMappedPageWithPrefix(CFBurstTrieRef trie, Page *page, UInt8 *bytes, uint32_t matched, uint32_t length, Boolean *stop, void *ctx, CFBurstTrieTraversalCallback callback)
+{
+    uint32_t pageSize = page->length - sizeof(Page);
+    uint32_t remaining = length - matched;
+    uint32_t offset = 0;
+    UInt8 *key = (UInt8*)malloc(MAX_KEY_LENGTH);
+    while (offset < pageSize) {
+        uint32_t keylen;
+        uint32_t payload;
+        if (trie->cflags & kCFBurstTrieSortByKey) {
+            PageEntry *entry = (PageEntry*)&page->data[offset];
+            memcpy(key, entry->string, entry->strlen);
+            keylen = entry->strlen;
+            payload = entry->payload;
+            offset += getPageEntrySize(entry);
+        } else {
+            PageEntryPacked *entry = (PageEntryPacked*)&page->data[offset];
+            memcpy(key + entry->pfxLen, entry->string, entry->strlen);
+            keylen = entry->pfxLen + entry->strlen;
+            payload = entry->payload;
+            offset += getPackedPageEntrySize(entry);
+        }
+
+        if (payload && keylen >= remaining && matched + keylen < MAX_KEY_LENGTH && memcmp(key, bytes + matched, remaining) == 0) {
+            memcpy(bytes + matched, key, keylen);
+            callback(ctx, bytes, matched + keylen, payload, stop);
+            if (*stop)
+                break;
+        }
+    }
+    free(key);
+}
+
+static void traverseMappedWithPrefix(CFBurstTrieRef trie, uint32_t next, UInt8 *bytes, uint32_t length, uint32_t matched, Boolean *stop, void *ctx, CFBurstTrieTraversalCallback callback)
+{
+    TrieHeader *header = (TrieHeader*)trie->mapBase;
+    while (matched < length) {
+        uint8_t c = bytes[matched];
+        if (DiskNextTrie_GetKind(next) == TrieKind || next == header->rootOffset) {
+            MapTrieLevelRef level = (MapTrieLevelRef)DiskNextTrie_GetPtr(trie->mapBase, next);
+            next = (uint32_t)level->slots[c];
+        } else if (DiskNextTrie_GetKind(next) == CompactTrieKind) {
+            CompactMapTrieLevelRef level = (CompactMapTrieLevelRef)DiskNextTrie_GetPtr(trie->mapBase, next);
+            uint8_t slot = c / 64;
+            uint8_t bit = c % 64;
+            uint64_t bword = level->bitmap[slot];
+            if (!(bword & (1ull << bit)))
+                return;
+            uint32_t item = 0;
+            for (int i = 0; i < slot; ++i)
+                item += __builtin_popcountll(level->bitmap[i]);
+            item += __builtin_popcountll(bword & ((1ull << bit)-1));
+            next = level->slots[item];
+        } else if (DiskNextTrie_GetKind(next) == ListKind) {
+            traverseMappedPageWithPrefix(trie, (Page *)DiskNextTrie_GetPtr(trie->mapBase, next), bytes, matched, length, stop, ctx, callback);
+            return;
+        } else {
+            return;
+        }
+        matched++;
+    }
+
+    if (DiskNextTrie_GetKind(next) == ListKind) {
+        traverseMappedPageWithPrefix(trie, (Page *)DiskNextTrie_GetPtr(trie->mapBase, next), bytes, matched, length, stop, ctx, callback);
+    } else {
+        CompactMapCursor cursor;
+        cursor.next = next;
+        cursor.isOnPage = FALSE;
+        cursor.entryOffsetInPage = 0;
+        cursor.offsetInEntry = 0;
+        cursor.payload = 0;
+        traverseFromMapCursor(trie, &cursor, bytes, MAX_KEY_LENGTH - length, length, stop, ctx, callback);
+    }
+}
+
+void CFBurstTrieTraverseWithPrefix(CFBurstTrieRef trie, const UInt8 *prefix, CFIndex length, void *ctx, CFBurstTrieTraversalCallback callback)
+{
+    if (!trie || !callback || length < 0 || length >= MAX_KEY_LENGTH)
+        return;
+
+    // The legacy format cannot be traversed.
+    if (trie->mapBase && ((fileHeader *)trie->mapBase)->signature == 0xbabeface)
+        return;
+
+    PrefixTraverseContext context;
+    context.context = ctx;
+    context.callback = callback;
+    if (trie->mapBase && (trie->cflags & (kCFBurstTriePrefixCompression | kCFBurstTrieSortByKey))) {
+        // Keys are built up after the prefix, so the callback sees them in full. The extra byte is for the terminator.
+        UInt8 *bytes = (UInt8*)malloc(MAX_KEY_LENGTH + 1);
+        if (length > 0)
+            memcpy(bytes, prefix, length);
+        Boolean stop = FALSE;
+        traverseMappedWithPrefix(trie, ((TrieHeader *)trie->mapBase)->rootOffset, bytes, (uint32_t)length, 0, &stop, &context, foundMappedKeyWithPrefix);
+        free(bytes);
+    } else {
+        void *cursor = 0;
+        traverseCFBurstTrieWithCursor(trie, prefix ? prefix : (const uint8_t *)"", (uint32_t)length, &cursor, false, &context, foundKeyWithPrefix);
+    }
+}
+
 #if 0
 #pragma mark -
 #pragma mark Insertion
@@ -1007,6 +1172,7 @@ static void findCFBurstTrieLevel(CFBurstTrieRef trie, TrieCursor *cursor, bool e
         }
     } else {
         TrieLevelRef root = (TrieLevelRef)NextTrie_GetPtr(cursor->next);
+        cursor->key[cursor->keylen] = 0;
         if (root->payload && callback(ctx, cursor->key, root->payload, cursor->prefixlen==cursor->keylen)) return;
         if (cursor->keylen == cursor->prefixlen && exactmatch) return;
         traverseCFBurstTrieLevel(trie, root, cursor, exactmatch, ctx, callback);
@@ -1041,6 +1207,7 @@ static void findCFBurstTrieCompactMappedLevel(CFBurstTrieRef trie, MapCursor *cu
             }
         }
     } else {
+        cursor->key[cursor->keylen] = 0;
         if(root->payload && callback(ctx, cursor->key, root->payload, cursor->prefixlen==cursor->keylen)) return;
         if (cursor->keylen == cursor->prefixlen && exactmatch) return;
         traverseCFBurstTrieCompactMappedLevel(trie, root, cursor,  exactmatch, ctx, callback);
@@ -1063,6 +1230,7 @@ static void findCFBurstTrieMappedLevel(CFBurstTrieRef trie, MapCursor *cursor, b
             findCFBurstTrieMappedPage(trie, cursor, ctx, callback);
         }
     }  else {
+        cursor->key[cursor->keylen] = 0;
         if (root->payload && callback(ctx, cursor->key, root->payload, cursor->prefixlen==cursor->keylen)) return;
         if (cursor->keylen == cursor->prefixlen && exactmatch) return;
         traverseCFBurstTrieMappedLevel(trie, root, cursor, exactmatch, ctx, callback);
@@ -1077,6 +1245,7 @@ static void traverseCFBurstTrieLevel(CFBurstTrieRef trie, TrieLevelRef root, Tri
         NextTrie next = root->slots[i];
         cursor->keylen = len;
         cursor->key[cursor->keylen++] = i;
+        cursor->key[cursor->keylen] = 0;
 
         if (NextTrie_GetKind(next) == TrieKind) {
             TrieLevelRef level = (TrieLevelRef)NextTrie_GetPtr(next);
@@ -1100,6 +1269,7 @@ static void traverseCFBurstTrieMappedLevel(CFBurstTrieRef trie, MapTrieLevelRef
         uint32_t offset = (uint32_t)root->slots[i];
         cursor->keylen = len;
         cursor->key[cursor->keylen++] = i;
+        cursor->key[cursor->keylen] = 0;
         
         if (DiskNextTrie_GetKind(offset) == TrieKind) {
             MapTrieLevelRef level = (MapTrieLevelRef)DiskNextTrie_GetPtr(trie->mapBase, offset);
@@ -1138,6 +1308,7 @@ static void traverseCFBurstTrieCompactMappedLevel(CFBurstTrieRef trie, CompactMa
             item += __builtin_popcountll(bword & ((1ull << bit)-1));
             uint32_t offset = root->slots[item];
             cursor->key[cursor->keylen++] = mykey;
+            cursor->key[cursor->keylen] = 0;
             
             if(DiskNextTrie_GetKind(offset) == CompactTrieKind) {
                 CompactMapTrieLevelRef level = (CompactMapTrieLevelRef)DiskNextTrie_GetPtr(trie->mapBase, offset);
@@ -1145,7 +1316,10 @@ static void traverseCFBurstTrieCompactMappedLevel(CFBurstTrieRef trie, CompactMa
                 if (cursor->keylen == cursor->prefixlen && exactmatch) return;
                 traverseCFBurstTrieCompactMappedLevel(trie, level, cursor, exactmatch, ctx, callback);
             } else if(DiskNextTrie_GetKind(offset) == TrieKind) {
-                traverseCFBurstTrieMappedLevel(trie, (MapTrieLevelRef)DiskNextTrie_GetPtr(trie->mapBase, offset), cursor, exactmatch, ctx, callback);
+                MapTrieLevelRef level = (MapTrieLevelRef)DiskNextTrie_GetPtr(trie->mapBase, offset);
+                if (level->payload && callback(ctx, cursor->key, level->payload, cursor->prefixlen==cursor->keylen)) return;
+                if (cursor->keylen == cursor->prefixlen && exactmatch) return;
+                traverseCFBurstTrieMappedLevel(trie, level, cursor, exactmatch, ctx, callback);
             } else if (DiskNextTrie_GetKind(offset) == ListKind) {
                 cursor->next = offset;
                 cursor->key[cursor->keylen] = 0;
@@ -1181,16 +1355,6 @@ static void traverseCFBurstTrieWithCursor(CFBurstTrieRef trie, const uint8_t *pr
     }
 }
 
-CF_INLINE uint32_t getPackedPageEntrySize(PageEntryPacked *entry)
-{
-    return sizeof(PageEntryPacked) + entry->strlen;
-}
-
-CF_INLINE uint32_t getPageEntrySize(PageEntry *entry)
-{
-    return sizeof(PageEntry) + entry->strlen;
-}
-
 /*
 static void _printPageEntry(PageEntryPacked *entry) {
     printf("entry 0x%p:\n", entry);
@@ -1454,7 +1618,7 @@ static void traverseFromMapCursorMappedLevel(CFBurstTrieRef trie, CompactMapCurs
     if (length >= capacity)
         return;
 
-    for (int i = 0; i < CHARACTER_SET_SIZE; ++i) {i =
+    for (int i = 0; i < CHARACTER_SET_SIZE; ++i) {
         bytes[length] = i;
         cursor->next = (uint32_t)root->slots[i];;
         cursor->isOnPage = FALSE;
@@ -1939,6 +2103,7 @@ static void serializeCFBurstTrieLists(CFBurstTrieRef trie, TrieLevelRef root, of
 static size_t serializeCFBurstTrie(CFBurstTrieRef trie, size_t start_offset, int fd)
 {
     TrieHeader header;
+    bzero(&header, sizeof(header));
     header.signature = 0x0ddba11;
     header.rootOffset = 0;
     header.count = trie->count;
@@ -22,6 +22,11 @@
 
 CF_EXTERN_C_BEGIN
 
+/*  A burst trie maps UTF-8 keys to non-zero 32-bit payloads. Tries are built in memory, then serialized to a file
+    which CFBurstTrieCreateFromFile() maps back; lookups and traversals run directly on the mapped bytes. A trie
+    created from a file or from map bytes is immutable, and can be read from any number of threads at once. Tries
+    being built must not be used from several threads at once.
+*/
 typedef struct CF_BRIDGED_MUTABLE_TYPE(id) _CFBurstTrie *CFBurstTrieRef;
 typedef struct CF_BRIDGED_MUTABLE_TYPE(id) _CFBurstTrieCursor *CFBurstTrieCursorRef;
 
@@ -183,6 +188,14 @@ void CFBurstTrieTraverseFromCursor(CFBurstTrieCursorRef cursor, void *ctx, CFBur
 CF_EXPORT
 void CFBurstTrieCursorRelease(CFBurstTrieCursorRef cursor) CF_AVAILABLE(10_8, 6_0);
 
+/*  CFBurstTrieTraverseWithPrefix
+    Calls the callback with every key starting with the given bytes, and its payload, until the callback sets stop.
+    Keys are passed in full, and are NUL terminated after keyLength bytes. Tries serialized with
+    kCFBurstTriePrefixCompression or kCFBurstTrieSortByKey are traversed in key order, straight from the mapped file.
+*/
+CF_EXPORT
+void CFBurstTrieTraverseWithPrefix(CFBurstTrieRef trie, const UInt8 *prefix, CFIndex length, void *ctx, CFBurstTrieTraversalCallback callback);
+
 CF_EXTERN_C_END
 
 #endif /* __COREFOUNDATION_CFBURSTTRIE__ */
@@ -21,6 +21,7 @@
 #include <CoreFoundation/CFString.h>
 #include <CoreFoundation/CFDictionary.h>
 #include "CFStringEncodingConverterExt.h"
+#include "CFStringEncodingConverterPriv.h"
 #include "CFUniChar.h"
 #include "CFUnicodeDecomposition.h"
 #include "CFUnicodePrecomposition.h"
@@ -137,7 +138,7 @@ struct __notInlineMutable {
     void *buffer;
     CFIndex length;
         CFIndex capacity;                           // Capacity in bytes
-    unsigned int hasGap:1;                      // Currently unused
+    unsigned int hasGap:1;                      // The buffer is a __CFStrRope rather than the contents
     unsigned int isFixedCapacity:1;
     unsigned int isExternalMutable:1;
     unsigned int capacityProvidedExternally:1;
@@ -146,6 +147,7 @@ struct __notInlineMutable {
 #else
     unsigned long desiredCapacity:28;
 #endif
+    CFLock_t ropeLock;                          // Taken to flatten or read the rope
     CFAllocatorRef contentsAllocator;           // Optional
 };                             // The only mutable variant for CFString
 
@@ -257,12 +259,16 @@ CF_INLINE Boolean __CFStrIsConstant(CFStringRef str) {
 
 CF_INLINE SInt32 __CFStrSkipAnyLengthByte(CFStringRef str)          {return ((str->base._cfinfo[CF_INFO_BITS] & __kCFHasLengthByteMask) == __kCFHasLengthByte) ? 1 : 0;}    // Number of bytes to skip over the length byte in the contents
 
-/* Returns ptr to the buffer (which might include the length byte).
+CF_INLINE Boolean __CFStrIsRope(CFStringRef str)                    {return __CFStrIsMutable(str) && str->variants.notInlineMutable.hasGap;}
+static void __CFStrFlattenRope(CFStringRef str);
+
+/* Returns ptr to the buffer (which might include the length byte). Mutable strings which were grown as ropes are flattened first.
 */
 CF_INLINE const void *__CFStrContents(CFStringRef str) {
     if (__CFStrIsInline(str)) {
     return (const void *)(((uintptr_t)&(str->variants)) + (__CFStrHasExplicitLength(str) ? sizeof(CFIndex) : 0));
     } else {    // Not inline; pointer is always word 2
+    if (__CFStrIsRope(str)) __CFStrFlattenRope(str);
     return str->variants.notInlineImmutable1.buffer;
     }
 }
@@ -357,7 +363,6 @@ CF_INLINE Boolean __CFStrIsExternalMutable(CFStringRef str) {return str->variant
 CF_INLINE Boolean __CFStrHasContentsAllocator(CFStringRef str)  {return (str->base._cfinfo[CF_INFO_BITS] & __kCFHasContentsAllocatorMask) == __kCFHasContentsAllocator;}
 CF_INLINE void __CFStrSetIsFixed(CFMutableStringRef str)            {str->variants.notInlineMutable.isFixedCapacity = 1;}
 CF_INLINE void __CFStrSetIsExternalMutable(CFMutableStringRef str)      {str->variants.notInlineMutable.isExternalMutable = 1;}
-//CF_INLINE void __CFStrSetHasGap(CFMutableStringRef str)               {str->variants.notInlineMutable.hasGap = 1;} currently unused
 
 // If capacity is provided externally, we only change it when we need to grow beyond it
 CF_INLINE Boolean __CFStrCapacityProvidedExternally(CFStringRef str)        {return str->variants.notInlineMutable.capacityProvidedExternally;}
@@ -536,54 +541,7 @@ CFStringEncoding __CFStringComputeEightBitStringEncoding(void) {
 /* Returns whether the provided bytes can be stored in ASCII
 */
 CF_INLINE Boolean __CFBytesInASCII(const uint8_t *bytes, CFIndex len) {
-#if __LP64__
-    /* A bit of unrolling; go by 32s, 16s, and 8s first */
-    while (len >= 32) {
-        uint64_t val = *(const uint64_t *)bytes;
-        uint64_t hiBits = (val & 0x8080808080808080ULL);    // More efficient to collect this rather than do a conditional at every step
-        bytes += 8;
-        val = *(const uint64_t *)bytes;
-        hiBits |= (val & 0x8080808080808080ULL);
-        bytes += 8;
-        val = *(const uint64_t *)bytes;
-        hiBits |= (val & 0x8080808080808080ULL);
-        bytes += 8;
-        val = *(const uint64_t *)bytes;
-        if (hiBits | (val & 0x8080808080808080ULL)) return false;
-        bytes += 8;
-        len -= 32;
-    }
-
-    while (len >= 16) {
-        uint64_t val = *(const uint64_t *)bytes;
-        uint64_t hiBits = (val & 0x8080808080808080ULL);
-        bytes += 8;
-        val = *(const uint64_t *)bytes;
-        if (hiBits | (val & 0x8080808080808080ULL)) return false;
-        bytes += 8;
-        len -= 16;
-    }
-
-    while (len >= 8) {
-        uint64_t val = *(const uint64_t *)bytes;
-        if (val & 0x8080808080808080ULL) return false;
-        bytes += 8;
-        len -= 8;
-    }
-#endif
-    /* Go by 4s */
-    while (len >= 4) {
-        uint32_t val = *(const uint32_t *)bytes;
-        if (val & 0x80808080U) return false;
-        bytes += 4;
-        len -= 4;
-    }
-    /* Handle the rest one byte at a time */
-    while (len--) {
-        if (*bytes++ & 0x80) return false;
-    }
-
-    return true;
+    return __CFStringEncodingASCIIPrefixLength(bytes, len) == len;
 }
 
 /* Returns whether the provided 8-bit string in the specified encoding can be stored in an 8-bit CFString. 
@@ -935,6 +893,223 @@ CF_INLINE void __CFStringChangeSize(CFMutableStringRef str, CFRange range, CFInd
 }
 
 
+/* Ropes
+
+Appending to a long mutable string would otherwise reallocate and copy its contents each time it fills up, and convert
+all of it to Unicode on the first non-ASCII append. Once a string is __kCFStrRopeThreshold characters long, appends
+which do not fit go into a list of pieces instead: the old contents become the first piece, and later appends fill
+pieces of at least __kCFStrRopePieceSize characters. The rope hangs off the buffer pointer, with hasGap set.
+
+8-bit pieces stay 8-bit even after the string has become Unicode; the string's flags always describe the contents as
+they will be once flattened, so code which looks at them before calling __CFStrContents() stays correct.
+__CFStrContents() flattens the rope into one buffer, so everything but appending, the length and
+CFStringGetCharacters() sees an ordinary string. As flattening may happen in readers, it is done under the string's
+ropeLock; the lock lives in the string rather than the rope, as flattening frees the rope.
+*/
+#define __kCFStrRopeThreshold (256 * 1024)
+#define __kCFStrRopePieceSize (256 * 1024)
+
+typedef struct {
+    void *allocation;       // Freed with the rope, if not NULL
+    uint8_t *bytes;         // First character
+    CFIndex location;       // Index of the first character in the string
+    CFIndex length;         // In characters
+    CFIndex capacity;       // In characters
+    Boolean isUnicode;
+} __CFStrRopePiece;
+
+typedef struct {
+    CFIndex count;
+    CFIndex capacity;
+    __CFStrRopePiece *pieces;
+} __CFStrRope;
+
+CF_INLINE __CFStrRope *__CFStrGetRope(CFStringRef str) {return (__CFStrRope *)str->variants.notInlineMutable.buffer;}
+
+static void __CFStrRopeDeallocate(CFMutableStringRef str, __CFStrRope *rope) {
+    for (CFIndex idx = 0; idx < rope->count; idx++) {
+        if (rope->pieces[idx].allocation) __CFStrDeallocateMutableContents(str, rope->pieces[idx].allocation);
+    }
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, rope->pieces);
+    CFAllocatorDeallocate(kCFAllocatorSystemDefault, rope);
+}
+
+static __CFStrRopePiece *__CFStrRopeAddPiece(CFMutableStringRef str, __CFStrRope *rope, CFIndex capacity, Boolean isUnicode) {
+    CFIndex charSize = isUnicode ? sizeof(UniChar) : sizeof(uint8_t);
+    void *allocation = capacity ? __CFStrAllocateMutableContents(str, capacity * charSize) : NULL;
+    if (capacity && !allocation) return NULL;
+    if (rope->count == rope->capacity) {
+        CFIndex newCapacity = rope->capacity ? rope->capacity * 2 : 16;
+        __CFStrRopePiece *pieces = (__CFStrRopePiece *)CFAllocatorReallocate(kCFAllocatorSystemDefault, rope->pieces, newCapacity * sizeof(__CFStrRopePiece), 0);
+        if (!pieces) {
+            if (allocation) __CFStrDeallocateMutableContents(str, allocation);
+            return NULL;
+        }
+        rope->pieces = pieces;
+        rope->capacity = newCapacity;
+    }
+    __CFStrRopePiece *piece = &rope->pieces[rope->count];
+    piece->allocation = allocation;
+    piece->bytes = (uint8_t *)allocation;
+    piece->location = rope->count ? rope->pieces[rope->count - 1].location + rope->pieces[rope->count - 1].length : 0;
+    piece->length = 0;
+    piece->capacity = capacity;
+    piece->isUnicode = isUnicode;
+    rope->count++;
+    return piece;
+}
+
+/* Turns the contents of the string into the first piece of a new rope.
+*/
+static __CFStrRope *__CFStrMakeRope(CFMutableStringRef str) {
+    __CFStrRope *rope = (__CFStrRope *)CFAllocatorAllocate(kCFAllocatorSystemDefault, sizeof(__CFStrRope), 0);
+    if (!rope) return NULL;
+    rope->count = rope->capacity = 0;
+    rope->pieces = NULL;
+
+    uint8_t *contents = (uint8_t *)__CFStrContents(str);
+    CFIndex length = __CFStrLength(str);
+    Boolean isUnicode = __CFStrIsUnicode(str);
+    if (contents) {
+        if (length > 0) {
+            __CFStrRopePiece *piece = __CFStrRopeAddPiece(str, rope, 0, isUnicode);
+            if (!piece) {
+                CFAllocatorDeallocate(kCFAllocatorSystemDefault, rope);
+                return NULL;
+            }
+            CFIndex extraBytes = __CFStrHasLengthByte(str) ? 2 : 0;
+            piece->allocation = __CFStrFreeContentsWhenDone(str) ? contents : NULL;
+            piece->bytes = contents + __CFStrSkipAnyLengthByte(str);
+            piece->length = length;
+            piece->capacity = (__CFStrCapacity(str) - extraBytes) / (isUnicode ? sizeof(UniChar) : sizeof(uint8_t));
+        } else if (__CFStrFreeContentsWhenDone(str)) {
+            __CFStrDeallocateMutableContents(str, contents);
+        }
+    }
+
+    // Flattening always puts the length and null bytes back in 8-bit strings.
+    if (!isUnicode) __CFStrSetHasLengthAndNullBytes(str);
+    __CFStrSetCapacity(str, 0);
+    __CFStrClearCapacityProvidedExternally(str);
+    __CFStrSetContentPtr(str, rope);
+    str->variants.notInlineMutable.hasGap = 1;
+    return rope;
+}
+
+/* Makes room to append appendedLength characters to a string which is, or should now become, a rope. Returns false if
+the string should grow its contents instead. Otherwise updates the length, and returns where the characters go in *where,
+and whether they should be written as UniChars in *isUnicode. appendedIsUnicode is only looked at for 8-bit strings.
+*/
+static Boolean __CFStrRopeReserve(CFMutableStringRef str, CFIndex appendedLength, Boolean appendedIsUnicode, void **where, Boolean *isUnicode) {
+    CFIndex length = __CFStrLength(str);
+    __CFStrRope *rope;
+    appendedIsUnicode = appendedIsUnicode || __CFStrIsUnicode(str);
+
+    if (__CFStrIsRope(str)) {
+        rope = __CFStrGetRope(str);
+    } else {
+        if (__CFStrIsExternalMutable(str) || length + appendedLength < __kCFStrRopeThreshold) return false;
+        // Until it is full, the current contents are as good as a piece.
+        CFIndex charSize = appendedIsUnicode ? sizeof(UniChar) : sizeof(uint8_t);
+        if ((appendedIsUnicode == __CFStrIsUnicode(str)) && ((length + appendedLength) * charSize + (appendedIsUnicode ? 0 : 2) <= __CFStrCapacity(str))) return false;
+        rope = __CFStrMakeRope(str);
+        if (!rope) return false;
+    }
+
+    __CFStrRopePiece *piece = rope->count ? &rope->pieces[rope->count - 1] : NULL;
+    if (!piece || (appendedIsUnicode && !piece->isUnicode) || (piece->length + appendedLength > piece->capacity)) {
+        piece = __CFStrRopeAddPiece(str, rope, __CFMax(appendedLength, __kCFStrRopePieceSize), appendedIsUnicode);
+        if (!piece) {
+            __CFStringHandleOutOfMemory(str);
+            __CFStrFlattenRope(str);
+            return false;
+        }
+    }
+
+    *where = piece->bytes + piece->length * (piece->isUnicode ? sizeof(UniChar) : sizeof(uint8_t));
+    *isUnicode = piece->isUnicode;
+    piece->length += appendedLength;
+    if (piece->isUnicode && !__CFStrIsUnicode(str)) {
+        __CFStrSetUnicode(str);
+        __CFStrClearHasLengthAndNullBytes(str);
+    }
+    __CFStrSetExplicitLength(str, length + appendedLength);
+    return true;
+}
+
+static void __CFStrFlattenRope(CFStringRef string) {
+    CFMutableStringRef str = (CFMutableStringRef)string;
+    __CFLock(&str->variants.notInlineMutable.ropeLock);
+    if (__CFStrIsRope(str)) {   // Unless another thread got here first
+        __CFStrRope *rope = __CFStrGetRope(str);
+        CFIndex length = __CFStrLength(str);
+        Boolean isUnicode = __CFStrIsUnicode(str);
+        CFIndex charSize = isUnicode ? sizeof(UniChar) : sizeof(uint8_t);
+        CFIndex numExtraBytes = isUnicode ? 0 : 2;
+        CFIndex capacity = __CFStrNewCapacity(str, length * charSize + numExtraBytes, 0, true, charSize);
+        uint8_t *contents = (capacity == -1) ? NULL : (uint8_t *)__CFStrAllocateMutableContents(str, capacity);
+        if (!contents) __CFStringHandleOutOfMemory(str);
+
+        uint8_t *body = isUnicode ? contents : contents + 1;
+        for (CFIndex idx = 0; idx < rope->count; idx++) {
+            const __CFStrRopePiece *piece = &rope->pieces[idx];
+            if (!isUnicode) {
+                memmove(body + piece->location, piece->bytes, piece->length);
+            } else if (piece->isUnicode) {
+                memmove((UniChar *)body + piece->location, piece->bytes, piece->length * sizeof(UniChar));
+            } else {
+                __CFStrConvertBytesToUnicode(piece->bytes, (UniChar *)body + piece->location, piece->length);
+            }
+        }
+        if (!isUnicode) {
+            body[length] = 0;
+            contents[0] = __CFCanUseLengthByte(length) ? (uint8_t)length : 0;
+        }
+
+        __CFStrSetCapacity(str, capacity);
+        __CFStrSetContentPtr(str, contents);
+        OSMemoryBarrier();
+        str->variants.notInlineMutable.hasGap = 0;
+        __CFStrRopeDeallocate(str, rope);
+    }
+    __CFUnlock(&str->variants.notInlineMutable.ropeLock);
+}
+
+/* Copies characters out of a rope without flattening it. Returns false if the string is not a rope (any longer).
+*/
+static Boolean __CFStrRopeGetCharacters(CFStringRef str, CFRange range, UniChar *buffer) {
+    Boolean result = false;
+    CFLock_t *lock = &((CFMutableStringRef)str)->variants.notInlineMutable.ropeLock;
+    __CFLock(lock);
+    if (__CFStrIsRope(str)) {
+        __CFStrRope *rope = __CFStrGetRope(str);
+        // Find the last piece starting at or before range.location
+        CFIndex low = 0, high = rope->count - 1;
+        while (low < high) {
+            CFIndex mid = (low + high + 1) / 2;
+            if (rope->pieces[mid].location <= range.location) low = mid; else high = mid - 1;
+        }
+        for (CFIndex idx = low; idx < rope->count && range.length > 0; idx++) {
+            const __CFStrRopePiece *piece = &rope->pieces[idx];
+            CFIndex offset = range.location - piece->location;
+            CFIndex count = __CFMin(piece->length - offset, range.length);
+            if (count <= 0) continue;
+            if (piece->isUnicode) {
+                memmove(buffer, (const UniChar *)piece->bytes + offset, count * sizeof(UniChar));
+            } else {
+                __CFStrConvertBytesToUnicode(piece->bytes + offset, buffer, count);
+            }
+            buffer += count;
+            range.location += count;
+            range.length -= count;
+        }
+        result = true;
+    }
+    __CFUnlock(lock);
+    return result;
+}
+
+
 #if defined(DEBUG)
 static Boolean __CFStrIsConstantString(CFStringRef str);
 #endif
@@ -948,7 +1123,9 @@ static void __CFStringDeallocate(CFTypeRef cf) {
     if (!__CFStrIsInline(str)) {
         uint8_t *contents;
     Boolean isMutable = __CFStrIsMutable(str);
-        if (__CFStrFreeContentsWhenDone(str) && (contents = (uint8_t *)__CFStrContents(str))) {
+        if (isMutable && __CFStrIsRope(str)) {
+            __CFStrRopeDeallocate((CFMutableStringRef)str, __CFStrGetRope(str));
+        } else if (__CFStrFreeContentsWhenDone(str) && (contents = (uint8_t *)__CFStrContents(str))) {
             if (isMutable) {
             __CFStrDeallocateMutableContents((CFMutableStringRef)str, contents);
         } else {
@@ -1904,6 +2081,19 @@ CF_INLINE void __CFStringReplace(CFMutableStringRef str, CFRange range, CFString
     CFStringRef copy = NULL;
     if (replacement == str) copy = replacement = (CFStringRef)CFStringCreateCopy(kCFAllocatorSystemDefault, replacement);   // Very special and hopefully rare case
     CFIndex replacementLength = CFStringGetLength(replacement);
+    void *appendedContents;
+    Boolean appendedIsUnicode;
+
+    if (range.length == 0 && range.location == __CFStrLength(str) &&
+        __CFStrRopeReserve(str, replacementLength, (replacementLength > 0) && CFStrIsUnicode(replacement), &appendedContents, &appendedIsUnicode)) {
+        if (appendedIsUnicode) {
+            CFStringGetCharacters(replacement, CFRangeMake(0, replacementLength), (UniChar *)appendedContents);
+        } else {
+            CFStringGetBytes(replacement, CFRangeMake(0, replacementLength), __CFStringGetEightBitStringEncoding(), 0, false, (uint8_t *)appendedContents, replacementLength, NULL);
+        }
+        if (copy) CFRelease(copy);
+        return;
+    }
 
     __CFStringChangeSize(str, range, replacementLength, (replacementLength > 0) && CFStrIsUnicode(replacement));
 
@@ -1938,6 +2128,7 @@ CF_INLINE CFMutableStringRef __CFStringCreateMutableFunnel(CFAllocatorRef alloc,
         str->variants.notInlineMutable.buffer = NULL;
         __CFStrSetExplicitLength(str, 0);
     str->variants.notInlineMutable.hasGap = str->variants.notInlineMutable.isFixedCapacity = str->variants.notInlineMutable.isExternalMutable = str->variants.notInlineMutable.capacityProvidedExternally = 0;
+    CF_LOCK_INIT_FOR_STRUCTS(str->variants.notInlineMutable.ropeLock);
     if (maxLength != 0) __CFStrSetIsFixed(str);
         __CFStrSetDesiredCapacity(str, (maxLength == 0) ? DEFAULTMINCAPACITY : maxLength);
         __CFStrSetCapacity(str, 0);
@@ -2063,12 +2254,17 @@ void CFStringGetCharacters(CFStringRef str, CFRange range, UniChar *buffer) {
 
     __CFAssertIsString(str);
     __CFAssertRangeIsInStringBounds(str, range.location, range.length);
+    if (__CFStrIsRope(str) && __CFStrRopeGetCharacters(str, range, buffer)) return;
     __CFStringGetCharactersGuts(str, range, buffer, (const uint8_t *)__CFStrContents(str));
 }
 
 /* This one is for NSCFString usage; it doesn't do ObjC dispatch; but it does do range check
 */
 int _CFStringCheckAndGetCharacters(CFStringRef str, CFRange range, UniChar *buffer) {
+     if (__CFStrIsRope(str)) {
+         if (range.location + range.length > __CFStrLength(str) && __CFStringNoteErrors()) return _CFStringErrBounds;
+         if (__CFStrRopeGetCharacters(str, range, buffer)) return _CFStringErrNone;
+     }
      const uint8_t *contents = (const uint8_t *)__CFStrContents(str);
      if (range.location + range.length > __CFStrLength2(str, contents) && __CFStringNoteErrors()) return _CFStringErrBounds;
      __CFStringGetCharactersGuts(str, range, buffer, contents);
@@ -4419,14 +4615,28 @@ void CFStringAppendCharacters(CFMutableStringRef str, const UniChar *chars, CFIn
 
     __CFAssertIsStringAndMutable(str);
 
+    void *appendedContents;
+    Boolean appendedIsUnicode;
     strLength = __CFStrLength(str);
     if (__CFStrIsUnicode(str)) {
+    if (__CFStrRopeReserve(str, appendedLength, true, &appendedContents, &appendedIsUnicode)) {
+        memmove(appendedContents, chars, appendedLength * sizeof(UniChar));
+        return;
+    }
     __CFStringChangeSize(str, CFRangeMake(strLength, 0), appendedLength, true);
     memmove((UniChar *)__CFStrContents(str) + strLength, chars, appendedLength * sizeof(UniChar));
     } else {
     uint8_t *contents;
     bool isASCII = true;
     for (idx = 0; isASCII && idx < appendedLength; idx++) isASCII = (chars[idx] < 0x80);
+    if (__CFStrRopeReserve(str, appendedLength, !isASCII, &appendedContents, &appendedIsUnicode)) {
+        if (appendedIsUnicode) {
+            memmove(appendedContents, chars, appendedLength * sizeof(UniChar));
+        } else {
+            for (idx = 0; idx < appendedLength; idx++) ((uint8_t *)appendedContents)[idx] = (uint8_t)chars[idx];
+        }
+        return;
+    }
     __CFStringChangeSize(str, CFRangeMake(strLength, 0), appendedLength, !isASCII);
     if (!isASCII) {
         memmove((UniChar *)__CFStrContents(str) + strLength, chars, appendedLength * sizeof(UniChar));
@@ -4491,9 +4701,26 @@ void __CFStringAppendBytes(CFMutableStringRef str, const char *cStr, CFIndex app
         }
     } else {
         CFIndex strLength;
+        void *ropeContents;
+        Boolean ropeIsUnicode;
         __CFAssertIsStringAndMutable(str);
         strLength = __CFStrLength(str);
 
+        if (__CFStrRopeReserve(str, appendedLength, appendedIsUnicode, &ropeContents, &ropeIsUnicode)) {
+            if (ropeIsUnicode) {
+                if (appendedIsUnicode || demoteAppendedUnicode) {
+                    memmove(ropeContents, cStr, appendedLength * sizeof(UniChar));
+                } else {
+                    __CFStrConvertBytesToUnicode((const uint8_t *)cStr, (UniChar *)ropeContents, appendedLength);
+                }
+            } else if (demoteAppendedUnicode) {
+                UniChar *chars = (UniChar *)cStr;
+                CFIndex idx;
+                for (idx = 0; idx < appendedLength; idx++) ((uint8_t *)ropeContents)[idx] = (uint8_t)chars[idx];
+            } else {
+                memmove(ropeContents, cStr, appendedLength);
+            }
+        } else {
         __CFStringChangeSize(str, CFRangeMake(strLength, 0), appendedLength, appendedIsUnicode || __CFStrIsUnicode(str));
 
         if (__CFStrIsUnicode(str)) {
@@ -4514,6 +4741,7 @@ void __CFStringAppendBytes(CFMutableStringRef str, const char *cStr, CFIndex app
         memmove(contents + strLength + __CFStrSkipAnyLengthByte(str), cStr, appendedLength);
         }
         }
+        }
     }
 
     if (freeCStrWhenDone) CFAllocatorDeallocate(__CFGetDefaultAllocator(), (void *)cStr);
@@ -21,6 +21,7 @@
 #include "CFPriv.h"
 #include <string.h>
 #include "CFStringEncodingConverterExt.h"
+#include "CFStringEncodingConverterPriv.h"
 #include "CFUniChar.h"
 #include "CFUnicodeDecomposition.h"
 #if (TARGET_OS_MAC && !(TARGET_OS_EMBEDDED || TARGET_OS_IPHONE)) || (TARGET_OS_EMBEDDED || TARGET_OS_IPHONE)
@@ -81,8 +82,11 @@ CF_PRIVATE void __CFSetCharToUniCharFunc(Boolean (*func)(UInt32 flags, UInt8 ch,
 }
 
 CF_PRIVATE void __CFStrConvertBytesToUnicode(const uint8_t *bytes, UniChar *buffer, CFIndex numChars) {
-    CFIndex idx;
-    for (idx = 0; idx < numChars; idx++) buffer[idx] = __CFCharToUniCharTable[bytes[idx]];
+    CFIndex idx = 0;
+    while (idx < numChars) { // The table maps ASCII to itself, so runs of it are widened in bulk
+        idx += __CFStringEncodingWidenASCIIPrefix(bytes + idx, numChars - idx, buffer + idx);
+        for (; (idx < numChars) && (bytes[idx] >= 0x80); idx++) buffer[idx] = __CFCharToUniCharTable[bytes[idx]];
+    }
 }
 
 
@@ -160,14 +164,17 @@ Boolean __CFStringDecodeByteStream3(const uint8_t *bytes, CFIndex len, CFStringE
             buffer->isASCII = false;
         } else {
             if (buffer->isASCII) {  // Let's see if we can reduce the Unicode down to ASCII...
-                const UTF16Char *characters = src;
-                UTF16Char mask = (swap ? 0x80FF : 0xFF80);
-    
-                while (characters < limit) {
-                    if (*(characters++) & mask) {
-                        buffer->isASCII = false;
-                        break;
+                if (swap) {
+                    const UTF16Char *characters = src;
+
+                    while (characters < limit) {
+                        if (*(characters++) & 0x80FF) {
+                            buffer->isASCII = false;
+                            break;
+                        }
                     }
+                } else if (__CFStringEncodingUTF16ASCIIPrefixLength(src, limit - src) != (limit - src)) {
+                    buffer->isASCII = false;
                 }
             }
     
@@ -187,7 +194,7 @@ Boolean __CFStringDecodeByteStream3(const uint8_t *bytes, CFIndex len, CFStringE
                 if (swap) {
                     while (src < limit) *(dst++) = (*(src++) >> 8);
                 } else {
-                    while (src < limit) *(dst++) = (uint8_t)*(src++);
+                    __CFStringEncodingNarrowASCIIPrefix(src, limit - src, dst);
                 }
             } else {
                 UTF16Char *dst;
@@ -290,14 +297,7 @@ Boolean __CFStringDecodeByteStream3(const uint8_t *bytes, CFIndex len, CFStringE
             len -= 3;
             if (0 == len) return true;
         }
-        if (buffer->isASCII) {
-            for (idx = 0; idx < len; idx++) {
-                if (128 <= chars[idx]) {
-                    buffer->isASCII = false;
-                    break;
-                }
-            }
-        }
+        if (buffer->isASCII && (__CFStringEncodingASCIIPrefixLength(chars, len) != len)) buffer->isASCII = false;
         if (buffer->isASCII) {
             buffer->numChars = len;
             buffer->shouldFreeChars = !buffer->chars.ascii && (len <= MAX_LOCAL_CHARS) ? false : true;
@@ -409,14 +409,7 @@ Boolean __CFStringDecodeByteStream3(const uint8_t *bytes, CFIndex len, CFStringE
         
         if (!isASCIISuperset) buffer->isASCII = false;
         
-        if (buffer->isASCII) {
-            for (idx = 0; idx < len; idx++) {
-                if (128 <= chars[idx]) {
-                    buffer->isASCII = false;
-                    break;
-                }
-            }
-        }
+        if (buffer->isASCII && (__CFStringEncodingASCIIPrefixLength(chars, len) != len)) buffer->isASCII = false;
         
         if (converter->encodingClass == kCFStringEncodingConverterCheapEightBit) {
             if (buffer->isASCII) {
@@ -646,10 +639,9 @@ CFIndex __CFStringEncodeByteStream(CFStringRef string, CFIndex rangeLoc, CFIndex
                 }
         
                 CFIndex uninterestingTailLen = buffer ? (rangeLen - MIN(max, rangeLen)) : 0;
-                while (*ptr < 0x80 && rangeLen > uninterestingTailLen) {
-                    ++ptr;
-                    --rangeLen;
-                }
+                CFIndex asciiLen = __CFStringEncodingASCIIPrefixLength(ptr, rangeLen - uninterestingTailLen);
+                ptr += asciiLen;
+                rangeLen -= asciiLen;
                 numCharsProcessed = ptr - cString;
                 if (buffer) {
                     numCharsProcessed = (numCharsProcessed < max ? numCharsProcessed : max);
@@ -672,10 +664,9 @@ CFIndex __CFStringEncodeByteStream(CFStringRef string, CFIndex rangeLoc, CFIndex
                     if (usedBufLen) *usedBufLen = numCharsProcessed;
                     return numCharsProcessed;
                 }
-                while (*ptr < 0x80 && rangeLen > 0) {
-                    ++ptr;
-                    --rangeLen;
-                }
+                CFIndex asciiLen = __CFStringEncodingASCIIPrefixLength(ptr, rangeLen);
+                ptr += asciiLen;
+                rangeLen -= asciiLen;
                 numCharsProcessed = ptr - cString;
                 if (buffer) {
                     numCharsProcessed = (numCharsProcessed < max ? numCharsProcessed : max);
@@ -909,6 +909,32 @@ CF_INLINE uint16_t __CFUTF8BytesToWriteForCharacter(uint32_t ch) {
     else return 0;
 }
 
+/* Runs of ASCII are handed to the vectorized helpers once a few ASCII characters in a row suggest a long one, and
+   only if the next 16 characters are all ASCII. Shorter runs, as in most non-English text, cost more to dispatch
+   (and to mispredict) than to convert a character at a time.
+*/
+#define __CFASCIIStreakLength 8
+
+CF_INLINE bool __CFUTF16StartsASCIIRun(const UniChar *characters, CFIndex numChars) {
+    uint64_t word;
+    if (numChars < 16) return false;
+    for (CFIndex idx = 0; idx < 16; idx += 4) {
+        memcpy(&word, characters + idx, sizeof(word));
+        if (word & 0xFF80FF80FF80FF80ULL) return false;
+    }
+    return true;
+}
+
+CF_INLINE bool __CFUTF8StartsASCIIRun(const uint8_t *bytes, CFIndex numBytes) {
+    uint64_t word;
+    if (numBytes < 16) return false;
+    for (CFIndex idx = 0; idx < 16; idx += 8) {
+        memcpy(&word, bytes + idx, sizeof(word));
+        if (word & 0x8080808080808080ULL) return false;
+    }
+    return true;
+}
+
 CF_INLINE uint16_t __CFToUTF8Core(uint32_t ch, uint8_t *bytes, uint32_t maxByteLen) {
     uint16_t bytesToWrite = __CFUTF8BytesToWriteForCharacter(ch);
     const uint32_t byteMask = 0xBF;
@@ -940,6 +966,7 @@ static CFIndex __CFToUTF8(uint32_t flags, const UniChar *characters, CFIndex num
     const uint8_t *beginBytes = bytes;
     const uint8_t *endBytes = bytes + maxByteLen;
     bool isStrict = (flags & kCFStringEncodingUseHFSPlusCanonical ? false : true);
+    CFIndex asciiStreak = 0;
 
     while ((characters < endCharacter) && (!maxByteLen || (bytes < endBytes))) {
         ch = *(characters++);
@@ -947,7 +974,17 @@ static CFIndex __CFToUTF8(uint32_t flags, const UniChar *characters, CFIndex num
         if (ch < 0x80) { // ASCII
             if (maxByteLen) *bytes = ch;
             ++bytes;
+
+            if ((++asciiStreak == __CFASCIIStreakLength) && __CFUTF16StartsASCIIRun(characters, endCharacter - characters) && (!maxByteLen || (bytes < endBytes))) {
+                CFIndex runLength = endCharacter - characters;
+
+                if (maxByteLen && (runLength > (endBytes - bytes))) runLength = endBytes - bytes;
+                runLength = (maxByteLen ? __CFStringEncodingNarrowASCIIPrefix(characters, runLength, bytes) : __CFStringEncodingUTF16ASCIIPrefixLength(characters, runLength));
+                characters += runLength;
+                bytes += runLength;
+            }
         } else {
+            asciiStreak = 0;
             if (ch >= kSurrogateHighStart) {
                 if (ch <= kSurrogateHighEnd) {
                     if ((characters < endCharacter) && ((*characters >= kSurrogateLowStart) && (*characters <= kSurrogateLowEnd))) {
@@ -999,6 +1036,533 @@ CF_INLINE bool __CFIsLegalUTF8(const uint8_t *source, CFIndex length) {
     return true;
 }
 
+/* Vectorized ASCII runs and UTF-8 validation
+ * Most text is long runs of ASCII with the odd multi-byte sequence, so the converters above and below, and the
+ * CFString creation and CFStringGetBytes funnels, hand those runs to kernels picked once by processor: SSE2 (always
+ * present on x86) or AVX2 when CPUID reports it, NEON on ARM, and a word-at-a-time loop elsewhere. UTF-8 is
+ * validated 16 bytes at a time with nibble lookup tables (SSSE3 or NEON) so that well-formed input can skip the
+ * per-sequence checks in __CFFromUTF8. Setting CFStringEncodingDisableSIMD in the environment forces the word-at-a-time
+ * kernels.
+ */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define __CF_ENCODING_SSE2 1
+#if !defined(_MSC_VER) || (defined(__clang_major__) && (__clang_major__ >= 8)) // older clang-cl hides intrinsics the target isn't built for
+#include <cpuid.h>
+#include <immintrin.h>
+#define __CF_ENCODING_X86_DISPATCH 1
+#endif
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define __CF_ENCODING_NEON 1
+#endif
+
+typedef struct {
+    CFIndex (*asciiPrefixLength)(const uint8_t *bytes, CFIndex numBytes);
+    CFIndex (*utf16ASCIIPrefixLength)(const UniChar *characters, CFIndex numChars);
+    CFIndex (*widenASCIIPrefix)(const uint8_t *bytes, CFIndex numBytes, UniChar *characters);
+    CFIndex (*narrowASCIIPrefix)(const UniChar *characters, CFIndex numChars, uint8_t *bytes);
+    bool (*isValidUTF8)(const uint8_t *bytes, CFIndex numBytes);
+} __CFEncodingKernels;
+
+#define __CFEncodingWordHighBits (UINTPTR_MAX / 0xFF * 0x80)
+
+static CFIndex __CFASCIIPrefixLengthScalar(const uint8_t *bytes, CFIndex numBytes) {
+    const uint8_t *source = bytes;
+    const uint8_t *end = bytes + numBytes;
+    uintptr_t word;
+
+    while ((end - source) >= (CFIndex)sizeof(word)) {
+        memcpy(&word, source, sizeof(word));
+        if (word & __CFEncodingWordHighBits) break;
+        source += sizeof(word);
+    }
+    while ((source < end) && (*source < 0x80)) ++source;
+    return source - bytes;
+}
+
+static CFIndex __CFUTF16ASCIIPrefixLengthScalar(const UniChar *characters, CFIndex numChars) {
+    CFIndex idx = 0;
+    while ((idx < numChars) && (characters[idx] < 0x80)) ++idx;
+    return idx;
+}
+
+static CFIndex __CFWidenASCIIPrefixScalar(const uint8_t *bytes, CFIndex numBytes, UniChar *characters) {
+    CFIndex idx = 0;
+    while ((idx < numBytes) && (bytes[idx] < 0x80)) {
+        characters[idx] = bytes[idx];
+        ++idx;
+    }
+    return idx;
+}
+
+static CFIndex __CFNarrowASCIIPrefixScalar(const UniChar *characters, CFIndex numChars, uint8_t *bytes) {
+    CFIndex idx = 0;
+    while ((idx < numChars) && (characters[idx] < 0x80)) {
+        bytes[idx] = (uint8_t)characters[idx];
+        ++idx;
+    }
+    return idx;
+}
+
+static bool __CFIsValidUTF8Scalar(const uint8_t *bytes, CFIndex numBytes) {
+    const uint8_t *source = bytes;
+    const uint8_t *end = bytes + numBytes;
+
+    while (source < end) {
+        source += __CFASCIIPrefixLengthScalar(source, end - source);
+        if (source == end) break;
+
+        CFIndex length = trailingBytesForUTF8[*source] + 1;
+        if ((length > (end - source)) || !__CFIsLegalUTF8(source, length)) return false;
+        source += length;
+    }
+    return true;
+}
+
+static const __CFEncodingKernels __CFEncodingKernelsScalar = {
+    __CFASCIIPrefixLengthScalar, __CFUTF16ASCIIPrefixLengthScalar, __CFWidenASCIIPrefixScalar, __CFNarrowASCIIPrefixScalar, __CFIsValidUTF8Scalar,
+};
+
+/* Each kernel converts whole vectors while they are all ASCII and leaves the exact end of the run, and any tail, to the scalar loop.
+ */
+#if __CF_ENCODING_SSE2
+static CFIndex __CFASCIIPrefixLengthSSE2(const uint8_t *bytes, CFIndex numBytes) {
+    CFIndex idx = 0;
+    for (; idx + 16 <= numBytes; idx += 16) {
+        if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(bytes + idx)))) break;
+    }
+    return idx + __CFASCIIPrefixLengthScalar(bytes + idx, numBytes - idx);
+}
+
+CF_INLINE bool __CFUTF16VectorsAreASCII(__m128i a, __m128i b) {
+    __m128i high = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi16((short)0xFF80));
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) == 0xFFFF;
+}
+
+static CFIndex __CFUTF16ASCIIPrefixLengthSSE2(const UniChar *characters, CFIndex numChars) {
+    CFIndex idx = 0;
+    for (; idx + 16 <= numChars; idx += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(characters + idx));
+        __m128i b = _mm_loadu_si128((const __m128i *)(characters + idx + 8));
+        if (!__CFUTF16VectorsAreASCII(a, b)) break;
+    }
+    return idx + __CFUTF16ASCIIPrefixLengthScalar(characters + idx, numChars - idx);
+}
+
+static CFIndex __CFWidenASCIIPrefixSSE2(const uint8_t *bytes, CFIndex numBytes, UniChar *characters) {
+    const __m128i zero = _mm_setzero_si128();
+    CFIndex idx = 0;
+    for (; idx + 16 <= numBytes; idx += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(bytes + idx));
+        if (_mm_movemask_epi8(v)) break;
+        _mm_storeu_si128((__m128i *)(characters + idx), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128((__m128i *)(characters + idx + 8), _mm_unpackhi_epi8(v, zero));
+    }
+    return idx + __CFWidenASCIIPrefixScalar(bytes + idx, numBytes - idx, characters + idx);
+}
+
+static CFIndex __CFNarrowASCIIPrefixSSE2(const UniChar *characters, CFIndex numChars, uint8_t *bytes) {
+    CFIndex idx = 0;
+    for (; idx + 16 <= numChars; idx += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(characters + idx));
+        __m128i b = _mm_loadu_si128((const __m128i *)(characters + idx + 8));
+        if (!__CFUTF16VectorsAreASCII(a, b)) break;
+        _mm_storeu_si128((__m128i *)(bytes + idx), _mm_packus_epi16(a, b));
+    }
+    return idx + __CFNarrowASCIIPrefixScalar(characters + idx, numChars - idx, bytes + idx);
+}
+#endif
+
+/* UTF-8 validation by lookup, after Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte".
+ * Each byte is classified by the high and low nibbles of the byte before it and the high nibble of itself; the three
+ * table entries share a bit only for an illegal pair. Bytes that must be the third or fourth of a sequence are found
+ * separately and must line up with the pairs the tables flag as two continuations in a row. The input is followed by
+ * zeros so that a sequence cut short at the end shows up as too short.
+ */
+#if __CF_ENCODING_X86_DISPATCH || __CF_ENCODING_NEON
+enum {
+    __CFUTF8TooShort = 1 << 0,      // a lead byte not followed by enough continuations
+    __CFUTF8TooLong = 1 << 1,       // a continuation after ASCII
+    __CFUTF8Overlong3 = 1 << 2,     // 11100000 100_____
+    __CFUTF8TooLarge = 1 << 3,      // beyond U+10FFFF
+    __CFUTF8Surrogate = 1 << 4,     // 11101101 101_____
+    __CFUTF8Overlong2 = 1 << 5,     // 1100000_ 10______
+    __CFUTF8TooLarge1000 = 1 << 6,  // 11110100 1001____ and up
+    __CFUTF8Overlong4 = 1 << 6,     // 11110000 1000____
+    __CFUTF8TwoContinuations = 1 << 7,
+    __CFUTF8Carry = __CFUTF8TooShort | __CFUTF8TooLong | __CFUTF8TwoContinuations,
+};
+
+static const uint8_t __CFUTF8Byte1High[16] = {
+    __CFUTF8TooLong, __CFUTF8TooLong, __CFUTF8TooLong, __CFUTF8TooLong, __CFUTF8TooLong, __CFUTF8TooLong, __CFUTF8TooLong, __CFUTF8TooLong,
+    __CFUTF8TwoContinuations, __CFUTF8TwoContinuations, __CFUTF8TwoContinuations, __CFUTF8TwoContinuations,
+    __CFUTF8TooShort | __CFUTF8Overlong2,
+    __CFUTF8TooShort,
+    __CFUTF8TooShort | __CFUTF8Overlong3 | __CFUTF8Surrogate,
+    __CFUTF8TooShort | __CFUTF8TooLarge | __CFUTF8TooLarge1000 | __CFUTF8Overlong4,
+};
+
+static const uint8_t __CFUTF8Byte1Low[16] = {
+    __CFUTF8Carry | __CFUTF8Overlong3 | __CFUTF8Overlong2 | __CFUTF8Overlong4,
+    __CFUTF8Carry | __CFUTF8Overlong2,
+    __CFUTF8Carry,
+    __CFUTF8Carry,
+    __CFUTF8Carry | __CFUTF8TooLarge,
+    __CFUTF8Carry | __CFUTF8TooLarge | __CFUTF8TooLarge1000,
+    __CFUTF8Carry | __CFUTF8TooLarge | __CFUTF8TooLarge1000,
+    __CFUTF8Carry | __CFUTF8TooLarge | __CFUTF8TooLarge1000,
+    __CFUTF8Carry | __CFUTF8TooLarge | __CFUTF8TooLarge1000,
+    __CFUTF8Carry | __CFUTF8TooLarge | __CFUTF8TooLarge1000,
+    __CFUTF8Carry | __CFUTF8TooLarge | __CFUTF8TooLarge1000,
+    __CFUTF8Carry | __CFUTF8TooLarge | __CFUTF8TooLarge1000,
+    __CFUTF8Carry | __CFUTF8TooLarge | __CFUTF8TooLarge1000,
+    __CFUTF8Carry | __CFUTF8TooLarge | __CFUTF8TooLarge1000 | __CFUTF8Surrogate,
+    __CFUTF8Carry | __CFUTF8TooLarge | __CFUTF8TooLarge1000,
+    __CFUTF8Carry | __CFUTF8TooLarge | __CFUTF8TooLarge1000,
+};
+
+static const uint8_t __CFUTF8Byte2High[16] = {
+    __CFUTF8TooShort, __CFUTF8TooShort, __CFUTF8TooShort, __CFUTF8TooShort, __CFUTF8TooShort, __CFUTF8TooShort, __CFUTF8TooShort, __CFUTF8TooShort,
+    __CFUTF8TooLong | __CFUTF8Overlong2 | __CFUTF8TwoContinuations | __CFUTF8Overlong3 | __CFUTF8TooLarge1000 | __CFUTF8Overlong4,
+    __CFUTF8TooLong | __CFUTF8Overlong2 | __CFUTF8TwoContinuations | __CFUTF8Overlong3 | __CFUTF8TooLarge,
+    __CFUTF8TooLong | __CFUTF8Overlong2 | __CFUTF8TwoContinuations | __CFUTF8Surrogate | __CFUTF8TooLarge,
+    __CFUTF8TooLong | __CFUTF8Overlong2 | __CFUTF8TwoContinuations | __CFUTF8Surrogate | __CFUTF8TooLarge,
+    __CFUTF8TooShort, __CFUTF8TooShort, __CFUTF8TooShort, __CFUTF8TooShort,
+};
+#endif
+
+#if __CF_ENCODING_X86_DISPATCH
+__attribute__((target("ssse3"))) CF_INLINE __m128i __CFUTF8BlockErrorsSSSE3(__m128i input, __m128i previous) {
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+    __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+
+    __m128i byte1High = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)__CFUTF8Byte1High), _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    __m128i byte1Low = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)__CFUTF8Byte1Low), _mm_and_si128(prev1, nibble));
+    __m128i byte2High = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)__CFUTF8Byte2High), _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    __m128i special = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+
+    // Only 111_____ and 1111____ leave the high bit set after these subtractions
+    __m128i thirdOrFourth = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80))), _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80))));
+    return _mm_xor_si128(_mm_and_si128(thirdOrFourth, _mm_set1_epi8((char)0x80)), special);
+}
+
+__attribute__((target("ssse3"))) static bool __CFIsValidUTF8SSSE3(const uint8_t *bytes, CFIndex numBytes) {
+    __m128i error = _mm_setzero_si128();
+    __m128i previous = _mm_setzero_si128();
+    bool previousIsASCII = true;
+    uint8_t tail[16] = { 0 };
+    CFIndex idx = 0;
+
+    for (; idx + 16 <= numBytes; idx += 16) {
+        __m128i input = _mm_loadu_si128((const __m128i *)(bytes + idx));
+        bool isASCII = !_mm_movemask_epi8(input);
+        if (!(isASCII && previousIsASCII)) error = _mm_or_si128(error, __CFUTF8BlockErrorsSSSE3(input, previous));
+        previous = input;
+        previousIsASCII = isASCII;
+    }
+    if (idx < numBytes) memcpy(tail, bytes + idx, numBytes - idx);
+    error = _mm_or_si128(error, __CFUTF8BlockErrorsSSSE3(_mm_loadu_si128((const __m128i *)tail), previous));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+
+__attribute__((target("avx2"))) static CFIndex __CFASCIIPrefixLengthAVX2(const uint8_t *bytes, CFIndex numBytes) {
+    CFIndex idx = 0;
+    for (; idx + 32 <= numBytes; idx += 32) {
+        if (_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(bytes + idx)))) break;
+    }
+    return idx + __CFASCIIPrefixLengthSSE2(bytes + idx, numBytes - idx);
+}
+
+__attribute__((target("avx2"))) CF_INLINE bool __CFUTF16VectorsAreASCIIAVX2(__m256i a, __m256i b) {
+    return _mm256_testz_si256(_mm256_or_si256(a, b), _mm256_set1_epi16((short)0xFF80));
+}
+
+__attribute__((target("avx2"))) static CFIndex __CFUTF16ASCIIPrefixLengthAVX2(const UniChar *characters, CFIndex numChars) {
+    CFIndex idx = 0;
+    for (; idx + 32 <= numChars; idx += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(characters + idx));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(characters + idx + 16));
+        if (!__CFUTF16VectorsAreASCIIAVX2(a, b)) break;
+    }
+    return idx + __CFUTF16ASCIIPrefixLengthSSE2(characters + idx, numChars - idx);
+}
+
+__attribute__((target("avx2"))) static CFIndex __CFWidenASCIIPrefixAVX2(const uint8_t *bytes, CFIndex numBytes, UniChar *characters) {
+    CFIndex idx = 0;
+    for (; idx + 32 <= numBytes; idx += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(bytes + idx));
+        if (_mm256_movemask_epi8(v)) break;
+        _mm256_storeu_si256((__m256i *)(characters + idx), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+        _mm256_storeu_si256((__m256i *)(characters + idx + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+    }
+    return idx + __CFWidenASCIIPrefixSSE2(bytes + idx, numBytes - idx, characters + idx);
+}
+
+__attribute__((target("avx2"))) static CFIndex __CFNarrowASCIIPrefixAVX2(const UniChar *characters, CFIndex numChars, uint8_t *bytes) {
+    CFIndex idx = 0;
+    for (; idx + 32 <= numChars; idx += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(characters + idx));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(characters + idx + 16));
+        if (!__CFUTF16VectorsAreASCIIAVX2(a, b)) break;
+        // packus interleaves the 128-bit lanes of a and b; put them back in order
+        _mm256_storeu_si256((__m256i *)(bytes + idx), _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8));
+    }
+    return idx + __CFNarrowASCIIPrefixSSE2(characters + idx, numChars - idx, bytes + idx);
+}
+
+static const __CFEncodingKernels __CFEncodingKernelsSSSE3 = {
+    __CFASCIIPrefixLengthSSE2, __CFUTF16ASCIIPrefixLengthSSE2, __CFWidenASCIIPrefixSSE2, __CFNarrowASCIIPrefixSSE2, __CFIsValidUTF8SSSE3,
+};
+
+static const __CFEncodingKernels __CFEncodingKernelsAVX2 = {
+    __CFASCIIPrefixLengthAVX2, __CFUTF16ASCIIPrefixLengthAVX2, __CFWidenASCIIPrefixAVX2, __CFNarrowASCIIPrefixAVX2, __CFIsValidUTF8SSSE3,
+};
+#endif
+
+#if __CF_ENCODING_SSE2
+static const __CFEncodingKernels __CFEncodingKernelsSSE2 = {
+    __CFASCIIPrefixLengthSSE2, __CFUTF16ASCIIPrefixLengthSSE2, __CFWidenASCIIPrefixSSE2, __CFNarrowASCIIPrefixSSE2, __CFIsValidUTF8Scalar,
+};
+#endif
+
+#if __CF_ENCODING_NEON
+CF_INLINE bool __CFNEONHasHighBit(uint8x16_t v) {
+#if defined(__aarch64__)
+    return vmaxvq_u8(v) >= 0x80;
+#else
+    uint8x8_t folded = vorr_u8(vget_low_u8(v), vget_high_u8(v));
+    return (vget_lane_u64(vreinterpret_u64_u8(folded), 0) & 0x8080808080808080ULL) != 0;
+#endif
+}
+
+CF_INLINE bool __CFNEONIsZero(uint8x16_t v) {
+    uint8x8_t folded = vorr_u8(vget_low_u8(v), vget_high_u8(v));
+    return vget_lane_u64(vreinterpret_u64_u8(folded), 0) == 0;
+}
+
+CF_INLINE bool __CFUTF16VectorsAreASCIINEON(uint16x8_t a, uint16x8_t b) {
+    return __CFNEONIsZero(vreinterpretq_u8_u16(vandq_u16(vorrq_u16(a, b), vdupq_n_u16(0xFF80))));
+}
+
+static CFIndex __CFASCIIPrefixLengthNEON(const uint8_t *bytes, CFIndex numBytes) {
+    CFIndex idx = 0;
+    for (; idx + 16 <= numBytes; idx += 16) {
+        if (__CFNEONHasHighBit(vld1q_u8(bytes + idx))) break;
+    }
+    return idx + __CFASCIIPrefixLengthScalar(bytes + idx, numBytes - idx);
+}
+
+static CFIndex __CFUTF16ASCIIPrefixLengthNEON(const UniChar *characters, CFIndex numChars) {
+    CFIndex idx = 0;
+    for (; idx + 16 <= numChars; idx += 16) {
+        if (!__CFUTF16VectorsAreASCIINEON(vld1q_u16(characters + idx), vld1q_u16(characters + idx + 8))) break;
+    }
+    return idx + __CFUTF16ASCIIPrefixLengthScalar(characters + idx, numChars - idx);
+}
+
+static CFIndex __CFWidenASCIIPrefixNEON(const uint8_t *bytes, CFIndex numBytes, UniChar *characters) {
+    CFIndex idx = 0;
+    for (; idx + 16 <= numBytes; idx += 16) {
+        uint8x16_t v = vld1q_u8(bytes + idx);
+        if (__CFNEONHasHighBit(v)) break;
+        vst1q_u16(characters + idx, vmovl_u8(vget_low_u8(v)));
+        vst1q_u16(characters + idx + 8, vmovl_u8(vget_high_u8(v)));
+    }
+    return idx + __CFWidenASCIIPrefixScalar(bytes + idx, numBytes - idx, characters + idx);
+}
+
+static CFIndex __CFNarrowASCIIPrefixNEON(const UniChar *characters, CFIndex numChars, uint8_t *bytes) {
+    CFIndex idx = 0;
+    for (; idx + 16 <= numChars; idx += 16) {
+        uint16x8_t a = vld1q_u16(characters + idx);
+        uint16x8_t b = vld1q_u16(characters + idx + 8);
+        if (!__CFUTF16VectorsAreASCIINEON(a, b)) break;
+        vst1q_u8(bytes + idx, vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+    }
+    return idx + __CFNarrowASCIIPrefixScalar(characters + idx, numChars - idx, bytes + idx);
+}
+
+CF_INLINE uint8x16_t __CFNEONLookup(const uint8_t *table, uint8x16_t indices) {
+#if defined(__aarch64__)
+    return vqtbl1q_u8(vld1q_u8(table), indices);
+#else
+    uint8x8x2_t halves = { { vld1_u8(table), vld1_u8(table + 8) } };
+    return vcombine_u8(vtbl2_u8(halves, vget_low_u8(indices)), vtbl2_u8(halves, vget_high_u8(indices)));
+#endif
+}
+
+CF_INLINE uint8x16_t __CFUTF8BlockErrorsNEON(uint8x16_t input, uint8x16_t previous) {
+    uint8x16_t prev1 = vextq_u8(previous, input, 15);
+    uint8x16_t prev2 = vextq_u8(previous, input, 14);
+    uint8x16_t prev3 = vextq_u8(previous, input, 13);
+
+    uint8x16_t byte1High = __CFNEONLookup(__CFUTF8Byte1High, vshrq_n_u8(prev1, 4));
+    uint8x16_t byte1Low = __CFNEONLookup(__CFUTF8Byte1Low, vandq_u8(prev1, vdupq_n_u8(0x0F)));
+    uint8x16_t byte2High = __CFNEONLookup(__CFUTF8Byte2High, vshrq_n_u8(input, 4));
+    uint8x16_t special = vandq_u8(vandq_u8(byte1High, byte1Low), byte2High);
+
+    uint8x16_t thirdOrFourth = vorrq_u8(vqsubq_u8(prev2, vdupq_n_u8(0xE0 - 0x80)), vqsubq_u8(prev3, vdupq_n_u8(0xF0 - 0x80)));
+    return veorq_u8(vandq_u8(thirdOrFourth, vdupq_n_u8(0x80)), special);
+}
+
+static bool __CFIsValidUTF8NEON(const uint8_t *bytes, CFIndex numBytes) {
+    uint8x16_t error = vdupq_n_u8(0);
+    uint8x16_t previous = vdupq_n_u8(0);
+    bool previousIsASCII = true;
+    uint8_t tail[16] = { 0 };
+    CFIndex idx = 0;
+
+    for (; idx + 16 <= numBytes; idx += 16) {
+        uint8x16_t input = vld1q_u8(bytes + idx);
+        bool isASCII = !__CFNEONHasHighBit(input);
+        if (!(isASCII && previousIsASCII)) error = vorrq_u8(error, __CFUTF8BlockErrorsNEON(input, previous));
+        previous = input;
+        previousIsASCII = isASCII;
+    }
+    if (idx < numBytes) memcpy(tail, bytes + idx, numBytes - idx);
+    error = vorrq_u8(error, __CFUTF8BlockErrorsNEON(vld1q_u8(tail), previous));
+    return __CFNEONIsZero(error);
+}
+
+static const __CFEncodingKernels __CFEncodingKernelsNEON = {
+    __CFASCIIPrefixLengthNEON, __CFUTF16ASCIIPrefixLengthNEON, __CFWidenASCIIPrefixNEON, __CFNarrowASCIIPrefixNEON, __CFIsValidUTF8NEON,
+};
+#endif
+
+static const __CFEncodingKernels *__CFEncodingKernelsSelected = NULL;
+
+static const __CFEncodingKernels *__CFEncodingGetKernels(void) {
+    if (!__CFEncodingKernelsSelected) {
+        const __CFEncodingKernels *kernels = &__CFEncodingKernelsScalar;
+        if (!__CFgetenv("CFStringEncodingDisableSIMD")) {
+#if __CF_ENCODING_X86_DISPATCH
+            unsigned int eax, ebx, ecx, edx;
+            kernels = &__CFEncodingKernelsSSE2;
+            if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+                if (ecx & bit_SSSE3) kernels = &__CFEncodingKernelsSSSE3;
+
+                // AVX2 also needs the OS to save the upper halves of the ymm registers
+                bool osSavesYMM = false;
+                if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+                    unsigned int xcr0Low, xcr0High;
+                    __asm__ __volatile__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+                    osSavesYMM = ((xcr0Low & 0x6) == 0x6);
+                }
+                if (osSavesYMM && (ecx & bit_SSSE3) && (__get_cpuid_max(0, NULL) >= 7)) {
+                    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+                    if (ebx & bit_AVX2) kernels = &__CFEncodingKernelsAVX2;
+                }
+            }
+#elif __CF_ENCODING_SSE2
+            kernels = &__CFEncodingKernelsSSE2;
+#elif __CF_ENCODING_NEON
+            kernels = &__CFEncodingKernelsNEON;
+#endif
+        }
+        __CFEncodingKernelsSelected = kernels;
+    }
+    return __CFEncodingKernelsSelected;
+}
+
+// Below this length the scalar loops finish before an indirect call would
+#define __CFEncodingShortLength 16
+
+CF_PRIVATE CFIndex __CFStringEncodingASCIIPrefixLength(const uint8_t *bytes, CFIndex numBytes) {
+    if (numBytes < __CFEncodingShortLength) return __CFASCIIPrefixLengthScalar(bytes, numBytes);
+    return __CFEncodingGetKernels()->asciiPrefixLength(bytes, numBytes);
+}
+
+CF_PRIVATE CFIndex __CFStringEncodingUTF16ASCIIPrefixLength(const UniChar *characters, CFIndex numChars) {
+    if (numChars < __CFEncodingShortLength) return __CFUTF16ASCIIPrefixLengthScalar(characters, numChars);
+    return __CFEncodingGetKernels()->utf16ASCIIPrefixLength(characters, numChars);
+}
+
+CF_PRIVATE CFIndex __CFStringEncodingWidenASCIIPrefix(const uint8_t *bytes, CFIndex numBytes, UniChar *characters) {
+    if (numBytes < __CFEncodingShortLength) return __CFWidenASCIIPrefixScalar(bytes, numBytes, characters);
+    return __CFEncodingGetKernels()->widenASCIIPrefix(bytes, numBytes, characters);
+}
+
+CF_PRIVATE CFIndex __CFStringEncodingNarrowASCIIPrefix(const UniChar *characters, CFIndex numChars, uint8_t *bytes) {
+    if (numChars < __CFEncodingShortLength) return __CFNarrowASCIIPrefixScalar(characters, numChars, bytes);
+    return __CFEncodingGetKernels()->narrowASCIIPrefix(characters, numChars, bytes);
+}
+
+CF_PRIVATE bool __CFStringEncodingIsValidUTF8(const uint8_t *bytes, CFIndex numBytes) {
+    return __CFEncodingGetKernels()->isValidUTF8(bytes, numBytes);
+}
+
+/* Decodes whole blocks of well-formed UTF-8 without the per-sequence checks, widening ASCII runs in bulk. Stops at the
+ * first block that doesn't validate or might not fit, and returns the number of bytes consumed; the caller carries on
+ * from there with the checked loop. With maxCharLen of 0 it only counts.
+ */
+#define __CFUTF8BlockLength 4096
+
+static CFIndex __CFFromValidUTF8Blocks(const uint8_t *bytes, CFIndex numBytes, UniChar *characters, CFIndex maxCharLen, CFIndex *usedCharLen) {
+    const uint8_t *source = bytes;
+    CFIndex theUsedCharLen = 0;
+
+    while (numBytes > 0) {
+        CFIndex blockLength = (numBytes > __CFUTF8BlockLength ? __CFUTF8BlockLength : numBytes);
+
+        if (maxCharLen && (blockLength > (maxCharLen - theUsedCharLen))) break; // UTF-16 never takes more units than UTF-8 takes bytes
+
+        // End the block on a sequence boundary
+        if (blockLength < numBytes) {
+            CFIndex backedUp = 0;
+            while ((backedUp++ < 3) && ((source[blockLength] & 0xC0) == 0x80)) --blockLength;
+        }
+        if (!__CFStringEncodingIsValidUTF8(source, blockLength)) break;
+
+        const uint8_t *blockEnd = source + blockLength;
+        CFIndex asciiStreak = 0;
+        while (source < blockEnd) {
+            if (*source < 0x80) {
+                if (maxCharLen) *(characters++) = *source;
+                ++source;
+                ++theUsedCharLen;
+
+                if ((++asciiStreak == __CFASCIIStreakLength) && __CFUTF8StartsASCIIRun(source, blockEnd - source)) {
+                    CFIndex runLength = (maxCharLen ? __CFStringEncodingWidenASCIIPrefix(source, blockEnd - source, characters) : __CFStringEncodingASCIIPrefixLength(source, blockEnd - source));
+                    source += runLength;
+                    if (maxCharLen) characters += runLength;
+                    theUsedCharLen += runLength;
+                }
+                continue;
+            }
+            asciiStreak = 0;
+
+            uint16_t extraBytesToRead = trailingBytesForUTF8[*source];
+            uint32_t ch = 0;
+            switch (extraBytesToRead) {
+                case 3:	ch += *source++; ch <<= 6;
+                case 2:	ch += *source++; ch <<= 6;
+                case 1:	ch += *source++; ch <<= 6;
+                case 0:	ch += *source++;
+            }
+            ch -= offsetsFromUTF8[extraBytesToRead];
+
+            if (ch <= kMaximumUCS2) {
+                if (maxCharLen) *(characters++) = (UTF16Char)ch;
+                ++theUsedCharLen;
+            } else {
+                if (maxCharLen) {
+                    ch -= halfBase;
+                    *(characters++) = (ch >> halfShift) + kSurrogateHighStart;
+                    *(characters++) = (ch & halfMask) + kSurrogateLowStart;
+                }
+                theUsedCharLen += 2;
+            }
+        }
+        numBytes -= blockLength;
+    }
+
+    *usedCharLen = theUsedCharLen;
+    return source - bytes;
+}
+
 static CFIndex __CFFromUTF8(uint32_t flags, const uint8_t *bytes, CFIndex numBytes, UniChar *characters, CFIndex maxCharLen, CFIndex *usedCharLen) {
     const uint8_t *source = bytes;
     uint16_t extraBytesToRead;
@@ -1011,7 +1575,29 @@ static CFIndex __CFFromUTF8(uint32_t flags, const uint8_t *bytes, CFIndex numByt
     CFIndex decompLength;
     bool isStrict = !isHFSPlus;
 
+    if (!needsToDecompose) {
+        CFIndex consumed = __CFFromValidUTF8Blocks(source, numBytes, characters, maxCharLen, &theUsedCharLen);
+        source += consumed;
+        numBytes -= consumed;
+        if (maxCharLen) characters += theUsedCharLen;
+    }
+
+    CFIndex asciiStreak = 0;
     while (numBytes && (!maxCharLen || (theUsedCharLen < maxCharLen))) {
+        if (*source >= 0x80) {
+            asciiStreak = 0;
+        } else if ((++asciiStreak > __CFASCIIStreakLength) && maxCharLen && __CFUTF8StartsASCIIRun(source, numBytes)) {
+            CFIndex runLength = ((maxCharLen - theUsedCharLen) < numBytes ? (maxCharLen - theUsedCharLen) : numBytes);
+
+            runLength = __CFStringEncodingWidenASCIIPrefix(source, runLength, characters);
+            source += runLength;
+            numBytes -= runLength;
+            characters += runLength;
+            theUsedCharLen += runLength;
+            asciiStreak = 0;
+            continue;
+        }
+
         extraBytesToRead = trailingBytesForUTF8[*source];
 
         if (extraBytesToRead > --numBytes) break;
@@ -1122,6 +1708,12 @@ static CFIndex __CFFromUTF8Len(uint32_t flags, const uint8_t *source, CFIndex nu
     CFIndex decompLength;
     bool isStrict = !isHFSPlus;
 
+    if (!needsToDecompose) {
+        CFIndex consumed = __CFFromValidUTF8Blocks(source, numBytes, NULL, 0, &theUsedCharLen);
+        source += consumed;
+        numBytes -= consumed;
+    }
+
     while (numBytes) {
         extraBytesToRead = trailingBytesForUTF8[*source];
 
@@ -34,6 +34,15 @@ extern  CFIndex __CFStringEncodingPlatformBytesToUnicode(uint32_t encoding, uint
 extern  CFIndex __CFStringEncodingPlatformCharLengthForBytes(uint32_t encoding, uint32_t flags, const uint8_t *bytes, CFIndex numBytes);
 extern  CFIndex __CFStringEncodingPlatformByteLengthForCharacters(uint32_t encoding, uint32_t flags, const UniChar *characters, CFIndex numChars);
 
+/* Vectorized helpers from CFBuiltinConverters.c, picked by processor feature at first use.
+   The prefix functions return how many leading characters are ASCII, converting them if there is somewhere to put them.
+*/
+CF_PRIVATE CFIndex __CFStringEncodingASCIIPrefixLength(const uint8_t *bytes, CFIndex numBytes);
+CF_PRIVATE CFIndex __CFStringEncodingUTF16ASCIIPrefixLength(const UniChar *characters, CFIndex numChars);
+CF_PRIVATE CFIndex __CFStringEncodingWidenASCIIPrefix(const uint8_t *bytes, CFIndex numBytes, UniChar *characters);
+CF_PRIVATE CFIndex __CFStringEncodingNarrowASCIIPrefix(const UniChar *characters, CFIndex numChars, uint8_t *bytes);
+CF_PRIVATE bool __CFStringEncodingIsValidUTF8(const uint8_t *bytes, CFIndex numBytes);
+
 #endif /* ! __COREFOUNDATION_CFSTRINGENCODINGCONVERTERPRIV__ */
 
 // clang-format on
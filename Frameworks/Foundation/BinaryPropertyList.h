@@ -0,0 +1,163 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#pragma once
+
+#import <Foundation/NSString.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+@class NSData;
+@class NSMutableData;
+
+// Streaming writer and lazy reader for the bplist00 format, used by NSKeyedArchiver and NSKeyedUnarchiver to
+// avoid building (or materializing) an intermediate tree of property list objects.
+namespace BinaryPropertyList {
+
+// Index of an object in a binary property list's object table.
+using ObjectRef = uint32_t;
+
+// Object table builder. Leaf objects are encoded as they are added; containers hold object references and are
+// encoded when the table is written, once the final reference size is known. Strings, integers and UIDs are uniqued,
+// so adding the same key or value repeatedly adds a single object.
+class Writer {
+public:
+    Writer();
+
+    ObjectRef addString(NSString* string);
+    ObjectRef addInteger(int64_t value);
+    ObjectRef addUnsignedInteger(uint64_t value);
+    ObjectRef addFloat(float value);
+    ObjectRef addDouble(double value);
+    ObjectRef addBool(bool value);
+    ObjectRef addData(const void* bytes, size_t length);
+    ObjectRef addDate(double timeIntervalSinceReferenceDate);
+    ObjectRef addUID(uint32_t uid);
+
+    // Adds any property list object (string, number, data, date, array or dictionary of those).
+    ObjectRef addPropertyList(id plist);
+
+    ObjectRef addArray(const ObjectRef* refs, size_t count);
+    ObjectRef addDictionary(const ObjectRef* keys, const ObjectRef* values, size_t count);
+
+    // Serializes the object table into data, replacing its contents.
+    void write(NSMutableData* data, ObjectRef topObject) const;
+
+private:
+    struct Entry {
+        uint8_t marker; // Container marker, or 0 for a pre-encoded leaf.
+        uint32_t start; // Offset into _leafBytes, or index into _containerRefs.
+        uint32_t count; // Encoded length of a leaf, or number of elements in a container.
+    };
+
+    ObjectRef _addLeaf();
+
+    std::vector<Entry> _entries;
+    std::vector<uint8_t> _leafBytes;
+    std::vector<ObjectRef> _containerRefs;
+
+    // Scratch space used while encoding a leaf.
+    std::vector<uint8_t> _scratch;
+    std::vector<unichar> _characters;
+
+    // Keyed by encoded bytes, marker included.
+    std::unordered_map<std::string, ObjectRef> _strings;
+    std::unordered_map<int64_t, ObjectRef> _integers;
+    std::vector<ObjectRef> _uids;
+    ObjectRef _bools[2];
+};
+
+enum class ObjectType { Invalid, Null, Bool, Integer, Real, Date, Data, String, UID, Array, Set, Dictionary };
+
+// Random-access view over the bytes of a binary property list. Nothing is materialized until asked for; the
+// accessors return false (or nil) for out-of-range references or objects of the wrong type.
+class Reader {
+public:
+    // bytes must remain valid (and unchanged) for as long as the reader is used.
+    bool open(const uint8_t* bytes, size_t length);
+
+    ObjectRef topObject() const {
+        return _topObject;
+    }
+
+    ObjectType typeOf(ObjectRef ref) const;
+
+    // Number of elements in an array or set, or of key/value pairs in a dictionary.
+    bool count(ObjectRef ref, size_t* count) const;
+    bool arrayElement(ObjectRef array, size_t index, ObjectRef* element) const;
+    bool dictionaryEntry(ObjectRef dictionary, size_t index, ObjectRef* key, ObjectRef* value) const;
+
+    // Looks up key by comparing it against the encoded keys in place, without materializing them.
+    bool dictionaryValue(ObjectRef dictionary, NSString* key, ObjectRef* value) const;
+
+    bool boolValue(ObjectRef ref, bool* value) const;
+    bool integerValue(ObjectRef ref, int64_t* value) const;
+    bool doubleValue(ObjectRef ref, double* value) const;
+    bool uidValue(ObjectRef ref, uint32_t* value) const;
+    bool dataBytes(ObjectRef ref, const uint8_t** bytes, size_t* length) const;
+    bool stringEquals(ObjectRef ref, NSString* string) const;
+
+    // Hashes an encoded string without materializing it. ASCII and UTF-16 encodings of the same characters hash alike,
+    // and match StringHash.
+    bool stringHash(ObjectRef ref, uint32_t* hash) const;
+
+    // Returns an autoreleased Foundation object for ref and, for containers, everything beneath it. Containers nested too
+    // deeply to recurse into safely are left out, as are objects that can't be decoded.
+    id objectForRef(ObjectRef ref) const;
+
+    // Returns true if the top object and everything beneath it can be decoded: every offset and object reference is in
+    // range, every leaf fits in the object data, and no container contains itself. Reads nothing but the encoding.
+    bool validate() const;
+
+private:
+    bool _offsetOf(ObjectRef ref, uint64_t* offset) const;
+    bool _header(ObjectRef ref, uint8_t* marker, uint64_t* count, const uint8_t** contents) const;
+    bool _refAt(const uint8_t* refs, size_t index, ObjectRef* ref) const;
+    bool _stringEquals(ObjectRef ref, NSString* string, const char* utf8, size_t utf8Length, NSUInteger length) const;
+    id _objectForRef(ObjectRef ref, size_t depth) const;
+
+    const uint8_t* _bytes = nullptr;
+    size_t _length = 0;
+    const uint8_t* _offsetTable = nullptr; // Also the end of the object data.
+    uint8_t _offsetIntSize = 0;
+    uint8_t _objectRefSize = 0;
+    uint64_t _objectCount = 0;
+    ObjectRef _topObject = 0;
+};
+
+// Returns true if bytes begin with a binary property list header.
+bool IsBinaryPropertyList(const uint8_t* bytes, size_t length);
+
+uint32_t StringHash(NSString* string);
+
+// Binary property lists shorter than this are cheaper to decode up front than through lazy containers.
+const size_t c_lazyMinimumLength = 64 * 1024;
+
+// Returns the contents of the property list file at path, or nil if it cannot be read. If mapLargeFiles is true, files
+// of c_lazyMinimumLength or more are mapped so that they can be read lazily; smaller files are always copied into
+// memory, and leave nothing mapped or open.
+NSData* DataWithContentsOfFile(NSString* path, bool mapLargeFiles);
+
+// Returns an autoreleased, immutable dictionary or array over the binary property list in data, or nil if data does
+// not hold a valid one. The encoding is validated up front, so that a damaged property list fails here as it would when
+// read eagerly. Nested containers are proxies as well, and nothing is decoded until it is first accessed. The returned
+// objects keep (an immutable copy of) data alive, so mapped data stays mapped for as long as any of them is in use.
+id LazyPropertyListWithData(NSData* data);
+
+} // namespace BinaryPropertyList
@@ -0,0 +1,1383 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#import "Starboard.h"
+#import "BinaryPropertyList.h"
+#import "Foundation/NSArray.h"
+#import "Foundation/NSData.h"
+#import "Foundation/NSDate.h"
+#import "Foundation/NSDictionary.h"
+#import "Foundation/NSException.h"
+#import "Foundation/NSFileManager.h"
+#import "Foundation/NSMutableData.h"
+#import "Foundation/NSNumber.h"
+#import "Foundation/NSSet.h"
+#import <CoreFoundation/CFArray.h>
+#import <CoreFoundation/CFDictionary.h>
+#import <CoreFoundation/CFNumber.h>
+#import "ForFoundationOnly.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace BinaryPropertyList {
+
+namespace {
+
+enum : uint8_t {
+    c_markerNull = 0x00,
+    c_markerFalse = 0x08,
+    c_markerTrue = 0x09,
+    c_markerInteger = 0x10,
+    c_markerReal = 0x20,
+    c_markerFloat = 0x22,
+    c_markerDouble = 0x23,
+    c_markerDate = 0x33,
+    c_markerData = 0x40,
+    c_markerASCIIString = 0x50,
+    c_markerUnicodeString = 0x60,
+    c_markerUID = 0x80,
+    c_markerArray = 0xA0,
+    c_markerSet = 0xC0,
+    c_markerDictionary = 0xD0,
+};
+
+const uint8_t c_header[] = { 'b', 'p', 'l', 'i', 's', 't', '0', '0' };
+const size_t c_headerLength = sizeof(c_header);
+const size_t c_trailerLength = 32;
+const ObjectRef c_noRef = UINT32_MAX;
+
+// Containers nested deeper than this are left out of objectForRef's result rather than recursed into.
+const size_t c_maxNestingDepth = 512;
+
+// Smallest of 1, 2, 4 or 8 bytes that holds value.
+uint8_t bytesNeeded(uint64_t value) {
+    if (value <= 0xFF) {
+        return 1;
+    } else if (value <= 0xFFFF) {
+        return 2;
+    } else if (value <= 0xFFFFFFFF) {
+        return 4;
+    }
+    return 8;
+}
+
+void storeBigEndian(uint8_t* dest, uint64_t value, size_t size) {
+    for (size_t i = size; i > 0; --i) {
+        dest[i - 1] = static_cast<uint8_t>(value);
+        value >>= 8;
+    }
+}
+
+uint64_t loadBigEndian(const uint8_t* src, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value = (value << 8) | src[i];
+    }
+    return value;
+}
+
+void appendBigEndian(std::vector<uint8_t>& bytes, uint64_t value, size_t size) {
+    size_t position = bytes.size();
+    bytes.resize(position + size);
+    storeBigEndian(bytes.data() + position, value, size);
+}
+
+// Only 8 byte integers are signed; shorter encodings are always unsigned.
+void appendInteger(std::vector<uint8_t>& bytes, int64_t value) {
+    uint8_t size = (value < 0) ? 8 : bytesNeeded(static_cast<uint64_t>(value));
+    uint8_t sizeLog2 = (size == 1) ? 0 : (size == 2) ? 1 : (size == 4) ? 2 : 3;
+    bytes.push_back(c_markerInteger | sizeLog2);
+    appendBigEndian(bytes, static_cast<uint64_t>(value), size);
+}
+
+void appendMarkerAndCount(std::vector<uint8_t>& bytes, uint8_t marker, uint64_t count) {
+    if (count < 0xF) {
+        bytes.push_back(marker | static_cast<uint8_t>(count));
+    } else {
+        bytes.push_back(marker | 0xF);
+        appendInteger(bytes, static_cast<int64_t>(count));
+    }
+}
+
+size_t markerAndCountLength(uint64_t count) {
+    return (count < 0xF) ? 1 : 2 + bytesNeeded(count);
+}
+
+// FNV-1a over UTF-16 code units.
+const uint32_t c_hashBasis = 2166136261u;
+
+uint32_t hashStep(uint32_t hash, unichar ch) {
+    return (hash ^ ch) * 16777619u;
+}
+
+bool fits(const uint8_t* start, const uint8_t* end, uint64_t length) {
+    return length <= static_cast<uint64_t>(end - start);
+}
+
+} // namespace
+
+uint32_t StringHash(NSString* string) {
+    unichar characters[64];
+    NSUInteger length = [string length];
+    uint32_t hash = c_hashBasis;
+    for (NSUInteger start = 0; start < length; start += _countof(characters)) {
+        NSUInteger count = std::min<NSUInteger>(_countof(characters), length - start);
+        [string getCharacters:characters range:NSMakeRange(start, count)];
+        for (NSUInteger i = 0; i < count; ++i) {
+            hash = hashStep(hash, characters[i]);
+        }
+    }
+    return hash;
+}
+
+bool IsBinaryPropertyList(const uint8_t* bytes, size_t length) {
+    // Any bplist0x version is accepted here; Reader::open is the one that validates the layout.
+    return (length >= c_headerLength) && (memcmp(bytes, c_header, c_headerLength - 1) == 0);
+}
+
+#pragma region Writer
+Writer::Writer() : _bools{ c_noRef, c_noRef } {
+}
+
+ObjectRef Writer::_addLeaf() {
+    ObjectRef ref = static_cast<ObjectRef>(_entries.size());
+    _entries.push_back({ 0, static_cast<uint32_t>(_leafBytes.size()), static_cast<uint32_t>(_scratch.size()) });
+    _leafBytes.insert(_leafBytes.end(), _scratch.begin(), _scratch.end());
+    return ref;
+}
+
+ObjectRef Writer::addString(NSString* string) {
+    NSUInteger length = [string length];
+    _characters.resize(length);
+    [string getCharacters:_characters.data() range:NSMakeRange(0, length)];
+
+    _scratch.clear();
+    if (std::all_of(_characters.begin(), _characters.end(), [](unichar ch) { return ch < 0x80; })) {
+        appendMarkerAndCount(_scratch, c_markerASCIIString, length);
+        _scratch.insert(_scratch.end(), _characters.begin(), _characters.end());
+    } else {
+        appendMarkerAndCount(_scratch, c_markerUnicodeString, length);
+        for (unichar ch : _characters) {
+            appendBigEndian(_scratch, ch, sizeof(unichar));
+        }
+    }
+
+    std::string encoded(_scratch.begin(), _scratch.end());
+    auto found = _strings.find(encoded);
+    if (found != _strings.end()) {
+        return found->second;
+    }
+
+    ObjectRef ref = _addLeaf();
+    _strings.emplace(std::move(encoded), ref);
+    return ref;
+}
+
+ObjectRef Writer::addInteger(int64_t value) {
+    auto found = _integers.find(value);
+    if (found != _integers.end()) {
+        return found->second;
+    }
+
+    _scratch.clear();
+    appendInteger(_scratch, value);
+    ObjectRef ref = _addLeaf();
+    _integers.emplace(value, ref);
+    return ref;
+}
+
+ObjectRef Writer::addUnsignedInteger(uint64_t value) {
+    if (value <= INT64_MAX) {
+        return addInteger(static_cast<int64_t>(value));
+    }
+
+    // Values that do not fit in a signed 64 bit integer use the 16 byte form.
+    _scratch.clear();
+    _scratch.push_back(c_markerInteger | 4);
+    appendBigEndian(_scratch, 0, sizeof(uint64_t));
+    appendBigEndian(_scratch, value, sizeof(uint64_t));
+    return _addLeaf();
+}
+
+ObjectRef Writer::addFloat(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    _scratch.clear();
+    _scratch.push_back(c_markerFloat);
+    appendBigEndian(_scratch, bits, sizeof(bits));
+    return _addLeaf();
+}
+
+ObjectRef Writer::addDouble(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    _scratch.clear();
+    _scratch.push_back(c_markerDouble);
+    appendBigEndian(_scratch, bits, sizeof(bits));
+    return _addLeaf();
+}
+
+ObjectRef Writer::addDate(double timeIntervalSinceReferenceDate) {
+    uint64_t bits;
+    memcpy(&bits, &timeIntervalSinceReferenceDate, sizeof(bits));
+
+    _scratch.clear();
+    _scratch.push_back(c_markerDate);
+    appendBigEndian(_scratch, bits, sizeof(bits));
+    return _addLeaf();
+}
+
+ObjectRef Writer::addBool(bool value) {
+    ObjectRef& ref = _bools[value ? 1 : 0];
+    if (ref == c_noRef) {
+        _scratch.clear();
+        _scratch.push_back(value ? c_markerTrue : c_markerFalse);
+        ref = _addLeaf();
+    }
+    return ref;
+}
+
+ObjectRef Writer::addData(const void* bytes, size_t length) {
+    // Copied straight into the leaf buffer rather than through _scratch, since data can be large.
+    _scratch.clear();
+    appendMarkerAndCount(_scratch, c_markerData, length);
+
+    ObjectRef ref = static_cast<ObjectRef>(_entries.size());
+    _entries.push_back({ 0, static_cast<uint32_t>(_leafBytes.size()), static_cast<uint32_t>(_scratch.size() + length) });
+    _leafBytes.insert(_leafBytes.end(), _scratch.begin(), _scratch.end());
+    _leafBytes.insert(_leafBytes.end(), static_cast<const uint8_t*>(bytes), static_cast<const uint8_t*>(bytes) + length);
+    return ref;
+}
+
+ObjectRef Writer::addUID(uint32_t uid) {
+    if (uid < _uids.size() && _uids[uid] != c_noRef) {
+        return _uids[uid];
+    }
+
+    uint8_t size = bytesNeeded(uid);
+    _scratch.clear();
+    _scratch.push_back(c_markerUID | (size - 1));
+    appendBigEndian(_scratch, uid, size);
+    ObjectRef ref = _addLeaf();
+
+    if (uid >= _uids.size()) {
+        _uids.resize(uid + 1, c_noRef);
+    }
+    _uids[uid] = ref;
+    return ref;
+}
+
+ObjectRef Writer::addArray(const ObjectRef* refs, size_t count) {
+    ObjectRef ref = static_cast<ObjectRef>(_entries.size());
+    _entries.push_back({ c_markerArray, static_cast<uint32_t>(_containerRefs.size()), static_cast<uint32_t>(count) });
+    _containerRefs.insert(_containerRefs.end(), refs, refs + count);
+    return ref;
+}
+
+ObjectRef Writer::addDictionary(const ObjectRef* keys, const ObjectRef* values, size_t count) {
+    ObjectRef ref = static_cast<ObjectRef>(_entries.size());
+    _entries.push_back({ c_markerDictionary, static_cast<uint32_t>(_containerRefs.size()), static_cast<uint32_t>(count) });
+    _containerRefs.insert(_containerRefs.end(), keys, keys + count);
+    _containerRefs.insert(_containerRefs.end(), values, values + count);
+    return ref;
+}
+
+ObjectRef Writer::addPropertyList(id plist) {
+    if ([plist isKindOfClass:[NSString class]]) {
+        return addString(plist);
+    }
+
+    if ([plist isKindOfClass:[NSNumber class]]) {
+        if (plist == static_cast<id>(kCFBooleanTrue) || plist == static_cast<id>(kCFBooleanFalse)) {
+            return addBool([plist boolValue]);
+        }
+
+        char type = [plist objCType][0];
+        if (type == 'f') {
+            return addFloat([plist floatValue]);
+        } else if (type == 'd') {
+            return addDouble([plist doubleValue]);
+        } else if (isupper(type)) {
+            return addUnsignedInteger([plist unsignedLongLongValue]);
+        }
+        return addInteger([plist longLongValue]);
+    }
+
+    if ([plist isKindOfClass:[NSData class]]) {
+        return addData([plist bytes], [plist length]);
+    }
+
+    if ([plist isKindOfClass:[NSDate class]]) {
+        return addDate([plist timeIntervalSinceReferenceDate]);
+    }
+
+    if ([plist isKindOfClass:[NSArray class]]) {
+        std::vector<ObjectRef> refs;
+        refs.reserve([plist count]);
+        for (id element in static_cast<NSArray*>(plist)) {
+            refs.push_back(addPropertyList(element));
+        }
+        return addArray(refs.data(), refs.size());
+    }
+
+    if ([plist isKindOfClass:[NSDictionary class]]) {
+        std::vector<ObjectRef> keys;
+        std::vector<ObjectRef> values;
+        keys.reserve([plist count]);
+        values.reserve([plist count]);
+        for (id key in static_cast<NSDictionary*>(plist)) {
+            keys.push_back(addPropertyList(key));
+            values.push_back(addPropertyList([plist objectForKey:key]));
+        }
+        return addDictionary(keys.data(), values.data(), keys.size());
+    }
+
+    [NSException raise:NSInvalidArgumentException format:@"%@ is not a property list object", [plist class]];
+    return c_noRef;
+}
+
+void Writer::write(NSMutableData* data, ObjectRef topObject) const {
+    size_t objectCount = _entries.size();
+    uint8_t refSize = bytesNeeded(objectCount ? objectCount - 1 : 0);
+
+    std::vector<uint64_t> offsets(objectCount);
+    uint64_t offset = c_headerLength;
+    for (size_t i = 0; i < objectCount; ++i) {
+        const Entry& entry = _entries[i];
+        offsets[i] = offset;
+        if (entry.marker == 0) {
+            offset += entry.count;
+        } else {
+            uint64_t refCount = (entry.marker == c_markerDictionary) ? 2ULL * entry.count : entry.count;
+            offset += markerAndCountLength(entry.count) + refCount * refSize;
+        }
+    }
+
+    uint64_t offsetTableOffset = offset;
+    uint8_t offsetSize = bytesNeeded(offsetTableOffset);
+
+    [data setLength:offsetTableOffset + objectCount * offsetSize + c_trailerLength];
+    uint8_t* out = static_cast<uint8_t*>([data mutableBytes]);
+    memcpy(out, c_header, c_headerLength);
+
+    std::vector<uint8_t> header;
+    for (size_t i = 0; i < objectCount; ++i) {
+        const Entry& entry = _entries[i];
+        uint8_t* position = out + offsets[i];
+        if (entry.marker == 0) {
+            memcpy(position, _leafBytes.data() + entry.start, entry.count);
+            continue;
+        }
+
+        header.clear();
+        appendMarkerAndCount(header, entry.marker, entry.count);
+        memcpy(position, header.data(), header.size());
+        position += header.size();
+
+        size_t refCount = (entry.marker == c_markerDictionary) ? 2 * entry.count : entry.count;
+        for (size_t j = 0; j < refCount; ++j, position += refSize) {
+            storeBigEndian(position, _containerRefs[entry.start + j], refSize);
+        }
+    }
+
+    uint8_t* offsetTable = out + offsetTableOffset;
+    for (size_t i = 0; i < objectCount; ++i) {
+        storeBigEndian(offsetTable + i * offsetSize, offsets[i], offsetSize);
+    }
+
+    uint8_t* trailer = offsetTable + objectCount * offsetSize;
+    memset(trailer, 0, 6);
+    trailer[6] = offsetSize;
+    trailer[7] = refSize;
+    storeBigEndian(trailer + 8, objectCount, sizeof(uint64_t));
+    storeBigEndian(trailer + 16, topObject, sizeof(uint64_t));
+    storeBigEndian(trailer + 24, offsetTableOffset, sizeof(uint64_t));
+}
+#pragma endregion
+
+#pragma region Reader
+bool Reader::open(const uint8_t* bytes, size_t length) {
+    if (!IsBinaryPropertyList(bytes, length) || length < c_headerLength + c_trailerLength) {
+        return false;
+    }
+
+    const uint8_t* trailer = bytes + length - c_trailerLength;
+    uint8_t offsetIntSize = trailer[6];
+    uint8_t objectRefSize = trailer[7];
+    uint64_t objectCount = loadBigEndian(trailer + 8, sizeof(uint64_t));
+    uint64_t topObject = loadBigEndian(trailer + 16, sizeof(uint64_t));
+    uint64_t offsetTableOffset = loadBigEndian(trailer + 24, sizeof(uint64_t));
+
+    if (offsetIntSize < 1 || offsetIntSize > 8 || objectRefSize < 1 || objectRefSize > 8 || objectCount == 0 ||
+        objectCount > UINT32_MAX || topObject >= objectCount || offsetTableOffset < c_headerLength ||
+        offsetTableOffset >= length - c_trailerLength ||
+        !fits(bytes + offsetTableOffset, trailer, objectCount * offsetIntSize)) {
+        return false;
+    }
+
+    _bytes = bytes;
+    _length = length;
+    _offsetTable = bytes + offsetTableOffset;
+    _offsetIntSize = offsetIntSize;
+    _objectRefSize = objectRefSize;
+    _objectCount = objectCount;
+    _topObject = static_cast<ObjectRef>(topObject);
+    return true;
+}
+
+bool Reader::_offsetOf(ObjectRef ref, uint64_t* offset) const {
+    if (ref >= _objectCount) {
+        return false;
+    }
+
+    *offset = loadBigEndian(_offsetTable + static_cast<size_t>(ref) * _offsetIntSize, _offsetIntSize);
+    return (*offset >= c_headerLength) && (*offset < static_cast<uint64_t>(_offsetTable - _bytes));
+}
+
+bool Reader::_header(ObjectRef ref, uint8_t* marker, uint64_t* count, const uint8_t** contents) const {
+    uint64_t offset;
+    if (!_offsetOf(ref, &offset)) {
+        return false;
+    }
+
+    const uint8_t* position = _bytes + offset;
+    uint8_t value = *position++;
+    uint64_t length = value & 0xF;
+
+    switch (value & 0xF0) {
+        case c_markerData:
+        case c_markerASCIIString:
+        case c_markerUnicodeString:
+        case c_markerArray:
+        case c_markerSet:
+        case c_markerDictionary:
+            if (length == 0xF) {
+                if (!fits(position, _offsetTable, 1) || (*position & 0xF0) != c_markerInteger) {
+                    return false;
+                }
+
+                size_t size = 1ULL << (*position++ & 0xF);
+                if (size > sizeof(uint64_t) || !fits(position, _offsetTable, size)) {
+                    return false;
+                }
+                length = loadBigEndian(position, size);
+                position += size;
+            }
+            break;
+    }
+
+    *marker = value;
+    *count = length;
+    *contents = position;
+    return true;
+}
+
+bool Reader::_refAt(const uint8_t* refs, size_t index, ObjectRef* ref) const {
+    uint64_t value = loadBigEndian(refs + index * _objectRefSize, _objectRefSize);
+    if (value >= _objectCount) {
+        return false;
+    }
+
+    *ref = static_cast<ObjectRef>(value);
+    return true;
+}
+
+ObjectType Reader::typeOf(ObjectRef ref) const {
+    uint8_t marker;
+    uint64_t count;
+    const uint8_t* contents;
+    if (!_header(ref, &marker, &count, &contents)) {
+        return ObjectType::Invalid;
+    }
+
+    switch (marker & 0xF0) {
+        case c_markerNull:
+            if (marker == c_markerNull) {
+                return ObjectType::Null;
+            } else if (marker == c_markerFalse || marker == c_markerTrue) {
+                return ObjectType::Bool;
+            }
+            return ObjectType::Invalid;
+        case c_markerInteger:
+            return ObjectType::Integer;
+        case c_markerReal:
+            return ObjectType::Real;
+        case c_markerDate & 0xF0:
+            return (marker == c_markerDate) ? ObjectType::Date : ObjectType::Invalid;
+        case c_markerData:
+            return ObjectType::Data;
+        case c_markerASCIIString:
+        case c_markerUnicodeString:
+            return ObjectType::String;
+        case c_markerUID:
+            return ObjectType::UID;
+        case c_markerArray:
+            return ObjectType::Array;
+        case c_markerSet:
+            return ObjectType::Set;
+        case c_markerDictionary:
+            return ObjectType::Dictionary;
+    }
+    return ObjectType::Invalid;
+}
+
+bool Reader::count(ObjectRef ref, size_t* count) const {
+    uint8_t marker;
+    uint64_t length;
+    const uint8_t* contents;
+    if (!_header(ref, &marker, &length, &contents)) {
+        return false;
+    }
+
+    uint8_t type = marker & 0xF0;
+    uint64_t refCount = (type == c_markerDictionary) ? 2 * length : length;
+    if ((type != c_markerArray && type != c_markerSet && type != c_markerDictionary) || refCount < length ||
+        refCount > static_cast<uint64_t>(_offsetTable - contents) / _objectRefSize) {
+        return false;
+    }
+
+    *count = static_cast<size_t>(length);
+    return true;
+}
+
+bool Reader::arrayElement(ObjectRef array, size_t index, ObjectRef* element) const {
+    uint8_t marker;
+    uint64_t length;
+    const uint8_t* contents;
+    if (!_header(array, &marker, &length, &contents) || ((marker & 0xF0) != c_markerArray && (marker & 0xF0) != c_markerSet) ||
+        index >= length || !fits(contents, _offsetTable, (index + 1) * _objectRefSize)) {
+        return false;
+    }
+
+    return _refAt(contents, index, element);
+}
+
+bool Reader::dictionaryEntry(ObjectRef dictionary, size_t index, ObjectRef* key, ObjectRef* value) const {
+    uint8_t marker;
+    uint64_t length;
+    const uint8_t* contents;
+    if (!_header(dictionary, &marker, &length, &contents) || (marker & 0xF0) != c_markerDictionary || index >= length ||
+        !fits(contents, _offsetTable, (length + index + 1) * _objectRefSize)) {
+        return false;
+    }
+
+    return _refAt(contents, index, key) && _refAt(contents, length + index, value);
+}
+
+bool Reader::dictionaryValue(ObjectRef dictionary, NSString* key, ObjectRef* value) const {
+    uint8_t marker;
+    uint64_t length;
+    const uint8_t* contents;
+    if (!_header(dictionary, &marker, &length, &contents) || (marker & 0xF0) != c_markerDictionary ||
+        length > static_cast<uint64_t>(_offsetTable - contents) / (2 * _objectRefSize)) {
+        return false;
+    }
+
+    const char* utf8 = [key UTF8String];
+    size_t utf8Length = strlen(utf8);
+    NSUInteger keyLength = [key length];
+
+    for (size_t i = 0; i < length; ++i) {
+        ObjectRef keyRef;
+        if (_refAt(contents, i, &keyRef) && _stringEquals(keyRef, key, utf8, utf8Length, keyLength)) {
+            return _refAt(contents, length + i, value);
+        }
+    }
+    return false;
+}
+
+bool Reader::_stringEquals(ObjectRef ref, NSString* string, const char* utf8, size_t utf8Length, NSUInteger length) const {
+    uint8_t marker;
+    uint64_t count;
+    const uint8_t* contents;
+    if (!_header(ref, &marker, &count, &contents)) {
+        return false;
+    }
+
+    if ((marker & 0xF0) == c_markerASCIIString) {
+        return (count == utf8Length) && fits(contents, _offsetTable, count) && (memcmp(contents, utf8, utf8Length) == 0);
+    }
+
+    if ((marker & 0xF0) == c_markerUnicodeString) {
+        if (count != length || !fits(contents, _offsetTable, count * sizeof(unichar))) {
+            return false;
+        }
+
+        for (NSUInteger i = 0; i < length; ++i) {
+            if (static_cast<unichar>(loadBigEndian(contents + i * sizeof(unichar), sizeof(unichar))) != [string characterAtIndex:i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+bool Reader::stringEquals(ObjectRef ref, NSString* string) const {
+    const char* utf8 = [string UTF8String];
+    return _stringEquals(ref, string, utf8, strlen(utf8), [string length]);
+}
+
+bool Reader::stringHash(ObjectRef ref, uint32_t* hash) const {
+    uint8_t marker;
+    uint64_t count;
+    const uint8_t* contents;
+    if (!_header(ref, &marker, &count, &contents)) {
+        return false;
+    }
+
+    uint32_t value = c_hashBasis;
+    if ((marker & 0xF0) == c_markerASCIIString) {
+        if (!fits(contents, _offsetTable, count)) {
+            return false;
+        }
+
+        for (uint64_t i = 0; i < count; ++i) {
+            value = hashStep(value, contents[i]);
+        }
+    } else if ((marker & 0xF0) == c_markerUnicodeString) {
+        if (count * sizeof(unichar) < count || !fits(contents, _offsetTable, count * sizeof(unichar))) {
+            return false;
+        }
+
+        for (uint64_t i = 0; i < count; ++i) {
+            value = hashStep(value, static_cast<unichar>(loadBigEndian(contents + i * sizeof(unichar), sizeof(unichar))));
+        }
+    } else {
+        return false;
+    }
+
+    *hash = value;
+    return true;
+}
+
+bool Reader::boolValue(ObjectRef ref, bool* value) const {
+    uint8_t marker;
+    uint64_t count;
+    const uint8_t* contents;
+    if (!_header(ref, &marker, &count, &contents) || (marker != c_markerTrue && marker != c_markerFalse)) {
+        return false;
+    }
+
+    *value = (marker == c_markerTrue);
+    return true;
+}
+
+bool Reader::integerValue(ObjectRef ref, int64_t* value) const {
+    uint8_t marker;
+    uint64_t count;
+    const uint8_t* contents;
+    if (!_header(ref, &marker, &count, &contents) || (marker & 0xF0) != c_markerInteger) {
+        return false;
+    }
+
+    size_t size = 1ULL << (marker & 0xF);
+    if (size > 16 || !fits(contents, _offsetTable, size)) {
+        return false;
+    }
+
+    // 16 byte integers only carry unsigned 64 bit values; the upper half is zero.
+    if (size == 16) {
+        contents += sizeof(uint64_t);
+        size = sizeof(uint64_t);
+    }
+
+    *value = static_cast<int64_t>(loadBigEndian(contents, size));
+    return true;
+}
+
+bool Reader::doubleValue(ObjectRef ref, double* value) const {
+    uint8_t marker;
+    uint64_t count;
+    const uint8_t* contents;
+    if (!_header(ref, &marker, &count, &contents)) {
+        return false;
+    }
+
+    if (marker == c_markerFloat && fits(contents, _offsetTable, sizeof(float))) {
+        uint32_t bits = static_cast<uint32_t>(loadBigEndian(contents, sizeof(bits)));
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        *value = result;
+        return true;
+    }
+
+    if ((marker == c_markerDouble || marker == c_markerDate) && fits(contents, _offsetTable, sizeof(double))) {
+        uint64_t bits = loadBigEndian(contents, sizeof(bits));
+        memcpy(value, &bits, sizeof(*value));
+        return true;
+    }
+
+    return false;
+}
+
+bool Reader::uidValue(ObjectRef ref, uint32_t* value) const {
+    uint8_t marker;
+    uint64_t count;
+    const uint8_t* contents;
+    if (!_header(ref, &marker, &count, &contents)) {
+        return false;
+    }
+
+    if ((marker & 0xF0) == c_markerUID) {
+        size_t size = (marker & 0xF) + 1;
+        if (size > sizeof(uint32_t) || !fits(contents, _offsetTable, size)) {
+            return false;
+        }
+
+        *value = static_cast<uint32_t>(loadBigEndian(contents, size));
+        return true;
+    }
+
+    // Archives that went through an XML representation on the way here may still spell references as { CF$UID = n }.
+    int64_t uid;
+    ObjectRef uidRef;
+    if (marker == (c_markerDictionary | 1) && dictionaryValue(ref, @"CF$UID", &uidRef) && integerValue(uidRef, &uid) && uid >= 0 &&
+        uid <= UINT32_MAX) {
+        *value = static_cast<uint32_t>(uid);
+        return true;
+    }
+
+    return false;
+}
+
+bool Reader::dataBytes(ObjectRef ref, const uint8_t** bytes, size_t* length) const {
+    uint8_t marker;
+    uint64_t count;
+    const uint8_t* contents;
+    if (!_header(ref, &marker, &count, &contents) || (marker & 0xF0) != c_markerData || !fits(contents, _offsetTable, count)) {
+        return false;
+    }
+
+    *bytes = contents;
+    *length = static_cast<size_t>(count);
+    return true;
+}
+
+id Reader::objectForRef(ObjectRef ref) const {
+    return _objectForRef(ref, 0);
+}
+
+id Reader::_objectForRef(ObjectRef ref, size_t depth) const {
+    uint8_t marker;
+    uint64_t count;
+    const uint8_t* contents;
+    if (!_header(ref, &marker, &count, &contents)) {
+        return nil;
+    }
+
+    switch (typeOf(ref)) {
+        case ObjectType::Bool:
+            return [NSNumber numberWithBool:(marker == c_markerTrue)];
+
+        case ObjectType::Integer: {
+            int64_t value;
+            if (!integerValue(ref, &value)) {
+                return nil;
+            }
+            return (marker == (c_markerInteger | 4)) ? [NSNumber numberWithUnsignedLongLong:static_cast<uint64_t>(value)] :
+                                                       [NSNumber numberWithLongLong:value];
+        }
+
+        case ObjectType::Real: {
+            double value;
+            if (!doubleValue(ref, &value)) {
+                return nil;
+            }
+            return (marker == c_markerFloat) ? [NSNumber numberWithFloat:static_cast<float>(value)] : [NSNumber numberWithDouble:value];
+        }
+
+        case ObjectType::Date: {
+            double value;
+            return doubleValue(ref, &value) ? [NSDate dateWithTimeIntervalSinceReferenceDate:value] : nil;
+        }
+
+        case ObjectType::Data: {
+            const uint8_t* bytes;
+            size_t length;
+            return dataBytes(ref, &bytes, &length) ? [NSData dataWithBytes:bytes length:length] : nil;
+        }
+
+        case ObjectType::String: {
+            bool unicode = (marker & 0xF0) == c_markerUnicodeString;
+            uint64_t length = unicode ? count * sizeof(unichar) : count;
+            if (length < count || !fits(contents, _offsetTable, length)) {
+                return nil;
+            }
+            return [[[NSString alloc] initWithBytes:contents
+                                             length:static_cast<NSUInteger>(length)
+                                           encoding:unicode ? NSUTF16BigEndianStringEncoding : NSASCIIStringEncoding] autorelease];
+        }
+
+        case ObjectType::Array:
+        case ObjectType::Set: {
+            size_t elementCount;
+            if (depth >= c_maxNestingDepth || !this->count(ref, &elementCount)) {
+                return nil;
+            }
+
+            std::vector<id> elements;
+            elements.reserve(elementCount);
+            for (size_t i = 0; i < elementCount; ++i) {
+                ObjectRef elementRef;
+                id element = arrayElement(ref, i, &elementRef) ? _objectForRef(elementRef, depth + 1) : nil;
+                if (element) {
+                    elements.push_back(element);
+                }
+            }
+
+            if ((marker & 0xF0) == c_markerSet) {
+                return [NSSet setWithObjects:elements.data() count:elements.size()];
+            }
+            return [NSArray arrayWithObjects:elements.data() count:elements.size()];
+        }
+
+        case ObjectType::Dictionary: {
+            size_t entryCount;
+            if (depth >= c_maxNestingDepth || !this->count(ref, &entryCount)) {
+                return nil;
+            }
+
+            std::vector<id> keys;
+            std::vector<id> values;
+            keys.reserve(entryCount);
+            values.reserve(entryCount);
+            for (size_t i = 0; i < entryCount; ++i) {
+                ObjectRef keyRef;
+                ObjectRef valueRef;
+                if (!dictionaryEntry(ref, i, &keyRef, &valueRef)) {
+                    continue;
+                }
+
+                id key = _objectForRef(keyRef, depth + 1);
+                id value = _objectForRef(valueRef, depth + 1);
+                if (key && value) {
+                    keys.push_back(key);
+                    values.push_back(value);
+                }
+            }
+            return [NSDictionary dictionaryWithObjects:values.data() forKeys:keys.data() count:keys.size()];
+        }
+
+        default:
+            // Null and UID objects have no Foundation counterpart.
+            return nil;
+    }
+}
+
+bool Reader::validate() const {
+    enum class State : uint8_t { Unchecked, Checking, Checked };
+    std::vector<State> states(static_cast<size_t>(_objectCount), State::Unchecked);
+
+    // Containers whose references are being checked: the container, how many of its references have been checked, and
+    // how many it has. A dictionary's keys come before its values.
+    struct Pending {
+        ObjectRef container;
+        size_t checked;
+        size_t refCount;
+    };
+    std::vector<Pending> pending;
+
+    auto check = [&](ObjectRef ref) {
+        if (states[ref] == State::Checked) {
+            return true;
+        }
+        if (states[ref] == State::Checking) {
+            return false;
+        }
+
+        size_t count;
+        switch (typeOf(ref)) {
+            case ObjectType::Array:
+            case ObjectType::Set:
+            case ObjectType::Dictionary:
+                if (!this->count(ref, &count)) {
+                    return false;
+                }
+                states[ref] = State::Checking;
+                pending.push_back({ ref, 0, (typeOf(ref) == ObjectType::Dictionary) ? 2 * count : count });
+                return true;
+
+            case ObjectType::Bool:
+                break;
+
+            case ObjectType::Integer: {
+                int64_t value;
+                if (!integerValue(ref, &value)) {
+                    return false;
+                }
+                break;
+            }
+
+            case ObjectType::Real:
+            case ObjectType::Date: {
+                double value;
+                if (!doubleValue(ref, &value)) {
+                    return false;
+                }
+                break;
+            }
+
+            case ObjectType::Data: {
+                const uint8_t* bytes;
+                size_t length;
+                if (!dataBytes(ref, &bytes, &length)) {
+                    return false;
+                }
+                break;
+            }
+
+            case ObjectType::String: {
+                // ASCII strings must be seven bit for NSString to decode them.
+                uint32_t hash;
+                uint8_t marker;
+                uint64_t length;
+                const uint8_t* contents;
+                if (!stringHash(ref, &hash) || !_header(ref, &marker, &length, &contents) ||
+                    ((marker & 0xF0) == c_markerASCIIString &&
+                     std::any_of(contents, contents + length, [](uint8_t ch) { return ch > 0x7F; }))) {
+                    return false;
+                }
+                break;
+            }
+
+            case ObjectType::UID: {
+                uint32_t uid;
+                if (!uidValue(ref, &uid)) {
+                    return false;
+                }
+                break;
+            }
+
+            default:
+                // Null objects have no Foundation counterpart, and an eager read fails on them as well.
+                return false;
+        }
+
+        states[ref] = State::Checked;
+        return true;
+    };
+
+    if (!check(_topObject)) {
+        return false;
+    }
+
+    while (!pending.empty()) {
+        Pending& top = pending.back();
+        if (top.checked == top.refCount) {
+            states[top.container] = State::Checked;
+            pending.pop_back();
+            continue;
+        }
+
+        // count() has checked that every reference of the container lies within the object data.
+        uint8_t marker;
+        uint64_t length;
+        const uint8_t* contents;
+        ObjectRef ref;
+        if (!_header(top.container, &marker, &length, &contents) || !_refAt(contents, top.checked++, &ref) || !check(ref)) {
+            return false;
+        }
+    }
+    return true;
+}
+#pragma endregion
+
+#pragma region Lazy containers
+namespace {
+
+// Shared by every container of one lazily read property list. The reader points into data.
+struct LazyStorage {
+    explicit LazyStorage(NSData* data) : data([data copy]) {
+    }
+
+    ~LazyStorage() {
+        [data release];
+    }
+
+    NSData* data;
+    Reader reader;
+};
+
+using LazyStorageRef = std::shared_ptr<const LazyStorage>;
+
+// Returns a retained object for ref: a lazy container for arrays and dictionaries, or the decoded leaf otherwise.
+// The storage was validated when it was opened, so every object beneath its top object can be created.
+id createLazyObject(const LazyStorageRef& storage, ObjectRef ref);
+
+// Raised if an object of validated storage cannot be read after all, which means the bytes changed underneath it.
+void raiseCorruptStorage() {
+    [NSException raise:NSInternalInconsistencyException format:@"Binary property list changed after it was validated"];
+}
+
+// Returns the object in slot, storing the retained result of create there first if the slot is empty. Threads that
+// race to fill the same slot may each create an object; all but the first to store theirs release it again.
+template <typename Create>
+id lazySlotValue(std::atomic<id>& slot, Create create) {
+    id value = slot.load(std::memory_order_acquire);
+    if (!value) {
+        id created = create();
+        if (slot.compare_exchange_strong(value, created, std::memory_order_acq_rel)) {
+            value = created;
+        } else {
+            [created release];
+        }
+    }
+    return value;
+}
+
+} // namespace
+} // namespace BinaryPropertyList
+
+using BinaryPropertyList::LazyStorageRef;
+using BinaryPropertyList::ObjectRef;
+
+@interface _NSBinaryPropertyListArray : NSArray
+- (instancetype)_initWithStorage:(const LazyStorageRef&)storage ref:(ObjectRef)ref count:(size_t)count;
+@end
+
+@implementation _NSBinaryPropertyListArray {
+    LazyStorageRef _storage;
+    ObjectRef _ref;
+    NSUInteger _count;
+    std::unique_ptr<std::atomic<id>[]> _objects;
+}
+
+- (instancetype)_initWithStorage:(const LazyStorageRef&)storage ref:(ObjectRef)ref count:(size_t)count {
+    if (self = [super init]) {
+        _storage = storage;
+        _ref = ref;
+        _count = count;
+        _objects.reset(new std::atomic<id>[count]());
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (NSUInteger i = 0; i < _count; ++i) {
+        [_objects[i].load(std::memory_order_relaxed) release];
+    }
+    [super dealloc];
+}
+
+- (CFTypeID)_cfTypeID {
+    return CFArrayGetTypeID();
+}
+
+- (Class)classForCoder {
+    return [NSArray class];
+}
+
+- (NSUInteger)count {
+    return _count;
+}
+
+- (id)objectAtIndex:(NSUInteger)index {
+    if (index >= _count) {
+        [NSException raise:NSRangeException
+                    format:@"objectAtIndex: index %lu beyond count %lu",
+                           static_cast<unsigned long>(index),
+                           static_cast<unsigned long>(_count)];
+    }
+
+    return BinaryPropertyList::lazySlotValue(_objects[index], [&]() -> id {
+        ObjectRef element;
+        if (!_storage->reader.arrayElement(_ref, index, &element)) {
+            BinaryPropertyList::raiseCorruptStorage();
+        }
+        return BinaryPropertyList::createLazyObject(_storage, element);
+    });
+}
+
+// Compares strings against the elements not yet decoded in place, rather than decoding them all.
+- (BOOL)containsObject:(id)object {
+    BOOL isString = [object isKindOfClass:[NSString class]];
+    const BinaryPropertyList::Reader& reader = _storage->reader;
+    for (NSUInteger i = 0; i < _count; ++i) {
+        id element = _objects[i].load(std::memory_order_acquire);
+        if (element) {
+            if ([element isEqual:object]) {
+                return YES;
+            }
+            continue;
+        }
+
+        ObjectRef elementRef;
+        if (isString) {
+            if (reader.arrayElement(_ref, i, &elementRef) && reader.stringEquals(elementRef, object)) {
+                return YES;
+            }
+        } else if ([[self objectAtIndex:i] isEqual:object]) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+@end
+
+@interface _NSBinaryPropertyListDictionary : NSDictionary
+- (instancetype)_initWithStorage:(const LazyStorageRef&)storage ref:(ObjectRef)ref count:(size_t)count;
+@end
+
+@implementation _NSBinaryPropertyListDictionary {
+    LazyStorageRef _storage;
+    ObjectRef _ref;
+    NSUInteger _count;
+    std::unique_ptr<std::atomic<id>[]> _keys;
+    std::unique_ptr<std::atomic<id>[]> _values;
+
+    // (hash, entry) for every key, sorted by hash and built on the first lookup. Left empty, and _stringKeys false,
+    // if any key is not a string; lookups then compare materialized keys instead.
+    std::once_flag _indexOnce;
+    std::vector<std::pair<uint32_t, uint32_t>> _index;
+    bool _stringKeys;
+}
+
+- (instancetype)_initWithStorage:(const LazyStorageRef&)storage ref:(ObjectRef)ref count:(size_t)count {
+    if (self = [super init]) {
+        _storage = storage;
+        _ref = ref;
+        _count = count;
+        _keys.reset(new std::atomic<id>[count]());
+        _values.reset(new std::atomic<id>[count]());
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (NSUInteger i = 0; i < _count; ++i) {
+        [_keys[i].load(std::memory_order_relaxed) release];
+        [_values[i].load(std::memory_order_relaxed) release];
+    }
+    [super dealloc];
+}
+
+- (CFTypeID)_cfTypeID {
+    return CFDictionaryGetTypeID();
+}
+
+- (NSUInteger)count {
+    return _count;
+}
+
+- (id)_keyAtIndex:(NSUInteger)index {
+    return BinaryPropertyList::lazySlotValue(_keys[index], [&]() -> id {
+        ObjectRef key;
+        ObjectRef value;
+        if (!_storage->reader.dictionaryEntry(_ref, index, &key, &value)) {
+            BinaryPropertyList::raiseCorruptStorage();
+        }
+        return BinaryPropertyList::createLazyObject(_storage, key);
+    });
+}
+
+- (id)_valueAtIndex:(NSUInteger)index {
+    return BinaryPropertyList::lazySlotValue(_values[index], [&]() -> id {
+        ObjectRef key;
+        ObjectRef value;
+        if (!_storage->reader.dictionaryEntry(_ref, index, &key, &value)) {
+            BinaryPropertyList::raiseCorruptStorage();
+        }
+        return BinaryPropertyList::createLazyObject(_storage, value);
+    });
+}
+
+- (void)_buildIndex {
+    const BinaryPropertyList::Reader& reader = _storage->reader;
+    _index.reserve(_count);
+    for (NSUInteger i = 0; i < _count; ++i) {
+        ObjectRef key;
+        ObjectRef value;
+        uint32_t hash;
+        if (!reader.dictionaryEntry(_ref, i, &key, &value) || !reader.stringHash(key, &hash)) {
+            _index.clear();
+            return;
+        }
+        _index.emplace_back(hash, static_cast<uint32_t>(i));
+    }
+
+    std::sort(_index.begin(), _index.end());
+    _stringKeys = true;
+}
+
+- (BOOL)_getIndex:(NSUInteger*)index forKey:(id)key {
+    if (!key) {
+        return NO;
+    }
+
+    std::call_once(_indexOnce, [self]() { [self _buildIndex]; });
+
+    if (_stringKeys) {
+        if (![key isKindOfClass:[NSString class]]) {
+            return NO;
+        }
+
+        // Candidates with a matching hash are compared against the encoded key in place.
+        const BinaryPropertyList::Reader& reader = _storage->reader;
+        uint32_t hash = BinaryPropertyList::StringHash(key);
+        auto candidate = std::lower_bound(_index.begin(), _index.end(), std::make_pair(hash, 0u));
+        for (; candidate != _index.end() && candidate->first == hash; ++candidate) {
+            ObjectRef keyRef;
+            ObjectRef valueRef;
+            if (reader.dictionaryEntry(_ref, candidate->second, &keyRef, &valueRef) && reader.stringEquals(keyRef, key)) {
+                *index = candidate->second;
+                return YES;
+            }
+        }
+        return NO;
+    }
+
+    for (NSUInteger i = 0; i < _count; ++i) {
+        if ([[self _keyAtIndex:i] isEqual:key]) {
+            *index = i;
+            return YES;
+        }
+    }
+    return NO;
+}
+
+- (id)objectForKey:(id)key {
+    NSUInteger index;
+    return [self _getIndex:&index forKey:key] ? [self _valueAtIndex:index] : nil;
+}
+
+// Called by CFDictionaryGetCountOfKey. Finding the key decodes neither it nor its value.
+- (NSUInteger)countForKey:(id)key {
+    NSUInteger index;
+    return [self _getIndex:&index forKey:key] ? 1 : 0;
+}
+
+- (NSEnumerator*)keyEnumerator {
+    std::vector<id> keys(_count);
+    for (NSUInteger i = 0; i < _count; ++i) {
+        keys[i] = [self _keyAtIndex:i];
+    }
+    return [[NSArray arrayWithObjects:keys.data() count:keys.size()] objectEnumerator];
+}
+
+- (void)getObjects:(id*)objects andKeys:(id*)keys {
+    for (NSUInteger i = 0; i < _count; ++i) {
+        if (objects) {
+            objects[i] = [self _valueAtIndex:i];
+        }
+        if (keys) {
+            keys[i] = [self _keyAtIndex:i];
+        }
+    }
+}
+
+// Called by CFDictionaryGetValueIfPresent and CFDictionaryApplyFunction.
+- (BOOL)__getValue:(id*)value forKey:(id)key {
+    NSUInteger index;
+    if (![self _getIndex:&index forKey:key]) {
+        return NO;
+    }
+
+    if (value) {
+        *value = [self _valueAtIndex:index];
+    }
+    return YES;
+}
+
+- (void)__apply:(void (*)(const void*, const void*, void*))applier context:(void*)context {
+    for (NSUInteger i = 0; i < _count; ++i) {
+        applier([self _keyAtIndex:i], [self _valueAtIndex:i], context);
+    }
+}
+
+@end
+
+namespace BinaryPropertyList {
+
+namespace {
+
+id createLazyObject(const LazyStorageRef& storage, ObjectRef ref) {
+    const Reader& reader = storage->reader;
+    size_t count;
+    switch (reader.typeOf(ref)) {
+        case ObjectType::Array:
+            if (reader.count(ref, &count)) {
+                return [[_NSBinaryPropertyListArray alloc] _initWithStorage:storage ref:ref count:count];
+            }
+            break;
+
+        case ObjectType::Dictionary:
+            if (reader.count(ref, &count)) {
+                return [[_NSBinaryPropertyListDictionary alloc] _initWithStorage:storage ref:ref count:count];
+            }
+            break;
+
+        case ObjectType::UID: {
+            uint32_t uid;
+            if (reader.uidValue(ref, &uid)) {
+                return (id)_CFKeyedArchiverUIDCreate(kCFAllocatorDefault, uid);
+            }
+            break;
+        }
+
+        default: {
+            id object = reader.objectForRef(ref);
+            if (object) {
+                return [object retain];
+            }
+            break;
+        }
+    }
+
+    raiseCorruptStorage();
+    return nil;
+}
+
+} // namespace
+
+NSData* DataWithContentsOfFile(NSString* path, bool mapLargeFiles) {
+    NSDataReadingOptions options = 0;
+    if (mapLargeFiles) {
+        NSDictionary* attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nullptr];
+        if ([attributes[NSFileSize] unsignedLongLongValue] >= c_lazyMinimumLength) {
+            options = NSDataReadingMappedIfSafe;
+        }
+    }
+
+    return [NSData dataWithContentsOfFile:path options:options error:nullptr];
+}
+
+id LazyPropertyListWithData(NSData* data) {
+    auto storage = std::make_shared<LazyStorage>(data);
+    if (!storage->reader.open(static_cast<const uint8_t*>([storage->data bytes]), [storage->data length]) ||
+        !storage->reader.validate()) {
+        return nil;
+    }
+
+    ObjectRef top = storage->reader.topObject();
+    ObjectType type = storage->reader.typeOf(top);
+    if (type != ObjectType::Array && type != ObjectType::Dictionary) {
+        return nil;
+    }
+
+    return [createLazyObject(storage, top) autorelease];
+}
+#pragma endregion
+
+} // namespace BinaryPropertyList
@@ -24,6 +24,7 @@
 #include "Foundation/NSArray.h"
 #include "NSEnumeratorInternal.h"
 #include "NSPropertyListWriter_binary.h"
+#include "BinaryPropertyList.h"
 #include "CoreFoundation/CFArray.h"
 #include "Foundation/NSMutableString.h"
 #include "NSKeyedArchiverInternal.h"
@@ -101,20 +102,20 @@ BASE_CLASS_REQUIRED_IMPLS(NSArray, NSArrayPrototype, CFArrayGetTypeID);
 }
 
 /**
- @Status Interoperable
+ @Status Caveat
+ @Notes Immutable arrays map files of 64KB or more, which must not be modified while the arrays are alive.
 */
 - (NSArray*)initWithContentsOfFile:(NSString*)filename {
-    const char* file = (char*)[filename UTF8String];
+    BOOL isMutable = [self isKindOfClass:[NSMutableArray class]];
 
-    NSData* data = [NSData dataWithContentsOfFile:filename];
+    // Immutable arrays map large files, so that binary property lists are decoded as they are accessed.
+    NSData* data = BinaryPropertyList::DataWithContentsOfFile(filename, !isMutable);
 
     if (data == nil) {
         [self release];
         return nil;
     }
 
-    char* pData = (char*)[data bytes];
-
     id arrayData =
         [NSPropertyListSerialization propertyListFromData:data mutabilityOption:NSPropertyListImmutable format:0 errorDescription:0];
     if (![arrayData isKindOfClass:[NSArray class]]) {
@@ -126,6 +127,11 @@ BASE_CLASS_REQUIRED_IMPLS(NSArray, NSArrayPrototype, CFArrayGetTypeID);
         }
     }
 
+    // The property list is immutable already, and can be returned as it is rather than copied.
+    if ([self isMemberOfClass:[NSArrayPrototype class]]) {
+        return [arrayData retain];
+    }
+
     return [self initWithArray:arrayData];
 }
 
@@ -998,8 +1004,7 @@ static CFComparisonResult _CFComparatorFunctionFromComparator(const void* val1,
 }
 
 /**
- @Status Caveat
- @Notes Options are currently ignored
+ @Status Interoperable
 */
 - (NSArray*)sortedArrayWithOptions:(NSSortOptions)opts usingComparator:(NSComparator)cmptr {
     NSMutableArray* ret = [NSMutableArray arrayWithArray:self];
@@ -15,10 +15,15 @@
 //******************************************************************************
 
 #import <Foundation/NSAutoreleasePool.h>
+#import <Foundation/NSDictionary.h>
+#import <Foundation/NSValue.h>
 #import <objc/objc-arc.h>
+#import "NSAutoreleasePool+Internal.h"
+#import "ForFoundationOnly.h"
 
 @interface NSAutoreleasePool () {
     void* _opaqueAutoreleasePool;
+    CFAllocatorRef _arena;
 }
 @end
 @implementation NSAutoreleasePool
@@ -61,6 +66,10 @@
  */
 - (void)dealloc {
     objc_autoreleasePoolPop(_opaqueAutoreleasePool);
+    // Objects autoreleased into the pool are gone by now, so the arena can usually be reset.
+    if (_arena) {
+        _CFArenaScopeEnd();
+    }
     [super dealloc];
 }
 
@@ -72,3 +81,30 @@
     [self release];
 }
 @end
+
+@implementation NSAutoreleasePool (Internal)
+- (instancetype)_initWithArena {
+    if (self = [self init]) {
+        _arena = _CFArenaScopeBegin();
+    }
+    return self;
+}
+
+- (CFAllocatorRef)_arena {
+    return _arena;
+}
+
++ (NSDictionary*)_arenaStatistics {
+    _CFArenaStatistics statistics;
+    _CFArenaGetStatistics(&statistics);
+    return @{
+        @"allocations" : @(statistics.allocations),
+        @"allocatedBytes" : @(statistics.allocatedBytes),
+        @"fallbackAllocations" : @(statistics.fallbackAllocations),
+        @"deallocations" : @(statistics.deallocations),
+        @"chunks" : @(statistics.chunks),
+        @"resets" : @(statistics.resets),
+        @"retainedScopes" : @(statistics.retainedScopes),
+    };
+}
+@end
@@ -112,6 +112,22 @@ BRIDGED_CLASS_REQUIRED_IMPLS(CFArrayRef, CFArrayGetTypeID, NSArray, NSCFArray)
     CFArrayReplaceValues(static_cast<CFMutableArrayRef>(self), range, (const void**)(&obj), 1);
 }
 
+- (void)getObjects:(id*)objects range:(NSRange)range {
+    if (range.location + range.length > CFArrayGetCount((CFArrayRef)self)) {
+        [NSException raise:NSRangeException format:@"getObjects:range: range {%lu, %lu} beyond count %ld",
+                                                static_cast<unsigned long>(range.location),
+                                                static_cast<unsigned long>(range.length),
+                                                static_cast<long>(CFArrayGetCount((CFArrayRef)self))];
+    }
+    CFArrayGetValues((CFArrayRef)self, CFRangeMake(range.location, range.length), (const void**)objects);
+}
+
+- (void)_replaceObjectsInRange:(NSRange)range withObjects:(id const*)objects {
+    BRIDGED_THROW_IF_IMMUTABLE(_CFArrayIsMutable, CFArrayRef);
+    // CFArrayReplaceValues retains the new values before it releases the old ones.
+    CFArrayReplaceValues(static_cast<CFMutableArrayRef>(self), CFRangeMake(range.location, range.length), (const void**)objects, range.length);
+}
+
 - (void)insertObject:(NSObject*)objAddr atIndex:(NSUInteger)index {
     BRIDGED_THROW_IF_IMMUTABLE(_CFArrayIsMutable, CFArrayRef);
     CFArrayInsertValueAtIndex(static_cast<CFMutableArrayRef>(self), index, reinterpret_cast<const void*>(objAddr));
@@ -24,6 +24,31 @@
 @interface NSCFData : NSMutableData
 @end
 
+// Bytes allocator that hands buffers back to an NSData deallocator block instead of freeing them.
+struct NSDataDeallocator {
+    void (^block)(void*, NSUInteger);
+    NSUInteger length;
+};
+
+static void _NSDataDeallocatorRelease(const void* info) {
+    const NSDataDeallocator* deallocator = static_cast<const NSDataDeallocator*>(info);
+    Block_release(deallocator->block);
+    delete deallocator;
+}
+
+static void _NSDataDeallocatorDeallocate(void* bytes, void* info) {
+    NSDataDeallocator* deallocator = static_cast<NSDataDeallocator*>(info);
+    deallocator->block(bytes, deallocator->length);
+}
+
+static CFAllocatorRef _NSDataCreateDeallocator(void (^block)(void*, NSUInteger), NSUInteger length) {
+    NSDataDeallocator* deallocator = new NSDataDeallocator{ Block_copy(block), length };
+    CFAllocatorContext context = {
+        0, deallocator, nullptr, _NSDataDeallocatorRelease, nullptr, nullptr, nullptr, _NSDataDeallocatorDeallocate, nullptr
+    };
+    return CFAllocatorCreate(kCFAllocatorDefault, &context);
+}
+
 #pragma region NSDataPrototype
 @implementation NSDataPrototype
 
@@ -39,6 +64,18 @@ PROTOTYPE_CLASS_REQUIRED_IMPLS(NSCFData)
         (CFDataCreateWithBytesNoCopy(kCFAllocatorDefault, reinterpret_cast<const byte*>(bytes), length, deallocator))));
 }
 
+- (_Nullable instancetype)initWithBytesNoCopy:(void*)bytes
+                                       length:(NSUInteger)length
+                                  deallocator:(void (^)(void* bytes, NSUInteger length))deallocator {
+    if (!deallocator) {
+        return [self initWithBytesNoCopy:bytes length:length freeWhenDone:NO];
+    }
+
+    woc::unique_cf<CFAllocatorRef> bytesDeallocator(_NSDataCreateDeallocator(deallocator, length));
+    return reinterpret_cast<NSDataPrototype*>(static_cast<NSData*>(
+        (CFDataCreateWithBytesNoCopy(kCFAllocatorDefault, reinterpret_cast<const byte*>(bytes), length, bytesDeallocator.get()))));
+}
+
 @end
 #pragma endregion
 
@@ -66,6 +103,20 @@ PROTOTYPE_CLASS_REQUIRED_IMPLS(NSCFData)
     return reinterpret_cast<NSMutableDataPrototype*>(data);
 }
 
+- (_Nullable instancetype)initWithBytesNoCopy:(void*)bytes
+                                       length:(NSUInteger)length
+                                  deallocator:(void (^)(void* bytes, NSUInteger length))deallocator {
+    // As above, the bytes are copied and given back right away.
+    NSMutableData* data = static_cast<NSMutableData*>(CFDataCreateMutable(kCFAllocatorDefault, 0));
+    [data appendBytes:bytes length:length];
+
+    if (deallocator) {
+        deallocator(bytes, length);
+    }
+
+    return reinterpret_cast<NSMutableDataPrototype*>(data);
+}
+
 - (_Nullable instancetype)initWithCapacity:(NSUInteger)capacity {
     return reinterpret_cast<NSMutableDataPrototype*>(CFDataCreateMutable(kCFAllocatorDefault, 0));
 }
@@ -38,6 +38,7 @@
 #import <string>
 #import <sstream>
 #import <iomanip>
+#import <io.h>
 #import "NSCFData.h"
 #import "NSRaise.h"
 #import "StringHelpers.h"
@@ -285,12 +286,10 @@ BASE_CLASS_REQUIRED_IMPLS(NSData, NSDataPrototype, CFDataGetTypeID);
 }
 
 /**
- @Status Caveat
- @Notes File is not mapped; defers to initWithContentsOfFile:
+ @Status Interoperable
 */
 - (instancetype)initWithContentsOfMappedFile:(NSString*)filename {
-    TraceVerbose(TAG, L"Not actually mapping file ...");
-    return [self initWithContentsOfFile:filename];
+    return [self initWithContentsOfFile:filename options:NSDataReadingMappedIfSafe error:nullptr];
 }
 
 /**
@@ -383,9 +382,26 @@ BASE_CLASS_REQUIRED_IMPLS(NSData, NSDataPrototype, CFDataGetTypeID);
     return [[[self alloc] initWithContentsOfMappedFile:filename] autorelease];
 }
 
+// Maps length bytes of an open file read-only, or returns nullptr if the file cannot be mapped.
+static void* _mapFile(EbrFile* file, size_t length) {
+    HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(file->HostFd()));
+    if (handle == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+
+    // The view keeps the mapping object alive after its handle is closed.
+    HANDLE mapping = CreateFileMappingFromApp(handle, nullptr, PAGE_READONLY, 0, nullptr);
+    if (!mapping) {
+        return nullptr;
+    }
+    auto closeMapping = wil::ScopeExit([&]() { CloseHandle(mapping); });
+
+    return MapViewOfFileFromApp(mapping, FILE_MAP_READ, 0, length);
+}
+
 /**
  @Status Caveat
- @Notes options parameter not supported
+ @Notes NSDataReadingUncached is not supported. Mapped files must not be modified while the data is alive.
 */
 - (instancetype)initWithContentsOfFile:(NSString*)filename options:(NSDataReadingOptions)options error:(NSError**)error {
     if (!filename) {
@@ -407,6 +423,19 @@ BASE_CLASS_REQUIRED_IMPLS(NSData, NSDataPrototype, CFDataGetTypeID);
         size_t length = EbrFtell(fpIn);
         EbrFseek(fpIn, 0, SEEK_SET);
 
+        if (length && (options & (NSDataReadingMappedIfSafe | NSDataReadingMappedAlways))) {
+            void* view = _mapFile(fpIn, length);
+            if (view) {
+                return [self initWithBytesNoCopy:view
+                                          length:length
+                                     deallocator:^(void* bytes, NSUInteger) {
+                                         UnmapViewOfFile(bytes);
+                                     }];
+            }
+
+            TraceVerbose(TAG, L"NSData couldn't map %hs, reading it instead", fname);
+        }
+
         if (length) {
             // The created NSData takes ownership of freeing this
             woc::unique_iw<uint8_t> copiedBytes(static_cast<uint8_t*>(IwMalloc(length)));
@@ -451,13 +480,13 @@ BASE_CLASS_REQUIRED_IMPLS(NSData, NSDataPrototype, CFDataGetTypeID);
 }
 
 /**
- @Status Stub
+ @Status Interoperable
 */
 - (instancetype)initWithBytesNoCopy:(void*)bytes
                              length:(NSUInteger)length
                         deallocator:(void (^)(void* bytes, NSUInteger length))deallocator {
-    UNIMPLEMENTED();
-    return nil;
+    // This class is a class cluster "interface". A concrete implementation (default or derived) MUST implement this.
+    return NSInvalidAbstractInvocationReturn();
 }
 
 /**
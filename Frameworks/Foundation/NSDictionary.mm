@@ -27,6 +27,7 @@
 #import "Foundation/NSKeyedArchiver.h"
 #import "LoggingNative.h"
 #import "NSPropertyListWriter_binary.h"
+#import "BinaryPropertyList.h"
 #import "NSKeyedArchiverInternal.h"
 #import "VAListHelper.h"
 #import "NSCFDictionary.h"
@@ -318,7 +319,8 @@ BASE_CLASS_REQUIRED_IMPLS(NSDictionary, NSDictionaryPrototype, CFDictionaryGetTy
 }
 
 /**
- @Status Interoperable
+ @Status Caveat
+ @Notes Immutable dictionaries map files of 64KB or more, which must not be modified while the dictionaries are alive.
 */
 - (NSDictionary*)initWithContentsOfFile:(NSString*)filename {
     if (filename == nil) {
@@ -327,19 +329,26 @@ BASE_CLASS_REQUIRED_IMPLS(NSDictionary, NSDictionaryPrototype, CFDictionaryGetTy
         return nil;
     }
 
-    NSData* data = [NSData dataWithContentsOfFile:filename];
+    BOOL isMutable = [self isKindOfClass:[NSMutableDictionary class]];
+
+    // Immutable dictionaries map large files, so that binary property lists are decoded as they are accessed.
+    NSData* data = BinaryPropertyList::DataWithContentsOfFile(filename, !isMutable);
 
     NSDictionary* deserializedDict = nil;
     if (data) {
         deserializedDict = [NSPropertyListSerialization
             propertyListFromData:data
-                mutabilityOption:[self isKindOfClass:[NSMutableDictionary class]] ? NSPropertyListMutableContainersAndLeaves :
-                                                                                    NSPropertyListImmutable
+                mutabilityOption:isMutable ? NSPropertyListMutableContainersAndLeaves : NSPropertyListImmutable
                           format:0
                 errorDescription:0];
     }
 
     if (deserializedDict && [deserializedDict isKindOfClass:[NSDictionary class]]) {
+        // The property list is immutable already, and can be returned as it is rather than copied.
+        if ([self isMemberOfClass:[NSDictionaryPrototype class]]) {
+            return [deserializedDict retain];
+        }
+
         //  Steal its dictionary
         return [self initWithDictionary:deserializedDict];
     } else {
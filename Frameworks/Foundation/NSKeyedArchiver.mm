@@ -28,144 +28,170 @@
 #import "Etc.h"
 #import "NSLogging.h"
 #import "Hash.h"
+#import "NSKeyedArchiverInternal.h"
+#import "BinaryPropertyList.h"
+#import <CoreFoundation/CFPropertyList.h>
+
+#include <algorithm>
+#include <vector>
 
 static const wchar_t* TAG = L"NSKeyedArchiver";
 
 typedef HashMap<id, unsigned> o2uHash;
 typedef HashMap<id, id> o2oHash;
 
+using BinaryPropertyList::ObjectRef;
+
 NSString* const NSInvalidArchiveOperationException = @"NSInvalidArchiveOperationException";
 
 NSString* const NSKeyedArchiveRootObjectKey = @"NSKeyedArchiveRootObjectKey";
 static HashMap<Class, StrongId<NSString>> s_clsMap;
+
+// Keys and values of one keyed object while its encodeWithCoder: runs.
+struct NSKeyedArchiverScope {
+    std::vector<ObjectRef> keys;
+    std::vector<ObjectRef> values;
+};
+
 struct NSKeyedArchiverPriv {
     HashMap<Class, StrongId<NSString>> clsMap; /* Map classes to names.    */
     o2uHash cIdMap; /* Conditionally coded.     */
     o2uHash uIdMap; /* Unconditionally coded.   */
     o2oHash repMap; /* Mappings for objects.    */
-};
 
-void printContents(int level, id obj);
+    BinaryPropertyList::Writer writer;
 
-static inline void _checkKey(NSString* aKey, NSMutableDictionary* _enc) {
-    if (![aKey isKindOfClass:[NSString class]]) {
-        NSTraceCritical(TAG, @"Key is not an NSString\n");
-        assert(0);
-    }
-    if ([aKey hasPrefix:@"$"]) {
-        aKey = [@"$" stringByAppendingString:aKey];
+    // The archive's $objects table: uid -> object table entry.
+    std::vector<ObjectRef> objects;
+
+    // Scopes are reused across objects so that their buffers are only allocated once per nesting level;
+    // scopes[0] is $top.
+    std::vector<NSKeyedArchiverScope> scopes;
+    size_t depth = 0;
+
+    NSKeyedArchiverScope& currentScope() {
+        return scopes[depth];
     }
-    if ([_enc objectForKey:aKey] != nil) {
-        NSTraceCritical(TAG, @"Key not found:%s\n", [aKey UTF8String]);
-        assert(0);
+
+    void pushScope() {
+        if (++depth == scopes.size()) {
+            scopes.emplace_back();
+        }
+        currentScope().keys.clear();
+        currentScope().values.clear();
     }
-}
 
-/*
-* Make a dictionary referring to the object at ref in the array of all objects.
-*/
-static id makeReference(unsigned ref) {
-    id n;
-    id d;
+    void popScope() {
+        --depth;
+    }
+};
 
-    n = [NSNumber numberWithUnsignedInt:ref];
-    d = [NSDictionary dictionaryWithObject:n forKey:@"CF$UID"];
-    return d;
-}
+void printContents(int level, id obj);
 
 @implementation NSKeyedArchiver {
     NSMutableData* _data;
 
     unsigned _keyNum;
-    NSMutableDictionary* _enc;
-    NSMutableArray* _obj;
     NSMutableArray* _retainList;
 
     struct NSKeyedArchiverPriv* _priv;
 }
 
+static inline void _encodeValue(NSKeyedArchiver* self, NSString* aKey, ObjectRef value) {
+    if (![aKey isKindOfClass:[NSString class]]) {
+        NSTraceCritical(TAG, @"Key is not an NSString\n");
+        assert(0);
+    }
+
+    NSKeyedArchiverPriv* priv = self->_priv;
+    NSKeyedArchiverScope& scope = priv->currentScope();
+    ObjectRef key = priv->writer.addString(aKey);
+
+    // Keys are uniqued by the writer, so a duplicate key is a duplicate object reference.
+    auto found = std::find(scope.keys.begin(), scope.keys.end(), key);
+    if (found != scope.keys.end()) {
+        NSTraceCritical(TAG, @"Key already encoded:%s\n", [aKey UTF8String]);
+        assert(0);
+        scope.values[found - scope.keys.begin()] = value;
+        return;
+    }
+
+    scope.keys.push_back(key);
+    scope.values.push_back(value);
+}
+
 - (void)_encodeArrayOfObjects:(NSArray*)anArray forKey:(NSString*)aKey {
-    id o;
-    _checkKey(aKey, _enc);
+    ObjectRef value;
 
     if (anArray == nil) {
-        o = makeReference(0);
+        value = _priv->writer.addUID(0);
     } else {
-        unsigned c = [anArray count];
-        NSMutableArray* m = [NSMutableArray arrayWithCapacity:c];
+        std::vector<ObjectRef> refs;
+        refs.reserve([anArray count]);
 
-        for (unsigned i = 0; i < c; i++) {
-            o = [self _encodeObject:[anArray objectAtIndex:i] conditional:NO];
-            [m addObject:o];
+        for (id object in anArray) {
+            refs.push_back(_priv->writer.addUID([self _encodeObject:object conditional:NO]));
         }
-        o = m;
+        value = _priv->writer.addArray(refs.data(), refs.size());
     }
-    [_enc setObject:o forKey:aKey];
+
+    _encodeValue(self, aKey, value);
 }
 
 /**
  @Status Interoperable
 */
 - (void)encodeInt:(int)anInteger forKey:(NSString*)aKey {
-    _checkKey(aKey, _enc);
-    [_enc setObject:[NSNumber numberWithInt:anInteger] forKey:aKey];
+    _encodeValue(self, aKey, _priv->writer.addInteger(anInteger));
 }
 
 /**
  @Status Interoperable
 */
 - (void)encodeInteger:(int)anInteger forKey:(NSString*)aKey {
-    _checkKey(aKey, _enc);
-    [_enc setObject:[NSNumber numberWithInt:anInteger] forKey:aKey];
+    _encodeValue(self, aKey, _priv->writer.addInteger(anInteger));
 }
 
 /**
  @Status Interoperable
 */
 - (void)encodeInt32:(int32_t)anInteger forKey:(NSString*)aKey {
-    _checkKey(aKey, _enc);
-    [_enc setObject:[NSNumber numberWithLong:anInteger] forKey:aKey];
+    _encodeValue(self, aKey, _priv->writer.addInteger(anInteger));
 }
 
 /**
  @Status Interoperable
 */
 - (void)encodeInt64:(int64_t)anInteger forKey:(NSString*)aKey {
-    _checkKey(aKey, _enc);
-    [_enc setObject:[NSNumber numberWithLongLong:anInteger] forKey:aKey];
+    _encodeValue(self, aKey, _priv->writer.addInteger(anInteger));
 }
 
 /**
  @Status Interoperable
 */
 - (void)encodeBool:(BOOL)aBool forKey:(NSString*)aKey {
-    _checkKey(aKey, _enc);
-    [_enc setObject:[NSNumber numberWithBool:aBool] forKey:aKey];
+    _encodeValue(self, aKey, _priv->writer.addBool(aBool));
 }
 
 /**
  @Status Interoperable
 */
 - (void)encodeFloat:(float)aFloat forKey:(NSString*)aKey {
-    _checkKey(aKey, _enc);
-    [_enc setObject:[NSNumber numberWithFloat:aFloat] forKey:aKey];
+    _encodeValue(self, aKey, _priv->writer.addFloat(aFloat));
 }
 
 /**
  @Status Interoperable
 */
 - (void)encodeDouble:(double)aDouble forKey:(NSString*)aKey {
-    _checkKey(aKey, _enc);
-    [_enc setObject:[NSNumber numberWithDouble:aDouble] forKey:aKey];
+    _encodeValue(self, aKey, _priv->writer.addDouble(aDouble));
 }
 
-
 /**
  @Status Interoperable
 */
 - (void)encodeBytes:(const uint8_t*)aPointer length:(NSUInteger)length forKey:(NSString*)aKey {
-    _checkKey(aKey, _enc);
-    [_enc setObject:[NSData dataWithBytes:aPointer length:length] forKey:aKey];
+    _encodeValue(self, aKey, _priv->writer.addData(aPointer, length));
 }
 
 /**
@@ -186,8 +212,6 @@ static id makeReference(unsigned ref) {
  @Status Interoperable
 */
 - (void)dealloc {
-    [_enc release];
-    [_obj release];
     [_data release];
     [_retainList release];
     delete _priv;
@@ -197,20 +221,37 @@ static id makeReference(unsigned ref) {
 
 /**
  @Status Interoperable
+ @Notes The archive is written as a binary property list; other output formats are converted from it.
 */
 - (void)finishEncoding {
-    id error;
-
     [_delegate archiverWillFinish:self];
 
-    NSMutableDictionary* final = [NSMutableDictionary new];
-    [final setObject:NSStringFromClass([self class]) forKey:@"$archiver"];
-    [final setObject:[NSNumber numberWithInt:100000] forKey:@"$version"];
-    [final setObject:_enc forKey:@"$top"];
-    [final setObject:_obj forKey:@"$objects"];
-    id data = [NSPropertyListSerialization dataFromPropertyList:final format:_outputFormat errorDescription:&error];
-    [final release];
-    [_data setData:data];
+    BinaryPropertyList::Writer& writer = _priv->writer;
+    NSKeyedArchiverScope& top = _priv->scopes[0];
+
+    ObjectRef keys[] = { writer.addString(@"$version"),
+                         writer.addString(@"$archiver"),
+                         writer.addString(@"$top"),
+                         writer.addString(@"$objects") };
+    ObjectRef values[] = { writer.addInteger(100000),
+                           writer.addString(NSStringFromClass([self class])),
+                           writer.addDictionary(top.keys.data(), top.values.data(), top.keys.size()),
+                           writer.addArray(_priv->objects.data(), _priv->objects.size()) };
+    ObjectRef root = writer.addDictionary(keys, values, _countof(keys));
+
+    if (_outputFormat == NSPropertyListBinaryFormat_v1_0) {
+        writer.write(_data, root);
+    } else {
+        NSMutableData* binary = [NSMutableData data];
+        writer.write(binary, root);
+
+        woc::unique_cf<CFPropertyListRef> plist(
+            CFPropertyListCreateWithData(nullptr, static_cast<CFDataRef>(binary), kCFPropertyListImmutable, nullptr, nullptr));
+        woc::unique_cf<CFDataRef> converted(
+            CFPropertyListCreateData(nullptr, plist.get(), static_cast<CFPropertyListFormat>(_outputFormat), 0, nullptr));
+        [_data setData:static_cast<NSData*>(converted.get())];
+    }
+
     [_delegate archiverDidFinish:self];
 }
 
@@ -239,10 +280,9 @@ static id makeReference(unsigned ref) {
         _keyNum = 0;
         _data = [data retain];
 
-        _enc = [NSMutableDictionary new]; // Top level mapping dict
-        _obj = [NSMutableArray new]; // Array of objects.
+        _priv->scopes.emplace_back(); // Top level mapping dict
+        _priv->objects.push_back(_priv->writer.addString(@"$null")); // Placeholder.
         _retainList = [NSMutableArray new];
-        [_obj addObject:@"$null"]; // Placeholder.
 
         _outputFormat = NSPropertyListBinaryFormat_v1_0;
     }
@@ -253,9 +293,7 @@ static id makeReference(unsigned ref) {
  @Status Interoperable
 */
 - (void)encodeObject:(id)anObject forKey:(NSString*)aKey {
-    _checkKey(aKey, _enc);
-    anObject = [self _encodeObject:anObject conditional:NO];
-    [_enc setObject:anObject forKey:aKey];
+    _encodeValue(self, aKey, _priv->writer.addUID([self _encodeObject:anObject conditional:NO]));
 }
 
 /**
@@ -263,28 +301,23 @@ static id makeReference(unsigned ref) {
 */
 - (void)encodeObject:(id)anObject {
     NSString* aKey = [NSString stringWithFormat:@"$%u", _keyNum++];
-
-    anObject = [self _encodeObject:anObject conditional:NO];
-    [_enc setObject:anObject forKey:aKey];
+    _encodeValue(self, aKey, _priv->writer.addUID([self _encodeObject:anObject conditional:NO]));
 }
 
 /**
  @Status Interoperable
 */
 - (void)encodeConditionalObject:(id)anObject forKey:(NSString*)aKey {
-    _checkKey(aKey, _enc);
-    anObject = [self _encodeObject:anObject conditional:YES];
-    [_enc setObject:anObject forKey:aKey];
+    _encodeValue(self, aKey, _priv->writer.addUID([self _encodeObject:anObject conditional:YES]));
 }
 
 /*
 * The real workhorse of the archiving process ... this deals with all
-* archiving of objects. It returns the object to be stored in the
-* mapping dictionary (_enc).
+* archiving of objects. It returns the uid of the encoded object, which
+* the caller stores in the current keyed object.
 */
-- (NSDictionary*)_encodeObject:(id)anObject conditional:(BOOL)conditional {
+- (unsigned)_encodeObject:(id)anObject conditional:(BOOL)conditional {
     id original = anObject;
-    id m = nil;
 
     if (anObject != nil) {
         // Obtain replacement object for the value being encoded.
@@ -309,150 +342,142 @@ static id makeReference(unsigned ref) {
         }
     }
 
-    id objectInfo = nil; // Encoded object
+    if (anObject == nil) {
+        return 0;
+    }
+
     unsigned ref = 0;
     unsigned* refTmp;
 
-    if (anObject != nil) {
-        if (_priv->uIdMap.get(anObject, refTmp)) {
-            ref = *refTmp;
-        } else {
-            if (conditional) {
-                if (_priv->cIdMap.get(anObject, refTmp)) {
-                    ref = [_obj count];
-                    _priv->cIdMap.insert(anObject, ref);
-
-                    // Use the null object as a placeholder for a conditionally encoded object.
-                    [_obj addObject:[_obj objectAtIndex:0]];
-                } else {
-                    // This object has already been conditionally encoded.
-                    ref = *refTmp;
-                }
-            } else {
-                id c = [anObject classForKeyedArchiver];
-
-                // FIXME ... exactly what classes are stored directly???
-                if (c == [NSString class] || c == [NSNumber class] || c == [NSData class]) {
-                    objectInfo = anObject;
-                } else {
-                    // We store a dictionary describing the object.
-                    m = [NSMutableDictionary new];
-                    objectInfo = m;
-                }
-
-                if (_priv->cIdMap.get(anObject, refTmp)) {
-                    // Conditionally encoded ... replace with actual value.
-                    ref = *refTmp;
-                    _priv->uIdMap.insert(anObject, ref);
-                    _priv->cIdMap.remove(anObject);
-                    [_obj replaceObjectAtIndex:ref withObject:objectInfo];
-                } else {
-                    // Not encoded ... create dictionary for it.
-                    ref = [_obj count];
-                    _priv->uIdMap.insert(anObject, ref);
-                    [_obj addObject:objectInfo];
-                }
-                [m release];
-            }
-        }
+    if (_priv->uIdMap.get(anObject, refTmp)) {
+        return *refTmp;
     }
 
-    // Build an object to reference the encoded value of anObject
-    id refObject = makeReference(ref);
-
-    // objectInfo is a dictionary describing the object.
-    if (objectInfo != nil && m == objectInfo) {
-        id savedEnc = _enc;
-        unsigned savedKeyNum = _keyNum;
-        id c = [anObject class];
-        id classname;
-        id mapped;
-
-        /*
-        * Map the class of the object to the actual class it is encoded as.
-        * First ask the object, then apply any name mappings to that value.
-        */
-        mapped = [anObject classForKeyedArchiver];
-        if (mapped != nil) {
-            c = mapped;
+    if (conditional) {
+        if (_priv->cIdMap.get(anObject, refTmp)) {
+            // This object has already been conditionally encoded.
+            return *refTmp;
         }
 
-        classname = [self classNameForClass:c];
-        if (classname == nil) {
-            classname = [[self class] classNameForClass:c];
-        }
-        if (classname == nil) {
-            classname = NSStringFromClass(c);
-        } else {
-            c = NSClassFromString(classname);
-        }
+        // Use the null object as a placeholder for a conditionally encoded object.
+        ref = _priv->objects.size();
+        _priv->cIdMap.insert(anObject, ref);
+        _priv->objects.push_back(_priv->objects[0]);
+        return ref;
+    }
 
-        /*
-        * At last, get the object to encode itself.  Save and restore the
-        * current object scope of course.
-        */
-        _enc = m;
-        _keyNum = 0;
-        [anObject encodeWithCoder:self];
-        _keyNum = savedKeyNum;
-        _enc = savedEnc;
-
-        /*
-        * This is ugly, but it seems to be the way MacOS-X does it ...
-        * We create class information by storing it directly into the
-        * table of all objects, and making a reference so we can look
-        * up the table entry by class pointer.
-        * A much cleaner way to do it would be by encoding the class
-        * normally, but we are trying to be compatible.
-        *
-        * Also ... we encode the class *after* encoding the instance,
-        * simply because that seems to be the way MacOS-X does it and
-        * we want to maximise compatibility (perhaps they had good reason?)
-        */
-        if (_priv->uIdMap.get(c, refTmp)) {
-            ref = *refTmp;
-        } else {
-            id cDict;
-            id hierarchy;
-
-            ref = [_obj count];
-            _priv->uIdMap.insert(c, ref);
-            cDict = [[NSMutableDictionary alloc] initWithCapacity:2];
-
-            // Record class name
-            [cDict setObject:classname forKey:@"$classname"];
-
-            // Record the class hierarchy for this object.
-            hierarchy = [NSMutableArray new];
-            while (c != 0) {
-                id next = [c superclass];
-
-                [hierarchy addObject:NSStringFromClass(c)];
-                if (next == c) {
-                    break;
-                }
-                c = next;
-            }
-            [cDict setObject:hierarchy forKey:@"$classes"];
-            [hierarchy release];
-            [_obj addObject:cDict];
-            [cDict release];
-        }
+    if (_priv->cIdMap.get(anObject, refTmp)) {
+        // Conditionally encoded ... replace with actual value.
+        ref = *refTmp;
+        _priv->cIdMap.remove(anObject);
+    } else {
+        ref = _priv->objects.size();
+        _priv->objects.push_back(_priv->objects[0]);
+    }
+    _priv->uIdMap.insert(anObject, ref);
+
+    id c = [anObject classForKeyedArchiver];
 
-        /*
-        * Now create a reference to the class information and store it
-        * in the object description dictionary for the object we just encoded.
-        */
-        [m setObject:makeReference(ref) forKey:@"$class"];
+    // FIXME ... exactly what classes are stored directly???
+    if (c == [NSString class] || c == [NSNumber class] || c == [NSData class]) {
+        _priv->objects[ref] = _priv->writer.addPropertyList(anObject);
+    } else {
+        // We store a dictionary describing the object. Encoding it appends the objects it refers to, which can
+        // reallocate the table, so the slot is only looked up once that's done.
+        ObjectRef encoded = [self _encodeKeyedObject:anObject];
+        _priv->objects[ref] = encoded;
     }
 
-    // If we have encoded the object information, tell the delegate.
-    if (objectInfo != nil && _delegate != nil) {
+    // We have encoded the object information, tell the delegate.
+    if (_delegate != nil) {
         [_delegate archiver:self didEncodeObject:anObject];
     }
 
-    // Return the dictionary identifying the encoded object.
-    return refObject;
+    return ref;
+}
+
+- (ObjectRef)_encodeKeyedObject:(id)anObject {
+    unsigned savedKeyNum = _keyNum;
+    id c = [anObject class];
+    id classname;
+    id mapped;
+
+    /*
+    * Map the class of the object to the actual class it is encoded as.
+    * First ask the object, then apply any name mappings to that value.
+    */
+    mapped = [anObject classForKeyedArchiver];
+    if (mapped != nil) {
+        c = mapped;
+    }
+
+    classname = [self classNameForClass:c];
+    if (classname == nil) {
+        classname = [[self class] classNameForClass:c];
+    }
+    if (classname == nil) {
+        classname = NSStringFromClass(c);
+    } else {
+        c = NSClassFromString(classname);
+    }
+
+    /*
+    * At last, get the object to encode itself.  Save and restore the
+    * current object scope of course.
+    */
+    _priv->pushScope();
+    _keyNum = 0;
+    [anObject encodeWithCoder:self];
+    _keyNum = savedKeyNum;
+
+    /*
+    * This is ugly, but it seems to be the way MacOS-X does it ...
+    * We create class information by storing it directly into the
+    * table of all objects, and making a reference so we can look
+    * up the table entry by class pointer.
+    * A much cleaner way to do it would be by encoding the class
+    * normally, but we are trying to be compatible.
+    *
+    * Also ... we encode the class *after* encoding the instance,
+    * simply because that seems to be the way MacOS-X does it and
+    * we want to maximise compatibility (perhaps they had good reason?)
+    */
+    BinaryPropertyList::Writer& writer = _priv->writer;
+    unsigned classRef;
+    unsigned* refTmp;
+    if (_priv->uIdMap.get(c, refTmp)) {
+        classRef = *refTmp;
+    } else {
+        // Record the class hierarchy for this object.
+        std::vector<ObjectRef> hierarchy;
+        for (Class cls = c; cls != nil;) {
+            Class next = [cls superclass];
+
+            hierarchy.push_back(writer.addString(NSStringFromClass(cls)));
+            if (next == cls) {
+                break;
+            }
+            cls = next;
+        }
+
+        ObjectRef keys[] = { writer.addString(@"$classname"), writer.addString(@"$classes") };
+        ObjectRef values[] = { writer.addString(classname), writer.addArray(hierarchy.data(), hierarchy.size()) };
+
+        classRef = _priv->objects.size();
+        _priv->uIdMap.insert(c, classRef);
+        _priv->objects.push_back(writer.addDictionary(keys, values, _countof(keys)));
+    }
+
+    /*
+    * Now create a reference to the class information and store it
+    * in the object description dictionary for the object we just encoded.
+    */
+    _encodeValue(self, @"$class", writer.addUID(classRef));
+
+    NSKeyedArchiverScope& scope = _priv->currentScope();
+    ObjectRef result = writer.addDictionary(scope.keys.data(), scope.values.data(), scope.keys.size());
+    _priv->popScope();
+    return result;
 }
 
 /**
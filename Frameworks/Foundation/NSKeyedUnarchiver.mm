@@ -24,9 +24,16 @@ OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
 #import "Foundation/NSData.h"
 #import "Foundation/NSValue.h"
 #import "NSCoderInternal.h"
+#import "BinaryPropertyList.h"
+#import <CoreFoundation/CFPropertyList.h>
 #import <stack>
 #import <memory>
 #import <functional>
+#import <unordered_map>
+#import <vector>
+
+using BinaryPropertyList::ObjectRef;
+using BinaryPropertyList::ObjectType;
 
 NSString* const NSInvalidUnarchiveOperationException = @"NSInvalidUnarchiveOperationException";
 static NSString* _NSUnarchiverEncounteredInvalidClassException = @"_NSUnarchiverEncounteredInvalidClassException";
@@ -34,16 +41,26 @@ static NSString* _NSUnarchiverEncounteredInvalidClassExceptionClassType = @"_NSU
 static NSString* _NSUnarchiverEncounteredInvalidClassExceptionExpectedClasses =
     @"_NSUnarchiverEncounteredInvalidClassExceptionExpectedClasses";
 
+// Values nested deeper than this, through keyed objects and arrays alike, are refused rather than recursed into.
+static const size_t c_maxDecodeDepth = 512;
+
 @implementation NSKeyedUnarchiver {
     idretaintype(NSMutableDictionary) _nameToReplacementClass;
-    idretaintype(NSDictionary) _propertyList;
-    idretaintype(NSArray) _objects;
-    idretaintype(NSMutableArray) _plistStack;
-    idretaintype(NSMutableDictionary) _uidToObject;
-    idretaintype(NSMutableDictionary) _objectToUid;
-    idretaintype(NSMutableDictionary) _classVersions;
-    idretaintype(NSNumber) _activeUid;
-    int _unnamedKeyIndex;
+
+    // The archive is read in place; objects are only created as they are decoded.
+    idretaintype(NSData) _archive;
+    BinaryPropertyList::Reader _reader;
+    ObjectRef _top;
+    ObjectRef _objects;
+    bool _valid;
+    size_t _decodeDepth;
+
+    // Keyed objects currently being decoded, innermost last.
+    std::vector<ObjectRef> _plistStack;
+    std::vector<StrongId<NSObject>> _uidToObject;
+    std::unordered_map<uint32_t, Class> _uidToClass;
+    uint32_t _activeUid;
+    bool _hasActiveUid;
 
     idretaintype(NSMutableArray) _dataObjects;
     idretaintype(NSBundle) _bundle;
@@ -89,15 +106,24 @@ static NSString* _NSUnarchiverEncounteredInvalidClassExceptionExpectedClasses =
 
     _nameToReplacementClass.attach([NSMutableDictionary new]);
 
-    _propertyList = [NSPropertyListSerialization propertyListWithData:data options:0 format:nullptr error:nullptr];
-    _objects = [_propertyList objectForKey:@"$objects"];
-    _plistStack.attach([NSMutableArray new]);
-
-    if ([_propertyList objectForKey:@"$top"] != nil) {
-        [_plistStack addObject:[_propertyList objectForKey:@"$top"]];
+    _archive.attach([data copy]);
+    if (!BinaryPropertyList::IsBinaryPropertyList(static_cast<const uint8_t*>([_archive bytes]), [_archive length])) {
+        // XML archives are converted up front so that everything below deals with a single representation.
+        woc::unique_cf<CFPropertyListRef> plist(
+            CFPropertyListCreateWithData(nullptr, static_cast<CFDataRef>(data), kCFPropertyListImmutable, nullptr, nullptr));
+        if (plist) {
+            woc::unique_cf<CFDataRef> binary(CFPropertyListCreateData(nullptr, plist.get(), kCFPropertyListBinaryFormat_v1_0, 0, nullptr));
+            _archive = static_cast<NSData*>(binary.get());
+        }
     }
 
-    _uidToObject.attach((NSMutableDictionary*)CFDictionaryCreateMutable(nullptr, 128, &kCFTypeDictionaryKeyCallBacks, NULL));
+    // Validating up front means that nothing below can be led around a container that contains itself.
+    _valid = _reader.open(static_cast<const uint8_t*>([_archive bytes]), [_archive length]) && _reader.validate() &&
+             _reader.dictionaryValue(_reader.topObject(), @"$objects", &_objects) &&
+             _reader.dictionaryValue(_reader.topObject(), @"$top", &_top);
+    if (_valid) {
+        _plistStack.push_back(_top);
+    }
 
     _dataObjects.attach([NSMutableArray new]);
 
@@ -106,14 +132,37 @@ static NSString* _NSUnarchiverEncounteredInvalidClassExceptionExpectedClasses =
     return self;
 }
 
-static id decodeClassFromDictionary(NSKeyedUnarchiver* self, id classReference) {
-    id plist = [classReference objectForKey:@"$class"];
-    id uid = [plist objectForKey:@"CF$UID"];
-    id profile = [self->_objects objectAtIndex:[uid intValue]];
-    id classes = [profile objectForKey:@"$classes"];
-    id className = [profile objectForKey:@"$classname"];
+static inline bool valueForKey(NSKeyedUnarchiver* self, NSString* key, ObjectRef* value) {
+    return !self->_plistStack.empty() && self->_reader.dictionaryValue(self->_plistStack.back(), key, value);
+}
+
+static Class decodeClassFromDictionary(NSKeyedUnarchiver* self, ObjectRef classReference) {
+    ObjectRef classValue;
+    uint32_t uid;
+    if (!self->_reader.dictionaryValue(classReference, @"$class", &classValue) || !self->_reader.uidValue(classValue, &uid)) {
+        [NSException raise:NSInvalidUnarchiveOperationException format:@"keyed object is missing its class reference"];
+    }
 
-    return className;
+    auto cached = self->_uidToClass.find(uid);
+    if (cached != self->_uidToClass.end()) {
+        return cached->second;
+    }
+
+    ObjectRef profile;
+    ObjectRef classNameRef;
+    if (!self->_reader.arrayElement(self->_objects, uid, &profile) ||
+        !self->_reader.dictionaryValue(profile, @"$classname", &classNameRef)) {
+        [NSException raise:NSInvalidUnarchiveOperationException format:@"class reference %u is invalid", uid];
+    }
+
+    id className = self->_reader.objectForRef(classNameRef);
+    if (![className isKindOfClass:[NSString class]]) {
+        [NSException raise:NSInvalidUnarchiveOperationException format:@"class reference %u has no class name", uid];
+    }
+
+    Class classType = NSClassFromString(className);
+    self->_uidToClass.emplace(uid, classType);
+    return classType;
 }
 
 static inline void checkClassForSecureCodingCompliance(NSKeyedUnarchiver* self, Class checkingClass) {
@@ -151,28 +200,35 @@ static inline void checkClassAgainstExpectedClasses(NSKeyedUnarchiver* self, Cla
                            }] raise];
 }
 
-static id decodeObjectForUID(NSKeyedUnarchiver* self, NSNumber* uid) {
-    DWORD uidIntValue = [uid intValue];
-    id result = [self->_uidToObject objectForKey:uid];
+static id decodeObjectForUID(NSKeyedUnarchiver* self, uint32_t uid) {
+    id cached = (uid < self->_uidToObject.size()) ? static_cast<NSObject*>(self->_uidToObject[uid]) : nil;
+    if (cached != nil) {
+        return cached;
+    }
 
-    if (result == NULL) {
-        id plist = [self->_objects objectAtIndex:uidIntValue];
+    ObjectRef plist;
+    if (!self->_reader.arrayElement(self->_objects, uid, &plist)) {
+        [NSException raise:NSInvalidUnarchiveOperationException format:@"reference to object %u is out of range", uid];
+    }
 
-        // NSString and NSNumber can be returned directly without a class check.
-        if ([plist isKindOfClass:[NSString class]]) {
-            if ([plist isEqualToString:@"$null"]) {
-                result = NULL;
-            } else {
-                result = plist;
+    id result = nil;
+    switch (self->_reader.typeOf(plist)) {
+        case ObjectType::String:
+            // NSString and NSNumber can be returned directly without a class check.
+            if (!self->_reader.stringEquals(plist, @"$null")) {
+                result = self->_reader.objectForRef(plist);
             }
-        } else if ([plist isKindOfClass:[NSNumber class]]) {
-            result = plist;
-        } else if ([plist isKindOfClass:[NSDictionary class]]) {
-            // NSDictionary could be an object masquerading as a dictionary;
-            // it performs its class check manually.
-            id className = decodeClassFromDictionary(self, plist);
+            break;
 
-            Class classType = NSClassFromString(className);
+        case ObjectType::Integer:
+        case ObjectType::Real:
+        case ObjectType::Bool:
+            result = self->_reader.objectForRef(plist);
+            break;
+
+        case ObjectType::Dictionary: {
+            // A dictionary describes a keyed object; it performs its class check manually.
+            Class classType = decodeClassFromDictionary(self, plist);
 
             // These two methods will except (correct behaviour) if they fail to match.
             checkClassAgainstExpectedClasses(self, classType, self->_expectedClassesInDecodePass.top());
@@ -183,65 +239,76 @@ static id decodeObjectForUID(NSKeyedUnarchiver* self, NSNumber* uid) {
                 classType = mapped;
             }
 
-            [self->_plistStack addObject:plist];
-            if (classType != nil) {
-                result = [classType alloc];
+            if (classType == nil) {
+                break;
+            }
 
-                [self->_uidToObject setObject:result forKey:uid];
+            if (uid >= self->_uidToObject.size()) {
+                self->_uidToObject.resize(uid + 1);
+            }
 
-                int curPos = self->_curUid;
+            self->_plistStack.push_back(plist);
+            auto popPlist = wil::ScopeExit([self]() { self->_plistStack.pop_back(); });
 
-                self->_activeUid = uid;
-                self->_curUid = 0;
+            result = [classType alloc];
 
-                if ([result respondsToSelector:@selector(initWithCoder:)]) {
-                    result = [result initWithCoder:self];
-                } else {
-                    if (result != nil) {
-                        [NSException
-                             raise:NSInvalidUnarchiveOperationException
-                            format:@"instances of class '%@' do not conform to the NSCoding protocol; please implement -initWithCoder:",
-                                   classType];
-                    }
-                }
+            self->_uidToObject[uid] = result;
+
+            int curPos = self->_curUid;
+            uint32_t savedUid = self->_activeUid;
+            bool savedHasUid = self->_hasActiveUid;
 
-                self->_curUid = curPos;
-                self->_activeUid = nil;
+            self->_activeUid = uid;
+            self->_hasActiveUid = true;
+            self->_curUid = 0;
 
+            if ([result respondsToSelector:@selector(initWithCoder:)]) {
+                result = [result initWithCoder:self];
+            } else {
                 if (result != nil) {
-                    [self->_uidToObject setObject:result forKey:uid];
-                    if ([result respondsToSelector:@selector(awakeAfterUsingCoder:)]) {
-                        result = [result awakeAfterUsingCoder:self];
-                    }
-
-                    [result autorelease];
-                } else {
-                    [NSException raise:NSInvalidUnarchiveOperationException
-                                format:@"failed to instantiate class '%@' during unarchival", classType];
+                    [NSException
+                         raise:NSInvalidUnarchiveOperationException
+                        format:@"instances of class '%@' do not conform to the NSCoding protocol; please implement -initWithCoder:",
+                               classType];
                 }
             }
 
-            [self->_plistStack removeLastObject];
-        } else {
-            // Everything else requires a class check.
+            self->_curUid = curPos;
+            self->_activeUid = savedUid;
+            self->_hasActiveUid = savedHasUid;
 
-            // This might except. Let it.
-            checkClassAgainstExpectedClasses(self, object_getClass(plist), self->_expectedClassesInDecodePass.top());
-            result = plist;
+            if (result != nil) {
+                self->_uidToObject[uid] = result;
+                if ([result respondsToSelector:@selector(awakeAfterUsingCoder:)]) {
+                    result = [result awakeAfterUsingCoder:self];
+                }
 
-            if ([plist isKindOfClass:[NSData class]]) {
-                result = plist;
-            } else if ([plist isKindOfClass:[NSDate class]]) {
-                result = plist;
+                [result autorelease];
             } else {
                 [NSException raise:NSInvalidUnarchiveOperationException
-                            format:@"failed to unarchive unknown object of class '%@'", object_getClass(plist)];
+                            format:@"failed to instantiate class '%@' during unarchival", classType];
             }
+            break;
         }
 
-        if (result) {
-            [self->_uidToObject setObject:result forKey:uid];
+        case ObjectType::Data:
+        case ObjectType::Date:
+            // Everything else requires a class check.
+            result = self->_reader.objectForRef(plist);
+
+            // This might except. Let it.
+            checkClassAgainstExpectedClasses(self, object_getClass(result), self->_expectedClassesInDecodePass.top());
+            break;
+
+        default:
+            [NSException raise:NSInvalidUnarchiveOperationException format:@"failed to unarchive unknown object at index %u", uid];
+    }
+
+    if (result) {
+        if (uid >= self->_uidToObject.size()) {
+            self->_uidToObject.resize(uid + 1);
         }
+        self->_uidToObject[uid] = result;
     }
 
     return result;
@@ -251,58 +318,69 @@ static id decodeObjectForUID(NSKeyedUnarchiver* self, NSNumber* uid) {
  @Status Interoperable
 */
 - (id)decodeRootObject {
-    id top = [_propertyList objectForKey:@"$top"];
-    id values = [top allValues];
+    size_t count = 0;
+    ObjectRef key;
+    ObjectRef object;
+    uint32_t uid;
 
-    if ([values count] != 1) {
+    if (!_valid) {
+        [NSException raise:NSInvalidUnarchiveOperationException format:@"incomprehensible archive"];
+        return nil;
+    } else if (!_reader.count(_top, &count) || count != 1) {
         [NSException raise:NSInvalidUnarchiveOperationException format:@"attempted to unarchive data with multiple root objects"];
         return nil;
+    } else if (!_reader.dictionaryEntry(_top, 0, &key, &object) || !_reader.uidValue(object, &uid)) {
+        return nil;
     } else {
-        id object = [values objectAtIndex:0];
-        id uid = [object objectForKey:@"CF$UID"];
-
         return decodeObjectForUID(self, uid);
     }
 }
 
-static id unarchiveObjectWithData(id data) {
-    id unarchiver = [NSKeyedUnarchiver alloc];
-    [unarchiver initForReadingWithData:data];
-
-    return [unarchiver decodeRootObject];
-}
-
-static BOOL containsValueForKey(NSKeyedUnarchiver* self, NSString* key) {
-    return [[self->_plistStack lastObject] objectForKey:key] != NULL ? TRUE : FALSE;
-}
-
-static id _decodeObjectWithPropertyList(NSKeyedUnarchiver* self, id plist) {
-    if ([plist isKindOfClass:[NSString class]] || [plist isKindOfClass:[NSData class]] || [plist isKindOfClass:[NSNumber class]]) {
-        return plist;
+static id _decodeObjectWithPropertyList(NSKeyedUnarchiver* self, ObjectRef plist) {
+    if (self->_decodeDepth >= c_maxDecodeDepth) {
+        [NSException raise:NSInvalidUnarchiveOperationException
+                    format:@"archive nests objects more than %u deep",
+                           static_cast<unsigned>(c_maxDecodeDepth)];
     }
 
-    if ([plist isKindOfClass:[NSDictionary class]]) {
-        id uid = [plist objectForKey:@"CF$UID"];
+    ++self->_decodeDepth;
+    auto popDepth = wil::ScopeExit([self]() { --self->_decodeDepth; });
 
+    uint32_t uid;
+    if (self->_reader.uidValue(plist, &uid)) {
         return decodeObjectForUID(self, uid);
-    } else if ([plist isKindOfClass:[NSArray class]]) {
-        id result = [NSMutableArray array];
-        DWORD i, count = [plist count];
-
-        for (i = 0; i < count; i++) {
-            id sibling = [plist objectAtIndex:i];
-            id objValue = _decodeObjectWithPropertyList(self, sibling);
+    }
 
-            if (objValue != nil) {
-                [result addObject:objValue];
+    switch (self->_reader.typeOf(plist)) {
+        case ObjectType::String:
+        case ObjectType::Data:
+        case ObjectType::Integer:
+        case ObjectType::Real:
+        case ObjectType::Bool:
+            return self->_reader.objectForRef(plist);
+
+        case ObjectType::Array: {
+            id result = [NSMutableArray array];
+            size_t count = 0;
+            self->_reader.count(plist, &count);
+
+            for (size_t i = 0; i < count; i++) {
+                ObjectRef sibling;
+                id objValue = self->_reader.arrayElement(plist, i, &sibling) ? _decodeObjectWithPropertyList(self, sibling) : nil;
+
+                if (objValue != nil) {
+                    [result addObject:objValue];
+                }
             }
+
+            return result;
         }
 
-        return result;
+        default:
+            break;
     }
 
-    [NSException raise:NSInvalidUnarchiveOperationException
-                format:@"unable to decode property list object with class %@", object_getClass(plist)];
+    [NSException raise:NSInvalidUnarchiveOperationException format:@"unable to decode property list object at index %u", plist];
     return nil;
 }
 
@@ -318,9 +396,9 @@ static id _decodeObjectWithPropertyList(NSKeyedUnarchiver* self, id plist) {
     }
 
     @try {
-        id plist = [[_plistStack lastObject] objectForKey:key];
+        ObjectRef plist;
 
-        if (!plist) {
+        if (!valueForKey(self, key, &plist)) {
             return nil;
         }
 
@@ -356,14 +434,56 @@ static id _decodeObjectWithPropertyList(NSKeyedUnarchiver* self, id plist) {
     return [self decodeObjectForKey:key];
 }
 
-static id _numberForKey(NSKeyedUnarchiver* self, id key) {
-    id result = [[self->_plistStack lastObject] objectForKey:key];
-    if (!result || [result isKindOfClass:[NSNumber class]]) {
-        return result;
+static bool _numberForKey(NSKeyedUnarchiver* self, NSString* key, ObjectRef* result) {
+    if (!valueForKey(self, key, result)) {
+        return false;
+    }
+
+    ObjectType type = self->_reader.typeOf(*result);
+    if (type == ObjectType::Integer || type == ObjectType::Real || type == ObjectType::Bool) {
+        return true;
     }
 
     [NSException raise:NSInvalidUnarchiveOperationException format:@"value for key '%@' is not an unboxed number", key];
-    return nil;
+    return false;
+}
+
+static int64_t _int64ForKey(NSKeyedUnarchiver* self, NSString* key) {
+    ObjectRef number;
+    if (!_numberForKey(self, key, &number)) {
+        return 0;
+    }
+
+    int64_t integer;
+    double real;
+    bool boolean;
+    if (self->_reader.integerValue(number, &integer)) {
+        return integer;
+    } else if (self->_reader.doubleValue(number, &real)) {
+        return static_cast<int64_t>(real);
+    } else if (self->_reader.boolValue(number, &boolean)) {
+        return boolean;
+    }
+    return 0;
+}
+
+static double _doubleForKey(NSKeyedUnarchiver* self, NSString* key) {
+    ObjectRef number;
+    if (!_numberForKey(self, key, &number)) {
+        return 0;
+    }
+
+    int64_t integer;
+    double real;
+    bool boolean;
+    if (self->_reader.doubleValue(number, &real)) {
+        return real;
+    } else if (self->_reader.integerValue(number, &integer)) {
+        return static_cast<double>(integer);
+    } else if (self->_reader.boolValue(number, &boolean)) {
+        return boolean;
+    }
+    return 0;
 }
 
 static id _valueForKey(NSKeyedUnarchiver* self, id key) {
@@ -374,7 +494,8 @@ static id _valueForKey(NSKeyedUnarchiver* self, id key) {
  @Status Interoperable
 */
 - (BOOL)containsValueForKey:(NSString*)key {
-    return ([[_plistStack lastObject] objectForKey:key] != nil) ? TRUE : FALSE;
+    ObjectRef value;
+    return valueForKey(self, key, &value) ? TRUE : FALSE;
 }
 
 /**
@@ -389,13 +510,7 @@ static id _valueForKey(NSKeyedUnarchiver* self, id key) {
  @Status Interoperable
 */
 - (int)decodeIntForKey:(NSString*)key {
-    id number = _numberForKey(self, key);
-
-    if (number == nil) {
-        return 0;
-    }
-
-    return [number intValue];
+    return static_cast<int>(_int64ForKey(self, key));
 }
 
 /**
@@ -416,59 +531,36 @@ static id _valueForKey(NSKeyedUnarchiver* self, id key) {
  @Status Interoperable
 */
 - (BOOL)decodeBoolForKey:(NSString*)key {
-    return [self decodeIntForKey:key];
+    return _int64ForKey(self, key) != 0;
 }
 
 /**
  @Status Interoperable
 */
 - (__int64)decodeInt64ForKey:(NSString*)key {
-    id number = _numberForKey(self, key);
-
-    if (number == nil) {
-        return 0;
-    }
-
-    unsigned __int64 ret = [number unsignedLongLongValue];
-
-    return ret;
+    return _int64ForKey(self, key);
 }
 
 /**
  @Status Interoperable
 */
 - (float)decodeFloatForKey:(NSString*)key {
-    id number = _numberForKey(self, key);
-
-    if (number == nil) {
-        return 0;
-    }
-
-    float ret = [number floatValue];
-
-    return ret;
+    return static_cast<float>(_doubleForKey(self, key));
 }
 
 /**
  @Status Interoperable
 */
 - (double)decodeDoubleForKey:(NSString*)key {
-    id number = _numberForKey(self, key);
-
-    if (number == nil) {
-        return 0;
-    }
-
-    double ret = [number doubleValue];
-
-    return ret;
+    return _doubleForKey(self, key);
 }
 
 /**
  @Status Interoperable
 */
 + (id)unarchiveObjectWithFile:(NSString*)file {
-    id data = [NSData dataWithContentsOfFile:file];
+    // The archive is decoded in place, so mapping it avoids reading objects that are never asked for.
+    id data = [NSData dataWithContentsOfFile:file options:NSDataReadingMappedIfSafe error:nullptr];
 
     if ([data length] == 0) {
         return nil;
@@ -506,6 +598,15 @@ static id _valueForKey(NSKeyedUnarchiver* self, id key) {
 - (const uint8_t*)decodeBytesForKey:(NSString*)key returnedLength:(NSUInteger*)length {
     *length = 0;
 
+    // Bytes encoded with encodeBytes:length:forKey: are returned straight out of the archive.
+    ObjectRef value;
+    const uint8_t* bytes;
+    size_t byteCount;
+    if (valueForKey(self, key, &value) && _reader.dataBytes(value, &bytes, &byteCount)) {
+        *length = byteCount;
+        return bytes;
+    }
+
     id data = [self decodeObjectForKey:key];
     if (data != nil) {
         [_dataObjects addObject:data];
@@ -578,10 +679,8 @@ static id _valueForKey(NSKeyedUnarchiver* self, id key) {
 */
 - (void)dealloc {
     _nameToReplacementClass = nil;
-    _propertyList = nil;
-    _objects = nil;
-    _plistStack = nil;
-    _uidToObject = nil;
+    _uidToObject.clear();
+    _archive = nil;
     _dataObjects = nil;
     _bundle = nil;
 
@@ -589,15 +688,9 @@ static id _valueForKey(NSKeyedUnarchiver* self, id key) {
 }
 
 - (void)_swapActiveObject:(id)object {
-    FAIL_FAST_HR_IF_NULL(E_UNEXPECTED, _activeUid);
+    FAIL_FAST_HR_IF(E_UNEXPECTED, !_hasActiveUid);
 
-    if (object != [self->_uidToObject objectForKey:_activeUid]) {
-        if (object != nil) {
-            [self->_uidToObject setObject:object forKey:_activeUid];
-        } else {
-            [self->_uidToObject removeObjectForKey:_activeUid];
-        }
-    }
+    _uidToObject[_activeUid] = object;
 }
 
 @end
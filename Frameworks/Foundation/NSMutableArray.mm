@@ -23,8 +23,11 @@
 #import "NSRaise.h"
 #import "NSCFArray.h"
 #import "BridgeHelpers.h"
+#import "CFPriv.h"
+#import "ForFoundationOnly.h"
 
 #include <algorithm>
+#include <memory>
 
 static const wchar_t* TAG = L"NSMutableArray";
 
@@ -226,54 +229,56 @@ using NSCompareFunc = NSInteger (*)(id, id, void*);
     return NSInvalidAbstractInvocation();
 }
 
-static void swap(NSMutableArray* self, uint32_t a, uint32_t b) {
-    if (a == b)
-        return;
+// Replaces the objects in range with as many objects from the given buffer. Subclasses that can replace a range of
+// objects at once override this.
+- (void)_replaceObjectsInRange:(NSRange)range withObjects:(id const*)objects {
+    // The objects are held while they are put back, since replacing one can release the last reference to another
+    // that still has to be put back.
+    for (NSUInteger i = 0; i < range.length; ++i) {
+        [objects[i] retain];
+    }
 
-    id obj1 = [self objectAtIndex:a];
-    id obj2 = [self objectAtIndex:b];
+    for (NSUInteger i = 0; i < range.length; ++i) {
+        if ([self objectAtIndex:range.location + i] != objects[i]) {
+            [self replaceObjectAtIndex:range.location + i withObject:objects[i]];
+        }
+    }
 
-    [obj1 retain];
-    [obj2 retain];
-    [self replaceObjectAtIndex:b withObject:obj1];
-    [self replaceObjectAtIndex:a withObject:obj2];
-    [obj1 release];
-    [obj2 release];
+    for (NSUInteger i = 0; i < range.length; ++i) {
+        [objects[i] release];
+    }
 }
 
-static void shortsort(NSMutableArray* self, uint32_t lo, uint32_t hi, NSCompareFunc compFunc, void* context) {
-    int p, max;
-
-    while (hi > lo) {
-        max = lo;
-        for (p = lo + 1; p <= (int)hi; p += 1) {
-            if ((compFunc([self objectAtIndex:p], [self objectAtIndex:max], context)) > 0)
-                max = p;
-        }
+struct _NSSortFunction {
+    NSCompareFunc function;
+    void* context;
+};
 
-        swap(self, max, hi);
-        hi -= 1;
-    }
+static CFComparisonResult _NSSortFunctionCompare(const void* left, const void* right, void* context) {
+    _NSSortFunction* sort = static_cast<_NSSortFunction*>(context);
+    return static_cast<CFComparisonResult>(sort->function(*static_cast<const id*>(left), *static_cast<const id*>(right), sort->context));
 }
 
-static signed int selComp(NSMutableArray* self, int i1, int i2, SEL selector) {
-    typedef int (*ftype)(id, SEL, id);
-    return ((ftype)objc_msgSend)([self objectAtIndex:i1], selector, [self objectAtIndex:i2]);
+static NSInteger _NSSelectorCompare(id left, id right, void* selector) {
+    typedef NSInteger (*ftype)(id, SEL, id);
+    return ((ftype)objc_msgSend)(left, static_cast<SEL>(selector), right);
 }
 
-static void shortsort(NSMutableArray* self, uint32_t lo, uint32_t hi, SEL selector) {
-    DWORD p, max;
+// Sorts a copy of the objects and then puts them back, rather than comparing and swapping the objects in place
+// through objectAtIndex: and replaceObjectAtIndex:withObject:. Unless NSSortStable or NSSortConcurrent is passed,
+// the order of objects that compare equal is not kept.
+static void _sortObjectsInRange(NSMutableArray* self, NSRange range, NSSortOptions options, NSCompareFunc compFunc, void* context) {
+    if (range.length < 2) {
+        return;
+    }
 
-    while (hi > lo) {
-        max = lo;
-        for (p = lo + 1; p <= hi; p += 1) {
-            if (selComp(self, p, max, selector) > 0)
-                max = p;
-        }
+    std::unique_ptr<id[]> objects(new id[range.length]);
+    [self getObjects:objects.get() range:range];
 
-        swap(self, max, hi);
-        hi -= 1;
-    }
+    _NSSortFunction sort = { compFunc, context };
+    _CFSortArray(objects.get(), range.length, sizeof(id), options & (NSSortConcurrent | NSSortStable), _NSSortFunctionCompare, &sort);
+
+    [self _replaceObjectsInRange:range withObjects:objects.get()];
 }
 
 /**
@@ -283,8 +288,6 @@ static void shortsort(NSMutableArray* self, uint32_t lo, uint32_t hi, SEL select
     [self sortUsingFunction:CFNSBlockCompare context:comparator];
 }
 
-#define CUTOFF 8
-
 /**
  @Status Interoperable
 */
@@ -298,164 +301,14 @@ static void shortsort(NSMutableArray* self, uint32_t lo, uint32_t hi, SEL select
  @Status Interoperable
 */
 - (void)sortUsingFunction:(NSCompareFunc)compFunc context:(void*)context range:(NSRange)range {
-    uint32_t base = range.location;
-    uint32_t num = range.length;
-
-    uint32_t lo, hi;
-    uint32_t mid;
-    uint32_t loguy, higuy;
-    uint32_t size;
-    uint32_t lostk[30], histk[30];
-    int stkptr;
-
-    if (num < 2)
-        return;
-    stkptr = 0;
-
-    lo = base;
-    hi = base + (num - 1);
-
-recurse:
-    size = (hi - lo) + 1;
-
-    if (size <= CUTOFF) {
-        shortsort(self, lo, hi, compFunc, context);
-    } else {
-        mid = lo + (size / 2);
-        swap(self, mid, lo);
-
-        loguy = lo;
-        higuy = hi + 1;
-
-        for (;;) {
-            do {
-                loguy += 1;
-            } while (loguy <= hi && (compFunc([self objectAtIndex:loguy], [self objectAtIndex:lo], context)) <= 0);
-
-            do {
-                higuy -= 1;
-            } while (higuy > lo && (compFunc([self objectAtIndex:higuy], [self objectAtIndex:lo], context)) >= 0);
-
-            if (higuy < loguy)
-                break;
-            swap(self, loguy, higuy);
-        }
-
-        swap(self, lo, higuy);
-
-        if (higuy - 1 - lo >= hi - loguy) {
-            if (lo + 1 < higuy) {
-                lostk[stkptr] = lo;
-                histk[stkptr] = higuy - 1;
-                ++stkptr;
-            }
-
-            if (loguy < hi) {
-                lo = loguy;
-                goto recurse;
-            }
-        } else {
-            if (loguy < hi) {
-                lostk[stkptr] = loguy;
-                histk[stkptr] = hi;
-                ++stkptr;
-            }
-
-            if (lo + 1 < higuy) {
-                hi = higuy - 1;
-                goto recurse;
-            }
-        }
-    }
-
-    --stkptr;
-    if (stkptr >= 0) {
-        lo = lostk[stkptr];
-        hi = histk[stkptr];
-        goto recurse;
-    }
+    _sortObjectsInRange(self, range, 0, compFunc, context);
 }
 
 /**
  @Status Interoperable
 */
 - (void)sortUsingSelector:(SEL)selector {
-    uint32_t base = 0;
-    uint32_t num = [self count];
-
-    uint32_t lo, hi;
-    uint32_t mid;
-    uint32_t loguy, higuy;
-    unsigned size;
-    uint32_t lostk[30], histk[30];
-    int stkptr;
-
-    if (num < 2)
-        return;
-    stkptr = 0;
-
-    lo = base;
-    hi = base + (num - 1);
-
-recurse:
-    size = (hi - lo) + 1;
-
-    if (size <= CUTOFF) {
-        shortsort(self, lo, hi, selector);
-    } else {
-        mid = lo + (size / 2);
-        swap(self, mid, lo);
-
-        loguy = lo;
-        higuy = hi + 1;
-
-        for (;;) {
-            do {
-                loguy += 1;
-            } while (loguy <= hi && selComp(self, loguy, lo, selector) <= 0);
-
-            do {
-                higuy -= 1;
-            } while (higuy > lo && selComp(self, higuy, lo, selector) >= 0);
-
-            if (higuy < loguy)
-                break;
-            swap(self, loguy, higuy);
-        }
-
-        swap(self, lo, higuy);
-
-        if (higuy - 1 - lo >= hi - loguy) {
-            if (lo + 1 < higuy) {
-                lostk[stkptr] = lo;
-                histk[stkptr] = higuy - 1;
-                ++stkptr;
-            }
-
-            if (loguy < hi) {
-                lo = loguy;
-                goto recurse;
-            }
-        } else {
-            if (loguy < hi) {
-                lostk[stkptr] = loguy;
-                histk[stkptr] = hi;
-                ++stkptr;
-            }
-
-            if (lo + 1 < higuy) {
-                hi = higuy - 1;
-                goto recurse;
-            }
-        }
-    }
-
-    --stkptr;
-    if (stkptr >= 0) {
-        lo = lostk[stkptr];
-        hi = histk[stkptr];
-        goto recurse;
-    }
+    [self sortUsingFunction:_NSSelectorCompare context:selector];
 }
 
 /**
@@ -557,11 +410,10 @@ recurse:
 }
 
 /**
- @Status Caveat
- @Notes Options are currently ignored
+ @Status Interoperable
 */
 - (void)sortWithOptions:(NSSortOptions)opts usingComparator:(NSComparator)cmptr {
-    [self sortUsingFunction:CFNSBlockCompare context:cmptr];
+    _sortObjectsInRange(self, NSMakeRange(0, [self count]), opts, CFNSBlockCompare, cmptr);
 }
 
 @end
@@ -19,6 +19,13 @@
 #import <Foundation/NSNotificationCenter.h>
 #include "LoggingNative.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 static const wchar_t* TAG = L"NSNotificationCenter";
 
 @interface NSNotificationReceiver : NSObject {
@@ -27,43 +34,94 @@ static const wchar_t* TAG = L"NSNotificationCenter";
     void (^block)(NSNotification* block);
     SEL selector;
     NSObject* notificationSender;
-    bool valid;
+    NSString* name;
+    uint64_t sequence;
+    std::atomic<bool> valid;
 }
 @end
 
 @implementation NSNotificationReceiver
+- (void)dealloc {
+    // Block observers own their placeholder object and block. These are released only once no published snapshot
+    // can still reach the receiver, so a post racing with removal never calls into a freed block.
+    if (block) {
+        [block release];
+        [object release];
+    }
+    [name release];
+    [super dealloc];
+}
+
+- (void)deliver:(NSNotification*)notification {
+    if (block) {
+        block(notification);
+    } else {
+        // Sent rather than called through an IMP cached at registration, which would go stale if the observer's class
+        // were changed (as KVO does) or the method replaced.
+        [object performSelector:selector withObject:notification];
+    }
+}
 @end
 
-NSNotificationCenter* defaultCenter;
+namespace {
+// Observers are indexed by the exact (name, sender) pair they registered for; nil in either slot is a wildcard.
+// Senders are compared by identity, names by value.
+struct ObserverKey {
+    StrongId<NSString> name;
+    void* sender;
+    NSUInteger hash;
 
-@implementation NSNotificationCenter {
-    NSMutableDictionary* observers;
-}
-static NSMutableArray* arrayForObservers(NSNotificationCenter* self, NSString* key, bool create = false) {
-    NSMutableArray* ret = [self->observers objectForKey:key];
-    if (ret) {
-        return ret;
+    ObserverKey(NSString* name, id sender, NSUInteger nameHash)
+        : name(name), sender(sender), hash(nameHash ^ (reinterpret_cast<uintptr_t>(sender) >> 4)) {
     }
 
-    if (!create) {
-        return nil;
+    ObserverKey(NSString* name, id sender) : ObserverKey(name, sender, [name hash]) {
+    }
+
+    bool operator==(const ObserverKey& other) const {
+        if (hash != other.hash || sender != other.sender) {
+            return false;
+        }
+
+        NSString* left = name;
+        NSString* right = other.name;
+        return left == right || (left != nil && right != nil && [left isEqualToString:right]);
+    }
+};
+
+struct ObserverKeyHash {
+    size_t operator()(const ObserverKey& key) const {
+        return key.hash;
     }
+};
 
-    ret = [NSMutableArray new];
-    [self->observers setObject:ret forKey:key];
-    [ret release];
+// Buckets are immutable once published in a snapshot. The writer mutates a bucket in place only while nothing but the
+// master table refers to it, and copies it otherwise.
+using ReceiverList = std::vector<StrongId<NSNotificationReceiver>>;
+using ObserverTable = std::unordered_map<ObserverKey, std::shared_ptr<ReceiverList>, ObserverKeyHash>;
 
-    return ret;
+struct ObserverSnapshot {
+    ObserverTable table;
+    uint64_t generation;
+};
+}
+
+@implementation NSNotificationCenter {
+    // Writers (add/remove) serialize on _mutex and edit _observers. Posters never take _mutex in the steady state: they
+    // read the last published _snapshot, and republish it first only if _generation shows it is stale.
+    std::mutex _mutex;
+    ObserverTable _observers;
+    std::unordered_map<void*, std::vector<ObserverKey>> _registrations;
+    std::atomic<uint64_t> _generation;
+    uint64_t _nextSequence;
+    std::shared_ptr<const ObserverSnapshot> _snapshot;
 }
 
 /**
  @Status Interoperable
 */
 + (NSNotificationCenter*)defaultCenter {
-    if (defaultCenter == nil) {
-        defaultCenter = [NSNotificationCenter new];
-    }
-
+    static NSNotificationCenter* defaultCenter = [NSNotificationCenter new];
     return defaultCenter;
 }
 
@@ -71,10 +129,37 @@ static NSMutableArray* arrayForObservers(NSNotificationCenter* self, NSString* k
  @Status Interoperable
 */
 - (instancetype)init {
-    observers = [[NSMutableDictionary alloc] init];
+    if (self = [super init]) {
+        _generation = 0;
+        _nextSequence = 0;
+        std::atomic_store(&_snapshot, std::shared_ptr<const ObserverSnapshot>(new ObserverSnapshot{ ObserverTable(), 0 }));
+    }
     return self;
 }
 
+static std::shared_ptr<const ObserverSnapshot> _currentSnapshot(NSNotificationCenter* self) {
+    std::shared_ptr<const ObserverSnapshot> snapshot = std::atomic_load(&self->_snapshot);
+    if (snapshot->generation == self->_generation.load(std::memory_order_acquire)) {
+        return snapshot;
+    }
+
+    // Observers changed since the last post. Publishing copies only the table of bucket pointers; the buckets themselves
+    // are shared with the master table, so a burst of registrations costs one republish rather than one per registration.
+    std::lock_guard<std::mutex> lock(self->_mutex);
+    snapshot = std::atomic_load(&self->_snapshot);
+    if (snapshot->generation != self->_generation.load(std::memory_order_relaxed)) {
+        snapshot.reset(new ObserverSnapshot{ self->_observers, self->_generation.load(std::memory_order_relaxed) });
+        std::atomic_store(&self->_snapshot, snapshot);
+    }
+
+    return snapshot;
+}
+
+static const ReceiverList* _receiversForKey(const ObserverSnapshot& snapshot, NSString* name, id sender, NSUInteger nameHash) {
+    auto found = snapshot.table.find(ObserverKey(name, sender, nameHash));
+    return found == snapshot.table.end() ? nullptr : found->second.get();
+}
+
 /**
  @Status Interoperable
 */
@@ -88,46 +173,61 @@ static NSMutableArray* arrayForObservers(NSNotificationCenter* self, NSString* k
  @Status Interoperable
 */
 - (void)postNotification:(NSNotification*)notification {
-    NSString* name = [notification name];
-
-    NSArray* arr = arrayForObservers(self, name);
-    if (arr == nil) {
+    // Holding the snapshot keeps every receiver in it alive for the duration of the post, even if observers are
+    // removed (by the callbacks themselves or by other threads) while it is being walked.
+    std::shared_ptr<const ObserverSnapshot> snapshot = _currentSnapshot(self);
+    if (snapshot->table.empty()) {
         return;
     }
 
-    NSObject* sender = [notification object];
-    int count = CFArrayGetCount((CFArrayRef)arr);
-    unsigned int numSendTo = 0;
-    id* sendTo = (id*)IwMalloc(count * sizeof(id));
-    for (unsigned int i = 0; i < count; i++) {
-        NSNotificationReceiver* observer = (NSNotificationReceiver*)CFArrayGetValueAtIndex((CFArrayRef)arr, i);
-        if (!observer->valid) {
-            continue;
-        }
-        if (observer->notificationSender != NULL && observer->notificationSender != sender) {
-            continue;
+    NSString* name = [notification name];
+    id sender = [notification object];
+    NSUInteger nameHash = [name hash];
+
+    const ReceiverList* lists[4];
+    size_t listCount = 0;
+    auto addList = [&lists, &listCount](const ReceiverList* list) {
+        if (list && !list->empty()) {
+            lists[listCount++] = list;
         }
+    };
 
-        sendTo[numSendTo] = observer;
-        [sendTo[numSendTo++] retain];
+    addList(_receiversForKey(*snapshot, name, sender, nameHash));
+    if (sender != nil) {
+        addList(_receiversForKey(*snapshot, name, nil, nameHash));
+    }
+    if (name != nil) {
+        addList(_receiversForKey(*snapshot, nil, sender, 0));
+        if (sender != nil) {
+            addList(_receiversForKey(*snapshot, nil, nil, 0));
+        }
     }
 
-    for (unsigned int i = 0; i < numSendTo; i++) {
-        NSNotificationReceiver* observer = sendTo[i];
+    if (listCount == 1) {
+        for (NSNotificationReceiver* receiver : *lists[0]) {
+            if (receiver->valid.load(std::memory_order_acquire)) {
+                [receiver deliver:notification];
+            }
+        }
+        return;
+    }
 
-        if (!observer->valid) {
-            [observer release];
-            continue;
+    // Several buckets match; deliver in registration order across all of them.
+    std::vector<NSNotificationReceiver*> receivers;
+    for (size_t i = 0; i < listCount; i++) {
+        for (NSNotificationReceiver* receiver : *lists[i]) {
+            receivers.push_back(receiver);
         }
+    }
+    std::sort(receivers.begin(), receivers.end(), [](NSNotificationReceiver* left, NSNotificationReceiver* right) {
+        return left->sequence < right->sequence;
+    });
 
-        if (!observer->block) {
-            [observer->object performSelector:observer->selector withObject:notification];
-        } else {
-            observer->block(notification);
+    for (NSNotificationReceiver* receiver : receivers) {
+        if (receiver->valid.load(std::memory_order_acquire)) {
+            [receiver deliver:notification];
         }
-        [observer release];
     }
-    IwFree(sendTo);
 }
 
 /**
@@ -139,11 +239,40 @@ static NSMutableArray* arrayForObservers(NSNotificationCenter* self, NSString* k
     [self postNotification:notification];
 }
 
+// Returns list ready to be edited in place, copying it first if a snapshot still shares it. Called with _mutex held:
+// snapshots only take references to buckets under _mutex, so a bucket referred to by the master table alone stays that
+// way. The fence orders the edits after the reads of whichever snapshot released the bucket last.
+static ReceiverList& _writableList(std::shared_ptr<ReceiverList>& list) {
+    if (list.use_count() > 1) {
+        list = std::make_shared<ReceiverList>(*list);
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *list;
+}
+
+static void _addReceiver(NSNotificationCenter* self, NSNotificationReceiver* receiver) {
+    ObserverKey key(receiver->name, receiver->notificationSender);
+    receiver->valid = true;
+
+    std::lock_guard<std::mutex> lock(self->_mutex);
+    receiver->sequence = self->_nextSequence++;
+
+    std::shared_ptr<ReceiverList>& list = self->_observers[key];
+    if (!list) {
+        list = std::make_shared<ReceiverList>();
+    }
+    _writableList(list).emplace_back(receiver);
+
+    self->_registrations[receiver->object].emplace_back(std::move(key));
+    self->_generation.fetch_add(1, std::memory_order_release);
+}
+
 /**
  @Status Interoperable
 */
 - (void)addObserver:(id)observer selector:(SEL)selName name:(NSString*)name object:(id)object {
-    if (name == nil) {
+    if (observer == nil) {
         return;
     }
 
@@ -152,9 +281,9 @@ static NSMutableArray* arrayForObservers(NSNotificationCenter* self, NSString* k
     newObserver->object = observer;
     newObserver->selector = selName;
     newObserver->notificationSender = object;
-    newObserver->valid = true;
+    newObserver->name = [name copy];
 
-    [arrayForObservers(self, name, true) addObject:newObserver];
+    _addReceiver(self, newObserver);
     [newObserver release];
 }
 
@@ -178,52 +307,66 @@ static NSMutableArray* arrayForObservers(NSNotificationCenter* self, NSString* k
     newObserver->block = [block copy];
     newObserver->selector = NULL;
     newObserver->notificationSender = object;
-    newObserver->valid = true;
+    newObserver->name = [name copy];
 
-    [arrayForObservers(self, name, true) addObject:newObserver];
+    id token = newObserver->object;
+    _addReceiver(self, newObserver);
     [newObserver release];
 
-    return newObserver->object;
+    return token;
 }
 
 /**
  @Status Interoperable
 */
 - (void)removeObserver:(id)observer name:(NSString*)name object:(id)object {
-    id arr = arrayForObservers(self, name);
-    if (arr == nil) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto registration = _registrations.find(observer);
+    if (registration == _registrations.end()) {
         return;
     }
 
-    int numItems = CFArrayGetCount((CFArrayRef)arr);
-
-    for (int i = numItems - 1; i >= 0; i--) {
-        NSNotificationReceiver* curObserver = (NSNotificationReceiver*)CFArrayGetValueAtIndex((CFArrayRef)arr, i);
-
-        if (!curObserver->valid) {
-            continue;
-        }
-        if (curObserver->object != observer) {
-            continue;
-        }
-        if (object != nil && curObserver->notificationSender != object) {
+    bool changed = false;
+    std::vector<ObserverKey>& keys = registration->second;
+    for (auto keyIt = keys.begin(); keyIt != keys.end();) {
+        NSString* keyName = keyIt->name;
+        if ((name != nil && (keyName == nil || ![keyName isEqualToString:name])) || (object != nil && keyIt->sender != object)) {
+            ++keyIt;
             continue;
         }
 
-        curObserver->valid = false;
-        if (curObserver->block) {
-            [curObserver->block release];
-            [curObserver->object release];
-            curObserver->block = nil;
-            curObserver->object = nil;
+        auto bucket = _observers.find(*keyIt);
+        if (bucket != _observers.end()) {
+            ReceiverList& list = _writableList(bucket->second);
+
+            // A snapshot that is already being walked may still reach these receivers; clearing valid stops delivery.
+            list.erase(std::remove_if(list.begin(),
+                                      list.end(),
+                                      [observer](NSNotificationReceiver* receiver) {
+                                          if (receiver->object != observer) {
+                                              return false;
+                                          }
+                                          receiver->valid.store(false, std::memory_order_release);
+                                          return true;
+                                      }),
+                       list.end());
+
+            if (list.empty()) {
+                _observers.erase(bucket);
+            }
         }
 
-        // Remove the object *after* freeing its block and object
-        CFArrayRemoveValueAtIndex((CFMutableArrayRef)arr, i);
+        keyIt = keys.erase(keyIt);
+        changed = true;
     }
 
-    if (CFArrayGetCount((CFArrayRef)arr) == 0) {
-        [observers setObject:nil forKey:name];
+    if (keys.empty()) {
+        _registrations.erase(registration);
+    }
+
+    if (changed) {
+        _generation.fetch_add(1, std::memory_order_release);
     }
 }
 
@@ -231,10 +374,6 @@ static NSMutableArray* arrayForObservers(NSNotificationCenter* self, NSString* k
  @Status Interoperable
 */
 - (void)removeObserver:(id)observer {
-    NSArray* copiedAllKeys = [[observers allKeys] copy];
-    for (NSString* curName in copiedAllKeys) {
-        [self removeObserver:observer name:curName object:nil];
-    }
-    [copiedAllKeys release];
+    [self removeObserver:observer name:nil object:nil];
 }
 @end
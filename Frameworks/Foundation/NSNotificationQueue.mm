@@ -15,55 +15,168 @@
 //******************************************************************************
 
 #include "Starboard.h"
-#include "StubReturn.h"
 #include "Foundation/NSNotificationQueue.h"
+#include "Foundation/NSNotificationCenter.h"
+#include "Foundation/NSNotification.h"
+#include "Foundation/NSRunLoop.h"
+#include "Foundation/NSThread.h"
+#include "Foundation/NSMutableDictionary.h"
+#include "NSNotificationQueueInternal.h"
 
-@implementation NSNotificationQueue
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+static NSString* const NSNotificationQueueThreadKey = @"NSNotificationQueueThreadKey";
+
+namespace {
+struct QueuedNotification {
+    StrongId<NSNotification> notification;
+    StrongId<NSArray> modes;
+
+    bool isInMode(NSString* mode) const {
+        return modes == nil ? [mode isEqualToString:NSDefaultRunLoopMode] : [static_cast<NSArray*>(modes) containsObject:mode];
+    }
+
+    bool coalescesWith(NSNotification* other, NSUInteger coalesceMask) const {
+        if (coalesceMask == NSNotificationNoCoalescing) {
+            return notification == other;
+        }
+        if ((coalesceMask & NSNotificationCoalescingOnName) && ![[notification name] isEqualToString:[other name]]) {
+            return false;
+        }
+        if ((coalesceMask & NSNotificationCoalescingOnSender) && [notification object] != [other object]) {
+            return false;
+        }
+        return true;
+    }
+};
+
+using NotificationList = std::vector<QueuedNotification>;
+}
+
+@implementation NSNotificationQueue {
+    StrongId<NSNotificationCenter> _center;
+    NotificationList _asapQueue;
+    NotificationList _idleQueue;
+}
 
 /**
- @Status Stub
- @Notes
+ @Status Interoperable
+ @Notes Each thread has its own default queue, which is serviced by that thread's run loop.
 */
 + (instancetype)defaultQueue {
-    // TODO: Intentionally commented out for now to prevent flooded debug spew from NSRunLoop's usage.
-    // UNIMPLEMENTED();
-    return StubReturn();
+    NSMutableDictionary* threadDictionary = [[NSThread currentThread] threadDictionary];
+    NSNotificationQueue* queue = [threadDictionary objectForKey:NSNotificationQueueThreadKey];
+
+    if (queue == nil) {
+        queue = [[self alloc] initWithNotificationCenter:[NSNotificationCenter defaultCenter]];
+        [threadDictionary setObject:queue forKey:NSNotificationQueueThreadKey];
+        [queue release];
+    }
+
+    return queue;
 }
 
 /**
- @Status Stub
- @Notes
+ @Status Interoperable
 */
 - (instancetype)initWithNotificationCenter:(NSNotificationCenter*)notificationCenter {
-    UNIMPLEMENTED();
-    return StubReturn();
+    if (self = [super init]) {
+        _center = notificationCenter;
+    }
+    return self;
+}
+
+// Removes every queued notification that coalesces with notification. Returns true if any were removed.
+static bool _dequeueMatching(NotificationList& queue, NSNotification* notification, NSUInteger coalesceMask) {
+    auto end = std::remove_if(queue.begin(), queue.end(), [notification, coalesceMask](const QueuedNotification& queued) {
+        return queued.coalescesWith(notification, coalesceMask);
+    });
+
+    bool removed = end != queue.end();
+    queue.erase(end, queue.end());
+    return removed;
+}
+
+// Posts (in order) and removes every notification in queue that is eligible for mode. The eligible entries are taken
+// off the queue before any are posted so that notifications enqueued by observers wait for the next pass.
+static void _postQueued(NSNotificationCenter* center, NotificationList& queue, NSString* mode) {
+    NotificationList toPost;
+    auto end = std::stable_partition(queue.begin(), queue.end(), [mode](const QueuedNotification& queued) {
+        return !queued.isInMode(mode);
+    });
+
+    std::move(end, queue.end(), std::back_inserter(toPost));
+    queue.erase(end, queue.end());
+
+    for (const QueuedNotification& queued : toPost) {
+        [center postNotification:queued.notification];
+    }
 }
 
 /**
- @Status Stub
- @Notes
+ @Status Interoperable
 */
 - (void)enqueueNotification:(NSNotification*)notification postingStyle:(NSPostingStyle)postingStyle {
-    UNIMPLEMENTED();
+    [self enqueueNotification:notification
+                 postingStyle:postingStyle
+                 coalesceMask:(NSNotificationCoalescingOnName | NSNotificationCoalescingOnSender)
+                     forModes:nil];
 }
 
 /**
- @Status Stub
- @Notes
+ @Status Interoperable
+ @Notes A coalesced notification replaces the queued notifications it matches and is delivered once, at the position
+        of the newest enqueue.
 */
 - (void)enqueueNotification:(NSNotification*)notification
                postingStyle:(NSPostingStyle)postingStyle
                coalesceMask:(NSNotificationCoalescing)coalesceMask
                    forModes:(NSArray*)modes {
-    UNIMPLEMENTED();
+    if (coalesceMask != NSNotificationNoCoalescing) {
+        [self dequeueNotificationsMatching:notification coalesceMask:coalesceMask];
+    }
+
+    switch (postingStyle) {
+        case NSPostNow:
+            [_center postNotification:notification];
+            break;
+
+        case NSPostASAP:
+            _asapQueue.emplace_back(QueuedNotification{ notification, [[modes copy] autorelease] });
+            break;
+
+        case NSPostWhenIdle:
+            _idleQueue.emplace_back(QueuedNotification{ notification, [[modes copy] autorelease] });
+            break;
+    }
 }
 
 /**
- @Status Stub
- @Notes
+ @Status Interoperable
 */
 - (void)dequeueNotificationsMatching:(NSNotification*)notification coalesceMask:(NSUInteger)coalesceMask {
-    UNIMPLEMENTED();
+    _dequeueMatching(_asapQueue, notification, coalesceMask);
+    _dequeueMatching(_idleQueue, notification, coalesceMask);
+}
+
+- (void)asapProcessMode:(NSString*)mode {
+    if (!_asapQueue.empty()) {
+        _postQueued(_center, _asapQueue, mode);
+    }
+}
+
+- (BOOL)hasIdleNotificationsInMode:(NSString*)mode {
+    return std::any_of(_idleQueue.begin(), _idleQueue.end(), [mode](const QueuedNotification& queued) {
+        return queued.isInMode(mode);
+    });
+}
+
+- (void)idleProcessMode:(NSString*)mode {
+    if (!_idleQueue.empty()) {
+        _postQueued(_center, _idleQueue, mode);
+    }
 }
 
 @end
@@ -16,6 +16,7 @@
 
 #include "Starboard.h"
 #include "StubReturn.h"
+#include "BinaryPropertyList.h"
 
 #include <CoreFoundation/CFPropertyList.h>
 
@@ -43,11 +44,26 @@
 
 /**
  @Status Interoperable
+ @Notes Large binary property lists read with NSPropertyListImmutable are decoded lazily; their containers keep an
+        immutable copy of data (or data itself, if it is immutable) alive.
 */
 + (id)propertyListWithData:(NSData*)data
                    options:(NSPropertyListReadOptions)options
                     format:(NSPropertyListFormat*)formatOut
                      error:(NSError**)error {
+    if (options == NSPropertyListImmutable && [data length] >= BinaryPropertyList::c_lazyMinimumLength) {
+        id plist = BinaryPropertyList::LazyPropertyListWithData(data);
+        if (plist) {
+            if (formatOut) {
+                *formatOut = NSPropertyListBinaryFormat_v1_0;
+            }
+            if (error) {
+                *error = nil;
+            }
+            return plist;
+        }
+    }
+
     CFErrorRef cfError = nullptr;
     woc::unique_cf<CFErrorRef> strongError;
     // Cast to result to id. This is safe because a CFPropertyListRef is one of a number of bridged classes but we don't know which ones.
@@ -35,6 +35,7 @@ OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
 #import "LoggingNative.h"
 #import "NSThread-Internal.h"
 #import "NSOperationQueueInternal.h"
+#import "NSNotificationQueueInternal.h"
 
 static const wchar_t* TAG = L"NSRunLoop";
 
@@ -261,6 +262,9 @@ static void DispatchMainRunLoopWakeup(void* arg) {
     if (limitDate != nil) {
         limitDate = [limitDate earlierDate:date];
         [self acceptInputForMode:mode beforeDate:limitDate];
+    } else if ([[NSNotificationQueue defaultQueue] hasIdleNotificationsInMode:mode]) {
+        // Nothing to wait on, but the run loop is idle: deliver idle notifications rather than dropping out with them queued.
+        [[NSNotificationQueue defaultQueue] idleProcessMode:mode];
     }
 
     [pool release];
@@ -34,6 +34,11 @@ typedef struct bio_st BIO;
 typedef struct ssl_ctx_st SSL_CTX;
 #endif
 
+struct ssl_session_st;
+
+// Properties key for an NSArray of DER encoded certificates that a handler trusts in addition to the system's roots.
+extern NSString* const _kNSSSLTrustedCertificates;
+
 @interface NSSSLHandler : NSObject {
 @public
     id _properties;
@@ -64,5 +69,12 @@ typedef struct ssl_ctx_st SSL_CTX;
 - (void)runHandshakeIfNeeded:(id)socket;
 - (void)runWithSocket:(id)socket;
 - (void)setOutputStream:(id)stream;
+- (void)setPeerName:(NSString*)hostName;
+- (BOOL)failedPeerVerification;
+- (int)continueHandshake;
+- (struct ssl_session_st*)copySession;
+- (void)setSession:(struct ssl_session_st*)session;
+- (BOOL)isSessionReused;
++ (void)releaseSession:(struct ssl_session_st*)session;
 + (void)initialize;
 @end
\ No newline at end of file
@@ -27,10 +27,16 @@
 
 #import <openssl/err.h>
 #import <openssl/ssl.h>
+#import <openssl/x509v3.h>
 #import <cmath>
 #import <algorithm>
+#import <vector>
 #import "LoggingNative.h"
 
+#if defined(WIN32)
+#import <wincrypt.h>
+#endif
+
 static const wchar_t* TAG = L"NSSSLHandler";
 
 static pthread_mutex_t initLock = PTHREAD_MUTEX_INITIALIZER;
@@ -45,6 +51,8 @@ static void locking_function(int mode, int idx, const char* file, int line) {
 }
 #endif
 
+NSString* const _kNSSSLTrustedCertificates = @"_kNSSSLTrustedCertificates";
+
 @implementation NSSSLHandler
 #if defined(WIN32) || defined(ANDROID)
 + (void)initialize {
@@ -71,6 +79,102 @@ static void locking_function(int mode, int idx, const char* file, int line) {
     }
 }
 
+// Adds the platform's trusted root certificates to store.
+static void _loadSystemRoots(X509_STORE* store) {
+#if defined(WIN32)
+    HCERTSTORE roots = CertOpenStore(CERT_STORE_PROV_SYSTEM_W, 0, 0, CERT_SYSTEM_STORE_CURRENT_USER | CERT_STORE_READONLY_FLAG, L"ROOT");
+    if (!roots) {
+        TraceError(TAG, L"Unable to open the system root certificate store (%d)", GetLastError());
+        return;
+    }
+
+    PCCERT_CONTEXT certificate = nullptr;
+    while ((certificate = CertEnumCertificatesInStore(roots, certificate)) != nullptr) {
+        const unsigned char* encoded = certificate->pbCertEncoded;
+        X509* x509 = d2i_X509(nullptr, &encoded, certificate->cbCertEncoded);
+        if (x509) {
+            // Fails harmlessly for a certificate that's already in the store.
+            X509_STORE_add_cert(store, x509);
+            X509_free(x509);
+        }
+    }
+    CertCloseStore(roots, 0);
+#else
+    X509_STORE_set_default_paths(store);
+    X509_STORE_load_locations(store, nullptr, "/system/etc/security/cacerts");
+#endif
+}
+
+// Client contexts are shared by every handler that uses the same method, so the trusted roots are only loaded once.
+// Each verifies the peer's certificate chain; a handler told not to validate it turns that off for its own connection.
+static SSL_CTX* _sharedContext(const SSL_METHOD* method) {
+    static const SSL_METHOD* methods[4];
+    static SSL_CTX* contexts[4];
+
+    pthread_mutex_lock(&initLock);
+    SSL_CTX* context = nullptr;
+    for (size_t i = 0; i < _countof(methods); i++) {
+        if (methods[i] == method) {
+            context = contexts[i];
+            break;
+        }
+
+        if (!methods[i]) {
+            context = SSL_CTX_new(method);
+            if (context) {
+                SSL_CTX_set_verify(context, SSL_VERIFY_PEER, nullptr);
+                _loadSystemRoots(SSL_CTX_get_cert_store(context));
+                methods[i] = method;
+                contexts[i] = context;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&initLock);
+
+    return context;
+}
+
+// Returns a new store that trusts everything context's store does, and also each DER encoded certificate in anchors.
+static X509_STORE* _createStoreWithAnchors(SSL_CTX* context, NSArray* anchors) {
+    X509_STORE* store = X509_STORE_new();
+    if (!store) {
+        return nullptr;
+    }
+
+    // X509_STORE_add_cert takes the same lock, so the shared roots are collected first and added once it's released.
+    std::vector<X509*> roots;
+    X509_STORE* shared = SSL_CTX_get_cert_store(context);
+    CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
+    for (int i = 0; i < sk_X509_OBJECT_num(shared->objs); i++) {
+        X509_OBJECT* object = sk_X509_OBJECT_value(shared->objs, i);
+        if (object->type == X509_LU_X509) {
+            CRYPTO_add(&object->data.x509->references, 1, CRYPTO_LOCK_X509);
+            roots.push_back(object->data.x509);
+        }
+    }
+    CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
+
+    for (X509* root : roots) {
+        X509_STORE_add_cert(store, root);
+        X509_free(root);
+    }
+
+    for (NSData* anchor in anchors) {
+        const unsigned char* encoded = static_cast<const unsigned char*>([anchor bytes]);
+        X509* x509 = d2i_X509(nullptr, &encoded, [anchor length]);
+        if (!x509) {
+            TraceError(TAG, L"Ignoring a trusted certificate that isn't DER encoded");
+            continue;
+        }
+
+        X509_STORE_add_cert(store, x509);
+        X509_free(x509);
+    }
+
+    return store;
+}
+
 - (id)initWithProperties:(id)properties {
     _properties = [properties retain];
 
@@ -87,13 +191,25 @@ static void locking_function(int mode, int idx, const char* file, int line) {
     else
         _method = (SSL_METHOD*)SSLv23_client_method();
 
+    _context = _sharedContext(_method);
+    _connection = SSL_new(_context);
+
+    // The chain is validated unless the caller explicitly asks for it not to be.
     id validatesCertChain = [_properties objectForKey:kCFStreamSSLValidatesCertificateChain];
+    if (validatesCertChain != nil && ![validatesCertChain boolValue]) {
+        SSL_set_verify(_connection, SSL_VERIFY_NONE, nullptr);
+    }
 
-    if (validatesCertChain != nil) {
+    // Certificates the caller trusts are only trusted by this connection, never by the shared context.
+    NSArray* anchors = [_properties objectForKey:_kNSSSLTrustedCertificates];
+    if ([anchors count] > 0) {
+        X509_STORE* store = _createStoreWithAnchors(_context, anchors);
+        if (store) {
+            SSL_set1_verify_cert_store(_connection, store);
+            X509_STORE_free(store);
+        }
     }
 
-    _context = SSL_CTX_new(_method);
-    _connection = SSL_new(_context);
     _incoming = BIO_new(BIO_s_mem());
     _outgoing = BIO_new(BIO_s_mem());
 
@@ -352,6 +468,66 @@ static void locking_function(int mode, int idx, const char* file, int line) {
     _outputStream = stream;
 }
 
+// Sets the name of the server being connected to. The peer's certificate has to be issued for it, and a host name
+// (rather than an address) is also sent in the ClientHello, which is what servers key session resumption on.
+- (void)setPeerName:(NSString*)hostName {
+    const char* name = [hostName UTF8String];
+    X509_VERIFY_PARAM* parameters = SSL_get0_param(_connection);
+    if (X509_VERIFY_PARAM_set1_ip_asc(parameters, name) == 1) {
+        return;
+    }
+
+    X509_VERIFY_PARAM_set_hostflags(parameters, X509_CHECK_FLAG_NO_PARTIAL_WILDCARDS);
+    X509_VERIFY_PARAM_set1_host(parameters, name, 0);
+    SSL_set_tlsext_host_name(_connection, name);
+}
+
+// Whether the last handshake failed because the peer's certificate was not trusted or not issued for the peer name.
+- (BOOL)failedPeerVerification {
+    return SSL_get_verify_result(_connection) != X509_V_OK;
+}
+
+// Advances the handshake using whatever encrypted bytes have been handed to writeEncrypted. Returns 1 once the
+// handshake is complete, 0 if it needs more bytes from the peer, and -1 if it failed.
+- (int)continueHandshake {
+    int check = SSL_do_handshake(_connection);
+    if (check == 1) {
+        return 1;
+    }
+
+    int error = SSL_get_error(_connection, check);
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+        return 0;
+    }
+
+    char errorCString[256];
+    ERR_error_string_n(ERR_get_error(), errorCString, sizeof(errorCString));
+    TraceError(TAG, L"SSL_do_handshake returned error %d - %hs", error, errorCString);
+    return -1;
+}
+
+// Returns a reference to the negotiated session, to be offered with setSession: on a later connection to the same
+// host. The caller releases it with releaseSession:.
+- (struct ssl_session_st*)copySession {
+    return SSL_get1_session(_connection);
+}
+
+- (void)setSession:(struct ssl_session_st*)session {
+    if (session) {
+        SSL_set_session(_connection, session);
+    }
+}
+
+- (BOOL)isSessionReused {
+    return SSL_session_reused(_connection) ? YES : NO;
+}
+
++ (void)releaseSession:(struct ssl_session_st*)session {
+    if (session) {
+        SSL_SESSION_free(session);
+    }
+}
+
 #else
 
 /*
@@ -495,6 +671,66 @@ static void locking_function(int mode, int idx, const char* file, int line) {
     UNIMPLEMENTED();
 }
 
+/*
+ @Status Stub
+ @Notes
+*/
+- (void)setPeerName:(NSString*)hostName {
+    UNIMPLEMENTED();
+}
+
+/*
+ @Status Stub
+ @Notes
+*/
+- (BOOL)failedPeerVerification {
+    UNIMPLEMENTED();
+    return StubReturn();
+}
+
+/*
+ @Status Stub
+ @Notes
+*/
+- (int)continueHandshake {
+    UNIMPLEMENTED();
+    return StubReturn();
+}
+
+/*
+ @Status Stub
+ @Notes
+*/
+- (struct ssl_session_st*)copySession {
+    UNIMPLEMENTED();
+    return StubReturn();
+}
+
+/*
+ @Status Stub
+ @Notes
+*/
+- (void)setSession:(struct ssl_session_st*)session {
+    UNIMPLEMENTED();
+}
+
+/*
+ @Status Stub
+ @Notes
+*/
+- (BOOL)isSessionReused {
+    UNIMPLEMENTED();
+    return StubReturn();
+}
+
+/*
+ @Status Stub
+ @Notes
+*/
++ (void)releaseSession:(struct ssl_session_st*)session {
+    UNIMPLEMENTED();
+}
+
 /*
  @Status Stub
  @Notes
@@ -33,6 +33,7 @@
 #include <Foundation/NSRange.h>
 #include <Foundation/NSRegularExpression.h>
 #include <Foundation/NSSet.h>
+#include <Foundation/NSStream.h>
 #include <CoreFoundation/CoreFoundation.h>
 
 #include "ForFoundationOnly.h"
@@ -47,6 +48,7 @@
 
 #include <vector>
 #include <memory>
+#include <algorithm>
 #include <string>
 
 static const wchar_t* TAG = L"NSString";
@@ -1634,6 +1636,60 @@ BOOL _isALineSeparatorTypeCharacter(unichar ch) {
     return [data writeToFile:file options:(atomically ? NSDataWritingAtomic : 0) error:err];
 }
 
+/**
+ @Status Interoperable
+ @Notes WinObjC extension.
+*/
+- (BOOL)writeToOutputStream:(NSOutputStream*)stream encoding:(NSStringEncoding)encoding error:(NSError**)error {
+    static const NSUInteger c_blockLength = 16 * 1024;
+
+    CFStringEncoding cfEncoding = CFStringConvertNSStringEncodingToEncoding(encoding);
+    CFIndex maxBytes = CFStringGetMaximumSizeForEncoding(c_blockLength, cfEncoding);
+    if (cfEncoding == kCFStringEncodingInvalidId || maxBytes == kCFNotFound) {
+        if (error) {
+            *error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteInapplicableStringEncodingError userInfo:nil];
+        }
+        return NO;
+    }
+
+    std::vector<unichar> characters(c_blockLength);
+    std::vector<uint8_t> bytes(maxBytes);
+    NSUInteger length = [self length];
+    for (NSUInteger location = 0; location < length;) {
+        NSUInteger count = std::min(c_blockLength, length - location);
+        [self getCharacters:characters.data() range:NSMakeRange(location, count)];
+
+        // Surrogate pairs are not split across blocks, or they would be encoded as two unpaired halves.
+        if (count > 1 && location + count < length && CFStringIsSurrogateHighCharacter(characters[count - 1])) {
+            --count;
+        }
+
+        CFIndex usedBytes = 0;
+        CFStringRef block = CFStringCreateWithCharactersNoCopy(kCFAllocatorDefault, characters.data(), count, kCFAllocatorNull);
+        CFIndex converted = CFStringGetBytes(block, CFRangeMake(0, count), cfEncoding, 0, false, bytes.data(), maxBytes, &usedBytes);
+        CFRelease(block);
+        if (converted != count) {
+            if (error) {
+                *error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteInapplicableStringEncodingError userInfo:nil];
+            }
+            return NO;
+        }
+
+        for (CFIndex written = 0; written < usedBytes;) {
+            NSInteger result = [stream write:bytes.data() + written maxLength:usedBytes - written];
+            if (result <= 0) {
+                if (error) {
+                    *error = [stream streamError];
+                }
+                return NO;
+            }
+            written += result;
+        }
+        location += count;
+    }
+    return YES;
+}
+
 /**
  @Status Interoperable
  @Notes
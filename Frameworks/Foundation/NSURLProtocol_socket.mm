@@ -0,0 +1,1375 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+// A portable HTTP/1.1 NSURLProtocol built on NSSocket and NSSSLHandler.
+//
+// Every connection is driven by one event loop thread that polls all sockets at once; no thread is ever blocked on a
+// single request. Connections are pooled per scheme://host:port and kept alive between requests, up to the
+// HTTPMaximumConnectionsPerHost of the session that started the request. Once a host is at its limit, requests that
+// allow pipelining are written behind the requests already in flight on an open connection; all others wait for a
+// connection to become idle. A server's certificate has to chain to a trusted root and be issued for the host before
+// anything is sent to it, and TLS sessions are cached per host so that reconnecting resumes the previous session. A
+// session's configuration can trust more roots for its own connections only; those connections are pooled apart.
+//
+// This protocol is not registered globally; a session opts into it through NSURLSessionConfiguration.protocolClasses.
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#include <ws2tcpip.h>
+
+#define pollSockets WSAPoll
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <poll.h>
+#include <errno.h>
+
+#define closesocket close
+#define pollSockets poll
+#endif
+
+#import <Starboard.h>
+#import <Foundation/Foundation.h>
+
+#import "NSSocket.h"
+#import "NSSSLHandler.h"
+#import "NSURLProtocolInternal.h"
+#import "NSURLSessionTask-Internal.h"
+#import "NSURLSessionConfiguration-Internal.h"
+#import "LoggingNative.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <sstream>
+#include <vector>
+
+#include <openssl/sha.h>
+
+static const wchar_t* TAG = L"NSURLProtocol (socket)";
+
+static const size_t c_readBufferSize = 16384;
+static const size_t c_maximumHeaderLineLength = 65536;
+static const NSUInteger c_defaultMaximumConnectionsPerHost = 6;
+static const int c_pollTimeoutMilliseconds = 1000;
+static const std::chrono::seconds c_idleConnectionTimeout(30);
+
+namespace {
+
+#pragma region Helpers
+static bool _equalsIgnoringCase(const std::string& left, const char* right) {
+    size_t length = strlen(right);
+    if (left.size() != length) {
+        return false;
+    }
+
+    for (size_t i = 0; i < length; ++i) {
+        if (tolower(static_cast<unsigned char>(left[i])) != tolower(static_cast<unsigned char>(right[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool _containsTokenIgnoringCase(const std::string& value, const char* token) {
+    size_t start = 0;
+    while (start <= value.size()) {
+        size_t end = value.find(',', start);
+        if (end == std::string::npos) {
+            end = value.size();
+        }
+
+        size_t first = value.find_first_not_of(" \t", start);
+        size_t last = value.find_last_not_of(" \t", end - 1);
+        if (first != std::string::npos && first < end && last >= first) {
+            if (_equalsIgnoringCase(value.substr(first, last - first + 1), token)) {
+                return true;
+            }
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+static bool _wouldBlock() {
+#ifdef _WIN32
+    int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS;
+#else
+    return errno == EWOULDBLOCK || errno == EAGAIN || errno == EINPROGRESS;
+#endif
+}
+
+static void _setNonBlocking(int descriptor) {
+#ifdef _WIN32
+    u_long on = 1;
+    ioctlsocket(descriptor, FIONBIO, &on);
+#else
+    int on = 1;
+    ioctl(descriptor, FIONBIO, &on);
+#endif
+}
+
+// Identifies a set of DER encoded certificates, so that connections trusting different certificates are never pooled
+// together. Empty if there are none.
+static std::string _trustKey(NSArray* certificates) {
+    if ([certificates count] == 0) {
+        return std::string();
+    }
+
+    SHA256_CTX context;
+    SHA256_Init(&context);
+    for (NSData* certificate in certificates) {
+        SHA256_Update(&context, [certificate bytes], [certificate length]);
+    }
+
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256_Final(digest, &context);
+
+    std::ostringstream key;
+    key << '#' << std::hex << std::setfill('0');
+    for (unsigned char byte : digest) {
+        key << std::setw(2) << static_cast<unsigned>(byte);
+    }
+    return key.str();
+}
+
+static NSError* _errorWithCode(NSInteger code, NSString* description) {
+    return [NSError errorWithDomain:NSURLErrorDomain code:code userInfo:@{ NSLocalizedDescriptionKey : description }];
+}
+
+// The origin-form request target: the path and query of the URL, with their escapes intact.
+static std::string _requestTarget(NSURL* url) {
+    std::string absolute([[url absoluteString] UTF8String]);
+
+    size_t start = absolute.find("://");
+    start = (start == std::string::npos) ? 0 : start + 3;
+    start = absolute.find_first_of("/?#", start);
+
+    std::string target;
+    if (start != std::string::npos) {
+        target = absolute.substr(start, absolute.find('#', start) - start);
+    }
+
+    if (target.empty() || target[0] != '/') {
+        target.insert(0, "/");
+    }
+    return target;
+}
+
+static bool _isIdempotent(NSString* method) {
+    return [method isEqualToString:@"GET"] || [method isEqualToString:@"HEAD"] || [method isEqualToString:@"OPTIONS"] ||
+           [method isEqualToString:@"PUT"] || [method isEqualToString:@"DELETE"];
+}
+#pragma endregion
+
+#pragma region Event Loop
+// A single thread that waits on every registered socket at once and dispatches readiness to the socket's handler.
+// Watches are only ever added, changed or removed on the loop thread; work from other threads is handed over with post().
+class EventLoop {
+public:
+    using Handler = std::function<void(short revents)>;
+
+    static EventLoop& shared() {
+        static EventLoop* loop = new EventLoop();
+        return *loop;
+    }
+
+    void watch(int descriptor, short events, Handler handler) {
+        _watches[descriptor] = Watch{ events, ++_nextSerial, std::move(handler) };
+    }
+
+    void setEvents(int descriptor, short events) {
+        auto found = _watches.find(descriptor);
+        if (found != _watches.end()) {
+            found->second.events = events;
+        }
+    }
+
+    void unwatch(int descriptor) {
+        _watches.erase(descriptor);
+    }
+
+    void setIdleHandler(std::function<void()> handler) {
+        _idleHandler = std::move(handler);
+    }
+
+    // Runs work on the loop thread. May be called from any thread.
+    void post(std::function<void()> work) {
+        {
+            std::lock_guard<std::mutex> lock(_postedLock);
+            _posted.emplace_back(std::move(work));
+        }
+
+        char wake = 0;
+        [_wakeWriter write:&wake maxLength:1];
+    }
+
+private:
+    struct Watch {
+        short events;
+        uint64_t serial;
+        Handler handler;
+    };
+
+    EventLoop() {
+#ifdef _WIN32
+        WSADATA wsaData;
+        WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+
+        NSSocket* reader = nil;
+        _wakeWriter.attach([[NSSocket alloc] initConnectedToSocket:&reader]);
+        _wakeReader = reader;
+        [_wakeReader setOperationWouldBlock:NO];
+
+        // A full wake socket already guarantees a wake up, so posting never blocks on it.
+        [_wakeWriter setOperationWouldBlock:NO];
+
+        std::thread(&EventLoop::_run, this).detach();
+    }
+
+    void _run() {
+        std::vector<pollfd> descriptors;
+        std::vector<uint64_t> serials;
+        std::vector<std::function<void()>> posted;
+
+        while (true) {
+            @autoreleasepool {
+                descriptors.clear();
+                serials.clear();
+
+                int wakeDescriptor = [_wakeReader descriptor];
+                descriptors.push_back(pollfd{ static_cast<decltype(pollfd::fd)>(wakeDescriptor), POLLIN, 0 });
+                serials.push_back(0);
+
+                for (const auto& entry : _watches) {
+                    descriptors.push_back(pollfd{ static_cast<decltype(pollfd::fd)>(entry.first), entry.second.events, 0 });
+                    serials.push_back(entry.second.serial);
+                }
+
+                int ready = pollSockets(descriptors.data(), static_cast<unsigned long>(descriptors.size()), c_pollTimeoutMilliseconds);
+                if (ready < 0) {
+                    TraceError(TAG, L"Polling %u sockets failed.", static_cast<unsigned>(descriptors.size()));
+                }
+
+                if (descriptors[0].revents & POLLIN) {
+                    char drain[256];
+                    while ([_wakeReader read:drain maxLength:sizeof(drain)] > 0) {
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(_postedLock);
+                    posted.swap(_posted);
+                }
+                for (auto& work : posted) {
+                    work();
+                }
+                posted.clear();
+
+                for (size_t i = 1; ready > 0 && i < descriptors.size(); ++i) {
+                    if (descriptors[i].revents == 0) {
+                        continue;
+                    }
+
+                    // An earlier handler may have closed this socket, and its descriptor may already be reused.
+                    auto found = _watches.find(static_cast<int>(descriptors[i].fd));
+                    if (found == _watches.end() || found->second.serial != serials[i]) {
+                        continue;
+                    }
+
+                    // Copied, as the handler is free to unwatch itself.
+                    Handler handler = found->second.handler;
+                    handler(descriptors[i].revents);
+                }
+
+                if (_idleHandler) {
+                    _idleHandler();
+                }
+            }
+        }
+    }
+
+    StrongId<NSSocket> _wakeReader;
+    StrongId<NSSocket> _wakeWriter;
+
+    std::unordered_map<int, Watch> _watches;
+    uint64_t _nextSerial = 0;
+    std::function<void()> _idleHandler;
+
+    std::mutex _postedLock;
+    std::vector<std::function<void()>> _posted;
+};
+#pragma endregion
+
+#pragma region Exchange
+class Connection;
+
+// One request and the parse state of its response.
+class Exchange {
+public:
+    Exchange(NSURLProtocol* protocol, NSURLRequest* request, NSUInteger maximumConnections, NSArray* trustedCertificates)
+        : protocol(protocol),
+          request(request),
+          maximumConnections(std::max<NSUInteger>(maximumConnections, 1)),
+          trustedCertificates(trustedCertificates) {
+        NSURL* url = [request URL];
+        secure = [[[url scheme] lowercaseString] isEqualToString:@"https"];
+        host = [[url host] UTF8String];
+        port = [url port] ? [[url port] unsignedShortValue] : (secure ? 443 : 80);
+        hostKey = (secure ? "https://" : "http://") + host + ":" + std::to_string(port) + (secure ? _trustKey(trustedCertificates) : "");
+
+        NSString* method = [request HTTPMethod] ?: @"GET";
+        expectsBody = ![method isEqualToString:@"HEAD"];
+        idempotent = _isIdempotent(method);
+        pipelinable = [request HTTPShouldUsePipelining] && ([method isEqualToString:@"GET"] || [method isEqualToString:@"HEAD"]);
+
+        _serialize(method);
+    }
+
+    // Consumes as much of bytes as belongs to this response. Returns the number of bytes consumed, or -1 if the
+    // response is malformed.
+    ptrdiff_t consume(const uint8_t* bytes, size_t length) {
+        size_t offset = 0;
+        receivedBytes |= (length > 0);
+
+        while (offset < length && _state != State::Complete) {
+            switch (_state) {
+                case State::StatusLine:
+                case State::Headers:
+                case State::ChunkSize:
+                case State::ChunkDataEnd:
+                case State::Trailers: {
+                    const uint8_t* lineEnd = static_cast<const uint8_t*>(memchr(bytes + offset, '\n', length - offset));
+                    if (!lineEnd) {
+                        return (length - offset > c_maximumHeaderLineLength) ? -1 : static_cast<ptrdiff_t>(offset);
+                    }
+
+                    size_t lineLength = lineEnd - (bytes + offset);
+                    std::string line(reinterpret_cast<const char*>(bytes + offset), lineLength);
+                    if (!line.empty() && line.back() == '\r') {
+                        line.pop_back();
+                    }
+                    offset += lineLength + 1;
+
+                    if (!_parseLine(line)) {
+                        return -1;
+                    }
+                    break;
+                }
+
+                case State::Body:
+                case State::ChunkData: {
+                    size_t count = static_cast<size_t>(std::min<uint64_t>(_remaining, length - offset));
+                    _deliverData(bytes + offset, count);
+                    offset += count;
+                    _remaining -= count;
+                    if (_remaining == 0) {
+                        _state = (_state == State::Body) ? State::Complete : State::ChunkDataEnd;
+                    }
+                    break;
+                }
+
+                case State::UntilClose:
+                    _deliverData(bytes + offset, length - offset);
+                    offset = length;
+                    break;
+
+                case State::Complete:
+                    break;
+            }
+        }
+
+        return static_cast<ptrdiff_t>(offset);
+    }
+
+    bool isComplete() const {
+        return _state == State::Complete;
+    }
+
+    // A response without framing ends when the server closes the connection.
+    bool completesAtEndOfStream() const {
+        return _state == State::UntilClose;
+    }
+
+    void finishAtEndOfStream() {
+        _state = State::Complete;
+        keepAlive = false;
+    }
+
+    // Reports completion to the client, unless the exchange was cancelled or redirected.
+    void finish() {
+        StrongId<NSURLProtocol> strongProtocol = std::move(protocol);
+        NSURLProtocol* target = strongProtocol;
+        if (target && !_redirected) {
+            [[target client] URLProtocolDidFinishLoading:target];
+        }
+    }
+
+    void fail(NSError* error) {
+        StrongId<NSURLProtocol> strongProtocol = std::move(protocol);
+        NSURLProtocol* target = strongProtocol;
+        if (target) {
+            [[target client] URLProtocol:target didFailWithError:error];
+        }
+    }
+
+    // Forget the client; whatever remains of the response is read and discarded.
+    void cancel() {
+        protocol = nil;
+        cancelled = true;
+    }
+
+    // Restarts parsing for a retry on another connection.
+    void reset() {
+        _state = State::StatusLine;
+        _headers.clear();
+        receivedBytes = false;
+        retried = true;
+    }
+
+    StrongId<NSURLProtocol> protocol;
+    StrongId<NSURLRequest> request;
+    NSUInteger maximumConnections;
+    StrongId<NSArray> trustedCertificates;
+
+    std::string host;
+    unsigned short port;
+    std::string hostKey;
+    bool secure;
+
+    std::vector<uint8_t> requestBytes;
+    bool expectsBody;
+    bool idempotent;
+    bool pipelinable;
+
+    Connection* connection = nullptr;
+    bool cancelled = false;
+    bool retried = false;
+    bool receivedBytes = false;
+    bool keepAlive = true;
+
+private:
+    enum class State { StatusLine, Headers, Body, ChunkSize, ChunkData, ChunkDataEnd, Trailers, UntilClose, Complete };
+
+    void _serialize(NSString* method) {
+        NSURL* url = [request URL];
+        NSMutableDictionary* headers = [[[request allHTTPHeaderFields] mutableCopy] autorelease] ?: [NSMutableDictionary dictionary];
+
+        if ([request HTTPShouldHandleCookies]) {
+            NSArray* cookies = [[NSHTTPCookieStorage sharedHTTPCookieStorage] cookiesForURL:url];
+            [headers addEntriesFromDictionary:[NSHTTPCookie requestHeaderFieldsWithCookies:cookies]];
+        }
+
+        NSData* body = [request HTTPBody];
+        if ([request HTTPBodyStream]) {
+            // The body stream is flattened up front, as it is for NSURLProtocol_WinHTTP.
+            NSInputStream* bodyStream = [request HTTPBodyStream];
+            NSMutableData* flattened = [NSMutableData data];
+            uint8_t buffer[c_readBufferSize];
+            [bodyStream open];
+            NSInteger read;
+            while ((read = [bodyStream read:buffer maxLength:sizeof(buffer)]) > 0) {
+                [flattened appendBytes:buffer length:read];
+            }
+            [bodyStream close];
+            body = flattened;
+        }
+
+        std::string head = std::string([method UTF8String]) + " " + _requestTarget(url) + " HTTP/1.1\r\n";
+
+        bool hasHost = false;
+        bool hasContentLength = false;
+        for (NSString* field in headers) {
+            std::string name([field UTF8String]);
+            hasHost |= _equalsIgnoringCase(name, "Host");
+            hasContentLength |= _equalsIgnoringCase(name, "Content-Length");
+            head += name + ": " + [[headers objectForKey:field] UTF8String] + "\r\n";
+        }
+
+        if (!hasHost) {
+            std::string hostField = (host.find(':') != std::string::npos) ? "[" + host + "]" : host;
+            if ([url port]) {
+                hostField += ":" + std::to_string(port);
+            }
+            head += "Host: " + hostField + "\r\n";
+        }
+
+        if (!hasContentLength && (body || [method isEqualToString:@"POST"] || [method isEqualToString:@"PUT"])) {
+            head += "Content-Length: " + std::to_string([body length]) + "\r\n";
+        }
+        head += "\r\n";
+
+        requestBytes.reserve(head.size() + [body length]);
+        requestBytes.assign(head.begin(), head.end());
+        if (body) {
+            const uint8_t* bodyBytes = static_cast<const uint8_t*>([body bytes]);
+            requestBytes.insert(requestBytes.end(), bodyBytes, bodyBytes + [body length]);
+        }
+    }
+
+    bool _parseLine(const std::string& line) {
+        switch (_state) {
+            case State::StatusLine: {
+                if (line.empty()) {
+                    return true; // Tolerate stray line breaks between responses.
+                }
+
+                // HTTP/<major>.<minor> <status code> <reason phrase>
+                if (line.compare(0, 5, "HTTP/") != 0) {
+                    return false;
+                }
+
+                char* end = nullptr;
+                unsigned long major = strtoul(line.c_str() + 5, &end, 10);
+                if (*end != '.') {
+                    return false;
+                }
+
+                unsigned long minor = strtoul(end + 1, &end, 10);
+                if (*end != ' ') {
+                    return false;
+                }
+
+                _statusCode = static_cast<int>(strtol(end + 1, &end, 10));
+                if (_statusCode < 100 || _statusCode > 999) {
+                    return false;
+                }
+
+                _version = line.substr(0, line.find(' '));
+                keepAlive = (major > 1) || (major == 1 && minor >= 1);
+                _headers.clear();
+                _state = State::Headers;
+                return true;
+            }
+
+            case State::Headers: {
+                if (!line.empty()) {
+                    if ((line[0] == ' ' || line[0] == '\t') && !_headers.empty()) {
+                        _headers.back().second += " " + line.substr(line.find_first_not_of(" \t"));
+                        return true;
+                    }
+
+                    size_t colon = line.find(':');
+                    if (colon == std::string::npos || colon == 0) {
+                        return false;
+                    }
+
+                    size_t valueStart = line.find_first_not_of(" \t", colon + 1);
+                    size_t valueEnd = line.find_last_not_of(" \t");
+                    std::string value = (valueStart == std::string::npos) ? std::string() : line.substr(valueStart, valueEnd - valueStart + 1);
+                    _headers.emplace_back(line.substr(0, colon), std::move(value));
+                    return true;
+                }
+
+                return _headersComplete();
+            }
+
+            case State::ChunkSize: {
+                char* end = nullptr;
+                unsigned long long size = strtoull(line.c_str(), &end, 16);
+                if (end == line.c_str()) {
+                    return false;
+                }
+
+                _remaining = size;
+                _state = (size == 0) ? State::Trailers : State::ChunkData;
+                return true;
+            }
+
+            case State::ChunkDataEnd:
+                if (!line.empty()) {
+                    return false;
+                }
+                _state = State::ChunkSize;
+                return true;
+
+            case State::Trailers:
+                if (line.empty()) {
+                    _state = State::Complete;
+                }
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    bool _headersComplete() {
+        // Informational responses are followed by the real one.
+        if (_statusCode >= 100 && _statusCode < 200 && _statusCode != 101) {
+            _state = State::StatusLine;
+            return true;
+        }
+
+        bool chunked = false;
+        bool hasContentLength = false;
+        uint64_t contentLength = 0;
+        for (const auto& header : _headers) {
+            if (_equalsIgnoringCase(header.first, "Transfer-Encoding")) {
+                chunked |= _containsTokenIgnoringCase(header.second, "chunked");
+            } else if (_equalsIgnoringCase(header.first, "Content-Length")) {
+                hasContentLength = true;
+                contentLength = strtoull(header.second.c_str(), nullptr, 10);
+            } else if (_equalsIgnoringCase(header.first, "Connection")) {
+                if (_containsTokenIgnoringCase(header.second, "close")) {
+                    keepAlive = false;
+                } else if (_containsTokenIgnoringCase(header.second, "keep-alive")) {
+                    keepAlive = true;
+                }
+            }
+        }
+
+        _deliverResponse();
+
+        if (!expectsBody || _statusCode == 204 || _statusCode == 304) {
+            _state = State::Complete;
+        } else if (chunked) {
+            _state = State::ChunkSize;
+        } else if (hasContentLength) {
+            _remaining = contentLength;
+            _state = (contentLength == 0) ? State::Complete : State::Body;
+        } else {
+            _state = State::UntilClose;
+            keepAlive = false;
+        }
+        return true;
+    }
+
+    void _deliverResponse() {
+        NSURLProtocol* target = protocol;
+        if (!target) {
+            return;
+        }
+
+        NSURL* url = [request URL];
+        NSMutableDictionary* headerFields = [NSMutableDictionary dictionary];
+        NSMutableDictionary* collectedCookies = [NSMutableDictionary dictionary];
+        NSString* location = nil;
+
+        for (const auto& header : _headers) {
+            NSString* name = [NSString stringWithUTF8String:header.first.c_str()];
+            NSString* value = [NSString stringWithUTF8String:header.second.c_str()] ?: @"";
+
+            if (_equalsIgnoringCase(header.first, "Set-Cookie") || _equalsIgnoringCase(header.first, "Set-Cookie2")) {
+                // Each cookie is collected separately; see NSURLProtocol_WinHTTP.
+                [collectedCookies setObject:value forKey:[NSString stringWithFormat:@"%u", static_cast<unsigned>([collectedCookies count] + 1)]];
+            } else if (_equalsIgnoringCase(header.first, "Location")) {
+                location = value;
+            }
+
+            NSString* existing = [headerFields objectForKey:name];
+            [headerFields setObject:(existing ? [NSString stringWithFormat:@"%@, %@", existing, value] : value) forKey:name];
+        }
+
+        if ([request HTTPShouldHandleCookies] && [collectedCookies count] > 0) {
+            NSArray* cookies = [NSHTTPCookie cookiesWithResponseHeaderFields:collectedCookies forURL:url];
+            [[NSHTTPCookieStorage sharedHTTPCookieStorage] setCookies:cookies forURL:url mainDocumentURL:nil];
+        }
+
+        NSHTTPURLResponse* response = [[[NSHTTPURLResponse alloc] initWithURL:url
+                                                                   statusCode:_statusCode
+                                                                  HTTPVersion:[NSString stringWithUTF8String:_version.c_str()]
+                                                                 headerFields:headerFields] autorelease];
+
+        if (_statusCode >= 300 && _statusCode <= 399 && _statusCode != 304 && location) {
+            // The rest of the response is read and discarded, so that the connection can be reused.
+            _redirected = true;
+            NSURLRequest* redirectRequest = [NSURLRequest requestWithURL:[NSURL URLWithString:location relativeToURL:url]];
+            [[target client] URLProtocol:target wasRedirectedToRequest:redirectRequest redirectResponse:response];
+        } else {
+            [[target client] URLProtocol:target didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+        }
+    }
+
+    void _deliverData(const uint8_t* bytes, size_t length) {
+        NSURLProtocol* target = protocol;
+        if (target && !_redirected && length > 0) {
+            [[target client] URLProtocol:target didLoadData:[NSData dataWithBytes:bytes length:length]];
+        }
+    }
+
+    State _state = State::StatusLine;
+    int _statusCode = 0;
+    std::string _version;
+    std::vector<std::pair<std::string, std::string>> _headers;
+    uint64_t _remaining = 0;
+    bool _redirected = false;
+};
+#pragma endregion
+
+#pragma region Connection
+class ConnectionPool;
+
+// A keep-alive connection to one host. Requests are written in order and responses are matched to them in order.
+class Connection : public std::enable_shared_from_this<Connection> {
+public:
+    Connection(ConnectionPool& pool, const Exchange& first)
+        : _pool(pool),
+          _hostKey(first.hostKey),
+          _host(first.host),
+          _port(first.port),
+          _secure(first.secure),
+          _trustedCertificates(first.trustedCertificates) {
+    }
+
+    const std::string& hostKey() const {
+        return _hostKey;
+    }
+
+    bool isClosed() const {
+        return _state == State::Closed;
+    }
+
+    bool isIdle() const {
+        return _state == State::Open && _exchanges.empty() && _keepAlive;
+    }
+
+    // Whether another request can be written behind the ones already in flight.
+    bool canPipeline() const {
+        if (_state == State::Closed || !_keepAlive || _exchanges.empty()) {
+            return false;
+        }
+
+        return std::all_of(_exchanges.begin(), _exchanges.end(), [](const std::shared_ptr<Exchange>& exchange) {
+            return exchange->pipelinable;
+        });
+    }
+
+    size_t inFlight() const {
+        return _exchanges.size();
+    }
+
+    std::chrono::steady_clock::time_point idleSince() const {
+        return _idleSince;
+    }
+
+    void open();
+    void enqueue(const std::shared_ptr<Exchange>& exchange);
+    void cancel(Exchange* exchange);
+
+    // Closes the socket. Requests that never saw a byte of their response are handed back to the pool to be retried
+    // where that is safe; the rest fail with error.
+    void close(NSError* error);
+
+private:
+    enum class State { Resolving, Connecting, Handshaking, Open, Closed };
+
+    void _connectNext();
+    void _onEvents(short revents);
+    void _connected();
+    void _advanceHandshake();
+    void _sendPlaintext(const uint8_t* bytes, size_t length);
+    void _drainEncrypted();
+    void _flush();
+    void _readable();
+    void _processIncoming();
+    void _completeFront();
+    void _updateEvents();
+
+    ConnectionPool& _pool;
+    std::string _hostKey;
+    std::string _host;
+    unsigned short _port;
+    bool _secure;
+    StrongId<NSArray> _trustedCertificates;
+
+    State _state = State::Resolving;
+    bool _keepAlive = true;
+    size_t _completed = 0;
+    std::chrono::steady_clock::time_point _idleSince;
+
+    StrongId<NSSocket> _socket;
+    StrongId<NSSSLHandler> _ssl;
+    addrinfo* _addresses = nullptr;
+    addrinfo* _nextAddress = nullptr;
+
+    std::deque<std::shared_ptr<Exchange>> _exchanges;
+    std::vector<uint8_t> _pendingPlaintext; // Written before the TLS handshake completed.
+    std::vector<uint8_t> _wire;
+    size_t _wireOffset = 0;
+    std::vector<uint8_t> _incoming;
+};
+
+// Per-host keep-alive connections. Only ever used on the event loop thread.
+class ConnectionPool {
+public:
+    static ConnectionPool& shared() {
+        static ConnectionPool* pool = new ConnectionPool();
+        return *pool;
+    }
+
+    void enqueue(const std::shared_ptr<Exchange>& exchange) {
+        Host& host = _hosts[exchange->hostKey];
+        host.maximumConnections = exchange->maximumConnections;
+        if (!_assign(host, exchange)) {
+            host.waiting.push_back(exchange);
+        }
+    }
+
+    void requeue(const std::shared_ptr<Exchange>& exchange) {
+        exchange->reset();
+        Host& host = _hosts[exchange->hostKey];
+        if (!_assign(host, exchange)) {
+            host.waiting.push_front(exchange);
+        }
+    }
+
+    void cancel(const std::shared_ptr<Exchange>& exchange) {
+        exchange->cancel();
+        if (exchange->connection) {
+            exchange->connection->cancel(exchange.get());
+            return;
+        }
+
+        auto found = _hosts.find(exchange->hostKey);
+        if (found != _hosts.end()) {
+            auto& waiting = found->second.waiting;
+            waiting.erase(std::remove(waiting.begin(), waiting.end(), exchange), waiting.end());
+        }
+    }
+
+    // Called when a connection has finished all of its requests and is idle.
+    void connectionAvailable(Connection* connection) {
+        Host& host = _hosts[connection->hostKey()];
+        while (!host.waiting.empty() && (connection->isIdle() || connection->canPipeline())) {
+            std::shared_ptr<Exchange> exchange = host.waiting.front();
+            if (!connection->isIdle() && !exchange->pipelinable) {
+                break;
+            }
+            host.waiting.pop_front();
+            connection->enqueue(exchange);
+        }
+    }
+
+    void connectionClosed(Connection* connection) {
+        auto found = _hosts.find(connection->hostKey());
+        if (found == _hosts.end()) {
+            return;
+        }
+
+        Host& host = found->second;
+        auto& connections = host.connections;
+        connections.erase(std::remove_if(connections.begin(),
+                                         connections.end(),
+                                         [connection](const std::shared_ptr<Connection>& entry) { return entry.get() == connection; }),
+                          connections.end());
+
+        while (!host.waiting.empty() && connections.size() < host.maximumConnections) {
+            std::shared_ptr<Exchange> exchange = host.waiting.front();
+            host.waiting.pop_front();
+            _assign(host, exchange);
+        }
+
+        if (connections.empty() && host.waiting.empty()) {
+            _hosts.erase(found);
+        }
+    }
+
+    void closeIdleConnections() {
+        auto now = std::chrono::steady_clock::now();
+        std::vector<std::shared_ptr<Connection>> expired;
+        for (const auto& entry : _hosts) {
+            for (const auto& connection : entry.second.connections) {
+                if (connection->isIdle() && now - connection->idleSince() > c_idleConnectionTimeout) {
+                    expired.push_back(connection);
+                }
+            }
+        }
+
+        for (const auto& connection : expired) {
+            connection->close(nil);
+        }
+    }
+
+    ssl_session_st* sessionForHost(const std::string& hostKey) {
+        auto found = _sessions.find(hostKey);
+        return (found != _sessions.end()) ? found->second : nullptr;
+    }
+
+    // Takes ownership of session.
+    void setSessionForHost(const std::string& hostKey, ssl_session_st* session) {
+        ssl_session_st*& entry = _sessions[hostKey];
+        if (entry != session) {
+            [NSSSLHandler releaseSession:entry];
+            entry = session;
+        } else {
+            [NSSSLHandler releaseSession:session];
+        }
+    }
+
+private:
+    struct Host {
+        std::vector<std::shared_ptr<Connection>> connections;
+        std::deque<std::shared_ptr<Exchange>> waiting;
+        NSUInteger maximumConnections = c_defaultMaximumConnectionsPerHost;
+    };
+
+    ConnectionPool() {
+        EventLoop::shared().setIdleHandler([this]() { closeIdleConnections(); });
+    }
+
+    bool _assign(Host& host, const std::shared_ptr<Exchange>& exchange) {
+        for (const auto& connection : host.connections) {
+            if (connection->isIdle()) {
+                connection->enqueue(exchange);
+                return true;
+            }
+        }
+
+        if (host.connections.size() < host.maximumConnections) {
+            auto connection = std::make_shared<Connection>(*this, *exchange);
+            host.connections.push_back(connection);
+            connection->enqueue(exchange);
+            connection->open();
+            return true;
+        }
+
+        if (exchange->pipelinable) {
+            Connection* shortest = nullptr;
+            for (const auto& connection : host.connections) {
+                if (connection->canPipeline() && (!shortest || connection->inFlight() < shortest->inFlight())) {
+                    shortest = connection.get();
+                }
+            }
+
+            if (shortest) {
+                shortest->enqueue(exchange);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::unordered_map<std::string, Host> _hosts;
+    std::unordered_map<std::string, ssl_session_st*> _sessions;
+};
+
+void Connection::open() {
+    // Name resolution blocks, so it happens on a dispatch worker rather than on the event loop.
+    std::shared_ptr<Connection> strongThis = shared_from_this();
+    std::string host = _host;
+    std::string port = std::to_string(_port);
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+            addresses = nullptr;
+        }
+
+        EventLoop::shared().post([strongThis, addresses]() {
+            if (strongThis->_state == State::Closed) {
+                if (addresses) {
+                    freeaddrinfo(addresses);
+                }
+                return;
+            }
+
+            if (!addresses) {
+                strongThis->close(_errorWithCode(NSURLErrorCannotFindHost, @"The specified host could not be found."));
+                return;
+            }
+
+            strongThis->_addresses = strongThis->_nextAddress = addresses;
+            strongThis->_connectNext();
+        });
+    });
+}
+
+void Connection::_connectNext() {
+    if (_socket) {
+        EventLoop::shared().unwatch([_socket descriptor]);
+        [_socket close];
+        _socket = nil;
+    }
+
+    while (_nextAddress) {
+        addrinfo* address = _nextAddress;
+        _nextAddress = _nextAddress->ai_next;
+
+        int descriptor = static_cast<int>(socket(address->ai_family, address->ai_socktype, address->ai_protocol));
+        if (descriptor == -1) {
+            continue;
+        }
+
+        int noDelay = 1;
+        setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+        _setNonBlocking(descriptor);
+
+        _socket.attach([[NSSocket alloc] initWithDescriptor:descriptor]);
+        if (connect(descriptor, address->ai_addr, static_cast<int>(address->ai_addrlen)) == 0 || _wouldBlock()) {
+            _state = State::Connecting;
+            std::shared_ptr<Connection> strongThis = shared_from_this();
+            EventLoop::shared().watch(descriptor, POLLOUT, [strongThis](short revents) { strongThis->_onEvents(revents); });
+            return;
+        }
+
+        [_socket close];
+        _socket = nil;
+    }
+
+    close(_errorWithCode(NSURLErrorCannotConnectToHost, @"Could not connect to the server."));
+}
+
+void Connection::_onEvents(short revents) {
+    if (_state == State::Connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt([_socket descriptor], SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length);
+        if (error != 0 || (revents & (POLLERR | POLLHUP | POLLNVAL))) {
+            _connectNext();
+        } else if (revents & POLLOUT) {
+            _connected();
+        }
+        return;
+    }
+
+    if (revents & (POLLIN | POLLERR | POLLHUP)) {
+        _readable();
+    }
+
+    if (_state != State::Closed && (revents & POLLOUT)) {
+        _flush();
+    }
+}
+
+void Connection::_connected() {
+    freeaddrinfo(_addresses);
+    _addresses = _nextAddress = nullptr;
+
+    if (!_secure) {
+        _state = State::Open;
+        _flush();
+        return;
+    }
+
+    NSDictionary* properties = [_trustedCertificates count] > 0 ? @{ _kNSSSLTrustedCertificates : _trustedCertificates.get() } : nil;
+    _ssl.attach([[NSSSLHandler alloc] initWithProperties:properties]);
+    [_ssl setPeerName:[NSString stringWithUTF8String:_host.c_str()]];
+    [_ssl setSession:_pool.sessionForHost(_hostKey)];
+    _state = State::Handshaking;
+    _advanceHandshake();
+}
+
+void Connection::_advanceHandshake() {
+    int result = [_ssl continueHandshake];
+    _drainEncrypted();
+    if (_state == State::Closed) {
+        return;
+    }
+
+    if (result < 0) {
+        if ([_ssl failedPeerVerification]) {
+            close(_errorWithCode(NSURLErrorServerCertificateUntrusted,
+                                 @"The certificate for this server is invalid or was not issued for this server."));
+        } else {
+            close(_errorWithCode(NSURLErrorSecureConnectionFailed, @"An SSL error has occurred and a secure connection to the server cannot be made."));
+        }
+        return;
+    }
+
+    if (result == 1) {
+        TraceVerbose(TAG, L"TLS handshake with %hs complete (session %hs).", _host.c_str(), [_ssl isSessionReused] ? "resumed" : "new");
+        _pool.setSessionForHost(_hostKey, [_ssl copySession]);
+        _state = State::Open;
+
+        std::vector<uint8_t> pending;
+        pending.swap(_pendingPlaintext);
+        if (!pending.empty()) {
+            _sendPlaintext(pending.data(), pending.size());
+        }
+    }
+}
+
+void Connection::enqueue(const std::shared_ptr<Exchange>& exchange) {
+    exchange->connection = this;
+    _exchanges.push_back(exchange);
+    _sendPlaintext(exchange->requestBytes.data(), exchange->requestBytes.size());
+}
+
+void Connection::_sendPlaintext(const uint8_t* bytes, size_t length) {
+    if (!_secure) {
+        _wire.insert(_wire.end(), bytes, bytes + length);
+        if (_state == State::Open) {
+            _flush();
+        }
+        return;
+    }
+
+    if (_state != State::Open) {
+        _pendingPlaintext.insert(_pendingPlaintext.end(), bytes, bytes + length);
+        return;
+    }
+
+    [_ssl writePlaintext:bytes maxLength:static_cast<int>(length)];
+    _drainEncrypted();
+}
+
+void Connection::_drainEncrypted() {
+    uint8_t buffer[c_readBufferSize];
+    while ([_ssl writeBytesAvailable] > 0) {
+        NSInteger count = [_ssl readEncrypted:buffer maxLength:sizeof(buffer)];
+        if (count <= 0) {
+            break;
+        }
+        _wire.insert(_wire.end(), buffer, buffer + count);
+    }
+    _flush();
+}
+
+void Connection::_flush() {
+    while (_wireOffset < _wire.size()) {
+        int sent = [_socket write:_wire.data() + _wireOffset maxLength:static_cast<DWORD>(_wire.size() - _wireOffset)];
+        if (sent > 0) {
+            _wireOffset += sent;
+        } else if (_wouldBlock()) {
+            break;
+        } else {
+            close(_errorWithCode(NSURLErrorNetworkConnectionLost, @"The network connection was lost."));
+            return;
+        }
+    }
+
+    if (_wireOffset == _wire.size()) {
+        _wire.clear();
+        _wireOffset = 0;
+    }
+    _updateEvents();
+}
+
+void Connection::_updateEvents() {
+    if (_state != State::Connecting && _state != State::Resolving && _socket) {
+        EventLoop::shared().setEvents([_socket descriptor], _wire.empty() ? POLLIN : (POLLIN | POLLOUT));
+    }
+}
+
+void Connection::_readable() {
+    // Keeps this connection alive while the handlers below close it.
+    std::shared_ptr<Connection> strongThis = shared_from_this();
+
+    uint8_t buffer[c_readBufferSize];
+    bool endOfStream = false;
+    while (true) {
+        int count = [_socket read:buffer maxLength:sizeof(buffer)];
+        if (count > 0) {
+            if (_ssl) {
+                [_ssl writeEncrypted:buffer maxLength:count];
+            } else {
+                _incoming.insert(_incoming.end(), buffer, buffer + count);
+            }
+        } else if (count < 0 && _wouldBlock()) {
+            break;
+        } else {
+            endOfStream = true;
+            break;
+        }
+    }
+
+    if (_state == State::Handshaking) {
+        _advanceHandshake();
+    }
+
+    if (_state == State::Open && _ssl) {
+        unsigned count;
+        while ((count = [_ssl readPlaintext:buffer maxLength:sizeof(buffer)]) > 0) {
+            _incoming.insert(_incoming.end(), buffer, buffer + count);
+        }
+        _drainEncrypted();
+    }
+
+    if (_state == State::Open) {
+        _processIncoming();
+    }
+
+    if (endOfStream && _state != State::Closed) {
+        if (!_exchanges.empty() && _exchanges.front()->completesAtEndOfStream()) {
+            _exchanges.front()->finishAtEndOfStream();
+            _completeFront();
+        }
+        close(_exchanges.empty() ? nil : _errorWithCode(NSURLErrorNetworkConnectionLost, @"The network connection was lost."));
+    }
+}
+
+void Connection::_processIncoming() {
+    size_t offset = 0;
+    while (!_exchanges.empty() && offset < _incoming.size()) {
+        std::shared_ptr<Exchange> front = _exchanges.front();
+        ptrdiff_t consumed = front->consume(_incoming.data() + offset, _incoming.size() - offset);
+        if (consumed < 0) {
+            close(_errorWithCode(NSURLErrorBadServerResponse, @"The server returned a malformed response."));
+            return;
+        }
+
+        offset += consumed;
+        if (!front->isComplete()) {
+            break;
+        }
+
+        _completeFront();
+        if (_state == State::Closed) {
+            return;
+        }
+    }
+
+    if (_exchanges.empty() && offset < _incoming.size()) {
+        TraceWarning(TAG, L"Discarding %u unexpected bytes from %hs.", static_cast<unsigned>(_incoming.size() - offset), _hostKey.c_str());
+        offset = _incoming.size();
+        _keepAlive = false;
+    }
+
+    _incoming.erase(_incoming.begin(), _incoming.begin() + offset);
+}
+
+void Connection::_completeFront() {
+    std::shared_ptr<Exchange> exchange = _exchanges.front();
+    _exchanges.pop_front();
+    exchange->connection = nullptr;
+    ++_completed;
+    _keepAlive = _keepAlive && exchange->keepAlive;
+
+    exchange->finish();
+
+    if (!_keepAlive) {
+        if (_state != State::Closed) {
+            close(nil);
+        }
+        return;
+    }
+
+    if (_exchanges.empty()) {
+        _idleSince = std::chrono::steady_clock::now();
+        _pool.connectionAvailable(this);
+    }
+}
+
+void Connection::cancel(Exchange* exchange) {
+    // A request that is alone on its connection takes the connection with it, rather than draining a response that
+    // nobody wants. Pipelined requests behind it would otherwise stall, so their responses are read and discarded.
+    if (_exchanges.size() == 1 && _exchanges.front().get() == exchange) {
+        close(nil);
+    }
+}
+
+void Connection::close(NSError* error) {
+    if (_state == State::Closed) {
+        return;
+    }
+
+    std::shared_ptr<Connection> strongThis = shared_from_this();
+    _state = State::Closed;
+
+    if (_socket) {
+        EventLoop::shared().unwatch([_socket descriptor]);
+        [_socket close];
+        _socket = nil;
+    }
+
+    if (_addresses) {
+        freeaddrinfo(_addresses);
+        _addresses = _nextAddress = nullptr;
+    }
+
+    std::deque<std::shared_ptr<Exchange>> exchanges;
+    exchanges.swap(_exchanges);
+    _pool.connectionClosed(this);
+
+    for (const auto& exchange : exchanges) {
+        exchange->connection = nullptr;
+        if (exchange->cancelled) {
+            continue;
+        }
+
+        // A kept-alive connection may have been closed by the server just as a request was written to it.
+        if (!exchange->receivedBytes && !exchange->retried && exchange->idempotent && _completed > 0) {
+            _pool.requeue(exchange);
+        } else {
+            exchange->fail(error ?: _errorWithCode(NSURLErrorNetworkConnectionLost, @"The network connection was lost."));
+        }
+    }
+}
+#pragma endregion
+
+} // namespace
+
+@interface NSURLProtocol_socket : NSURLProtocol {
+    std::shared_ptr<Exchange> _exchange;
+}
+@end
+
+@implementation NSURLProtocol_socket
++ (BOOL)canInitWithRequest:(NSURLRequest*)request {
+    NSString* scheme = [[[request URL] scheme] lowercaseString];
+    return [[request URL] host] && ([scheme isEqualToString:@"http"] || [scheme isEqualToString:@"https"]);
+}
+
++ (NSURLRequest*)canonicalRequestForRequest:(NSURLRequest*)request {
+    return request;
+}
+
+- (void)startLoading {
+    @synchronized(self) {
+        if (_exchange) {
+            return;
+        }
+
+        NSUInteger maximumConnections = c_defaultMaximumConnectionsPerHost;
+        NSArray* trustedCertificates = nil;
+        id client = [self client];
+        if ([client isKindOfClass:[NSURLSessionTask class]]) {
+            NSURLSessionConfiguration* configuration = [static_cast<NSURLSessionTask*>(client) _configuration];
+            NSInteger configured = [configuration HTTPMaximumConnectionsPerHost];
+            if (configured > 0) {
+                maximumConnections = configured;
+            }
+            trustedCertificates = [configuration _trustedCertificates];
+        }
+
+        std::shared_ptr<Exchange> exchange = std::make_shared<Exchange>(self, _request, maximumConnections, trustedCertificates);
+        _exchange = exchange;
+        EventLoop::shared().post([exchange]() { ConnectionPool::shared().enqueue(exchange); });
+    }
+}
+
+- (void)stopLoading {
+    @synchronized(self) {
+        if (!_exchange) {
+            return;
+        }
+
+        std::shared_ptr<Exchange> exchange = std::move(_exchange);
+        EventLoop::shared().post([exchange]() { ConnectionPool::shared().cancel(exchange); });
+    }
+}
+@end
@@ -15,6 +15,7 @@
 //******************************************************************************
 
 #import <Foundation/NSURLSessionConfiguration.h>
+#import "NSURLSessionConfiguration-Internal.h"
 #import <Starboard.h>
 #import <Windows.h>
 
@@ -23,6 +24,7 @@
 @end
 
 @implementation NSURLSessionConfiguration
+@synthesize _trustedCertificates = _trustedCertificates;
 
 - (instancetype)_initWithSharedDefaults {
     if (self = [super init]) {
@@ -79,6 +81,11 @@
     return self;
 }
 
+- (void)dealloc {
+    [_trustedCertificates release];
+    [super dealloc];
+}
+
 /**
  @Status Interoperable
 */
@@ -105,6 +112,7 @@
     copy.protocolClasses = _protocolClasses;
     copy.HTTPShouldUsePipelining = _HTTPShouldUsePipelining;
     copy.connectionProxyDictionary = _connectionProxyDictionary;
+    copy._trustedCertificates = _trustedCertificates;
     return copy;
 }
 
@@ -44,6 +44,20 @@ enum HttpStatus : int {
     return [NSURLProtocol _URLProtocolClassForRequest:request];
 }
 
+// The configuration's protocol classes are consulted in order before the globally registered ones.
+- (Class)_protocolClassForRequest:(NSURLRequest*)request {
+    for (Class protocolClass in _configuration.protocolClasses) {
+        if ([protocolClass canInitWithRequest:request]) {
+            return protocolClass;
+        }
+    }
+    return [[self class] _protocolClassForRequest:request];
+}
+
+- (NSURLSessionConfiguration*)_configuration {
+    return _configuration;
+}
+
 - (id)_initWithTaskDelegate:(id<_NSURLSessionTaskDelegate>)taskDelegate
                  identifier:(NSUInteger)identifier
               configuration:(NSURLSessionConfiguration*)configuration
@@ -165,7 +179,7 @@ enum HttpStatus : int {
 
 - (void)__startLoadingThread {
     if (!_protocolConnection) {
-        Class protocolClass = [[self class] _protocolClassForRequest:_currentRequest];
+        Class protocolClass = [self _protocolClassForRequest:_currentRequest];
         if (!protocolClass || ![protocolClass canInitWithRequest:_currentRequest]) {
             NSError* error = [NSError
                 errorWithDomain:NSCocoaErrorDomain
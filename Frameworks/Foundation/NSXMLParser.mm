@@ -20,13 +20,70 @@
 #include "Foundation/NSMutableArray.h"
 #include "Foundation/NSMutableDictionary.h"
 #include "Foundation/NSData.h"
+#include "Foundation/NSError.h"
+#include "Foundation/NSInputStream.h"
 #include "Foundation/NSAutoreleasePool.h"
 #include "Foundation/NSXMLParser.h"
 
 #include <libxml/parser.h>
+#include <libxml/SAX2.h>
+
+#include <algorithm>
+#include <memory>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
 
 //#define LOG_PARSED
 
+FOUNDATION_EXPORT NSString* const NSXMLParserErrorDomain = @"NSXMLParserErrorDomain";
+
+// Size of each chunk handed to the libxml2 push parser. Only one chunk is resident at a time, so memory use
+// is bounded by this and by libxml2's own input window regardless of document size.
+static const size_t c_parseChunkSize = 64 * 1024;
+
+// Element and attribute names repeat heavily in real documents (GPX/KML have a handful of distinct tags
+// across millions of elements), so they are interned to one NSString per distinct name for the duration of a parse.
+// The table is keyed on the name's bytes without copying them, so a lookup of a name already seen doesn't allocate;
+// an entry's key points at the copy its value owns.
+struct NameKey {
+    const char* bytes;
+    size_t length;
+};
+
+struct NameKeyHash {
+    size_t operator()(const NameKey& key) const {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < key.length; ++i) {
+            hash = (hash ^ static_cast<unsigned char>(key.bytes[i])) * 1099511628211ULL;
+        }
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+};
+
+struct NameKeyEqual {
+    bool operator()(const NameKey& left, const NameKey& right) const {
+        return left.length == right.length && memcmp(left.bytes, right.bytes, left.length) == 0;
+    }
+};
+
+struct InternedName {
+    std::unique_ptr<char[]> bytes;
+    StrongId<NSString> string;
+};
+
+using NameTable = std::unordered_map<NameKey, InternedName, NameKeyHash, NameKeyEqual>;
+
+@interface NSXMLParser () {
+    StrongId<NSInputStream> _stream;
+    xmlParserCtxtPtr _context;
+    NameTable _names;
+    bool _aborted;
+    StrongId<NSError> _parserError;
+}
+@end
+
 @implementation NSXMLParser
 
 /**
@@ -37,13 +94,16 @@
 }
 
 - (instancetype)initWithContentsOfFile:(id)path {
-    id data = [NSData dataWithContentsOfFile:path];
-    if (data == nil) {
+    // Files are read incrementally rather than loaded into an NSData up front.
+    NSInputStream* stream = [[NSInputStream alloc] initWithFileAtPath:path];
+    if (stream == nil) {
         [self release];
         return nil;
     }
 
-    return [self initWithData:data];
+    self = [self initWithStream:stream];
+    [stream release];
+    return self;
 }
 
 /**
@@ -56,6 +116,17 @@
     return self;
 }
 
+/**
+ @Status Interoperable
+ @Notes The stream is read in fixed-size chunks and fed to an incremental parser; the document is never fully resident.
+*/
+- (instancetype)initWithStream:(NSInputStream*)stream {
+    if (self = [super init]) {
+        _stream = stream;
+    }
+    return self;
+}
+
 /**
  @Status Interoperable
 */
@@ -82,6 +153,25 @@
     return _delegate;
 }
 
+static NSString* internedName(NSXMLParser* self, const xmlChar* name) {
+    const char* bytes = reinterpret_cast<const char*>(name);
+    NameKey key{ bytes, strlen(bytes) };
+    auto found = self->_names.find(key);
+    if (found != self->_names.end()) {
+        return found->second.string;
+    }
+
+    InternedName interned;
+    interned.bytes.reset(new char[key.length + 1]);
+    memcpy(interned.bytes.get(), bytes, key.length + 1);
+    interned.string.attach([[NSString alloc] initWithUTF8String:bytes]);
+
+    NSString* nameString = interned.string;
+    key.bytes = interned.bytes.get();
+    self->_names.emplace(key, std::move(interned));
+    return nameString;
+}
+
 static void startDocumentCallback(void* ctx) {
     NSXMLParser* self = (NSXMLParser*)ctx;
 
@@ -118,22 +208,17 @@ static void startElementCallback(void* ctx, const xmlChar* name, const xmlChar**
         } else {
             attrs = [NSMutableDictionary new];
             while (currAttr && *currAttr) {
-                id key = [[NSString alloc] initWithUTF8String:(const char*)currAttr[0]];
                 id val = [[NSString alloc] initWithUTF8String:(const char*)currAttr[1]];
 
-                [attrs setObject:val forKey:key];
-                [key release];
+                [attrs setObject:val forKey:internedName(self, currAttr[0])];
                 [val release];
 
                 currAttr += 2;
             }
         }
 
-        id nameString = [[NSString alloc] initWithUTF8String:(const char*)name];
-
-        [self->_delegate parser:self didStartElement:nameString namespaceURI:nil qualifiedName:nil attributes:attrs];
+        [self->_delegate parser:self didStartElement:internedName(self, name) namespaceURI:nil qualifiedName:nil attributes:attrs];
 
-        [nameString release];
         [attrs release];
     }
 }
@@ -142,9 +227,7 @@ static void endElementCallback(void* ctx, const xmlChar* name) {
     NSXMLParser* self = (NSXMLParser*)ctx;
 
     if (self->_hasDidEndElement) {
-        id nameString = [[NSString alloc] initWithUTF8String:(const char*)name];
-        [self->_delegate parser:self didEndElement:nameString namespaceURI:nil qualifiedName:nil];
-        [nameString release];
+        [self->_delegate parser:self didEndElement:internedName(self, name) namespaceURI:nil qualifiedName:nil];
     }
 }
 
@@ -171,13 +254,44 @@ static xmlEntityPtr entityCallback(void* user_data, const xmlChar* name) {
     return xmlGetPredefinedEntity(name);
 }
 
+// Reads the next chunk of input into buffer. Returns the number of bytes read, 0 at end of input, or -1 if the stream
+// failed, after setting parserError to the stream's error and telling the delegate.
+- (NSInteger)_readChunk:(std::vector<char>&)buffer {
+    if (_stream != nil) {
+        NSInteger read = [_stream read:reinterpret_cast<uint8_t*>(buffer.data()) maxLength:buffer.size()];
+        if (read < 0) {
+            _parserError = [_stream streamError];
+            if (_parserError == nil) {
+                _parserError = [NSError errorWithDomain:NSXMLParserErrorDomain code:NSXMLParserInternalError userInfo:nil];
+            }
+
+            if ([_delegate respondsToSelector:@selector(parser:parseErrorOccurred:)]) {
+                [_delegate parser:self parseErrorOccurred:_parserError];
+            }
+            return -1;
+        }
+        return read;
+    }
+
+    size_t toRead = std::min(buffer.size(), static_cast<size_t>(_length - (_bytes - static_cast<const uint8_t*>([_data bytes]))));
+    memcpy(buffer.data(), _bytes, toRead);
+    _bytes += toRead;
+    return static_cast<NSInteger>(toRead);
+}
+
 /**
  @Status Interoperable
 */
 - (BOOL)parse {
-    _bytes = (uint8_t*)[_data bytes];
-    _length = [_data length];
+    if (_stream != nil) {
+        [_stream open];
+    } else {
+        _bytes = (uint8_t*)[_data bytes];
+        _length = [_data length];
+    }
     _emptyDictionary = [NSDictionary new];
+    _aborted = false;
+    _parserError = nil;
 
     xmlSubstituteEntitiesDefault(1);
 
@@ -193,48 +307,83 @@ static xmlEntityPtr entityCallback(void* user_data, const xmlChar* name) {
     sax.cdataBlock = cdataCallback;
     sax.getEntity = entityCallback;
 
-    int ret = xmlSAXUserParseMemory(&sax, (void*)self, (const char*)_bytes, _length);
-    [_emptyDictionary release];
+    std::vector<char> buffer(c_parseChunkSize);
 
-    return ret == 0;
-}
+    // libxml2 sniffs the encoding from the first bytes handed to the push parser, so seed it with the first chunk.
+    NSInteger read = [self _readChunk:buffer];
+    if (read >= 0) {
+        _context = xmlCreatePushParserCtxt(&sax, (void*)self, buffer.data(), static_cast<int>(read), nullptr);
+    }
+
+    int ret = -1;
+    if (_context) {
+        ret = 0;
+        while (ret == 0 && !_aborted && read > 0) {
+            read = [self _readChunk:buffer];
+            if (read > 0) {
+                ret = xmlParseChunk(_context, buffer.data(), static_cast<int>(read), 0);
+            }
+        }
+
+        // A stream that fails part way through is not a document that ended there.
+        if (read < 0) {
+            ret = -1;
+        }
+
+        if (ret == 0 && !_aborted) {
+            ret = xmlParseChunk(_context, nullptr, 0, 1);
+        }
+
+        if (ret == 0 && !_context->wellFormed) {
+            ret = -1;
+        }
+
+        xmlFreeParserCtxt(_context);
+        _context = nullptr;
+    }
+
+    if (_stream != nil) {
+        [_stream close];
+    }
 
-void abortParsing__unused() {
-    // NSUnimplementedMethod();
-    assert(0);
+    _names.clear();
+    [_emptyDictionary release];
+    _emptyDictionary = nil;
+
+    return ret == 0 && !_aborted;
 }
 
 /**
- @Status Stub
+ @Status Interoperable
 */
-- (int)columnNumber {
-    UNIMPLEMENTED();
-    return StubReturn();
+- (NSInteger)columnNumber {
+    return _context ? xmlSAX2GetColumnNumber(_context) : 0;
 }
 
 /**
- @Status Stub
+ @Status Interoperable
 */
-- (int)lineNumber {
-    UNIMPLEMENTED();
-    return StubReturn();
+- (NSInteger)lineNumber {
+    return _context ? xmlSAX2GetLineNumber(_context) : 0;
 }
 
 /**
- @Status Stub
- @Notes
+ @Status Caveat
+ @Notes Only reports a failure to read the input stream; malformed documents leave it nil.
 */
-- (void)abortParsing {
-    UNIMPLEMENTED();
+- (NSError*)parserError {
+    return [[_parserError retain] autorelease];
 }
 
 /**
- @Status Stub
- @Notes
+ @Status Caveat
+ @Notes Stops the parse; parse returns NO. parserError is not populated.
 */
-- (instancetype)initWithStream:(NSInputStream*)stream {
-    UNIMPLEMENTED();
-    return StubReturn();
+- (void)abortParsing {
+    _aborted = true;
+    if (_context) {
+        xmlStopParser(_context);
+    }
 }
 
 @end
@@ -25,15 +25,1147 @@
 #include <ErrorHandling.h>
 #include <StubReturn.h>
 #include <RawBuffer.h>
+#include <algorithm>
 #include <memory>
+#include <string.h>
 #include <vector>
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CRYPTOR_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define CRYPTOR_ARM64 1
+#include <arm_neon.h>
+#endif
+
 using namespace Microsoft::WRL;
 using namespace ABI::Windows::Storage::Streams;
 using namespace ABI::Windows::Security::Cryptography;
 using namespace ABI::Windows::Security::Cryptography::Core;
 using namespace Windows::Foundation;
 
+// AES is done here, with AES-NI or the ARMv8 instructions when the processor has them and a constant-time bitsliced
+// cipher otherwise, on the caller's buffers. DES, 3DES, RC2 and RC4 still go through Windows.Security.Cryptography.
+//
+// Without the instructions, nothing is looked up in a table indexed by the key or the data, as the time that takes
+// depends on what is in the cache: the S-box is computed with logic gates on many bytes at once, and GHASH multiplies
+// with integer multiplications that have their carries kept apart.
+
+static const size_t c_aesBlockBytes = 16;
+
+static inline uint32_t _loadBigEndian32(const unsigned char* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static inline uint64_t _loadBigEndian64(const unsigned char* p) {
+    return (uint64_t(_loadBigEndian32(p)) << 32) | _loadBigEndian32(p + 4);
+}
+
+static inline void _storeBigEndian32(unsigned char* p, uint32_t value) {
+    p[0] = static_cast<unsigned char>(value >> 24);
+    p[1] = static_cast<unsigned char>(value >> 16);
+    p[2] = static_cast<unsigned char>(value >> 8);
+    p[3] = static_cast<unsigned char>(value);
+}
+
+static inline void _storeBigEndian64(unsigned char* p, uint64_t value) {
+    _storeBigEndian32(p, static_cast<uint32_t>(value >> 32));
+    _storeBigEndian32(p + 4, static_cast<uint32_t>(value));
+}
+
+static inline uint32_t _rotateRight(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline void _xorBlock(unsigned char* out, const unsigned char* a, const unsigned char* b) {
+    for (size_t i = 0; i < c_aesBlockBytes; ++i) {
+        out[i] = a[i] ^ b[i];
+    }
+}
+
+// Round keys for both directions. The decryption ones are for the equivalent inverse cipher (FIPS-197 5.3.5), the
+// form that AES-NI and the ARMv8 instructions take; the bitsliced cipher runs the inverse cipher itself on the
+// encryption keys, which it keeps bitsliced as well.
+struct AesKey {
+    unsigned rounds;
+    unsigned char encrypt[15][16];
+    unsigned char decrypt[15][16];
+    uint32_t sliced[15][8];
+};
+
+// H for GHASH: its halves for _ghashPortable, or H to H^4 byte-reversed for carry-less multiply.
+struct GcmKey {
+    uint64_t high;
+    uint64_t low;
+    unsigned char powers[4][16];
+};
+
+// The bitsliced cipher works on two blocks at once, as eight words: bit b of each byte is in word b, at bit
+// 4 * column + row for the first block and 16 more for the second.
+
+// Bit b of each byte of a little-endian word, in its four lowest bits. The partial products never overlap.
+static inline uint32_t _gatherBits(uint32_t word, int b) {
+    return ((((word >> b) & 0x01010101) * 0x00204081) >> 21) & 0xf;
+}
+
+// The inverse of _gatherBits: the four lowest bits of nibble, in bit 0 of each byte.
+static inline uint32_t _spreadBits(uint32_t nibble) {
+    return ((nibble & 0xf) * 0x00204081) & 0x01010101;
+}
+
+static inline uint32_t _loadLittleEndian32(const unsigned char* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static inline void _storeLittleEndian32(unsigned char* p, uint32_t value) {
+    p[0] = static_cast<unsigned char>(value);
+    p[1] = static_cast<unsigned char>(value >> 8);
+    p[2] = static_cast<unsigned char>(value >> 16);
+    p[3] = static_cast<unsigned char>(value >> 24);
+}
+
+// first and second may be the same block.
+static void _bitsliceLoad(uint32_t* q, const unsigned char* first, const unsigned char* second) {
+    uint32_t words[8];
+    for (size_t i = 0; i < 4; ++i) {
+        words[i] = _loadLittleEndian32(first + 4 * i);
+        words[4 + i] = _loadLittleEndian32(second + 4 * i);
+    }
+    for (int b = 0; b < 8; ++b) {
+        q[b] = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            q[b] |= _gatherBits(words[i], b) << (4 * i);
+        }
+    }
+}
+
+// first and second may be the same block if both halves of q hold the same one.
+static void _bitsliceStore(const uint32_t* q, unsigned char* first, unsigned char* second) {
+    for (size_t i = 0; i < 8; ++i) {
+        uint32_t word = 0;
+        for (int b = 0; b < 8; ++b) {
+            word |= _spreadBits(q[b] >> (4 * i)) << b;
+        }
+        _storeLittleEndian32((i < 4) ? first + 4 * i : second + 4 * (i - 4), word);
+    }
+}
+
+// Boyar and Peralta's circuit for the S-box, on bit b of every byte at once in q[b].
+static void _bitsliceSubstitute(uint32_t* q) {
+    const uint32_t x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4], x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+    // Top linear transformation
+    const uint32_t y14 = x3 ^ x5;
+    const uint32_t y13 = x0 ^ x6;
+    const uint32_t y9 = x0 ^ x3;
+    const uint32_t y8 = x0 ^ x5;
+    const uint32_t t0 = x1 ^ x2;
+    const uint32_t y1 = t0 ^ x7;
+    const uint32_t y4 = y1 ^ x3;
+    const uint32_t y12 = y13 ^ y14;
+    const uint32_t y2 = y1 ^ x0;
+    const uint32_t y5 = y1 ^ x6;
+    const uint32_t y3 = y5 ^ y8;
+    const uint32_t t1 = x4 ^ y12;
+    const uint32_t y15 = t1 ^ x5;
+    const uint32_t y20 = t1 ^ x1;
+    const uint32_t y6 = y15 ^ x7;
+    const uint32_t y10 = y15 ^ t0;
+    const uint32_t y11 = y20 ^ y9;
+    const uint32_t y7 = x7 ^ y11;
+    const uint32_t y17 = y10 ^ y11;
+    const uint32_t y19 = y10 ^ y8;
+    const uint32_t y16 = t0 ^ y11;
+    const uint32_t y21 = y13 ^ y16;
+    const uint32_t y18 = x0 ^ y16;
+
+    // Inversion in GF(2^8)
+    const uint32_t t2 = y12 & y15;
+    const uint32_t t3 = y3 & y6;
+    const uint32_t t4 = t3 ^ t2;
+    const uint32_t t5 = y4 & x7;
+    const uint32_t t6 = t5 ^ t2;
+    const uint32_t t7 = y13 & y16;
+    const uint32_t t8 = y5 & y1;
+    const uint32_t t9 = t8 ^ t7;
+    const uint32_t t10 = y2 & y7;
+    const uint32_t t11 = t10 ^ t7;
+    const uint32_t t12 = y9 & y11;
+    const uint32_t t13 = y14 & y17;
+    const uint32_t t14 = t13 ^ t12;
+    const uint32_t t15 = y8 & y10;
+    const uint32_t t16 = t15 ^ t12;
+    const uint32_t t17 = t4 ^ t14;
+    const uint32_t t18 = t6 ^ t16;
+    const uint32_t t19 = t9 ^ t14;
+    const uint32_t t20 = t11 ^ t16;
+    const uint32_t t21 = t17 ^ y20;
+    const uint32_t t22 = t18 ^ y19;
+    const uint32_t t23 = t19 ^ y21;
+    const uint32_t t24 = t20 ^ y18;
+
+    const uint32_t t25 = t21 ^ t22;
+    const uint32_t t26 = t21 & t23;
+    const uint32_t t27 = t24 ^ t26;
+    const uint32_t t28 = t25 & t27;
+    const uint32_t t29 = t28 ^ t22;
+    const uint32_t t30 = t23 ^ t24;
+    const uint32_t t31 = t22 ^ t26;
+    const uint32_t t32 = t31 & t30;
+    const uint32_t t33 = t32 ^ t24;
+    const uint32_t t34 = t23 ^ t33;
+    const uint32_t t35 = t27 ^ t33;
+    const uint32_t t36 = t24 & t35;
+    const uint32_t t37 = t36 ^ t34;
+    const uint32_t t38 = t27 ^ t36;
+    const uint32_t t39 = t29 & t38;
+    const uint32_t t40 = t25 ^ t39;
+
+    const uint32_t t41 = t40 ^ t37;
+    const uint32_t t42 = t29 ^ t33;
+    const uint32_t t43 = t29 ^ t40;
+    const uint32_t t44 = t33 ^ t37;
+    const uint32_t t45 = t42 ^ t41;
+    const uint32_t z0 = t44 & y15;
+    const uint32_t z1 = t37 & y6;
+    const uint32_t z2 = t33 & x7;
+    const uint32_t z3 = t43 & y16;
+    const uint32_t z4 = t40 & y1;
+    const uint32_t z5 = t29 & y7;
+    const uint32_t z6 = t42 & y11;
+    const uint32_t z7 = t45 & y17;
+    const uint32_t z8 = t41 & y10;
+    const uint32_t z9 = t44 & y12;
+    const uint32_t z10 = t37 & y3;
+    const uint32_t z11 = t33 & y4;
+    const uint32_t z12 = t43 & y13;
+    const uint32_t z13 = t40 & y5;
+    const uint32_t z14 = t29 & y2;
+    const uint32_t z15 = t42 & y9;
+    const uint32_t z16 = t45 & y14;
+    const uint32_t z17 = t41 & y8;
+
+    // Bottom linear transformation
+    const uint32_t t46 = z15 ^ z16;
+    const uint32_t t47 = z10 ^ z11;
+    const uint32_t t48 = z5 ^ z13;
+    const uint32_t t49 = z9 ^ z10;
+    const uint32_t t50 = z2 ^ z12;
+    const uint32_t t51 = z2 ^ z5;
+    const uint32_t t52 = z7 ^ z8;
+    const uint32_t t53 = z0 ^ z3;
+    const uint32_t t54 = z6 ^ z7;
+    const uint32_t t55 = z16 ^ z17;
+    const uint32_t t56 = z12 ^ t48;
+    const uint32_t t57 = t50 ^ t53;
+    const uint32_t t58 = z4 ^ t46;
+    const uint32_t t59 = z3 ^ t54;
+    const uint32_t t60 = t46 ^ t57;
+    const uint32_t t61 = z14 ^ t57;
+    const uint32_t t62 = t52 ^ t58;
+    const uint32_t t63 = t49 ^ t58;
+    const uint32_t t64 = z4 ^ t59;
+    const uint32_t t65 = t61 ^ t62;
+    const uint32_t t66 = z1 ^ t63;
+    const uint32_t t67 = t64 ^ t65;
+
+    q[7] = t59 ^ t63;
+    q[4] = t53 ^ t66;
+    q[6] = t64 ^ ~q[4];
+    q[5] = t55 ^ ~t67;
+    q[3] = t51 ^ t66;
+    q[2] = t47 ^ t65;
+    q[1] = t56 ^ ~t62;
+    q[0] = t48 ^ ~t60;
+}
+
+// The inverse S-box is the S-box between two of the inverse of its affine transformation.
+static void _bitsliceInverseAffine(uint32_t* q) {
+    const uint32_t q0 = ~q[0], q1 = ~q[1], q2 = q[2], q3 = q[3], q4 = q[4], q5 = ~q[5], q6 = ~q[6], q7 = q[7];
+    q[7] = q1 ^ q4 ^ q6;
+    q[6] = q0 ^ q3 ^ q5;
+    q[5] = q7 ^ q2 ^ q4;
+    q[4] = q6 ^ q1 ^ q3;
+    q[3] = q5 ^ q0 ^ q2;
+    q[2] = q4 ^ q7 ^ q1;
+    q[1] = q3 ^ q6 ^ q0;
+    q[0] = q2 ^ q5 ^ q7;
+}
+
+static void _bitsliceInverseSubstitute(uint32_t* q) {
+    _bitsliceInverseAffine(q);
+    _bitsliceSubstitute(q);
+    _bitsliceInverseAffine(q);
+}
+
+// Rotates each half of the word right by n bits.
+static inline uint32_t _rotateHalvesRight(uint32_t x, int n) {
+    const uint32_t low = (0xffffu >> n) * 0x10001u;
+    return ((x >> n) & low) | ((x << (16 - n)) & ~low);
+}
+
+// Row r of each block rotated left by r columns, or right for the inverse.
+static void _bitsliceShiftRows(uint32_t* q, bool inverse) {
+    for (int b = 0; b < 8; ++b) {
+        const uint32_t x = q[b];
+        q[b] = (x & 0x11111111) | _rotateHalvesRight(x & 0x22222222, inverse ? 12 : 4) | _rotateHalvesRight(x & 0x44444444, 8) |
+               _rotateHalvesRight(x & 0x88888888, inverse ? 4 : 12);
+    }
+}
+
+// Each byte replaced by the one in the next row of its column, or the one two rows on.
+static inline uint32_t _nextRow(uint32_t x) {
+    return ((x >> 1) & 0x77777777) | ((x << 3) & 0x88888888);
+}
+
+static inline uint32_t _rowAfterNext(uint32_t x) {
+    return ((x >> 2) & 0x33333333) | ((x << 2) & 0xcccccccc);
+}
+
+// Every byte doubled in GF(2^8).
+static void _bitsliceDouble(const uint32_t* in, uint32_t* out) {
+    const uint32_t top = in[7];
+    out[7] = in[6];
+    out[6] = in[5];
+    out[5] = in[4];
+    out[4] = in[3] ^ top;
+    out[3] = in[2] ^ top;
+    out[2] = in[1];
+    out[1] = in[0] ^ top;
+    out[0] = top;
+}
+
+// Each byte of a column becomes 2 times itself, 3 times the next one and once each of the other two, that is twice the
+// sum with the next one, plus the other three.
+static void _bitsliceMixColumns(uint32_t* q) {
+    uint32_t sums[8];
+    uint32_t others[8];
+    for (int b = 0; b < 8; ++b) {
+        sums[b] = q[b] ^ _nextRow(q[b]);
+        others[b] = _nextRow(q[b]) ^ _rowAfterNext(sums[b]);
+    }
+    _bitsliceDouble(sums, q);
+    for (int b = 0; b < 8; ++b) {
+        q[b] ^= others[b];
+    }
+}
+
+// The inverse is the same after adding 4 times the byte two rows on to each byte.
+static void _bitsliceInverseMixColumns(uint32_t* q) {
+    uint32_t sums[8];
+    uint32_t twice[8];
+    for (int b = 0; b < 8; ++b) {
+        sums[b] = q[b] ^ _rowAfterNext(q[b]);
+    }
+    _bitsliceDouble(sums, twice);
+    _bitsliceDouble(twice, sums);
+    for (int b = 0; b < 8; ++b) {
+        q[b] ^= sums[b];
+    }
+    _bitsliceMixColumns(q);
+}
+
+static inline void _bitsliceAddRoundKey(uint32_t* q, const uint32_t* roundKey) {
+    for (int b = 0; b < 8; ++b) {
+        q[b] ^= roundKey[b];
+    }
+}
+
+static void _aesEncryptBitsliced(const AesKey* key, uint32_t* q) {
+    _bitsliceAddRoundKey(q, key->sliced[0]);
+    for (unsigned round = 1; round < key->rounds; ++round) {
+        _bitsliceSubstitute(q);
+        _bitsliceShiftRows(q, false);
+        _bitsliceMixColumns(q);
+        _bitsliceAddRoundKey(q, key->sliced[round]);
+    }
+    _bitsliceSubstitute(q);
+    _bitsliceShiftRows(q, false);
+    _bitsliceAddRoundKey(q, key->sliced[key->rounds]);
+}
+
+static void _aesDecryptBitsliced(const AesKey* key, uint32_t* q) {
+    _bitsliceAddRoundKey(q, key->sliced[key->rounds]);
+    for (unsigned round = key->rounds - 1; round > 0; --round) {
+        _bitsliceShiftRows(q, true);
+        _bitsliceInverseSubstitute(q);
+        _bitsliceAddRoundKey(q, key->sliced[round]);
+        _bitsliceInverseMixColumns(q);
+    }
+    _bitsliceShiftRows(q, true);
+    _bitsliceInverseSubstitute(q);
+    _bitsliceAddRoundKey(q, key->sliced[0]);
+}
+
+static uint32_t _substituteWord(uint32_t word) {
+    unsigned char bytes[c_aesBlockBytes] = {};
+    uint32_t q[8];
+    _storeBigEndian32(bytes, word);
+    _bitsliceLoad(q, bytes, bytes);
+    _bitsliceSubstitute(q);
+    _bitsliceStore(q, bytes, bytes);
+    word = _loadBigEndian32(bytes);
+    SecureZeroMemory(bytes, sizeof(bytes));
+    SecureZeroMemory(q, sizeof(q));
+    return word;
+}
+
+// Doubles each of the four bytes in GF(2^8) at once.
+static inline uint32_t _doubleBytes(uint32_t word) {
+    return ((word & 0x7f7f7f7f) << 1) ^ (((word >> 7) & 0x01010101) * 0x1b);
+}
+
+static uint32_t _inverseMixColumn(uint32_t word) {
+    // Each output byte is 14, 11, 13 and 9 times the bytes of the column starting from its own.
+    const uint32_t times2 = _doubleBytes(word);
+    const uint32_t times4 = _doubleBytes(times2);
+    const uint32_t times8 = _doubleBytes(times4);
+    const uint32_t times9 = times8 ^ word;
+    return (times8 ^ times4 ^ times2) ^ _rotateRight(times9 ^ times2, 24) ^ _rotateRight(times9 ^ times4, 16) ^
+           _rotateRight(times9, 8);
+}
+
+static void _aesExpandKey(AesKey* key, const unsigned char* bytes, size_t length) {
+    const size_t keyWords = length / 4;
+    key->rounds = static_cast<unsigned>(keyWords + 6);
+
+    uint32_t words[60];
+    const size_t count = 4 * (key->rounds + 1);
+    for (size_t i = 0; i < keyWords; ++i) {
+        words[i] = _loadBigEndian32(bytes + 4 * i);
+    }
+
+    uint32_t roundConstant = 1;
+    for (size_t i = keyWords; i < count; ++i) {
+        uint32_t word = words[i - 1];
+        if (i % keyWords == 0) {
+            word = _substituteWord((word << 8) | (word >> 24)) ^ (roundConstant << 24);
+            roundConstant = _doubleBytes(roundConstant);
+        } else if (keyWords > 6 && i % keyWords == 4) {
+            word = _substituteWord(word);
+        }
+        words[i] = words[i - keyWords] ^ word;
+    }
+
+    for (unsigned round = 0; round <= key->rounds; ++round) {
+        const unsigned inverse = key->rounds - round;
+        for (size_t j = 0; j < 4; ++j) {
+            const uint32_t word = words[4 * round + j];
+            _storeBigEndian32(key->encrypt[round] + 4 * j, word);
+            _storeBigEndian32(key->decrypt[inverse] + 4 * j, (round == 0 || inverse == 0) ? word : _inverseMixColumn(word));
+        }
+        _bitsliceLoad(key->sliced[round], key->encrypt[round], key->encrypt[round]);
+    }
+
+    SecureZeroMemory(words, sizeof(words));
+}
+
+static void _aesEncryptEcbPortable(const AesKey* key, const unsigned char* in, unsigned char* out, size_t blocks) {
+    uint32_t q[8];
+    while (blocks > 0) {
+        const size_t pair = std::min<size_t>(blocks, 2);
+        _bitsliceLoad(q, in, in + c_aesBlockBytes * (pair - 1));
+        _aesEncryptBitsliced(key, q);
+        _bitsliceStore(q, out, out + c_aesBlockBytes * (pair - 1));
+        in += c_aesBlockBytes * pair;
+        out += c_aesBlockBytes * pair;
+        blocks -= pair;
+    }
+    SecureZeroMemory(q, sizeof(q));
+}
+
+static void _aesDecryptEcbPortable(const AesKey* key, const unsigned char* in, unsigned char* out, size_t blocks) {
+    uint32_t q[8];
+    while (blocks > 0) {
+        const size_t pair = std::min<size_t>(blocks, 2);
+        _bitsliceLoad(q, in, in + c_aesBlockBytes * (pair - 1));
+        _aesDecryptBitsliced(key, q);
+        _bitsliceStore(q, out, out + c_aesBlockBytes * (pair - 1));
+        in += c_aesBlockBytes * pair;
+        out += c_aesBlockBytes * pair;
+        blocks -= pair;
+    }
+    SecureZeroMemory(q, sizeof(q));
+}
+
+// Each block needs the one before it, so these go through the cipher one at a time, in both halves.
+static void _aesEncryptCbcPortable(const AesKey* key, unsigned char* iv, const unsigned char* in, unsigned char* out, size_t blocks) {
+    uint32_t q[8];
+    unsigned char chain[c_aesBlockBytes];
+    memcpy(chain, iv, c_aesBlockBytes);
+    for (; blocks > 0; --blocks, in += c_aesBlockBytes, out += c_aesBlockBytes) {
+        _xorBlock(chain, chain, in);
+        _bitsliceLoad(q, chain, chain);
+        _aesEncryptBitsliced(key, q);
+        _bitsliceStore(q, chain, chain);
+        memcpy(out, chain, c_aesBlockBytes);
+    }
+    memcpy(iv, chain, c_aesBlockBytes);
+    SecureZeroMemory(q, sizeof(q));
+}
+
+static void _aesDecryptCbcPortable(const AesKey* key, unsigned char* iv, const unsigned char* in, unsigned char* out, size_t blocks) {
+    uint32_t q[8];
+    unsigned char previous[c_aesBlockBytes];
+    unsigned char ciphertext[2][c_aesBlockBytes];
+    unsigned char plaintext[2][c_aesBlockBytes];
+    memcpy(previous, iv, c_aesBlockBytes);
+    while (blocks > 0) {
+        const size_t pair = std::min<size_t>(blocks, 2);
+        memcpy(ciphertext, in, c_aesBlockBytes * pair);
+        _bitsliceLoad(q, ciphertext[0], ciphertext[pair - 1]);
+        _aesDecryptBitsliced(key, q);
+        _bitsliceStore(q, plaintext[0], plaintext[1]);
+        _xorBlock(out, plaintext[0], previous);
+        if (pair == 2) {
+            _xorBlock(out + c_aesBlockBytes, plaintext[1], ciphertext[0]);
+        }
+        memcpy(previous, ciphertext[pair - 1], c_aesBlockBytes);
+        in += c_aesBlockBytes * pair;
+        out += c_aesBlockBytes * pair;
+        blocks -= pair;
+    }
+    memcpy(iv, previous, c_aesBlockBytes);
+    SecureZeroMemory(q, sizeof(q));
+    SecureZeroMemory(plaintext, sizeof(plaintext));
+}
+
+// XORs in the encrypted counter blocks, stepping the counter's last 32 bits (big-endian) as GCM does.
+static void _aesCtr32Portable(const AesKey* key, unsigned char* counter, const unsigned char* in, unsigned char* out, size_t blocks) {
+    uint32_t q[8];
+    unsigned char counters[2][c_aesBlockBytes];
+    unsigned char keystream[2][c_aesBlockBytes];
+    uint32_t low = _loadBigEndian32(counter + 12);
+    while (blocks > 0) {
+        const size_t pair = std::min<size_t>(blocks, 2);
+        memcpy(counters[0], counter, c_aesBlockBytes);
+        memcpy(counters[1], counter, c_aesBlockBytes);
+        _storeBigEndian32(counters[1] + 12, low + 1);
+        _bitsliceLoad(q, counters[0], counters[1]);
+        _aesEncryptBitsliced(key, q);
+        _bitsliceStore(q, keystream[0], keystream[1]);
+        for (size_t i = 0; i < pair; ++i) {
+            _xorBlock(out + c_aesBlockBytes * i, in + c_aesBlockBytes * i, keystream[i]);
+        }
+        low += static_cast<uint32_t>(pair);
+        _storeBigEndian32(counter + 12, low);
+        in += c_aesBlockBytes * pair;
+        out += c_aesBlockBytes * pair;
+        blocks -= pair;
+    }
+    SecureZeroMemory(q, sizeof(q));
+    SecureZeroMemory(keystream, sizeof(keystream));
+}
+
+static void _ghashInitPortable(GcmKey* gcm, const unsigned char* h) {
+    gcm->high = _loadBigEndian64(h);
+    gcm->low = _loadBigEndian64(h + 8);
+}
+
+// The low 64 bits of the carry-less product of x and y. Each multiplication takes every fourth bit of both, so no more
+// than 15 partial products meet in a bit that is kept, and their carries go into the three bits after it, which are not.
+static inline uint64_t _carrylessMultiply(uint64_t x, uint64_t y) {
+    const uint64_t m0 = 0x1111111111111111ULL;
+    const uint64_t m1 = m0 << 1;
+    const uint64_t m2 = m0 << 2;
+    const uint64_t m3 = m0 << 3;
+    const uint64_t x0 = x & m0, x1 = x & m1, x2 = x & m2, x3 = x & m3;
+    const uint64_t y0 = y & m0, y1 = y & m1, y2 = y & m2, y3 = y & m3;
+    const uint64_t z0 = (x0 * y0) ^ (x1 * y3) ^ (x2 * y2) ^ (x3 * y1);
+    const uint64_t z1 = (x0 * y1) ^ (x1 * y0) ^ (x2 * y3) ^ (x3 * y2);
+    const uint64_t z2 = (x0 * y2) ^ (x1 * y1) ^ (x2 * y0) ^ (x3 * y3);
+    const uint64_t z3 = (x0 * y3) ^ (x1 * y2) ^ (x2 * y1) ^ (x3 * y0);
+    return (z0 & m0) | (z1 & m1) | (z2 & m2) | (z3 & m3);
+}
+
+static inline uint64_t _reverseBits(uint64_t x) {
+    x = ((x & 0x5555555555555555ULL) << 1) | ((x >> 1) & 0x5555555555555555ULL);
+    x = ((x & 0x3333333333333333ULL) << 2) | ((x >> 2) & 0x3333333333333333ULL);
+    x = ((x & 0x0f0f0f0f0f0f0f0fULL) << 4) | ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL);
+    x = ((x & 0x00ff00ff00ff00ffULL) << 8) | ((x >> 8) & 0x00ff00ff00ff00ffULL);
+    x = ((x & 0x0000ffff0000ffffULL) << 16) | ((x >> 16) & 0x0000ffff0000ffffULL);
+    return (x << 32) | (x >> 32);
+}
+
+// tag = (tag ^ block) * H for each block. GCM's bits run from the most significant down, so the product is of the
+// halves with their bits in order, by Karatsuba; the high half of each 128-bit product is the low half of the product
+// of the reversed factors, reversed. The 256-bit result is shifted and reduced as in Intel's carry-less multiplication
+// white paper.
+static void _ghashPortable(const GcmKey* gcm, unsigned char* tag, const unsigned char* data, size_t blocks) {
+    const uint64_t h1 = gcm->high, h0 = gcm->low, h2 = h0 ^ h1;
+    const uint64_t h1r = _reverseBits(h1), h0r = _reverseBits(h0), h2r = h0r ^ h1r;
+    uint64_t y1 = _loadBigEndian64(tag);
+    uint64_t y0 = _loadBigEndian64(tag + 8);
+    for (; blocks > 0; --blocks, data += c_aesBlockBytes) {
+        y1 ^= _loadBigEndian64(data);
+        y0 ^= _loadBigEndian64(data + 8);
+        const uint64_t y2 = y0 ^ y1;
+        const uint64_t y1r = _reverseBits(y1), y0r = _reverseBits(y0), y2r = y0r ^ y1r;
+
+        const uint64_t z0 = _carrylessMultiply(y0, h0);
+        const uint64_t z1 = _carrylessMultiply(y1, h1);
+        const uint64_t z2 = _carrylessMultiply(y2, h2) ^ z0 ^ z1;
+        const uint64_t z0h = _reverseBits(_carrylessMultiply(y0r, h0r)) >> 1;
+        const uint64_t z1h = _reverseBits(_carrylessMultiply(y1r, h1r)) >> 1;
+        const uint64_t z2h = (_reverseBits(_carrylessMultiply(y2r, h2r)) >> 1) ^ z0h ^ z1h;
+
+        uint64_t v0 = z0;
+        uint64_t v1 = z0h ^ z2;
+        uint64_t v2 = z1 ^ z2h;
+        uint64_t v3 = z1h;
+
+        v3 = (v3 << 1) | (v2 >> 63);
+        v2 = (v2 << 1) | (v1 >> 63);
+        v1 = (v1 << 1) | (v0 >> 63);
+        v0 = v0 << 1;
+
+        v2 ^= v0 ^ (v0 >> 1) ^ (v0 >> 2) ^ (v0 >> 7);
+        v1 ^= (v0 << 63) ^ (v0 << 62) ^ (v0 << 57);
+        v3 ^= v1 ^ (v1 >> 1) ^ (v1 >> 2) ^ (v1 >> 7);
+        v2 ^= (v1 << 63) ^ (v1 << 62) ^ (v1 << 57);
+
+        y0 = v2;
+        y1 = v3;
+    }
+    _storeBigEndian64(tag, y1);
+    _storeBigEndian64(tag + 8, y0);
+}
+
+#if CRYPTOR_X86
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("aes,pclmul,sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("aes,pclmul,sse4.1")
+#endif
+
+namespace aesni {
+
+// Independent blocks go through the rounds side by side: aesenc starts every cycle or two but takes several to finish.
+static const size_t c_parallelBlocks = 8;
+
+static inline void loadKeys(const unsigned char (*roundKeys)[16], unsigned rounds, __m128i* keys) {
+    for (unsigned round = 0; round <= rounds; ++round) {
+        keys[round] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(roundKeys[round]));
+    }
+}
+
+template <size_t N>
+static inline void encrypt(__m128i* blocks, const __m128i* keys, unsigned rounds) {
+    for (size_t i = 0; i < N; ++i) {
+        blocks[i] = _mm_xor_si128(blocks[i], keys[0]);
+    }
+    for (unsigned round = 1; round < rounds; ++round) {
+        for (size_t i = 0; i < N; ++i) {
+            blocks[i] = _mm_aesenc_si128(blocks[i], keys[round]);
+        }
+    }
+    for (size_t i = 0; i < N; ++i) {
+        blocks[i] = _mm_aesenclast_si128(blocks[i], keys[rounds]);
+    }
+}
+
+template <size_t N>
+static inline void decrypt(__m128i* blocks, const __m128i* keys, unsigned rounds) {
+    for (size_t i = 0; i < N; ++i) {
+        blocks[i] = _mm_xor_si128(blocks[i], keys[0]);
+    }
+    for (unsigned round = 1; round < rounds; ++round) {
+        for (size_t i = 0; i < N; ++i) {
+            blocks[i] = _mm_aesdec_si128(blocks[i], keys[round]);
+        }
+    }
+    for (size_t i = 0; i < N; ++i) {
+        blocks[i] = _mm_aesdeclast_si128(blocks[i], keys[rounds]);
+    }
+}
+
+static inline __m128i load(const unsigned char* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+static inline void store(unsigned char* p, __m128i value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), value);
+}
+
+static void encryptEcb(const AesKey* key, const unsigned char* in, unsigned char* out, size_t blocks) {
+    const unsigned rounds = key->rounds;
+    __m128i keys[15];
+    loadKeys(key->encrypt, rounds, keys);
+    for (; blocks >= c_parallelBlocks; blocks -= c_parallelBlocks) {
+        __m128i b[c_parallelBlocks];
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            b[i] = load(in + 16 * i);
+        }
+        encrypt<c_parallelBlocks>(b, keys, rounds);
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            store(out + 16 * i, b[i]);
+        }
+        in += 16 * c_parallelBlocks;
+        out += 16 * c_parallelBlocks;
+    }
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        __m128i b = load(in);
+        encrypt<1>(&b, keys, rounds);
+        store(out, b);
+    }
+}
+
+static void decryptEcb(const AesKey* key, const unsigned char* in, unsigned char* out, size_t blocks) {
+    const unsigned rounds = key->rounds;
+    __m128i keys[15];
+    loadKeys(key->decrypt, rounds, keys);
+    for (; blocks >= c_parallelBlocks; blocks -= c_parallelBlocks) {
+        __m128i b[c_parallelBlocks];
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            b[i] = load(in + 16 * i);
+        }
+        decrypt<c_parallelBlocks>(b, keys, rounds);
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            store(out + 16 * i, b[i]);
+        }
+        in += 16 * c_parallelBlocks;
+        out += 16 * c_parallelBlocks;
+    }
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        __m128i b = load(in);
+        decrypt<1>(&b, keys, rounds);
+        store(out, b);
+    }
+}
+
+// Each block needs the one before it, so CBC encryption is the one mode that can't overlap blocks.
+static void encryptCbc(const AesKey* key, unsigned char* iv, const unsigned char* in, unsigned char* out, size_t blocks) {
+    const unsigned rounds = key->rounds;
+    __m128i keys[15];
+    loadKeys(key->encrypt, rounds, keys);
+    __m128i chain = load(iv);
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        chain = _mm_xor_si128(chain, load(in));
+        encrypt<1>(&chain, keys, rounds);
+        store(out, chain);
+    }
+    store(iv, chain);
+}
+
+static void decryptCbc(const AesKey* key, unsigned char* iv, const unsigned char* in, unsigned char* out, size_t blocks) {
+    const unsigned rounds = key->rounds;
+    __m128i keys[15];
+    loadKeys(key->decrypt, rounds, keys);
+    __m128i previous = load(iv);
+    for (; blocks >= c_parallelBlocks; blocks -= c_parallelBlocks) {
+        __m128i ciphertext[c_parallelBlocks];
+        __m128i b[c_parallelBlocks];
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            ciphertext[i] = load(in + 16 * i);
+            b[i] = ciphertext[i];
+        }
+        decrypt<c_parallelBlocks>(b, keys, rounds);
+        store(out, _mm_xor_si128(b[0], previous));
+        for (size_t i = 1; i < c_parallelBlocks; ++i) {
+            store(out + 16 * i, _mm_xor_si128(b[i], ciphertext[i - 1]));
+        }
+        previous = ciphertext[c_parallelBlocks - 1];
+        in += 16 * c_parallelBlocks;
+        out += 16 * c_parallelBlocks;
+    }
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        const __m128i ciphertext = load(in);
+        __m128i b = ciphertext;
+        decrypt<1>(&b, keys, rounds);
+        store(out, _mm_xor_si128(b, previous));
+        previous = ciphertext;
+    }
+    store(iv, previous);
+}
+
+static void ctr32(const AesKey* key, unsigned char* counter, const unsigned char* in, unsigned char* out, size_t blocks) {
+    const unsigned rounds = key->rounds;
+    __m128i keys[15];
+    loadKeys(key->encrypt, rounds, keys);
+
+    // Byte-swapping the last word turns it into a lane that _mm_add_epi32 can step.
+    const __m128i swapLastWord = _mm_set_epi8(12, 13, 14, 15, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    __m128i next = _mm_shuffle_epi8(load(counter), swapLastWord);
+    for (; blocks >= c_parallelBlocks; blocks -= c_parallelBlocks) {
+        __m128i b[c_parallelBlocks];
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            b[i] = _mm_shuffle_epi8(_mm_add_epi32(next, _mm_set_epi32(static_cast<int>(i), 0, 0, 0)), swapLastWord);
+        }
+        next = _mm_add_epi32(next, _mm_set_epi32(static_cast<int>(c_parallelBlocks), 0, 0, 0));
+        encrypt<c_parallelBlocks>(b, keys, rounds);
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            store(out + 16 * i, _mm_xor_si128(b[i], load(in + 16 * i)));
+        }
+        in += 16 * c_parallelBlocks;
+        out += 16 * c_parallelBlocks;
+    }
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        __m128i b = _mm_shuffle_epi8(next, swapLastWord);
+        next = _mm_add_epi32(next, _mm_set_epi32(1, 0, 0, 0));
+        encrypt<1>(&b, keys, rounds);
+        store(out, _mm_xor_si128(b, load(in)));
+    }
+    store(counter, _mm_shuffle_epi8(next, swapLastWord));
+}
+
+// GHASH on byte-reversed blocks (Intel's carry-less multiplication white paper, algorithms 2 and 5): the 256-bit
+// products are summed, and only the sum reduced.
+static inline void multiply(__m128i a, __m128i b, __m128i& low, __m128i& high) {
+    const __m128i middle = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+    low = _mm_xor_si128(low, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x00), _mm_slli_si128(middle, 8)));
+    high = _mm_xor_si128(high, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x11), _mm_srli_si128(middle, 8)));
+}
+
+static inline __m128i reduce(__m128i low, __m128i high) {
+    // The bit-reflected product is one bit short: shift all 256 bits left by one.
+    const __m128i lowCarry = _mm_srli_epi32(low, 31);
+    const __m128i highCarry = _mm_srli_epi32(high, 31);
+    low = _mm_or_si128(_mm_slli_epi32(low, 1), _mm_slli_si128(lowCarry, 4));
+    high = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(high, 1), _mm_slli_si128(highCarry, 4)), _mm_srli_si128(lowCarry, 12));
+
+    // Then fold the low half in modulo x^128 + x^7 + x^2 + x + 1.
+    __m128i fold = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(low, 31), _mm_slli_epi32(low, 30)), _mm_slli_epi32(low, 25));
+    const __m128i foldHigh = _mm_srli_si128(fold, 4);
+    low = _mm_xor_si128(low, _mm_slli_si128(fold, 12));
+    fold = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(low, 1), _mm_srli_epi32(low, 2)), _mm_srli_epi32(low, 7));
+    fold = _mm_xor_si128(fold, foldHigh);
+    return _mm_xor_si128(high, _mm_xor_si128(low, fold));
+}
+
+static inline __m128i reverseBytes(__m128i value) {
+    return _mm_shuffle_epi8(value, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+static void ghashInit(GcmKey* gcm, const unsigned char* h) {
+    const __m128i h1 = reverseBytes(load(h));
+    __m128i power = h1;
+    store(gcm->powers[0], power);
+    for (size_t i = 1; i < 4; ++i) {
+        __m128i low = _mm_setzero_si128();
+        __m128i high = _mm_setzero_si128();
+        multiply(power, h1, low, high);
+        power = reduce(low, high);
+        store(gcm->powers[i], power);
+    }
+}
+
+static void ghash(const GcmKey* gcm, unsigned char* tag, const unsigned char* data, size_t blocks) {
+    const __m128i h1 = load(gcm->powers[0]);
+    const __m128i h2 = load(gcm->powers[1]);
+    const __m128i h3 = load(gcm->powers[2]);
+    const __m128i h4 = load(gcm->powers[3]);
+    __m128i x = reverseBytes(load(tag));
+
+    // (((x + b0)H + b1)H + b2)H + b3)H = (x + b0)H^4 + b1 H^3 + b2 H^2 + b3 H: four independent multiplies.
+    for (; blocks >= 4; blocks -= 4, data += 64) {
+        __m128i low = _mm_setzero_si128();
+        __m128i high = _mm_setzero_si128();
+        multiply(_mm_xor_si128(x, reverseBytes(load(data))), h4, low, high);
+        multiply(reverseBytes(load(data + 16)), h3, low, high);
+        multiply(reverseBytes(load(data + 32)), h2, low, high);
+        multiply(reverseBytes(load(data + 48)), h1, low, high);
+        x = reduce(low, high);
+    }
+    for (; blocks > 0; --blocks, data += 16) {
+        __m128i low = _mm_setzero_si128();
+        __m128i high = _mm_setzero_si128();
+        multiply(_mm_xor_si128(x, reverseBytes(load(data))), h1, low, high);
+        x = reduce(low, high);
+    }
+
+    store(tag, reverseBytes(x));
+}
+
+} // namespace aesni
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+static void _cpuid(int leaf, int registers[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    __cpuidex(registers, leaf, 0);
+#else
+    unsigned int eax, ebx, ecx, edx;
+    __cpuid_count(leaf, 0, eax, ebx, ecx, edx);
+    registers[0] = eax;
+    registers[1] = ebx;
+    registers[2] = ecx;
+    registers[3] = edx;
+#endif
+}
+
+static bool _hasAESNI() {
+    // AES, PCLMULQDQ and SSE4.1
+    int registers[4];
+    _cpuid(1, registers);
+    const int required = (1 << 25) | (1 << 1) | (1 << 19);
+    return (registers[2] & required) == required;
+}
+
+#elif CRYPTOR_ARM64
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("crypto"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("+crypto")
+#endif
+
+namespace aesInstructions {
+
+static const size_t c_parallelBlocks = 4;
+
+static inline void loadKeys(const unsigned char (*roundKeys)[16], unsigned rounds, uint8x16_t* keys) {
+    for (unsigned round = 0; round <= rounds; ++round) {
+        keys[round] = vld1q_u8(roundKeys[round]);
+    }
+}
+
+// aese adds the round key before substituting, so the last key is added on its own.
+template <size_t N>
+static inline void encrypt(uint8x16_t* blocks, const uint8x16_t* keys, unsigned rounds) {
+    for (unsigned round = 0; round + 1 < rounds; ++round) {
+        for (size_t i = 0; i < N; ++i) {
+            blocks[i] = vaesmcq_u8(vaeseq_u8(blocks[i], keys[round]));
+        }
+    }
+    for (size_t i = 0; i < N; ++i) {
+        blocks[i] = veorq_u8(vaeseq_u8(blocks[i], keys[rounds - 1]), keys[rounds]);
+    }
+}
+
+template <size_t N>
+static inline void decrypt(uint8x16_t* blocks, const uint8x16_t* keys, unsigned rounds) {
+    for (unsigned round = 0; round + 1 < rounds; ++round) {
+        for (size_t i = 0; i < N; ++i) {
+            blocks[i] = vaesimcq_u8(vaesdq_u8(blocks[i], keys[round]));
+        }
+    }
+    for (size_t i = 0; i < N; ++i) {
+        blocks[i] = veorq_u8(vaesdq_u8(blocks[i], keys[rounds - 1]), keys[rounds]);
+    }
+}
+
+static void encryptEcb(const AesKey* key, const unsigned char* in, unsigned char* out, size_t blocks) {
+    const unsigned rounds = key->rounds;
+    uint8x16_t keys[15];
+    loadKeys(key->encrypt, rounds, keys);
+    for (; blocks >= c_parallelBlocks; blocks -= c_parallelBlocks) {
+        uint8x16_t b[c_parallelBlocks];
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            b[i] = vld1q_u8(in + 16 * i);
+        }
+        encrypt<c_parallelBlocks>(b, keys, rounds);
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            vst1q_u8(out + 16 * i, b[i]);
+        }
+        in += 16 * c_parallelBlocks;
+        out += 16 * c_parallelBlocks;
+    }
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        uint8x16_t b = vld1q_u8(in);
+        encrypt<1>(&b, keys, rounds);
+        vst1q_u8(out, b);
+    }
+}
+
+static void decryptEcb(const AesKey* key, const unsigned char* in, unsigned char* out, size_t blocks) {
+    const unsigned rounds = key->rounds;
+    uint8x16_t keys[15];
+    loadKeys(key->decrypt, rounds, keys);
+    for (; blocks >= c_parallelBlocks; blocks -= c_parallelBlocks) {
+        uint8x16_t b[c_parallelBlocks];
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            b[i] = vld1q_u8(in + 16 * i);
+        }
+        decrypt<c_parallelBlocks>(b, keys, rounds);
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            vst1q_u8(out + 16 * i, b[i]);
+        }
+        in += 16 * c_parallelBlocks;
+        out += 16 * c_parallelBlocks;
+    }
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        uint8x16_t b = vld1q_u8(in);
+        decrypt<1>(&b, keys, rounds);
+        vst1q_u8(out, b);
+    }
+}
+
+static void encryptCbc(const AesKey* key, unsigned char* iv, const unsigned char* in, unsigned char* out, size_t blocks) {
+    const unsigned rounds = key->rounds;
+    uint8x16_t keys[15];
+    loadKeys(key->encrypt, rounds, keys);
+    uint8x16_t chain = vld1q_u8(iv);
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        chain = veorq_u8(chain, vld1q_u8(in));
+        encrypt<1>(&chain, keys, rounds);
+        vst1q_u8(out, chain);
+    }
+    vst1q_u8(iv, chain);
+}
+
+static void decryptCbc(const AesKey* key, unsigned char* iv, const unsigned char* in, unsigned char* out, size_t blocks) {
+    const unsigned rounds = key->rounds;
+    uint8x16_t keys[15];
+    loadKeys(key->decrypt, rounds, keys);
+    uint8x16_t previous = vld1q_u8(iv);
+    for (; blocks >= c_parallelBlocks; blocks -= c_parallelBlocks) {
+        uint8x16_t ciphertext[c_parallelBlocks];
+        uint8x16_t b[c_parallelBlocks];
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            ciphertext[i] = vld1q_u8(in + 16 * i);
+            b[i] = ciphertext[i];
+        }
+        decrypt<c_parallelBlocks>(b, keys, rounds);
+        vst1q_u8(out, veorq_u8(b[0], previous));
+        for (size_t i = 1; i < c_parallelBlocks; ++i) {
+            vst1q_u8(out + 16 * i, veorq_u8(b[i], ciphertext[i - 1]));
+        }
+        previous = ciphertext[c_parallelBlocks - 1];
+        in += 16 * c_parallelBlocks;
+        out += 16 * c_parallelBlocks;
+    }
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        const uint8x16_t ciphertext = vld1q_u8(in);
+        uint8x16_t b = ciphertext;
+        decrypt<1>(&b, keys, rounds);
+        vst1q_u8(out, veorq_u8(b, previous));
+        previous = ciphertext;
+    }
+    vst1q_u8(iv, previous);
+}
+
+static void ctr32(const AesKey* key, unsigned char* counter, const unsigned char* in, unsigned char* out, size_t blocks) {
+    const unsigned rounds = key->rounds;
+    uint8x16_t keys[15];
+    loadKeys(key->encrypt, rounds, keys);
+
+    unsigned char block[16];
+    memcpy(block, counter, 16);
+    uint32_t low = _loadBigEndian32(counter + 12);
+    for (; blocks >= c_parallelBlocks; blocks -= c_parallelBlocks) {
+        uint8x16_t b[c_parallelBlocks];
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            _storeBigEndian32(block + 12, low++);
+            b[i] = vld1q_u8(block);
+        }
+        encrypt<c_parallelBlocks>(b, keys, rounds);
+        for (size_t i = 0; i < c_parallelBlocks; ++i) {
+            vst1q_u8(out + 16 * i, veorq_u8(b[i], vld1q_u8(in + 16 * i)));
+        }
+        in += 16 * c_parallelBlocks;
+        out += 16 * c_parallelBlocks;
+    }
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        _storeBigEndian32(block + 12, low++);
+        uint8x16_t b = vld1q_u8(block);
+        encrypt<1>(&b, keys, rounds);
+        vst1q_u8(out, veorq_u8(b, vld1q_u8(in)));
+    }
+    _storeBigEndian32(counter + 12, low);
+}
+
+} // namespace aesInstructions
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+static bool _hasAESInstructions() {
+    return IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) != FALSE;
+}
+
+#endif
+
+// The block functions for this processor. in and out may be the same buffer; iv and counter are updated for the next
+// call.
+struct AesEngine {
+    void (*encryptEcb)(const AesKey* key, const unsigned char* in, unsigned char* out, size_t blocks);
+    void (*decryptEcb)(const AesKey* key, const unsigned char* in, unsigned char* out, size_t blocks);
+    void (*encryptCbc)(const AesKey* key, unsigned char* iv, const unsigned char* in, unsigned char* out, size_t blocks);
+    void (*decryptCbc)(const AesKey* key, unsigned char* iv, const unsigned char* in, unsigned char* out, size_t blocks);
+    void (*ctr32)(const AesKey* key, unsigned char* counter, const unsigned char* in, unsigned char* out, size_t blocks);
+    void (*ghashInit)(GcmKey* gcm, const unsigned char* h);
+    void (*ghash)(const GcmKey* gcm, unsigned char* tag, const unsigned char* data, size_t blocks);
+};
+
+static AesEngine _detectAesEngine() {
+    AesEngine engine = { _aesEncryptEcbPortable, _aesDecryptEcbPortable, _aesEncryptCbcPortable, _aesDecryptCbcPortable,
+                         _aesCtr32Portable,      _ghashInitPortable,     _ghashPortable };
+#if CRYPTOR_X86
+    if (_hasAESNI()) {
+        engine = { aesni::encryptEcb, aesni::decryptEcb, aesni::encryptCbc, aesni::decryptCbc,
+                   aesni::ctr32,      aesni::ghashInit,  aesni::ghash };
+    }
+#elif CRYPTOR_ARM64
+    if (_hasAESInstructions()) {
+        engine.encryptEcb = aesInstructions::encryptEcb;
+        engine.decryptEcb = aesInstructions::decryptEcb;
+        engine.encryptCbc = aesInstructions::encryptCbc;
+        engine.decryptCbc = aesInstructions::decryptCbc;
+        engine.ctr32 = aesInstructions::ctr32;
+    }
+#endif
+    return engine;
+}
+
+static const AesEngine& _aesEngine() {
+    static const AesEngine s_engine = _detectAesEngine();
+    return s_engine;
+}
+
+// kCCModeCTR steps the whole block as a big-endian counter; the engines only step its last word, so the carry out of
+// that is done here.
+static void _aesCtr(const AesKey* key, unsigned char* counter, const unsigned char* in, unsigned char* out, size_t blocks) {
+    const AesEngine& engine = _aesEngine();
+    while (blocks > 0) {
+        const uint64_t untilCarry = 0x100000000ULL - _loadBigEndian32(counter + 12);
+        const size_t run = static_cast<size_t>(std::min<uint64_t>(blocks, untilCarry));
+        engine.ctr32(key, counter, in, out, run);
+        in += c_aesBlockBytes * run;
+        out += c_aesBlockBytes * run;
+        blocks -= run;
+        if (run == untilCarry) {
+            for (int i = 11; i >= 0 && ++counter[i] == 0; --i) {
+            }
+        }
+    }
+}
+
+static bool _isAesKeyLength(size_t keyLength) {
+    return keyLength == kCCKeySizeAES128 || keyLength == kCCKeySizeAES192 || keyLength == kCCKeySizeAES256;
+}
+
+static bool _overlaps(const void* a, size_t aLength, const void* b, size_t bLength) {
+    const uintptr_t aStart = reinterpret_cast<uintptr_t>(a);
+    const uintptr_t bStart = reinterpret_cast<uintptr_t>(b);
+    return aLength > 0 && bLength > 0 && aStart < bStart + bLength && bStart < aStart + aLength;
+}
+
+// A cryptor made by CCCryptorCreate and friends: AesCryptor for AES, WinRTCryptor for everything else.
+struct CC_Cryptor_State {
+    virtual ~CC_Cryptor_State() {
+    }
+
+    virtual CCCryptorStatus update(const void* dataIn, size_t dataInLength, void* dataOut, size_t dataOutAvailable, size_t* dataOutMoved) = 0;
+    virtual CCCryptorStatus final(void* dataOut, size_t dataOutAvailable, size_t* dataOutMoved) = 0;
+    virtual CCCryptorStatus reset(const void* iv) = 0;
+    virtual size_t outputLength(size_t inputLength, bool final) = 0;
+};
+
 static CCCryptorStatus _cryptorStatusFromHRESULT(HRESULT result) {
     switch (result) {
         case E_INVALIDARG:
@@ -59,8 +1191,8 @@ static CCCryptorStatus _cryptorStatusFromHRESULT(HRESULT result) {
     return result;
 }
 
-struct CC_Cryptor_State {
-    CC_Cryptor_State(CCOperation op, CCAlgorithm alg, CCOptions options, const void* key, size_t keyLength, const void* iv)
+struct WinRTCryptor : public CC_Cryptor_State {
+    WinRTCryptor(CCOperation op, CCAlgorithm alg, CCOptions options, const void* key, size_t keyLength, const void* iv)
         : _op(op),
           _alg(alg),
           _options(options),
@@ -79,13 +1211,13 @@ struct CC_Cryptor_State {
         }
     }
 
-    ~CC_Cryptor_State() {
+    ~WinRTCryptor() override {
     }
 
-    static std::unique_ptr<CC_Cryptor_State> init(
+    static std::unique_ptr<WinRTCryptor> init(
         CCOperation op, CCAlgorithm alg, CCOptions options, const void* key, size_t keyLength, const void* iv, CCCryptorStatus* statusOut) {
 
-        std::unique_ptr<CC_Cryptor_State> pState = std::make_unique<CC_Cryptor_State>(op, alg, options, key, keyLength, iv);
+        std::unique_ptr<WinRTCryptor> pState = std::make_unique<WinRTCryptor>(op, alg, options, key, keyLength, iv);
 
         HRESULT initResult = pState->_init();
         if (FAILED(initResult)) {
@@ -97,15 +1229,15 @@ struct CC_Cryptor_State {
         return pState;
     }
 
-    CCCryptorStatus update(const void* dataIn, size_t dataInLength, void* dataOut, size_t dataOutAvailable, size_t* dataOutMoved) {
+    CCCryptorStatus update(const void* dataIn, size_t dataInLength, void* dataOut, size_t dataOutAvailable, size_t* dataOutMoved) override {
         return _cryptorStatusFromHRESULT(_update(dataIn, dataInLength, dataOut, dataOutAvailable, dataOutMoved));
     }
 
-    CCCryptorStatus final(void* dataOut, size_t dataOutAvailable, size_t* dataOutMoved) {
+    CCCryptorStatus final(void* dataOut, size_t dataOutAvailable, size_t* dataOutMoved) override {
         return _cryptorStatusFromHRESULT(_final(dataOut, dataOutAvailable, dataOutMoved));
     }
 
-    CCCryptorStatus reset(const void* iv) {
+    CCCryptorStatus reset(const void* iv) override {
         _iv = iv;
         _ivBuffer = nullptr;
         _inputBuffer.clear();
@@ -119,39 +1251,7 @@ struct CC_Cryptor_State {
         return kCCSuccess;
     }
 
-    static CCCryptorStatus oneShot(CCOperation op,
-                                   CCAlgorithm alg,
-                                   CCOptions options,
-                                   const void* key,
-                                   size_t keyLength,
-                                   const void* iv,
-                                   const void* dataIn,
-                                   size_t dataInLength,
-                                   void* dataOut,
-                                   size_t dataOutAvailable,
-                                   size_t* dataOutMoved) {
-        CCCryptorStatus status;
-        *dataOutMoved = 0;
-
-        std::unique_ptr<CC_Cryptor_State> pState = CC_Cryptor_State::init(op, alg, options, key, keyLength, iv, &status);
-        if (status != kCCSuccess) {
-            return status;
-        }
-
-        size_t dataMoved1 = 0;
-        status = pState->update(dataIn, dataInLength, dataOut, dataOutAvailable, &dataMoved1);
-        *dataOutMoved = dataMoved1;
-        if (status != kCCSuccess) {
-            return status;
-        }
-
-        size_t dataMoved2 = 0;
-        status = pState->final((uint8_t*)dataOut + dataMoved1, dataOutAvailable - dataMoved1, &dataMoved2);
-        *dataOutMoved = dataMoved1 + dataMoved2;
-        return status;
-    }
-
-    size_t outputLength(size_t inputLength, bool final) {
+    size_t outputLength(size_t inputLength, bool final) override {
         // For stream ciphers, the output size is always equal to the input size. For block ciphers, the output size will always be less
         // than or equal to the input size plus the size of one block
 
@@ -391,9 +1491,14 @@ private:
         RETURN_IF_FAILED_LOG(dataOutBuffer.As(&bufferAccess));
         BYTE* pRawOutput;
         RETURN_IF_FAILED_LOG(bufferAccess->Buffer(&pRawOutput));
-        memcpy_s(dataOut, dataOutAvailable, pRawOutput, dataOutSize);
 
-        *dataOutMoved = dataOutSize;
+        // Decrypting with padding hands back less than went in
+        UINT32 rawOutputLength;
+        RETURN_IF_FAILED_LOG(dataOutBuffer->get_Length(&rawOutputLength));
+        const size_t dataProduced = std::min<size_t>(rawOutputLength, dataOutSize);
+        memcpy_s(dataOut, dataOutAvailable, pRawOutput, dataProduced);
+
+        *dataOutMoved = dataProduced;
 
         // If this is the final operation, we are done
         if (final) {
@@ -472,6 +1577,412 @@ private:
     std::vector<uint8_t> _inputBuffer;
 };
 
+
+// AES in ECB, CBC or CTR mode, working on the caller's buffers: only a partial block is kept between updates.
+struct AesCryptor : public CC_Cryptor_State {
+    AesCryptor() : _op(kCCEncrypt), _mode(kCCModeCBC), _padding(false), _buffered(0), _keystreamUsed(c_aesBlockBytes) {
+    }
+
+    ~AesCryptor() override {
+        SecureZeroMemory(&_key, sizeof(_key));
+        SecureZeroMemory(_buffer, sizeof(_buffer));
+        SecureZeroMemory(_keystream, sizeof(_keystream));
+    }
+
+    CCCryptorStatus init(CCOperation op, CCMode mode, bool padding, const void* key, size_t keyLength, const void* iv) {
+        if (op != kCCEncrypt && op != kCCDecrypt) {
+            LOG_HR_MSG(E_INVALIDARG, "Expected operation kCCEncrypt or kCCDecrypt");
+            return kCCParamError;
+        }
+
+        if (!key || !_isAesKeyLength(keyLength)) {
+            LOG_HR_MSG(E_INVALIDARG, "Invalid key for specified algorithm kCCAlgorithmAES");
+            return kCCParamError;
+        }
+
+        _op = op;
+        _mode = mode;
+        _padding = padding && (mode != kCCModeCTR);
+        _aesExpandKey(&_key, static_cast<const unsigned char*>(key), keyLength);
+        return reset(iv);
+    }
+
+    CCCryptorStatus update(const void* dataIn, size_t dataInLength, void* dataOut, size_t dataOutAvailable, size_t* dataOutMoved) override {
+        if (!dataOutMoved || (dataInLength > 0 && (!dataIn || !dataOut))) {
+            return kCCParamError;
+        }
+
+        *dataOutMoved = 0;
+        const unsigned char* in = static_cast<const unsigned char*>(dataIn);
+        unsigned char* out = static_cast<unsigned char*>(dataOut);
+
+        if (_mode == kCCModeCTR) {
+            if (dataInLength > dataOutAvailable) {
+                return kCCBufferTooSmall;
+            }
+
+            _ctrUpdate(in, out, dataInLength);
+            *dataOutMoved = dataInLength;
+            return kCCSuccess;
+        }
+
+        size_t blocks = _readyBlocks(dataInLength);
+        const size_t outLength = blocks * c_aesBlockBytes;
+        if (outLength > dataOutAvailable) {
+            return kCCBufferTooSmall;
+        }
+
+        if (_buffered > 0 && _overlaps(in, dataInLength, out, outLength)) {
+            // The output runs ahead of the input by what was buffered, so each part of the input still to come is
+            // taken before the output reaches it.
+            unsigned char stage[16 * c_aesBlockBytes];
+            while (blocks > 0) {
+                const size_t count = std::min(blocks, sizeof(stage) / c_aesBlockBytes);
+                const size_t fresh = count * c_aesBlockBytes - _buffered;
+                memcpy(stage, _buffer, _buffered);
+                memcpy(stage + _buffered, in, fresh);
+                in += fresh;
+                dataInLength -= fresh;
+
+                const size_t carried = std::min(_buffered, dataInLength);
+                memcpy(_buffer, in, carried);
+                in += carried;
+                dataInLength -= carried;
+                _buffered = carried;
+
+                _cipherBlocks(stage, out, count);
+                out += count * c_aesBlockBytes;
+                blocks -= count;
+            }
+            SecureZeroMemory(stage, sizeof(stage));
+        } else {
+            if (blocks > 0 && _buffered > 0) {
+                const size_t fill = c_aesBlockBytes - _buffered;
+                memcpy(_buffer + _buffered, in, fill);
+                in += fill;
+                dataInLength -= fill;
+                _buffered = 0;
+
+                _cipherBlocks(_buffer, out, 1);
+                out += c_aesBlockBytes;
+                --blocks;
+            }
+
+            _cipherBlocks(in, out, blocks);
+            in += blocks * c_aesBlockBytes;
+            dataInLength -= blocks * c_aesBlockBytes;
+        }
+
+        memcpy(_buffer + _buffered, in, dataInLength);
+        _buffered += dataInLength;
+        *dataOutMoved = outLength;
+        return kCCSuccess;
+    }
+
+    CCCryptorStatus final(void* dataOut, size_t dataOutAvailable, size_t* dataOutMoved) override {
+        *dataOutMoved = 0;
+        unsigned char* out = static_cast<unsigned char*>(dataOut);
+
+        if (_mode == kCCModeCTR) {
+            return kCCSuccess;
+        }
+
+        if (!_padding) {
+            return (_buffered == 0) ? kCCSuccess : kCCAlignmentError;
+        }
+
+        if (_op == kCCEncrypt) {
+            if (!out || dataOutAvailable < c_aesBlockBytes) {
+                return kCCBufferTooSmall;
+            }
+
+            const unsigned char pad = static_cast<unsigned char>(c_aesBlockBytes - _buffered);
+            memset(_buffer + _buffered, pad, pad);
+            _cipherBlocks(_buffer, out, 1);
+            _buffered = 0;
+            *dataOutMoved = c_aesBlockBytes;
+            return kCCSuccess;
+        }
+
+        if (_buffered != c_aesBlockBytes) {
+            return (_buffered == 0) ? kCCDecodeError : kCCAlignmentError;
+        }
+
+        // Decrypted aside, so that a short buffer or bad padding leaves the cryptor as it was.
+        unsigned char plaintext[c_aesBlockBytes];
+        _aesEngine().decryptEcb(&_key, _buffer, plaintext, 1);
+        if (_mode == kCCModeCBC) {
+            _xorBlock(plaintext, plaintext, _iv);
+        }
+
+        const unsigned char pad = plaintext[c_aesBlockBytes - 1];
+        unsigned char mismatch = (pad == 0 || pad > c_aesBlockBytes) ? 1 : 0;
+        for (size_t i = 0; i < c_aesBlockBytes; ++i) {
+            const unsigned char inPad = (i >= c_aesBlockBytes - std::min<size_t>(pad, c_aesBlockBytes)) ? 0xff : 0;
+            mismatch |= (plaintext[i] ^ pad) & inPad;
+        }
+
+        CCCryptorStatus status = kCCSuccess;
+        const size_t length = c_aesBlockBytes - pad;
+        if (mismatch) {
+            status = kCCDecodeError;
+        } else if (length > 0 && (!out || dataOutAvailable < length)) {
+            status = kCCBufferTooSmall;
+        } else {
+            memcpy(out, plaintext, length);
+            memcpy(_iv, _buffer, c_aesBlockBytes);
+            _buffered = 0;
+            *dataOutMoved = length;
+        }
+
+        SecureZeroMemory(plaintext, sizeof(plaintext));
+        return status;
+    }
+
+    CCCryptorStatus reset(const void* iv) override {
+        // The key schedule is kept: only the chaining value and anything buffered start over.
+        if (iv && _mode != kCCModeECB) {
+            memcpy(_iv, iv, c_aesBlockBytes);
+        } else {
+            memset(_iv, 0, c_aesBlockBytes);
+        }
+
+        _buffered = 0;
+        _keystreamUsed = c_aesBlockBytes;
+        return kCCSuccess;
+    }
+
+    size_t outputLength(size_t inputLength, bool final) override {
+        if (_mode == kCCModeCTR) {
+            return inputLength;
+        }
+
+        const size_t total = _buffered + inputLength;
+        if (!final) {
+            return _readyBlocks(inputLength) * c_aesBlockBytes;
+        }
+
+        const size_t whole = total - (total % c_aesBlockBytes);
+        return (_padding && _op == kCCEncrypt) ? whole + c_aesBlockBytes : whole;
+    }
+
+private:
+    // The blocks an update can finish: decrypting with padding holds the last one back, as it may be the padding.
+    size_t _readyBlocks(size_t inputLength) const {
+        const size_t total = _buffered + inputLength;
+        if (_padding && _op == kCCDecrypt) {
+            return (total > 0) ? (total - 1) / c_aesBlockBytes : 0;
+        }
+
+        return total / c_aesBlockBytes;
+    }
+
+    void _cipherBlocks(const unsigned char* in, unsigned char* out, size_t blocks) {
+        if (blocks == 0) {
+            return;
+        }
+
+        const AesEngine& engine = _aesEngine();
+        if (_mode == kCCModeECB) {
+            (_op == kCCEncrypt ? engine.encryptEcb : engine.decryptEcb)(&_key, in, out, blocks);
+        } else {
+            (_op == kCCEncrypt ? engine.encryptCbc : engine.decryptCbc)(&_key, _iv, in, out, blocks);
+        }
+    }
+
+    void _ctrUpdate(const unsigned char* in, unsigned char* out, size_t length) {
+        for (; length > 0 && _keystreamUsed < c_aesBlockBytes; --length) {
+            *out++ = *in++ ^ _keystream[_keystreamUsed++];
+        }
+
+        const size_t blocks = length / c_aesBlockBytes;
+        _aesCtr(&_key, _iv, in, out, blocks);
+        in += blocks * c_aesBlockBytes;
+        out += blocks * c_aesBlockBytes;
+        length -= blocks * c_aesBlockBytes;
+
+        if (length > 0) {
+            memset(_keystream, 0, c_aesBlockBytes);
+            _aesCtr(&_key, _iv, _keystream, _keystream, 1);
+            for (size_t i = 0; i < length; ++i) {
+                out[i] = in[i] ^ _keystream[i];
+            }
+            _keystreamUsed = length;
+        }
+    }
+
+    CCOperation _op;
+    CCMode _mode;
+    bool _padding;
+    AesKey _key;
+    // The CBC chaining value or the CTR counter
+    unsigned char _iv[c_aesBlockBytes];
+    unsigned char _buffer[c_aesBlockBytes];
+    size_t _buffered;
+    unsigned char _keystream[c_aesBlockBytes];
+    size_t _keystreamUsed;
+};
+
+// GCM hashes the ciphertext this many bytes at a time, while it's still in the cache.
+static const size_t c_gcmPieceBytes = 4096;
+
+// AES-GCM (NIST SP 800-38D) over a whole message.
+struct AesGcm {
+    AesGcm(const void* key, size_t keyLength, const void* iv, size_t ivLength, const void* aData, size_t aDataLength)
+        : _engine(_aesEngine()), _aDataLength(aDataLength) {
+        _aesExpandKey(&_key, static_cast<const unsigned char*>(key), keyLength);
+
+        unsigned char h[c_aesBlockBytes] = {};
+        _engine.encryptEcb(&_key, h, h, 1);
+        _engine.ghashInit(&_hash, h);
+
+        if (ivLength == 12) {
+            memcpy(_counter, iv, 12);
+            _storeBigEndian32(_counter + 12, 1);
+        } else {
+            memset(_counter, 0, c_aesBlockBytes);
+            _addHash(_counter, static_cast<const unsigned char*>(iv), ivLength);
+            unsigned char lengths[c_aesBlockBytes] = {};
+            _storeBigEndian64(lengths + 8, uint64_t(ivLength) * 8);
+            _engine.ghash(&_hash, _counter, lengths, 1);
+        }
+
+        _engine.encryptEcb(&_key, _counter, _tagMask, 1);
+        _storeBigEndian32(_counter + 12, _loadBigEndian32(_counter + 12) + 1);
+
+        memset(_tag, 0, c_aesBlockBytes);
+        _addHash(_tag, static_cast<const unsigned char*>(aData), aDataLength);
+    }
+
+    ~AesGcm() {
+        SecureZeroMemory(&_key, sizeof(_key));
+        SecureZeroMemory(&_hash, sizeof(_hash));
+        SecureZeroMemory(_tagMask, sizeof(_tagMask));
+    }
+
+    void encrypt(const unsigned char* in, unsigned char* out, size_t length) {
+        for (size_t done = 0; done < length;) {
+            const size_t piece = std::min(length - done, c_gcmPieceBytes);
+            _crypt(in + done, out + done, piece);
+            _addHash(_tag, out + done, piece);
+            done += piece;
+        }
+    }
+
+    // Only the tag of the ciphertext: decrypt() comes after it has been checked.
+    void hashCiphertext(const unsigned char* in, size_t length) {
+        _addHash(_tag, in, length);
+    }
+
+    void decrypt(const unsigned char* in, unsigned char* out, size_t length) {
+        _crypt(in, out, length);
+    }
+
+    void tag(size_t dataLength, unsigned char* tag) {
+        unsigned char lengths[c_aesBlockBytes];
+        _storeBigEndian64(lengths, uint64_t(_aDataLength) * 8);
+        _storeBigEndian64(lengths + 8, uint64_t(dataLength) * 8);
+        _engine.ghash(&_hash, _tag, lengths, 1);
+        _xorBlock(tag, _tag, _tagMask);
+    }
+
+private:
+    void _crypt(const unsigned char* in, unsigned char* out, size_t length) {
+        const size_t blocks = length / c_aesBlockBytes;
+        _engine.ctr32(&_key, _counter, in, out, blocks);
+        const size_t rest = length - blocks * c_aesBlockBytes;
+        if (rest > 0) {
+            unsigned char keystream[c_aesBlockBytes] = {};
+            _engine.ctr32(&_key, _counter, keystream, keystream, 1);
+            for (size_t i = 0; i < rest; ++i) {
+                out[blocks * c_aesBlockBytes + i] = in[blocks * c_aesBlockBytes + i] ^ keystream[i];
+            }
+            SecureZeroMemory(keystream, sizeof(keystream));
+        }
+    }
+
+    // GHASH of data padded with zeros to whole blocks.
+    void _addHash(unsigned char* state, const unsigned char* data, size_t length) {
+        const size_t blocks = length / c_aesBlockBytes;
+        _engine.ghash(&_hash, state, data, blocks);
+        const size_t rest = length - blocks * c_aesBlockBytes;
+        if (rest > 0) {
+            unsigned char last[c_aesBlockBytes] = {};
+            memcpy(last, data + blocks * c_aesBlockBytes, rest);
+            _engine.ghash(&_hash, state, last, 1);
+        }
+    }
+
+    const AesEngine& _engine;
+    AesKey _key;
+    GcmKey _hash;
+    size_t _aDataLength;
+    unsigned char _counter[c_aesBlockBytes];
+    unsigned char _tag[c_aesBlockBytes];
+    unsigned char _tagMask[c_aesBlockBytes];
+};
+
+static CCCryptorStatus _validateGcmParams(CCAlgorithm alg,
+                                          const void* key,
+                                          size_t keyLength,
+                                          const void* iv,
+                                          size_t ivLength,
+                                          const void* aData,
+                                          size_t aDataLength,
+                                          const void* dataIn,
+                                          size_t dataInLength,
+                                          const void* dataOut,
+                                          const void* tag,
+                                          size_t tagLength) {
+    if (alg != kCCAlgorithmAES || !key || !_isAesKeyLength(keyLength)) {
+        return kCCParamError;
+    }
+
+    if (!iv || ivLength == 0 || (!aData && aDataLength > 0) || (dataInLength > 0 && (!dataIn || !dataOut))) {
+        return kCCParamError;
+    }
+
+    if (!tag || tagLength < 4 || tagLength > c_aesBlockBytes) {
+        return kCCParamError;
+    }
+
+    return kCCSuccess;
+}
+
+static CCCryptorStatus _cryptOneShot(CC_Cryptor_State* state,
+                                     const void* dataIn,
+                                     size_t dataInLength,
+                                     void* dataOut,
+                                     size_t dataOutAvailable,
+                                     size_t* dataOutMoved) {
+    size_t dataMoved1 = 0;
+    CCCryptorStatus status = state->update(dataIn, dataInLength, dataOut, dataOutAvailable, &dataMoved1);
+    *dataOutMoved = dataMoved1;
+    if (status != kCCSuccess) {
+        return status;
+    }
+
+    size_t dataMoved2 = 0;
+    status = state->final((uint8_t*)dataOut + dataMoved1, dataOutAvailable - dataMoved1, &dataMoved2);
+    *dataOutMoved = dataMoved1 + dataMoved2;
+    return status;
+}
+
+static CCMode _modeFromOptions(CCOptions options) {
+    return (options & kCCOptionECBMode) ? kCCModeECB : kCCModeCBC;
+}
+
+static std::unique_ptr<CC_Cryptor_State> _createCryptor(
+    CCOperation op, CCAlgorithm alg, CCOptions options, const void* key, size_t keyLength, const void* iv, CCCryptorStatus* statusOut) {
+    if (alg == kCCAlgorithmAES) {
+        std::unique_ptr<AesCryptor> cryptor = std::make_unique<AesCryptor>();
+        *statusOut = cryptor->init(op, _modeFromOptions(options), (options & kCCOptionPKCS7Padding) != 0, key, keyLength, iv);
+        return (*statusOut == kCCSuccess) ? std::move(cryptor) : nullptr;
+    }
+
+    return WinRTCryptor::init(op, alg, options, key, keyLength, iv, statusOut);
+}
+
 /**
 @Status Caveat
 @Notes kCCAlgorithmCAST and kCCAlgorithmBlowfish are unsupported.
@@ -481,7 +1992,7 @@ CCCryptorStatus CCCryptorCreate(
     *cryptorRef = nullptr;
 
     CCCryptorStatus status;
-    std::unique_ptr<CC_Cryptor_State> pState = CC_Cryptor_State::init(op, alg, options, key, keyLength, iv, &status);
+    std::unique_ptr<CC_Cryptor_State> pState = _createCryptor(op, alg, options, key, keyLength, iv, &status);
     if (status == kCCSuccess) {
         *cryptorRef = pState.release();
     }
@@ -489,6 +2000,63 @@ CCCryptorStatus CCCryptorCreate(
     return status;
 }
 
+/**
+@Status Caveat
+@Notes Only kCCModeECB and kCCModeCBC (and kCCModeCTR for AES, kCCModeRC4 for RC4) are supported. tweak and numRounds
+       are ignored.
+*/
+CCCryptorStatus CCCryptorCreateWithMode(CCOperation op,
+                                        CCMode mode,
+                                        CCAlgorithm alg,
+                                        CCPadding padding,
+                                        const void* iv,
+                                        const void* key,
+                                        size_t keyLength,
+                                        const void* tweak,
+                                        size_t tweakLength,
+                                        int numRounds,
+                                        CCModeOptions options,
+                                        CCCryptorRef* cryptorRef) {
+    if (!cryptorRef) {
+        return kCCParamError;
+    }
+
+    *cryptorRef = nullptr;
+    if (padding != ccNoPadding && padding != ccPKCS7Padding) {
+        return kCCParamError;
+    }
+
+    if (alg == kCCAlgorithmAES) {
+        if (mode != kCCModeECB && mode != kCCModeCBC && mode != kCCModeCTR) {
+            UNIMPLEMENTED_WITH_MSG("Only kCCModeECB, kCCModeCBC and kCCModeCTR are supported for kCCAlgorithmAES");
+            return kCCUnimplemented;
+        }
+
+        if (mode == kCCModeCTR && options == kCCModeOptionCTR_LE) {
+            UNIMPLEMENTED_WITH_MSG("kCCModeOptionCTR_LE is not supported");
+            return kCCUnimplemented;
+        }
+
+        std::unique_ptr<AesCryptor> cryptor = std::make_unique<AesCryptor>();
+        CCCryptorStatus status = cryptor->init(op, mode, padding == ccPKCS7Padding, key, keyLength, iv);
+        if (status == kCCSuccess) {
+            *cryptorRef = cryptor.release();
+        }
+
+        return status;
+    }
+
+    CCOptions cryptorOptions = (padding == ccPKCS7Padding) ? kCCOptionPKCS7Padding : 0;
+    if (mode == kCCModeECB) {
+        cryptorOptions |= kCCOptionECBMode;
+    } else if (mode != kCCModeCBC && !(mode == kCCModeRC4 && alg == kCCAlgorithmRC4)) {
+        UNIMPLEMENTED_WITH_MSG("Unsupported mode for this algorithm");
+        return kCCUnimplemented;
+    }
+
+    return CCCryptorCreate(op, alg, cryptorOptions, key, keyLength, iv, cryptorRef);
+}
+
 /**
 @Status Caveat
 @Notes Ignores caller-supplied memory and overwrites cryptorRef with dynamically allocated memory.
@@ -511,7 +2079,7 @@ CCCryptorStatus CCCryptorCreateFromData(CCOperation op,
     *cryptorRef = nullptr;
 
     CCCryptorStatus status;
-    std::unique_ptr<CC_Cryptor_State> pState = CC_Cryptor_State::init(op, alg, options, key, keyLength, iv, &status);
+    std::unique_ptr<CC_Cryptor_State> pState = _createCryptor(op, alg, options, key, keyLength, iv, &status);
     if (status == kCCSuccess) {
         *cryptorRef = pState.release();
     }
@@ -529,6 +2097,7 @@ CCCryptorStatus CCCryptorRelease(CCCryptorRef cryptorRef) {
 
 /**
 @Status Interoperable
+@Notes For AES, dataOut may be the same buffer as dataIn.
 */
 CCCryptorStatus CCCryptorUpdate(
     CCCryptorRef cryptorRef, const void* dataIn, size_t dataInLength, void* dataOut, size_t dataOutAvailable, size_t* dataOutMoved) {
@@ -564,6 +2133,7 @@ size_t CCCryptorGetOutputLength(CCCryptorRef cryptorRef, size_t inputLength, boo
 
 /**
 @Status Interoperable
+@Notes For AES the key schedule is kept, and only the IV and any buffered input are reset.
 */
 CCCryptorStatus CCCryptorReset(CCCryptorRef cryptorRef, const void* iv) {
     if (!cryptorRef) {
@@ -575,6 +2145,7 @@ CCCryptorStatus CCCryptorReset(CCCryptorRef cryptorRef, const void* iv) {
 
 /**
 @Status Interoperable
+@Notes For AES, dataOut may be the same buffer as dataIn.
 */
 CCCryptorStatus CCCrypt(CCOperation op,
                         CCAlgorithm alg,
@@ -587,5 +2158,95 @@ CCCryptorStatus CCCrypt(CCOperation op,
                         void* dataOut,
                         size_t dataOutAvailable,
                         size_t* dataOutMoved) {
-    return CC_Cryptor_State::oneShot(op, alg, options, key, keyLength, iv, dataIn, dataInLength, dataOut, dataOutAvailable, dataOutMoved);
-}
\ No newline at end of file
+    *dataOutMoved = 0;
+
+    if (alg == kCCAlgorithmAES) {
+        AesCryptor cryptor;
+        CCCryptorStatus status = cryptor.init(op, _modeFromOptions(options), (options & kCCOptionPKCS7Padding) != 0, key, keyLength, iv);
+        if (status != kCCSuccess) {
+            return status;
+        }
+
+        return _cryptOneShot(&cryptor, dataIn, dataInLength, dataOut, dataOutAvailable, dataOutMoved);
+    }
+
+    CCCryptorStatus status;
+    std::unique_ptr<WinRTCryptor> pState = WinRTCryptor::init(op, alg, options, key, keyLength, iv, &status);
+    if (status != kCCSuccess) {
+        return status;
+    }
+
+    return _cryptOneShot(pState.get(), dataIn, dataInLength, dataOut, dataOutAvailable, dataOutMoved);
+}
+
+/**
+@Status Interoperable
+@Notes cipherDataOut may be the same buffer as dataIn.
+*/
+CCCryptorStatus CCCryptorGCMOneshotEncrypt(CCAlgorithm alg,
+                                           const void* key,
+                                           size_t keyLength,
+                                           const void* iv,
+                                           size_t ivLength,
+                                           const void* aData,
+                                           size_t aDataLength,
+                                           const void* dataIn,
+                                           size_t dataInLength,
+                                           void* cipherDataOut,
+                                           void* tagOut,
+                                           size_t tagLength) {
+    CCCryptorStatus status =
+        _validateGcmParams(alg, key, keyLength, iv, ivLength, aData, aDataLength, dataIn, dataInLength, cipherDataOut, tagOut, tagLength);
+    if (status != kCCSuccess) {
+        return status;
+    }
+
+    AesGcm gcm(key, keyLength, iv, ivLength, aData, aDataLength);
+    gcm.encrypt(static_cast<const unsigned char*>(dataIn), static_cast<unsigned char*>(cipherDataOut), dataInLength);
+
+    unsigned char tag[c_aesBlockBytes];
+    gcm.tag(dataInLength, tag);
+    memcpy(tagOut, tag, tagLength);
+    return kCCSuccess;
+}
+
+/**
+@Status Interoperable
+@Notes dataOut may be the same buffer as dataIn. Nothing is written to it unless the tag matches; kCCDecodeError is
+       returned when it does not.
+*/
+CCCryptorStatus CCCryptorGCMOneshotDecrypt(CCAlgorithm alg,
+                                           const void* key,
+                                           size_t keyLength,
+                                           const void* iv,
+                                           size_t ivLength,
+                                           const void* aData,
+                                           size_t aDataLength,
+                                           const void* dataIn,
+                                           size_t dataInLength,
+                                           void* dataOut,
+                                           const void* tagIn,
+                                           size_t tagLength) {
+    CCCryptorStatus status =
+        _validateGcmParams(alg, key, keyLength, iv, ivLength, aData, aDataLength, dataIn, dataInLength, dataOut, tagIn, tagLength);
+    if (status != kCCSuccess) {
+        return status;
+    }
+
+    AesGcm gcm(key, keyLength, iv, ivLength, aData, aDataLength);
+    gcm.hashCiphertext(static_cast<const unsigned char*>(dataIn), dataInLength);
+
+    unsigned char tag[c_aesBlockBytes];
+    gcm.tag(dataInLength, tag);
+    unsigned char mismatch = 0;
+    for (size_t i = 0; i < tagLength; ++i) {
+        mismatch |= tag[i] ^ static_cast<const unsigned char*>(tagIn)[i];
+    }
+
+    if (mismatch) {
+        return kCCDecodeError;
+    }
+
+    gcm.decrypt(static_cast<const unsigned char*>(dataIn), static_cast<unsigned char*>(dataOut), dataInLength);
+    return kCCSuccess;
+}
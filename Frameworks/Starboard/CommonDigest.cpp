@@ -14,383 +14,1451 @@
 //
 //******************************************************************************
 
-#include <Windows.h>
-#include <bcrypt.h>
 #include <CommonCrypto\CommonDigest.h>
-#include <CommonCrypto\CommonCryptor.h>
-#include <ErrorHandling.h>
-#include <assert.h>
-#include <StubReturn.h>
-
-struct CC_Digest_State {
-    CC_Digest_State(const unsigned int digestLength, const LPCWSTR algorithm) :
-        _hAlg(INVALID_HANDLE_VALUE),
-        _hHash(INVALID_HANDLE_VALUE),
-        _pHashObject(nullptr),
-        _algorithm(algorithm),
-        _digestLength(digestLength) {
-        _init();
-    }
-
-    ~CC_Digest_State() {
-        if (_hAlg != INVALID_HANDLE_VALUE) {
-            BCryptCloseAlgorithmProvider(_hAlg, 0);
-            _hAlg = INVALID_HANDLE_VALUE;
+#include "CommonDigestInternal.h"
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define DIGEST_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define DIGEST_ARM64 1
+#include <Windows.h>
+#include <arm_neon.h>
+#endif
+
+// The digests are computed here rather than by BCrypt, which costs an algorithm provider and a hash object for every
+// message: the state lives in the caller's CC_Digest_State, and each algorithm is a function that compresses whole
+// blocks into it. SHA-1 and SHA-256 use the processor's SHA instructions where there are any, and CC_SHA256_Batch
+// hashes short messages side by side in the lanes of the vector registers.
+
+static const uint32_t c_md5Constants[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+static const uint32_t c_sha256Constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint64_t c_sha512Constants[80] = {
+    0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc, 0x3956c25bf348b538,
+    0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242, 0x12835b0145706fbe,
+    0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2, 0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+    0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+    0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5, 0x983e5152ee66dfab,
+    0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+    0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed,
+    0x53380d139d95b3df, 0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+    0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+    0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8, 0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
+    0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373,
+    0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+    0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b, 0xca273eceea26619c,
+    0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba, 0x0a637dc5a2c898a6,
+    0x113f9804bef90dae, 0x1b710b35131c471b, 0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+    0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817,
+};
+
+static const uint32_t c_md5Start[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+static const uint32_t c_sha1Start[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+static const uint32_t c_sha224Start[8] = { 0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+                                           0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4 };
+static const uint32_t c_sha256Start[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                           0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+static const uint64_t c_sha384Start[8] = { 0xcbbb9d5dc1059ed8, 0x629a292a367cd507, 0x9159015a3070dd17, 0x152fecd8f70e5939,
+                                           0x67332667ffc00b31, 0x8eb44a8768581511, 0xdb0c2e0d64f98fa7, 0x47b5481dbefa4fa4 };
+static const uint64_t c_sha512Start[8] = { 0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+                                           0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179 };
+
+// The permutation of 0 to 255 made from the digits of pi that MD2 substitutes bytes with (RFC 1319).
+static const unsigned char c_md2Substitution[256] = {
+    41,  46,  67,  201, 162, 216, 124, 1,   61,  54,  84,  161, 236, 240, 6,   19,  98,  167, 5,   243, 192, 199, 115, 140,
+    152, 147, 43,  217, 188, 76,  130, 202, 30,  155, 87,  60,  253, 212, 224, 22,  103, 66,  111, 24,  138, 23,  229, 18,
+    190, 78,  196, 214, 218, 158, 222, 73,  160, 251, 245, 142, 187, 47,  238, 122, 169, 104, 121, 145, 21,  178, 7,   63,
+    148, 194, 16,  137, 11,  34,  95,  33,  128, 127, 93,  154, 90,  144, 50,  39,  53,  62,  204, 231, 191, 247, 151, 3,
+    255, 25,  48,  179, 72,  165, 181, 209, 215, 94,  146, 42,  172, 86,  170, 198, 79,  184, 56,  210, 150, 164, 125, 182,
+    118, 252, 107, 226, 156, 116, 4,   241, 69,  157, 112, 89,  100, 113, 135, 32,  134, 91,  207, 101, 230, 45,  168, 2,
+    27,  96,  37,  173, 174, 176, 185, 246, 28,  70,  97,  105, 52,  64,  126, 15,  85,  71,  163, 35,  221, 81,  175, 58,
+    195, 92,  249, 206, 186, 197, 234, 38,  44,  83,  13,  110, 133, 40,  132, 9,   211, 223, 205, 244, 65,  129, 77,  82,
+    106, 220, 55,  200, 108, 193, 171, 250, 36,  225, 123, 8,   12,  189, 177, 74,  120, 136, 149, 139, 227, 99,  232, 109,
+    233, 203, 213, 254, 59,  0,   29,  57,  242, 239, 183, 14,  102, 88,  208, 228, 166, 119, 114, 248, 235, 117, 75,  10,
+    49,  68,  80,  180, 143, 237, 31,  26,  219, 153, 141, 51,  159, 17,  131, 20,
+};
+
+static const size_t c_md2BlockBytes = 16;
+
+static inline uint32_t _loadBigEndian32(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+static inline uint32_t _loadLittleEndian32(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[3]) << 24) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[0];
+}
+
+static inline uint64_t _loadBigEndian64(const unsigned char* p) {
+    return (static_cast<uint64_t>(_loadBigEndian32(p)) << 32) | _loadBigEndian32(p + 4);
+}
+
+static inline void _storeBigEndian32(unsigned char* p, uint32_t value) {
+    p[0] = static_cast<unsigned char>(value >> 24);
+    p[1] = static_cast<unsigned char>(value >> 16);
+    p[2] = static_cast<unsigned char>(value >> 8);
+    p[3] = static_cast<unsigned char>(value);
+}
+
+static inline void _storeLittleEndian32(unsigned char* p, uint32_t value) {
+    p[0] = static_cast<unsigned char>(value);
+    p[1] = static_cast<unsigned char>(value >> 8);
+    p[2] = static_cast<unsigned char>(value >> 16);
+    p[3] = static_cast<unsigned char>(value >> 24);
+}
+
+static inline void _storeBigEndian64(unsigned char* p, uint64_t value) {
+    _storeBigEndian32(p, static_cast<uint32_t>(value >> 32));
+    _storeBigEndian32(p + 4, static_cast<uint32_t>(value));
+}
+
+static inline uint32_t _rotateLeft(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t _rotateRight(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline uint64_t _rotateRight(uint64_t x, int n) {
+    return (x >> n) | (x << (64 - n));
+}
+
+// MD2 keeps its 48-byte state and then its 16-byte checksum in the hash bytes.
+static void _md2Transform(unsigned char* state, const unsigned char* block) {
+    for (size_t j = 0; j < 16; ++j) {
+        state[16 + j] = block[j];
+        state[32 + j] = block[j] ^ state[j];
+    }
+
+    unsigned t = 0;
+    for (unsigned round = 0; round < 18; ++round) {
+        for (size_t k = 0; k < 48; ++k) {
+            t = state[k] ^= c_md2Substitution[t];
         }
-        if (_hHash != INVALID_HANDLE_VALUE) {
-            BCryptDestroyHash(_hHash);
-            _hHash = INVALID_HANDLE_VALUE;
+        t = (t + round) & 0xff;
+    }
+}
+
+static void _md2Blocks(CC_Digest_State* ctx, const unsigned char* data, size_t count) {
+    unsigned char* checksum = ctx->hash.bytes + 48;
+    for (; count > 0; --count, data += c_md2BlockBytes) {
+        unsigned char last = checksum[15];
+        for (size_t j = 0; j < 16; ++j) {
+            last = checksum[j] ^= c_md2Substitution[data[j] ^ last];
         }
-        delete[] _pHashObject;
-        _pHashObject = nullptr;
+        _md2Transform(ctx->hash.bytes, data);
     }
+}
 
-    static int init(CC_Digest_State** ctx, unsigned int digestLength, LPCWSTR algorithm) {
-        if (!ctx) {
-            return -1;
+static void _md4Blocks(CC_Digest_State* ctx, const unsigned char* data, size_t count) {
+    static const int shifts[3][4] = { { 3, 7, 11, 19 }, { 3, 5, 9, 13 }, { 3, 9, 11, 15 } };
+    static const unsigned char order[3][16] = { { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+                                                { 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 },
+                                                { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 } };
+
+    uint32_t* hash = ctx->hash.words;
+    for (; count > 0; --count, data += 64) {
+        uint32_t x[16];
+        for (size_t i = 0; i < 16; ++i) {
+            x[i] = _loadLittleEndian32(data + 4 * i);
         }
 
-        *ctx = nullptr;
+        uint32_t a = hash[0], b = hash[1], c = hash[2], d = hash[3];
+        for (size_t i = 0; i < 48; ++i) {
+            const size_t round = i / 16;
+            uint32_t f;
+            if (round == 0) {
+                f = (b & c) | (~b & d);
+            } else if (round == 1) {
+                f = ((b & c) | (b & d) | (c & d)) + 0x5a827999;
+            } else {
+                f = (b ^ c ^ d) + 0x6ed9eba1;
+            }
+            const uint32_t rotated = _rotateLeft(a + f + x[order[round][i % 16]], shifts[round][i % 4]);
+            a = d;
+            d = c;
+            c = b;
+            b = rotated;
+        }
 
-        CC_Digest_State* state = new CC_Digest_State(digestLength, algorithm);
-        if (!_isValidState(state)) {
-            return -1;
+        hash[0] += a;
+        hash[1] += b;
+        hash[2] += c;
+        hash[3] += d;
+    }
+}
+
+static void _md5Blocks(CC_Digest_State* ctx, const unsigned char* data, size_t count) {
+    static const int shifts[4][4] = { { 7, 12, 17, 22 }, { 5, 9, 14, 20 }, { 4, 11, 16, 23 }, { 6, 10, 15, 21 } };
+
+    uint32_t* hash = ctx->hash.words;
+    for (; count > 0; --count, data += 64) {
+        uint32_t x[16];
+        for (size_t i = 0; i < 16; ++i) {
+            x[i] = _loadLittleEndian32(data + 4 * i);
         }
 
-        *ctx = state;
-        return 1;
+        uint32_t a = hash[0], b = hash[1], c = hash[2], d = hash[3];
+        for (size_t i = 0; i < 64; ++i) {
+            const size_t round = i / 16;
+            uint32_t f;
+            size_t g;
+            if (round == 0) {
+                f = (b & c) | (~b & d);
+                g = i;
+            } else if (round == 1) {
+                f = (d & b) | (~d & c);
+                g = 5 * i + 1;
+            } else if (round == 2) {
+                f = b ^ c ^ d;
+                g = 3 * i + 5;
+            } else {
+                f = c ^ (b | ~d);
+                g = 7 * i;
+            }
+            const uint32_t rotated = _rotateLeft(a + f + c_md5Constants[i] + x[g % 16], shifts[round][i % 4]);
+            a = d;
+            d = c;
+            c = b;
+            b += rotated;
+        }
+
+        hash[0] += a;
+        hash[1] += b;
+        hash[2] += c;
+        hash[3] += d;
     }
+}
 
-    // internal implemention of update for all hash contexts
-    static int update(CC_Digest_State** ctx, const void* data, CC_LONG len) {
-        CC_Digest_State* state = ctx ? *ctx : nullptr;
-        if (!_isValidState(state)) {
-            *ctx = nullptr;
-            return -1;
+static void _sha1BlocksPortable(uint32_t* hash, const unsigned char* data, size_t count) {
+    for (; count > 0; --count, data += 64) {
+        uint32_t w[80];
+        for (size_t i = 0; i < 16; ++i) {
+            w[i] = _loadBigEndian32(data + 4 * i);
+        }
+        for (size_t i = 16; i < 80; ++i) {
+            w[i] = _rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = hash[0], b = hash[1], c = hash[2], d = hash[3], e = hash[4];
+        for (size_t i = 0; i < 80; ++i) {
+            uint32_t f;
+            if (i < 20) {
+                f = ((b & c) | (~b & d)) + 0x5a827999;
+            } else if (i < 40) {
+                f = (b ^ c ^ d) + 0x6ed9eba1;
+            } else if (i < 60) {
+                f = ((b & c) | (b & d) | (c & d)) + 0x8f1bbcdc;
+            } else {
+                f = (b ^ c ^ d) + 0xca62c1d6;
+            }
+            const uint32_t next = _rotateLeft(a, 5) + f + e + w[i];
+            e = d;
+            d = c;
+            c = _rotateLeft(b, 30);
+            b = a;
+            a = next;
         }
 
-        return state->_hashData(reinterpret_cast<const BYTE*>(data), len);
+        hash[0] += a;
+        hash[1] += b;
+        hash[2] += c;
+        hash[3] += d;
+        hash[4] += e;
     }
+}
 
-    // internal implementaion of final for all hash contexts
-    static int final(unsigned char* digest, CC_Digest_State** ctx) {
-        CC_Digest_State* state = ctx ? *ctx : nullptr;
-        if (!_isValidState(state)) {
-            *ctx = nullptr;
-            return -1;
+static void _sha256BlocksPortable(uint32_t* hash, const unsigned char* data, size_t count) {
+    for (; count > 0; --count, data += 64) {
+        uint32_t w[64];
+        for (size_t i = 0; i < 16; ++i) {
+            w[i] = _loadBigEndian32(data + 4 * i);
+        }
+        for (size_t i = 16; i < 64; ++i) {
+            const uint32_t s0 = _rotateRight(w[i - 15], 7) ^ _rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = _rotateRight(w[i - 2], 17) ^ _rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
         }
 
-        state->_finishHash(digest);
-        delete state;
+        uint32_t a = hash[0], b = hash[1], c = hash[2], d = hash[3], e = hash[4], f = hash[5], g = hash[6], h = hash[7];
+        for (size_t i = 0; i < 64; ++i) {
+            const uint32_t s1 = _rotateRight(e, 6) ^ _rotateRight(e, 11) ^ _rotateRight(e, 25);
+            const uint32_t t1 = h + s1 + ((e & f) ^ (~e & g)) + c_sha256Constants[i] + w[i];
+            const uint32_t s0 = _rotateRight(a, 2) ^ _rotateRight(a, 13) ^ _rotateRight(a, 22);
+            const uint32_t t2 = s0 + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
 
-        return 1;
+        hash[0] += a;
+        hash[1] += b;
+        hash[2] += c;
+        hash[3] += d;
+        hash[4] += e;
+        hash[5] += f;
+        hash[6] += g;
+        hash[7] += h;
     }
+}
 
-    // internal implementation of the one shot methods for all hash contexts
-    static unsigned char* oneShotDigest(int(*init)(CC_Digest_State**),
-        int(*update)(CC_Digest_State** ctx, const void* data, CC_LONG len),
-        int(*final)(unsigned char* digest, CC_Digest_State** ctx),
-        const void* input,
-        CC_LONG length,
-        unsigned char* digest) {
-        CC_Digest_State* ctx;
+static void _sha512Blocks(CC_Digest_State* ctx, const unsigned char* data, size_t count) {
+    uint64_t* hash = ctx->hash.longs;
+    for (; count > 0; --count, data += 128) {
+        uint64_t w[80];
+        for (size_t i = 0; i < 16; ++i) {
+            w[i] = _loadBigEndian64(data + 8 * i);
+        }
+        for (size_t i = 16; i < 80; ++i) {
+            const uint64_t s0 = _rotateRight(w[i - 15], 1) ^ _rotateRight(w[i - 15], 8) ^ (w[i - 15] >> 7);
+            const uint64_t s1 = _rotateRight(w[i - 2], 19) ^ _rotateRight(w[i - 2], 61) ^ (w[i - 2] >> 6);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
 
-        if (init(&ctx) < 0) {
-            return nullptr;
+        uint64_t a = hash[0], b = hash[1], c = hash[2], d = hash[3], e = hash[4], f = hash[5], g = hash[6], h = hash[7];
+        for (size_t i = 0; i < 80; ++i) {
+            const uint64_t s1 = _rotateRight(e, 14) ^ _rotateRight(e, 18) ^ _rotateRight(e, 41);
+            const uint64_t t1 = h + s1 + ((e & f) ^ (~e & g)) + c_sha512Constants[i] + w[i];
+            const uint64_t s0 = _rotateRight(a, 28) ^ _rotateRight(a, 34) ^ _rotateRight(a, 39);
+            const uint64_t t2 = s0 + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
         }
 
-        int updateResult = update(&ctx, input, length);
+        hash[0] += a;
+        hash[1] += b;
+        hash[2] += c;
+        hash[3] += d;
+        hash[4] += e;
+        hash[5] += f;
+        hash[6] += g;
+        hash[7] += h;
+    }
+}
+
+// One message's progress through a lane: its whole blocks straight from the caller, then the one or two padded ones.
+struct Sha256Message {
+    const unsigned char* data;
+    size_t blocks;
+    size_t padded;
+    size_t next;
+    unsigned char tail[128];
+};
+
+static void _sha256StartMessage(Sha256Message* message, const void* data, CC_LONG length) {
+    const size_t whole = length / 64;
+    const size_t rest = length % 64;
+    message->data = static_cast<const unsigned char*>(data);
+    message->blocks = whole;
+    message->padded = (rest + 9 > 64) ? 2 : 1;
+    message->next = 0;
+
+    unsigned char* tail = message->tail;
+    if (rest > 0) {
+        memcpy(tail, message->data + whole * 64, rest);
+    }
+    tail[rest] = 0x80;
+    memset(tail + rest + 1, 0, message->padded * 64 - rest - 1);
+    _storeBigEndian64(tail + message->padded * 64 - 8, static_cast<uint64_t>(length) * 8);
+}
+
+static const unsigned char* _sha256NextBlock(Sha256Message* message) {
+    const size_t block = message->next++;
+    return (block < message->blocks) ? message->data + block * 64 : message->tail + (block - message->blocks) * 64;
+}
 
-        // Final should be called even if update fails.
-        if (final(digest, &ctx) < 0) {
-            return nullptr;
+static bool _sha256Finished(const Sha256Message* message) {
+    return message->next == message->blocks + message->padded;
+}
+
+// Hashes the messages Lanes::width at a time, each lane taking the next message as soon as it finishes one, so that
+// lanes only go idle at the end.
+template <typename Lanes>
+static void _sha256BatchLanes(const void* const* data, const CC_LONG* lengths, unsigned char* const* digests, size_t count) {
+    static const unsigned char idle[64] = {};
+
+    Lanes lanes;
+    Sha256Message messages[Lanes::width];
+    size_t current[Lanes::width];
+    size_t started = 0;
+    size_t busy = 0;
+    for (size_t lane = 0; lane < Lanes::width; ++lane) {
+        current[lane] = SIZE_MAX;
+        lanes.start(lane);
+        if (started < count) {
+            _sha256StartMessage(&messages[lane], data[started], lengths[started]);
+            current[lane] = started++;
+            ++busy;
         }
+    }
 
-        if (updateResult < 0) {
-            return nullptr;
+    while (busy > 0) {
+        const unsigned char* blocks[Lanes::width];
+        for (size_t lane = 0; lane < Lanes::width; ++lane) {
+            blocks[lane] = (current[lane] != SIZE_MAX) ? _sha256NextBlock(&messages[lane]) : idle;
         }
+        lanes.compress(blocks);
+
+        for (size_t lane = 0; lane < Lanes::width; ++lane) {
+            if (current[lane] == SIZE_MAX || !_sha256Finished(&messages[lane])) {
+                continue;
+            }
+
+            lanes.finish(lane, digests[current[lane]]);
+            current[lane] = SIZE_MAX;
+            --busy;
+            if (started < count) {
+                lanes.start(lane);
+                _sha256StartMessage(&messages[lane], data[started], lengths[started]);
+                current[lane] = started++;
+                ++busy;
+            }
+        }
+    }
+}
+
+#if DIGEST_X86
+
+// MSVC compiles intrinsics for any instruction set anywhere; clang and gcc need the functions that use them marked
+// for it, which the pragmas around each namespace do.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sha,sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sha,sse4.1")
+#endif
+
+namespace shaExtensions {
+
+// Four rounds of SHA-1 (F selecting the round function), with the E they take made from the first four rounds' A.
+template <int F>
+static inline void sha1Rounds(__m128i& abcd, __m128i& previous, __m128i w) {
+    const __m128i e = _mm_sha1nexte_epu32(previous, w);
+    previous = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e, F);
+}
+
+static inline __m128i sha1Schedule(__m128i w0, __m128i w1, __m128i w2, __m128i w3) {
+    return _mm_sha1msg2_epu32(_mm_xor_si128(_mm_sha1msg1_epu32(w0, w1), w2), w3);
+}
+
+static void sha1Blocks(uint32_t* hash, const unsigned char* data, size_t count) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hash)), 0x1b);
+    __m128i e0 = _mm_set_epi32(hash[4], 0, 0, 0);
+
+    for (; count > 0; --count, data += 64) {
+        const __m128i abcdSaved = abcd;
+        const __m128i e0Saved = e0;
 
-        return digest;
+        __m128i w0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), byteSwap);
+        __m128i w1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)), byteSwap);
+        __m128i w2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)), byteSwap);
+        __m128i w3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)), byteSwap);
+
+        __m128i previous = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, _mm_add_epi32(e0, w0), 0);
+        sha1Rounds<0>(abcd, previous, w1);
+        sha1Rounds<0>(abcd, previous, w2);
+        sha1Rounds<0>(abcd, previous, w3);
+        w0 = sha1Schedule(w0, w1, w2, w3);
+        sha1Rounds<0>(abcd, previous, w0);
+        w1 = sha1Schedule(w1, w2, w3, w0);
+        sha1Rounds<1>(abcd, previous, w1);
+        w2 = sha1Schedule(w2, w3, w0, w1);
+        sha1Rounds<1>(abcd, previous, w2);
+        w3 = sha1Schedule(w3, w0, w1, w2);
+        sha1Rounds<1>(abcd, previous, w3);
+        w0 = sha1Schedule(w0, w1, w2, w3);
+        sha1Rounds<1>(abcd, previous, w0);
+        w1 = sha1Schedule(w1, w2, w3, w0);
+        sha1Rounds<1>(abcd, previous, w1);
+        w2 = sha1Schedule(w2, w3, w0, w1);
+        sha1Rounds<2>(abcd, previous, w2);
+        w3 = sha1Schedule(w3, w0, w1, w2);
+        sha1Rounds<2>(abcd, previous, w3);
+        w0 = sha1Schedule(w0, w1, w2, w3);
+        sha1Rounds<2>(abcd, previous, w0);
+        w1 = sha1Schedule(w1, w2, w3, w0);
+        sha1Rounds<2>(abcd, previous, w1);
+        w2 = sha1Schedule(w2, w3, w0, w1);
+        sha1Rounds<2>(abcd, previous, w2);
+        w3 = sha1Schedule(w3, w0, w1, w2);
+        sha1Rounds<3>(abcd, previous, w3);
+        w0 = sha1Schedule(w0, w1, w2, w3);
+        sha1Rounds<3>(abcd, previous, w0);
+        w1 = sha1Schedule(w1, w2, w3, w0);
+        sha1Rounds<3>(abcd, previous, w1);
+        w2 = sha1Schedule(w2, w3, w0, w1);
+        sha1Rounds<3>(abcd, previous, w2);
+        w3 = sha1Schedule(w3, w0, w1, w2);
+        sha1Rounds<3>(abcd, previous, w3);
+
+        e0 = _mm_sha1nexte_epu32(previous, e0Saved);
+        abcd = _mm_add_epi32(abcd, abcdSaved);
     }
 
-private:
-    NTSTATUS _init() {
-        DWORD cbHashObject;
-        DWORD cbResult;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(hash), _mm_shuffle_epi32(abcd, 0x1b));
+    hash[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+// Four rounds of SHA-256, two at a time, with state0 holding ABEF and state1 CDGH.
+static inline void sha256Rounds(__m128i& state0, __m128i& state1, __m128i w, size_t i) {
+    const __m128i words = _mm_add_epi32(w, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c_sha256Constants + i)));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, words);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(words, 0x0e));
+}
+
+static inline __m128i sha256Schedule(__m128i w0, __m128i w1, __m128i w2, __m128i w3) {
+    return _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w0, w1), _mm_alignr_epi8(w3, w2, 4)), w3);
+}
+
+static void sha256Blocks(uint32_t* hash, const unsigned char* data, size_t count) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    const __m128i dcba = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hash)), 0xb1);
+    const __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hash + 4)), 0x1b);
+    __m128i state0 = _mm_alignr_epi8(dcba, efgh, 8);
+    __m128i state1 = _mm_blend_epi16(efgh, dcba, 0xf0);
+
+    for (; count > 0; --count, data += 64) {
+        const __m128i state0Saved = state0;
+        const __m128i state1Saved = state1;
 
-        RETURN_IF_NTSTATUS_FAILED_LOG(BCryptOpenAlgorithmProvider(&_hAlg, _algorithm, NULL, 0));
-        RETURN_IF_NTSTATUS_FAILED_LOG(
-            BCryptGetProperty(_hAlg, BCRYPT_OBJECT_LENGTH, reinterpret_cast<PBYTE>(&cbHashObject), sizeof(DWORD), &cbResult, 0));
+        __m128i w0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), byteSwap);
+        __m128i w1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)), byteSwap);
+        __m128i w2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)), byteSwap);
+        __m128i w3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)), byteSwap);
 
-        _pHashObject = new BYTE[cbHashObject];
-        if (_pHashObject == nullptr) {
-            RETURN_IF_NTSTATUS_FAILED_MSG(STATUS_NO_MEMORY, "CC_Digest_State Unable to allocate Hash object");
+        sha256Rounds(state0, state1, w0, 0);
+        sha256Rounds(state0, state1, w1, 4);
+        sha256Rounds(state0, state1, w2, 8);
+        sha256Rounds(state0, state1, w3, 12);
+        for (size_t i = 16; i < 64; i += 16) {
+            w0 = sha256Schedule(w0, w1, w2, w3);
+            sha256Rounds(state0, state1, w0, i);
+            w1 = sha256Schedule(w1, w2, w3, w0);
+            sha256Rounds(state0, state1, w1, i + 4);
+            w2 = sha256Schedule(w2, w3, w0, w1);
+            sha256Rounds(state0, state1, w2, i + 8);
+            w3 = sha256Schedule(w3, w0, w1, w2);
+            sha256Rounds(state0, state1, w3, i + 12);
         }
 
-        RETURN_IF_NTSTATUS_FAILED_LOG(BCryptCreateHash(_hAlg, &_hHash, _pHashObject, cbHashObject, NULL, 0, 0));
+        state0 = _mm_add_epi32(state0, state0Saved);
+        state1 = _mm_add_epi32(state1, state1Saved);
+    }
+
+    const __m128i feba = _mm_shuffle_epi32(state0, 0x1b);
+    const __m128i dchg = _mm_shuffle_epi32(state1, 0xb1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(hash), _mm_blend_epi16(feba, dchg, 0xf0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(hash + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
 
-        return 0;
+// Two messages at a time for CC_SHA256_Batch: a single one leaves the SHA unit waiting on each round's result, which
+// the other message's rounds fill in. The states are kept as ABEF and CDGH.
+struct Sha256Pair {
+    static const size_t width = 2;
+    __m128i state0[2];
+    __m128i state1[2];
+
+    void start(size_t lane) {
+        const __m128i dcba = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(c_sha256Start)), 0xb1);
+        const __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(c_sha256Start + 4)), 0x1b);
+        state0[lane] = _mm_alignr_epi8(dcba, efgh, 8);
+        state1[lane] = _mm_blend_epi16(efgh, dcba, 0xf0);
     }
 
-    static bool _isValidState(CC_Digest_State* state) {
-        if (!state) {
-            return false;
+    void finish(size_t lane, unsigned char* digest) const {
+        uint32_t hash[8];
+        const __m128i feba = _mm_shuffle_epi32(state0[lane], 0x1b);
+        const __m128i dchg = _mm_shuffle_epi32(state1[lane], 0xb1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(hash), _mm_blend_epi16(feba, dchg, 0xf0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(hash + 4), _mm_alignr_epi8(dchg, feba, 8));
+        for (size_t i = 0; i < 8; ++i) {
+            _storeBigEndian32(digest + 4 * i, hash[i]);
         }
+    }
 
-        // at this point, state has to be either NULL or valid
-        if (state->_hHash == INVALID_HANDLE_VALUE) {
-            delete state;
-            return false;
+    void compress(const unsigned char* const* blocks) {
+        const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+        __m128i a0 = state0[0], a1 = state1[0];
+        __m128i b0 = state0[1], b1 = state1[1];
+
+        __m128i v[4];
+        __m128i w[4];
+        for (size_t i = 0; i < 4; ++i) {
+            v[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks[0] + 16 * i)), byteSwap);
+            w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks[1] + 16 * i)), byteSwap);
+        }
+
+        for (size_t i = 0; i < 16; i += 4) {
+            sha256Rounds(a0, a1, v[i / 4], i);
+            sha256Rounds(b0, b1, w[i / 4], i);
+        }
+        for (size_t i = 16; i < 64; i += 16) {
+            v[0] = sha256Schedule(v[0], v[1], v[2], v[3]);
+            w[0] = sha256Schedule(w[0], w[1], w[2], w[3]);
+            sha256Rounds(a0, a1, v[0], i);
+            sha256Rounds(b0, b1, w[0], i);
+            v[1] = sha256Schedule(v[1], v[2], v[3], v[0]);
+            w[1] = sha256Schedule(w[1], w[2], w[3], w[0]);
+            sha256Rounds(a0, a1, v[1], i + 4);
+            sha256Rounds(b0, b1, w[1], i + 4);
+            v[2] = sha256Schedule(v[2], v[3], v[0], v[1]);
+            w[2] = sha256Schedule(w[2], w[3], w[0], w[1]);
+            sha256Rounds(a0, a1, v[2], i + 8);
+            sha256Rounds(b0, b1, w[2], i + 8);
+            v[3] = sha256Schedule(v[3], v[0], v[1], v[2]);
+            w[3] = sha256Schedule(w[3], w[0], w[1], w[2]);
+            sha256Rounds(a0, a1, v[3], i + 12);
+            sha256Rounds(b0, b1, w[3], i + 12);
         }
 
-        return true;
+        state0[0] = _mm_add_epi32(state0[0], a0);
+        state1[0] = _mm_add_epi32(state1[0], a1);
+        state0[1] = _mm_add_epi32(state0[1], b0);
+        state1[1] = _mm_add_epi32(state1[1], b1);
     }
+};
+
+static void sha256Batch(const void* const* data, const CC_LONG* lengths, unsigned char* const* digests, size_t count) {
+    _sha256BatchLanes<Sha256Pair>(data, lengths, digests, count);
+}
+
+} // namespace shaExtensions
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push(__attribute__((target("sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+#endif
+
+namespace sse41 {
+
+struct Words {
+    typedef __m128i R;
+    static const size_t width = 4;
+
+    static R load(const uint32_t* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    static void store(uint32_t* p, R a) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a);
+    }
+    static R set1(uint32_t a) {
+        return _mm_set1_epi32(static_cast<int>(a));
+    }
+    static R add(R a, R b) {
+        return _mm_add_epi32(a, b);
+    }
+    static R bitAnd(R a, R b) {
+        return _mm_and_si128(a, b);
+    }
+    static R bitAndNot(R a, R b) {
+        return _mm_andnot_si128(a, b);
+    }
+    static R bitOr(R a, R b) {
+        return _mm_or_si128(a, b);
+    }
+    static R bitXor(R a, R b) {
+        return _mm_xor_si128(a, b);
+    }
+    static R shiftRight(R a, int n) {
+        return _mm_srli_epi32(a, n);
+    }
+    static R rotateRight(R a, int n) {
+        return _mm_or_si128(_mm_srli_epi32(a, n), _mm_slli_epi32(a, 32 - n));
+    }
+};
+
+#include "CommonDigestLanes.inc"
+
+} // namespace sse41
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace avx2 {
+
+struct Words {
+    typedef __m256i R;
+    static const size_t width = 8;
+
+    static R load(const uint32_t* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    static void store(uint32_t* p, R a) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a);
+    }
+    static R set1(uint32_t a) {
+        return _mm256_set1_epi32(static_cast<int>(a));
+    }
+    static R add(R a, R b) {
+        return _mm256_add_epi32(a, b);
+    }
+    static R bitAnd(R a, R b) {
+        return _mm256_and_si256(a, b);
+    }
+    static R bitAndNot(R a, R b) {
+        return _mm256_andnot_si256(a, b);
+    }
+    static R bitOr(R a, R b) {
+        return _mm256_or_si256(a, b);
+    }
+    static R bitXor(R a, R b) {
+        return _mm256_xor_si256(a, b);
+    }
+    static R shiftRight(R a, int n) {
+        return _mm256_srli_epi32(a, n);
+    }
+    static R rotateRight(R a, int n) {
+        return _mm256_or_si256(_mm256_srli_epi32(a, n), _mm256_slli_epi32(a, 32 - n));
+    }
+};
 
-    int _hashData(const BYTE* data, CC_LONG length) {
-        NTSTATUS status = BCryptHashData(_hHash, const_cast<BYTE*>(data), length, 0);
-        if (SUCCEEDED_NTSTATUS(status)) {
+#include "CommonDigestLanes.inc"
+
+} // namespace avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+static void _cpuid(int leaf, int registers[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    __cpuidex(registers, leaf, 0);
+#else
+    unsigned int eax, ebx, ecx, edx;
+    __cpuid_count(leaf, 0, eax, ebx, ecx, edx);
+    registers[0] = eax;
+    registers[1] = ebx;
+    registers[2] = ecx;
+    registers[3] = edx;
+#endif
+}
+
+static bool _hasSSE41() {
+    int registers[4];
+    _cpuid(1, registers);
+    return (registers[2] & (1 << 19)) != 0;
+}
+
+static bool _hasLeaf7() {
+    int registers[4];
+    _cpuid(0, registers);
+    return registers[0] >= 7;
+}
+
+static bool _hasSHA() {
+    if (!_hasSSE41() || !_hasLeaf7()) {
+        return false;
+    }
+
+    int registers[4];
+    _cpuid(7, registers);
+    return (registers[1] & (1 << 29)) != 0;
+}
+
+static bool _hasAVX2() {
+    if (!_hasLeaf7()) {
+        return false;
+    }
+
+    // The OS has to save the upper halves of the ymm registers (OSXSAVE, then XCR0 bits 1 and 2) as well
+    int registers[4];
+    _cpuid(1, registers);
+    const int osxsaveAndAVX = (1 << 27) | (1 << 28);
+    if ((registers[2] & osxsaveAndAVX) != osxsaveAndAVX) {
+        return false;
+    }
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned int xcr0Low, xcr0High;
+    __asm__ __volatile__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    unsigned long long xcr0 = xcr0Low;
+#endif
+    if ((xcr0 & 0x6) != 0x6) {
+        return false;
+    }
+
+    _cpuid(7, registers);
+    return (registers[1] & (1 << 5)) != 0;
+}
+
+#elif DIGEST_ARM64
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("crypto"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("+crypto")
+#endif
+
+namespace shaExtensions {
+
+static inline uint32x4_t loadWords(const unsigned char* p) {
+    return vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p)));
+}
+
+// Four rounds of SHA-1 (F selecting the round function), taking this group's E and leaving the next one's.
+template <int F>
+static inline void sha1Rounds(uint32x4_t& abcd, uint32_t& e, uint32x4_t w, uint32_t constant) {
+    const uint32x4_t words = vaddq_u32(w, vdupq_n_u32(constant));
+    const uint32_t next = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+    if (F == 0) {
+        abcd = vsha1cq_u32(abcd, e, words);
+    } else if (F == 2) {
+        abcd = vsha1mq_u32(abcd, e, words);
+    } else {
+        abcd = vsha1pq_u32(abcd, e, words);
+    }
+    e = next;
+}
+
+static inline uint32x4_t sha1Schedule(uint32x4_t w0, uint32x4_t w1, uint32x4_t w2, uint32x4_t w3) {
+    return vsha1su1q_u32(vsha1su0q_u32(w0, w1, w2), w3);
+}
+
+static void sha1Blocks(uint32_t* hash, const unsigned char* data, size_t count) {
+    static const uint32_t constants[4] = { 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6 };
+
+    uint32x4_t abcd = vld1q_u32(hash);
+    uint32_t e0 = hash[4];
+    for (; count > 0; --count, data += 64) {
+        const uint32x4_t abcdSaved = abcd;
+        const uint32_t e0Saved = e0;
+
+        uint32x4_t w[4] = { loadWords(data), loadWords(data + 16), loadWords(data + 32), loadWords(data + 48) };
+        uint32_t e = e0;
+        for (size_t group = 0; group < 20; ++group) {
+            if (group >= 4) {
+                w[group % 4] = sha1Schedule(w[group % 4], w[(group + 1) % 4], w[(group + 2) % 4], w[(group + 3) % 4]);
+            }
+            const uint32x4_t words = w[group % 4];
+            switch (group / 5) {
+                case 0:
+                    sha1Rounds<0>(abcd, e, words, constants[0]);
+                    break;
+                case 1:
+                    sha1Rounds<1>(abcd, e, words, constants[1]);
+                    break;
+                case 2:
+                    sha1Rounds<2>(abcd, e, words, constants[2]);
+                    break;
+                default:
+                    sha1Rounds<3>(abcd, e, words, constants[3]);
+                    break;
+            }
+        }
+
+        e0 = e + e0Saved;
+        abcd = vaddq_u32(abcd, abcdSaved);
+    }
+
+    vst1q_u32(hash, abcd);
+    hash[4] = e0;
+}
+
+// Four rounds of SHA-256, with state0 holding ABCD and state1 EFGH.
+static inline void sha256Rounds(uint32x4_t& state0, uint32x4_t& state1, uint32x4_t w, size_t i) {
+    const uint32x4_t words = vaddq_u32(w, vld1q_u32(c_sha256Constants + i));
+    const uint32x4_t abcd = state0;
+    state0 = vsha256hq_u32(state0, state1, words);
+    state1 = vsha256h2q_u32(state1, abcd, words);
+}
+
+static inline uint32x4_t sha256Schedule(uint32x4_t w0, uint32x4_t w1, uint32x4_t w2, uint32x4_t w3) {
+    return vsha256su1q_u32(vsha256su0q_u32(w0, w1), w2, w3);
+}
+
+static void sha256Blocks(uint32_t* hash, const unsigned char* data, size_t count) {
+    uint32x4_t state0 = vld1q_u32(hash);
+    uint32x4_t state1 = vld1q_u32(hash + 4);
+    for (; count > 0; --count, data += 64) {
+        const uint32x4_t state0Saved = state0;
+        const uint32x4_t state1Saved = state1;
+
+        uint32x4_t w0 = loadWords(data);
+        uint32x4_t w1 = loadWords(data + 16);
+        uint32x4_t w2 = loadWords(data + 32);
+        uint32x4_t w3 = loadWords(data + 48);
+
+        sha256Rounds(state0, state1, w0, 0);
+        sha256Rounds(state0, state1, w1, 4);
+        sha256Rounds(state0, state1, w2, 8);
+        sha256Rounds(state0, state1, w3, 12);
+        for (size_t i = 16; i < 64; i += 16) {
+            w0 = sha256Schedule(w0, w1, w2, w3);
+            sha256Rounds(state0, state1, w0, i);
+            w1 = sha256Schedule(w1, w2, w3, w0);
+            sha256Rounds(state0, state1, w1, i + 4);
+            w2 = sha256Schedule(w2, w3, w0, w1);
+            sha256Rounds(state0, state1, w2, i + 8);
+            w3 = sha256Schedule(w3, w0, w1, w2);
+            sha256Rounds(state0, state1, w3, i + 12);
+        }
+
+        state0 = vaddq_u32(state0, state0Saved);
+        state1 = vaddq_u32(state1, state1Saved);
+    }
+
+    vst1q_u32(hash, state0);
+    vst1q_u32(hash + 4, state1);
+}
+
+} // namespace shaExtensions
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+static bool _hasSHA() {
+    return IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) != FALSE;
+}
+
+#endif
+
+// SHA-1 and SHA-256 block functions, and the batch one, for this processor.
+struct DigestEngines {
+    void (*sha1Blocks)(uint32_t* hash, const unsigned char* data, size_t count);
+    void (*sha256Blocks)(uint32_t* hash, const unsigned char* data, size_t count);
+    void (*sha256Batch)(const void* const* data, const CC_LONG* lengths, unsigned char* const* digests, size_t count);
+};
+
+static void _sha256BatchOneByOne(const void* const* data, const CC_LONG* lengths, unsigned char* const* digests, size_t count);
+
+static DigestEngines _detectEngines() {
+    DigestEngines engines = { _sha1BlocksPortable, _sha256BlocksPortable, _sha256BatchOneByOne };
+#if DIGEST_X86
+    if (_hasAVX2()) {
+        engines.sha256Batch = avx2::sha256Batch;
+    } else if (_hasSSE41()) {
+        engines.sha256Batch = sse41::sha256Batch;
+    }
+    if (_hasSHA()) {
+        engines.sha1Blocks = shaExtensions::sha1Blocks;
+        engines.sha256Blocks = shaExtensions::sha256Blocks;
+        engines.sha256Batch = shaExtensions::sha256Batch;
+    }
+#elif DIGEST_ARM64
+    if (_hasSHA()) {
+        engines.sha1Blocks = shaExtensions::sha1Blocks;
+        engines.sha256Blocks = shaExtensions::sha256Blocks;
+    }
+#endif
+    return engines;
+}
+
+static const DigestEngines& _engines() {
+    static const DigestEngines s_engines = _detectEngines();
+    return s_engines;
+}
+
+static void _sha1Blocks(CC_Digest_State* ctx, const unsigned char* data, size_t count) {
+    _engines().sha1Blocks(ctx->hash.words, data, count);
+}
+
+static void _sha256Blocks(CC_Digest_State* ctx, const unsigned char* data, size_t count) {
+    _engines().sha256Blocks(ctx->hash.words, data, count);
+}
+
+// How each algorithm pads its last block and lays out its digest.
+enum DigestPadding { MD2Padding, LittleEndianLength, BigEndianLength, BigEndianLength128 };
+
+struct DigestAlgorithm {
+    size_t blockBytes;
+    size_t digestLength;
+    DigestPadding padding;
+    void (*blocks)(CC_Digest_State* ctx, const unsigned char* data, size_t count);
+};
+
+static const DigestAlgorithm c_md2 = { c_md2BlockBytes, CC_MD2_DIGEST_LENGTH, MD2Padding, _md2Blocks };
+static const DigestAlgorithm c_md4 = { 64, CC_MD4_DIGEST_LENGTH, LittleEndianLength, _md4Blocks };
+static const DigestAlgorithm c_md5 = { 64, CC_MD5_DIGEST_LENGTH, LittleEndianLength, _md5Blocks };
+static const DigestAlgorithm c_sha1 = { 64, CC_SHA1_DIGEST_LENGTH, BigEndianLength, _sha1Blocks };
+static const DigestAlgorithm c_sha224 = { 64, CC_SHA224_DIGEST_LENGTH, BigEndianLength, _sha256Blocks };
+static const DigestAlgorithm c_sha256 = { 64, CC_SHA256_DIGEST_LENGTH, BigEndianLength, _sha256Blocks };
+static const DigestAlgorithm c_sha384 = { 128, CC_SHA384_DIGEST_LENGTH, BigEndianLength128, _sha512Blocks };
+static const DigestAlgorithm c_sha512 = { 128, CC_SHA512_DIGEST_LENGTH, BigEndianLength128, _sha512Blocks };
+
+static int _init(CC_Digest_State* ctx, const void* start, size_t startBytes) {
+    if (!ctx) {
+        return -1;
+    }
+
+    memset(ctx, 0, sizeof(*ctx));
+    if (startBytes > 0) {
+        memcpy(ctx->hash.bytes, start, startBytes);
+    }
+    return 1;
+}
+
+// internal implementation of update for all hash contexts
+static int _update(const DigestAlgorithm& algorithm, CC_Digest_State* ctx, const void* data, CC_LONG len) {
+    if (!ctx || (!data && len > 0)) {
+        return -1;
+    }
+
+    if (len == 0) {
+        return 1;
+    }
+
+    const unsigned char* in = static_cast<const unsigned char*>(data);
+    size_t length = len;
+    const size_t buffered = static_cast<size_t>(ctx->count % algorithm.blockBytes);
+    ctx->count += length;
+
+    if (buffered > 0) {
+        const size_t filling = std::min(algorithm.blockBytes - buffered, length);
+        memcpy(ctx->buffer + buffered, in, filling);
+        if (buffered + filling < algorithm.blockBytes) {
             return 1;
         }
+        algorithm.blocks(ctx, ctx->buffer, 1);
+        in += filling;
+        length -= filling;
+    }
+
+    const size_t blocks = length / algorithm.blockBytes;
+    if (blocks > 0) {
+        algorithm.blocks(ctx, in, blocks);
+        in += blocks * algorithm.blockBytes;
+        length -= blocks * algorithm.blockBytes;
+    }
+
+    memcpy(ctx->buffer, in, length);
+    return 1;
+}
+
+// The message length in bits, ending at the end of the last block.
+static void _storeLength(DigestPadding padding, unsigned char* end, uint64_t count) {
+    if (padding == LittleEndianLength) {
+        _storeLittleEndian32(end - 8, static_cast<uint32_t>(count << 3));
+        _storeLittleEndian32(end - 4, static_cast<uint32_t>(count >> 29));
+    } else {
+        _storeBigEndian64(end - 8, count << 3);
+        if (padding == BigEndianLength128) {
+            _storeBigEndian64(end - 16, count >> 61);
+        }
+    }
+}
+
+static void _storeDigest(DigestPadding padding, size_t digestLength, unsigned char* digest, const CC_Digest_State* ctx) {
+    if (padding == LittleEndianLength) {
+        for (size_t i = 0; i < digestLength / 4; ++i) {
+            _storeLittleEndian32(digest + 4 * i, ctx->hash.words[i]);
+        }
+    } else if (padding == BigEndianLength) {
+        for (size_t i = 0; i < digestLength / 4; ++i) {
+            _storeBigEndian32(digest + 4 * i, ctx->hash.words[i]);
+        }
+    } else {
+        for (size_t i = 0; i < digestLength / 8; ++i) {
+            _storeBigEndian64(digest + 8 * i, ctx->hash.longs[i]);
+        }
+    }
+}
 
-        LOG_NTSTATUS_MSG(status, "BCryptHashData failed\n");
+// internal implementation of final for all hash contexts, which are cleared afterwards
+static int _final(const DigestAlgorithm& algorithm, unsigned char* digest, CC_Digest_State* ctx) {
+    if (!ctx || !digest) {
         return -1;
     }
 
-    void _finishHash(BYTE* digest) {
-        LOG_IF_NTSTATUS_FAILED(BCryptFinishHash(_hHash, digest, _digestLength, 0));
+    const size_t blockBytes = algorithm.blockBytes;
+    size_t buffered = static_cast<size_t>(ctx->count % blockBytes);
+    if (algorithm.padding == MD2Padding) {
+        // i bytes of i to fill the block, then the checksum as a block of its own.
+        const size_t padding = blockBytes - buffered;
+        memset(ctx->buffer + buffered, static_cast<int>(padding), padding);
+        _md2Blocks(ctx, ctx->buffer, 1);
+        memcpy(ctx->buffer, ctx->hash.bytes + 48, blockBytes);
+        _md2Transform(ctx->hash.bytes, ctx->buffer);
+        memcpy(digest, ctx->hash.bytes, algorithm.digestLength);
+        memset(ctx, 0, sizeof(*ctx));
+        return 1;
     }
 
-    const unsigned int _digestLength;
-    const LPCWSTR _algorithm;
-    BCRYPT_ALG_HANDLE _hAlg;
-    BCRYPT_HASH_HANDLE _hHash;
-    PBYTE _pHashObject;
-};
+    // A one bit, then zeros up to the length in bits at the end of the last block.
+    const size_t lengthBytes = (algorithm.padding == BigEndianLength128) ? 16 : 8;
+    ctx->buffer[buffered++] = 0x80;
+    if (buffered > blockBytes - lengthBytes) {
+        memset(ctx->buffer + buffered, 0, blockBytes - buffered);
+        algorithm.blocks(ctx, ctx->buffer, 1);
+        buffered = 0;
+    }
+    memset(ctx->buffer + buffered, 0, blockBytes - buffered);
+
+    _storeLength(algorithm.padding, ctx->buffer + blockBytes, ctx->count);
+    algorithm.blocks(ctx, ctx->buffer, 1);
+    _storeDigest(algorithm.padding, algorithm.digestLength, digest, ctx);
+
+    memset(ctx, 0, sizeof(*ctx));
+    return 1;
+}
+
+// internal implementation of the one shot methods for all hash contexts
+static unsigned char* _oneShotDigest(const DigestAlgorithm& algorithm,
+                                     const void* start,
+                                     size_t startBytes,
+                                     const void* input,
+                                     CC_LONG length,
+                                     unsigned char* digest) {
+    CC_Digest_State ctx;
+    _init(&ctx, start, startBytes);
+    const int updateResult = _update(algorithm, &ctx, input, length);
+
+    // Final should be called even if update fails.
+    if (_final(algorithm, digest, &ctx) < 0 || updateResult < 0) {
+        return nullptr;
+    }
+
+    return digest;
+}
+
+static void _sha256BatchOneByOne(const void* const* data, const CC_LONG* lengths, unsigned char* const* digests, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        _oneShotDigest(c_sha256, c_sha256Start, sizeof(c_sha256Start), data[i], lengths[i], digests[i]);
+    }
+}
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_MD2_Init(CC_MD2_CTX* ctx) {
-    return CC_Digest_State::init(ctx, CC_MD2_DIGEST_LENGTH, BCRYPT_MD2_ALGORITHM);
+    return _init(ctx, nullptr, 0);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_MD2_Update(CC_MD2_CTX* ctx, const void* data, CC_LONG len) {
-    return CC_Digest_State::update(ctx, data, len);
+    return _update(c_md2, ctx, data, len);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_MD2_Final(unsigned char* digest, CC_MD2_CTX* ctx) {
-    return CC_Digest_State::final(digest, ctx);
+    return _final(c_md2, digest, ctx);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" unsigned char* CC_MD2(const void* input, CC_LONG length, unsigned char* digest) {
-    return CC_Digest_State::oneShotDigest(CC_MD2_Init, CC_MD2_Update, CC_MD2_Final, input, length, digest);
+    return _oneShotDigest(c_md2, nullptr, 0, input, length, digest);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_MD4_Init(CC_MD4_CTX* ctx) {
-    return CC_Digest_State::init(ctx, CC_MD4_DIGEST_LENGTH, BCRYPT_MD4_ALGORITHM);
+    return _init(ctx, c_md5Start, sizeof(c_md5Start));
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_MD4_Update(CC_MD4_CTX* ctx, const void* data, CC_LONG len) {
-    return CC_Digest_State::update(ctx, data, len);
+    return _update(c_md4, ctx, data, len);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_MD4_Final(unsigned char* digest, CC_MD4_CTX* ctx) {
-    return CC_Digest_State::final(digest, ctx);
+    return _final(c_md4, digest, ctx);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" unsigned char* CC_MD4(const void* input, CC_LONG length, unsigned char* digest) {
-    return CC_Digest_State::oneShotDigest(CC_MD4_Init, CC_MD4_Update, CC_MD4_Final, input, length, digest);
+    return _oneShotDigest(c_md4, c_md5Start, sizeof(c_md5Start), input, length, digest);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_MD5_Init(CC_MD5_CTX* ctx) {
-    return CC_Digest_State::init(ctx, CC_MD5_DIGEST_LENGTH, BCRYPT_MD5_ALGORITHM);
+    return _init(ctx, c_md5Start, sizeof(c_md5Start));
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_MD5_Update(CC_MD5_CTX* ctx, const void* data, CC_LONG len) {
-    return CC_Digest_State::update(ctx, data, len);
+    return _update(c_md5, ctx, data, len);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_MD5_Final(unsigned char* digest, CC_MD5_CTX* ctx) {
-    return CC_Digest_State::final(digest, ctx);
+    return _final(c_md5, digest, ctx);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" unsigned char* CC_MD5(const void* input, CC_LONG length, unsigned char* digest) {
-    return CC_Digest_State::oneShotDigest(CC_MD5_Init, CC_MD5_Update, CC_MD5_Final, input, length, digest);
+    return _oneShotDigest(c_md5, c_md5Start, sizeof(c_md5Start), input, length, digest);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_SHA1_Init(CC_SHA1_CTX* ctx) {
-    return CC_Digest_State::init(ctx, CC_SHA1_DIGEST_LENGTH, BCRYPT_SHA1_ALGORITHM);
+    return _init(ctx, c_sha1Start, sizeof(c_sha1Start));
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_SHA1_Update(CC_SHA1_CTX* ctx, const void* data, CC_LONG len) {
-    return CC_Digest_State::update(ctx, data, len);
+    return _update(c_sha1, ctx, data, len);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_SHA1_Final(unsigned char* digest, CC_SHA1_CTX* ctx) {
-    return CC_Digest_State::final(digest, ctx);
+    return _final(c_sha1, digest, ctx);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" unsigned char* CC_SHA1(const void* input, CC_LONG length, unsigned char* digest) {
-    return CC_Digest_State::oneShotDigest(CC_SHA1_Init, CC_SHA1_Update, CC_SHA1_Final, input, length, digest);
+    return _oneShotDigest(c_sha1, c_sha1Start, sizeof(c_sha1Start), input, length, digest);
 }
 
 /**
-@Status Stub
+@Status Interoperable
 */
 extern "C" int CC_SHA224_Init(CC_SHA224_CTX* ctx) {
-    UNIMPLEMENTED();
-    return StubReturn();
+    return _init(ctx, c_sha224Start, sizeof(c_sha224Start));
 }
 
 /**
-@Status Stub
+@Status Interoperable
 */
 extern "C" int CC_SHA224_Update(CC_SHA224_CTX* ctx, const void* data, CC_LONG len) {
-    UNIMPLEMENTED();
-    return StubReturn();
+    return _update(c_sha224, ctx, data, len);
 }
 
 /**
-@Status Stub
+@Status Interoperable
 */
 extern "C" int CC_SHA224_Final(unsigned char* digest, CC_SHA224_CTX* ctx) {
-    UNIMPLEMENTED();
-    return StubReturn();
+    return _final(c_sha224, digest, ctx);
 }
 
 /**
-@Status Stub
+@Status Interoperable
 */
 extern "C" unsigned char* CC_SHA224(const void* input, CC_LONG length, unsigned char* digest) {
-    UNIMPLEMENTED();
-    return StubReturn();
+    return _oneShotDigest(c_sha224, c_sha224Start, sizeof(c_sha224Start), input, length, digest);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_SHA256_Init(CC_SHA256_CTX* ctx) {
-    return CC_Digest_State::init(ctx, CC_SHA256_DIGEST_LENGTH, BCRYPT_SHA256_ALGORITHM);
+    return _init(ctx, c_sha256Start, sizeof(c_sha256Start));
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_SHA256_Update(CC_SHA256_CTX* ctx, const void* data, CC_LONG len) {
-    return CC_Digest_State::update(ctx, data, len);
+    return _update(c_sha256, ctx, data, len);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_SHA256_Final(unsigned char* digest, CC_SHA256_CTX* ctx) {
-    return CC_Digest_State::final(digest, ctx);
+    return _final(c_sha256, digest, ctx);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" unsigned char* CC_SHA256(const void* input, CC_LONG length, unsigned char* digest) {
-    return CC_Digest_State::oneShotDigest(CC_SHA256_Init, CC_SHA256_Update, CC_SHA256_Final, input, length, digest);
+    return _oneShotDigest(c_sha256, c_sha256Start, sizeof(c_sha256Start), input, length, digest);
+}
+
+/**
+@Status Interoperable
+@Notes Not part of Apple's CommonCrypto.
+*/
+extern "C" int CC_SHA256_Batch(const void* const* data, const CC_LONG* lengths, unsigned char* const* digests, size_t count) {
+    if (count > 0 && (!data || !lengths || !digests)) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if ((!data[i] && lengths[i] > 0) || !digests[i]) {
+            return -1;
+        }
+    }
+
+    _engines().sha256Batch(data, lengths, digests, count);
+    return 1;
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_SHA384_Init(CC_SHA384_CTX* ctx) {
-    return CC_Digest_State::init(ctx, CC_SHA384_DIGEST_LENGTH, BCRYPT_SHA384_ALGORITHM);
+    return _init(ctx, c_sha384Start, sizeof(c_sha384Start));
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_SHA384_Update(CC_SHA384_CTX* ctx, const void* data, CC_LONG len) {
-    return CC_Digest_State::update(ctx, data, len);
+    return _update(c_sha384, ctx, data, len);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_SHA384_Final(unsigned char* digest, CC_SHA384_CTX* ctx) {
-    return CC_Digest_State::final(digest, ctx);
+    return _final(c_sha384, digest, ctx);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" unsigned char* CC_SHA384(const void* input, CC_LONG length, unsigned char* digest) {
-    return CC_Digest_State::oneShotDigest(CC_SHA384_Init, CC_SHA384_Update, CC_SHA384_Final, input, length, digest);
+    return _oneShotDigest(c_sha384, c_sha384Start, sizeof(c_sha384Start), input, length, digest);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_SHA512_Init(CC_SHA512_CTX* ctx) {
-    return CC_Digest_State::init(ctx, CC_SHA512_DIGEST_LENGTH, BCRYPT_SHA512_ALGORITHM);
+    return _init(ctx, c_sha512Start, sizeof(c_sha512Start));
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_SHA512_Update(CC_SHA512_CTX* ctx, const void* data, CC_LONG len) {
-    return CC_Digest_State::update(ctx, data, len);
+    return _update(c_sha512, ctx, data, len);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" int CC_SHA512_Final(unsigned char* digest, CC_SHA512_CTX* ctx) {
-    return CC_Digest_State::final(digest, ctx);
+    return _final(c_sha512, digest, ctx);
 }
 
 /**
 @Status Interoperable
 */
 extern "C" unsigned char* CC_SHA512(const void* input, CC_LONG length, unsigned char* digest) {
-    return CC_Digest_State::oneShotDigest(CC_SHA512_Init, CC_SHA512_Update, CC_SHA512_Final, input, length, digest);
+    return _oneShotDigest(c_sha512, c_sha512Start, sizeof(c_sha512Start), input, length, digest);
+}
+
+// The functions behind CommonDigestInternal.h, for HMAC and the key derivation functions.
+
+template <DigestPadding padding, size_t blockBytes>
+static void _padBlock(unsigned char* block, size_t messageBytes, uint64_t totalBytes) {
+    block[messageBytes] = 0x80;
+    memset(block + messageBytes + 1, 0, blockBytes - messageBytes - 1);
+    _storeLength(padding, block + blockBytes, totalBytes);
+}
+
+template <DigestPadding padding, size_t digestLength>
+static void _storeHash(unsigned char* digest, const CC_Digest_State* ctx) {
+    _storeDigest(padding, digestLength, digest, ctx);
+}
+
+#define DIGEST_FUNCTIONS(name, blockBytes, padding, blocks)                                                                  \
+    {                                                                                                                        \
+        blockBytes, CC_##name##_DIGEST_LENGTH, CC_##name##_Init, CC_##name##_Update, CC_##name##_Final, blocks,             \
+            _padBlock<padding, blockBytes>, _storeHash<padding, CC_##name##_DIGEST_LENGTH>                                   \
+    }
+
+// In the order of DigestKind
+static const DigestFunctions c_digestFunctions[] = {
+    DIGEST_FUNCTIONS(MD5, 64, LittleEndianLength, _md5Blocks),
+    DIGEST_FUNCTIONS(SHA1, 64, BigEndianLength, _sha1Blocks),
+    DIGEST_FUNCTIONS(SHA224, 64, BigEndianLength, _sha256Blocks),
+    DIGEST_FUNCTIONS(SHA256, 64, BigEndianLength, _sha256Blocks),
+    DIGEST_FUNCTIONS(SHA384, 128, BigEndianLength128, _sha512Blocks),
+    DIGEST_FUNCTIONS(SHA512, 128, BigEndianLength128, _sha512Blocks),
+};
+
+#undef DIGEST_FUNCTIONS
+
+const DigestFunctions& _CCDigestFunctions(DigestKind kind) {
+    return c_digestFunctions[kind];
+}
+
+void _CCDigestUpdate(const DigestFunctions& digest, CC_Digest_State* ctx, const void* data, size_t length) {
+    const unsigned char* in = static_cast<const unsigned char*>(data);
+    do {
+        const size_t piece = std::min<size_t>(length, 0x40000000);
+        digest.update(ctx, in, static_cast<CC_LONG>(piece));
+        in += piece;
+        length -= piece;
+    } while (length > 0);
 }
@@ -17,35 +17,72 @@
 #include <Windows.h>
 #include <CommonCrypto\CommonHMAC.h>
 #include <CommonCrypto\CommonDigest.h>
-#include <COMIncludes.h>
-#include <wrl\wrappers\corewrappers.h>
-#include <wrl\client.h>
-#include <windows.security.cryptography.h>
-#include <windows.storage.streams.h>
-#include <COMIncludes_End.h>
 #include <ErrorHandling.h>
 #include <StubReturn.h>
-#include <RawBuffer.h>
+#include "CommonHMACInternal.h"
+#include <string.h>
 
-using namespace Microsoft::WRL;
-using namespace ABI::Windows::Storage::Streams;
-using namespace ABI::Windows::Security::Cryptography::Core;
-using namespace Windows::Foundation;
+// HMAC (RFC 2104) over the digests in CommonDigest.cpp. The key's pad blocks are hashed once, when it's set up, rather
+// than for every message.
 
-struct CC_Hmac_State {
-    CC_Hmac_State(CCHmacAlgorithm algorithm, const void* key, size_t keyLength) :
-        _algorithm(algorithm),
-        _key(key),
-        _keyLength(keyLength),
-        _isValid(true) {
-        if (FAILED(_init())) {
-            invalidate();
-        }
+// The digest behind each CCHmacAlgorithm, in the order of the enum.
+static const DigestKind c_hmacDigests[] = { DigestSHA1, DigestMD5, DigestSHA256, DigestSHA384, DigestSHA512, DigestSHA224 };
+
+// The longest block of any of the digests.
+static const size_t c_maxBlockBytes = 128;
+
+bool _CCHmacKeyInit(HmacKey* key, CCHmacAlgorithm algorithm, const void* keyBytes, size_t keyLength) {
+    if (algorithm < 0 || static_cast<size_t>(algorithm) >= _countof(c_hmacDigests)) {
+        return false;
     }
 
-    ~CC_Hmac_State() {
+    const DigestFunctions& digest = _CCDigestFunctions(c_hmacDigests[algorithm]);
+    key->digest = &digest;
+
+    // Keys longer than a block are hashed, and shorter ones padded with zeros.
+    unsigned char pad[c_maxBlockBytes] = {};
+    if (keyLength > digest.blockBytes) {
+        CC_Digest_State ctx;
+        digest.init(&ctx);
+        _CCDigestUpdate(digest, &ctx, keyBytes, keyLength);
+        digest.final(pad, &ctx);
+    } else if (keyLength > 0) {
+        memcpy(pad, keyBytes, keyLength);
+    }
+
+    for (size_t i = 0; i < digest.blockBytes; ++i) {
+        pad[i] ^= 0x36;
     }
+    digest.init(&key->inner);
+    digest.update(&key->inner, pad, static_cast<CC_LONG>(digest.blockBytes));
+
+    for (size_t i = 0; i < digest.blockBytes; ++i) {
+        pad[i] ^= 0x36 ^ 0x5c;
+    }
+    digest.init(&key->outer);
+    digest.update(&key->outer, pad, static_cast<CC_LONG>(digest.blockBytes));
+
+    SecureZeroMemory(pad, sizeof(pad));
+    return true;
+}
+
+void _CCHmacFinal(const HmacKey& key, CC_Digest_State* inner, unsigned char* mac) {
+    const DigestFunctions& digest = *key.digest;
+    unsigned char innerDigest[CC_SHA512_DIGEST_LENGTH];
+    digest.final(innerDigest, inner);
+
+    CC_Digest_State outer = key.outer;
+    digest.update(&outer, innerDigest, static_cast<CC_LONG>(digest.digestLength));
+    digest.final(mac, &outer);
+    SecureZeroMemory(innerDigest, sizeof(innerDigest));
+}
 
+void _CCHmacKeyClear(HmacKey* key) {
+    SecureZeroMemory(&key->inner, sizeof(key->inner));
+    SecureZeroMemory(&key->outer, sizeof(key->outer));
+}
+
+struct CC_Hmac_State {
     static void init(CC_Hmac_State** ctx, CCHmacAlgorithm algorithm, const void* key, size_t keyLength) {
         if (!ctx) {
             LOG_HR(E_INVALIDARG);
@@ -54,155 +91,74 @@ struct CC_Hmac_State {
 
         *ctx = nullptr;
 
-        CC_Hmac_State* state = new CC_Hmac_State(algorithm, key, keyLength);
-        if (!_validState(&state)) {
-            LOG_HR(E_UNEXPECTED);
+        if (!key && keyLength > 0) {
+            LOG_HR(E_INVALIDARG);
             return;
         }
 
+        CC_Hmac_State* state = new CC_Hmac_State();
+        if (!_CCHmacKeyInit(&state->_key, algorithm, key, keyLength)) {
+            UNIMPLEMENTED_WITH_MSG("Requested HMAC algorithm is not supported");
+            delete state;
+            return;
+        }
+
+        state->_message = state->_key.inner;
         *ctx = state;
-        return;
     }
 
     static void update(CC_Hmac_State** ctx, const void* data, size_t len) {
-        if (!_validState(ctx)) {
+        if (!ctx || !*ctx || (!data && len > 0)) {
             LOG_HR(E_INVALIDARG);
             return;
         }
 
-        if (FAILED((*ctx)->_update(data, len))) {
-            delete *ctx;
-            *ctx = nullptr;
-        }
+        CC_Hmac_State* state = *ctx;
+        _CCDigestUpdate(*state->_key.digest, &state->_message, data, len);
     }
 
     static void final(void* digest, CC_Hmac_State** ctx) {
-       if (!_validState(ctx)) {
-           LOG_HR(E_INVALIDARG);
-           return;
-       }
-
-        if (FAILED((*ctx)->_finishHash(digest))) {
-            LOG_HR(E_UNEXPECTED);
+        if (!ctx || !*ctx || !digest) {
+            LOG_HR(E_INVALIDARG);
+            return;
         }
-        delete *ctx;
+
+        CC_Hmac_State* state = *ctx;
+        _CCHmacFinal(state->_key, &state->_message, static_cast<unsigned char*>(digest));
+        delete state;
         *ctx = nullptr;
     }
 
     static void oneShot(CCHmacAlgorithm algorithm, const void* key, size_t keyLength, const void* data, size_t dataLength, void* macOut) {
-        CC_Hmac_State* ctx;
-
-        init(&ctx, algorithm, key, keyLength);
-
-        update(&ctx, data, dataLength);
-
-        final(macOut, &ctx);
-    }
-
-private:
-    static bool _validState(CC_Hmac_State** ctx) {
-        if (!ctx) {
-            return false;
-        }
-
-        CC_Hmac_State* state = *ctx;
-        if (!state) {
-            return false;
+        if ((!key && keyLength > 0) || (!data && dataLength > 0) || !macOut) {
+            LOG_HR(E_INVALIDARG);
+            return;
         }
 
-        if (!state->_isValid) {
-            delete state;
-            *ctx = nullptr;
-            return false;
+        CC_Hmac_State state;
+        if (!_CCHmacKeyInit(&state._key, algorithm, key, keyLength)) {
+            UNIMPLEMENTED_WITH_MSG("Requested HMAC algorithm is not supported");
+            return;
         }
 
-        return true;
-    }
-
-    void invalidate() {
-        _isValid = false;
+        _CCDigestUpdate(*state._key.digest, &state._key.inner, data, dataLength);
+        _CCHmacFinal(state._key, &state._key.inner, static_cast<unsigned char*>(macOut));
     }
 
-    HRESULT _init() {
-        ComPtr<IMacAlgorithmProviderStatics> macAlgorithmProviderStatics;
-        ComPtr<IMacAlgorithmNamesStatics> macAlgorithmNamesStatics;
-
-        RETURN_IF_FAILED_LOG(
-            GetActivationFactory(Wrappers::HStringReference(RuntimeClass_Windows_Security_Cryptography_Core_MacAlgorithmProvider).Get(),
-                 &macAlgorithmProviderStatics));
-
-        RETURN_IF_FAILED_LOG(
-            GetActivationFactory(Wrappers::HStringReference(RuntimeClass_Windows_Security_Cryptography_Core_MacAlgorithmNames).Get(),
-                &macAlgorithmNamesStatics));
-
-        HSTRING name;
-
-        switch (_algorithm) {
-            case kCCHmacAlgSHA1:
-                RETURN_IF_FAILED_LOG(macAlgorithmNamesStatics->get_HmacSha1(&name));
-                _digestLength = CC_SHA1_DIGEST_LENGTH;
-                break;
-            case kCCHmacAlgMD5:
-                RETURN_IF_FAILED_LOG(macAlgorithmNamesStatics->get_HmacMd5(&name));
-                _digestLength = CC_MD5_DIGEST_LENGTH;
-                break;
-            case kCCHmacAlgSHA256:
-                RETURN_IF_FAILED_LOG(macAlgorithmNamesStatics->get_HmacSha256(&name));
-                _digestLength = CC_SHA256_DIGEST_LENGTH;
-                break;
-            case kCCHmacAlgSHA384:
-                RETURN_IF_FAILED_LOG(macAlgorithmNamesStatics->get_HmacSha384(&name));
-                _digestLength = CC_SHA384_DIGEST_LENGTH;
-                break;
-            case kCCHmacAlgSHA512:
-                RETURN_IF_FAILED_LOG(macAlgorithmNamesStatics->get_HmacSha512(&name));
-                _digestLength = CC_SHA512_DIGEST_LENGTH;
-                break;
-            case kCCHmacAlgSHA224:
-            default:
-                UNIMPLEMENTED_WITH_MSG("Requested HMAC algorithm is not supported");
-                return E_NOTIMPL;
-        }
-
-        RETURN_IF_FAILED_LOG(macAlgorithmProviderStatics->OpenAlgorithm(name, &_macAlgorithmProvider));
-
-        ComPtr<IBuffer> keyBuffer;
-        RETURN_IF_FAILED_LOG(BufferFromRawData(&keyBuffer, (unsigned char*)_key, _keyLength));
-        ComPtr<IMacAlgorithmProvider2> macAlgorithmProvider2;
-        RETURN_IF_FAILED_LOG(_macAlgorithmProvider.As(&macAlgorithmProvider2));
-        RETURN_IF_FAILED_LOG(macAlgorithmProvider2->CreateHash(keyBuffer.Get(), &_hash));
-        return S_OK;
+    ~CC_Hmac_State() {
+        _CCHmacKeyClear(&_key);
+        SecureZeroMemory(&_message, sizeof(_message));
     }
 
-    HRESULT _update(const void* data, size_t length) {
-        ComPtr<IBuffer> dataBuffer;
-        RETURN_IF_FAILED_LOG(BufferFromRawData(&dataBuffer, (unsigned char*)data, length));
-        RETURN_IF_FAILED_LOG(_hash->Append(dataBuffer.Get()));
-        return S_OK;
-    }
+private:
+    CC_Hmac_State() = default;
 
-    HRESULT _finishHash(void* digest) {
-        memset(digest, 0, _digestLength);
-        RETURN_IF_FAILED_LOG(_hash->GetValueAndReset(&_outBuffer));
-        ComPtr<IBufferByteAccess> bufferAccess;
-        RETURN_IF_FAILED_LOG(_outBuffer.As(&bufferAccess));
-        BYTE* pRawHash;
-        RETURN_IF_FAILED_LOG(bufferAccess->Buffer(&pRawHash));
-        memcpy_s(digest, _digestLength, pRawHash, _digestLength);
-        return S_OK;
-    }
+    HmacKey _key;
 
-    const CCHmacAlgorithm _algorithm;
-    const void* _key;
-    const size_t _keyLength;
-    ComPtr<IMacAlgorithmProvider> _macAlgorithmProvider;
-    ComPtr<IHashComputation> _hash;
-    ComPtr<IBuffer> _outBuffer;
-    size_t _digestLength;
-    bool _isValid;
+    // The inner digest of the message so far
+    CC_Digest_State _message;
 };
 
-
 /**
 @Status Interoperable
 */
@@ -230,4 +186,3 @@ void CCHmacFinal(CCHmacContext* ctx, void* macOut) {
 void CCHmac(CCHmacAlgorithm algorithm, const void* key, size_t keyLength, const void* data, size_t dataLength, void* macOut) {
     CC_Hmac_State::oneShot(algorithm, key, keyLength, data, dataLength, macOut);
 }
-
@@ -0,0 +1,360 @@
+//******************************************************************************
+//
+// Copyright (c) 2015 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include <Windows.h>
+#include <CommonCrypto\CommonKeyDerivation.h>
+#include <ErrorHandling.h>
+#include <StubReturn.h>
+#include "CommonHMACInternal.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+// PBKDF2 (RFC 8018) and HKDF (RFC 5869) over the HMAC in CommonHMAC.cpp. Every PBKDF2 round after the first MACs a
+// message shorter than a block, so rather than going through the digest's update and final it pads that message once
+// and runs the block function straight from the key's precomputed inner and outer states: two compressions a round.
+// The blocks of the derived key are independent of one another, and long keys share them out across the threadpool.
+
+// The HMAC behind each CCPseudoRandomAlgorithm, from kCCPRFHmacAlgSHA1.
+static const CCHmacAlgorithm c_prfAlgorithms[] = { kCCHmacAlgSHA1, kCCHmacAlgSHA224, kCCHmacAlgSHA256, kCCHmacAlgSHA384, kCCHmacAlgSHA512 };
+
+// Rounds for a block of the derived key to be worth handing to the threadpool.
+static const unsigned c_minimumRoundsPerThread = 2048;
+
+// The longest block of any of the digests.
+static const size_t c_maxBlockBytes = 128;
+
+static bool _hmacAlgorithmForPRF(CCPseudoRandomAlgorithm prf, CCHmacAlgorithm* algorithm) {
+    if (prf < kCCPRFHmacAlgSHA1 || prf > kCCPRFHmacAlgSHA512) {
+        return false;
+    }
+
+    *algorithm = c_prfAlgorithms[prf - kCCPRFHmacAlgSHA1];
+    return true;
+}
+
+static bool _hmacAlgorithmForDigest(CCDigestAlgorithm digest, CCHmacAlgorithm* algorithm) {
+    switch (digest) {
+        case kCCDigestMD5:
+            *algorithm = kCCHmacAlgMD5;
+            return true;
+        case kCCDigestSHA1:
+            *algorithm = kCCHmacAlgSHA1;
+            return true;
+        case kCCDigestSHA224:
+            *algorithm = kCCHmacAlgSHA224;
+            return true;
+        case kCCDigestSHA256:
+            *algorithm = kCCHmacAlgSHA256;
+            return true;
+        case kCCDigestSHA384:
+            *algorithm = kCCHmacAlgSHA384;
+            return true;
+        case kCCDigestSHA512:
+            *algorithm = kCCHmacAlgSHA512;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// T_index = U_1 ^ U_2 ^ ... ^ U_rounds, where U_1 = HMAC(password, salt || index) and U_n = HMAC(password, U_n-1).
+static void _pbkdf2Block(
+    const HmacKey& key, const unsigned char* salt, size_t saltLength, uint32_t index, unsigned rounds, unsigned char* out) {
+    const DigestFunctions& digest = *key.digest;
+    const size_t digestLength = digest.digestLength;
+
+    const unsigned char indexBytes[4] = { static_cast<unsigned char>(index >> 24),
+                                          static_cast<unsigned char>(index >> 16),
+                                          static_cast<unsigned char>(index >> 8),
+                                          static_cast<unsigned char>(index) };
+    CC_Digest_State state = key.inner;
+    _CCDigestUpdate(digest, &state, salt, saltLength);
+    digest.update(&state, indexBytes, sizeof(indexBytes));
+
+    // U goes back and forth between the inner block, as the message, and the outer one, as the inner digest. Both are
+    // a block after the pad block, and the padding after U stays the same from round to round.
+    unsigned char innerBlock[c_maxBlockBytes];
+    unsigned char outerBlock[c_maxBlockBytes];
+    _CCHmacFinal(key, &state, innerBlock);
+    memcpy(out, innerBlock, digestLength);
+    digest.pad(innerBlock, digestLength, digest.blockBytes + digestLength);
+    digest.pad(outerBlock, digestLength, digest.blockBytes + digestLength);
+
+    for (unsigned round = 1; round < rounds; ++round) {
+        state.hash = key.inner.hash;
+        digest.blocks(&state, innerBlock, 1);
+        digest.store(outerBlock, &state);
+
+        state.hash = key.outer.hash;
+        digest.blocks(&state, outerBlock, 1);
+        digest.store(innerBlock, &state);
+
+        for (size_t i = 0; i < digestLength; ++i) {
+            out[i] ^= innerBlock[i];
+        }
+    }
+
+    SecureZeroMemory(&state, sizeof(state));
+    SecureZeroMemory(innerBlock, sizeof(innerBlock));
+    SecureZeroMemory(outerBlock, sizeof(outerBlock));
+}
+
+// The shares of a derivation, handed out one at a time to the calling thread and to work on the process's threadpool.
+struct Pbkdf2Shares {
+    std::function<void(size_t)> derive;
+    size_t count;
+    std::atomic<size_t> next;
+};
+
+static void _deriveShares(Pbkdf2Shares* shares) {
+    for (size_t share = shares->next++; share < shares->count; share = shares->next++) {
+        shares->derive(share);
+    }
+}
+
+static void CALLBACK _deriveSharesCallback(PTP_CALLBACK_INSTANCE instance, void* context, PTP_WORK work) {
+    _deriveShares(static_cast<Pbkdf2Shares*>(context));
+}
+
+static CCCryptorStatus _pbkdf2(const HmacKey& key,
+                               const unsigned char* salt,
+                               size_t saltLength,
+                               unsigned rounds,
+                               unsigned char* derivedKey,
+                               size_t derivedKeyLength) {
+    const size_t digestLength = key.digest->digestLength;
+    const size_t blocks = (derivedKeyLength + digestLength - 1) / digestLength;
+    if (rounds == 0 || blocks > std::numeric_limits<uint32_t>::max()) {
+        return kCCParamError;
+    }
+
+    // Every threads-th block, from first.
+    auto derive = [&](size_t first, size_t threads) {
+        unsigned char block[CC_SHA512_DIGEST_LENGTH];
+        for (size_t i = first; i < blocks; i += threads) {
+            _pbkdf2Block(key, salt, saltLength, static_cast<uint32_t>(i + 1), rounds, block);
+            memcpy(derivedKey + i * digestLength, block, std::min(digestLength, derivedKeyLength - i * digestLength));
+        }
+        SecureZeroMemory(block, sizeof(block));
+    };
+
+    size_t threads = 1;
+    if (blocks > 1 && rounds >= c_minimumRoundsPerThread) {
+        threads = std::min<size_t>(blocks, std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    Pbkdf2Shares shares;
+    shares.derive = [&](size_t share) { derive(share, threads); };
+    shares.count = threads;
+    shares.next = 0;
+
+    // Without the work, or if the pool is slow to get to it, the calling thread takes every share itself.
+    PTP_WORK work = (threads > 1) ? CreateThreadpoolWork(_deriveSharesCallback, &shares, nullptr) : nullptr;
+    if (work) {
+        for (size_t share = 1; share < threads; ++share) {
+            SubmitThreadpoolWork(work);
+        }
+    }
+
+    _deriveShares(&shares);
+
+    if (work) {
+        // Every share has been taken by now, so work that hasn't started would have nothing left to do.
+        WaitForThreadpoolWorkCallbacks(work, TRUE);
+        CloseThreadpoolWork(work);
+    }
+    return kCCSuccess;
+}
+
+static CCCryptorStatus _hkdf(const HmacKey& extractKey,
+                             CCHmacAlgorithm algorithm,
+                             const void* inputKey,
+                             size_t inputKeyLength,
+                             const void* info,
+                             size_t infoLength,
+                             unsigned char* derivedKey,
+                             size_t derivedKeyLength) {
+    const DigestFunctions& digest = *extractKey.digest;
+    const size_t digestLength = digest.digestLength;
+    if (derivedKeyLength > 255 * digestLength) {
+        return kCCParamError;
+    }
+
+    // Extract: PRK = HMAC(salt, IKM)
+    unsigned char pseudoRandomKey[CC_SHA512_DIGEST_LENGTH];
+    CC_Digest_State state = extractKey.inner;
+    _CCDigestUpdate(digest, &state, inputKey, inputKeyLength);
+    _CCHmacFinal(extractKey, &state, pseudoRandomKey);
+
+    // Expand: T(n) = HMAC(PRK, T(n-1) || info || n)
+    HmacKey expandKey;
+    _CCHmacKeyInit(&expandKey, algorithm, pseudoRandomKey, digestLength);
+    unsigned char block[CC_SHA512_DIGEST_LENGTH];
+    for (size_t done = 0, n = 1; done < derivedKeyLength; done += digestLength, ++n) {
+        const unsigned char counter = static_cast<unsigned char>(n);
+        state = expandKey.inner;
+        if (n > 1) {
+            digest.update(&state, block, static_cast<CC_LONG>(digestLength));
+        }
+        _CCDigestUpdate(digest, &state, info, infoLength);
+        digest.update(&state, &counter, 1);
+        _CCHmacFinal(expandKey, &state, block);
+        memcpy(derivedKey + done, block, std::min(digestLength, derivedKeyLength - done));
+    }
+
+    _CCHmacKeyClear(&expandKey);
+    SecureZeroMemory(pseudoRandomKey, sizeof(pseudoRandomKey));
+    SecureZeroMemory(block, sizeof(block));
+    return kCCSuccess;
+}
+
+static bool _validBuffer(const void* buffer, size_t length) {
+    return buffer || length == 0;
+}
+
+/**
+@Status Interoperable
+@Notes Blocks of the derived key beyond the first are derived on the threadpool when there are enough rounds.
+*/
+int CCKeyDerivationPBKDF(CCPBKDFAlgorithm algorithm,
+                         const char* password,
+                         size_t passwordLen,
+                         const uint8_t* salt,
+                         size_t saltLen,
+                         CCPseudoRandomAlgorithm prf,
+                         unsigned rounds,
+                         uint8_t* derivedKey,
+                         size_t derivedKeyLen) {
+    CCHmacAlgorithm hmacAlgorithm;
+    if (algorithm != kCCPBKDF2 || !_hmacAlgorithmForPRF(prf, &hmacAlgorithm) || !derivedKey || derivedKeyLen == 0 ||
+        !_validBuffer(password, passwordLen) || !_validBuffer(salt, saltLen)) {
+        return kCCParamError;
+    }
+
+    HmacKey key;
+    _CCHmacKeyInit(&key, hmacAlgorithm, password, passwordLen);
+    const CCCryptorStatus status = _pbkdf2(key, salt, saltLen, rounds, derivedKey, derivedKeyLen);
+    _CCHmacKeyClear(&key);
+    return status;
+}
+
+/**
+@Status Interoperable
+@Notes Times a derivation of the given sizes on this device, with the same threading as CCKeyDerivationPBKDF.
+*/
+unsigned CCCalibratePBKDF(CCPBKDFAlgorithm algorithm,
+                          size_t passwordLen,
+                          size_t saltLen,
+                          CCPseudoRandomAlgorithm prf,
+                          size_t derivedKeyLen,
+                          uint32_t msec) {
+    CCHmacAlgorithm hmacAlgorithm;
+    if (algorithm != kCCPBKDF2 || !_hmacAlgorithmForPRF(prf, &hmacAlgorithm) || derivedKeyLen == 0 || msec == 0) {
+        return static_cast<unsigned>(-1);
+    }
+
+    std::vector<uint8_t> password(std::max<size_t>(passwordLen, 1), 'a');
+    std::vector<uint8_t> salt(std::max<size_t>(saltLen, 1), 's');
+    std::vector<uint8_t> derivedKey(derivedKeyLen);
+
+    // Enough rounds that the timing means something, then scaled to the time asked for.
+    unsigned rounds = c_minimumRoundsPerThread;
+    double elapsed;
+    for (;;) {
+        const auto start = std::chrono::steady_clock::now();
+        CCKeyDerivationPBKDF(algorithm,
+                             reinterpret_cast<const char*>(password.data()),
+                             passwordLen,
+                             salt.data(),
+                             saltLen,
+                             prf,
+                             rounds,
+                             derivedKey.data(),
+                             derivedKeyLen);
+        elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= 10.0 || rounds >= std::numeric_limits<unsigned>::max() / 4) {
+            break;
+        }
+        rounds *= 4;
+    }
+
+    const double calibrated = rounds * (msec / std::max(elapsed, 0.001));
+    return static_cast<unsigned>(std::max(1.0, std::min(calibrated, double(std::numeric_limits<unsigned>::max() - 1))));
+}
+
+/**
+@Status Caveat
+@Notes Only kCCKDFAlgorithmHKDF, with context as the info, and kCCKDFAlgorithmPBKDF2_HMAC are supported. label and iv
+       are unused.
+*/
+CCCryptorStatus CCKeyDerivationHMac(CCKDFAlgorithm algorithm,
+                                    CCDigestAlgorithm digest,
+                                    unsigned rounds,
+                                    const void* keyDerivationKey,
+                                    size_t keyDerivationKeyLen,
+                                    const void* label,
+                                    size_t labelLen,
+                                    const void* context,
+                                    size_t contextLen,
+                                    const void* iv,
+                                    size_t ivLen,
+                                    const void* salt,
+                                    size_t saltLen,
+                                    void* derivedKey,
+                                    size_t derivedKeyLen) {
+    CCHmacAlgorithm hmacAlgorithm;
+    if (!_hmacAlgorithmForDigest(digest, &hmacAlgorithm) || !derivedKey || derivedKeyLen == 0 ||
+        !_validBuffer(keyDerivationKey, keyDerivationKeyLen) || !_validBuffer(context, contextLen) || !_validBuffer(salt, saltLen)) {
+        return kCCParamError;
+    }
+
+    switch (algorithm) {
+        case kCCKDFAlgorithmHKDF: {
+            // With no salt, the extraction key is a digest's length of zeros, which HMAC pads the same as no key at all.
+            HmacKey extractKey;
+            _CCHmacKeyInit(&extractKey, hmacAlgorithm, salt, saltLen);
+            const CCCryptorStatus status = _hkdf(extractKey,
+                                                 hmacAlgorithm,
+                                                 keyDerivationKey,
+                                                 keyDerivationKeyLen,
+                                                 context,
+                                                 contextLen,
+                                                 static_cast<unsigned char*>(derivedKey),
+                                                 derivedKeyLen);
+            _CCHmacKeyClear(&extractKey);
+            return status;
+        }
+
+        case kCCKDFAlgorithmPBKDF2_HMAC: {
+            HmacKey key;
+            _CCHmacKeyInit(&key, hmacAlgorithm, keyDerivationKey, keyDerivationKeyLen);
+            const CCCryptorStatus status =
+                _pbkdf2(key, static_cast<const unsigned char*>(salt), saltLen, rounds, static_cast<unsigned char*>(derivedKey), derivedKeyLen);
+            _CCHmacKeyClear(&key);
+            return status;
+        }
+
+        default:
+            UNIMPLEMENTED_WITH_MSG("Requested key derivation algorithm is not supported");
+            return kCCUnimplemented;
+    }
+}
@@ -0,0 +1,44 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <functional>
+#include <stddef.h>
+
+// The number of threads AccelerateParallelFor splits count items across: one per processor, counting the calling thread,
+// but few enough that each gets at least minimumPerThread items. Always at least 1.
+size_t AccelerateParallelThreads(size_t count, size_t minimumPerThread);
+
+// Calls task(i) for each i < tasks, on the threads of a pool shared by Accelerate and on the calling thread, and returns
+// once all are done. Tasks run on the calling thread alone when the pool is busy with another caller's tasks or when
+// called from one of the pool's threads.
+void AccelerateParallelRun(size_t tasks, const std::function<void(size_t)>& task);
+
+// Calls body(begin, end) for contiguous ranges covering [0, count), one range per thread, as many threads as
+// AccelerateParallelThreads gives. Small counts run entirely on the calling thread.
+template <typename Body>
+void AccelerateParallelFor(size_t count, size_t minimumPerThread, const Body& body) {
+    const size_t threads = AccelerateParallelThreads(count, minimumPerThread);
+    if (threads <= 1) {
+        body(0, count);
+        return;
+    }
+
+    AccelerateParallelRun(threads, [&body, count, threads](size_t thread) {
+        body(count * thread / threads, count * (thread + 1) / threads);
+    });
+}
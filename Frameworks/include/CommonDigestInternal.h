@@ -0,0 +1,50 @@
+//******************************************************************************
+//
+// Copyright (c) 2015 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <CommonCrypto/CommonDigest.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The digests HMAC and the key derivation functions are built on.
+enum DigestKind { DigestMD5, DigestSHA1, DigestSHA224, DigestSHA256, DigestSHA384, DigestSHA512 };
+
+// A digest's sizes and functions. Besides the usual init, update and final, the block functions let a caller carry on
+// from a saved state with a message that fits in one block, as HMAC does over and over in PBKDF2, without the
+// buffering of update and final.
+struct DigestFunctions {
+    size_t blockBytes;
+    size_t digestLength;
+    int (*init)(CC_Digest_State* ctx);
+    int (*update)(CC_Digest_State* ctx, const void* data, CC_LONG len);
+    int (*final)(unsigned char* digest, CC_Digest_State* ctx);
+
+    // Compresses count whole blocks into ctx's hash, leaving its count and buffer alone.
+    void (*blocks)(CC_Digest_State* ctx, const unsigned char* data, size_t count);
+
+    // Pads the messageBytes at the start of block for a message of totalBytes in all, so that compressing it ends the
+    // digest. messageBytes has to leave room for the padding in the one block.
+    void (*pad)(unsigned char* block, size_t messageBytes, uint64_t totalBytes);
+
+    // Writes the digest that ctx's hash holds after the last block.
+    void (*store)(unsigned char* digest, const CC_Digest_State* ctx);
+};
+
+const DigestFunctions& _CCDigestFunctions(DigestKind kind);
+
+// Adds length bytes of data to a digest in progress, however many that is: update takes only 32 bits of length.
+void _CCDigestUpdate(const DigestFunctions& digest, CC_Digest_State* ctx, const void* data, size_t length);
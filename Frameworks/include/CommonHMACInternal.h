@@ -0,0 +1,37 @@
+//******************************************************************************
+//
+// Copyright (c) 2015 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#pragma once
+
+#include <CommonCrypto/CommonHMAC.h>
+#include "CommonDigestInternal.h"
+
+// An HMAC key as the digest states after its inner and outer pad blocks, so that each message MAC'd with it costs the
+// digest of the message and of one more block, however long the key.
+struct HmacKey {
+    const DigestFunctions* digest;
+    CC_Digest_State inner;
+    CC_Digest_State outer;
+};
+
+// Sets up key for algorithm. Returns false for an algorithm that isn't supported.
+bool _CCHmacKeyInit(HmacKey* key, CCHmacAlgorithm algorithm, const void* keyBytes, size_t keyLength);
+
+// Finishes the MAC of a message whose digest so far is inner, which is cleared.
+void _CCHmacFinal(const HmacKey& key, CC_Digest_State* inner, unsigned char* mac);
+
+// Clears the key's states.
+void _CCHmacKeyClear(HmacKey* key);
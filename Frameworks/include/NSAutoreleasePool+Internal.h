@@ -0,0 +1,34 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#pragma once
+#import <Foundation/NSAutoreleasePool.h>
+#import <CoreFoundation/CFBase.h>
+
+@class NSDictionary;
+
+@interface NSAutoreleasePool (Internal)
+// Pushes a pool that also keeps a thread-local arena CFAllocator in scope until the pool is drained. Only objects
+// created with _arena as their allocator use it; see _CFArenaScopeBegin() for the restrictions on memory obtained from it.
+- (instancetype)_initWithArena;
+
+// The arena of a pool pushed with _initWithArena, or NULL for any other pool.
+- (CFAllocatorRef)_arena;
+
+// Arena counters for the current thread: allocations, allocatedBytes, fallbackAllocations, deallocations, chunks,
+// resets and retainedScopes.
++ (NSDictionary*)_arenaStatistics;
+@end
@@ -0,0 +1,29 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#pragma once
+
+#import <Foundation/NSNotificationQueue.h>
+
+@class NSString;
+
+// Called by NSRunLoop. ASAP notifications are posted once per run loop iteration, after timers have fired;
+// idle notifications are posted in place of waiting for input.
+@interface NSNotificationQueue ()
+- (void)asapProcessMode:(NSString*)mode;
+- (BOOL)hasIdleNotificationsInMode:(NSString*)mode;
+- (void)idleProcessMode:(NSString*)mode;
+@end
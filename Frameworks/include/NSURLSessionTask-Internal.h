@@ -59,6 +59,7 @@
                     request:(NSURLRequest*)request;
 @property (readwrite, assign) id<_NSURLSessionTaskDelegate> _taskDelegate;
 - (void)_updateWithURLResponse:(NSURLResponse*)response;
+- (NSURLSessionConfiguration*)_configuration;
 
 @property (readwrite, assign) NSURLSessionTaskState state;
 @property (readwrite, assign) int64_t countOfBytesExpectedToReceive;
@@ -0,0 +1,204 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#pragma once
+
+#include "Accelerate\vDSP.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// Vector kernels behind the vDSP functions, for a unit output stride. Inputs may have any stride; strided inputs are
+// gathered. Each kernel handles a whole number of vectors from the start of the data and returns how many elements
+// that was, and the caller's scalar loop finishes the rest, so results match the scalar code element for element.
+// Reductions fold into the value passed in through C. The filters take contiguous data apart from the taps of conv and
+// the decimated input of desamp, and add up each output in the same order as the scalar loops.
+//
+// The FFT passes are the exception: they work on one pass of the split-complex FFT in vDSPFFT.cpp, a vector of columns
+// at a time, for the columns from q up to s, and return where they stopped. The caller finishes the columns left over
+// with the plain loops. The real FFT steps start at element 1 and stop short of the middle, which the caller finishes.
+//
+// gemm is the micro-kernel of the matrix multiplication in blasGemm.cpp. It adds alpha times the product of a panel of
+// vDSPGemmRows rows of A and K columns, packed a column at a time, and panels of vDSPGemmColumns columns of B, packed a
+// row at a time and one after another, into the column-major C, one tile after another along the N columns of C. It
+// returns how many columns that was, and the caller pads what is left over to a whole tile.
+const vDSP_Length vDSPGemmRows = 8;
+const vDSP_Length vDSPGemmColumns = 4;
+
+template <typename T>
+struct vDSPKernelSet {
+    typedef vDSP_Length (*FFTPass)(
+        const T* xr, const T* xi, T* yr, T* yi, const T* wr, const T* wi, vDSP_Length s, vDSP_Length m, vDSP_Length q);
+
+    vDSP_Length (*vabs)(const T* A, vDSP_Stride IA, T* C, vDSP_Length N);
+    vDSP_Length (*vnabs)(const T* A, vDSP_Stride IA, T* C, vDSP_Length N);
+    vDSP_Length (*vneg)(const T* A, vDSP_Stride IA, T* C, vDSP_Length N);
+    vDSP_Length (*vsq)(const T* A, vDSP_Stride IA, T* C, vDSP_Length N);
+    vDSP_Length (*vssq)(const T* A, vDSP_Stride IA, T* C, vDSP_Length N);
+    vDSP_Length (*vfrac)(const T* A, vDSP_Stride IA, T* C, vDSP_Length N);
+    vDSP_Length (*vsadd)(const T* A, vDSP_Stride IA, T B, T* C, vDSP_Length N);
+    vDSP_Length (*vsmul)(const T* A, vDSP_Stride IA, T B, T* C, vDSP_Length N);
+    vDSP_Length (*vthr)(const T* A, vDSP_Stride IA, T B, T* C, vDSP_Length N);
+    vDSP_Length (*vthres)(const T* A, vDSP_Stride IA, T B, T* C, vDSP_Length N);
+    vDSP_Length (*vclip)(const T* A, vDSP_Stride IA, T B, T C, T* D, vDSP_Length N);
+    vDSP_Length (*vlim)(const T* A, vDSP_Stride IA, T B, T C, T* D, vDSP_Length N);
+    vDSP_Length (*vadd)(const T* A, vDSP_Stride IA, const T* B, vDSP_Stride IB, T* C, vDSP_Length N);
+    vDSP_Length (*vmul)(const T* A, vDSP_Stride IA, const T* B, vDSP_Stride IB, T* C, vDSP_Length N);
+    vDSP_Length (*vasm)(const T* A, vDSP_Stride IA, const T* B, vDSP_Stride IB, T C, T* D, vDSP_Length N);
+    vDSP_Length (*vfill)(T A, T* C, vDSP_Length N);
+    vDSP_Length (*zvmags)(const T* Ar, const T* Ai, vDSP_Stride IA, T* C, vDSP_Length N);
+    vDSP_Length (*zvmgsa)(const T* Ar, const T* Ai, vDSP_Stride IA, const T* B, vDSP_Stride IB, T* C, vDSP_Length N);
+    vDSP_Length (*maxv)(const T* A, vDSP_Stride IA, vDSP_Length N, T* C);
+    vDSP_Length (*maxmgv)(const T* A, vDSP_Stride IA, vDSP_Length N, T* C);
+    vDSP_Length (*svesq)(const T* A, vDSP_Stride IA, T scale, vDSP_Length N, T* C);
+    vDSP_Length (*conv)(const T* A, const T* F, vDSP_Stride IF, T* C, vDSP_Length N, vDSP_Length P);
+    vDSP_Length (*desamp)(const T* A, vDSP_Stride DF, const T* F, T* C, vDSP_Length N, vDSP_Length P);
+    vDSP_Length (*imgfir)(const T* A, vDSP_Length NC, const T* F, vDSP_Length P, vDSP_Length Q, T* C, vDSP_Length N);
+    FFTPass fft2;
+    FFTPass fft3;
+    FFTPass fft4;
+    FFTPass fft5;
+    FFTPass fft8;
+    vDSP_Length (*fftUntangle)(T* re, T* im, const T* wr, const T* wi, vDSP_Length n);
+    vDSP_Length (*fftTangle)(const T* xr, const T* xi, T* zr, T* zi, const T* wr, const T* wi, vDSP_Length n);
+    vDSP_Length (*gemm)(const T* A, const T* B, vDSP_Length K, T alpha, T* C, vDSP_Length ldc, vDSP_Length N);
+};
+
+// The kernels behind vImage's 8-bit formats, which work in floats: see vImageKernels.inc.
+struct vImageKernelSet {
+    vDSP_Length (*scaleRows)(const uint8_t* const* rows, const float* weights, vDSP_Length taps, float* C, vDSP_Length N);
+    vDSP_Length (*scaleColumns)(
+        const float* A, const int32_t* indices, const float* weights, vDSP_Length taps, uint8_t* C, vDSP_Length N);
+    vDSP_Length (*reflect32)(const uint8_t* A, uint8_t* C, vDSP_Length N);
+    vDSP_Length (*shuffle32)(const uint8_t* A, uint8_t* C, const uint8_t map[4], const uint8_t fill[4], vDSP_Length N);
+    vDSP_Length (*expand24)(const uint8_t* A, uint8_t* C, const uint8_t map[4], const uint8_t fill[4], vDSP_Length N);
+    vDSP_Length (*pack32)(const uint8_t* A, uint8_t* C, const uint8_t map[3], vDSP_Length N);
+    vDSP_Length (*premultiply32)(const uint8_t* A, uint8_t* C, unsigned int alpha, vDSP_Length N);
+    vDSP_Length (*unpremultiply32)(const uint8_t* A, uint8_t* C, unsigned int alpha, vDSP_Length N);
+    vDSP_Length (*deinterleave32)(const uint8_t* A, uint8_t* const C[4], vDSP_Length N);
+    vDSP_Length (*interleave32)(const uint8_t* const A[4], uint8_t* C, vDSP_Length N);
+    vDSP_Length (*bytesToHalves)(const uint8_t* A, uint16_t* C, vDSP_Length N);
+    vDSP_Length (*halvesToBytes)(const uint16_t* A, uint8_t* C, vDSP_Length N);
+    vDSP_Length (*floatsToHalves)(const float* A, uint16_t* C, vDSP_Length N);
+    vDSP_Length (*halvesToFloats)(const uint16_t* A, float* C, vDSP_Length N);
+    vDSP_Length (*slideRows)(const float* prev, const uint8_t* A, const uint8_t* B, float* C, vDSP_Length N);
+    vDSP_Length (*slideLines)(const float* prev, const float* A, const float* B, float* C, vDSP_Length N);
+    vDSP_Length (*filterLine)(const float* A, const float* weights, vDSP_Length taps, vDSP_Length stride, float* C, vDSP_Length N);
+    vDSP_Length (*filterRows)(const uint8_t* const* rows,
+                              const float* weights,
+                              vDSP_Length count,
+                              vDSP_Length taps,
+                              vDSP_Length stride,
+                              float* C,
+                              vDSP_Length N);
+    vDSP_Length (*divideToBytes)(const float* A, const float* divisors, uint8_t* C, vDSP_Length N);
+};
+
+// IEEE half precision conversions, exact and rounding to nearest even, by the same bit manipulation as the vector
+// kernels so that every path gives the same bits, NaN included: NaNs become quiet NaNs without their payloads.
+inline float vImageHalfToFloat(uint16_t h) {
+    const uint32_t infinity = 0x7c00u << 13;
+    uint32_t bits = (h & 0x7fffu) << 13;
+    const uint32_t exponent = bits & infinity;
+    bits += (127u - 15u) << 23;
+    if (exponent == infinity) {
+        bits += (128u - 16u) << 23;
+    } else if (exponent == 0) {
+        // Subnormal or zero: let the float subtraction normalize it
+        float f;
+        const uint32_t magic = 113u << 23;
+        bits += 1u << 23;
+        memcpy(&f, &bits, sizeof(f));
+        float m;
+        memcpy(&m, &magic, sizeof(m));
+        f -= m;
+        memcpy(&bits, &f, sizeof(bits));
+    }
+    bits |= (h & 0x8000u) << 16;
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+inline uint16_t vImageFloatToHalf(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint32_t half;
+    if (bits >= (143u << 23)) {
+        // Too large for a half, infinite or NaN
+        half = (bits > (255u << 23)) ? 0x7e00u : 0x7c00u;
+    } else if (bits < (113u << 23)) {
+        // Subnormal as a half: adding 0.5 leaves the rounded mantissa in the low bits
+        const uint32_t magicBits = 126u << 23;
+        float magnitude, magic;
+        memcpy(&magnitude, &bits, sizeof(magnitude));
+        memcpy(&magic, &magicBits, sizeof(magic));
+        magnitude += magic;
+        memcpy(&half, &magnitude, sizeof(half));
+        half -= magicBits;
+    } else {
+        half = (bits + 0xfffu - ((127u - 15u) << 23) + ((bits >> 13) & 1u)) >> 13;
+    }
+    return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+struct vDSPKernels {
+    const char* name;
+    vDSPKernelSet<float> f;
+    vDSPKernelSet<double> d;
+    vImageKernelSet image;
+};
+
+// Every kernel set this processor can run, best first: AVX2 (gathering strided inputs in hardware on Intel processors)
+// and SSE4.1 on x86 as CPUID reports them, NEON on ARM, and plain loops everywhere. The list is built once, on first
+// use.
+const std::vector<const vDSPKernels*>& vDSPGetAvailableKernels();
+
+// The kernels vDSP uses, the first of the available ones.
+inline const vDSPKernels& vDSPGetKernels() {
+    return *vDSPGetAvailableKernels().front();
+}
+
+// How vDSPFilter computes a correlation: whichever of the other two should be faster, the vector kernels directly or
+// FFTs of overlapping blocks.
+enum vDSPFilterMethod { vDSPFilterAutomatic, vDSPFilterDirect, vDSPFilterFFT };
+
+// C[n * IC] = the sum over p < P of A[(n * DF + p) * IA] * F[p * IF], for n < N: vDSP_conv with DF = 1 and vDSP_desamp
+// with unit strides, with the method given for the tests to check and time each one.
+void vDSPFilter(const float* A,
+                vDSP_Stride IA,
+                vDSP_Stride DF,
+                const float* F,
+                vDSP_Stride IF,
+                float* C,
+                vDSP_Stride IC,
+                vDSP_Length N,
+                vDSP_Length P,
+                vDSPFilterMethod method);
+void vDSPFilter(const double* A,
+                vDSP_Stride IA,
+                vDSP_Stride DF,
+                const double* F,
+                vDSP_Stride IF,
+                double* C,
+                vDSP_Stride IC,
+                vDSP_Length N,
+                vDSP_Length P,
+                vDSPFilterMethod method);
@@ -617,6 +617,35 @@ ACCELERATE_IMPEXP void SetBLASParamErrorProc(BLASParamErrorProc __ErrorProc);
 
 ACCELERATE_IMPEXP void BLASDefaultErrorProc(const char *funcName, const char *paramName, const int *paramPos, const int *paramValue);
 
+ACCELERATE_IMPEXP void cblas_sgemm_batch_strided(const enum CBLAS_ORDER Order, const enum CBLAS_TRANSPOSE TransA,
+                 const enum CBLAS_TRANSPOSE TransB, const int M, const int N,
+                 const int K, const float alpha, const float* A,
+                 const int lda, const int stridea, const float* B, const int ldb,
+                 const int strideb, const float beta, float* C, const int ldc,
+                 const int stridec, const int batch_size);
+ACCELERATE_IMPEXP void cblas_dgemm_batch_strided(const enum CBLAS_ORDER Order, const enum CBLAS_TRANSPOSE TransA,
+                 const enum CBLAS_TRANSPOSE TransB, const int M, const int N,
+                 const int K, const double alpha, const double* A,
+                 const int lda, const int stridea, const double* B, const int ldb,
+                 const int strideb, const double beta, double* C, const int ldc,
+                 const int stridec, const int batch_size);
+ACCELERATE_IMPEXP void cblas_sgemm_batch(const enum CBLAS_ORDER Order, const enum CBLAS_TRANSPOSE* TransA_Array,
+                 const enum CBLAS_TRANSPOSE* TransB_Array, const int* M_Array, const int* N_Array,
+                 const int* K_Array, const float* alpha_Array, const float** A_Array,
+                 const int* lda_Array, const float** B_Array, const int* ldb_Array,
+                 const float* beta_Array, float** C_Array, const int* ldc_Array,
+                 const int group_count, const int* group_size);
+ACCELERATE_IMPEXP void cblas_dgemm_batch(const enum CBLAS_ORDER Order, const enum CBLAS_TRANSPOSE* TransA_Array,
+                 const enum CBLAS_TRANSPOSE* TransB_Array, const int* M_Array, const int* N_Array,
+                 const int* K_Array, const double* alpha_Array, const double** A_Array,
+                 const int* lda_Array, const double** B_Array, const int* ldb_Array,
+                 const double* beta_Array, double** C_Array, const int* ldc_Array,
+                 const int group_count, const int* group_size);
+
+// The most threads sgemm and dgemm may use, counting the calling thread: 0, the default, for one per processor.
+ACCELERATE_IMPEXP void SetBLASThreadCount(int count);
+ACCELERATE_IMPEXP int GetBLASThreadCount(void);
+
 __declspec(thread) extern int CBLAS_CallFromC;
 __declspec(thread) extern int RowMajorStrg;
 extern BLASParamErrorProc __BLASErrorProc;
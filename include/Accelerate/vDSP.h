@@ -67,6 +67,25 @@ typedef struct vDSP_DFT_SetupStructD {
     vDSP_DFT_TransformType transformType;
 } *vDSP_DFT_SetupD;
 
+//Specifies whether to perform a forward or inverse FFT
+typedef int FFTDirection;
+enum {
+    kFFTDirection_Forward = +1,
+    kFFTDirection_Inverse = -1
+};
+
+//Radices an FFT setup is created for; every setup runs the power of two transforms
+typedef int FFTRadix;
+enum {
+    kFFTRadix2 = 0,
+    kFFTRadix3 = 1,
+    kFFTRadix5 = 2
+};
+
+//Setup objects holding the twiddle factors for FFTs of up to 2^Log2n points, single and double-precision
+typedef struct OpaqueFFTSetup* FFTSetup;
+typedef struct OpaqueFFTSetupD* FFTSetupD;
+
 ACCELERATE_EXPORT void vDSP_vabs(const float* A, vDSP_Stride IA, float* C, vDSP_Stride IC, vDSP_Length N);
 ACCELERATE_EXPORT void vDSP_vabsD(const double* A, vDSP_Stride IA, double* C, vDSP_Stride IC, vDSP_Length N);
 ACCELERATE_EXPORT void vDSP_vabsi(const int* A, vDSP_Stride IA, int* C, vDSP_Stride IC, vDSP_Length N);
@@ -205,4 +224,35 @@ ACCELERATE_EXPORT void vDSP_DFT_DestroySetupD(vDSP_DFT_SetupD __Setup);
 ACCELERATE_EXPORT void vDSP_DFT_Execute(const struct vDSP_DFT_SetupStruct *__Setup, const float *__Ir, const float *__Ii, float *__Or,
                                         float *__Oi);
 ACCELERATE_EXPORT void vDSP_DFT_ExecuteD(const struct vDSP_DFT_SetupStructD *__Setup, const double *__Ir, const double *__Ii, double *__Or,
-                                         double *__Oi);
\ No newline at end of file
+                                         double *__Oi);
+ACCELERATE_EXPORT FFTSetup vDSP_create_fftsetup(vDSP_Length __Log2n, FFTRadix __Radix);
+ACCELERATE_EXPORT FFTSetupD vDSP_create_fftsetupD(vDSP_Length __Log2n, FFTRadix __Radix);
+ACCELERATE_EXPORT void vDSP_destroy_fftsetup(FFTSetup __setup);
+ACCELERATE_EXPORT void vDSP_destroy_fftsetupD(FFTSetupD __setup);
+ACCELERATE_EXPORT void vDSP_fft_zip(FFTSetup __Setup, const DSPSplitComplex *__C, vDSP_Stride __IC, vDSP_Length __Log2N,
+                                    FFTDirection __Direction);
+ACCELERATE_EXPORT void vDSP_fft_zipD(FFTSetupD __Setup, const DSPDoubleSplitComplex *__C, vDSP_Stride __IC, vDSP_Length __Log2N,
+                                     FFTDirection __Direction);
+ACCELERATE_EXPORT void vDSP_fft_zop(FFTSetup __Setup, const DSPSplitComplex *__A, vDSP_Stride __IA, const DSPSplitComplex *__C,
+                                    vDSP_Stride __IC, vDSP_Length __Log2N, FFTDirection __Direction);
+ACCELERATE_EXPORT void vDSP_fft_zopD(FFTSetupD __Setup, const DSPDoubleSplitComplex *__A, vDSP_Stride __IA,
+                                     const DSPDoubleSplitComplex *__C, vDSP_Stride __IC, vDSP_Length __Log2N, FFTDirection __Direction);
+ACCELERATE_EXPORT void vDSP_fft_zrip(FFTSetup __Setup, const DSPSplitComplex *__C, vDSP_Stride __IC, vDSP_Length __Log2N,
+                                     FFTDirection __Direction);
+ACCELERATE_EXPORT void vDSP_fft_zripD(FFTSetupD __Setup, const DSPDoubleSplitComplex *__C, vDSP_Stride __IC, vDSP_Length __Log2N,
+                                      FFTDirection __Direction);
+ACCELERATE_EXPORT void vDSP_fft_zrop(FFTSetup __Setup, const DSPSplitComplex *__A, vDSP_Stride __IA, const DSPSplitComplex *__C,
+                                     vDSP_Stride __IC, vDSP_Length __Log2N, FFTDirection __Direction);
+ACCELERATE_EXPORT void vDSP_fft_zropD(FFTSetupD __Setup, const DSPDoubleSplitComplex *__A, vDSP_Stride __IA,
+                                      const DSPDoubleSplitComplex *__C, vDSP_Stride __IC, vDSP_Length __Log2N, FFTDirection __Direction);
+ACCELERATE_EXPORT void vDSP_conv(const float *__A, vDSP_Stride __IA, const float *__F, vDSP_Stride __IF, float *__C, vDSP_Stride __IC,
+                                 vDSP_Length __N, vDSP_Length __P);
+ACCELERATE_EXPORT void vDSP_convD(const double *__A, vDSP_Stride __IA, const double *__F, vDSP_Stride __IF, double *__C,
+                                  vDSP_Stride __IC, vDSP_Length __N, vDSP_Length __P);
+ACCELERATE_EXPORT void vDSP_desamp(const float *__A, vDSP_Stride __DF, const float *__F, float *__C, vDSP_Length __N, vDSP_Length __P);
+ACCELERATE_EXPORT void vDSP_desampD(const double *__A, vDSP_Stride __DF, const double *__F, double *__C, vDSP_Length __N,
+                                    vDSP_Length __P);
+ACCELERATE_EXPORT void vDSP_f3x3(const float *__A, vDSP_Length __NR, vDSP_Length __NC, const float *__F, float *__C);
+ACCELERATE_EXPORT void vDSP_f3x3D(const double *__A, vDSP_Length __NR, vDSP_Length __NC, const double *__F, double *__C);
+ACCELERATE_EXPORT void vDSP_f5x5(const float *__A, vDSP_Length __NR, vDSP_Length __NC, const float *__F, float *__C);
+ACCELERATE_EXPORT void vDSP_f5x5D(const double *__A, vDSP_Length __NR, vDSP_Length __NC, const double *__F, double *__C);
\ No newline at end of file
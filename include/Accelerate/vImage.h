@@ -16,6 +16,7 @@
 //******************************************************************************
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include <BaseTsd.h>
 #include "AccelerateExport.h"
 
@@ -47,6 +48,18 @@ enum
     kvImageGetTempBufferSize = 128
 };
 
+enum
+{
+    kRotate0DegreesClockwise = 0,
+    kRotate90DegreesClockwise = 3,
+    kRotate180DegreesClockwise = 2,
+    kRotate270DegreesClockwise = 1,
+    kRotate0DegreesCounterClockwise = 0,
+    kRotate90DegreesCounterClockwise = 1,
+    kRotate180DegreesCounterClockwise = 2,
+    kRotate270DegreesCounterClockwise = 3
+};
+
 typedef unsigned long vImagePixelCount;
 
 typedef struct {
@@ -60,6 +73,12 @@ typedef SSIZE_T vImage_Error;
 
 typedef uint32_t vImage_Flags;
 
+typedef uint8_t Pixel_8;
+
+typedef float Pixel_F;
+
+typedef uint16_t Pixel_16F;
+
 typedef uint8_t Pixel_8888[4];
 
 typedef struct Pixel_8888_s {
@@ -76,10 +95,156 @@ ACCELERATE_EXPORT vImage_Error vImageBoxConvolve_ARGB8888(const vImage_Buffer* s
                                                           const Pixel_8888 backgroundColor,
                                                           vImage_Flags flags);
 
+ACCELERATE_EXPORT vImage_Error vImageBoxConvolve_Planar8(const vImage_Buffer* src,
+                                                         const vImage_Buffer* dest,
+                                                         void* tempBuffer,
+                                                         vImagePixelCount srcOffsetToROI_X,
+                                                         vImagePixelCount srcOffsetToROI_Y,
+                                                         uint32_t kernel_height,
+                                                         uint32_t kernel_width,
+                                                         Pixel_8 backgroundColor,
+                                                         vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageTentConvolve_ARGB8888(const vImage_Buffer* src,
+                                                           const vImage_Buffer* dest,
+                                                           void* tempBuffer,
+                                                           vImagePixelCount srcOffsetToROI_X,
+                                                           vImagePixelCount srcOffsetToROI_Y,
+                                                           uint32_t kernel_height,
+                                                           uint32_t kernel_width,
+                                                           const Pixel_8888 backgroundColor,
+                                                           vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageTentConvolve_Planar8(const vImage_Buffer* src,
+                                                          const vImage_Buffer* dest,
+                                                          void* tempBuffer,
+                                                          vImagePixelCount srcOffsetToROI_X,
+                                                          vImagePixelCount srcOffsetToROI_Y,
+                                                          uint32_t kernel_height,
+                                                          uint32_t kernel_width,
+                                                          Pixel_8 backgroundColor,
+                                                          vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvolve_ARGB8888(const vImage_Buffer* src,
+                                                       const vImage_Buffer* dest,
+                                                       void* tempBuffer,
+                                                       vImagePixelCount srcOffsetToROI_X,
+                                                       vImagePixelCount srcOffsetToROI_Y,
+                                                       const int16_t* kernel,
+                                                       uint32_t kernel_height,
+                                                       uint32_t kernel_width,
+                                                       int32_t divisor,
+                                                       const Pixel_8888 backgroundColor,
+                                                       vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvolve_Planar8(const vImage_Buffer* src,
+                                                      const vImage_Buffer* dest,
+                                                      void* tempBuffer,
+                                                      vImagePixelCount srcOffsetToROI_X,
+                                                      vImagePixelCount srcOffsetToROI_Y,
+                                                      const int16_t* kernel,
+                                                      uint32_t kernel_height,
+                                                      uint32_t kernel_width,
+                                                      int32_t divisor,
+                                                      Pixel_8 backgroundColor,
+                                                      vImage_Flags flags);
+
 ACCELERATE_EXPORT vImage_Error vImageMatrixMultiply_ARGB8888(const vImage_Buffer* src,
                                                              const vImage_Buffer* dest,
                                                              const int16_t matrix[16],
                                                              int32_t divisor,
                                                              const int16_t* pre_bias_p,
                                                              const int32_t* post_bias_p,
-                                                             vImage_Flags flags);
\ No newline at end of file
+                                                             vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageScale_ARGB8888(const vImage_Buffer* src,
+                                                    const vImage_Buffer* dest,
+                                                    void* tempBuffer,
+                                                    vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageScale_Planar8(const vImage_Buffer* src,
+                                                   const vImage_Buffer* dest,
+                                                   void* tempBuffer,
+                                                   vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageRotate90_ARGB8888(const vImage_Buffer* src,
+                                                       const vImage_Buffer* dest,
+                                                       uint8_t rotationConstant,
+                                                       const Pixel_8888 backColor,
+                                                       vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageRotate90_Planar8(const vImage_Buffer* src,
+                                                      const vImage_Buffer* dest,
+                                                      uint8_t rotationConstant,
+                                                      Pixel_8 backColor,
+                                                      vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageHorizontalReflect_ARGB8888(const vImage_Buffer* src,
+                                                                const vImage_Buffer* dest,
+                                                                vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageHorizontalReflect_Planar8(const vImage_Buffer* src,
+                                                               const vImage_Buffer* dest,
+                                                               vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvert_ARGB8888toPlanar8(const vImage_Buffer* srcARGB,
+                                                               const vImage_Buffer* destA,
+                                                               const vImage_Buffer* destR,
+                                                               const vImage_Buffer* destG,
+                                                               const vImage_Buffer* destB,
+                                                               vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvert_Planar8toARGB8888(const vImage_Buffer* srcA,
+                                                               const vImage_Buffer* srcR,
+                                                               const vImage_Buffer* srcG,
+                                                               const vImage_Buffer* srcB,
+                                                               const vImage_Buffer* dest,
+                                                               vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvert_RGB888toARGB8888(const vImage_Buffer* rgbSrc,
+                                                              const vImage_Buffer* aSrc,
+                                                              Pixel_8 alpha,
+                                                              const vImage_Buffer* argbDest,
+                                                              bool premultiply,
+                                                              vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvert_RGB888toRGBA8888(const vImage_Buffer* rgbSrc,
+                                                              const vImage_Buffer* aSrc,
+                                                              Pixel_8 alpha,
+                                                              const vImage_Buffer* rgbaDest,
+                                                              bool premultiply,
+                                                              vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvert_RGB888toBGRA8888(const vImage_Buffer* rgbSrc,
+                                                              const vImage_Buffer* aSrc,
+                                                              Pixel_8 alpha,
+                                                              const vImage_Buffer* bgraDest,
+                                                              bool premultiply,
+                                                              vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvert_ARGB8888toRGB888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvert_RGBA8888toRGB888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvert_BGRA8888toRGB888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImagePermuteChannels_ARGB8888(const vImage_Buffer* src,
+                                                              const vImage_Buffer* dest,
+                                                              const uint8_t permuteMap[4],
+                                                              vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImagePremultiplyData_ARGB8888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImagePremultiplyData_RGBA8888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageUnpremultiplyData_ARGB8888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageUnpremultiplyData_RGBA8888(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvert_Planar8toPlanar16F(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvert_Planar16FtoPlanar8(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvert_PlanarFtoPlanar16F(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags);
+
+ACCELERATE_EXPORT vImage_Error vImageConvert_Planar16FtoPlanarF(const vImage_Buffer* src, const vImage_Buffer* dest, vImage_Flags flags);
\ No newline at end of file
@@ -82,6 +82,26 @@ enum { kCCOptionPKCS7Padding = 1, kCCOptionECBMode = 2 };
 
 typedef int32_t CCOptions;
 
+enum {
+    kCCModeECB = 1,
+    kCCModeCBC = 2,
+    kCCModeCFB = 3,
+    kCCModeCTR = 4,
+    kCCModeOFB = 7,
+    kCCModeRC4 = 9,
+    kCCModeCFB8 = 10,
+};
+
+typedef uint32_t CCMode;
+
+enum { ccNoPadding = 0, ccPKCS7Padding = 1 };
+
+typedef uint32_t CCPadding;
+
+enum { kCCModeOptionCTR_LE = 0x0001, kCCModeOptionCTR_BE = 0x0002 };
+
+typedef uint32_t CCModeOptions;
+
 struct CC_Cryptor_State;
 typedef struct CC_Cryptor_State* CCCryptorRef;
 
@@ -90,6 +110,19 @@ SB_EXTERNC_BEGIN
 SB_IMPEXP CCCryptorStatus CCCryptorCreate(
     CCOperation op, CCAlgorithm alg, CCOptions options, const void* key, size_t keyLength, const void* iv, CCCryptorRef* cryptorRef);
 
+SB_IMPEXP CCCryptorStatus CCCryptorCreateWithMode(CCOperation op,
+                                                  CCMode mode,
+                                                  CCAlgorithm alg,
+                                                  CCPadding padding,
+                                                  const void* iv,
+                                                  const void* key,
+                                                  size_t keyLength,
+                                                  const void* tweak,
+                                                  size_t tweakLength,
+                                                  int numRounds,
+                                                  CCModeOptions options,
+                                                  CCCryptorRef* cryptorRef);
+
 SB_IMPEXP CCCryptorStatus CCCryptorCreateFromData(CCOperation op,
                                                   CCAlgorithm alg,
                                                   CCOptions options,
@@ -124,4 +157,31 @@ SB_IMPEXP CCCryptorStatus CCCrypt(CCOperation op,
                                   size_t dataOutAvailable,
                                   size_t* dataOutMoved);
 
+// Note: Declared in CommonCryptorSPI.h on the reference platform
+SB_IMPEXP CCCryptorStatus CCCryptorGCMOneshotEncrypt(CCAlgorithm alg,
+                                                     const void* key,
+                                                     size_t keyLength,
+                                                     const void* iv,
+                                                     size_t ivLength,
+                                                     const void* aData,
+                                                     size_t aDataLength,
+                                                     const void* dataIn,
+                                                     size_t dataInLength,
+                                                     void* cipherDataOut,
+                                                     void* tagOut,
+                                                     size_t tagLength);
+
+SB_IMPEXP CCCryptorStatus CCCryptorGCMOneshotDecrypt(CCAlgorithm alg,
+                                                     const void* key,
+                                                     size_t keyLength,
+                                                     const void* iv,
+                                                     size_t ivLength,
+                                                     const void* aData,
+                                                     size_t aDataLength,
+                                                     const void* dataIn,
+                                                     size_t dataInLength,
+                                                     void* dataOut,
+                                                     const void* tagIn,
+                                                     size_t tagLength);
+
 SB_EXTERNC_END
@@ -19,15 +19,29 @@
 #include <StarboardExport.h>
 #include <StubIncludes.h>
 
-struct CC_Digest_State;
-typedef struct CC_Digest_State* CC_MD2_CTX;
-typedef struct CC_Digest_State* CC_MD4_CTX;
-typedef struct CC_Digest_State* CC_MD5_CTX;
-typedef struct CC_Digest_State* CC_SHA1_CTX;
-typedef struct CC_Digest_State* CC_SHA224_CTX;
-typedef struct CC_Digest_State* CC_SHA256_CTX;
-typedef struct CC_Digest_State* CC_SHA384_CTX;
-typedef struct CC_Digest_State* CC_SHA512_CTX;
+#include <stddef.h>
+#include <stdint.h>
+
+// A digest in progress, kept by the caller, and a plain value that can be copied to hash more than one message
+// from a common start. Its fields are private to CommonDigest.cpp.
+typedef struct CC_Digest_State {
+    union {
+        uint32_t words[16];
+        uint64_t longs[8];
+        unsigned char bytes[64];
+    } hash;
+    uint64_t count;
+    unsigned char buffer[128];
+} CC_Digest_State;
+
+typedef CC_Digest_State CC_MD2_CTX;
+typedef CC_Digest_State CC_MD4_CTX;
+typedef CC_Digest_State CC_MD5_CTX;
+typedef CC_Digest_State CC_SHA1_CTX;
+typedef CC_Digest_State CC_SHA224_CTX;
+typedef CC_Digest_State CC_SHA256_CTX;
+typedef CC_Digest_State CC_SHA384_CTX;
+typedef CC_Digest_State CC_SHA512_CTX;
 
 typedef unsigned long CC_LONG;
 
@@ -40,6 +54,15 @@ typedef unsigned long CC_LONG;
 #define CC_SHA384_DIGEST_LENGTH 48
 #define CC_SHA512_DIGEST_LENGTH 64
 
+#define CC_MD2_BLOCK_BYTES 64
+#define CC_MD4_BLOCK_BYTES 64
+#define CC_MD5_BLOCK_BYTES 64
+#define CC_SHA1_BLOCK_BYTES 64
+#define CC_SHA224_BLOCK_BYTES 64
+#define CC_SHA256_BLOCK_BYTES 64
+#define CC_SHA384_BLOCK_BYTES 128
+#define CC_SHA512_BLOCK_BYTES 128
+
 SB_EXTERNC_BEGIN
 
 int CC_MD2_Init(CC_MD2_CTX* c);
@@ -62,16 +85,20 @@ int CC_SHA1_Update(CC_SHA1_CTX* ctx, const void* data, CC_LONG len);
 int CC_SHA1_Final(unsigned char* digest, CC_SHA1_CTX* ctx);
 unsigned char* CC_SHA1(const void* data, CC_LONG len, unsigned char* md);
 
-int CC_SHA224_Init(CC_SHA224_CTX* ctx) STUB_METHOD;
-int CC_SHA224_Update(CC_SHA224_CTX* ctx, const void* data, CC_LONG len) STUB_METHOD;
-int CC_SHA224_Final(unsigned char* digest, CC_SHA224_CTX* ctx) STUB_METHOD;
-unsigned char* CC_SHA224(const void* data, CC_LONG len, unsigned char* md) STUB_METHOD;
+int CC_SHA224_Init(CC_SHA224_CTX* ctx);
+int CC_SHA224_Update(CC_SHA224_CTX* ctx, const void* data, CC_LONG len);
+int CC_SHA224_Final(unsigned char* digest, CC_SHA224_CTX* ctx);
+unsigned char* CC_SHA224(const void* data, CC_LONG len, unsigned char* md);
 
 int CC_SHA256_Init(CC_SHA256_CTX* ctx);
 int CC_SHA256_Update(CC_SHA256_CTX* ctx, const void* data, CC_LONG len);
 int CC_SHA256_Final(unsigned char* digest, CC_SHA256_CTX* ctx);
 unsigned char* CC_SHA256(const void* data, CC_LONG len, unsigned char* md);
 
+// Not in Apple's CommonCrypto: the SHA-256 digests of count messages, data[i] of lengths[i] bytes into digests[i].
+// Short messages are hashed several at once, one to each lane of the vector registers.
+int CC_SHA256_Batch(const void* const* data, const CC_LONG* lengths, unsigned char* const* digests, size_t count);
+
 int CC_SHA384_Init(CC_SHA384_CTX* ctx);
 int CC_SHA384_Update(CC_SHA384_CTX* ctx, const void* data, CC_LONG len);
 int CC_SHA384_Final(unsigned char* digest, CC_SHA384_CTX* ctx);
@@ -13,5 +13,88 @@
 // THE SOFTWARE.
 //
 //******************************************************************************
+#pragma once
 
-// This header file is not yet implemented
+#include <StarboardExport.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <CommonCrypto/CommonCryptor.h>
+
+enum { kCCPBKDF2 = 2 };
+
+typedef uint32_t CCPBKDFAlgorithm;
+
+enum {
+    kCCPRFHmacAlgSHA1 = 1,
+    kCCPRFHmacAlgSHA224 = 2,
+    kCCPRFHmacAlgSHA256 = 3,
+    kCCPRFHmacAlgSHA384 = 4,
+    kCCPRFHmacAlgSHA512 = 5,
+};
+
+typedef uint32_t CCPseudoRandomAlgorithm;
+
+// Note: Declared in CommonDigestSPI.h on the reference platform
+enum {
+    kCCDigestNone = 0,
+    kCCDigestMD5 = 3,
+    kCCDigestSHA1 = 8,
+    kCCDigestSHA224 = 9,
+    kCCDigestSHA256 = 10,
+    kCCDigestSHA384 = 11,
+    kCCDigestSHA512 = 12,
+};
+
+typedef uint32_t CCDigestAlgorithm;
+
+// Note: Declared in CommonKeyDerivationSPI.h on the reference platform
+enum {
+    kCCKDFAlgorithmPBKDF2_HMAC = 0,
+    kCCKDFAlgorithmCTR_HMAC,
+    kCCKDFAlgorithmCTR_HMAC_FIXED,
+    kCCKDFAlgorithmFB_HMAC,
+    kCCKDFAlgorithmFB_HMAC_FIXED,
+    kCCKDFAlgorithmDPIPE_HMAC,
+    kCCKDFAlgorithmHKDF,
+    kCCKDFAlgorithmAnsiX963,
+};
+
+typedef uint32_t CCKDFAlgorithm;
+
+SB_EXTERNC_BEGIN
+
+SB_IMPEXP int CCKeyDerivationPBKDF(CCPBKDFAlgorithm algorithm,
+                                   const char* password,
+                                   size_t passwordLen,
+                                   const uint8_t* salt,
+                                   size_t saltLen,
+                                   CCPseudoRandomAlgorithm prf,
+                                   unsigned rounds,
+                                   uint8_t* derivedKey,
+                                   size_t derivedKeyLen);
+
+SB_IMPEXP unsigned CCCalibratePBKDF(CCPBKDFAlgorithm algorithm,
+                                    size_t passwordLen,
+                                    size_t saltLen,
+                                    CCPseudoRandomAlgorithm prf,
+                                    size_t derivedKeyLen,
+                                    uint32_t msec);
+
+// Note: Declared in CommonKeyDerivationSPI.h on the reference platform
+SB_IMPEXP CCCryptorStatus CCKeyDerivationHMac(CCKDFAlgorithm algorithm,
+                                              CCDigestAlgorithm digest,
+                                              unsigned rounds,
+                                              const void* keyDerivationKey,
+                                              size_t keyDerivationKeyLen,
+                                              const void* label,
+                                              size_t labelLen,
+                                              const void* context,
+                                              size_t contextLen,
+                                              const void* iv,
+                                              size_t ivLen,
+                                              const void* salt,
+                                              size_t saltLen,
+                                              void* derivedKey,
+                                              size_t derivedKeyLen);
+
+SB_EXTERNC_END
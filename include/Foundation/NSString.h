@@ -29,6 +29,7 @@
 @class NSLocale;
 @class NSDictionary;
 @class NSOrthography;
+@class NSOutputStream;
 
 typedef unsigned short unichar;
 
@@ -277,3 +278,10 @@ FOUNDATION_EXPORT_CLASS
                       tokenRanges:(NSArray* _Nullable*)tokenRanges STUB_METHOD;
 
 @end
+
+@interface NSString (WinObjC)
+// [WinObjC Extension]
+// Writes the string to an open stream in the given encoding, without a byte order mark, a block of characters at a time.
+// Long strings built up by appending are written without first being copied into one buffer.
+- (BOOL)writeToOutputStream:(NSOutputStream*)stream encoding:(NSStringEncoding)encoding error:(NSError* _Nullable*)error;
+@end
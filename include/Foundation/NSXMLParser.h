@@ -146,16 +146,16 @@ FOUNDATION_EXPORT_CLASS
 
 - (instancetype)initWithContentsOfURL:(NSURL*)url;
 - (instancetype)initWithData:(NSData*)data;
-- (instancetype)initWithStream:(NSInputStream*)stream STUB_METHOD;
+- (instancetype)initWithStream:(NSInputStream*)stream;
 @property (assign) id<NSXMLParserDelegate> delegate;
 @property BOOL shouldProcessNamespaces STUB_PROPERTY;
 @property BOOL shouldReportNamespacePrefixes STUB_PROPERTY;
 @property BOOL shouldResolveExternalEntities STUB_PROPERTY;
 - (BOOL)parse;
-- (void)abortParsing STUB_METHOD;
-@property (readonly, copy) NSError* parserError STUB_PROPERTY;
-@property (readonly) NSInteger columnNumber STUB_PROPERTY;
-@property (readonly) NSInteger lineNumber STUB_PROPERTY;
+- (void)abortParsing;
+@property (readonly, copy) NSError* parserError;
+@property (readonly) NSInteger columnNumber;
+@property (readonly) NSInteger lineNumber;
 @property (readonly, copy) NSString* publicID STUB_PROPERTY;
 @property (readonly, copy) NSString* systemID STUB_PROPERTY;
 @end
@@ -0,0 +1,549 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include "gtest-api.h"
+#import "Accelerate/Accelerate.h"
+#include "vDSPInternal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// The micro-kernel is checked bit for bit against the plain loop over the same packed panels, and sgemm and dgemm
+// against products taken in double precision, to within K + 2 epsilon of the sum of the magnitudes of the terms. The
+// batched functions and every thread count must give exactly what one cblas_?gemm call at a time does.
+
+namespace {
+
+template <typename T>
+const vDSPKernelSet<T>& _set(const vDSPKernels& kernels);
+
+template <>
+const vDSPKernelSet<float>& _set(const vDSPKernels& kernels) {
+    return kernels.f;
+}
+
+template <>
+const vDSPKernelSet<double>& _set(const vDSPKernels& kernels) {
+    return kernels.d;
+}
+
+template <typename T>
+std::vector<T> _values(size_t count, unsigned int seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<T> distribution(-1, 1);
+    std::vector<T> values(count);
+    for (T& value : values) {
+        value = distribution(generator);
+    }
+    return values;
+}
+
+// A product kept out of any fused multiply-add.
+template <typename T>
+T _product(T a, T b) {
+    volatile T product = a * b;
+    return product;
+}
+
+template <typename T>
+bool _same(T a, T b) {
+    return memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+void _gemm(const enum CBLAS_ORDER Order,
+           const enum CBLAS_TRANSPOSE TransA,
+           const enum CBLAS_TRANSPOSE TransB,
+           const int M,
+           const int N,
+           const int K,
+           const float alpha,
+           const float* A,
+           const int lda,
+           const float* B,
+           const int ldb,
+           const float beta,
+           float* C,
+           const int ldc) {
+    cblas_sgemm(Order, TransA, TransB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+void _gemm(const enum CBLAS_ORDER Order,
+           const enum CBLAS_TRANSPOSE TransA,
+           const enum CBLAS_TRANSPOSE TransB,
+           const int M,
+           const int N,
+           const int K,
+           const double alpha,
+           const double* A,
+           const int lda,
+           const double* B,
+           const int ldb,
+           const double beta,
+           double* C,
+           const int ldc) {
+    cblas_dgemm(Order, TransA, TransB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+void _gemmStrided(const enum CBLAS_ORDER Order,
+                  const enum CBLAS_TRANSPOSE TransA,
+                  const enum CBLAS_TRANSPOSE TransB,
+                  const int M,
+                  const int N,
+                  const int K,
+                  const float alpha,
+                  const float* A,
+                  const int lda,
+                  const int stridea,
+                  const float* B,
+                  const int ldb,
+                  const int strideb,
+                  const float beta,
+                  float* C,
+                  const int ldc,
+                  const int stridec,
+                  const int batch_size) {
+    cblas_sgemm_batch_strided(Order, TransA, TransB, M, N, K, alpha, A, lda, stridea, B, ldb, strideb, beta, C, ldc, stridec, batch_size);
+}
+
+void _gemmStrided(const enum CBLAS_ORDER Order,
+                  const enum CBLAS_TRANSPOSE TransA,
+                  const enum CBLAS_TRANSPOSE TransB,
+                  const int M,
+                  const int N,
+                  const int K,
+                  const double alpha,
+                  const double* A,
+                  const int lda,
+                  const int stridea,
+                  const double* B,
+                  const int ldb,
+                  const int strideb,
+                  const double beta,
+                  double* C,
+                  const int ldc,
+                  const int stridec,
+                  const int batch_size) {
+    cblas_dgemm_batch_strided(Order, TransA, TransB, M, N, K, alpha, A, lda, stridea, B, ldb, strideb, beta, C, ldc, stridec, batch_size);
+}
+
+const enum CBLAS_TRANSPOSE c_transposes[] = { CblasNoTrans, CblasTrans, CblasConjTrans };
+
+// One product's matrices, each with a few elements to spare at the end of every row or column.
+template <typename T>
+struct Product {
+    enum CBLAS_ORDER order;
+    enum CBLAS_TRANSPOSE transA;
+    enum CBLAS_TRANSPOSE transB;
+    int M;
+    int N;
+    int K;
+    int lda;
+    int ldb;
+    int ldc;
+    std::vector<T> A;
+    std::vector<T> B;
+    std::vector<T> C;
+
+    Product(enum CBLAS_ORDER order, enum CBLAS_TRANSPOSE transA, enum CBLAS_TRANSPOSE transB, int M, int N, int K, unsigned int seed)
+        : order(order), transA(transA), transB(transB), M(M), N(N), K(K) {
+        const bool rowMajor = order == CblasRowMajor;
+        lda = ((transA == CblasNoTrans) != rowMajor ? M : K) + 3;
+        ldb = ((transB == CblasNoTrans) != rowMajor ? K : N) + 2;
+        ldc = (rowMajor ? N : M) + 1;
+        A = _values<T>(lda * (((transA == CblasNoTrans) != rowMajor) ? K : M), seed);
+        B = _values<T>(ldb * (((transB == CblasNoTrans) != rowMajor) ? N : K), seed + 1);
+        C = _values<T>(ldc * (rowMajor ? M : N), seed + 2);
+    }
+
+    // The element at row i and column j of op(A), op(B) and C.
+    T a(int i, int p) const {
+        const bool transpose = transA != CblasNoTrans;
+        return (transpose != (order == CblasRowMajor)) ? A[p + i * lda] : A[i + p * lda];
+    }
+
+    T b(int p, int j) const {
+        const bool transpose = transB != CblasNoTrans;
+        return (transpose != (order == CblasRowMajor)) ? B[j + p * ldb] : B[p + j * ldb];
+    }
+
+    size_t c(int i, int j) const {
+        return (order == CblasRowMajor) ? j + i * ldc : i + j * ldc;
+    }
+
+    void multiply(T alpha, T beta) {
+        _gemm(order, transA, transB, M, N, K, alpha, A.data(), lda, B.data(), ldb, beta, C.data(), ldc);
+    }
+};
+
+template <typename T>
+void _checkKernels() {
+    const vDSP_Length ldc = vDSPGemmRows + 3;
+    const T c_untouched = 12345;
+
+    for (const vDSPKernels* kernels : vDSPGetAvailableKernels()) {
+        const vDSPKernelSet<T>& set = _set<T>(*kernels);
+        for (vDSP_Length K : { 0, 1, 2, 7, 64, 257 }) {
+            for (vDSP_Length N : { 0, 3, 4, 5, 8, 13 }) {
+                const vDSP_Length panels = (N + vDSPGemmColumns - 1) / vDSPGemmColumns;
+                std::vector<T> A = _values<T>(vDSPGemmRows * K, static_cast<unsigned int>(K));
+                std::vector<T> B = _values<T>(vDSPGemmColumns * K * panels, static_cast<unsigned int>(K + N + 100));
+                std::vector<T> C = _values<T>(ldc * N, static_cast<unsigned int>(N + 200));
+                for (vDSP_Length j = 0; j < N; ++j) {
+                    std::fill(C.begin() + j * ldc + vDSPGemmRows, C.begin() + (j + 1) * ldc, c_untouched);
+                }
+                const std::vector<T> original = C;
+                const T alpha = static_cast<T>(0.75);
+
+                vDSP_Length done = set.gemm(A.data(), B.data(), K, alpha, C.data(), ldc, N);
+                ASSERT_EQ(N - N % vDSPGemmColumns, done) << kernels->name;
+                for (vDSP_Length j = 0; j < N; ++j) {
+                    for (vDSP_Length i = 0; i < ldc; ++i) {
+                        T expected = original[i + j * ldc];
+                        if (i < vDSPGemmRows && j < done) {
+                            const T* panel = B.data() + (j / vDSPGemmColumns) * vDSPGemmColumns * K;
+                            T sum = 0;
+                            for (vDSP_Length p = 0; p < K; ++p) {
+                                sum += _product(A[p * vDSPGemmRows + i], panel[p * vDSPGemmColumns + j % vDSPGemmColumns]);
+                            }
+                            expected += _product(sum, alpha);
+                        }
+                        ASSERT_TRUE(_same(expected, C[i + j * ldc])) << "gemm (" << kernels->name << "), K = " << K << ", N = " << N
+                                                                     << ", row " << i << ", column " << j;
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void _checkProducts() {
+    struct Size {
+        int M;
+        int N;
+        int K;
+    };
+
+    // Whole tiles and parts of them, inner dimensions across more than one block, and more rows than a block of A.
+    const Size sizes[] = { { 1, 1, 1 }, { 4, 4, 4 }, { 8, 4, 16 }, { 7, 9, 5 }, { 17, 33, 300 }, { 150, 6, 3 }, { 3, 0, 2 }, { 5, 6, 0 } };
+    const T scalars[][2] = { { 1, 0 }, { static_cast<T>(0.75), static_cast<T>(-0.5) }, { 0, 2 }, { -1, 1 } };
+
+    unsigned int seed = 0;
+    for (enum CBLAS_ORDER order : { CblasColMajor, CblasRowMajor }) {
+        for (enum CBLAS_TRANSPOSE transA : c_transposes) {
+            for (enum CBLAS_TRANSPOSE transB : c_transposes) {
+                for (const Size& size : sizes) {
+                    for (const auto& scalar : scalars) {
+                        const T alpha = scalar[0];
+                        const T beta = scalar[1];
+                        Product<T> product(order, transA, transB, size.M, size.N, size.K, ++seed);
+
+                        // With beta 0, C is only written, NaN or not.
+                        if (beta == 0) {
+                            std::fill(product.C.begin(), product.C.end(), std::numeric_limits<T>::quiet_NaN());
+                        }
+                        const std::vector<T> original = product.C;
+                        product.multiply(alpha, beta);
+
+                        const std::string name = std::string((order == CblasRowMajor) ? "row major" : "column major") + ", op(A) " +
+                                                 std::to_string(transA) + ", op(B) " + std::to_string(transB) + ", " +
+                                                 std::to_string(size.M) + " x " + std::to_string(size.N) + " x " + std::to_string(size.K);
+                        for (size_t index = 0; index < product.C.size(); ++index) {
+                            if (index % product.ldc >= static_cast<size_t>((order == CblasRowMajor) ? size.N : size.M)) {
+                                ASSERT_TRUE(_same(original[index], product.C[index])) << name << ", spare element " << index;
+                            }
+                        }
+
+                        for (int i = 0; i < size.M; ++i) {
+                            for (int j = 0; j < size.N; ++j) {
+                                double expected = (beta == 0) ? 0 : double(beta) * original[product.c(i, j)];
+                                double magnitude = std::fabs(expected);
+                                for (int p = 0; p < size.K && alpha != 0; ++p) {
+                                    const double term = double(alpha) * product.a(i, p) * product.b(p, j);
+                                    expected += term;
+                                    magnitude += std::fabs(term);
+                                }
+                                const double tolerance = (size.K + 2) * magnitude * std::numeric_limits<T>::epsilon();
+                                ASSERT_NEAR(expected, product.C[product.c(i, j)], tolerance)
+                                    << name << ", alpha " << alpha << ", beta " << beta << ", row " << i << ", column " << j;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Large enough to be split across threads, by rows and by columns.
+template <typename T>
+void _checkThreads() {
+    for (const auto& size : { std::make_pair(300, 200), std::make_pair(100, 500) }) {
+        for (enum CBLAS_TRANSPOSE trans : { CblasNoTrans, CblasTrans }) {
+            Product<T> product(CblasColMajor, trans, trans, size.first, size.second, 270, 7);
+            Product<T> single = product;
+
+            SetBLASThreadCount(1);
+            EXPECT_EQ(1, GetBLASThreadCount());
+            single.multiply(static_cast<T>(1.5), static_cast<T>(0.5));
+            SetBLASThreadCount(0);
+            EXPECT_EQ(0, GetBLASThreadCount());
+            product.multiply(static_cast<T>(1.5), static_cast<T>(0.5));
+
+            for (size_t i = 0; i < product.C.size(); ++i) {
+                ASSERT_TRUE(_same(single.C[i], product.C[i])) << size.first << " x " << size.second << ", element " << i;
+            }
+        }
+    }
+}
+
+// Many small products, spread across threads, and a few large ones, each split across threads; A is shared by all of
+// them through a stride of 0.
+template <typename T>
+void _checkStrided() {
+    struct Batch {
+        enum CBLAS_ORDER order;
+        enum CBLAS_TRANSPOSE transA;
+        enum CBLAS_TRANSPOSE transB;
+        int M;
+        int N;
+        int K;
+        int count;
+    };
+    const Batch batches[] = { { CblasRowMajor, CblasNoTrans, CblasNoTrans, 4, 4, 4, 3000 },
+                              { CblasColMajor, CblasTrans, CblasNoTrans, 9, 7, 5, 1000 },
+                              { CblasRowMajor, CblasNoTrans, CblasTrans, 64, 64, 64, 100 },
+                              { CblasColMajor, CblasNoTrans, CblasNoTrans, 200, 180, 190, 3 },
+                              { CblasColMajor, CblasNoTrans, CblasNoTrans, 4, 4, 4, 0 } };
+    for (const Batch& batch : batches) {
+        Product<T> product(batch.order, batch.transA, batch.transB, batch.M, batch.N, batch.K, 11);
+        const int strideB = static_cast<int>(product.B.size());
+        const int strideC = static_cast<int>(product.C.size());
+        std::vector<T> B = _values<T>(strideB * batch.count, 12);
+        std::vector<T> C = _values<T>(strideC * batch.count, 13);
+        std::vector<T> expected = C;
+        for (int i = 0; i < batch.count; ++i) {
+            _gemm(batch.order,
+                  batch.transA,
+                  batch.transB,
+                  batch.M,
+                  batch.N,
+                  batch.K,
+                  static_cast<T>(0.5),
+                  product.A.data(),
+                  product.lda,
+                  B.data() + i * strideB,
+                  product.ldb,
+                  static_cast<T>(-1),
+                  expected.data() + i * strideC,
+                  product.ldc);
+        }
+
+        _gemmStrided(batch.order,
+                     batch.transA,
+                     batch.transB,
+                     batch.M,
+                     batch.N,
+                     batch.K,
+                     static_cast<T>(0.5),
+                     product.A.data(),
+                     product.lda,
+                     0,
+                     B.data(),
+                     product.ldb,
+                     strideB,
+                     static_cast<T>(-1),
+                     C.data(),
+                     product.ldc,
+                     strideC,
+                     batch.count);
+        for (size_t i = 0; i < C.size(); ++i) {
+            ASSERT_TRUE(_same(expected[i], C[i])) << batch.M << " x " << batch.N << " x " << batch.K << ", element " << i;
+        }
+    }
+}
+
+int s_errorPosition;
+
+void _recordError(const char* funcName, const char* paramName, const int* paramPos, const int* paramValue) {
+    s_errorPosition = *paramPos;
+}
+
+} // namespace
+
+TEST(BLASGemm, KernelsMatchLoops) {
+    _checkKernels<float>();
+    _checkKernels<double>();
+}
+
+TEST(BLASGemm, MatchesProducts) {
+    _checkProducts<float>();
+    _checkProducts<double>();
+}
+
+TEST(BLASGemm, ThreadCount) {
+    _checkThreads<float>();
+    _checkThreads<double>();
+}
+
+TEST(BLASGemm, StridedBatch) {
+    _checkStrided<float>();
+    _checkStrided<double>();
+}
+
+TEST(BLASGemm, GroupedBatch) {
+    // A group of small row-major products with transposes and a group of larger column-major ones.
+    std::vector<Product<float>> products;
+    for (int i = 0; i < 50; ++i) {
+        products.emplace_back(CblasRowMajor, CblasTrans, CblasNoTrans, 6, 5, 4, i);
+    }
+    for (int i = 0; i < 3; ++i) {
+        products.emplace_back(CblasRowMajor, CblasNoTrans, CblasConjTrans, 70, 90, 130, 100 + i);
+    }
+    std::vector<Product<float>> expected = products;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        expected[i].multiply((i < 50) ? 2.0f : -1.0f, (i < 50) ? 0.0f : 0.25f);
+    }
+
+    const enum CBLAS_TRANSPOSE transA[] = { CblasTrans, CblasNoTrans };
+    const enum CBLAS_TRANSPOSE transB[] = { CblasNoTrans, CblasConjTrans };
+    const int M[] = { 6, 70 };
+    const int N[] = { 5, 90 };
+    const int K[] = { 4, 130 };
+    const float alpha[] = { 2.0f, -1.0f };
+    const float beta[] = { 0.0f, 0.25f };
+    const int lda[] = { products[0].lda, products[50].lda };
+    const int ldb[] = { products[0].ldb, products[50].ldb };
+    const int ldc[] = { products[0].ldc, products[50].ldc };
+    const int sizes[] = { 50, 3 };
+    std::vector<const float*> A;
+    std::vector<const float*> B;
+    std::vector<float*> C;
+    for (Product<float>& product : products) {
+        A.push_back(product.A.data());
+        B.push_back(product.B.data());
+        C.push_back(product.C.data());
+    }
+
+    cblas_sgemm_batch(CblasRowMajor, transA, transB, M, N, K, alpha, A.data(), lda, B.data(), ldb, beta, C.data(), ldc, 2, sizes);
+    for (size_t i = 0; i < products.size(); ++i) {
+        for (size_t j = 0; j < products[i].C.size(); ++j) {
+            ASSERT_TRUE(_same(expected[i].C[j], products[i].C[j])) << "product " << i << ", element " << j;
+        }
+    }
+
+    // And the same through cblas_dgemm_batch, with a group of none.
+    std::vector<Product<double>> doubles;
+    doubles.emplace_back(CblasColMajor, CblasNoTrans, CblasTrans, 9, 3, 17, 1);
+    Product<double> single = doubles[0];
+    single.multiply(1.0, 1.0);
+    const enum CBLAS_TRANSPOSE noTrans[] = { CblasNoTrans, CblasNoTrans };
+    const enum CBLAS_TRANSPOSE trans[] = { CblasTrans, CblasTrans };
+    const int dM[] = { 1, 9 };
+    const int dN[] = { 1, 3 };
+    const int dK[] = { 1, 17 };
+    const double ones[] = { 1.0, 1.0 };
+    const int dlda[] = { 1, doubles[0].lda };
+    const int dldb[] = { 1, doubles[0].ldb };
+    const int dldc[] = { 1, doubles[0].ldc };
+    const int dSizes[] = { 0, 1 };
+    const double* dA = doubles[0].A.data();
+    const double* dB = doubles[0].B.data();
+    double* dC = doubles[0].C.data();
+    cblas_dgemm_batch(CblasColMajor, noTrans, trans, dM, dN, dK, ones, &dA, dlda, &dB, dldb, ones, &dC, dldc, 2, dSizes);
+    for (size_t j = 0; j < single.C.size(); ++j) {
+        ASSERT_TRUE(_same(single.C[j], doubles[0].C[j])) << "element " << j;
+    }
+}
+
+TEST(BLASGemm, Errors) {
+    SetBLASParamErrorProc(_recordError);
+    float A[16] = {};
+    float B[16] = {};
+    float C[16] = {};
+    const float* pointersA[] = { A };
+    const float* pointersB[] = { B };
+    float* pointersC[] = { C };
+
+    struct Case {
+        int M;
+        int lda;
+        int ldb;
+        int ldc;
+        int count;
+        int strided;
+        int grouped;
+    };
+
+    // The strides follow each leading dimension in the strided form, and the groups come last in the grouped one.
+    const Case cases[] = { { -1, 4, 4, 4, 1, 4, 4 }, { 4, 3, 4, 4, 1, 9, 9 }, { 4, 4, 3, 4, 1, 12, 11 },
+                           { 4, 4, 4, 3, 1, 16, 14 }, { 4, 4, 4, 4, -1, 18, 16 } };
+    const enum CBLAS_TRANSPOSE noTrans = CblasNoTrans;
+    const int four = 4;
+    const float one = 1;
+    for (const Case& c : cases) {
+        s_errorPosition = 0;
+        cblas_sgemm_batch_strided(
+            CblasColMajor, CblasNoTrans, CblasNoTrans, c.M, 4, 4, 1, A, c.lda, 0, B, c.ldb, 0, 0, C, c.ldc, 0, c.count);
+        EXPECT_EQ(c.strided, s_errorPosition);
+
+        s_errorPosition = 0;
+        cblas_sgemm_batch(CblasColMajor,
+                          &noTrans,
+                          &noTrans,
+                          &c.M,
+                          &four,
+                          &four,
+                          &one,
+                          pointersA,
+                          &c.lda,
+                          pointersB,
+                          &c.ldb,
+                          &one,
+                          pointersC,
+                          &c.ldc,
+                          1,
+                          &c.count);
+        EXPECT_EQ(c.grouped, s_errorPosition);
+    }
+
+    const enum CBLAS_TRANSPOSE bad = static_cast<enum CBLAS_TRANSPOSE>(0);
+    s_errorPosition = 0;
+    cblas_sgemm_batch_strided(CblasColMajor, CblasNoTrans, bad, 4, 4, 4, 1, A, 4, 0, B, 4, 0, 0, C, 4, 0, 1);
+    EXPECT_EQ(3, s_errorPosition);
+
+    s_errorPosition = 0;
+    const enum CBLAS_ORDER badOrder = static_cast<enum CBLAS_ORDER>(0);
+    cblas_sgemm_batch(
+        badOrder, &bad, &bad, &four, &four, &four, &one, pointersA, &four, pointersB, &four, &one, pointersC, &four, 1, &four);
+    EXPECT_EQ(1, s_errorPosition);
+
+    s_errorPosition = 0;
+    cblas_sgemm_batch(CblasColMajor, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                      nullptr, nullptr, -1, nullptr);
+    EXPECT_EQ(15, s_errorPosition);
+
+    // Nothing was multiplied.
+    for (float value : C) {
+        EXPECT_EQ(0.0f, value);
+    }
+    SetBLASParamErrorProc(NULL);
+}
@@ -0,0 +1,302 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include "gtest-api.h"
+#import "Accelerate/Accelerate.h"
+#include "vDSPInternal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+// The filter kernels are checked bit for bit against the scalar loops, and the public functions, by either method,
+// against sums taken in double precision. The FFTs spread their rounding errors over whole blocks, so the results need
+// only be within a few epsilon of the largest a sum could be, the largest |A| times the sum of |F|.
+
+namespace {
+
+template <typename T>
+const vDSPKernelSet<T>& _set(const vDSPKernels& kernels);
+
+template <>
+const vDSPKernelSet<float>& _set(const vDSPKernels& kernels) {
+    return kernels.f;
+}
+
+template <>
+const vDSPKernelSet<double>& _set(const vDSPKernels& kernels) {
+    return kernels.d;
+}
+
+template <typename T>
+std::vector<T> _values(size_t count, unsigned int seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<T> distribution(-1, 1);
+    std::vector<T> values(count);
+    for (T& value : values) {
+        value = distribution(generator);
+    }
+    return values;
+}
+
+// A product kept out of any fused multiply-add.
+template <typename T>
+T _product(T a, T b) {
+    volatile T product = a * b;
+    return product;
+}
+
+template <typename T>
+bool _same(T a, T b) {
+    return memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+template <typename T>
+void _checkKernels() {
+    const vDSP_Length lengths[] = { 0, 1, 3, 4, 7, 8, 15, 16, 17, 33, 100 };
+    const vDSP_Length taps[] = { 1, 2, 3, 7, 16, 33 };
+    const T c_untouched = 12345;
+
+    for (const vDSPKernels* kernels : vDSPGetAvailableKernels()) {
+        const vDSPKernelSet<T>& set = _set<T>(*kernels);
+        for (vDSP_Length N : lengths) {
+            for (vDSP_Length P : taps) {
+                for (vDSP_Stride IF : { 1, -1, 2 }) {
+                    std::vector<T> A = _values<T>(N + P, static_cast<unsigned int>(N + P));
+                    std::vector<T> filter = _values<T>(2 * P, static_cast<unsigned int>(P + 100));
+                    const T* F = filter.data() + ((IF < 0) ? P - 1 : 0);
+                    std::vector<T> C(N, c_untouched);
+                    vDSP_Length done = set.conv(A.data(), F, IF, C.data(), N, P);
+                    ASSERT_LE(done, N);
+                    for (vDSP_Length n = 0; n < N; ++n) {
+                        T expected = c_untouched;
+                        if (n < done) {
+                            expected = 0;
+                            for (vDSP_Length p = 0; p < P; ++p) {
+                                expected += _product(A[n + p], F[p * IF]);
+                            }
+                        }
+                        ASSERT_TRUE(_same(expected, C[n])) << "conv (" << kernels->name << "), N = " << N << ", P = " << P
+                                                           << ", IF = " << IF << ", element " << n;
+                    }
+                }
+
+                for (vDSP_Stride DF : { 1, 2, 3, 5 }) {
+                    std::vector<T> A = _values<T>(N * DF + P, static_cast<unsigned int>(N * DF + P));
+                    std::vector<T> F = _values<T>(P, static_cast<unsigned int>(P + 200));
+                    std::vector<T> C(N, c_untouched);
+                    vDSP_Length done = set.desamp(A.data(), DF, F.data(), C.data(), N, P);
+                    ASSERT_LE(done, N);
+                    for (vDSP_Length n = 0; n < N; ++n) {
+                        T expected = c_untouched;
+                        if (n < done) {
+                            expected = 0;
+                            for (vDSP_Length p = 0; p < P; ++p) {
+                                expected += _product(A[n * DF + p], F[p]);
+                            }
+                        }
+                        ASSERT_TRUE(_same(expected, C[n])) << "desamp (" << kernels->name << "), N = " << N << ", P = " << P
+                                                           << ", DF = " << DF << ", element " << n;
+                    }
+                }
+            }
+
+            for (vDSP_Length K : { 1, 3, 5 }) {
+                const vDSP_Length NC = N + K + 2;
+                std::vector<T> A = _values<T>(K * NC, static_cast<unsigned int>(N + K));
+                std::vector<T> F = _values<T>(K * K, static_cast<unsigned int>(K + 300));
+                std::vector<T> C(N, c_untouched);
+                vDSP_Length done = set.imgfir(A.data(), NC, F.data(), K, K, C.data(), N);
+                ASSERT_LE(done, N);
+                for (vDSP_Length n = 0; n < N; ++n) {
+                    T expected = c_untouched;
+                    if (n < done) {
+                        expected = 0;
+                        for (vDSP_Length i = 0; i < K; ++i) {
+                            for (vDSP_Length j = 0; j < K; ++j) {
+                                expected += _product(A[i * NC + n + j], F[i * K + j]);
+                            }
+                        }
+                    }
+                    ASSERT_TRUE(_same(expected, C[n])) << "imgfir (" << kernels->name << "), N = " << N << ", K = " << K << ", element "
+                                                       << n;
+                }
+            }
+        }
+    }
+}
+
+// Checks C[n * IC] against the sum over p of A[(n * DF + p) * IA] * F[p * IF].
+template <typename T>
+void _checkFilter(const char* name,
+                  const T* A,
+                  vDSP_Stride IA,
+                  vDSP_Stride DF,
+                  const T* F,
+                  vDSP_Stride IF,
+                  const T* C,
+                  vDSP_Stride IC,
+                  vDSP_Length N,
+                  vDSP_Length P) {
+    double largest = 0;
+    for (vDSP_Length i = 0; i < (N - 1) * DF + P; ++i) {
+        largest = std::max(largest, std::fabs(static_cast<double>(A[i * IA])));
+    }
+    double taps = 0;
+    for (vDSP_Length p = 0; p < P; ++p) {
+        taps += std::fabs(F[p * IF]);
+    }
+
+    const double tolerance = 16 * std::numeric_limits<T>::epsilon() * (log2(static_cast<double>(P)) + 1) * largest * taps;
+    for (vDSP_Length n = 0; n < N; ++n) {
+        double expected = 0;
+        for (vDSP_Length p = 0; p < P; ++p) {
+            expected += static_cast<double>(A[(n * DF + p) * IA]) * F[p * IF];
+        }
+        ASSERT_NEAR(expected, C[n * IC], tolerance)
+            << name << ", N = " << N << ", P = " << P << ", IA = " << IA << ", DF = " << DF << ", IF = " << IF << ", IC = " << IC
+            << ", element " << n;
+    }
+}
+
+template <typename T>
+void _checkMethods() {
+    const vDSP_Length lengths[] = { 1, 5, 64, 1000, 4099 };
+    const vDSP_Length taps[] = { 1, 2, 9, 64, 129, 1000 };
+    const vDSPFilterMethod methods[] = { vDSPFilterAutomatic, vDSPFilterDirect, vDSPFilterFFT };
+    const char* names[] = { "automatic", "direct", "FFT" };
+
+    for (int method = 0; method < 3; ++method) {
+        for (vDSP_Length N : lengths) {
+            for (vDSP_Length P : taps) {
+                for (vDSP_Stride IA : { 1, 2 }) {
+                    for (vDSP_Stride IF : { 1, -1 }) {
+                        const vDSP_Stride IC = 3 - IA;
+                        std::vector<T> A = _values<T>((N + P) * IA, static_cast<unsigned int>(N * 7 + P));
+                        std::vector<T> filter = _values<T>(P, static_cast<unsigned int>(P));
+                        const T* F = filter.data() + ((IF < 0) ? P - 1 : 0);
+                        std::vector<T> C(N * IC);
+                        vDSPFilter(A.data(), IA, 1, F, IF, C.data(), IC, N, P, methods[method]);
+                        _checkFilter(names[method], A.data(), IA, 1, F, IF, C.data(), IC, N, P);
+                    }
+                }
+
+                for (vDSP_Stride DF : { 2, 3, 8 }) {
+                    std::vector<T> A = _values<T>(N * DF + P, static_cast<unsigned int>(N * 5 + P));
+                    std::vector<T> F = _values<T>(P, static_cast<unsigned int>(P + 1));
+                    std::vector<T> C(N);
+                    vDSPFilter(A.data(), 1, DF, F.data(), 1, C.data(), 1, N, P, methods[method]);
+                    _checkFilter(names[method], A.data(), 1, DF, F.data(), 1, C.data(), 1, N, P);
+                }
+            }
+        }
+    }
+}
+
+// Checks the K x K filter of an NR x NC image, with zeros where the filter would reach past the edges.
+template <typename T>
+void _checkImage(void (*filter)(const T*, vDSP_Length, vDSP_Length, const T*, T*), vDSP_Length K, vDSP_Length NR, vDSP_Length NC) {
+    std::vector<T> A = _values<T>(NR * NC, static_cast<unsigned int>(NR * NC));
+    std::vector<T> F = _values<T>(K * K, static_cast<unsigned int>(K));
+    std::vector<T> C(NR * NC, 12345);
+    filter(A.data(), NR, NC, F.data(), C.data());
+
+    const vDSP_Length edge = K / 2;
+    for (vDSP_Length row = 0; row < NR; ++row) {
+        for (vDSP_Length column = 0; column < NC; ++column) {
+            double expected = 0;
+            if (row >= edge && row + edge < NR && column >= edge && column + edge < NC) {
+                for (vDSP_Length i = 0; i < K; ++i) {
+                    for (vDSP_Length j = 0; j < K; ++j) {
+                        expected += static_cast<double>(A[(row + i - edge) * NC + column + j - edge]) * F[i * K + j];
+                    }
+                }
+            }
+            ASSERT_NEAR(expected, C[row * NC + column], K * K * 4 * std::numeric_limits<T>::epsilon())
+                << K << " x " << K << ", " << NR << " x " << NC << ", row " << row << ", column " << column;
+        }
+    }
+}
+
+} // namespace
+
+TEST(vDSPConvolution, KernelsMatchLoops) {
+    _checkKernels<float>();
+    _checkKernels<double>();
+}
+
+TEST(vDSPConvolution, DirectAndFFTMatchSums) {
+    _checkMethods<float>();
+    _checkMethods<double>();
+}
+
+TEST(vDSPConvolution, ConvolutionIsCorrelationReversed) {
+    const float A[] = { 1, 2, 3, 4, 5, 6 };
+    const float F[] = { 1, 10, 100 };
+    float correlation[4];
+    float convolution[4];
+    vDSP_conv(A, 1, F, 1, correlation, 1, 4, 3);
+    vDSP_conv(A, 1, F + 2, -1, convolution, 1, 4, 3);
+
+    const float expectedCorrelation[] = { 321, 432, 543, 654 };
+    const float expectedConvolution[] = { 123, 234, 345, 456 };
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(expectedCorrelation[i], correlation[i]);
+        EXPECT_EQ(expectedConvolution[i], convolution[i]);
+    }
+}
+
+TEST(vDSPConvolution, Decimation) {
+    const double A[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    const double F[] = { 0.5, 0.25, 0.25 };
+    double C[4];
+    vDSP_desampD(A, 2, F, C, 4, 3);
+
+    const double expected[] = { 1.75, 3.75, 5.75, 7.75 };
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(expected[i], C[i]);
+    }
+}
+
+// A long stream, long enough to be split across threads by either method.
+TEST(vDSPConvolution, LongStreams) {
+    const vDSP_Length N = 1 << 20;
+    for (vDSP_Length P : { 31, 2049 }) {
+        std::vector<float> A = _values<float>(N + P - 1, 1);
+        std::vector<float> F = _values<float>(P, 2);
+        std::vector<float> C(N);
+        vDSP_conv(A.data(), 1, F.data(), 1, C.data(), 1, N, P);
+
+        // Every 97th output, so that the check does not take longer than the filter.
+        for (vDSP_Length n = 0; n < N; n += 97) {
+            _checkFilter("vDSP_conv", A.data() + n, 1, 1, F.data(), 1, C.data() + n, 1, 1, P);
+        }
+    }
+}
+
+TEST(vDSPConvolution, ImageFilters) {
+    for (vDSP_Length NR : { 1, 3, 4, 5, 17, 300 }) {
+        for (vDSP_Length NC : { 4, 6, 18, 64, 258 }) {
+            _checkImage<float>(vDSP_f3x3, 3, NR, NC);
+            _checkImage<double>(vDSP_f3x3D, 3, NR, NC);
+            _checkImage<float>(vDSP_f5x5, 5, NR, NC);
+            _checkImage<double>(vDSP_f5x5D, 5, NR, NC);
+        }
+    }
+}
@@ -0,0 +1,445 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include "gtest-api.h"
+#import "Accelerate/Accelerate.h"
+#include "vDSPInternal.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+// The FFTs are checked against the DFT computed from its definition in double precision. Their error grows with the
+// logarithm of the length, so results must be within a few epsilon times log2 N of it, relative to its norm.
+
+namespace {
+
+template <typename T>
+const vDSPKernelSet<T>& _set(const vDSPKernels& kernels);
+
+template <>
+const vDSPKernelSet<float>& _set(const vDSPKernels& kernels) {
+    return kernels.f;
+}
+
+template <>
+const vDSPKernelSet<double>& _set(const vDSPKernels& kernels) {
+    return kernels.d;
+}
+
+template <typename T>
+std::vector<T> _values(size_t count, unsigned int seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<T> distribution(-1, 1);
+    std::vector<T> values(count);
+    for (T& value : values) {
+        value = distribution(generator);
+    }
+    return values;
+}
+
+// y = sum over n of x[n] * e^(direction * 2 pi i k n / N), with direction -1 for the forward transform.
+template <typename T>
+void _dft(const T* xr, const T* xi, size_t N, int direction, std::vector<double>& yr, std::vector<double>& yi) {
+    yr.assign(N, 0);
+    yi.assign(N, 0);
+    for (size_t k = 0; k < N; ++k) {
+        for (size_t n = 0; n < N; ++n) {
+            const double angle = direction * 2 * M_PI * static_cast<double>((k * n) % N) / N;
+            yr[k] += xr[n] * cos(angle) - xi[n] * sin(angle);
+            yi[k] += xr[n] * sin(angle) + xi[n] * cos(angle);
+        }
+    }
+}
+
+// The norm of the difference from the expected values, relative to theirs.
+template <typename T>
+double _error(const T* re, const T* im, const std::vector<double>& expectedR, const std::vector<double>& expectedI) {
+    double difference = 0;
+    double norm = 0;
+    for (size_t i = 0; i < expectedR.size(); ++i) {
+        difference += (re[i] - expectedR[i]) * (re[i] - expectedR[i]) + (im[i] - expectedI[i]) * (im[i] - expectedI[i]);
+        norm += expectedR[i] * expectedR[i] + expectedI[i] * expectedI[i];
+    }
+    return (norm == 0) ? sqrt(difference) : sqrt(difference / norm);
+}
+
+template <typename T>
+double _tolerance(size_t N) {
+    return 8 * std::numeric_limits<T>::epsilon() * (log2(static_cast<double>(N)) + 1);
+}
+
+// The packed half spectrum vDSP_fft_zrip produces for a real signal: twice X[k] for k < N / 2, with X[N / 2] in the
+// imaginary part of the first element.
+template <typename T>
+void _packedRealDFT(const std::vector<T>& signal, std::vector<double>& packedR, std::vector<double>& packedI) {
+    const size_t N = signal.size();
+    std::vector<T> zero(N, 0);
+    std::vector<double> yr, yi;
+    _dft(signal.data(), zero.data(), N, -1, yr, yi);
+
+    packedR.resize(N / 2);
+    packedI.resize(N / 2);
+    packedR[0] = 2 * yr[0];
+    packedI[0] = 2 * yr[N / 2];
+    for (size_t k = 1; k < N / 2; ++k) {
+        packedR[k] = 2 * yr[k];
+        packedI[k] = 2 * yi[k];
+    }
+}
+
+// The real signal, its even samples in packedR and odd ones in packedI, whose spectrum has the given first half.
+template <typename T>
+void _packedRealIDFT(const T* halfR, const T* halfI, size_t N, std::vector<double>& packedR, std::vector<double>& packedI) {
+    std::vector<double> spectrumR(N, 0), spectrumI(N, 0);
+    spectrumR[0] = halfR[0];
+    spectrumR[N / 2] = halfI[0];
+    for (size_t k = 1; k < N / 2; ++k) {
+        spectrumR[k] = spectrumR[N - k] = halfR[k];
+        spectrumI[k] = halfI[k];
+        spectrumI[N - k] = -halfI[k];
+    }
+
+    std::vector<double> yr, yi;
+    _dft(spectrumR.data(), spectrumI.data(), N, 1, yr, yi);
+    packedR.resize(N / 2);
+    packedI.resize(N / 2);
+    for (size_t i = 0; i < N / 2; ++i) {
+        packedR[i] = yr[2 * i];
+        packedI[i] = yr[2 * i + 1];
+    }
+}
+
+template <typename T, typename Setup, typename Split>
+void _checkComplex(Setup setup,
+                   void (*zip)(Setup, const Split*, vDSP_Stride, vDSP_Length, FFTDirection),
+                   vDSP_Length log2N) {
+    const size_t N = static_cast<size_t>(1) << log2N;
+    std::vector<T> re = _values<T>(N, static_cast<unsigned int>(log2N));
+    std::vector<T> im = _values<T>(N, static_cast<unsigned int>(log2N + 100));
+
+    for (int direction : { kFFTDirection_Forward, kFFTDirection_Inverse }) {
+        std::vector<double> expectedR, expectedI;
+        _dft(re.data(), im.data(), N, -direction, expectedR, expectedI);
+
+        std::vector<T> outR = re, outI = im;
+        Split split = { outR.data(), outI.data() };
+        zip(setup, &split, 1, log2N, direction);
+        EXPECT_GT(_tolerance<T>(N), _error(outR.data(), outI.data(), expectedR, expectedI)) << "2^" << log2N << ", direction "
+                                                                                           << direction;
+    }
+}
+
+template <typename T, typename Setup, typename Split>
+void _checkReal(Setup setup, void (*zrip)(Setup, const Split*, vDSP_Stride, vDSP_Length, FFTDirection), vDSP_Length log2N) {
+    const size_t N = static_cast<size_t>(1) << log2N;
+    std::vector<T> signal = _values<T>(N, static_cast<unsigned int>(log2N + 200));
+    std::vector<double> expectedR, expectedI;
+    _packedRealDFT(signal, expectedR, expectedI);
+
+    std::vector<T> re(N / 2), im(N / 2);
+    for (size_t i = 0; i < N / 2; ++i) {
+        re[i] = signal[2 * i];
+        im[i] = signal[2 * i + 1];
+    }
+    Split split = { re.data(), im.data() };
+    zrip(setup, &split, 1, log2N, kFFTDirection_Forward);
+    EXPECT_GT(_tolerance<T>(N), _error(re.data(), im.data(), expectedR, expectedI)) << "forward, 2^" << log2N;
+
+    _packedRealIDFT(re.data(), im.data(), N, expectedR, expectedI);
+    zrip(setup, &split, 1, log2N, kFFTDirection_Inverse);
+    EXPECT_GT(_tolerance<T>(N), _error(re.data(), im.data(), expectedR, expectedI)) << "inverse, 2^" << log2N;
+
+    // Forward and back gives the signal scaled by 2 N.
+    for (size_t i = 0; i < N / 2; ++i) {
+        ASSERT_NEAR(2 * N * signal[2 * i], re[i], 2 * N * _tolerance<T>(N));
+        ASSERT_NEAR(2 * N * signal[2 * i + 1], im[i], 2 * N * _tolerance<T>(N));
+    }
+}
+
+template <typename T>
+void _checkPasses() {
+    const vDSPKernelSet<T>& loops = _set<T>(*vDSPGetAvailableKernels().back());
+    const unsigned radices[] = { 2, 3, 4, 5, 8 };
+    const vDSP_Length strides[] = { 1, 2, 3, 4, 5, 8, 12, 16, 40 };
+    const vDSP_Length ms[] = { 1, 3, 8 };
+
+    for (const vDSPKernels* kernels : vDSPGetAvailableKernels()) {
+        const vDSPKernelSet<T>& set = _set<T>(*kernels);
+        for (unsigned radix : radices) {
+            typename vDSPKernelSet<T>::FFTPass pass =
+                (radix == 2) ? set.fft2 : (radix == 3) ? set.fft3 : (radix == 4) ? set.fft4 : (radix == 5) ? set.fft5 : set.fft8;
+            typename vDSPKernelSet<T>::FFTPass loop =
+                (radix == 2) ? loops.fft2 : (radix == 3) ? loops.fft3 : (radix == 4) ? loops.fft4 : (radix == 5) ? loops.fft5 : loops.fft8;
+
+            for (vDSP_Length s : strides) {
+                for (vDSP_Length m : ms) {
+                    const size_t n = radix * m * s;
+                    std::vector<T> xr = _values<T>(n, 1), xi = _values<T>(n, 2);
+                    std::vector<T> wr = _values<T>((radix - 1) * m, 3), wi = _values<T>((radix - 1) * m, 4);
+                    std::vector<T> expectedR(n), expectedI(n), yr(n), yi(n);
+
+                    ASSERT_EQ(s, loop(xr.data(), xi.data(), expectedR.data(), expectedI.data(), wr.data(), wi.data(), s, m, 0));
+                    vDSP_Length q = pass(xr.data(), xi.data(), yr.data(), yi.data(), wr.data(), wi.data(), s, m, 0);
+                    ASSERT_LE(q, s);
+                    ASSERT_EQ(s, loop(xr.data(), xi.data(), yr.data(), yi.data(), wr.data(), wi.data(), s, m, q));
+
+                    for (size_t i = 0; i < n; ++i) {
+                        ASSERT_NEAR(expectedR[i], yr[i], 16 * std::numeric_limits<T>::epsilon()) << kernels->name << ", radix "
+                                                                                                 << radix << ", s " << s << ", m " << m;
+                        ASSERT_NEAR(expectedI[i], yi[i], 16 * std::numeric_limits<T>::epsilon()) << kernels->name << ", radix "
+                                                                                                 << radix << ", s " << s << ", m " << m;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// The vector untangling and tangling steps of the real FFTs, for the elements they handle, against the plain loops.
+template <typename T>
+void _checkRealSteps() {
+    const vDSPKernelSet<T>& loops = _set<T>(*vDSPGetAvailableKernels().back());
+    for (const vDSPKernels* kernels : vDSPGetAvailableKernels()) {
+        const vDSPKernelSet<T>& set = _set<T>(*kernels);
+        for (vDSP_Length n = 1; n <= 70; ++n) {
+            std::vector<T> re = _values<T>(n, 1), im = _values<T>(n, 2);
+            std::vector<T> wr = _values<T>(n / 2 + 1, 3), wi = _values<T>(n / 2 + 1, 4);
+
+            std::vector<T> expectedR = re, expectedI = im, outR = re, outI = im;
+            vDSP_Length end = loops.fftUntangle(expectedR.data(), expectedI.data(), wr.data(), wi.data(), n);
+            vDSP_Length k = set.fftUntangle(outR.data(), outI.data(), wr.data(), wi.data(), n);
+            ASSERT_LE(k, end);
+            for (vDSP_Length i = 1; i < k; ++i) {
+                ASSERT_NEAR(expectedR[i], outR[i], 8 * std::numeric_limits<T>::epsilon()) << kernels->name << ", n " << n;
+                ASSERT_NEAR(expectedI[i], outI[i], 8 * std::numeric_limits<T>::epsilon()) << kernels->name << ", n " << n;
+                ASSERT_NEAR(expectedR[n - i], outR[n - i], 8 * std::numeric_limits<T>::epsilon()) << kernels->name << ", n " << n;
+                ASSERT_NEAR(expectedI[n - i], outI[n - i], 8 * std::numeric_limits<T>::epsilon()) << kernels->name << ", n " << n;
+            }
+
+            expectedR = re, expectedI = im;
+            end = loops.fftTangle(re.data(), im.data(), expectedR.data(), expectedI.data(), wr.data(), wi.data(), n);
+            k = set.fftTangle(re.data(), im.data(), outR.data(), outI.data(), wr.data(), wi.data(), n);
+            ASSERT_LE(k, end);
+            for (vDSP_Length i = 1; i < k; ++i) {
+                ASSERT_NEAR(expectedR[i], outR[i], 8 * std::numeric_limits<T>::epsilon()) << kernels->name << ", n " << n;
+                ASSERT_NEAR(expectedI[i], outI[i], 8 * std::numeric_limits<T>::epsilon()) << kernels->name << ", n " << n;
+                ASSERT_NEAR(expectedR[n - i], outR[n - i], 8 * std::numeric_limits<T>::epsilon()) << kernels->name << ", n " << n;
+                ASSERT_NEAR(expectedI[n - i], outI[n - i], 8 * std::numeric_limits<T>::epsilon()) << kernels->name << ", n " << n;
+            }
+        }
+    }
+}
+
+} // namespace
+
+TEST(vDSPFFT, PassKernelsMatchLoops) {
+    _checkPasses<float>();
+    _checkPasses<double>();
+}
+
+TEST(vDSPFFT, RealStepKernelsMatchLoops) {
+    _checkRealSteps<float>();
+    _checkRealSteps<double>();
+}
+
+TEST(vDSPFFT, ComplexMatchesDFT) {
+    FFTSetup setup = vDSP_create_fftsetup(12, kFFTRadix2);
+    FFTSetupD setupD = vDSP_create_fftsetupD(12, kFFTRadix2);
+    ASSERT_NE(nullptr, setup);
+    ASSERT_NE(nullptr, setupD);
+
+    for (vDSP_Length log2N = 0; log2N <= 12; ++log2N) {
+        _checkComplex<float>(setup, vDSP_fft_zip, log2N);
+        _checkComplex<double>(setupD, vDSP_fft_zipD, log2N);
+    }
+
+    vDSP_destroy_fftsetup(setup);
+    vDSP_destroy_fftsetupD(setupD);
+}
+
+TEST(vDSPFFT, RealMatchesDFT) {
+    FFTSetup setup = vDSP_create_fftsetup(12, kFFTRadix2);
+    FFTSetupD setupD = vDSP_create_fftsetupD(12, kFFTRadix2);
+
+    for (vDSP_Length log2N = 1; log2N <= 12; ++log2N) {
+        _checkReal<float>(setup, vDSP_fft_zrip, log2N);
+        _checkReal<double>(setupD, vDSP_fft_zripD, log2N);
+    }
+
+    vDSP_destroy_fftsetup(setup);
+    vDSP_destroy_fftsetupD(setupD);
+}
+
+TEST(vDSPFFT, OutOfPlaceAndStrided) {
+    const vDSP_Length log2N = 9;
+    const size_t N = 1 << log2N;
+    FFTSetup setup = vDSP_create_fftsetup(log2N, kFFTRadix2);
+
+    std::vector<float> re = _values<float>(N, 1), im = _values<float>(N, 2);
+    std::vector<float> inPlaceR = re, inPlaceI = im;
+    DSPSplitComplex inPlace = { inPlaceR.data(), inPlaceI.data() };
+    vDSP_fft_zip(setup, &inPlace, 1, log2N, kFFTDirection_Forward);
+
+    // Every other element in, every third out
+    std::vector<float> stridedR(2 * N, 7), stridedI(2 * N, 7), outR(3 * N, 7), outI(3 * N, 7);
+    for (size_t i = 0; i < N; ++i) {
+        stridedR[2 * i] = re[i];
+        stridedI[2 * i] = im[i];
+    }
+    DSPSplitComplex strided = { stridedR.data(), stridedI.data() };
+    DSPSplitComplex out = { outR.data(), outI.data() };
+    vDSP_fft_zop(setup, &strided, 2, &out, 3, log2N, kFFTDirection_Forward);
+    for (size_t i = 0; i < N; ++i) {
+        ASSERT_EQ(re[i], stridedR[2 * i]);
+        ASSERT_EQ(7, stridedR[2 * i + 1]);
+        ASSERT_EQ(inPlaceR[i], outR[3 * i]);
+        ASSERT_EQ(inPlaceI[i], outI[3 * i]);
+        ASSERT_EQ(7, outR[3 * i + 1]);
+    }
+
+    vDSP_fft_zip(setup, &strided, 2, log2N, kFFTDirection_Forward);
+    for (size_t i = 0; i < N; ++i) {
+        ASSERT_EQ(inPlaceR[i], stridedR[2 * i]);
+        ASSERT_EQ(inPlaceI[i], stridedI[2 * i]);
+    }
+
+    // The real transform of the same data, in place and out of place
+    std::vector<float> realR = re, realI = im;
+    DSPSplitComplex real = { realR.data(), realI.data() };
+    vDSP_fft_zrip(setup, &real, 1, log2N, kFFTDirection_Forward);
+    DSPSplitComplex source = { re.data(), im.data() };
+    vDSP_fft_zrop(setup, &source, 1, &out, 3, log2N, kFFTDirection_Forward);
+    for (size_t i = 0; i < N / 2; ++i) {
+        ASSERT_EQ(realR[i], outR[3 * i]);
+        ASSERT_EQ(realI[i], outI[3 * i]);
+    }
+
+    vDSP_destroy_fftsetup(setup);
+}
+
+TEST(vDSPFFT, SmallerTransformsShareASetup) {
+    FFTSetupD large = vDSP_create_fftsetupD(16, kFFTRadix2);
+    FFTSetupD small = vDSP_create_fftsetupD(6, kFFTRadix2);
+    ASSERT_EQ(nullptr, vDSP_create_fftsetupD(10, 7));
+
+    std::vector<double> re = _values<double>(64, 1), im = _values<double>(64, 2);
+    std::vector<double> fromLargeR = re, fromLargeI = im, fromSmallR = re, fromSmallI = im;
+    DSPDoubleSplitComplex fromLarge = { fromLargeR.data(), fromLargeI.data() };
+    DSPDoubleSplitComplex fromSmall = { fromSmallR.data(), fromSmallI.data() };
+    vDSP_fft_zipD(large, &fromLarge, 1, 6, kFFTDirection_Inverse);
+    vDSP_fft_zipD(small, &fromSmall, 1, 6, kFFTDirection_Inverse);
+    EXPECT_EQ(fromSmallR, fromLargeR);
+    EXPECT_EQ(fromSmallI, fromLargeI);
+
+    // Transforms longer than the setup leave the data alone.
+    vDSP_fft_zipD(small, &fromSmall, 1, 7, kFFTDirection_Forward);
+    vDSP_fft_zripD(small, &fromSmall, 1, 8, kFFTDirection_Forward);
+    EXPECT_EQ(fromLargeR, fromSmallR);
+
+    vDSP_destroy_fftsetupD(large);
+    vDSP_destroy_fftsetupD(small);
+}
+
+TEST(vDSPFFT, ConcurrentTransforms) {
+    const vDSP_Length log2N = 14;
+    const size_t N = 1 << log2N;
+    FFTSetup setup = vDSP_create_fftsetup(log2N, kFFTRadix2);
+
+    std::vector<float> re = _values<float>(N, 1), im = _values<float>(N, 2);
+    std::vector<float> expectedR = re, expectedI = im;
+    DSPSplitComplex expected = { expectedR.data(), expectedI.data() };
+    vDSP_fft_zrip(setup, &expected, 1, log2N + 1, kFFTDirection_Forward);
+
+    std::vector<std::thread> threads;
+    std::vector<int> failures(8, 0);
+    for (size_t t = 0; t < failures.size(); ++t) {
+        threads.emplace_back([&, t]() {
+            for (int round = 0; round < 20; ++round) {
+                std::vector<float> outR = re, outI = im;
+                DSPSplitComplex out = { outR.data(), outI.data() };
+                vDSP_fft_zrip(setup, &out, 1, log2N + 1, kFFTDirection_Forward);
+                failures[t] += (outR != expectedR || outI != expectedI);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (int failed : failures) {
+        EXPECT_EQ(0, failed);
+    }
+    vDSP_destroy_fftsetup(setup);
+}
+
+TEST(vDSPFFT, MixedRadixDFTs) {
+    const vDSP_Length complexLengths[] = { 8, 24, 40, 48, 64, 96, 120, 160, 240, 480, 960 };
+    for (vDSP_Length N : complexLengths) {
+        for (vDSP_DFT_Direction direction : { vDSP_DFT_FORWARD, vDSP_DFT_INVERSE }) {
+            vDSP_DFT_Setup setup = vDSP_DFT_zop_CreateSetup(nullptr, N, direction);
+            vDSP_DFT_SetupD setupD = vDSP_DFT_zop_CreateSetupD(nullptr, N, direction);
+            ASSERT_NE(nullptr, setup);
+            ASSERT_NE(nullptr, setupD);
+
+            std::vector<float> re = _values<float>(N, 1), im = _values<float>(N, 2), outR(N), outI(N);
+            std::vector<double> reD = _values<double>(N, 1), imD = _values<double>(N, 2), outRD(N), outID(N);
+            std::vector<double> expectedR, expectedI;
+
+            _dft(re.data(), im.data(), N, -direction, expectedR, expectedI);
+            vDSP_DFT_Execute(setup, re.data(), im.data(), outR.data(), outI.data());
+            EXPECT_GT(_tolerance<float>(N), _error(outR.data(), outI.data(), expectedR, expectedI)) << N << ", " << direction;
+
+            _dft(reD.data(), imD.data(), N, -direction, expectedR, expectedI);
+            vDSP_DFT_ExecuteD(setupD, reD.data(), imD.data(), outRD.data(), outID.data());
+            EXPECT_GT(_tolerance<double>(N), _error(outRD.data(), outID.data(), expectedR, expectedI)) << N << ", " << direction;
+
+            vDSP_DFT_DestroySetup(setup);
+            vDSP_DFT_DestroySetupD(setupD);
+        }
+    }
+}
+
+TEST(vDSPFFT, MixedRadixRealDFTs) {
+    const vDSP_Length lengths[] = { 16, 48, 80, 96, 160, 240, 480, 1920 };
+    for (vDSP_Length N : lengths) {
+        vDSP_DFT_SetupD forward = vDSP_DFT_zrop_CreateSetupD(nullptr, N, vDSP_DFT_FORWARD);
+        vDSP_DFT_SetupD inverse = vDSP_DFT_zrop_CreateSetupD(forward, N, vDSP_DFT_INVERSE);
+        ASSERT_NE(nullptr, forward);
+        ASSERT_NE(nullptr, inverse);
+
+        std::vector<double> signal = _values<double>(N, 3);
+        std::vector<double> evens(N / 2), odds(N / 2), outR(N / 2), outI(N / 2);
+        for (size_t i = 0; i < N / 2; ++i) {
+            evens[i] = signal[2 * i];
+            odds[i] = signal[2 * i + 1];
+        }
+
+        std::vector<double> expectedR, expectedI;
+        _packedRealDFT(signal, expectedR, expectedI);
+        vDSP_DFT_ExecuteD(forward, evens.data(), odds.data(), outR.data(), outI.data());
+        EXPECT_GT(_tolerance<double>(N), _error(outR.data(), outI.data(), expectedR, expectedI)) << N;
+
+        // In place, with the setup that shares the forward one's tables
+        _packedRealIDFT(outR.data(), outI.data(), N, expectedR, expectedI);
+        vDSP_DFT_DestroySetupD(forward);
+        vDSP_DFT_ExecuteD(inverse, outR.data(), outI.data(), outR.data(), outI.data());
+        EXPECT_GT(_tolerance<double>(N), _error(outR.data(), outI.data(), expectedR, expectedI)) << N;
+        vDSP_DFT_DestroySetupD(inverse);
+    }
+}
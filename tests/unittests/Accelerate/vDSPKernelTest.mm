@@ -0,0 +1,340 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include "gtest-api.h"
+#import "Accelerate/Accelerate.h"
+#include "vDSPInternal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Every kernel set the processor can run is checked against the scalar expressions from vDSP.cpp. Element-wise results
+// must match bit for bit (any NaN matching any NaN, since NEON does not keep payloads); sums, which the kernels add up
+// in a different order, must be within the usual N * epsilon bound.
+
+namespace {
+
+const vDSP_Length c_lengths[] = { 0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 31, 33, 100, 1003 };
+const vDSP_Stride c_strides[] = { 1, 2, 3, -2 };
+
+template <typename T>
+const vDSPKernelSet<T>& _set(const vDSPKernels& kernels);
+
+template <>
+const vDSPKernelSet<float>& _set(const vDSPKernels& kernels) {
+    return kernels.f;
+}
+
+template <>
+const vDSPKernelSet<double>& _set(const vDSPKernels& kernels) {
+    return kernels.d;
+}
+
+// Values in [-1000, 1000], with whole numbers, halves, signed zeros, infinities and NaN mixed in.
+template <typename T>
+std::vector<T> _values(size_t count, unsigned int seed) {
+    const T specials[] = { 0, -static_cast<T>(0), 1, -1, static_cast<T>(0.5), static_cast<T>(-2.5), 1000,
+                           std::numeric_limits<T>::infinity(), -std::numeric_limits<T>::infinity(), std::numeric_limits<T>::quiet_NaN() };
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<T> distribution(-1000, 1000);
+    std::vector<T> values(count);
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = (generator() % 8 == 0) ? specials[generator() % (sizeof(specials) / sizeof(specials[0]))] : distribution(generator);
+    }
+    return values;
+}
+
+// Finite values only, for the reductions.
+template <typename T>
+std::vector<T> _finiteValues(size_t count, unsigned int seed) {
+    std::vector<T> values = _values<T>(count, seed);
+    for (T& value : values) {
+        if (!std::isfinite(value)) {
+            value = 3;
+        }
+    }
+    return values;
+}
+
+template <typename T>
+bool _same(T a, T b) {
+    return (std::isnan(a) && std::isnan(b)) || memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+// Strided input: count elements at the given stride, starting from the end of the buffer for negative strides.
+template <typename T>
+struct _Strided {
+    std::vector<T> buffer;
+    const T* base;
+
+    _Strided(vDSP_Length count, vDSP_Stride stride, unsigned int seed) {
+        vDSP_Length span = count * std::abs(stride) + 1;
+        buffer = _values<T>(span, seed);
+        base = buffer.data() + ((stride < 0) ? span - 1 : 0);
+    }
+};
+
+template <typename T>
+using _UnaryKernel = std::function<vDSP_Length(const vDSPKernelSet<T>&, const T*, vDSP_Stride, T*, vDSP_Length)>;
+
+template <typename T>
+using _BinaryKernel = std::function<vDSP_Length(const vDSPKernelSet<T>&, const T*, vDSP_Stride, const T*, vDSP_Stride, T*, vDSP_Length)>;
+
+template <typename T>
+void _checkUnary(const char* name, _UnaryKernel<T> kernel, std::function<T(T)> reference) {
+    const T c_untouched = 12345;
+    for (const vDSPKernels* kernels : vDSPGetAvailableKernels()) {
+        for (vDSP_Length N : c_lengths) {
+            for (vDSP_Stride IA : c_strides) {
+                _Strided<T> A(N, IA, static_cast<unsigned int>(N + IA));
+                std::vector<T> C(N, c_untouched);
+                vDSP_Length done = kernel(_set<T>(*kernels), A.base, IA, C.data(), N);
+                ASSERT_LE(done, N) << name << " (" << kernels->name << ")";
+
+                for (vDSP_Length i = 0; i < N; ++i) {
+                    T expected = (i < done) ? reference(A.base[i * IA]) : c_untouched;
+                    ASSERT_TRUE(_same(expected, C[i])) << name << " (" << kernels->name << "), N = " << N << ", IA = " << IA
+                                                       << ", element " << i << ": expected " << expected << ", got " << C[i];
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void _checkBinary(const char* name, _BinaryKernel<T> kernel, std::function<T(T, T)> reference, bool sameStrides = false) {
+    const T c_untouched = 12345;
+    for (const vDSPKernels* kernels : vDSPGetAvailableKernels()) {
+        for (vDSP_Length N : c_lengths) {
+            for (vDSP_Stride IA : c_strides) {
+                vDSP_Stride IB = sameStrides ? IA : (IA == 1 ? 3 : 1);
+                _Strided<T> A(N, IA, static_cast<unsigned int>(N + IA));
+                _Strided<T> B(N, IB, static_cast<unsigned int>(N + IB + 100));
+                std::vector<T> C(N, c_untouched);
+                vDSP_Length done = kernel(_set<T>(*kernels), A.base, IA, B.base, IB, C.data(), N);
+                ASSERT_LE(done, N) << name << " (" << kernels->name << ")";
+
+                for (vDSP_Length i = 0; i < N; ++i) {
+                    T expected = (i < done) ? reference(A.base[i * IA], B.base[i * IB]) : c_untouched;
+                    ASSERT_TRUE(_same(expected, C[i])) << name << " (" << kernels->name << "), N = " << N << ", IA = " << IA
+                                                       << ", IB = " << IB << ", element " << i << ": expected " << expected
+                                                       << ", got " << C[i];
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void _checkElementwise() {
+    const T b = static_cast<T>(-120.5);
+    const T c = static_cast<T>(310.25);
+
+    _checkUnary<T>("vabs", [](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, T* C, vDSP_Length N) { return k.vabs(A, IA, C, N); },
+                   [](T a) { return std::fabs(a); });
+    _checkUnary<T>("vnabs", [](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, T* C, vDSP_Length N) { return k.vnabs(A, IA, C, N); },
+                   [](T a) { return -std::fabs(a); });
+    _checkUnary<T>("vneg", [](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, T* C, vDSP_Length N) { return k.vneg(A, IA, C, N); },
+                   [](T a) { return -a; });
+    _checkUnary<T>("vsq", [](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, T* C, vDSP_Length N) { return k.vsq(A, IA, C, N); },
+                   [](T a) { return a * a; });
+    _checkUnary<T>("vssq", [](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, T* C, vDSP_Length N) { return k.vssq(A, IA, C, N); },
+                   [](T a) { return a * std::fabs(a); });
+    _checkUnary<T>("vfrac", [](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, T* C, vDSP_Length N) { return k.vfrac(A, IA, C, N); },
+                   [](T a) { return a - std::trunc(a); });
+    _checkUnary<T>("vsadd",
+                   [b](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, T* C, vDSP_Length N) { return k.vsadd(A, IA, b, C, N); },
+                   [b](T a) { return a + b; });
+    _checkUnary<T>("vsmul",
+                   [b](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, T* C, vDSP_Length N) { return k.vsmul(A, IA, b, C, N); },
+                   [b](T a) { return a * b; });
+    _checkUnary<T>("vthr",
+                   [b](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, T* C, vDSP_Length N) { return k.vthr(A, IA, b, C, N); },
+                   [b](T a) { return (a >= b) ? a : b; });
+    _checkUnary<T>("vthres",
+                   [b](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, T* C, vDSP_Length N) { return k.vthres(A, IA, b, C, N); },
+                   [b](T a) { return (a >= b) ? a : 0; });
+    _checkUnary<T>("vclip",
+                   [b, c](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, T* D, vDSP_Length N) { return k.vclip(A, IA, b, c, D, N); },
+                   [b, c](T a) { return (a < b) ? b : ((a > c) ? c : a); });
+    _checkUnary<T>("vlim",
+                   [b, c](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, T* D, vDSP_Length N) { return k.vlim(A, IA, b, c, D, N); },
+                   [b, c](T a) { return (a >= b) ? c : -c; });
+    _checkUnary<T>("vfill", [c](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, T* C, vDSP_Length N) { return k.vfill(c, C, N); },
+                   [c](T a) { return c; });
+
+    _checkBinary<T>("vadd",
+                    [](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, const T* B, vDSP_Stride IB, T* C, vDSP_Length N) {
+                        return k.vadd(A, IA, B, IB, C, N);
+                    },
+                    [](T a, T b) { return a + b; });
+    _checkBinary<T>("vmul",
+                    [](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, const T* B, vDSP_Stride IB, T* C, vDSP_Length N) {
+                        return k.vmul(A, IA, B, IB, C, N);
+                    },
+                    [](T a, T b) { return a * b; });
+    _checkBinary<T>("vasm",
+                    [c](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, const T* B, vDSP_Stride IB, T* D, vDSP_Length N) {
+                        return k.vasm(A, IA, B, IB, c, D, N);
+                    },
+                    [c](T a, T b) { return (a + b) * c; });
+
+    // Written out as two statements so that the reference cannot be contracted into a fused multiply-add.
+    _checkBinary<T>("zvmags",
+                    [](const vDSPKernelSet<T>& k, const T* A, vDSP_Stride IA, const T* B, vDSP_Stride IB, T* C, vDSP_Length N) {
+                        return k.zvmags(A, B, IA, C, N);
+                    },
+                    [](T real, T imag) {
+                        volatile T realSquared = real * real;
+                        return realSquared + imag * imag;
+                    },
+                    true);
+}
+
+template <typename T>
+void _checkReductions() {
+    for (const vDSPKernels* kernels : vDSPGetAvailableKernels()) {
+        const vDSPKernelSet<T>& set = _set<T>(*kernels);
+        for (vDSP_Length N : c_lengths) {
+            for (vDSP_Stride IA : c_strides) {
+                std::vector<T> buffer = _finiteValues<T>(N * std::abs(IA) + 1, static_cast<unsigned int>(N * 7 + IA));
+                const T* A = buffer.data() + ((IA < 0) ? buffer.size() - 1 : 0);
+
+                T max = std::numeric_limits<T>::min();
+                T expectedMax = max;
+                T maxMagnitude = 0;
+                T expectedMaxMagnitude = 0;
+                T sum = 0;
+                long double expectedSum = 0;
+                const T scale = static_cast<T>(0.01);
+                vDSP_Length doneMax = set.maxv(A, IA, N, &max);
+                vDSP_Length doneMagnitude = set.maxmgv(A, IA, N, &maxMagnitude);
+                vDSP_Length doneSum = set.svesq(A, IA, scale, N, &sum);
+                ASSERT_LE(doneMax, N);
+                ASSERT_LE(doneMagnitude, N);
+                ASSERT_LE(doneSum, N);
+
+                for (vDSP_Length i = 0; i < N; ++i) {
+                    T a = A[i * IA];
+                    if (i < doneMax && expectedMax < a) {
+                        expectedMax = a;
+                    }
+                    if (i < doneMagnitude && std::fabs(a) > expectedMaxMagnitude) {
+                        expectedMaxMagnitude = std::fabs(a);
+                    }
+                    if (i < doneSum) {
+                        T t = a * scale;
+                        expectedSum += static_cast<long double>(t) * t;
+                    }
+                }
+
+                EXPECT_EQ(expectedMax, max) << "maxv (" << kernels->name << "), N = " << N << ", IA = " << IA;
+                EXPECT_EQ(expectedMaxMagnitude, maxMagnitude) << "maxmgv (" << kernels->name << "), N = " << N << ", IA = " << IA;
+                EXPECT_NEAR(static_cast<double>(expectedSum), sum, expectedSum * (N + 1) * std::numeric_limits<T>::epsilon())
+                    << "svesq (" << kernels->name << "), N = " << N << ", IA = " << IA;
+            }
+        }
+    }
+}
+
+} // namespace
+
+TEST(vDSPKernels, ScalarSetIsAlwaysAvailable) {
+    const std::vector<const vDSPKernels*>& available = vDSPGetAvailableKernels();
+    ASSERT_LE(1u, available.size());
+    EXPECT_STREQ("Scalar", available.back()->name);
+    EXPECT_EQ(available.front(), &vDSPGetKernels());
+}
+
+TEST(vDSPKernels, FloatElementwise) {
+    _checkElementwise<float>();
+}
+
+TEST(vDSPKernels, DoubleElementwise) {
+    _checkElementwise<double>();
+}
+
+TEST(vDSPKernels, FloatReductions) {
+    _checkReductions<float>();
+}
+
+TEST(vDSPKernels, DoubleReductions) {
+    _checkReductions<double>();
+}
+
+// The public functions, with strides on either side of the kernels' unit output stride.
+TEST(vDSPKernels, PublicFunctionsMatchScalarLoops) {
+    const vDSP_Length N = 1003;
+    const vDSP_Stride strides[] = { 1, 3 };
+    const float b = -120.5f;
+    const float c = 310.25f;
+
+    for (vDSP_Stride IA : strides) {
+        for (vDSP_Stride IC : strides) {
+            std::vector<float> A = _values<float>(N * IA, 1);
+            std::vector<float> B = _values<float>(N * IA, 2);
+            std::vector<float> C(N * IC);
+            DSPSplitComplex split = { A.data(), B.data() };
+
+            auto check = [&](const char* name, std::function<float(vDSP_Length)> expected) {
+                for (vDSP_Length i = 0; i < N; ++i) {
+                    ASSERT_TRUE(_same(expected(i), C[i * IC])) << name << ", IA = " << IA << ", IC = " << IC << ", element " << i;
+                }
+            };
+
+            vDSP_vabs(A.data(), IA, C.data(), IC, N);
+            check("vDSP_vabs", [&](vDSP_Length i) { return std::fabs(A[i * IA]); });
+            vDSP_vsmul(A.data(), IA, &b, C.data(), IC, N);
+            check("vDSP_vsmul", [&](vDSP_Length i) { return A[i * IA] * b; });
+            vDSP_vclip(A.data(), IA, &b, &c, C.data(), IC, N);
+            check("vDSP_vclip", [&](vDSP_Length i) { return (A[i * IA] < b) ? b : ((A[i * IA] > c) ? c : A[i * IA]); });
+            vDSP_vthrsc(A.data(), IA, &b, &c, C.data(), IC, N);
+            check("vDSP_vthrsc", [&](vDSP_Length i) { return (A[i * IA] >= b) ? c : -c; });
+            vDSP_vadd(A.data(), IA, B.data(), IA, C.data(), IC, N);
+            check("vDSP_vadd", [&](vDSP_Length i) { return A[i * IA] + B[i * IA]; });
+            vDSP_vasm(A.data(), IA, B.data(), IA, &c, C.data(), IC, N);
+            check("vDSP_vasm", [&](vDSP_Length i) { return (A[i * IA] + B[i * IA]) * c; });
+            vDSP_vfrac(A.data(), IA, C.data(), IC, N);
+            check("vDSP_vfrac", [&](vDSP_Length i) { return A[i * IA] - std::trunc(A[i * IA]); });
+            vDSP_zvmgsa(&split, IA, B.data(), IA, C.data(), IC, N);
+            check("vDSP_zvmgsa", [&](vDSP_Length i) {
+                volatile float realSquared = A[i * IA] * A[i * IA];
+                volatile float magnitude = realSquared + B[i * IA] * B[i * IA];
+                return magnitude + B[i * IA];
+            });
+            vDSP_vclr(C.data(), IC, N);
+            check("vDSP_vclr", [&](vDSP_Length i) { return 0.0f; });
+        }
+    }
+
+    std::vector<double> A = _finiteValues<double>(N, 3);
+    double max = 0;
+    vDSP_maxvD(A.data(), 1, &max, N);
+    EXPECT_EQ(*std::max_element(A.begin(), A.end()), max);
+
+    double rms = 0;
+    vDSP_rmsqvD(A.data(), 1, &rms, N);
+    double squares = 0;
+    for (double a : A) {
+        squares += a * a;
+    }
+    EXPECT_NEAR(sqrt(squares / N), rms, 1.0E-9 * rms);
+}
@@ -810,6 +810,7 @@ TEST(Accelerate, vDSP_DFT_RealToComplex_Float) {
     checkArraySingle(ImgOut1, DFT_exp_imag3, 8, "DFT_RtoC_Imag_S3");
 
     vDSP_DFT_DestroySetup(zrop_Setup);
+    vDSP_DFT_DestroySetup(zrop_Setup_New);
 }
 
 //Test for validating the single-precision complex-to-real IDFT for a vector
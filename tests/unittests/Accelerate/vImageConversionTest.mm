@@ -0,0 +1,506 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include "gtest-api.h"
+#import "Accelerate/Accelerate.h"
+#include "vDSPInternal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+// The conversion kernels are checked bit for bit against the plain loops, premultiplication against vImage's integer
+// formulas for every pair of a color and an alpha, and the half conversions against the nearest half found by search.
+
+namespace {
+
+// A buffer of width by height elements of T, rows padded by a few elements.
+template <typename T>
+struct Plane {
+    std::vector<uint8_t> bytes;
+    vImage_Buffer buffer;
+
+    Plane(vImagePixelCount width, vImagePixelCount height, size_t channels = 1, size_t padding = 5)
+        : bytes((width * channels + padding) * sizeof(T) * height + 1) {
+        buffer.data = bytes.data();
+        buffer.width = width;
+        buffer.height = height;
+        buffer.rowBytes = (width * channels + padding) * sizeof(T);
+    }
+
+    Plane(const Plane& other) : bytes(other.bytes), buffer(other.buffer) {
+        buffer.data = bytes.data();
+    }
+
+    T* row(vImagePixelCount y) {
+        return reinterpret_cast<T*>(bytes.data() + y * buffer.rowBytes);
+    }
+};
+
+template <typename T>
+Plane<T> _random(vImagePixelCount width, vImagePixelCount height, size_t channels, unsigned int seed) {
+    Plane<T> plane(width, height, channels);
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> distribution(0, 255);
+    for (uint8_t& byte : plane.bytes) {
+        byte = static_cast<uint8_t>(distribution(generator));
+    }
+    return plane;
+}
+
+uint8_t _premultiplied(unsigned int c, unsigned int a) {
+    return static_cast<uint8_t>((c * a + 127) / 255);
+}
+
+uint8_t _unpremultiplied(unsigned int c, unsigned int a) {
+    return (a == 0) ? 0 : static_cast<uint8_t>(std::min(255u, (c * 255 + a / 2) / a));
+}
+
+uint8_t _roundToByte(float a) {
+    const float clamped = (a > 0.0f) ? ((a < 255.0f) ? a : 255.0f) : 0.0f;
+    return static_cast<uint8_t>(clamped + 0.5f);
+}
+
+float _asFloat(uint32_t bits) {
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+uint32_t _bits(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+// The half nearest f, ties to the even one, found among all the finite halves rather than by manipulating bits.
+uint16_t _nearestHalf(float f) {
+    static std::vector<double> s_magnitudes;
+    if (s_magnitudes.empty()) {
+        for (int h = 0; h < 0x7c00; ++h) {
+            const int exponent = h >> 10;
+            const int mantissa = h & 0x3ff;
+            s_magnitudes.push_back(exponent == 0 ? std::ldexp(mantissa, -24) : std::ldexp(1024 + mantissa, exponent - 25));
+        }
+        // Infinity, as the next step up
+        s_magnitudes.push_back(65536);
+    }
+
+    const uint16_t sign = std::signbit(f) ? 0x8000 : 0;
+    const double magnitude = std::fabs(static_cast<double>(f));
+    if (std::isnan(f)) {
+        return 0x7e00 | sign;
+    }
+    // 65520 is halfway between the largest half and the next power of 2, which rounds to infinity.
+    if (magnitude >= 65520) {
+        return 0x7c00 | sign;
+    }
+
+    size_t above = std::lower_bound(s_magnitudes.begin(), s_magnitudes.end(), magnitude) - s_magnitudes.begin();
+    if (above == 0 || s_magnitudes[above] == magnitude) {
+        return static_cast<uint16_t>(above | sign);
+    }
+    const double down = magnitude - s_magnitudes[above - 1];
+    const double up = s_magnitudes[above] - magnitude;
+    const size_t nearest = (down < up || (down == up && (above - 1) % 2 == 0)) ? above - 1 : above;
+    return static_cast<uint16_t>(nearest | sign);
+}
+
+// Floats around every boundary the conversion to halves has: zero, the subnormal halves, the normal ones, overflow,
+// infinity and NaN, with a spread of random bit patterns.
+std::vector<float> _halfTestFloats() {
+    std::vector<float> floats;
+    for (int h = 0; h < 0x7c00; ++h) {
+        const float f = vImageHalfToFloat(static_cast<uint16_t>(h));
+        const uint32_t bits = _bits(f);
+        for (int delta : { -2, -1, 0, 1, 2 }) {
+            floats.push_back(_asFloat(bits + delta));
+        }
+        // Halfway to the next half, and either side of it
+        if (h + 1 < 0x7c00) {
+            const float next = vImageHalfToFloat(static_cast<uint16_t>(h + 1));
+            const float middle = static_cast<float>((static_cast<double>(f) + next) / 2);
+            floats.push_back(middle);
+            floats.push_back(std::nextafter(middle, 0.0f));
+            floats.push_back(std::nextafter(middle, 1e10f));
+        }
+    }
+    for (float f : { 65504.0f, 65519.0f, 65520.0f, 65535.0f, 1e10f, std::numeric_limits<float>::infinity(), 1e-10f, 1e-45f }) {
+        floats.push_back(f);
+    }
+    floats.push_back(_asFloat(0x7fc00000));
+    floats.push_back(_asFloat(0x7f800001));
+    floats.push_back(_asFloat(0x7fbfffff));
+
+    std::mt19937 generator(5);
+    for (int i = 0; i < 100000; ++i) {
+        floats.push_back(_asFloat(static_cast<uint32_t>(generator())));
+    }
+
+    const size_t positive = floats.size();
+    for (size_t i = 0; i < positive; ++i) {
+        floats.push_back(-floats[i]);
+    }
+    return floats;
+}
+
+template <typename T>
+bool _sameRows(Plane<T>& a, Plane<T>& b, size_t elements) {
+    for (vImagePixelCount y = 0; y < a.buffer.height; ++y) {
+        if (memcmp(a.row(y), b.row(y), elements * sizeof(T)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(vImageConversion, KernelsMatchLoops) {
+    const vDSP_Length lengths[] = { 0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 32, 33, 100 };
+    const uint8_t c_untouched = 0xa5;
+    const uint8_t fill[4] = { 11, 22, 33, 44 };
+    const uint8_t maps[][4] = { { 0, 1, 2, 3 }, { 3, 2, 1, 0 }, { 4, 0, 1, 2 }, { 2, 1, 0, 4 }, { 1, 1, 7, 0 } };
+
+    for (const vDSPKernels* kernels : vDSPGetAvailableKernels()) {
+        const vImageKernelSet& set = kernels->image;
+        for (vDSP_Length N : lengths) {
+            Plane<uint8_t> pixels = _random<uint8_t>(N, 1, 4, static_cast<unsigned int>(N));
+            const uint8_t* in = pixels.row(0);
+
+            for (const uint8_t* map : maps) {
+                std::vector<uint8_t> out(4 * N, c_untouched);
+                vDSP_Length done = set.shuffle32(in, out.data(), map, fill, N);
+                ASSERT_LE(done, N);
+                for (vDSP_Length i = 0; i < 4 * N; ++i) {
+                    const size_t k = i % 4;
+                    const uint8_t expected = (i >= 4 * done) ? c_untouched : (map[k] < 4 ? in[i - k + map[k]] : fill[k]);
+                    ASSERT_EQ(expected, out[i]) << "shuffle32 (" << kernels->name << "), N = " << N << ", byte " << i;
+                }
+
+                std::fill(out.begin(), out.end(), c_untouched);
+                done = set.expand24(in, out.data(), map, fill, N);
+                ASSERT_LE(done, N);
+                for (vDSP_Length i = 0; i < 4 * N; ++i) {
+                    const size_t k = i % 4;
+                    const uint8_t expected = (i >= 4 * done) ? c_untouched : (map[k] < 3 ? in[3 * (i / 4) + map[k]] : fill[k]);
+                    ASSERT_EQ(expected, out[i]) << "expand24 (" << kernels->name << "), N = " << N << ", byte " << i;
+                }
+
+                if (map[0] < 4 && map[1] < 4 && map[2] < 4) {
+                    std::fill(out.begin(), out.end(), c_untouched);
+                    done = set.pack32(in, out.data(), map, N);
+                    ASSERT_LE(done, N);
+                    for (vDSP_Length i = 0; i < 4 * N; ++i) {
+                        const uint8_t expected = (i >= 3 * done) ? c_untouched : in[4 * (i / 3) + map[i % 3]];
+                        ASSERT_EQ(expected, out[i]) << "pack32 (" << kernels->name << "), N = " << N << ", byte " << i;
+                    }
+                }
+            }
+
+            for (unsigned int alpha : { 0u, 3u }) {
+                std::vector<uint8_t> out(4 * N, c_untouched);
+                vDSP_Length done = set.premultiply32(in, out.data(), alpha, N);
+                ASSERT_LE(done, N);
+                for (vDSP_Length i = 0; i < 4 * N; ++i) {
+                    const uint8_t a = in[i - i % 4 + alpha];
+                    const uint8_t expected = (i >= 4 * done) ? c_untouched : (i % 4 == alpha ? a : _premultiplied(in[i], a));
+                    ASSERT_EQ(expected, out[i]) << "premultiply32 (" << kernels->name << "), N = " << N << ", byte " << i;
+                }
+
+                std::fill(out.begin(), out.end(), c_untouched);
+                done = set.unpremultiply32(in, out.data(), alpha, N);
+                ASSERT_LE(done, N);
+                for (vDSP_Length i = 0; i < 4 * N; ++i) {
+                    const uint8_t a = in[i - i % 4 + alpha];
+                    const uint8_t expected = (i >= 4 * done) ? c_untouched : (i % 4 == alpha ? a : _unpremultiplied(in[i], a));
+                    ASSERT_EQ(expected, out[i]) << "unpremultiply32 (" << kernels->name << "), N = " << N << ", byte " << i;
+                }
+            }
+
+            std::vector<std::vector<uint8_t>> planes(4, std::vector<uint8_t>(N, c_untouched));
+            uint8_t* const planeRows[4] = { planes[0].data(), planes[1].data(), planes[2].data(), planes[3].data() };
+            vDSP_Length done = set.deinterleave32(in, planeRows, N);
+            ASSERT_LE(done, N);
+            for (size_t k = 0; k < 4; ++k) {
+                for (vDSP_Length i = 0; i < N; ++i) {
+                    ASSERT_EQ(i < done ? in[4 * i + k] : c_untouched, planes[k][i])
+                        << "deinterleave32 (" << kernels->name << "), N = " << N << ", channel " << k << ", pixel " << i;
+                }
+            }
+
+            std::vector<uint8_t> interleaved(4 * N, c_untouched);
+            const uint8_t* const sources[4] = { in + 0 * N, in + 1 * N, in + 2 * N, in + 3 * N };
+            done = set.interleave32(sources, interleaved.data(), N);
+            ASSERT_LE(done, N);
+            for (vDSP_Length i = 0; i < 4 * N; ++i) {
+                ASSERT_EQ(i < 4 * done ? sources[i % 4][i / 4] : c_untouched, interleaved[i])
+                    << "interleave32 (" << kernels->name << "), N = " << N << ", byte " << i;
+            }
+
+            std::vector<uint16_t> halves(N, 0xa5a5);
+            done = set.bytesToHalves(in, halves.data(), N);
+            ASSERT_LE(done, N);
+            for (vDSP_Length i = 0; i < N; ++i) {
+                ASSERT_EQ(i < done ? vImageFloatToHalf(in[i] * (1.0f / 255.0f)) : 0xa5a5, halves[i])
+                    << "bytesToHalves (" << kernels->name << "), N = " << N << ", element " << i;
+            }
+
+            // Random halves, NaNs and infinities among them
+            const uint16_t* randomHalves = reinterpret_cast<const uint16_t*>(in);
+            std::vector<uint8_t> bytes(N, c_untouched);
+            done = set.halvesToBytes(randomHalves, bytes.data(), N);
+            ASSERT_LE(done, N);
+            for (vDSP_Length i = 0; i < N; ++i) {
+                ASSERT_EQ(i < done ? _roundToByte(vImageHalfToFloat(randomHalves[i]) * 255.0f) : c_untouched, bytes[i])
+                    << "halvesToBytes (" << kernels->name << "), N = " << N << ", element " << i;
+            }
+
+            std::vector<float> floats(N, 1234.5f);
+            done = set.halvesToFloats(randomHalves, floats.data(), N);
+            ASSERT_LE(done, N);
+            for (vDSP_Length i = 0; i < N; ++i) {
+                ASSERT_EQ(i < done ? _bits(vImageHalfToFloat(randomHalves[i])) : _bits(1234.5f), _bits(floats[i]))
+                    << "halvesToFloats (" << kernels->name << "), N = " << N << ", element " << i;
+            }
+        }
+    }
+}
+
+TEST(vImageConversion, HalvesMatchNearest) {
+    for (uint32_t h = 0; h < 0x10000; ++h) {
+        const float f = vImageHalfToFloat(static_cast<uint16_t>(h));
+        if ((h & 0x7c00) == 0x7c00 && (h & 0x3ff) != 0) {
+            ASSERT_TRUE(std::isnan(f)) << h;
+        } else {
+            ASSERT_EQ(h, _nearestHalf(f)) << h;
+        }
+    }
+
+    std::vector<float> floats = _halfTestFloats();
+    for (float f : floats) {
+        ASSERT_EQ(_nearestHalf(f), vImageFloatToHalf(f)) << f << " (" << std::hex << _bits(f) << ")";
+    }
+
+    std::vector<uint16_t> allHalves(0x10000);
+    for (uint32_t h = 0; h < 0x10000; ++h) {
+        allHalves[h] = static_cast<uint16_t>(h);
+    }
+    for (const vDSPKernels* kernels : vDSPGetAvailableKernels()) {
+        std::vector<uint16_t> halves(floats.size());
+        vDSP_Length done = kernels->image.floatsToHalves(floats.data(), halves.data(), floats.size());
+        for (vDSP_Length i = 0; i < done; ++i) {
+            ASSERT_EQ(vImageFloatToHalf(floats[i]), halves[i]) << kernels->name << ", " << floats[i] << " (" << std::hex << _bits(floats[i])
+                                                             << ")";
+        }
+
+        std::vector<float> widened(allHalves.size());
+        done = kernels->image.halvesToFloats(allHalves.data(), widened.data(), allHalves.size());
+        for (vDSP_Length i = 0; i < done; ++i) {
+            ASSERT_EQ(_bits(vImageHalfToFloat(allHalves[i])), _bits(widened[i])) << kernels->name << ", " << std::hex << allHalves[i];
+        }
+    }
+}
+
+TEST(vImageConversion, Premultiply) {
+    // Every color with every alpha, in both orders
+    Plane<uint8_t> all(256, 256, 4);
+    for (unsigned int a = 0; a < 256; ++a) {
+        for (unsigned int c = 0; c < 256; ++c) {
+            const uint8_t pixel[4] = {
+                static_cast<uint8_t>(c), static_cast<uint8_t>(255 - c), static_cast<uint8_t>(c), static_cast<uint8_t>(a)
+            };
+            memcpy(all.row(a) + 4 * c, pixel, sizeof(pixel));
+        }
+    }
+
+    for (vImage_Flags flags : { kvImageNoFlags, kvImageDoNotTile }) {
+        Plane<uint8_t> premultiplied(256, 256, 4);
+        ASSERT_EQ(kvImageNoError, vImagePremultiplyData_RGBA8888(&all.buffer, &premultiplied.buffer, flags));
+        Plane<uint8_t> unpremultiplied = premultiplied;
+        ASSERT_EQ(kvImageNoError, vImageUnpremultiplyData_RGBA8888(&unpremultiplied.buffer, &unpremultiplied.buffer, flags));
+        for (unsigned int a = 0; a < 256; ++a) {
+            for (unsigned int c = 0; c < 256; ++c) {
+                const uint8_t* pixel = premultiplied.row(a) + 4 * c;
+                ASSERT_EQ(_premultiplied(c, a), pixel[0]);
+                ASSERT_EQ(_premultiplied(255 - c, a), pixel[1]);
+                ASSERT_EQ(a, pixel[3]);
+                const uint8_t* restored = unpremultiplied.row(a) + 4 * c;
+                ASSERT_EQ(_unpremultiplied(pixel[0], a), restored[0]);
+                ASSERT_EQ(_unpremultiplied(pixel[1], a), restored[1]);
+                ASSERT_EQ(a, restored[3]);
+            }
+        }
+
+        // Straight colors with a full alpha come back as they were
+        Plane<uint8_t> argb(256, 256, 4);
+        for (unsigned int y = 0; y < 256; ++y) {
+            for (unsigned int x = 0; x < 256; ++x) {
+                const uint8_t pixel[4] = { static_cast<uint8_t>(y), static_cast<uint8_t>(x), static_cast<uint8_t>(x ^ y), 255 };
+                memcpy(argb.row(y) + 4 * x, pixel, sizeof(pixel));
+            }
+        }
+        Plane<uint8_t> unpremultipliedARGB(256, 256, 4);
+        ASSERT_EQ(kvImageNoError, vImageUnpremultiplyData_ARGB8888(&all.buffer, &unpremultipliedARGB.buffer, flags));
+        ASSERT_EQ(kvImageNoError, vImagePremultiplyData_ARGB8888(&unpremultipliedARGB.buffer, &unpremultipliedARGB.buffer, flags));
+        for (unsigned int a = 0; a < 256; ++a) {
+            for (unsigned int c = 0; c < 256; ++c) {
+                const uint8_t* pixel = all.row(a) + 4 * c;
+                const uint8_t* result = unpremultipliedARGB.row(a) + 4 * c;
+                ASSERT_EQ(pixel[0], result[0]);
+                for (int k = 1; k < 4; ++k) {
+                    ASSERT_EQ(_premultiplied(_unpremultiplied(pixel[k], pixel[0]), pixel[0]), result[k]);
+                }
+            }
+        }
+    }
+}
+
+TEST(vImageConversion, PlanarRoundTrips) {
+    Plane<uint8_t> argb = _random<uint8_t>(101, 37, 4, 1);
+    std::vector<Plane<uint8_t>> planes(4, Plane<uint8_t>(101, 37));
+    ASSERT_EQ(kvImageNoError,
+              vImageConvert_ARGB8888toPlanar8(
+                  &argb.buffer, &planes[0].buffer, &planes[1].buffer, &planes[2].buffer, &planes[3].buffer, kvImageNoFlags));
+    for (vImagePixelCount y = 0; y < 37; ++y) {
+        for (vImagePixelCount x = 0; x < 101; ++x) {
+            for (size_t k = 0; k < 4; ++k) {
+                ASSERT_EQ(argb.row(y)[4 * x + k], planes[k].row(y)[x]);
+            }
+        }
+    }
+
+    Plane<uint8_t> back(101, 37, 4);
+    ASSERT_EQ(kvImageNoError,
+              vImageConvert_Planar8toARGB8888(
+                  &planes[0].buffer, &planes[1].buffer, &planes[2].buffer, &planes[3].buffer, &back.buffer, kvImageDoNotTile));
+    EXPECT_TRUE(_sameRows(argb, back, 4 * 101));
+
+    Plane<uint8_t> small(100, 37, 4);
+    EXPECT_EQ(kvImageBufferSizeMismatch,
+              vImageConvert_Planar8toARGB8888(
+                  &planes[0].buffer, &planes[1].buffer, &planes[2].buffer, &planes[3].buffer, &small.buffer, kvImageNoFlags));
+    EXPECT_EQ(kvImageNullPointerArgument,
+              vImageConvert_ARGB8888toPlanar8(
+                  &argb.buffer, &planes[0].buffer, nullptr, &planes[2].buffer, &planes[3].buffer, kvImageNoFlags));
+}
+
+TEST(vImageConversion, RGB888) {
+    Plane<uint8_t> rgb = _random<uint8_t>(67, 23, 3, 2);
+    Plane<uint8_t> alphas = _random<uint8_t>(67, 23, 1, 3);
+    typedef vImage_Error (*FromRGB)(const vImage_Buffer*, const vImage_Buffer*, Pixel_8, const vImage_Buffer*, bool, vImage_Flags);
+    typedef vImage_Error (*ToRGB)(const vImage_Buffer*, const vImage_Buffer*, vImage_Flags);
+    const FromRGB froms[] = { vImageConvert_RGB888toARGB8888, vImageConvert_RGB888toRGBA8888, vImageConvert_RGB888toBGRA8888 };
+    const ToRGB tos[] = { vImageConvert_ARGB8888toRGB888, vImageConvert_RGBA8888toRGB888, vImageConvert_BGRA8888toRGB888 };
+    // Where each format keeps red, green, blue and alpha
+    const size_t places[][4] = { { 1, 2, 3, 0 }, { 0, 1, 2, 3 }, { 2, 1, 0, 3 } };
+
+    for (size_t format = 0; format < 3; ++format) {
+        for (bool planarAlpha : { false, true }) {
+            for (bool premultiply : { false, true }) {
+                Plane<uint8_t> four(67, 23, 4);
+                const vImage_Buffer* aSrc = planarAlpha ? &alphas.buffer : nullptr;
+                ASSERT_EQ(kvImageNoError, froms[format](&rgb.buffer, aSrc, 200, &four.buffer, premultiply, kvImageNoFlags));
+                for (vImagePixelCount y = 0; y < 23; ++y) {
+                    for (vImagePixelCount x = 0; x < 67; ++x) {
+                        const uint8_t* pixel = four.row(y) + 4 * x;
+                        const uint8_t a = planarAlpha ? alphas.row(y)[x] : 200;
+                        ASSERT_EQ(a, pixel[places[format][3]]);
+                        for (size_t k = 0; k < 3; ++k) {
+                            const uint8_t c = rgb.row(y)[3 * x + k];
+                            ASSERT_EQ(premultiply ? _premultiplied(c, a) : c, pixel[places[format][k]]) << format << " " << x << " " << y;
+                        }
+                    }
+                }
+
+                if (!premultiply) {
+                    // In place, into the first three quarters of each row
+                    ASSERT_EQ(kvImageNoError, tos[format](&four.buffer, &four.buffer, kvImageNoFlags));
+                    for (vImagePixelCount y = 0; y < 23; ++y) {
+                        ASSERT_EQ(0, memcmp(rgb.row(y), four.row(y), 3 * 67)) << format << " " << y;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(vImageConversion, PermuteChannels) {
+    Plane<uint8_t> src = _random<uint8_t>(53, 19, 4, 4);
+    const uint8_t maps[][4] = { { 3, 2, 1, 0 }, { 0, 0, 0, 0 }, { 1, 2, 3, 0 }, { 0, 1, 2, 3 } };
+    for (const uint8_t* map : maps) {
+        Plane<uint8_t> dest(53, 19, 4);
+        ASSERT_EQ(kvImageNoError, vImagePermuteChannels_ARGB8888(&src.buffer, &dest.buffer, map, kvImageNoFlags));
+        Plane<uint8_t> inPlace = src;
+        ASSERT_EQ(kvImageNoError, vImagePermuteChannels_ARGB8888(&inPlace.buffer, &inPlace.buffer, map, kvImageDoNotTile));
+        for (vImagePixelCount y = 0; y < 19; ++y) {
+            for (vImagePixelCount x = 0; x < 53; ++x) {
+                for (size_t k = 0; k < 4; ++k) {
+                    ASSERT_EQ(src.row(y)[4 * x + map[k]], dest.row(y)[4 * x + k]);
+                }
+            }
+        }
+        EXPECT_TRUE(_sameRows(dest, inPlace, 4 * 53));
+    }
+
+    const uint8_t invalid[4] = { 0, 1, 2, 4 };
+    EXPECT_EQ(kvImageInvalidParameter, vImagePermuteChannels_ARGB8888(&src.buffer, &src.buffer, invalid, kvImageNoFlags));
+}
+
+TEST(vImageConversion, Planar16F) {
+    // Every byte survives the trip through halves
+    Plane<uint8_t> bytes(256, 3);
+    for (vImagePixelCount y = 0; y < 3; ++y) {
+        for (unsigned int x = 0; x < 256; ++x) {
+            bytes.row(y)[x] = static_cast<uint8_t>(x + y);
+        }
+    }
+    Plane<uint16_t> halves(256, 3);
+    Plane<uint8_t> back(256, 3);
+    ASSERT_EQ(kvImageNoError, vImageConvert_Planar8toPlanar16F(&bytes.buffer, &halves.buffer, kvImageNoFlags));
+    ASSERT_EQ(kvImageNoError, vImageConvert_Planar16FtoPlanar8(&halves.buffer, &back.buffer, kvImageNoFlags));
+    EXPECT_TRUE(_sameRows(bytes, back, 256));
+    EXPECT_EQ(0x3c00, halves.row(0)[255]);
+    EXPECT_EQ(0, halves.row(0)[0]);
+
+    // Every half to float and back, NaNs quieted
+    Plane<uint16_t> allHalves(0x1000, 16);
+    for (uint32_t h = 0; h < 0x10000; ++h) {
+        allHalves.row(h >> 12)[h & 0xfff] = static_cast<uint16_t>(h);
+    }
+    Plane<float> floats(0x1000, 16);
+    Plane<uint16_t> rounded(0x1000, 16);
+    ASSERT_EQ(kvImageNoError, vImageConvert_Planar16FtoPlanarF(&allHalves.buffer, &floats.buffer, kvImageNoFlags));
+    ASSERT_EQ(kvImageNoError, vImageConvert_PlanarFtoPlanar16F(&floats.buffer, &rounded.buffer, kvImageNoFlags));
+    for (uint32_t h = 0; h < 0x10000; ++h) {
+        const bool isNaN = (h & 0x7c00) == 0x7c00 && (h & 0x3ff) != 0;
+        ASSERT_EQ(isNaN ? ((h & 0x8000) | 0x7e00) : h, rounded.row(h >> 12)[h & 0xfff]) << std::hex << h;
+    }
+
+    // Out of range and NaN clamp
+    Plane<uint16_t> extremes(4, 1);
+    const uint16_t values[] = { 0xbc00, 0x4000, 0x7c00, 0x7e00 };
+    memcpy(extremes.row(0), values, sizeof(values));
+    Plane<uint8_t> clamped(4, 1);
+    ASSERT_EQ(kvImageNoError, vImageConvert_Planar16FtoPlanar8(&extremes.buffer, &clamped.buffer, kvImageNoFlags));
+    EXPECT_EQ(0, clamped.row(0)[0]);
+    EXPECT_EQ(255, clamped.row(0)[1]);
+    EXPECT_EQ(255, clamped.row(0)[2]);
+    EXPECT_EQ(0, clamped.row(0)[3]);
+}
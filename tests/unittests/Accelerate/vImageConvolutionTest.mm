@@ -0,0 +1,482 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include "gtest-api.h"
+#import "Accelerate/Accelerate.h"
+#include "vDSPInternal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// The convolutions are checked against a direct sum over every tap of the kernel, in doubles, for box, tent, separable
+// and other kernels in each edge mode, and the kernels they use against the plain loops.
+
+namespace {
+
+// A buffer of width by height pixels of channels bytes, rows padded by a few bytes.
+struct Image {
+    std::vector<uint8_t> bytes;
+    vImage_Buffer buffer;
+    size_t channels;
+
+    Image(vImagePixelCount width, vImagePixelCount height, size_t channels)
+        : bytes((width * channels + 5) * height + 1), channels(channels) {
+        buffer.data = bytes.data();
+        buffer.width = width;
+        buffer.height = height;
+        buffer.rowBytes = width * channels + 5;
+    }
+
+    Image(const Image& other) : bytes(other.bytes), buffer(other.buffer), channels(other.channels) {
+        buffer.data = bytes.data();
+    }
+
+    uint8_t* pixel(vImagePixelCount x, vImagePixelCount y) {
+        return bytes.data() + y * buffer.rowBytes + x * channels;
+    }
+
+    bool rowsEqual(Image& other) {
+        for (vImagePixelCount y = 0; y < buffer.height; ++y) {
+            if (memcmp(pixel(0, y), other.pixel(0, y), buffer.width * channels) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+Image _random(vImagePixelCount width, vImagePixelCount height, size_t channels, unsigned int seed) {
+    Image image(width, height, channels);
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> distribution(0, 255);
+    for (uint8_t& byte : image.bytes) {
+        byte = static_cast<uint8_t>(distribution(generator));
+    }
+    return image;
+}
+
+enum Filter { Box, Tent, Kernel };
+
+// The taps of a box or tent filter, the tent's the product of triangles rising to (size + 1) / 2 in the middle.
+std::vector<int16_t> _taps(Filter filter, uint32_t height, uint32_t width) {
+    std::vector<int16_t> taps(height * width);
+    for (uint32_t j = 0; j < height; ++j) {
+        for (uint32_t i = 0; i < width; ++i) {
+            const int down = static_cast<int>((height + 1) / 2) - std::abs(static_cast<int>(j) - static_cast<int>(height / 2));
+            const int across = static_cast<int>((width + 1) / 2) - std::abs(static_cast<int>(i) - static_cast<int>(width / 2));
+            taps[j * width + i] = static_cast<int16_t>(filter == Tent ? down * across : 1);
+        }
+    }
+    return taps;
+}
+
+// The convolution of src at (offsetX, offsetY) with kernel, summed directly over every tap.
+void _convolve(Image& src,
+               Image& dest,
+               vImagePixelCount offsetX,
+               vImagePixelCount offsetY,
+               const std::vector<int16_t>& kernel,
+               uint32_t height,
+               uint32_t width,
+               double divisor,
+               const uint8_t* background,
+               vImage_Flags flags) {
+    const ptrdiff_t srcWidth = static_cast<ptrdiff_t>(src.buffer.width);
+    const ptrdiff_t srcHeight = static_cast<ptrdiff_t>(src.buffer.height);
+    const ptrdiff_t top = height / 2;
+    const ptrdiff_t left = width / 2;
+    double weight = 0;
+    for (int16_t tap : kernel) {
+        weight += tap;
+    }
+
+    for (vImagePixelCount y = 0; y < dest.buffer.height; ++y) {
+        for (vImagePixelCount x = 0; x < dest.buffer.width; ++x) {
+            const ptrdiff_t sx = static_cast<ptrdiff_t>(offsetX + x);
+            const ptrdiff_t sy = static_cast<ptrdiff_t>(offsetY + y);
+            const bool fits = sx >= left && sx + left < srcWidth && sy >= top && sy + top < srcHeight;
+            for (size_t c = 0; c < src.channels; ++c) {
+                uint8_t& out = dest.pixel(x, y)[c];
+                if ((flags & kvImageCopyInPlace) && !fits) {
+                    out = src.pixel(sx, sy)[c];
+                    continue;
+                }
+
+                double sum = 0;
+                double inside = 0;
+                for (ptrdiff_t j = -top; j <= top; ++j) {
+                    for (ptrdiff_t i = -left; i <= left; ++i) {
+                        const double tap = kernel[(j + top) * width + (i + left)];
+                        ptrdiff_t u = sx + i;
+                        ptrdiff_t v = sy + j;
+                        double value;
+                        if (u >= 0 && u < srcWidth && v >= 0 && v < srcHeight) {
+                            value = src.pixel(u, v)[c];
+                            inside += tap;
+                        } else if (flags & (kvImageCopyInPlace | kvImageEdgeExtend)) {
+                            u = std::min(std::max<ptrdiff_t>(u, 0), srcWidth - 1);
+                            v = std::min(std::max<ptrdiff_t>(v, 0), srcHeight - 1);
+                            value = src.pixel(u, v)[c];
+                        } else if (flags & kvImageTruncateKernel) {
+                            value = 0;
+                        } else {
+                            value = background[c];
+                        }
+                        sum += tap * value;
+                    }
+                }
+
+                double scaled = divisor;
+                if ((flags & kvImageTruncateKernel) && !(flags & kvImageCopyInPlace) && inside != 0 && weight != 0) {
+                    scaled = divisor * inside / weight;
+                }
+                const double quotient = std::floor((sum + scaled / 2) / scaled);
+                out = static_cast<uint8_t>(std::min(std::max(quotient, 0.0), 255.0));
+            }
+            if (src.channels == 4 && (flags & kvImageLeaveAlphaUnchanged)) {
+                dest.pixel(x, y)[0] = src.pixel(sx, sy)[0];
+            }
+        }
+    }
+}
+
+struct Case {
+    Filter filter;
+    uint32_t height;
+    uint32_t width;
+    std::vector<int16_t> kernel;
+    int32_t divisor;
+    const char* name;
+};
+
+vImage_Error _run(const Case& c,
+                  Image& src,
+                  Image& dest,
+                  void* temp,
+                  vImagePixelCount offsetX,
+                  vImagePixelCount offsetY,
+                  const uint8_t* background,
+                  vImage_Flags flags) {
+    const vImage_Buffer* in = &src.buffer;
+    const vImage_Buffer* out = &dest.buffer;
+    const uint32_t height = c.height;
+    const uint32_t width = c.width;
+    const int16_t* kernel = c.kernel.data();
+    if (src.channels == 4) {
+        switch (c.filter) {
+            case Box:
+                return vImageBoxConvolve_ARGB8888(in, out, temp, offsetX, offsetY, height, width, background, flags);
+            case Tent:
+                return vImageTentConvolve_ARGB8888(in, out, temp, offsetX, offsetY, height, width, background, flags);
+            default:
+                return vImageConvolve_ARGB8888(in, out, temp, offsetX, offsetY, kernel, height, width, c.divisor, background, flags);
+        }
+    }
+    switch (c.filter) {
+        case Box:
+            return vImageBoxConvolve_Planar8(in, out, temp, offsetX, offsetY, height, width, background[0], flags);
+        case Tent:
+            return vImageTentConvolve_Planar8(in, out, temp, offsetX, offsetY, height, width, background[0], flags);
+        default:
+            return vImageConvolve_Planar8(in, out, temp, offsetX, offsetY, kernel, height, width, c.divisor, background[0], flags);
+    }
+}
+
+std::vector<Case> _cases() {
+    std::vector<Case> cases;
+    for (uint32_t size : { 1u, 3u, 5u, 9u }) {
+        cases.push_back({ Box, size, size, {}, 0, "box" });
+        cases.push_back({ Tent, size, size, {}, 0, "tent" });
+    }
+    cases.push_back({ Box, 3, 7, {}, 0, "box" });
+    cases.push_back({ Box, 11, 1, {}, 0, "box" });
+    cases.push_back({ Tent, 7, 3, {}, 0, "tent" });
+    cases.push_back({ Tent, 1, 11, {}, 0, "tent" });
+    // Larger than the images, and with more than floats hold
+    cases.push_back({ Box, 41, 29, {}, 0, "box" });
+    cases.push_back({ Box, 131, 131, {}, 0, "box" });
+    cases.push_back({ Tent, 35, 45, {}, 0, "tent" });
+
+    // Separable: a binomial Gaussian, and one with negative weights
+    cases.push_back({ Kernel, 5, 3, { 1, 2, 1, 4, 8, 4, 6, 12, 6, 4, 8, 4, 1, 2, 1 }, 64, "gaussian" });
+    cases.push_back({ Kernel, 3, 3, { -1, 2, -1, -2, 4, -2, -1, 2, -1 }, 1, "separable" });
+    cases.push_back({ Kernel, 1, 5, { 3, -6, 9, 0, 12 }, 7, "separable" });
+    // Not separable: a sharpening filter, an edge detector with divisor 0, and random taps
+    cases.push_back({ Kernel, 3, 3, { 0, -1, 0, -1, 5, -1, 0, -1, 0 }, 1, "sharpen" });
+    cases.push_back({ Kernel, 3, 3, { -1, -1, -1, -1, 8, -1, -1, -1, -1 }, 0, "edges" });
+    std::mt19937 generator(12);
+    std::uniform_int_distribution<int> taps(-20, 40);
+    std::vector<int16_t> random(5 * 7);
+    for (int16_t& tap : random) {
+        tap = static_cast<int16_t>(taps(generator));
+    }
+    cases.push_back({ Kernel, 5, 7, random, 300, "random" });
+    cases.push_back({ Kernel, 5, 7, random, -300, "negative divisor" });
+    // Sums too large for floats, separable and not
+    cases.push_back({ Kernel, 3, 1, { 20000, 30000, 20000 }, 70000, "large" });
+    cases.push_back({ Kernel, 3, 3, { 9000, 32000, 9000, 32000, -32000, 32000, 9000, 32000, 9000 }, 112000, "large" });
+    return cases;
+}
+
+const vImage_Flags c_edges[] = { kvImageEdgeExtend, kvImageBackgroundColorFill, kvImageTruncateKernel, kvImageCopyInPlace };
+
+} // namespace
+
+TEST(vImageConvolution, KernelsMatchLoops) {
+    const vDSP_Length lengths[] = { 0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 32, 33, 100 };
+    const float c_untouched = 1234.5f;
+
+    for (const vDSPKernels* kernels : vDSPGetAvailableKernels()) {
+        const vImageKernelSet& set = kernels->image;
+        for (vDSP_Length N : lengths) {
+            const size_t c_taps = 5;
+            const size_t c_stride = 4;
+            Image bytes = _random(N + c_taps * c_stride, c_taps, 1, static_cast<unsigned int>(N));
+            const uint8_t* rows[c_taps];
+            std::vector<float> floats[c_taps];
+            for (size_t k = 0; k < c_taps; ++k) {
+                rows[k] = bytes.pixel(0, k);
+                floats[k].assign(rows[k], rows[k] + N + c_taps * c_stride);
+            }
+            const float weights[c_taps * c_taps] = { 1, -2, 3, 0, 5, 6, 7, -8, 9, 10, 11, 12, 13, 14, 15,
+                                                     -16, 17, 18, 19, 20, 21, 22, 23, 24, 25 };
+
+            std::vector<float> out(N, c_untouched);
+            vDSP_Length done = set.slideRows(floats[0].data(), rows[1], rows[2], out.data(), N);
+            ASSERT_LE(done, N);
+            for (vDSP_Length i = 0; i < N; ++i) {
+                ASSERT_EQ(i < done ? floats[0][i] + rows[1][i] - rows[2][i] : c_untouched, out[i])
+                    << "slideRows (" << kernels->name << "), N = " << N << ", element " << i;
+            }
+
+            // In place, as the last pass of a box filter runs
+            out.assign(floats[0].begin(), floats[0].begin() + N);
+            done = set.slideLines(out.data(), floats[3].data(), floats[4].data(), out.data(), N);
+            ASSERT_LE(done, N);
+            for (vDSP_Length i = 0; i < N; ++i) {
+                ASSERT_EQ(i < done ? floats[0][i] + floats[3][i] - floats[4][i] : floats[0][i], out[i])
+                    << "slideLines (" << kernels->name << "), N = " << N << ", element " << i;
+            }
+
+            out.assign(N, c_untouched);
+            done = set.filterLine(floats[1].data(), weights, c_taps, c_stride, out.data(), N);
+            ASSERT_LE(done, N);
+            for (vDSP_Length i = 0; i < N; ++i) {
+                float sum = 0;
+                for (size_t k = 0; k < c_taps; ++k) {
+                    sum += weights[k] * floats[1][i + k * c_stride];
+                }
+                ASSERT_EQ(i < done ? sum : c_untouched, out[i]) << "filterLine (" << kernels->name << "), N = " << N << ", element " << i;
+            }
+
+            out.assign(N, c_untouched);
+            done = set.filterRows(rows, weights, c_taps, c_taps, c_stride, out.data(), N);
+            ASSERT_LE(done, N);
+            for (vDSP_Length i = 0; i < N; ++i) {
+                float sum = 0;
+                for (size_t j = 0; j < c_taps; ++j) {
+                    for (size_t k = 0; k < c_taps; ++k) {
+                        sum += weights[j * c_taps + k] * rows[j][i + k * c_stride];
+                    }
+                }
+                ASSERT_EQ(i < done ? sum : c_untouched, out[i]) << "filterRows (" << kernels->name << "), N = " << N << ", element " << i;
+            }
+
+            // Sums and divisors of either sign, with exact halves among the quotients
+            std::vector<float> sums(N);
+            std::vector<float> divisors(N);
+            for (vDSP_Length i = 0; i < N; ++i) {
+                sums[i] = floats[2][i] * 37 - 2000;
+                divisors[i] = (i % 3 == 0) ? 10.0f : (i % 3 == 1) ? 37.0f : -7.0f;
+            }
+            std::vector<uint8_t> quotients(N, 0xa5);
+            done = set.divideToBytes(sums.data(), divisors.data(), quotients.data(), N);
+            ASSERT_LE(done, N);
+            for (vDSP_Length i = 0; i < N; ++i) {
+                const double quotient = std::floor((sums[i] + divisors[i] / 2.0) / divisors[i]);
+                const uint8_t expected = static_cast<uint8_t>(std::min(std::max(quotient, 0.0), 255.0));
+                ASSERT_EQ(i < done ? expected : 0xa5, quotients[i])
+                    << "divideToBytes (" << kernels->name << "), N = " << N << ", element " << i;
+            }
+        }
+    }
+}
+
+TEST(vImageConvolution, MatchesDirectSums) {
+    const uint8_t background[4] = { 200, 10, 128, 255 };
+    for (size_t channels : { 4u, 1u }) {
+        Image src = _random(23, 19, channels, static_cast<unsigned int>(channels));
+        for (const Case& c : _cases()) {
+            const std::vector<int16_t> kernel = (c.filter == Kernel) ? c.kernel : _taps(c.filter, c.height, c.width);
+            double divisor = c.divisor == 0 ? 1 : c.divisor;
+            if (c.filter != Kernel) {
+                divisor = 0;
+                for (int16_t tap : kernel) {
+                    divisor += tap;
+                }
+            }
+
+            for (vImage_Flags edge : c_edges) {
+                // The whole image, and a region in from its top left corner
+                for (vImagePixelCount offset : { 0u, 3u }) {
+                    for (vImage_Flags extra : std::vector<vImage_Flags>{ kvImageNoFlags, kvImageLeaveAlphaUnchanged | kvImageDoNotTile }) {
+                        // The largest kernels take long enough to sum directly just once.
+                        if (kernel.size() > 10000 && (offset != 0 || extra != kvImageNoFlags)) {
+                            continue;
+                        }
+                        const vImage_Flags flags = edge | extra;
+                        Image expected(src.buffer.width - 2 * offset, src.buffer.height - offset, channels);
+                        Image dest(expected);
+                        _convolve(src, expected, offset, offset, kernel, c.height, c.width, divisor, background, flags);
+                        ASSERT_EQ(kvImageNoError, _run(c, src, dest, nullptr, offset, offset, background, flags));
+
+                        // Normalizing by a fraction of a kernel that is not a box may round the other way.
+                        const bool exact = c.filter != Kernel || edge != kvImageTruncateKernel;
+                        for (vImagePixelCount y = 0; y < dest.buffer.height; ++y) {
+                            for (vImagePixelCount x = 0; x < dest.buffer.width * channels; ++x) {
+                                const int difference = static_cast<int>(dest.pixel(0, y)[x]) - static_cast<int>(expected.pixel(0, y)[x]);
+                                ASSERT_LE(std::abs(difference), exact ? 0 : 1)
+                                    << c.name << " " << c.height << "x" << c.width << ", channels " << channels << ", flags " << flags
+                                    << ", offset " << offset << ", row " << y << ", element " << x;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(vImageConvolution, BoxFiltersRoundToNearest) {
+    // Rows summing to 9, 9, 9, 9 and 4, so the 5x5 box around the middle averages 40 / 25 = 1.6. Dividing each row's sum
+    // by 5 and the sum of those by 5 again, truncating both times as vImageBoxConvolve_ARGB8888 once did, gives 0.
+    const uint8_t rows[5][5] = { { 2, 2, 2, 2, 1 }, { 2, 2, 2, 2, 1 }, { 2, 2, 2, 2, 1 }, { 2, 2, 2, 2, 1 }, { 1, 1, 1, 1, 0 } };
+    const uint8_t background[4] = { 0, 0, 0, 0 };
+    const Case box = { Box, 5, 5, {}, 0, "box" };
+
+    for (size_t channels : { 4u, 1u }) {
+        Image src(5, 5, channels);
+        for (vImagePixelCount y = 0; y < 5; ++y) {
+            for (vImagePixelCount x = 0; x < 5; ++x) {
+                memset(src.pixel(x, y), rows[y][x], channels);
+            }
+        }
+
+        for (vImage_Flags edge : c_edges) {
+            Image dest(1, 1, channels);
+            ASSERT_EQ(kvImageNoError, _run(box, src, dest, nullptr, 2, 2, background, edge));
+            for (size_t c = 0; c < channels; ++c) {
+                EXPECT_EQ(2, dest.pixel(0, 0)[c]) << "channels " << channels << ", flags " << edge << ", channel " << c;
+            }
+        }
+    }
+}
+
+TEST(vImageConvolution, TruncatedKernelsRoundWithinOneAtEdges) {
+    // kvImageTruncateKernel scales the divisor down to the share of the kernel's weight inside the image. For kernels
+    // other than boxes and tents that is not a whole number, and working it out in floats rather than doubles may round
+    // a quotient that lands near a half the other way. Where the kernel fits the divisor is the caller's, and exact.
+    const uint8_t background[4] = { 0, 0, 0, 0 };
+    for (size_t channels : { 4u, 1u }) {
+        Image src = _random(31, 17, channels, static_cast<unsigned int>(channels + 40));
+        for (const Case& c : _cases()) {
+            if (c.filter != Kernel) {
+                continue;
+            }
+            Image expected(src.buffer.width, src.buffer.height, channels);
+            Image dest(expected);
+            _convolve(src, expected, 0, 0, c.kernel, c.height, c.width, c.divisor == 0 ? 1 : c.divisor, background, kvImageTruncateKernel);
+            ASSERT_EQ(kvImageNoError, _run(c, src, dest, nullptr, 0, 0, background, kvImageTruncateKernel));
+
+            for (vImagePixelCount y = 0; y < dest.buffer.height; ++y) {
+                for (vImagePixelCount x = 0; x < dest.buffer.width; ++x) {
+                    const bool fits = x >= c.width / 2 && x + c.width / 2 < src.buffer.width && y >= c.height / 2 &&
+                                      y + c.height / 2 < src.buffer.height;
+                    for (size_t channel = 0; channel < channels; ++channel) {
+                        const int difference = static_cast<int>(dest.pixel(x, y)[channel]) - static_cast<int>(expected.pixel(x, y)[channel]);
+                        ASSERT_LE(std::abs(difference), fits ? 0 : 1) << c.name << " " << c.height << "x" << c.width << ", channels "
+                                                                      << channels << ", pixel " << x << ", " << y;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(vImageConvolution, TilesMatchOneThread) {
+    const uint8_t background[4] = { 1, 2, 3, 4 };
+    Image src = _random(640, 480, 4, 21);
+    for (const Case& c : _cases()) {
+        for (vImage_Flags edge : c_edges) {
+            Image tiled(600, 470, 4);
+            Image single(tiled);
+            ASSERT_EQ(kvImageNoError, _run(c, src, tiled, nullptr, 20, 5, background, edge));
+            ASSERT_EQ(kvImageNoError, _run(c, src, single, nullptr, 20, 5, background, edge | kvImageDoNotTile));
+            EXPECT_TRUE(tiled.rowsEqual(single)) << c.name << " " << c.height << "x" << c.width << ", flags " << edge;
+        }
+    }
+}
+
+TEST(vImageConvolution, TempBuffer) {
+    const uint8_t background[4] = { 0, 0, 0, 0 };
+    Image src = _random(300, 200, 4, 3);
+    Image dest(300, 200, 4);
+    for (const Case& c : _cases()) {
+        for (vImage_Flags flags : std::vector<vImage_Flags>{ kvImageTruncateKernel, kvImageEdgeExtend | kvImageDoNotTile }) {
+            const vImage_Error size = _run(c, src, dest, nullptr, 0, 0, background, flags | kvImageGetTempBufferSize);
+            ASSERT_GT(size, 0);
+
+            // Whatever is in the temp buffer beforehand, and nothing written past its end
+            const uint8_t c_guard = 0x5a;
+            std::vector<uint8_t> temp(size + 64, c_guard);
+            Image expected(dest);
+            ASSERT_EQ(kvImageNoError, _run(c, src, expected, nullptr, 0, 0, background, flags));
+            ASSERT_EQ(kvImageNoError, _run(c, src, dest, temp.data(), 0, 0, background, flags));
+            EXPECT_TRUE(dest.rowsEqual(expected)) << c.name << " " << c.height << "x" << c.width;
+            for (size_t i = size; i < temp.size(); ++i) {
+                ASSERT_EQ(c_guard, temp[i]) << c.name << " " << c.height << "x" << c.width << ", byte " << i;
+            }
+        }
+    }
+
+    // Nothing to do needs no temp buffer
+    Image empty(0, 0, 4);
+    EXPECT_EQ(0,
+              vImageBoxConvolve_ARGB8888(
+                  &src.buffer, &empty.buffer, nullptr, 0, 0, 3, 3, background, kvImageEdgeExtend | kvImageGetTempBufferSize));
+}
+
+TEST(vImageConvolution, Errors) {
+    const Pixel_8888 background = { 0, 0, 0, 0 };
+    const int16_t kernel[9] = { 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+    Image src = _random(10, 10, 4, 1);
+    Image dest(10, 10, 4);
+    Image small(4, 4, 4);
+
+    EXPECT_EQ(kvImageNullPointerArgument,
+              vImageConvolve_ARGB8888(&src.buffer, &dest.buffer, nullptr, 0, 0, nullptr, 3, 3, 9, background, kvImageEdgeExtend));
+    EXPECT_EQ(kvImageInvalidKernelSize,
+              vImageTentConvolve_ARGB8888(&src.buffer, &dest.buffer, nullptr, 0, 0, 4, 3, background, kvImageEdgeExtend));
+    EXPECT_EQ(kvImageInvalidKernelSize,
+              vImageConvolve_ARGB8888(&src.buffer, &dest.buffer, nullptr, 0, 0, kernel, 3, 0, 9, background, kvImageEdgeExtend));
+    EXPECT_EQ(kvImageInvalidOffset_X, vImageBoxConvolve_Planar8(&src.buffer, &small.buffer, nullptr, 11, 0, 3, 3, 0, kvImageEdgeExtend));
+    EXPECT_EQ(kvImageRoiLargerThanInputBuffer,
+              vImageBoxConvolve_ARGB8888(&src.buffer, &small.buffer, nullptr, 7, 0, 3, 3, background, kvImageEdgeExtend));
+    EXPECT_EQ(kvImageInvalidEdgeStyle, vImageConvolve_ARGB8888(&src.buffer, &dest.buffer, nullptr, 0, 0, kernel, 3, 3, 9, background, 0));
+}
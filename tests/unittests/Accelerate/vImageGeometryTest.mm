@@ -0,0 +1,370 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include "gtest-api.h"
+#import "Accelerate/Accelerate.h"
+#include "vDSPInternal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// The image kernels are checked bit for bit against the plain loops, and vImageScale against a Lanczos filter taken in
+// double precision, to within one step of rounding. Rotations and reflections only move pixels, so they have to match
+// exactly.
+
+namespace {
+
+// An image with its pixels in a vector, rows padded to rowBytes.
+struct Image {
+    std::vector<uint8_t> pixels;
+    vImage_Buffer buffer;
+
+    Image(vImagePixelCount width, vImagePixelCount height, size_t channels, size_t padding = 3)
+        : pixels((width * channels + padding) * height + 1) {
+        buffer.data = pixels.data();
+        buffer.width = width;
+        buffer.height = height;
+        buffer.rowBytes = width * channels + padding;
+    }
+
+    Image(const Image& other) : pixels(other.pixels), buffer(other.buffer) {
+        buffer.data = pixels.data();
+    }
+
+    uint8_t* at(vImagePixelCount x, vImagePixelCount y, size_t channels) {
+        return pixels.data() + y * buffer.rowBytes + x * channels;
+    }
+};
+
+Image _randomImage(vImagePixelCount width, vImagePixelCount height, size_t channels, unsigned int seed) {
+    Image image(width, height, channels);
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> distribution(0, 255);
+    for (uint8_t& pixel : image.pixels) {
+        pixel = static_cast<uint8_t>(distribution(generator));
+    }
+    return image;
+}
+
+bool _samePixels(Image& a, Image& b, size_t channels) {
+    for (vImagePixelCount y = 0; y < a.buffer.height; ++y) {
+        if (memcmp(a.at(0, y, channels), b.at(0, y, channels), a.buffer.width * channels) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A product kept out of any fused multiply-add.
+float _product(float a, float b) {
+    volatile float product = a * b;
+    return product;
+}
+
+bool _same(float a, float b) {
+    return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+double _lanczos(double t, int radius) {
+    if (t == 0) {
+        return 1;
+    } else if (std::fabs(t) >= radius) {
+        return 0;
+    }
+    const double x = 3.14159265358979323846 * t;
+    return radius * std::sin(x) * std::sin(x / radius) / (x * x);
+}
+
+// The weights of every source sample for each destination sample, samples past the edges folded onto the edges.
+std::vector<std::vector<double>> _weights(vImagePixelCount from, vImagePixelCount to, int radius) {
+    const double scale = std::max(1.0, static_cast<double>(from) / to);
+    std::vector<std::vector<double>> weights(to, std::vector<double>(from));
+    for (vImagePixelCount i = 0; i < to; ++i) {
+        const double center = (i + 0.5) * from / to - 0.5;
+        double sum = 0;
+        for (long j = static_cast<long>(std::floor(center - radius * scale)); j <= std::ceil(center + radius * scale); ++j) {
+            const double weight = _lanczos((j - center) / scale, radius);
+            weights[i][std::min(std::max(j, 0L), static_cast<long>(from) - 1)] += weight;
+            sum += weight;
+        }
+        for (double& weight : weights[i]) {
+            weight /= sum;
+        }
+    }
+    return weights;
+}
+
+void _checkScale(vImagePixelCount srcWidth,
+                 vImagePixelCount srcHeight,
+                 vImagePixelCount destWidth,
+                 vImagePixelCount destHeight,
+                 size_t channels,
+                 vImage_Flags flags) {
+    Image src = _randomImage(srcWidth, srcHeight, channels, static_cast<unsigned int>(srcWidth * 31 + srcHeight));
+    Image dest(destWidth, destHeight, channels);
+    vImage_Error error = (channels == 4) ? vImageScale_ARGB8888(&src.buffer, &dest.buffer, nullptr, flags)
+                                         : vImageScale_Planar8(&src.buffer, &dest.buffer, nullptr, flags);
+    ASSERT_EQ(kvImageNoError, error);
+
+    const int radius = (flags & kvImageHighQualityResampling) ? 5 : 3;
+    std::vector<std::vector<double>> rows = _weights(srcHeight, destHeight, radius);
+    std::vector<std::vector<double>> columns = _weights(srcWidth, destWidth, radius);
+    for (vImagePixelCount y = 0; y < destHeight; ++y) {
+        for (vImagePixelCount x = 0; x < destWidth; ++x) {
+            for (size_t c = 0; c < channels; ++c) {
+                double sum = 0;
+                for (vImagePixelCount sy = 0; sy < srcHeight; ++sy) {
+                    for (vImagePixelCount sx = 0; sx < srcWidth; ++sx) {
+                        sum += rows[y][sy] * columns[x][sx] * src.at(sx, sy, channels)[c];
+                    }
+                }
+                const double expected = std::min(std::max(sum, 0.0), 255.0);
+                ASSERT_NEAR(expected, dest.at(x, y, channels)[c], 0.5 + 1.0E-3)
+                    << srcWidth << " x " << srcHeight << " to " << destWidth << " x " << destHeight << ", " << channels
+                    << " channels, pixel " << x << ", " << y << ", channel " << c;
+            }
+        }
+    }
+}
+
+} // namespace
+
+TEST(vImageGeometry, KernelsMatchLoops) {
+    const vDSP_Length lengths[] = { 0, 1, 3, 4, 7, 8, 15, 16, 17, 33, 100 };
+    const float c_untouched = 12345;
+
+    for (const vDSPKernels* kernels : vDSPGetAvailableKernels()) {
+        const vImageKernelSet& set = kernels->image;
+        for (vDSP_Length N : lengths) {
+            for (vDSP_Length taps : { 1, 2, 6, 13 }) {
+                Image src = _randomImage(N, taps, 1, static_cast<unsigned int>(N + taps));
+                std::vector<const uint8_t*> rows(taps);
+                std::vector<float> weights(taps);
+                for (vDSP_Length k = 0; k < taps; ++k) {
+                    rows[k] = src.at(0, taps - 1 - k, 1);
+                    weights[k] = 1.0f / (k + 3) - 0.1f;
+                }
+
+                std::vector<float> C(N, c_untouched);
+                vDSP_Length done = set.scaleRows(rows.data(), weights.data(), taps, C.data(), N);
+                ASSERT_LE(done, N);
+                for (vDSP_Length i = 0; i < N; ++i) {
+                    float expected = c_untouched;
+                    if (i < done) {
+                        expected = 0;
+                        for (vDSP_Length k = 0; k < taps; ++k) {
+                            expected += _product(weights[k], static_cast<float>(rows[k][i]));
+                        }
+                    }
+                    ASSERT_TRUE(_same(expected, C[i])) << "scaleRows (" << kernels->name << "), N = " << N << ", taps = " << taps
+                                                       << ", element " << i;
+                }
+
+                std::vector<float> line(N + taps);
+                for (size_t i = 0; i < line.size(); ++i) {
+                    line[i] = static_cast<float>((i * 37) % 300) - 20.25f;
+                }
+                std::vector<int32_t> indices(taps * N);
+                std::vector<float> columnWeights(taps * N);
+                for (size_t i = 0; i < indices.size(); ++i) {
+                    indices[i] = static_cast<int32_t>((i * 7) % line.size());
+                    columnWeights[i] = 1.0f / (i % 5 + 1);
+                }
+
+                std::vector<uint8_t> out(N, 77);
+                done = set.scaleColumns(line.data(), indices.data(), columnWeights.data(), taps, out.data(), N);
+                ASSERT_LE(done, N);
+                for (vDSP_Length j = 0; j < N; ++j) {
+                    uint8_t expected = 77;
+                    if (j < done) {
+                        float sum = 0;
+                        for (vDSP_Length k = 0; k < taps; ++k) {
+                            sum += _product(line[indices[k * N + j]], columnWeights[k * N + j]);
+                        }
+                        expected = static_cast<uint8_t>(std::min(std::max(sum, 0.0f), 255.0f) + 0.5f);
+                    }
+                    ASSERT_EQ(expected, out[j]) << "scaleColumns (" << kernels->name << "), N = " << N << ", taps = " << taps
+                                                << ", element " << j;
+                }
+            }
+
+            Image pixels = _randomImage(N, 1, 4, static_cast<unsigned int>(N));
+            std::vector<uint8_t> reflected(4 * N, 0);
+            vDSP_Length done = set.reflect32(pixels.at(0, 0, 4), reflected.data(), N);
+            ASSERT_LE(2 * done, N);
+            for (vDSP_Length i = 0; i < N; ++i) {
+                const bool written = i < done || i >= N - done;
+                for (size_t c = 0; c < 4; ++c) {
+                    ASSERT_EQ(written ? pixels.at(N - 1 - i, 0, 4)[c] : 0, reflected[4 * i + c])
+                        << "reflect32 (" << kernels->name << "), N = " << N << ", pixel " << i;
+                }
+            }
+        }
+    }
+}
+
+TEST(vImageGeometry, ScaleMatchesLanczos) {
+    const vImagePixelCount sizes[][4] = { { 8, 8, 8, 8 },   { 13, 9, 5, 4 },  { 9, 13, 27, 30 },
+                                          { 40, 3, 7, 11 }, { 1, 1, 6, 5 },   { 17, 20, 17, 20 },
+                                          { 64, 48, 9, 7 }, { 5, 7, 23, 2 } };
+    for (const auto& size : sizes) {
+        _checkScale(size[0], size[1], size[2], size[3], 4, kvImageNoFlags);
+        _checkScale(size[0], size[1], size[2], size[3], 1, kvImageNoFlags);
+    }
+    _checkScale(30, 20, 11, 45, 4, kvImageHighQualityResampling);
+    _checkScale(30, 20, 11, 45, 1, kvImageHighQualityResampling | kvImageDoNotTile);
+}
+
+TEST(vImageGeometry, ScaleKeepsFlatImages) {
+    for (vImagePixelCount size : { 1, 7, 64, 333 }) {
+        Image src(97, 61, 4);
+        for (vImagePixelCount y = 0; y < 61; ++y) {
+            for (vImagePixelCount x = 0; x < 97; ++x) {
+                const uint8_t color[] = { 255, 0, 17, 200 };
+                memcpy(src.at(x, y, 4), color, 4);
+            }
+        }
+
+        Image dest(size, size / 2 + 1, 4);
+        ASSERT_EQ(kvImageNoError, vImageScale_ARGB8888(&src.buffer, &dest.buffer, nullptr, kvImageNoFlags));
+        for (vImagePixelCount y = 0; y < dest.buffer.height; ++y) {
+            for (vImagePixelCount x = 0; x < size; ++x) {
+                const uint8_t* pixel = dest.at(x, y, 4);
+                ASSERT_EQ(255, pixel[0]);
+                ASSERT_EQ(0, pixel[1]);
+                ASSERT_EQ(17, pixel[2]);
+                ASSERT_EQ(200, pixel[3]);
+            }
+        }
+    }
+}
+
+TEST(vImageGeometry, ScaleTempBuffer) {
+    Image src = _randomImage(300, 200, 4, 1);
+    Image dest(70, 410, 4);
+    Image tiled(70, 410, 4);
+    Image untiled(70, 410, 4);
+
+    ASSERT_EQ(kvImageNoError, vImageScale_ARGB8888(&src.buffer, &tiled.buffer, nullptr, kvImageNoFlags));
+    ASSERT_EQ(kvImageNoError, vImageScale_ARGB8888(&src.buffer, &untiled.buffer, nullptr, kvImageDoNotTile));
+    EXPECT_TRUE(_samePixels(tiled, untiled, 4));
+
+    vImage_Error size = vImageScale_ARGB8888(&src.buffer, &dest.buffer, nullptr, kvImageGetTempBufferSize);
+    ASSERT_GT(size, 0);
+    std::vector<uint8_t> temp(size);
+    ASSERT_EQ(kvImageNoError, vImageScale_ARGB8888(&src.buffer, &dest.buffer, temp.data(), kvImageNoFlags));
+    EXPECT_TRUE(_samePixels(tiled, dest, 4));
+
+    vImage_Buffer empty = { src.buffer.data, 0, 0, 0 };
+    EXPECT_EQ(kvImageInvalidParameter, vImageScale_ARGB8888(&empty, &dest.buffer, nullptr, kvImageNoFlags));
+    EXPECT_EQ(kvImageNullPointerArgument, vImageScale_Planar8(nullptr, &dest.buffer, nullptr, kvImageNoFlags));
+}
+
+TEST(vImageGeometry, Rotate90) {
+    // 3 x 2, one byte per pixel
+    Image src(3, 2, 1);
+    const uint8_t values[] = { 1, 2, 3, 4, 5, 6 };
+    for (int i = 0; i < 6; ++i) {
+        *src.at(i % 3, i / 3, 1) = values[i];
+    }
+
+    const uint8_t c_clockwise90[] = { 4, 1, 5, 2, 6, 3 };
+    const uint8_t c_180[] = { 6, 5, 4, 3, 2, 1 };
+    const uint8_t c_counterClockwise90[] = { 3, 6, 2, 5, 1, 4 };
+    const struct {
+        uint8_t rotation;
+        vImagePixelCount width;
+        const uint8_t* expected;
+    } cases[] = { { kRotate0DegreesClockwise, 3, values },
+                  { kRotate90DegreesClockwise, 2, c_clockwise90 },
+                  { kRotate180DegreesClockwise, 3, c_180 },
+                  { kRotate90DegreesCounterClockwise, 2, c_counterClockwise90 } };
+    for (const auto& test : cases) {
+        Image dest(test.width, 6 / test.width, 1);
+        ASSERT_EQ(kvImageNoError, vImageRotate90_Planar8(&src.buffer, &dest.buffer, test.rotation, 0, kvImageNoFlags));
+        for (int i = 0; i < 6; ++i) {
+            EXPECT_EQ(test.expected[i], *dest.at(i % test.width, i / test.width, 1)) << "rotation " << int(test.rotation) << ", pixel "
+                                                                                     << i;
+        }
+    }
+
+    // Centred in a larger destination, the rest filled with the background.
+    Image larger(4, 5, 1);
+    ASSERT_EQ(kvImageNoError, vImageRotate90_Planar8(&src.buffer, &larger.buffer, kRotate90DegreesClockwise, 9, kvImageNoFlags));
+    const uint8_t c_centred[] = { 9, 9, 9, 9, 9, 4, 1, 9, 9, 5, 2, 9, 9, 6, 3, 9, 9, 9, 9, 9 };
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_EQ(c_centred[i], *larger.at(i % 4, i / 4, 1)) << "pixel " << i;
+    }
+
+    EXPECT_EQ(kvImageInvalidParameter, vImageRotate90_Planar8(&src.buffer, &larger.buffer, 4, 0, kvImageNoFlags));
+}
+
+TEST(vImageGeometry, Rotate90RoundTrips) {
+    const Pixel_8888 background = { 1, 2, 3, 4 };
+    Image src = _randomImage(77, 45, 4, 2);
+    Image turned(45, 77, 4);
+    Image back(77, 45, 4);
+    Image half(77, 45, 4);
+    Image whole(77, 45, 4);
+
+    ASSERT_EQ(kvImageNoError, vImageRotate90_ARGB8888(&src.buffer, &turned.buffer, kRotate90DegreesClockwise, background, kvImageNoFlags));
+    for (vImagePixelCount y = 0; y < 77; ++y) {
+        for (vImagePixelCount x = 0; x < 45; ++x) {
+            ASSERT_EQ(0, memcmp(turned.at(x, y, 4), src.at(y, 44 - x, 4), 4)) << "pixel " << x << ", " << y;
+        }
+    }
+
+    ASSERT_EQ(kvImageNoError,
+              vImageRotate90_ARGB8888(&turned.buffer, &back.buffer, kRotate90DegreesCounterClockwise, background, kvImageDoNotTile));
+    EXPECT_TRUE(_samePixels(src, back, 4));
+
+    ASSERT_EQ(kvImageNoError, vImageRotate90_ARGB8888(&src.buffer, &half.buffer, kRotate180DegreesClockwise, background, kvImageNoFlags));
+    ASSERT_EQ(kvImageNoError,
+              vImageRotate90_ARGB8888(&half.buffer, &whole.buffer, kRotate180DegreesCounterClockwise, background, kvImageNoFlags));
+    EXPECT_TRUE(_samePixels(src, whole, 4));
+}
+
+TEST(vImageGeometry, HorizontalReflect) {
+    for (vImagePixelCount width : { 1, 2, 5, 8, 9, 16, 31, 100 }) {
+        Image src = _randomImage(width, 3, 4, static_cast<unsigned int>(width));
+        Image dest(width, 3, 4);
+        ASSERT_EQ(kvImageNoError, vImageHorizontalReflect_ARGB8888(&src.buffer, &dest.buffer, kvImageNoFlags));
+        for (vImagePixelCount y = 0; y < 3; ++y) {
+            for (vImagePixelCount x = 0; x < width; ++x) {
+                ASSERT_EQ(0, memcmp(dest.at(x, y, 4), src.at(width - 1 - x, y, 4), 4)) << "width " << width << ", pixel " << x;
+            }
+        }
+
+        ASSERT_EQ(kvImageNoError, vImageHorizontalReflect_ARGB8888(&dest.buffer, &dest.buffer, kvImageNoFlags));
+        EXPECT_TRUE(_samePixels(src, dest, 4)) << "width " << width;
+
+        Image planar = _randomImage(width, 2, 1, static_cast<unsigned int>(width + 1));
+        Image original = planar;
+        ASSERT_EQ(kvImageNoError, vImageHorizontalReflect_Planar8(&planar.buffer, &planar.buffer, kvImageNoFlags));
+        for (vImagePixelCount y = 0; y < 2; ++y) {
+            for (vImagePixelCount x = 0; x < width; ++x) {
+                ASSERT_EQ(*original.at(width - 1 - x, y, 1), *planar.at(x, y, 1)) << "width " << width << ", pixel " << x;
+            }
+        }
+    }
+
+    Image small(4, 4, 1);
+    Image large(5, 4, 1);
+    EXPECT_EQ(kvImageBufferSizeMismatch, vImageHorizontalReflect_Planar8(&small.buffer, &large.buffer, kvImageNoFlags));
+}
@@ -0,0 +1,176 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#import "Starboard.h"
+#import "TestFramework.h"
+#import <Foundation/Foundation.h>
+#import <CoreFoundation/CFBurstTrie.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* const c_streets[] = { "Main Street", "Mill Lane", "Oak Road", "Maple Avenue", "Market Square", "Church Road" };
+
+// "Main Street 0", "Mill Lane 1", ... with the index as payload (plus one, since payloads must be non-zero).
+std::map<std::string, uint32_t> _addresses(size_t count) {
+    std::map<std::string, uint32_t> addresses;
+    const size_t streetCount = sizeof(c_streets) / sizeof(c_streets[0]);
+    for (size_t i = 0; i < count; ++i) {
+        addresses[std::string(c_streets[i % streetCount]) + " " + std::to_string(i / streetCount)] = static_cast<uint32_t>(i + 1);
+    }
+    return addresses;
+}
+
+NSString* _path(CFBurstTrieOpts opts) {
+    return [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"CFBurstTrieTests-%lu.trie", opts]];
+}
+
+// Builds a trie from the addresses, serializes it with the given options and maps it back.
+CFBurstTrieRef _createMappedTrie(const std::map<std::string, uint32_t>& addresses, CFBurstTrieOpts opts) {
+    CFBurstTrieRef trie = CFBurstTrieCreate();
+    for (const auto& address : addresses) {
+        CFBurstTrieAddUTF8String(trie, (UInt8*)address.first.data(), address.first.size(), address.second);
+    }
+
+    NSString* path = _path(opts);
+    Boolean serialized = CFBurstTrieSerialize(trie, (CFStringRef)path, kCFBurstTrieReadOnly | opts);
+    CFBurstTrieRelease(trie);
+    return serialized ? CFBurstTrieCreateFromFile((CFStringRef)path) : nullptr;
+}
+
+// Keys are NUL terminated as well as passed with their length.
+void _collect(void* context, const UInt8* key, uint32_t keyLength, uint32_t payload, Boolean* stop) {
+    EXPECT_EQ(keyLength, strlen((const char*)key));
+    (*static_cast<std::map<std::string, uint32_t>*>(context))[std::string((const char*)key, keyLength)] = payload;
+}
+
+std::map<std::string, uint32_t> _withPrefix(const std::map<std::string, uint32_t>& addresses, const std::string& prefix) {
+    std::map<std::string, uint32_t> matches;
+    for (auto it = addresses.lower_bound(prefix); it != addresses.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+        matches.insert(*it);
+    }
+    return matches;
+}
+
+const CFBurstTrieOpts c_options[] = { kCFBurstTriePrefixCompression,
+                                      kCFBurstTrieSortByKey,
+                                      kCFBurstTriePrefixCompression | kCFBurstTrieBitmapCompression,
+                                      kCFBurstTrieSortByKey | kCFBurstTrieBitmapCompression };
+
+} // namespace
+
+TEST(CFBurstTrie, MappedLookups) {
+    std::map<std::string, uint32_t> addresses = _addresses(20000);
+
+    for (CFBurstTrieOpts opts : c_options) {
+        CFBurstTrieRef trie = _createMappedTrie(addresses, opts);
+        ASSERT_NE(nullptr, trie);
+        EXPECT_EQ(addresses.size(), CFBurstTrieGetCount(trie));
+
+        for (const auto& address : addresses) {
+            uint32_t payload = 0;
+            ASSERT_TRUE(CFBurstTrieContainsUTF8String(trie, (UInt8*)address.first.data(), address.first.size(), &payload));
+            ASSERT_EQ(address.second, payload);
+        }
+
+        uint32_t payload = 0;
+        EXPECT_FALSE(CFBurstTrieContainsUTF8String(trie, (UInt8*)"Main Street", 11, &payload));
+        EXPECT_FALSE(CFBurstTrieContainsUTF8String(trie, (UInt8*)"Main Street 99999", 17, &payload));
+        EXPECT_FALSE(CFBurstTrieContainsUTF8String(trie, (UInt8*)"Elm Street 1", 12, &payload));
+
+        CFBurstTrieRelease(trie);
+        [[NSFileManager defaultManager] removeItemAtPath:_path(opts) error:nil];
+    }
+}
+
+TEST(CFBurstTrie, TraverseWithPrefix) {
+    std::map<std::string, uint32_t> addresses = _addresses(20000);
+    const char* const prefixes[] = { "", "M", "Mill Lane 1", "Oak Road 19", "Market Square 1234", "Elm" };
+
+    for (CFBurstTrieOpts opts : c_options) {
+        CFBurstTrieRef trie = _createMappedTrie(addresses, opts);
+        ASSERT_NE(nullptr, trie);
+
+        for (const char* prefix : prefixes) {
+            std::map<std::string, uint32_t> found;
+            CFBurstTrieTraverseWithPrefix(trie, (const UInt8*)prefix, strlen(prefix), &found, _collect);
+            EXPECT_TRUE(_withPrefix(addresses, prefix) == found) << "prefix \"" << prefix << "\", options " << opts;
+        }
+
+        CFBurstTrieRelease(trie);
+        [[NSFileManager defaultManager] removeItemAtPath:_path(opts) error:nil];
+    }
+}
+
+TEST(CFBurstTrie, TraverseWithPrefixStops) {
+    CFBurstTrieRef trie = _createMappedTrie(_addresses(1000), kCFBurstTriePrefixCompression);
+    ASSERT_NE(nullptr, trie);
+
+    size_t count = 0;
+    CFBurstTrieTraverseWithPrefix(trie,
+                                  (const UInt8*)"Oak",
+                                  3,
+                                  &count,
+                                  [](void* context, const UInt8* key, uint32_t keyLength, uint32_t payload, Boolean* stop) {
+                                      *stop = (++*static_cast<size_t*>(context) == 5);
+                                  });
+    EXPECT_EQ(5, count);
+
+    CFBurstTrieRelease(trie);
+    [[NSFileManager defaultManager] removeItemAtPath:_path(kCFBurstTriePrefixCompression) error:nil];
+}
+
+TEST(CFBurstTrie, ConcurrentReaders) {
+    std::map<std::string, uint32_t> addresses = _addresses(50000);
+    std::vector<std::pair<std::string, uint32_t>> entries(addresses.begin(), addresses.end());
+
+    CFBurstTrieRef trie = _createMappedTrie(addresses, kCFBurstTriePrefixCompression);
+    ASSERT_NE(nullptr, trie);
+
+    std::atomic<size_t> failures{ 0 };
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < 8; ++t) {
+        readers.emplace_back([&, t]() {
+            CFBurstTrieRef reader = CFBurstTrieRetain(trie);
+            for (size_t i = t; i < entries.size(); i += 3) {
+                uint32_t payload = 0;
+                if (!CFBurstTrieContainsUTF8String(reader, (UInt8*)entries[i].first.data(), entries[i].first.size(), &payload) ||
+                    payload != entries[i].second) {
+                    ++failures;
+                }
+            }
+
+            std::map<std::string, uint32_t> found;
+            CFBurstTrieTraverseWithPrefix(reader, (const UInt8*)c_streets[t % 6], strlen(c_streets[t % 6]), &found, _collect);
+            if (found != _withPrefix(addresses, c_streets[t % 6])) {
+                ++failures;
+            }
+            CFBurstTrieRelease(reader);
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(0, failures);
+    CFBurstTrieRelease(trie);
+    [[NSFileManager defaultManager] removeItemAtPath:_path(kCFBurstTriePrefixCompression) error:nil];
+}
@@ -0,0 +1,168 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#import "Starboard.h"
+#import "TestFramework.h"
+#import "CoreFoundation/CoreFoundation.h"
+
+#include <vector>
+
+namespace {
+
+// Keys that all hash alike, so that every lookup has to look past the tags of its neighbours.
+CFHashCode _collidingHash(const void* value) {
+    return reinterpret_cast<uintptr_t>(value) % 3;
+}
+
+Boolean _collidingEqual(const void* value1, const void* value2) {
+    return value1 == value2;
+}
+
+CFArrayRef _createStrings(CFIndex count, CFStringRef format) {
+    CFMutableArrayRef strings = CFArrayCreateMutable(nullptr, count, &kCFTypeArrayCallBacks);
+    for (CFIndex i = 0; i < count; ++i) {
+        CFStringRef string = CFStringCreateWithFormat(nullptr, nullptr, format, i * 31);
+        CFArrayAppendValue(strings, string);
+        CFRelease(string);
+    }
+    return strings;
+}
+
+CFArrayRef _createNumbers(CFIndex count, CFIndex offset) {
+    CFMutableArrayRef numbers = CFArrayCreateMutable(nullptr, count, &kCFTypeArrayCallBacks);
+    for (CFIndex i = 0; i < count; ++i) {
+        CFIndex value = offset + i * 7;
+        CFNumberRef number = CFNumberCreate(nullptr, kCFNumberCFIndexType, &value);
+        CFArrayAppendValue(numbers, number);
+        CFRelease(number);
+    }
+    return numbers;
+}
+
+// Fills a dictionary with the keys, then checks that every one of them is found and that none of the absent keys are.
+void _checkLookups(CFArrayRef keys, CFArrayRef absentKeys, const CFDictionaryKeyCallBacks* keyCallBacks) {
+    CFIndex count = CFArrayGetCount(keys);
+    CFMutableDictionaryRef dictionary = CFDictionaryCreateMutable(nullptr, 0, keyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    std::vector<const void*> present(count), absent(count);
+    CFArrayGetValues(keys, CFRangeMake(0, count), present.data());
+    CFArrayGetValues(absentKeys, CFRangeMake(0, count), absent.data());
+    for (CFIndex i = 0; i < count; ++i) {
+        CFNumberRef value = CFNumberCreate(nullptr, kCFNumberCFIndexType, &i);
+        CFDictionarySetValue(dictionary, present[i], value);
+        CFRelease(value);
+    }
+    EXPECT_EQ(count, CFDictionaryGetCount(dictionary));
+
+    for (CFIndex i = 0; i < count; ++i) {
+        CFIndex value = -1;
+        CFNumberRef number = static_cast<CFNumberRef>(CFDictionaryGetValue(dictionary, present[i]));
+        ASSERT_NE(nullptr, number);
+        CFNumberGetValue(number, kCFNumberCFIndexType, &value);
+        EXPECT_EQ(i, value);
+        EXPECT_FALSE(CFDictionaryContainsKey(dictionary, absent[i]));
+    }
+    CFRelease(dictionary);
+}
+
+} // namespace
+
+TEST(CFDictionary, CollidingKeysAddRemoveAndLookUp) {
+    const uintptr_t c_count = 500;
+    CFDictionaryKeyCallBacks keyCallBacks = { 0, nullptr, nullptr, nullptr, _collidingEqual, _collidingHash };
+    CFMutableDictionaryRef dictionary = CFDictionaryCreateMutable(nullptr, 0, &keyCallBacks, nullptr);
+
+    for (uintptr_t i = 1; i <= c_count; ++i) {
+        CFDictionarySetValue(dictionary, reinterpret_cast<const void*>(i), reinterpret_cast<const void*>(i * 2));
+    }
+    EXPECT_EQ(c_count, CFDictionaryGetCount(dictionary));
+
+    // Remove every other key, leaving deleted buckets in between the live ones.
+    for (uintptr_t i = 1; i <= c_count; i += 2) {
+        CFDictionaryRemoveValue(dictionary, reinterpret_cast<const void*>(i));
+    }
+    for (uintptr_t i = 1; i <= c_count; ++i) {
+        EXPECT_EQ(i % 2 == 0, CFDictionaryContainsKey(dictionary, reinterpret_cast<const void*>(i)));
+    }
+    EXPECT_EQ(reinterpret_cast<const void*>(c_count * 2), CFDictionaryGetValue(dictionary, reinterpret_cast<const void*>(c_count)));
+
+    // Re-adding reuses the deleted buckets without duplicating the keys still present.
+    for (uintptr_t i = 1; i <= c_count; ++i) {
+        CFDictionarySetValue(dictionary, reinterpret_cast<const void*>(i), reinterpret_cast<const void*>(i * 3));
+    }
+    EXPECT_EQ(c_count, CFDictionaryGetCount(dictionary));
+
+    CFDictionaryRef copy = CFDictionaryCreateCopy(nullptr, dictionary);
+    for (uintptr_t i = 1; i <= c_count; ++i) {
+        EXPECT_EQ(reinterpret_cast<const void*>(i * 3), CFDictionaryGetValue(copy, reinterpret_cast<const void*>(i)));
+    }
+    EXPECT_FALSE(CFDictionaryContainsKey(copy, reinterpret_cast<const void*>(c_count + 1)));
+
+    CFRelease(copy);
+    CFRelease(dictionary);
+}
+
+TEST(CFDictionary, SetAndBagWithEqualKeysThatAreDistinctObjects) {
+    CFArrayRef keys = _createStrings(1000, CFSTR("key.%ld"));
+    CFArrayRef equalKeys = _createStrings(1000, CFSTR("key.%ld"));
+    CFMutableDictionaryRef dictionary =
+        CFDictionaryCreateMutable(nullptr, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+
+    for (CFIndex i = 0; i < CFArrayGetCount(keys); ++i) {
+        CFDictionarySetValue(dictionary, CFArrayGetValueAtIndex(keys, i), CFArrayGetValueAtIndex(keys, i));
+    }
+    for (CFIndex i = 0; i < CFArrayGetCount(equalKeys); ++i) {
+        EXPECT_EQ(CFArrayGetValueAtIndex(keys, i), CFDictionaryGetValue(dictionary, CFArrayGetValueAtIndex(equalKeys, i)));
+    }
+    EXPECT_FALSE(CFDictionaryContainsKey(dictionary, CFSTR("key.1")));
+
+    CFMutableSetRef set = CFSetCreateMutable(nullptr, 0, &kCFTypeSetCallBacks);
+    CFMutableBagRef bag = CFBagCreateMutable(nullptr, 0, &kCFTypeBagCallBacks);
+    for (CFIndex i = 0; i < CFArrayGetCount(keys); ++i) {
+        CFSetAddValue(set, CFArrayGetValueAtIndex(keys, i));
+        CFBagAddValue(bag, CFArrayGetValueAtIndex(keys, i));
+        CFBagAddValue(bag, CFArrayGetValueAtIndex(equalKeys, i));
+    }
+    for (CFIndex i = 0; i < CFArrayGetCount(equalKeys); ++i) {
+        EXPECT_EQ(CFArrayGetValueAtIndex(keys, i), CFSetGetValue(set, CFArrayGetValueAtIndex(equalKeys, i)));
+        EXPECT_EQ(2, CFBagGetCountOfValue(bag, CFArrayGetValueAtIndex(equalKeys, i)));
+    }
+    EXPECT_FALSE(CFSetContainsValue(set, CFSTR("key.1")));
+
+    CFRelease(bag);
+    CFRelease(set);
+    CFRelease(dictionary);
+    CFRelease(equalKeys);
+    CFRelease(keys);
+}
+
+TEST(CFDictionary, LookupsByKeyType) {
+    for (CFIndex count : { 64, 4096, 50000 }) {
+        CFArrayRef strings = _createStrings(count, CFSTR("placemark.property.%ld"));
+        CFArrayRef absentStrings = _createStrings(count, CFSTR("placemark.property.%ld.absent"));
+        _checkLookups(strings, absentStrings, &kCFTypeDictionaryKeyCallBacks);
+        CFRelease(absentStrings);
+        CFRelease(strings);
+
+        CFArrayRef numbers = _createNumbers(count, 0);
+        CFArrayRef absentNumbers = _createNumbers(count, 3);
+        _checkLookups(numbers, absentNumbers, &kCFTypeDictionaryKeyCallBacks);
+
+        // The same objects looked up by identity
+        _checkLookups(numbers, absentNumbers, nullptr);
+        CFRelease(absentNumbers);
+        CFRelease(numbers);
+    }
+}
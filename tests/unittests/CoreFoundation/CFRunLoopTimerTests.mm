@@ -0,0 +1,145 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#import "Starboard.h"
+#import "TestFramework.h"
+#import "CoreFoundation/CoreFoundation.h"
+
+#include <vector>
+
+static CFStringRef c_testMode = CFSTR("CFRunLoopTimerTestMode");
+
+static void _timerCallBack(CFRunLoopTimerRef timer, void* info) {
+}
+
+static CFRunLoopTimerRef _createTimer(CFAbsoluteTime fireDate, CFTimeInterval tolerance = 0) {
+    CFRunLoopTimerRef timer = CFRunLoopTimerCreate(nullptr, fireDate, 0, 0, 0, _timerCallBack, nullptr);
+    CFRunLoopTimerSetTolerance(timer, tolerance);
+    return timer;
+}
+
+TEST(CFRunLoopTimer, AddAndRemove) {
+    CFRunLoopRef runLoop = CFRunLoopGetCurrent();
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+    // Spread over the first tick, a few coarser slots and beyond the wheel's horizon.
+    CFTimeInterval offsets[] = { 0.0005, 0.07, 0.3, 5, 600, 86400, 1.0E7 };
+    std::vector<CFRunLoopTimerRef> timers;
+    for (CFTimeInterval offset : offsets) {
+        timers.push_back(_createTimer(now + offset));
+        CFRunLoopAddTimer(runLoop, timers.back(), c_testMode);
+    }
+
+    for (CFRunLoopTimerRef timer : timers) {
+        EXPECT_TRUE(CFRunLoopContainsTimer(runLoop, timer, c_testMode));
+        EXPECT_FALSE(CFRunLoopContainsTimer(runLoop, timer, kCFRunLoopDefaultMode));
+    }
+
+    for (size_t i = 0; i < timers.size(); i += 2) {
+        CFRunLoopRemoveTimer(runLoop, timers[i], c_testMode);
+    }
+
+    for (size_t i = 0; i < timers.size(); ++i) {
+        EXPECT_EQ(i % 2 != 0, CFRunLoopContainsTimer(runLoop, timers[i], c_testMode));
+        CFRunLoopTimerInvalidate(timers[i]);
+        EXPECT_FALSE(CFRunLoopContainsTimer(runLoop, timers[i], c_testMode));
+        CFRelease(timers[i]);
+    }
+}
+
+TEST(CFRunLoopTimer, NextTimerFireDate) {
+    CFRunLoopRef runLoop = CFRunLoopGetCurrent();
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    EXPECT_EQ(0.0, CFRunLoopGetNextTimerFireDate(runLoop, c_testMode));
+
+    CFRunLoopTimerRef late = _createTimer(now + 3600);
+    CFRunLoopTimerRef middle = _createTimer(now + 0.3, 0.1);
+    CFRunLoopTimerRef early = _createTimer(now + 0.07);
+
+    CFRunLoopAddTimer(runLoop, late, c_testMode);
+    EXPECT_EQ(CFRunLoopTimerGetNextFireDate(late), CFRunLoopGetNextTimerFireDate(runLoop, c_testMode));
+
+    CFRunLoopAddTimer(runLoop, middle, c_testMode);
+    CFRunLoopAddTimer(runLoop, early, c_testMode);
+    EXPECT_EQ(CFRunLoopTimerGetNextFireDate(early), CFRunLoopGetNextTimerFireDate(runLoop, c_testMode));
+
+    // Moving a timer re-files it in the wheel.
+    CFRunLoopTimerSetNextFireDate(early, now + 7200);
+    EXPECT_EQ(CFRunLoopTimerGetNextFireDate(middle), CFRunLoopGetNextTimerFireDate(runLoop, c_testMode));
+
+    CFRunLoopTimerSetNextFireDate(late, now + 0.001);
+    EXPECT_EQ(CFRunLoopTimerGetNextFireDate(late), CFRunLoopGetNextTimerFireDate(runLoop, c_testMode));
+
+    CFRunLoopRemoveTimer(runLoop, late, c_testMode);
+    EXPECT_EQ(CFRunLoopTimerGetNextFireDate(middle), CFRunLoopGetNextTimerFireDate(runLoop, c_testMode));
+
+    for (CFRunLoopTimerRef timer : { late, middle, early }) {
+        CFRunLoopTimerInvalidate(timer);
+        CFRelease(timer);
+    }
+    EXPECT_EQ(0.0, CFRunLoopGetNextTimerFireDate(runLoop, c_testMode));
+}
+
+// Many timers spread over every level of the wheel: the run loop's next fire date has to stay the earliest remaining
+// timer's as they are rescheduled and removed in an order unrelated to their fire dates.
+TEST(CFRunLoopTimer, ManyTimersKeepTheEarliestFireDate) {
+    const size_t c_timerCount = 5000;
+
+    CFRunLoopRef runLoop = CFRunLoopGetCurrent();
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+    uint32_t seed = 1;
+    auto next = [&seed]() {
+        seed = seed * 1664525 + 1013904223;
+        return seed >> 8;
+    };
+
+    std::vector<CFRunLoopTimerRef> timers;
+    for (size_t i = 0; i < c_timerCount; ++i) {
+        timers.push_back(_createTimer(now + 0.001 * (1 + next() % 1000) * (1 << (next() % 17))));
+        CFRunLoopAddTimer(runLoop, timers.back(), c_testMode);
+    }
+
+    auto earliest = [&timers]() {
+        CFAbsoluteTime fireDate = 0;
+        for (CFRunLoopTimerRef timer : timers) {
+            CFAbsoluteTime date = CFRunLoopTimerGetNextFireDate(timer);
+            if (fireDate == 0 || date < fireDate) {
+                fireDate = date;
+            }
+        }
+        return fireDate;
+    };
+    EXPECT_EQ(earliest(), CFRunLoopGetNextTimerFireDate(runLoop, c_testMode));
+
+    for (size_t i = 0; i < c_timerCount; i += 3) {
+        CFRunLoopTimerSetNextFireDate(timers[i], now + 0.001 * (1 + next() % 100000));
+    }
+    EXPECT_EQ(earliest(), CFRunLoopGetNextTimerFireDate(runLoop, c_testMode));
+
+    while (!timers.empty()) {
+        size_t index = next() % timers.size();
+        CFRunLoopRemoveTimer(runLoop, timers[index], c_testMode);
+        CFRunLoopTimerInvalidate(timers[index]);
+        CFRelease(timers[index]);
+        timers[index] = timers.back();
+        timers.pop_back();
+
+        if (timers.size() % 500 == 0) {
+            EXPECT_EQ(earliest(), CFRunLoopGetNextTimerFireDate(runLoop, c_testMode));
+        }
+    }
+}
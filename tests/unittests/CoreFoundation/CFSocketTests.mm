@@ -0,0 +1,156 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#import "Starboard.h"
+#import "TestFramework.h"
+#import "CoreFoundation/CoreFoundation.h"
+
+// The CFSocket manager thread is only started on POSIX targets, and the epoll manager only exists on Linux. No project in
+// this tree builds CoreFoundation for either, so none of these tests are compiled or run by CoreFoundation.UnitTests,
+// which is Windows only: the epoll manager is untested here.
+#if !defined(_WIN32)
+
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+namespace {
+
+struct SocketPairs {
+    // Read ends are wrapped in CFSockets with a read callback scheduled on the current run loop; bytes are
+    // written to the peers to wake them.
+    std::vector<int> peers;
+    std::vector<CFSocketRef> sockets;
+    std::vector<CFRunLoopSourceRef> sources;
+
+    // Updated from the read callback.
+    size_t callbacks = 0;
+    size_t expected = 0;
+
+    ~SocketPairs() {
+        for (size_t i = 0; i < sockets.size(); ++i) {
+            CFRunLoopRemoveSource(CFRunLoopGetCurrent(), sources[i], kCFRunLoopDefaultMode);
+            CFRelease(sources[i]);
+            CFSocketInvalidate(sockets[i]);
+            CFRelease(sockets[i]);
+            close(peers[i]);
+        }
+    }
+
+    // Returns the number of pairs actually opened, which is less than count if descriptors ran out.
+    size_t open(size_t count) {
+        CFSocketContext context = { 0, this, nullptr, nullptr, nullptr };
+        for (size_t i = 0; i < count; ++i) {
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+                break;
+            }
+
+            CFSocketRef socket = CFSocketCreateWithNative(nullptr, fds[0], kCFSocketReadCallBack, _readCallBack, &context);
+            CFRunLoopSourceRef source = CFSocketCreateRunLoopSource(nullptr, socket, 0);
+            CFRunLoopAddSource(CFRunLoopGetCurrent(), source, kCFRunLoopDefaultMode);
+
+            peers.push_back(fds[1]);
+            sockets.push_back(socket);
+            sources.push_back(source);
+        }
+        return sockets.size();
+    }
+
+    void signal(size_t index) {
+        char byte = 'x';
+        write(peers[index], &byte, sizeof(byte));
+    }
+
+    // Runs the current run loop until expected callbacks have been delivered, or the timeout passes.
+    bool waitForCallbacks(size_t count, CFTimeInterval timeout = 10) {
+        expected = count;
+        CFAbsoluteTime deadline = CFAbsoluteTimeGetCurrent() + timeout;
+        while (callbacks < expected && CFAbsoluteTimeGetCurrent() < deadline) {
+            CFRunLoopRunInMode(kCFRunLoopDefaultMode, deadline - CFAbsoluteTimeGetCurrent(), true);
+        }
+        return callbacks >= expected;
+    }
+
+private:
+    static void _readCallBack(CFSocketRef socket, CFSocketCallBackType type, CFDataRef address, const void* data, void* info) {
+        SocketPairs* pairs = static_cast<SocketPairs*>(info);
+        char buffer[64];
+        read(CFSocketGetNative(socket), buffer, sizeof(buffer));
+
+        if (++pairs->callbacks >= pairs->expected) {
+            CFRunLoopStop(CFRunLoopGetCurrent());
+        }
+    }
+};
+
+} // namespace
+
+TEST(CFSocket, ReadCallBacksAreDeliveredAndReenabled) {
+    SocketPairs pairs;
+    ASSERT_EQ(8u, pairs.open(8));
+
+    for (size_t i = 0; i < 8; ++i) {
+        pairs.signal(i);
+    }
+    ASSERT_TRUE(pairs.waitForCallbacks(8));
+
+    // Read callbacks are re-enabled automatically, so each socket reports again.
+    for (size_t i = 0; i < 8; ++i) {
+        pairs.signal(i);
+    }
+    ASSERT_TRUE(pairs.waitForCallbacks(16));
+}
+
+TEST(CFSocket, DisabledCallBacksAreNotDelivered) {
+    SocketPairs pairs;
+    ASSERT_EQ(2u, pairs.open(2));
+
+    CFSocketDisableCallBacks(pairs.sockets[0], kCFSocketReadCallBack);
+    pairs.signal(0);
+    pairs.signal(1);
+    ASSERT_TRUE(pairs.waitForCallbacks(1));
+    EXPECT_FALSE(pairs.waitForCallbacks(2, 0.2));
+
+    CFSocketEnableCallBacks(pairs.sockets[0], kCFSocketReadCallBack);
+    EXPECT_TRUE(pairs.waitForCallbacks(2));
+}
+
+// More sockets than select() can watch, each of which has to report exactly once when it becomes readable.
+TEST(CFSocket, ManySocketsEachReportOnce) {
+    const size_t c_socketCount = 2 * FD_SETSIZE;
+
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    SocketPairs pairs;
+    size_t count = pairs.open(c_socketCount);
+    ASSERT_LT(static_cast<size_t>(FD_SETSIZE), count) << "Too few descriptors to get past what select() can watch";
+
+    for (size_t i = count; i > 0; --i) {
+        pairs.signal(i - 1);
+    }
+    ASSERT_TRUE(pairs.waitForCallbacks(count));
+    EXPECT_FALSE(pairs.waitForCallbacks(count + 1, 0.2));
+    EXPECT_EQ(count, pairs.callbacks);
+}
+
+#endif
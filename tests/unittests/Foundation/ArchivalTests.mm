@@ -373,4 +373,207 @@ TEST(Archival, NSKeyedArchiver_Static_ClassName_Inheritance) {
     EXPECT_TRUE([object isKindOfClass:[NSKAInstanceOriginalClass class]]);
     [unarchiver finishDecoding];
     [unarchiver release];
-}
\ No newline at end of file
+}
+@interface NSKANode : NSObject <NSCoding>
+@property (retain) NSString* name;
+@property (retain) NSArray* children;
+@property (assign) NSKANode* parent;
+@end
+@implementation NSKANode
+- (id)initWithCoder:(NSCoder*)coder {
+    if (self = [super init]) {
+        _name = [[coder decodeObjectForKey:@"name"] retain];
+        _children = [[coder decodeObjectForKey:@"children"] retain];
+        _parent = [coder decodeObjectForKey:@"parent"];
+    }
+    return self;
+}
+
+- (void)encodeWithCoder:(NSCoder*)coder {
+    [coder encodeObject:_name forKey:@"name"];
+    [coder encodeObject:_children forKey:@"children"];
+    [coder encodeConditionalObject:_parent forKey:@"parent"];
+}
+
+- (void)dealloc {
+    [_name release];
+    [_children release];
+    [super dealloc];
+}
+@end
+
+static NSKANode* createTestTree(NSUInteger childCount) {
+    NSKANode* root = [[NSKANode new] autorelease];
+    root.name = @"root";
+
+    NSMutableArray* children = [NSMutableArray arrayWithCapacity:childCount];
+    for (NSUInteger i = 0; i < childCount; ++i) {
+        NSKANode* child = [[NSKANode new] autorelease];
+        child.name = [NSString stringWithFormat:@"child %lu", static_cast<unsigned long>(i)];
+        child.parent = root;
+        [children addObject:child];
+    }
+    root.children = children;
+    return root;
+}
+
+TEST(Archival, NSKeyedArchiver_ObjectGraph) {
+    NSData* archive = [NSKeyedArchiver archivedDataWithRootObject:createTestTree(3)];
+    ASSERT_OBJCNE(nil, archive);
+    EXPECT_EQ(0, memcmp([archive bytes], "bplist00", 8));
+
+    NSKANode* root = [NSKeyedUnarchiver unarchiveObjectWithData:archive];
+    ASSERT_OBJCNE(nil, root);
+    EXPECT_OBJCEQ(@"root", root.name);
+    EXPECT_OBJCEQ(nil, root.parent);
+    ASSERT_EQ(3, [root.children count]);
+
+    for (NSUInteger i = 0; i < 3; ++i) {
+        NSKANode* child = root.children[i];
+        EXPECT_OBJCEQ(([NSString stringWithFormat:@"child %lu", static_cast<unsigned long>(i)]), child.name);
+        EXPECT_EQ_MSG(root, child.parent, "Shared references should decode to a single instance.");
+    }
+}
+
+TEST(Archival, NSKeyedArchiver_ConditionalObject) {
+    // A conditionally encoded object that is never encoded unconditionally decodes as nil.
+    NSKANode* orphan = [[NSKANode new] autorelease];
+    orphan.name = @"orphan";
+    orphan.parent = [[NSKANode new] autorelease];
+
+    NSKANode* decoded = [NSKeyedUnarchiver unarchiveObjectWithData:[NSKeyedArchiver archivedDataWithRootObject:orphan]];
+    ASSERT_OBJCNE(nil, decoded);
+    EXPECT_OBJCEQ(@"orphan", decoded.name);
+    EXPECT_OBJCEQ(nil, decoded.parent);
+}
+
+TEST(Archival, NSKeyedArchiver_Scalars) {
+    NSMutableData* data = [NSMutableData data];
+    NSKeyedArchiver* archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:data];
+
+    const uint8_t bytes[] = { 0xDE, 0xAD, 0xBE, 0xEF };
+    [archiver encodeBool:YES forKey:@"bool"];
+    [archiver encodeInt:-5 forKey:@"int"];
+    [archiver encodeInt64:0x123456789LL forKey:@"int64"];
+    [archiver encodeFloat:1.5f forKey:@"float"];
+    [archiver encodeDouble:-2.25 forKey:@"double"];
+    [archiver encodeBytes:bytes length:sizeof(bytes) forKey:@"bytes"];
+    [archiver encodeObject:@"été" forKey:@"unicode"];
+    [archiver finishEncoding];
+    [archiver release];
+
+    NSKeyedUnarchiver* unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:data];
+    EXPECT_TRUE([unarchiver containsValueForKey:@"bool"]);
+    EXPECT_FALSE([unarchiver containsValueForKey:@"missing"]);
+    EXPECT_TRUE([unarchiver decodeBoolForKey:@"bool"]);
+    EXPECT_EQ(-5, [unarchiver decodeIntForKey:@"int"]);
+    EXPECT_EQ(0x123456789LL, [unarchiver decodeInt64ForKey:@"int64"]);
+    EXPECT_EQ(1.5f, [unarchiver decodeFloatForKey:@"float"]);
+    EXPECT_EQ(-2.25, [unarchiver decodeDoubleForKey:@"double"]);
+    EXPECT_EQ(0, [unarchiver decodeIntForKey:@"missing"]);
+    EXPECT_OBJCEQ(@"été", [unarchiver decodeObjectForKey:@"unicode"]);
+
+    NSUInteger length = 0;
+    const uint8_t* decodedBytes = [unarchiver decodeBytesForKey:@"bytes" returnedLength:&length];
+    ASSERT_EQ(sizeof(bytes), length);
+    EXPECT_EQ(0, memcmp(bytes, decodedBytes, length));
+
+    [unarchiver finishDecoding];
+    [unarchiver release];
+}
+
+TEST(Archival, NSKeyedArchiver_XMLFormat) {
+    NSMutableData* data = [NSMutableData data];
+    NSKeyedArchiver* archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:data];
+    archiver.outputFormat = NSPropertyListXMLFormat_v1_0;
+    [archiver encodeObject:createTestTree(2) forKey:@"tree"];
+    [archiver encodeInt:7 forKey:@"seven"];
+    [archiver finishEncoding];
+    [archiver release];
+
+    EXPECT_EQ(0, memcmp([data bytes], "<?xml", 5));
+
+    NSKeyedUnarchiver* unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:data];
+    NSKANode* tree = [unarchiver decodeObjectForKey:@"tree"];
+    EXPECT_EQ(7, [unarchiver decodeIntForKey:@"seven"]);
+    ASSERT_OBJCNE(nil, tree);
+    ASSERT_EQ(2, [tree.children count]);
+    EXPECT_EQ(tree, [tree.children[1] parent]);
+    [unarchiver finishDecoding];
+    [unarchiver release];
+}
+
+TEST(Archival, NSKeyedUnarchiver_MappedFile) {
+    NSArray* cachesPaths = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSAllDomainsMask, YES);
+    ASSERT_NE(0, [cachesPaths count]);
+    [[NSFileManager defaultManager] createDirectoryAtPath:cachesPaths[0] withIntermediateDirectories:YES attributes:nil error:nil];
+    NSString* path = [cachesPaths[0] stringByAppendingPathComponent:@"tree.archive"];
+    ASSERT_TRUE([NSKeyedArchiver archiveRootObject:createTestTree(4) toFile:path]);
+
+    // The mapping has to be released before the file can be deleted.
+    @autoreleasepool {
+        NSKANode* root = [NSKeyedUnarchiver unarchiveObjectWithFile:path];
+        EXPECT_OBJCNE(nil, root);
+        EXPECT_EQ(4, [root.children count]);
+    }
+
+    EXPECT_TRUE([[NSFileManager defaultManager] removeItemAtPath:path error:nil]);
+}
+
+TEST(Archival, NSKeyedUnarchiver_SelfReferencingContainer) {
+    // { $objects = (); $top = { root = <an array containing itself> }; }
+    static const uint8_t c_archive[] = { 0x62, 0x70, 0x6C, 0x69, 0x73, 0x74, 0x30, 0x30, 0xD2, 0x01, 0x02, 0x03, 0x04, 0x58, 0x24, 0x6F,
+                                         0x62, 0x6A, 0x65, 0x63, 0x74, 0x73, 0x54, 0x24, 0x74, 0x6F, 0x70, 0xA0, 0xD1, 0x05, 0x06, 0x54,
+                                         0x72, 0x6F, 0x6F, 0x74, 0xA1, 0x06, 0x08, 0x0D, 0x16, 0x1B, 0x1C, 0x1F, 0x24, 0x00, 0x00, 0x00,
+                                         0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00,
+                                         0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x26 };
+    NSData* archive = [NSData dataWithBytes:c_archive length:sizeof(c_archive)];
+
+    EXPECT_ANY_THROW([NSKeyedUnarchiver unarchiveObjectWithData:archive]);
+
+    NSKeyedUnarchiver* unarchiver = [[[NSKeyedUnarchiver alloc] initForReadingWithData:archive] autorelease];
+    EXPECT_OBJCEQ(nil, [unarchiver decodeObjectForKey:@"root"]);
+}
+
+TEST(Archival, NSKeyedUnarchiver_DeeplyNestedArrays) {
+    id nested = @[];
+    for (int i = 0; i < 2000; ++i) {
+        nested = @[ nested ];
+    }
+
+    NSDictionary* plist =
+        @{ @"$archiver" : @"NSKeyedArchiver", @"$version" : @100000, @"$objects" : @[ @"$null" ], @"$top" : @{ @"root" : nested } };
+    NSData* archive = [NSPropertyListSerialization dataWithPropertyList:plist format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+    ASSERT_OBJCNE(nil, archive);
+
+    NSKeyedUnarchiver* unarchiver = [[[NSKeyedUnarchiver alloc] initForReadingWithData:archive] autorelease];
+    EXPECT_ANY_THROW([unarchiver decodeObjectForKey:@"root"]);
+}
+
+TEST(Archival, NSKeyedUnarchiver_ClassNameNotAString) {
+    NSDictionary* plist = @{
+        @"$archiver" : @"NSKeyedArchiver",
+        @"$version" : @100000,
+        @"$objects" : @[ @"$null", @{ @"$class" : @{ @"CF$UID" : @2 } }, @{ @"$classname" : @42, @"$classes" : @[ @"NSObject" ] } ],
+        @"$top" : @{ @"root" : @{ @"CF$UID" : @1 } }
+    };
+    NSData* archive = [NSPropertyListSerialization dataWithPropertyList:plist format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+    ASSERT_OBJCNE(nil, archive);
+
+    EXPECT_ANY_THROW([NSKeyedUnarchiver unarchiveObjectWithData:archive]);
+}
+
+TEST(Archival, NSKeyedArchiver_LargeTree) {
+    // Enough children that the archiver's object table is reallocated while the root is still being encoded.
+    const NSUInteger c_childCount = 5000;
+    NSKANode* tree = createTestTree(c_childCount);
+
+    NSData* archive = [NSKeyedArchiver archivedDataWithRootObject:tree];
+    ASSERT_OBJCNE(nil, archive);
+
+    NSKANode* decoded = [NSKeyedUnarchiver unarchiveObjectWithData:archive];
+    ASSERT_OBJCNE(nil, decoded);
+    ASSERT_EQ(c_childCount, [decoded.children count]);
+    EXPECT_EQ(decoded, [decoded.children[0] parent]);
+    EXPECT_EQ(decoded, [decoded.children[c_childCount - 1] parent]);
+}
@@ -18,6 +18,9 @@
 #import <Foundation/Foundation.h>
 #include <CoreFoundation/CFString.h>
 
+#include <string>
+#include <vector>
+
 TEST(CFStrings, ConvertEncodingToIANACharSetName) {
     CFStringRef charSetName;
 
@@ -44,4 +47,203 @@ TEST(CFStrings, ConvertIANACharSetNameToEncoding) {
     // Simple test to check kCFStringEncodingInvalidId encoding is returned for the specified unsupported character set name.
     encoding = CFStringConvertIANACharSetNameToEncoding(static_cast<CFStringRef>(@"ABC_XYZ_123"));
     ASSERT_EQ_MSG(encoding, kCFStringEncodingInvalidId, "Expected kCFStringEncodingASCII encoding for unsupported character set name!");
-}
\ No newline at end of file
+}
+
+static std::vector<UniChar> _utf16FromCodePoint(uint32_t codePoint) {
+    if (codePoint < 0x10000) {
+        return { static_cast<UniChar>(codePoint) };
+    }
+    codePoint -= 0x10000;
+    return { static_cast<UniChar>(0xD800 + (codePoint >> 10)), static_cast<UniChar>(0xDC00 + (codePoint & 0x3FF)) };
+}
+
+// Places a multi-byte character at every offset of ASCII text of every length up to a few vectors, so that the
+// vectorized and scalar paths of the converters meet it at every position.
+TEST(CFStrings, UTF8RoundTripsAtEveryOffset) {
+    const struct {
+        const char* utf8;
+        uint32_t codePoint;
+    } c_characters[] = { { "\xC3\xA9", 0xE9 }, { "\xE2\x82\xAC", 0x20AC }, { "\xF0\x9F\x98\x80", 0x1F600 } };
+
+    for (const auto& character : c_characters) {
+        std::vector<UniChar> encoded = _utf16FromCodePoint(character.codePoint);
+        for (size_t length = 0; length < 80; ++length) {
+            for (size_t offset = 0; offset <= length; ++offset) {
+                std::string utf8;
+                std::vector<UniChar> expected;
+                for (size_t i = 0; i < length; ++i) {
+                    if (i == offset) {
+                        utf8 += character.utf8;
+                        expected.insert(expected.end(), encoded.begin(), encoded.end());
+                    }
+                    utf8 += static_cast<char>('a' + (i % 26));
+                    expected.push_back('a' + (i % 26));
+                }
+
+                CFStringRef string = CFStringCreateWithBytes(nullptr, reinterpret_cast<const UInt8*>(utf8.data()), utf8.size(), kCFStringEncodingUTF8, false);
+                ASSERT_NE(nullptr, string);
+                ASSERT_EQ(static_cast<CFIndex>(expected.size()), CFStringGetLength(string));
+
+                std::vector<UniChar> characters(expected.size());
+                CFStringGetCharacters(string, CFRangeMake(0, characters.size()), characters.data());
+                EXPECT_EQ(expected, characters);
+
+                std::vector<UInt8> bytes(utf8.size() + 1);
+                CFIndex usedLength = 0;
+                EXPECT_EQ(static_cast<CFIndex>(expected.size()),
+                          CFStringGetBytes(string, CFRangeMake(0, expected.size()), kCFStringEncodingUTF8, 0, false, bytes.data(), bytes.size(), &usedLength));
+                EXPECT_EQ(utf8, std::string(reinterpret_cast<const char*>(bytes.data()), usedLength));
+
+                CFRelease(string);
+            }
+        }
+    }
+}
+
+TEST(CFStrings, MalformedUTF8IsRejected) {
+    const char* c_malformed[] = {
+        "\xC0\xAF", // overlong
+        "\xE0\x80\xAF", // overlong
+        "\xF0\x80\x80\xAF", // overlong
+        "\xED\xA0\x80", // surrogate
+        "\xF4\x90\x80\x80", // beyond U+10FFFF
+        "\xF5\x80\x80\x80", // beyond U+10FFFF
+        "\x80", // lone continuation
+        "\xE2\x82", // truncated
+        "\xE2\x82z", // truncated
+    };
+
+    std::string ascii(100, 'x');
+    for (const char* malformed : c_malformed) {
+        for (size_t offset : { 0, 1, 15, 16, 31, 33, 64, 100 }) {
+            std::string utf8 = ascii.substr(0, offset) + malformed + ascii.substr(offset);
+            CFStringRef string = CFStringCreateWithBytes(nullptr, reinterpret_cast<const UInt8*>(utf8.data()), utf8.size(), kCFStringEncodingUTF8, false);
+            EXPECT_EQ(nullptr, string);
+            if (string) {
+                CFRelease(string);
+            }
+        }
+    }
+
+    // A lone 0xA9 has always been taken as a replacement character, for compatibility.
+    std::string utf8 = ascii + "\xA9" + ascii;
+    CFStringRef string = CFStringCreateWithBytes(nullptr, reinterpret_cast<const UInt8*>(utf8.data()), utf8.size(), kCFStringEncodingUTF8, false);
+    ASSERT_NE(nullptr, string);
+    EXPECT_EQ(0xFFFD, CFStringGetCharacterAtIndex(string, ascii.size()));
+    CFRelease(string);
+}
+
+TEST(CFStrings, UTF16ReducesToASCII) {
+    std::vector<UniChar> characters;
+    for (size_t i = 0; i < 100; ++i) {
+        characters.push_back('a' + (i % 26));
+    }
+
+    CFStringRef ascii = CFStringCreateWithBytes(nullptr,
+                                                reinterpret_cast<const UInt8*>(characters.data()),
+                                                characters.size() * sizeof(UniChar),
+                                                kCFStringEncodingUTF16LE,
+                                                false);
+    ASSERT_NE(nullptr, ascii);
+    EXPECT_NE(nullptr, CFStringGetCStringPtr(ascii, kCFStringEncodingASCII));
+    EXPECT_EQ('a' + (99 % 26), CFStringGetCharacterAtIndex(ascii, 99));
+    CFRelease(ascii);
+
+    characters[70] = 0x20AC;
+    CFStringRef unicode = CFStringCreateWithBytes(nullptr,
+                                                  reinterpret_cast<const UInt8*>(characters.data()),
+                                                  characters.size() * sizeof(UniChar),
+                                                  kCFStringEncodingUTF16LE,
+                                                  false);
+    ASSERT_NE(nullptr, unicode);
+    EXPECT_EQ(nullptr, CFStringGetCStringPtr(unicode, kCFStringEncodingASCII));
+    EXPECT_EQ(0x20AC, CFStringGetCharacterAtIndex(unicode, 70));
+    CFRelease(unicode);
+}
+
+namespace {
+
+// Appends numbered lines, with a Unicode line every 97th, until the string holds at least length characters, and
+// mirrors them into expected.
+void _appendLines(CFMutableStringRef string, std::u16string& expected, size_t length) {
+    for (size_t i = 0; expected.size() < length; ++i) {
+        std::string line = "Line " + std::to_string(i) + " of a long document\n";
+        if (i % 97 == 96) {
+            const UniChar unicode[] = { 0x65E5, 0x672C, 0xD83D, 0xDE00, '\n' };
+            CFStringAppendCharacters(string, unicode, 5);
+            expected.append(reinterpret_cast<const char16_t*>(unicode), 5);
+        } else {
+            CFStringAppendCString(string, line.c_str(), kCFStringEncodingASCII);
+            expected.append(line.begin(), line.end());
+        }
+    }
+}
+
+} // namespace
+
+TEST(CFStrings, LongAppendsKeepContents) {
+    const CFIndex capacities[] = { 0, 4 << 20 };
+    for (CFIndex capacity : capacities) {
+        CFMutableStringRef string = CFStringCreateMutable(nullptr, capacity);
+        std::u16string expected;
+        _appendLines(string, expected, 3 << 20);
+        ASSERT_EQ(static_cast<CFIndex>(expected.size()), CFStringGetLength(string));
+
+        // Ranges read before flattening, straddling the 256K boundaries between pieces.
+        const CFIndex locations[] = { 0, 256 * 1024 - 3, 1 << 20, static_cast<CFIndex>(expected.size()) - 10 };
+        for (CFIndex location : locations) {
+            UniChar buffer[10];
+            CFStringGetCharacters(string, CFRangeMake(location, 10), buffer);
+            EXPECT_EQ(0, memcmp(expected.data() + location, buffer, sizeof(buffer))) << "location " << location;
+            EXPECT_EQ(expected[location], CFStringGetCharacterAtIndex(string, location));
+        }
+
+        NSString* substring = [(NSString*)string substringWithRange:NSMakeRange(2 << 20, 100)];
+        EXPECT_OBJCEQ([NSString stringWithCharacters:reinterpret_cast<const unichar*>(expected.data()) + (2 << 20) length:100], substring);
+
+        // Inserting in the middle flattens the string first.
+        CFStringInsert(string, 5, CFSTR("!"));
+        expected.insert(5, u"!");
+        CFStringAppend(string, CFSTR("The end"));
+        expected.append(u"The end");
+
+        CFStringRef copy = CFStringCreateWithCharacters(nullptr, reinterpret_cast<const UniChar*>(expected.data()), expected.size());
+        EXPECT_TRUE(CFEqual(copy, string));
+        EXPECT_EQ(CFHash(copy), CFHash(string));
+        CFRelease(copy);
+        CFRelease(string);
+    }
+}
+
+TEST(CFStrings, LongEightBitAppendsStayEightBit) {
+    NSMutableString* string = [NSMutableString string];
+    for (size_t i = 0; [string length] < (1 << 20); ++i) {
+        [string appendFormat:@"%zu,", i];
+    }
+    EXPECT_NE(nullptr, CFStringGetCStringPtr((CFStringRef)string, kCFStringEncodingASCII));
+    EXPECT_TRUE([string hasPrefix:@"0,1,2,"]);
+}
+
+TEST(CFStrings, WriteToOutputStream) {
+    NSMutableString* string = [NSMutableString string];
+    std::u16string expected;
+    _appendLines((CFMutableStringRef)string, expected, 1 << 20);
+
+    const NSStringEncoding encodings[] = { NSUTF8StringEncoding, NSUTF16LittleEndianStringEncoding };
+    for (NSStringEncoding encoding : encodings) {
+        NSOutputStream* stream = [NSOutputStream outputStreamToMemory];
+        [stream open];
+        NSError* error = nil;
+        ASSERT_TRUE([string writeToOutputStream:stream encoding:encoding error:&error]);
+        EXPECT_EQ(nil, error);
+        [stream close];
+        EXPECT_OBJCEQ([string dataUsingEncoding:encoding], [stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey]);
+    }
+
+    NSOutputStream* stream = [NSOutputStream outputStreamToMemory];
+    [stream open];
+    NSError* error = nil;
+    EXPECT_FALSE([string writeToOutputStream:stream encoding:NSASCIIStringEncoding error:&error]);
+    EXPECT_EQ(NSFileWriteInapplicableStringEncodingError, [error code]);
+    [stream close];
+}
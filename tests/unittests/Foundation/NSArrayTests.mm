@@ -17,6 +17,8 @@
 #include <TestFramework.h>
 #include <Foundation\Foundation.h>
 
+#include <cstdlib>
+
 void assertArrayContents(NSArray* array, NSObject* first, ...) {
     va_list args;
     va_start(args, first);
@@ -350,3 +352,71 @@ TEST(NSArray, MutateDuringEnumeration) {
 
     ASSERT_ANY_THROW(enumerate());
 }
+
+static NSComparator _compareFirstElements = ^NSComparisonResult(id left, id right) {
+    return [left[0] compare:right[0]];
+};
+
+// Pairs of a key, with many duplicates, and the position the pair started at.
+static NSArray* _keyedPairs(NSUInteger count) {
+    NSMutableArray* pairs = [NSMutableArray arrayWithCapacity:count];
+    srand(1);
+    for (NSUInteger i = 0; i < count; ++i) {
+        [pairs addObject:@[ @(rand() % 100), @(i) ]];
+    }
+    return pairs;
+}
+
+static void _assertSortedByKey(NSArray* pairs, BOOL stable) {
+    for (NSUInteger i = 1; i < [pairs count]; ++i) {
+        NSComparisonResult order = [pairs[i - 1][0] compare:pairs[i][0]];
+        ASSERT_NE(NSOrderedDescending, order);
+        if (stable && order == NSOrderedSame) {
+            ASSERT_EQ(NSOrderedAscending, [pairs[i - 1][1] compare:pairs[i][1]]);
+        }
+    }
+}
+
+TEST(NSArray, SortWithOptions) {
+    for (NSUInteger count : { 2, 10, 100, 1000, 20000 }) {
+        NSArray* pairs = _keyedPairs(count);
+
+        NSArray* sorted = [pairs sortedArrayUsingComparator:_compareFirstElements];
+        ASSERT_EQ(count, [sorted count]);
+        _assertSortedByKey(sorted, NO);
+
+        _assertSortedByKey([pairs sortedArrayWithOptions:NSSortStable usingComparator:_compareFirstElements], YES);
+        _assertSortedByKey([pairs sortedArrayWithOptions:NSSortConcurrent | NSSortStable usingComparator:_compareFirstElements], YES);
+
+        NSMutableArray* mutablePairs = [[pairs mutableCopy] autorelease];
+        [mutablePairs sortWithOptions:NSSortStable usingComparator:_compareFirstElements];
+        _assertSortedByKey(mutablePairs, YES);
+    }
+}
+
+static CFComparisonResult _compareFirstElementsFunction(const void* left, const void* right, void* context) {
+    return static_cast<CFComparisonResult>(_compareFirstElements((id)left, (id)right));
+}
+
+// CFArraySortValues sorts with CFQSortArray, which has always been stable; callers depend on that.
+TEST(NSArray, CFArraySortValuesIsStable) {
+    for (NSUInteger count : { 2, 10, 100, 1000, 20000 }) {
+        NSMutableArray* pairs = [[_keyedPairs(count) mutableCopy] autorelease];
+        CFArraySortValues((CFMutableArrayRef)pairs, CFRangeMake(0, count), _compareFirstElementsFunction, nullptr);
+        ASSERT_EQ(count, [pairs count]);
+        _assertSortedByKey(pairs, YES);
+    }
+}
+
+static NSInteger _compareIntegers(id left, id right, void* context) {
+    return [left compare:right];
+}
+
+TEST(NSArray, SortSubrangeAndUsingSelector) {
+    NSMutableArray* array = [NSMutableArray arrayWithArray:@[ @9, @8, @7, @6, @5, @4, @3, @2, @1, @0 ]];
+    [array sortUsingFunction:_compareIntegers context:nullptr range:NSMakeRange(2, 5)];
+    ASSERT_OBJCEQ((@[ @9, @8, @3, @4, @5, @6, @7, @2, @1, @0 ]), array);
+
+    [array sortUsingSelector:@selector(compare:)];
+    ASSERT_OBJCEQ((@[ @0, @1, @2, @3, @4, @5, @6, @7, @8, @9 ]), array);
+}
@@ -0,0 +1,108 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include <TestFramework.h>
+#import <Foundation/Foundation.h>
+#import "NSAutoreleasePool+Internal.h"
+
+static long _arenaCounter(NSString* name) {
+    return [[[NSAutoreleasePool _arenaStatistics] objectForKey:name] longValue];
+}
+
+TEST(NSAutoreleasePool, ArenaPoolAllocatesFromArena) {
+    long allocations = _arenaCounter(@"allocations");
+    long deallocations = _arenaCounter(@"deallocations");
+    long resets = _arenaCounter(@"resets");
+    CFAllocatorRef previousDefault = CFAllocatorGetDefault();
+
+    NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] _initWithArena];
+    CFAllocatorRef arena = [pool _arena];
+    ASSERT_NE(nullptr, arena);
+
+    // Only allocations that are passed the arena use it.
+    EXPECT_EQ(previousDefault, CFAllocatorGetDefault());
+    CFStringRef defaultString = CFStringCreateWithFormat(nullptr, nullptr, CFSTR("%d pears"), 2);
+    EXPECT_NE(arena, CFGetAllocator(defaultString));
+    CFRelease(defaultString);
+
+    CFStringRef string = CFStringCreateWithFormat(arena, nullptr, CFSTR("%d apples and %d oranges"), 3, 4);
+    EXPECT_EQ(arena, CFGetAllocator(string));
+    EXPECT_OBJCEQ(@"3 apples and 4 oranges", (NSString*)string);
+    CFRelease(string);
+
+    const UInt8 bytes[] = { 1, 2, 3, 4 };
+    CFDataRef data = CFDataCreate(arena, bytes, sizeof(bytes));
+    EXPECT_EQ(arena, CFGetAllocator(data));
+    CFRelease(data);
+
+    EXPECT_LT(allocations, _arenaCounter(@"allocations"));
+    EXPECT_LT(deallocations, _arenaCounter(@"deallocations"));
+    [pool drain];
+
+    EXPECT_EQ(previousDefault, CFAllocatorGetDefault());
+    EXPECT_EQ(resets + 1, _arenaCounter(@"resets"));
+}
+
+TEST(NSAutoreleasePool, PoolsWithoutArenaHaveNone) {
+    NSAutoreleasePool* pool = [NSAutoreleasePool new];
+    EXPECT_EQ(nullptr, [pool _arena]);
+    [pool drain];
+}
+
+TEST(NSAutoreleasePool, ArenaObjectsCanOutliveTheirPool) {
+    long retainedScopes = _arenaCounter(@"retainedScopes");
+
+    NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] _initWithArena];
+    CFAllocatorRef arena = [pool _arena];
+    CFMutableStringRef string = CFStringCreateMutable(arena, 0);
+    CFStringAppend(string, CFSTR("escaped"));
+    [(NSString*)CFStringCreateCopy(arena, string) autorelease];
+    [pool drain];
+
+    EXPECT_EQ(retainedScopes + 1, _arenaCounter(@"retainedScopes"));
+
+    // The arena is no longer in scope, so growing the string moves it to the system allocator.
+    for (int i = 0; i < 100; ++i) {
+        CFStringAppend(string, CFSTR(" and grown"));
+    }
+    EXPECT_TRUE([(NSString*)string hasPrefix:@"escaped and grown"]);
+    EXPECT_EQ(7 + 100 * 10, CFStringGetLength(string));
+
+    // The string still owns its arena, so the next pool gets a new one.
+    pool = [[NSAutoreleasePool alloc] _initWithArena];
+    CFStringRef other = CFStringCreateWithFormat([pool _arena], nullptr, CFSTR("%d"), 5);
+    EXPECT_NE(CFGetAllocator(string), CFGetAllocator(other));
+    CFRelease(other);
+    [pool drain];
+
+    CFRelease(string);
+}
+
+TEST(NSAutoreleasePool, NestedArenaPoolsShareTheOutermostArena) {
+    long resets = _arenaCounter(@"resets");
+
+    NSAutoreleasePool* outer = [[NSAutoreleasePool alloc] _initWithArena];
+    CFAllocatorRef arena = [outer _arena];
+
+    NSAutoreleasePool* inner = [[NSAutoreleasePool alloc] _initWithArena];
+    EXPECT_EQ(arena, [inner _arena]);
+    [inner drain];
+
+    EXPECT_EQ(resets, _arenaCounter(@"resets"));
+    [outer drain];
+
+    EXPECT_EQ(resets + 1, _arenaCounter(@"resets"));
+}
@@ -113,4 +113,40 @@ TEST(NSDateFormatter, NSDateFormatter) {
     NSString* strMyDate = [dateFormatter stringFromDate:date];
 
     ASSERT_OBJCEQ(@"18-03-2009", strMyDate);
-}
\ No newline at end of file
+}
+
+// Formatters with the same locale, style and time zone start from the same cached ICU formatter, and must not see each
+// other's changes.
+TEST(NSDateFormatter, FormattersSharingStylesAreIndependent) {
+    NSLocale* locale = [NSLocale localeWithLocaleIdentifier:@"en_GB"];
+    NSTimeZone* timeZone = [NSTimeZone timeZoneWithName:@"GMT"];
+    NSDate* date = [NSDate dateWithTimeIntervalSince1970:0];
+
+    NSMutableArray* formatters = [NSMutableArray array];
+    for (int i = 0; i < 3; i++) {
+        NSDateFormatter* formatter = [[NSDateFormatter new] autorelease];
+        [formatter setLocale:locale];
+        [formatter setTimeZone:timeZone];
+        [formatter setDateStyle:NSDateFormatterMediumStyle];
+        [formatter setTimeStyle:NSDateFormatterMediumStyle];
+        [formatters addObject:formatter];
+    }
+
+    [formatters[1] setDateFormat:@"dd-MM-yyyy"];
+    [formatters[2] setTimeZone:[NSTimeZone timeZoneWithName:@"America/Los_Angeles"]];
+
+    EXPECT_OBJCEQ(@"1 Jan 1970, 00:00:00", [formatters[0] stringFromDate:date]);
+    EXPECT_OBJCEQ(@"01-01-1970", [formatters[1] stringFromDate:date]);
+    EXPECT_OBJCEQ(@"31 Dec 1969, 16:00:00", [formatters[2] stringFromDate:date]);
+
+    NSNumberFormatter* first = [[NSNumberFormatter new] autorelease];
+    NSNumberFormatter* second = [[NSNumberFormatter new] autorelease];
+    [first setLocale:locale];
+    [second setLocale:locale];
+    [first setNumberStyle:NSNumberFormatterDecimalStyle];
+    [second setNumberStyle:NSNumberFormatterDecimalStyle];
+    [first setMinimumFractionDigits:2];
+
+    EXPECT_OBJCEQ(@"1,234.50", [first stringFromNumber:@1234.5]);
+    EXPECT_OBJCEQ(@"1,234.5", [second stringFromNumber:@1234.5]);
+}
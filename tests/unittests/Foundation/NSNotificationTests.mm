@@ -16,6 +16,12 @@
 
 #include <TestFramework.h>
 #import <Foundation/Foundation.h>
+#import "NSNotificationQueueInternal.h"
+#import <objc/runtime.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
 @interface TestObjectA : NSObject
 @end
 
@@ -30,3 +36,254 @@
 TEST(NSNotificationCenter, PostNotificationFromDealloc) {
     TestObjectA* obj = [[TestObjectA new] autorelease];
 }
+
+@interface TestNotificationCounter : NSObject {
+@public
+    std::atomic<int> count;
+}
+- (void)receive:(NSNotification*)notification;
+@end
+
+@implementation TestNotificationCounter
+- (void)receive:(NSNotification*)notification {
+    ++count;
+}
+@end
+
+TEST(NSNotificationCenter, FiltersBySender) {
+    NSNotificationCenter* center = [[NSNotificationCenter new] autorelease];
+    TestNotificationCounter* anySender = [[TestNotificationCounter new] autorelease];
+    TestNotificationCounter* oneSender = [[TestNotificationCounter new] autorelease];
+    TestNotificationCounter* anyName = [[TestNotificationCounter new] autorelease];
+    NSObject* sender = [[NSObject new] autorelease];
+    NSObject* otherSender = [[NSObject new] autorelease];
+
+    [center addObserver:anySender selector:@selector(receive:) name:@"Location" object:nil];
+    [center addObserver:oneSender selector:@selector(receive:) name:@"Location" object:sender];
+    [center addObserver:anyName selector:@selector(receive:) name:nil object:sender];
+
+    [center postNotificationName:@"Location" object:sender];
+    [center postNotificationName:@"Location" object:otherSender];
+    [center postNotificationName:@"Network" object:sender];
+    [center postNotificationName:[NSMutableString stringWithString:@"Location"] object:nil];
+
+    EXPECT_EQ(3, anySender->count.load());
+    EXPECT_EQ(1, oneSender->count.load());
+    EXPECT_EQ(2, anyName->count.load());
+}
+
+@interface TestNotificationDoubleCounter : TestNotificationCounter
+@end
+
+@implementation TestNotificationDoubleCounter
+- (void)receive:(NSNotification*)notification {
+    count += 2;
+}
+@end
+
+TEST(NSNotificationCenter, FollowsObserverClassChanges) {
+    NSNotificationCenter* center = [[NSNotificationCenter new] autorelease];
+    TestNotificationCounter* observer = [[TestNotificationCounter new] autorelease];
+
+    [center addObserver:observer selector:@selector(receive:) name:@"Name" object:nil];
+    [center postNotificationName:@"Name" object:nil];
+    EXPECT_EQ(1, observer->count.load());
+
+    // As KVO does when an observed object is first observed.
+    object_setClass(observer, [TestNotificationDoubleCounter class]);
+    [center postNotificationName:@"Name" object:nil];
+    EXPECT_EQ(3, observer->count.load());
+
+    object_setClass(observer, [TestNotificationCounter class]);
+}
+
+TEST(NSNotificationCenter, DeliversInRegistrationOrder) {
+    NSNotificationCenter* center = [[NSNotificationCenter new] autorelease];
+    NSObject* sender = [[NSObject new] autorelease];
+    NSMutableArray* order = [NSMutableArray array];
+
+    [center addObserverForName:@"Name" object:sender queue:nil usingBlock:^(NSNotification*) { [order addObject:@1]; }];
+    [center addObserverForName:nil object:nil queue:nil usingBlock:^(NSNotification*) { [order addObject:@2]; }];
+    [center addObserverForName:@"Name" object:nil queue:nil usingBlock:^(NSNotification*) { [order addObject:@3]; }];
+
+    [center postNotificationName:@"Name" object:sender];
+
+    NSArray* expected = @[ @1, @2, @3 ];
+    EXPECT_OBJCEQ(expected, order);
+}
+
+TEST(NSNotificationCenter, RemoveObserver) {
+    NSNotificationCenter* center = [[NSNotificationCenter new] autorelease];
+    TestNotificationCounter* counter = [[TestNotificationCounter new] autorelease];
+    NSObject* sender = [[NSObject new] autorelease];
+
+    [center addObserver:counter selector:@selector(receive:) name:@"A" object:nil];
+    [center addObserver:counter selector:@selector(receive:) name:@"B" object:sender];
+
+    [center removeObserver:counter name:@"A" object:nil];
+    [center postNotificationName:@"A" object:nil];
+    [center postNotificationName:@"B" object:sender];
+    EXPECT_EQ(1, counter->count.load());
+
+    [center removeObserver:counter];
+    [center postNotificationName:@"B" object:sender];
+    EXPECT_EQ(1, counter->count.load());
+}
+
+TEST(NSNotificationCenter, RemoveObserverDuringPost) {
+    NSNotificationCenter* center = [[NSNotificationCenter new] autorelease];
+    __block NSNotificationCenter* blockCenter = center;
+    __block id second = nil;
+    __block int secondCalls = 0;
+
+    id first = [center addObserverForName:@"Name"
+                                   object:nil
+                                    queue:nil
+                               usingBlock:^(NSNotification*) { [blockCenter removeObserver:second]; }];
+    second = [center addObserverForName:@"Name" object:nil queue:nil usingBlock:^(NSNotification*) { ++secondCalls; }];
+
+    [center postNotificationName:@"Name" object:nil];
+    EXPECT_EQ(0, secondCalls);
+
+    [center removeObserver:first];
+}
+
+TEST(NSNotificationCenter, ConcurrentPostAndRegister) {
+    NSNotificationCenter* center = [[NSNotificationCenter new] autorelease];
+    TestNotificationCounter* counter = [[TestNotificationCounter new] autorelease];
+    [center addObserver:counter selector:@selector(receive:) name:@"Name" object:nil];
+
+    const int postsPerThread = 1000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([center]() {
+            @autoreleasepool {
+                for (int j = 0; j < postsPerThread; j++) {
+                    [center postNotificationName:@"Name" object:nil];
+                }
+            }
+        });
+    }
+
+    threads.emplace_back([center]() {
+        @autoreleasepool {
+            for (int j = 0; j < postsPerThread; j++) {
+                TestNotificationCounter* transient = [TestNotificationCounter new];
+                [center addObserver:transient selector:@selector(receive:) name:@"Name" object:nil];
+                [center removeObserver:transient];
+                [transient release];
+            }
+        }
+    });
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(4 * postsPerThread, counter->count.load());
+}
+
+static void _runLoopOnce() {
+    [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+}
+
+TEST(NSNotificationQueue, CoalescesASAPNotifications) {
+    NSNotificationCenter* center = [[NSNotificationCenter new] autorelease];
+    NSNotificationQueue* queue = [[[NSNotificationQueue alloc] initWithNotificationCenter:center] autorelease];
+    TestNotificationCounter* byName = [[TestNotificationCounter new] autorelease];
+    [center addObserver:byName selector:@selector(receive:) name:@"Status" object:nil];
+
+    NSObject* sender = [[NSObject new] autorelease];
+    for (int i = 0; i < 100; i++) {
+        [queue enqueueNotification:[NSNotification notificationWithName:@"Status" object:sender]
+                      postingStyle:NSPostASAP
+                      coalesceMask:NSNotificationCoalescingOnName
+                          forModes:nil];
+    }
+    EXPECT_EQ(0, byName->count.load());
+
+    [queue asapProcessMode:NSDefaultRunLoopMode];
+    EXPECT_EQ(1, byName->count.load());
+
+    [queue asapProcessMode:NSDefaultRunLoopMode];
+    EXPECT_EQ(1, byName->count.load());
+}
+
+TEST(NSNotificationQueue, CoalescesOnSender) {
+    NSNotificationCenter* center = [[NSNotificationCenter new] autorelease];
+    NSNotificationQueue* queue = [[[NSNotificationQueue alloc] initWithNotificationCenter:center] autorelease];
+    TestNotificationCounter* counter = [[TestNotificationCounter new] autorelease];
+    [center addObserver:counter selector:@selector(receive:) name:nil object:nil];
+
+    NSObject* first = [[NSObject new] autorelease];
+    NSObject* second = [[NSObject new] autorelease];
+    for (int i = 0; i < 10; i++) {
+        [queue enqueueNotification:[NSNotification notificationWithName:@"A" object:first]
+                      postingStyle:NSPostWhenIdle
+                      coalesceMask:NSNotificationCoalescingOnSender
+                          forModes:nil];
+        [queue enqueueNotification:[NSNotification notificationWithName:@"B" object:second]
+                      postingStyle:NSPostWhenIdle
+                      coalesceMask:NSNotificationCoalescingOnSender
+                          forModes:nil];
+    }
+
+    EXPECT_TRUE([queue hasIdleNotificationsInMode:NSDefaultRunLoopMode]);
+    [queue idleProcessMode:NSDefaultRunLoopMode];
+    EXPECT_EQ(2, counter->count.load());
+    EXPECT_FALSE([queue hasIdleNotificationsInMode:NSDefaultRunLoopMode]);
+}
+
+TEST(NSNotificationQueue, NoCoalescingAndModes) {
+    NSNotificationCenter* center = [[NSNotificationCenter new] autorelease];
+    NSNotificationQueue* queue = [[[NSNotificationQueue alloc] initWithNotificationCenter:center] autorelease];
+    TestNotificationCounter* counter = [[TestNotificationCounter new] autorelease];
+    [center addObserver:counter selector:@selector(receive:) name:@"Name" object:nil];
+
+    NSNotification* notification = [NSNotification notificationWithName:@"Name" object:nil];
+    [queue enqueueNotification:notification postingStyle:NSPostASAP coalesceMask:NSNotificationNoCoalescing forModes:nil];
+    [queue enqueueNotification:notification postingStyle:NSPostASAP coalesceMask:NSNotificationNoCoalescing forModes:nil];
+    [queue enqueueNotification:notification postingStyle:NSPostASAP coalesceMask:NSNotificationNoCoalescing forModes:@[ @"OtherMode" ]];
+
+    [queue asapProcessMode:NSDefaultRunLoopMode];
+    EXPECT_EQ(2, counter->count.load());
+
+    [queue asapProcessMode:@"OtherMode"];
+    EXPECT_EQ(3, counter->count.load());
+}
+
+TEST(NSNotificationQueue, PostNowDropsQueuedMatches) {
+    NSNotificationCenter* center = [[NSNotificationCenter new] autorelease];
+    NSNotificationQueue* queue = [[[NSNotificationQueue alloc] initWithNotificationCenter:center] autorelease];
+    TestNotificationCounter* counter = [[TestNotificationCounter new] autorelease];
+    [center addObserver:counter selector:@selector(receive:) name:@"Name" object:nil];
+
+    NSNotification* notification = [NSNotification notificationWithName:@"Name" object:nil];
+    [queue enqueueNotification:notification postingStyle:NSPostWhenIdle];
+    [queue enqueueNotification:notification postingStyle:NSPostNow];
+    EXPECT_EQ(1, counter->count.load());
+
+    [queue idleProcessMode:NSDefaultRunLoopMode];
+    EXPECT_EQ(1, counter->count.load());
+}
+
+TEST(NSNotificationQueue, DefaultQueueDeliversFromRunLoop) {
+    TestNotificationCounter* counter = [[TestNotificationCounter new] autorelease];
+    [[NSNotificationCenter defaultCenter] addObserver:counter selector:@selector(receive:) name:@"NSNotificationQueueTest" object:nil];
+
+    NSNotification* notification = [NSNotification notificationWithName:@"NSNotificationQueueTest" object:nil];
+    for (int i = 0; i < 10; i++) {
+        [[NSNotificationQueue defaultQueue] enqueueNotification:notification postingStyle:NSPostASAP];
+        [[NSNotificationQueue defaultQueue] enqueueNotification:notification postingStyle:NSPostWhenIdle];
+    }
+
+    // Each enqueue coalesces with everything already queued under the same name and sender, whatever its posting style.
+    _runLoopOnce();
+    EXPECT_EQ(1, counter->count.load());
+
+    [[NSNotificationQueue defaultQueue] enqueueNotification:notification postingStyle:NSPostWhenIdle];
+    _runLoopOnce();
+    EXPECT_EQ(2, counter->count.load());
+
+    [[NSNotificationCenter defaultCenter] removeObserver:counter];
+}
@@ -38,4 +38,144 @@ TEST(NSPropertyListSerialization, PropertyListForDate) {
 
     ASSERT_NO_THROW({ plistDict = [xml propertyList]; });
     ASSERT_OBJCEQ(date, plistDict[@"Date Modified"]);
-}
\ No newline at end of file
+}
+
+// A binary property list large enough to be read lazily: a dictionary of count region entries, each holding a name,
+// a code, a data blob and an array of neighbour indexes.
+static NSData* _regionTable(NSUInteger count) {
+    NSMutableDictionary* regions = [NSMutableDictionary dictionary];
+    for (NSUInteger i = 0; i < count; ++i) {
+        NSDictionary* region = @{
+            @"name" : [NSString stringWithFormat:@"Région %lu", static_cast<unsigned long>(i)],
+            @"code" : @(i),
+            @"blob" : [NSData dataWithBytes:&i length:sizeof(i)],
+            @"neighbours" : @[ @((i + 1) % count), @((i + 7) % count) ],
+        };
+        regions[[NSString stringWithFormat:@"region-%lu", static_cast<unsigned long>(i)]] = region;
+    }
+    regions[@"clé"] = @"unicode key";
+
+    return [NSPropertyListSerialization dataWithPropertyList:regions format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+}
+
+TEST(NSPropertyListSerialization, LargeBinaryPropertyListsMatchEagerlyReadOnes) {
+    NSData* data = _regionTable(2000);
+    ASSERT_LT(64u * 1024u, [data length]);
+
+    NSPropertyListFormat format = NSPropertyListXMLFormat_v1_0;
+    NSDictionary* lazy = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:&format error:nil];
+    NSDictionary* eager =
+        [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListMutableContainers format:nil error:nil];
+    ASSERT_NE(nil, lazy);
+    EXPECT_EQ(NSPropertyListBinaryFormat_v1_0, format);
+
+    // Individual lookups, before anything else has been decoded.
+    EXPECT_OBJCEQ(@"Région 1234", lazy[@"region-1234"][@"name"]);
+    EXPECT_OBJCEQ(@1235, lazy[@"region-1234"][@"neighbours"][0]);
+    EXPECT_OBJCEQ(@"unicode key", lazy[@"clé"]);
+    EXPECT_EQ(nil, lazy[@"region-2000"]);
+    EXPECT_EQ(nil, lazy[@42]);
+    EXPECT_OBJCEQ(@"Région 5", static_cast<id>(CFDictionaryGetValue((CFDictionaryRef)lazy, @"region-5"))[@"name"]);
+    EXPECT_EQ(2, CFArrayGetCount((CFArrayRef)lazy[@"region-5"][@"neighbours"]));
+    EXPECT_EQ(1, CFDictionaryGetCountOfKey((CFDictionaryRef)lazy, @"region-7"));
+    EXPECT_EQ(0, CFDictionaryGetCountOfKey((CFDictionaryRef)lazy, @"region-2000"));
+
+    EXPECT_EQ([eager count], [lazy count]);
+    EXPECT_OBJCEQ(eager, lazy);
+
+    NSUInteger enumerated = 0;
+    for (NSString* key in lazy) {
+        EXPECT_OBJCEQ(eager[key], lazy[key]);
+        ++enumerated;
+    }
+    EXPECT_EQ([eager count], enumerated);
+
+    // Mutable containers were asked for, and must not be lazy.
+    EXPECT_NO_THROW([static_cast<NSMutableDictionary*>(eager) setObject:@"value" forKey:@"key"]);
+}
+
+TEST(NSPropertyListSerialization, LargeBinaryPropertyListsReadFromFiles) {
+    NSData* data = _regionTable(2000);
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"LargeBinaryPropertyList.plist"];
+    ASSERT_TRUE([data writeToFile:path atomically:NO]);
+
+    // The immutable dictionary maps the file, which cannot be removed until the dictionary has been freed.
+    @autoreleasepool {
+        NSDictionary* dictionary = [[NSDictionary alloc] initWithContentsOfFile:path];
+        NSMutableDictionary* mutableDictionary = [[NSMutableDictionary alloc] initWithContentsOfFile:path];
+
+        EXPECT_OBJCEQ(@"Région 1999", dictionary[@"region-1999"][@"name"]);
+        EXPECT_OBJCEQ(dictionary, mutableDictionary);
+
+        [mutableDictionary removeObjectForKey:@"region-1999"];
+        EXPECT_EQ([dictionary count] - 1, [mutableDictionary count]);
+
+        [dictionary release];
+        [mutableDictionary release];
+    }
+
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
+TEST(NSPropertyListSerialization, SmallPropertyListFilesAreReadIntoMemory) {
+    NSData* data = [NSPropertyListSerialization dataWithPropertyList:@{ @"key" : @"value" }
+                                                              format:NSPropertyListBinaryFormat_v1_0
+                                                             options:0
+                                                               error:nil];
+    NSString* path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"SmallBinaryPropertyList.plist"];
+    ASSERT_TRUE([data writeToFile:path atomically:NO]);
+
+    // Nothing keeps the file mapped, so it can be removed while the dictionary is still alive.
+    NSDictionary* dictionary = [[[NSDictionary alloc] initWithContentsOfFile:path] autorelease];
+    EXPECT_TRUE([[NSFileManager defaultManager] removeItemAtPath:path error:nil]);
+    EXPECT_OBJCEQ(@"value", dictionary[@"key"]);
+}
+
+TEST(NSPropertyListSerialization, LargeBinaryPropertyListArraysContainObjects) {
+    NSMutableArray* names = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 10000; ++i) {
+        [names addObject:[NSString stringWithFormat:@"name-%lu", static_cast<unsigned long>(i)]];
+    }
+    [names addObject:@"nom-é"];
+    [names addObject:@42];
+
+    NSData* data = [NSPropertyListSerialization dataWithPropertyList:@[ names ] format:NSPropertyListBinaryFormat_v1_0 options:0 error:nil];
+    ASSERT_LT(64u * 1024u, [data length]);
+
+    NSArray* lazy = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:nil error:nil][0];
+    EXPECT_TRUE([lazy containsObject:@"name-9999"]);
+    EXPECT_TRUE([lazy containsObject:@"nom-é"]);
+    EXPECT_TRUE([lazy containsObject:@42]);
+    EXPECT_FALSE([lazy containsObject:@"name-10000"]);
+    EXPECT_FALSE([lazy containsObject:@43]);
+
+    // Elements that were decoded already are compared as objects.
+    EXPECT_OBJCEQ(@"name-5", lazy[5]);
+    EXPECT_TRUE([lazy containsObject:@"name-5"]);
+}
+
+// Reads the big-endian integer of size bytes at bytes.
+static uint64_t _loadBigEndian(const uint8_t* bytes, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+TEST(NSPropertyListSerialization, DamagedLargeBinaryPropertyListsFailToRead) {
+    NSMutableData* data = [[_regionTable(2000) mutableCopy] autorelease];
+    uint8_t* bytes = static_cast<uint8_t*>([data mutableBytes]);
+
+    // Points the offset of one object deep inside the property list past the end of the object data.
+    const uint8_t* trailer = bytes + [data length] - 32;
+    size_t offsetSize = trailer[6];
+    uint64_t objectCount = _loadBigEndian(trailer + 8, 8);
+    uint64_t topObject = _loadBigEndian(trailer + 16, 8);
+    uint64_t offsetTable = _loadBigEndian(trailer + 24, 8);
+    uint64_t damaged = (topObject == objectCount - 1) ? objectCount - 2 : objectCount - 1;
+    memset(bytes + offsetTable + damaged * offsetSize, 0xFF, offsetSize);
+
+    EXPECT_EQ(nil, [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListMutableContainers format:nil error:nil]);
+    EXPECT_EQ(nil, [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:nil error:nil]);
+}
@@ -0,0 +1,177 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+#include <TestFramework.h>
+#import <Foundation/Foundation.h>
+
+#include <algorithm>
+#include <errno.h>
+
+@interface NSXMLParserTestDelegate : NSObject <NSXMLParserDelegate>
+@property (nonatomic) NSUInteger startCount;
+@property (nonatomic) NSUInteger endCount;
+@property (nonatomic) NSUInteger abortAfter;
+@property (nonatomic, retain) NSString* firstName;
+@property (nonatomic) BOOL namesInterned;
+@property (nonatomic, retain) NSMutableString* text;
+@property (nonatomic, retain) NSDictionary* lastAttributes;
+@end
+
+@implementation NSXMLParserTestDelegate
+- (instancetype)init {
+    if (self = [super init]) {
+        _namesInterned = YES;
+        _text = [NSMutableString new];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [_firstName release];
+    [_text release];
+    [_lastAttributes release];
+    [super dealloc];
+}
+
+- (void)parser:(NSXMLParser*)parser
+    didStartElement:(NSString*)elementName
+       namespaceURI:(NSString*)namespaceURI
+      qualifiedName:(NSString*)qualifiedName
+         attributes:(NSDictionary*)attributeDict {
+    if ([elementName isEqualToString:@"trkpt"]) {
+        if (_firstName == nil) {
+            self.firstName = elementName;
+        } else if (_firstName != elementName) {
+            _namesInterned = NO;
+        }
+        self.lastAttributes = attributeDict;
+    }
+
+    if (++_startCount == _abortAfter) {
+        [parser abortParsing];
+    }
+}
+
+- (void)parser:(NSXMLParser*)parser
+ didEndElement:(NSString*)elementName
+  namespaceURI:(NSString*)namespaceURI
+ qualifiedName:(NSString*)qName {
+    ++_endCount;
+}
+
+- (void)parser:(NSXMLParser*)parser foundCharacters:(NSString*)string {
+    [_text appendString:string];
+}
+@end
+
+// Hands out its data in one read and then fails, as a file or socket might part way through a document.
+@interface NSXMLParserFailingStream : NSInputStream
+@property (nonatomic, retain) NSData* data;
+@end
+
+@implementation NSXMLParserFailingStream
+- (void)dealloc {
+    [_data release];
+    [super dealloc];
+}
+
+- (void)open {
+}
+
+- (void)close {
+}
+
+- (NSInteger)read:(uint8_t*)buffer maxLength:(NSUInteger)length {
+    if (_data == nil) {
+        return -1;
+    }
+
+    NSUInteger count = std::min<NSUInteger>(length, [_data length]);
+    memcpy(buffer, [_data bytes], count);
+    self.data = nil;
+    return count;
+}
+
+- (NSError*)streamError {
+    return _data == nil ? [NSError errorWithDomain:NSPOSIXErrorDomain code:EIO userInfo:nil] : nil;
+}
+@end
+
+static NSData* _makeTrack(NSUInteger points) {
+    NSMutableString* xml = [NSMutableString stringWithString:@"<?xml version=\"1.0\" encoding=\"UTF-8\"?><gpx><trk>"];
+    for (NSUInteger i = 0; i < points; ++i) {
+        [xml appendFormat:@"<trkpt lat=\"%u\" lon=\"-%u\">x</trkpt>", (unsigned)i, (unsigned)i];
+    }
+    [xml appendString:@"</trk></gpx>"];
+    return [xml dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+TEST(NSXMLParser, ParseData) {
+    NSXMLParserTestDelegate* delegate = [[NSXMLParserTestDelegate new] autorelease];
+    NSXMLParser* parser = [[[NSXMLParser alloc] initWithData:_makeTrack(3)] autorelease];
+    parser.delegate = delegate;
+
+    ASSERT_TRUE([parser parse]);
+    EXPECT_EQ(5, delegate.startCount);
+    EXPECT_EQ(5, delegate.endCount);
+    EXPECT_OBJCEQ(@"xxx", delegate.text);
+    EXPECT_OBJCEQ(@"2", [delegate.lastAttributes objectForKey:@"lat"]);
+    EXPECT_OBJCEQ(@"-2", [delegate.lastAttributes objectForKey:@"lon"]);
+}
+
+TEST(NSXMLParser, ParseStreamAcrossChunks) {
+    // Large enough that the document is fed to the parser in several chunks.
+    const NSUInteger points = 20000;
+    NSXMLParserTestDelegate* delegate = [[NSXMLParserTestDelegate new] autorelease];
+    NSInputStream* stream = [NSInputStream inputStreamWithData:_makeTrack(points)];
+    NSXMLParser* parser = [[[NSXMLParser alloc] initWithStream:stream] autorelease];
+    parser.delegate = delegate;
+
+    ASSERT_TRUE([parser parse]);
+    EXPECT_EQ(points + 2, delegate.startCount);
+    EXPECT_EQ(points + 2, delegate.endCount);
+    EXPECT_EQ(points, [delegate.text length]);
+    EXPECT_TRUE(delegate.namesInterned);
+}
+
+TEST(NSXMLParser, ParseMalformedStream) {
+    NSData* data = [@"<gpx><trk></gpx>" dataUsingEncoding:NSUTF8StringEncoding];
+    NSXMLParser* parser = [[[NSXMLParser alloc] initWithStream:[NSInputStream inputStreamWithData:data]] autorelease];
+
+    EXPECT_FALSE([parser parse]);
+}
+
+TEST(NSXMLParser, ParseFailingStream) {
+    // The first chunk is a whole document, so the parse only fails if the read error isn't mistaken for its end.
+    NSXMLParserFailingStream* stream = [[NSXMLParserFailingStream new] autorelease];
+    stream.data = _makeTrack(3);
+    NSXMLParser* parser = [[[NSXMLParser alloc] initWithStream:stream] autorelease];
+
+    EXPECT_FALSE([parser parse]);
+    ASSERT_OBJCNE(nil, parser.parserError);
+    EXPECT_OBJCEQ(NSPOSIXErrorDomain, parser.parserError.domain);
+    EXPECT_EQ(EIO, parser.parserError.code);
+}
+
+TEST(NSXMLParser, AbortParsing) {
+    NSXMLParserTestDelegate* delegate = [[NSXMLParserTestDelegate new] autorelease];
+    delegate.abortAfter = 10;
+    NSXMLParser* parser = [[[NSXMLParser alloc] initWithStream:[NSInputStream inputStreamWithData:_makeTrack(1000)]] autorelease];
+    parser.delegate = delegate;
+
+    EXPECT_FALSE([parser parse]);
+    EXPECT_EQ(10, delegate.startCount);
+}
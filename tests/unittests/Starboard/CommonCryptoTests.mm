@@ -33,11 +33,11 @@ static const char longKey[] =
 
 /* CommonDigest Tests */
 
-void _sanity(int (*init)(CC_Digest_State**),
-             int (*update)(CC_Digest_State** ctx, const void* data, CC_LONG len),
-             int (*final)(unsigned char* digest, CC_Digest_State** ctx),
+void _sanity(int (*init)(CC_Digest_State*),
+             int (*update)(CC_Digest_State* ctx, const void* data, CC_LONG len),
+             int (*final)(unsigned char* digest, CC_Digest_State* ctx),
              unsigned digestLength) {
-    CC_Digest_State* ctx;
+    CC_Digest_State ctx;
     std::vector<unsigned char> digest(digestLength);
 
     ASSERT_EQ_MSG(init(&ctx), 1, "FAILED: init returned incorrect value");
@@ -46,11 +46,11 @@ void _sanity(int (*init)(CC_Digest_State**),
     logBytes(singleLine, digest.data(), digestLength);
 }
 
-void _sameDataYieldsSameDigest(int (*init)(CC_Digest_State**),
-                               int (*update)(CC_Digest_State** ctx, const void* data, CC_LONG len),
-                               int (*final)(unsigned char* digest, CC_Digest_State** ctx),
+void _sameDataYieldsSameDigest(int (*init)(CC_Digest_State*),
+                               int (*update)(CC_Digest_State* ctx, const void* data, CC_LONG len),
+                               int (*final)(unsigned char* digest, CC_Digest_State* ctx),
                                unsigned digestLength) {
-    CC_Digest_State* ctx;
+    CC_Digest_State ctx;
     std::vector<unsigned char> digest1(digestLength);
     std::vector<unsigned char> digest2(digestLength);
 
@@ -67,11 +67,11 @@ void _sameDataYieldsSameDigest(int (*init)(CC_Digest_State**),
     ASSERT_TRUE_MSG(equalsBytes(digest1.data(), digest2.data(), digestLength), "FAILED: same data should yield same result");
 }
 
-void _multipleUpdatesYieldsSameDigest(int (*init)(CC_Digest_State**),
-                                      int (*update)(CC_Digest_State** ctx, const void* data, CC_LONG len),
-                                      int (*final)(unsigned char* digest, CC_Digest_State** ctx),
+void _multipleUpdatesYieldsSameDigest(int (*init)(CC_Digest_State*),
+                                      int (*update)(CC_Digest_State* ctx, const void* data, CC_LONG len),
+                                      int (*final)(unsigned char* digest, CC_Digest_State* ctx),
                                       unsigned digestLength) {
-    CC_Digest_State* ctx;
+    CC_Digest_State ctx;
     std::vector<unsigned char> digest1(digestLength);
     std::vector<unsigned char> digest2(digestLength);
 
@@ -90,9 +90,9 @@ void _multipleUpdatesYieldsSameDigest(int (*init)(CC_Digest_State**),
     ASSERT_TRUE_MSG(equalsBytes(digest1.data(), digest2.data(), digestLength), "FAILED: multiple updates using same data should yield same result");
 }
 
-class DigestTest : public ::testing::TestWithParam<::testing::tuple<int(*)(CC_Digest_State**),
-             int (*)(CC_Digest_State** ctx, const void* data, CC_LONG len),
-             int (*)(unsigned char* digest, CC_Digest_State** ctx),
+class DigestTest : public ::testing::TestWithParam<::testing::tuple<int(*)(CC_Digest_State*),
+             int (*)(CC_Digest_State* ctx, const void* data, CC_LONG len),
+             int (*)(unsigned char* digest, CC_Digest_State* ctx),
              unsigned>> {};
 
 TEST_P(DigestTest, Sanity) {
@@ -110,7 +110,7 @@ TEST_P(DigestTest, SameDataYieldsSameDigest) {
 }
 
 TEST_P(DigestTest, MultipleUpdatesYieldsSameDigest) {
-    _sameDataYieldsSameDigest(::testing::get<0>(GetParam()),
+    _multipleUpdatesYieldsSameDigest(::testing::get<0>(GetParam()),
         ::testing::get<1>(GetParam()),
         ::testing::get<2>(GetParam()),
         ::testing::get<3>(GetParam()));
@@ -122,16 +122,17 @@ INSTANTIATE_TEST_CASE_P(CommonDigest,
                                           ::testing::make_tuple(CC_MD4_Init, CC_MD4_Update, CC_MD4_Final, CC_MD4_DIGEST_LENGTH),
                                           ::testing::make_tuple(CC_MD5_Init, CC_MD5_Update, CC_MD5_Final, CC_MD5_DIGEST_LENGTH),
                                           ::testing::make_tuple(CC_SHA1_Init, CC_SHA1_Update, CC_SHA1_Final, CC_SHA1_DIGEST_LENGTH),
+                                          ::testing::make_tuple(CC_SHA224_Init, CC_SHA224_Update, CC_SHA224_Final, CC_SHA224_DIGEST_LENGTH),
                                           ::testing::make_tuple(CC_SHA256_Init, CC_SHA256_Update, CC_SHA256_Final, CC_SHA256_DIGEST_LENGTH),
                                           ::testing::make_tuple(CC_SHA384_Init, CC_SHA384_Update, CC_SHA384_Final, CC_SHA384_DIGEST_LENGTH),
                                           ::testing::make_tuple(CC_SHA512_Init, CC_SHA512_Update, CC_SHA512_Final, CC_SHA512_DIGEST_LENGTH)));
 
-void _oneShotYieldsSameDigestAsUpdate(int (*init)(CC_Digest_State**),
-                                      int (*update)(CC_Digest_State** ctx, const void* data, CC_LONG len),
-                                      int (*final)(unsigned char* digest, CC_Digest_State** ctx),
+void _oneShotYieldsSameDigestAsUpdate(int (*init)(CC_Digest_State*),
+                                      int (*update)(CC_Digest_State* ctx, const void* data, CC_LONG len),
+                                      int (*final)(unsigned char* digest, CC_Digest_State* ctx),
                                       unsigned char* (*oneShot)(const void* data, CC_LONG len, unsigned char* md),
                                       unsigned digestLength) {
-    CC_Digest_State* ctx;
+    CC_Digest_State ctx;
     std::vector<unsigned char> digest1(digestLength);
     std::vector<unsigned char> digest2(digestLength);
 
@@ -146,9 +147,9 @@ void _oneShotYieldsSameDigestAsUpdate(int (*init)(CC_Digest_State**),
     ASSERT_TRUE_MSG(equalsBytes(digest1.data(), digest2.data(), digestLength), "FAILED: one shot should yield same result");
 }
 
-class DigestTest2 : public ::testing::TestWithParam<::testing::tuple<int(*)(CC_Digest_State**),
-             int (*)(CC_Digest_State** ctx, const void* data, CC_LONG len),
-             int (*)(unsigned char* digest, CC_Digest_State** ctx),
+class DigestTest2 : public ::testing::TestWithParam<::testing::tuple<int(*)(CC_Digest_State*),
+             int (*)(CC_Digest_State* ctx, const void* data, CC_LONG len),
+             int (*)(unsigned char* digest, CC_Digest_State* ctx),
              unsigned char* (*)(const void*, CC_LONG, unsigned char*),
              unsigned>> {};
 
@@ -166,11 +167,204 @@ INSTANTIATE_TEST_CASE_P(CommonDigest,
                             ::testing::make_tuple(CC_MD4_Init, CC_MD4_Update, CC_MD4_Final, CC_MD4, CC_MD4_DIGEST_LENGTH),
                             ::testing::make_tuple(CC_MD5_Init, CC_MD5_Update, CC_MD5_Final, CC_MD5, CC_MD5_DIGEST_LENGTH),
                             ::testing::make_tuple(CC_SHA1_Init, CC_SHA1_Update, CC_SHA1_Final, CC_SHA1, CC_SHA1_DIGEST_LENGTH),
+                            ::testing::make_tuple(CC_SHA224_Init, CC_SHA224_Update, CC_SHA224_Final, CC_SHA224, CC_SHA224_DIGEST_LENGTH),
                             ::testing::make_tuple(CC_SHA256_Init, CC_SHA256_Update, CC_SHA256_Final, CC_SHA256, CC_SHA256_DIGEST_LENGTH),
                             ::testing::make_tuple(CC_SHA384_Init, CC_SHA384_Update, CC_SHA384_Final, CC_SHA384, CC_SHA384_DIGEST_LENGTH),
                             ::testing::make_tuple(CC_SHA512_Init, CC_SHA512_Update, CC_SHA512_Final, CC_SHA512, CC_SHA512_DIGEST_LENGTH)));
 
 
+static std::string _hex(const unsigned char* bytes, size_t length) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < length; ++i) {
+        hex.push_back(digits[bytes[i] >> 4]);
+        hex.push_back(digits[bytes[i] & 0xf]);
+    }
+    return hex;
+}
+
+static std::string _oneShotHex(unsigned char* (*oneShot)(const void*, CC_LONG, unsigned char*), unsigned digestLength, const char* message) {
+    std::vector<unsigned char> digest(digestLength);
+    EXPECT_EQ(digest.data(), oneShot(message, static_cast<CC_LONG>(strlen(message)), digest.data()));
+    return _hex(digest.data(), digestLength);
+}
+
+static const char c_twoBlocks[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+static const char c_twoLongBlocks[] =
+    "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu";
+
+TEST(CommonDigest, KnownAnswers) {
+    static const char digits[] = "12345678901234567890123456789012345678901234567890123456789012345678901234567890";
+
+    EXPECT_EQ("8350e5a3e24c153df2275c9f80692773", _oneShotHex(CC_MD2, CC_MD2_DIGEST_LENGTH, ""));
+    EXPECT_EQ("da853b0d3f88d99b30283a69e6ded6bb", _oneShotHex(CC_MD2, CC_MD2_DIGEST_LENGTH, "abc"));
+    EXPECT_EQ("ab4f496bfb2a530b219ff33031fe06b0", _oneShotHex(CC_MD2, CC_MD2_DIGEST_LENGTH, "message digest"));
+    EXPECT_EQ("d5976f79d83d3a0dc9806c3c66f3efd8", _oneShotHex(CC_MD2, CC_MD2_DIGEST_LENGTH, digits));
+
+    EXPECT_EQ("31d6cfe0d16ae931b73c59d7e0c089c0", _oneShotHex(CC_MD4, CC_MD4_DIGEST_LENGTH, ""));
+    EXPECT_EQ("a448017aaf21d8525fc10ae87aa6729d", _oneShotHex(CC_MD4, CC_MD4_DIGEST_LENGTH, "abc"));
+    EXPECT_EQ("d9130a8164549fe818874806e1c7014b", _oneShotHex(CC_MD4, CC_MD4_DIGEST_LENGTH, "message digest"));
+    EXPECT_EQ("e33b4ddc9c38f2199c3e7b164fcc0536", _oneShotHex(CC_MD4, CC_MD4_DIGEST_LENGTH, digits));
+
+    EXPECT_EQ("d41d8cd98f00b204e9800998ecf8427e", _oneShotHex(CC_MD5, CC_MD5_DIGEST_LENGTH, ""));
+    EXPECT_EQ("900150983cd24fb0d6963f7d28e17f72", _oneShotHex(CC_MD5, CC_MD5_DIGEST_LENGTH, "abc"));
+    EXPECT_EQ("8215ef0796a20bcaaae116d3876c664a", _oneShotHex(CC_MD5, CC_MD5_DIGEST_LENGTH, c_twoBlocks));
+
+    EXPECT_EQ("da39a3ee5e6b4b0d3255bfef95601890afd80709", _oneShotHex(CC_SHA1, CC_SHA1_DIGEST_LENGTH, ""));
+    EXPECT_EQ("a9993e364706816aba3e25717850c26c9cd0d89d", _oneShotHex(CC_SHA1, CC_SHA1_DIGEST_LENGTH, "abc"));
+    EXPECT_EQ("84983e441c3bd26ebaae4aa1f95129e5e54670f1", _oneShotHex(CC_SHA1, CC_SHA1_DIGEST_LENGTH, c_twoBlocks));
+
+    EXPECT_EQ("d14a028c2a3a2bc9476102bb288234c415a2b01f828ea62ac5b3e42f", _oneShotHex(CC_SHA224, CC_SHA224_DIGEST_LENGTH, ""));
+    EXPECT_EQ("23097d223405d8228642a477bda255b32aadbce4bda0b3f7e36c9da7", _oneShotHex(CC_SHA224, CC_SHA224_DIGEST_LENGTH, "abc"));
+    EXPECT_EQ("75388b16512776cc5dba5da1fd890150b0c6455cb4f58b1952522525", _oneShotHex(CC_SHA224, CC_SHA224_DIGEST_LENGTH, c_twoBlocks));
+
+    EXPECT_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", _oneShotHex(CC_SHA256, CC_SHA256_DIGEST_LENGTH, ""));
+    EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", _oneShotHex(CC_SHA256, CC_SHA256_DIGEST_LENGTH, "abc"));
+    EXPECT_EQ("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+              _oneShotHex(CC_SHA256, CC_SHA256_DIGEST_LENGTH, c_twoBlocks));
+
+    EXPECT_EQ("38b060a751ac96384cd9327eb1b1e36a21fdb71114be07434c0cc7bf63f6e1da274edebfe76f65fbd51ad2f14898b95b",
+              _oneShotHex(CC_SHA384, CC_SHA384_DIGEST_LENGTH, ""));
+    EXPECT_EQ("cb00753f45a35e8bb5a03d699ac65007272c32ab0eded1631a8b605a43ff5bed8086072ba1e7cc2358baeca134c825a7",
+              _oneShotHex(CC_SHA384, CC_SHA384_DIGEST_LENGTH, "abc"));
+    EXPECT_EQ("09330c33f71147e83d192fc782cd1b4753111b173b3b05d22fa08086e3b0f712fcc7c71a557e2db966c3e9fa91746039",
+              _oneShotHex(CC_SHA384, CC_SHA384_DIGEST_LENGTH, c_twoLongBlocks));
+
+    EXPECT_EQ("cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e",
+              _oneShotHex(CC_SHA512, CC_SHA512_DIGEST_LENGTH, ""));
+    EXPECT_EQ("ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f",
+              _oneShotHex(CC_SHA512, CC_SHA512_DIGEST_LENGTH, "abc"));
+    EXPECT_EQ("8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909",
+              _oneShotHex(CC_SHA512, CC_SHA512_DIGEST_LENGTH, c_twoLongBlocks));
+}
+
+TEST(CommonDigest, MillionCharacters) {
+    CC_SHA256_CTX ctx;
+    const std::vector<char> chunk(1000, 'a');
+    ASSERT_EQ(1, CC_SHA256_Init(&ctx));
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(1, CC_SHA256_Update(&ctx, chunk.data(), static_cast<CC_LONG>(chunk.size())));
+    }
+
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    ASSERT_EQ(1, CC_SHA256_Final(digest, &ctx));
+    EXPECT_EQ("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", _hex(digest, sizeof(digest)));
+}
+
+static std::vector<unsigned char> _message(size_t length, unsigned seed) {
+    std::vector<unsigned char> message(length);
+    for (size_t i = 0; i < length; ++i) {
+        message[i] = static_cast<unsigned char>((i * 131 + seed * 17 + (i >> 8)) & 0xff);
+    }
+    return message;
+}
+
+void _piecesYieldSameDigest(int (*init)(CC_Digest_State*),
+                            int (*update)(CC_Digest_State* ctx, const void* data, CC_LONG len),
+                            int (*final)(unsigned char* digest, CC_Digest_State* ctx),
+                            unsigned char* (*oneShot)(const void* data, CC_LONG len, unsigned char* md),
+                            unsigned digestLength) {
+    static const size_t pieces[] = { 1, 3, 16, 63, 64, 65, 127, 128, 129, 1000 };
+
+    for (size_t length = 0; length <= 300; length += (length < 140) ? 1 : 23) {
+        const std::vector<unsigned char> message = _message(length, static_cast<unsigned>(length));
+        std::vector<unsigned char> expected(digestLength);
+        ASSERT_EQ(expected.data(), oneShot(message.data(), static_cast<CC_LONG>(length), expected.data()));
+
+        for (size_t piece : pieces) {
+            CC_Digest_State ctx;
+            ASSERT_EQ(1, init(&ctx));
+            for (size_t i = 0; i < length; i += piece) {
+                ASSERT_EQ(1, update(&ctx, message.data() + i, static_cast<CC_LONG>(std::min(piece, length - i))));
+            }
+
+            std::vector<unsigned char> digest(digestLength);
+            ASSERT_EQ(1, final(digest.data(), &ctx));
+            ASSERT_TRUE_MSG(equalsBytes(expected.data(), digest.data(), digestLength), "FAILED: %u bytes in pieces of %u", length, piece);
+        }
+
+        // A context is a plain value: a copy taken part way carries on the same.
+        CC_Digest_State ctx;
+        ASSERT_EQ(1, init(&ctx));
+        ASSERT_EQ(1, update(&ctx, message.data(), static_cast<CC_LONG>(length / 2)));
+        CC_Digest_State copy = ctx;
+        ASSERT_EQ(1, update(&copy, message.data() + length / 2, static_cast<CC_LONG>(length - length / 2)));
+
+        std::vector<unsigned char> digest(digestLength);
+        ASSERT_EQ(1, final(digest.data(), &copy));
+        ASSERT_TRUE_MSG(equalsBytes(expected.data(), digest.data(), digestLength), "FAILED: copied context, %u bytes", length);
+    }
+}
+
+TEST_P(DigestTest2, PiecesYieldSameDigest) {
+    _piecesYieldSameDigest(::testing::get<0>(GetParam()),
+        ::testing::get<1>(GetParam()),
+        ::testing::get<2>(GetParam()),
+        ::testing::get<3>(GetParam()),
+        ::testing::get<4>(GetParam()));
+}
+
+TEST(CommonDigest, SHA256BatchMatchesOneShot) {
+    std::vector<std::vector<unsigned char>> messages;
+    for (size_t length = 0; length <= 200; ++length) {
+        messages.push_back(_message(length, 1));
+    }
+    messages.push_back(_message(1000, 2));
+    messages.push_back(_message(5000, 3));
+    for (size_t length = 0; length <= 200; length += 37) {
+        messages.push_back(_message(length, 4));
+    }
+
+    // Every count up to a few times the widest vector, so that lanes both run short and take several messages each.
+    for (size_t count = 0; count <= 40; ++count) {
+        std::vector<const void*> data;
+        std::vector<CC_LONG> lengths;
+        std::vector<std::vector<unsigned char>> digests(count, std::vector<unsigned char>(CC_SHA256_DIGEST_LENGTH));
+        std::vector<unsigned char*> outputs;
+        for (size_t i = 0; i < count; ++i) {
+            const std::vector<unsigned char>& message = messages[(i * 7 + count) % messages.size()];
+            data.push_back(message.data());
+            lengths.push_back(static_cast<CC_LONG>(message.size()));
+            outputs.push_back(digests[i].data());
+        }
+
+        ASSERT_EQ(1, CC_SHA256_Batch(data.data(), lengths.data(), outputs.data(), count));
+        for (size_t i = 0; i < count; ++i) {
+            unsigned char expected[CC_SHA256_DIGEST_LENGTH];
+            CC_SHA256(data[i], lengths[i], expected);
+            ASSERT_TRUE_MSG(equalsBytes(expected, outputs[i], CC_SHA256_DIGEST_LENGTH), "FAILED: message %u of %u", i, count);
+        }
+    }
+
+    // Every message in the batch, in order.
+    std::vector<const void*> data;
+    std::vector<CC_LONG> lengths;
+    std::vector<unsigned char> digests(messages.size() * CC_SHA256_DIGEST_LENGTH);
+    std::vector<unsigned char*> outputs;
+    for (size_t i = 0; i < messages.size(); ++i) {
+        data.push_back(messages[i].data());
+        lengths.push_back(static_cast<CC_LONG>(messages[i].size()));
+        outputs.push_back(&digests[i * CC_SHA256_DIGEST_LENGTH]);
+    }
+    ASSERT_EQ(1, CC_SHA256_Batch(data.data(), lengths.data(), outputs.data(), messages.size()));
+    for (size_t i = 0; i < messages.size(); ++i) {
+        unsigned char expected[CC_SHA256_DIGEST_LENGTH];
+        CC_SHA256(data[i], lengths[i], expected);
+        ASSERT_TRUE_MSG(equalsBytes(expected, outputs[i], CC_SHA256_DIGEST_LENGTH), "FAILED: message %u", i);
+    }
+}
+
+TEST(CommonDigest, SHA256BatchRejectsMissingBuffers) {
+    const char message[] = "abc";
+    const void* data[] = { message };
+    CC_LONG lengths[] = { 3 };
+    unsigned char* noDigests[] = { nullptr };
+
+    EXPECT_EQ(1, CC_SHA256_Batch(nullptr, nullptr, nullptr, 0));
+    EXPECT_EQ(-1, CC_SHA256_Batch(nullptr, lengths, noDigests, 1));
+    EXPECT_EQ(-1, CC_SHA256_Batch(data, lengths, noDigests, 1));
+}
+
 /* CommonHMAC tests */
 
 class HmacTest : public ::testing::TestWithParam<::testing::tuple<CCHmacAlgorithm, unsigned>> {};
@@ -231,7 +425,8 @@ INSTANTIATE_TEST_CASE_P(CommonHmac,
                             ::testing::make_tuple(kCCHmacAlgMD5, CC_MD5_DIGEST_LENGTH),
                             ::testing::make_tuple(kCCHmacAlgSHA256, CC_SHA256_DIGEST_LENGTH),
                             ::testing::make_tuple(kCCHmacAlgSHA384, CC_SHA384_DIGEST_LENGTH),
-                            ::testing::make_tuple(kCCHmacAlgSHA512, CC_SHA512_DIGEST_LENGTH)));
+                            ::testing::make_tuple(kCCHmacAlgSHA512, CC_SHA512_DIGEST_LENGTH),
+                            ::testing::make_tuple(kCCHmacAlgSHA224, CC_SHA224_DIGEST_LENGTH)));
 
 TEST(CommonHmac, OneShotSanity) {
     unsigned hashLength = CC_SHA256_DIGEST_LENGTH;
@@ -242,6 +437,35 @@ TEST(CommonHmac, OneShotSanity) {
     logBytes(singleLine, hash1.data(), hashLength);
 }
 
+static std::string _hmacHex(CCHmacAlgorithm algorithm, const std::string& key, const std::string& data, size_t length) {
+    std::vector<unsigned char> mac(length);
+    CCHmac(algorithm, key.data(), key.size(), data.data(), data.size(), mac.data());
+    return _hex(mac.data(), mac.size());
+}
+
+TEST(CommonHmac, KnownAnswers) {
+    // RFC 2202 and RFC 4231 test case 2
+    static const std::string key = "Jefe";
+    static const std::string data = "what do ya want for nothing?";
+    EXPECT_EQ("750c783e6ab0b503eaa86e310a5db738", _hmacHex(kCCHmacAlgMD5, key, data, CC_MD5_DIGEST_LENGTH));
+    EXPECT_EQ("effcdf6ae5eb2fa2d27416d5f184df9c259a7c79", _hmacHex(kCCHmacAlgSHA1, key, data, CC_SHA1_DIGEST_LENGTH));
+    EXPECT_EQ("a30e01098bc6dbbf45690f3a7e9e6d0f8bbea2a39e6148008fd05e44", _hmacHex(kCCHmacAlgSHA224, key, data, CC_SHA224_DIGEST_LENGTH));
+    EXPECT_EQ("5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+              _hmacHex(kCCHmacAlgSHA256, key, data, CC_SHA256_DIGEST_LENGTH));
+    EXPECT_EQ("af45d2e376484031617f78d2b58a6b1b9c7ef464f5a01b47e42ec3736322445e8e2240ca5e69e2c78b3239ecfab21649",
+              _hmacHex(kCCHmacAlgSHA384, key, data, CC_SHA384_DIGEST_LENGTH));
+    EXPECT_EQ("164b7a7bfcf819e2e395fbe73b56e0a387bd64222e831fd610270cd7ea2505549758bf75c05a994a6d034f65f8f0e6fdcaeab1a34d4a6b4b636e0"
+              "70a38bce737",
+              _hmacHex(kCCHmacAlgSHA512, key, data, CC_SHA512_DIGEST_LENGTH));
+
+    // RFC 4231 test case 6: a key longer than the block is hashed first
+    EXPECT_EQ("60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54",
+              _hmacHex(kCCHmacAlgSHA256,
+                       std::string(131, '\xaa'),
+                       "Test Using Larger Than Block-Size Key - Hash Key First",
+                       CC_SHA256_DIGEST_LENGTH));
+}
+
 /* CommonCryptor tests */
 void _oneShotYieldsSameCrypto(CCAlgorithm algorithm,
                               CCOperation operation,
@@ -405,7 +629,8 @@ void _encryptDecryptSameAsOriginal(CCAlgorithm algorithm,
                      outputSize,
                      &oneShotBytesDecrypted);
     ASSERT_EQ(kCCSuccess, status);
-    ASSERT_EQ(outputLength, oneShotBytesDecrypted);
+    // Decrypting with padding gives back just the original
+    ASSERT_EQ((options & kCCOptionPKCS7Padding) ? update1Size + update2Size : outputLength, oneShotBytesDecrypted);
     logBytes(singleLine, output2.data(), update1Size + update2Size);
 
     ASSERT_TRUE_MSG(equalsBytes((BYTE*)singleLine, output2.data(),  update1Size + update2Size), "FAILED: Encrypt followed by Decrypt should equal original");
@@ -490,4 +715,517 @@ TEST(CommonCryptor, Sanity) {
     logBytes(multiLine2, output.data(), aesBlockLength);
     ASSERT_EQ(16, datamoved);
     CCCryptorRelease(ctx);
-}
\ No newline at end of file
+}
+
+static std::vector<unsigned char> _bytes(const char* hex) {
+    std::vector<unsigned char> bytes;
+    for (; hex[0] && hex[1]; hex += 2) {
+        bytes.push_back(static_cast<unsigned char>(std::stoi(std::string(hex, 2), nullptr, 16)));
+    }
+    return bytes;
+}
+
+static std::string _cryptHex(CCOperation op, CCOptions options, const char* key, const char* iv, const char* input) {
+    const std::vector<unsigned char> keyBytes = _bytes(key);
+    const std::vector<unsigned char> ivBytes = _bytes(iv);
+    const std::vector<unsigned char> inputBytes = _bytes(input);
+    std::vector<unsigned char> output(inputBytes.size() + kCCBlockSizeAES128);
+    size_t moved = 0;
+    EXPECT_EQ(kCCSuccess,
+              CCCrypt(op,
+                      kCCAlgorithmAES,
+                      options,
+                      keyBytes.data(),
+                      keyBytes.size(),
+                      ivBytes.empty() ? nullptr : ivBytes.data(),
+                      inputBytes.data(),
+                      inputBytes.size(),
+                      output.data(),
+                      output.size(),
+                      &moved));
+    return _hex(output.data(), moved);
+}
+
+static std::string _ctrHex(const char* key, const char* counter, const char* input) {
+    const std::vector<unsigned char> keyBytes = _bytes(key);
+    const std::vector<unsigned char> counterBytes = _bytes(counter);
+    std::vector<unsigned char> data = _bytes(input);
+    CCCryptorRef cryptor;
+    EXPECT_EQ(kCCSuccess,
+              CCCryptorCreateWithMode(kCCEncrypt,
+                                      kCCModeCTR,
+                                      kCCAlgorithmAES,
+                                      ccNoPadding,
+                                      counterBytes.data(),
+                                      keyBytes.data(),
+                                      keyBytes.size(),
+                                      nullptr,
+                                      0,
+                                      0,
+                                      kCCModeOptionCTR_BE,
+                                      &cryptor));
+    size_t moved = 0;
+    EXPECT_EQ(kCCSuccess, CCCryptorUpdate(cryptor, data.data(), data.size(), data.data(), data.size(), &moved));
+    EXPECT_EQ(data.size(), moved);
+    CCCryptorRelease(cryptor);
+    return _hex(data.data(), data.size());
+}
+
+TEST(CommonCryptor, AESKnownAnswers) {
+    // FIPS-197 appendix C
+    static const char plaintext[] = "00112233445566778899aabbccddeeff";
+    static const char key256[] = "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f";
+    const std::string key128(key256, 32);
+    const std::string key192(key256, 48);
+    EXPECT_EQ("69c4e0d86a7b0430d8cdb78070b4c55a", _cryptHex(kCCEncrypt, kCCOptionECBMode, key128.c_str(), "", plaintext));
+    EXPECT_EQ("dda97ca4864cdfe06eaf70a0ec0d7191", _cryptHex(kCCEncrypt, kCCOptionECBMode, key192.c_str(), "", plaintext));
+    EXPECT_EQ("8ea2b7ca516745bfeafc49904b496089", _cryptHex(kCCEncrypt, kCCOptionECBMode, key256, "", plaintext));
+    EXPECT_EQ(plaintext, _cryptHex(kCCDecrypt, kCCOptionECBMode, key128.c_str(), "", "69c4e0d86a7b0430d8cdb78070b4c55a"));
+    EXPECT_EQ(plaintext, _cryptHex(kCCDecrypt, kCCOptionECBMode, key192.c_str(), "", "dda97ca4864cdfe06eaf70a0ec0d7191"));
+    EXPECT_EQ(plaintext, _cryptHex(kCCDecrypt, kCCOptionECBMode, key256, "", "8ea2b7ca516745bfeafc49904b496089"));
+
+    // NIST SP 800-38A F.2.1, F.2.2, F.5.1 and F.5.2
+    static const char key[] = "2b7e151628aed2a6abf7158809cf4f3c";
+    static const char iv[] = "000102030405060708090a0b0c0d0e0f";
+    static const char counter[] = "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+    static const char message[] =
+        "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e5130c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710";
+    static const char cbc[] =
+        "7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b273bed6b8e3c1743b7116e69e222295163ff1caa1681fac09120eca307586e1a7";
+    static const char ctr[] =
+        "874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee";
+    EXPECT_EQ(cbc, _cryptHex(kCCEncrypt, 0, key, iv, message));
+    EXPECT_EQ(message, _cryptHex(kCCDecrypt, 0, key, iv, cbc));
+    EXPECT_EQ(ctr, _ctrHex(key, counter, message));
+    EXPECT_EQ(message, _ctrHex(key, counter, ctr));
+}
+
+TEST(CommonCryptor, AESCounterCarriesAcrossWholeBlock) {
+    // The counter is the whole block: compare with encrypting each counter value in ECB mode.
+    static const char key[] = "2b7e151628aed2a6abf7158809cf4f3c";
+    static const char start[] = "00000000000000fffffffffffffffffd";
+    static const char counters[] = "00000000000000fffffffffffffffffd00000000000000fffffffffffffffffe00000000000000ffffffffffffffffff"
+                                   "000000000000010000000000000000000000000000000100000000000000000100000000000001000000000000000002";
+    const std::string zeros(2 * 6 * kCCBlockSizeAES128 - 10, '0');
+    const std::string keystream = _cryptHex(kCCEncrypt, kCCOptionECBMode, key, "", counters);
+    EXPECT_EQ(keystream.substr(0, zeros.size()), _ctrHex(key, start, zeros.c_str()));
+}
+
+TEST(CommonCryptor, AESGCMKnownAnswers) {
+    // Test cases 2, 4, 6 and 14 from McGrew and Viega, "The Galois/Counter Mode of Operation"
+    struct Case {
+        const char* key;
+        const char* iv;
+        const char* aData;
+        const char* plaintext;
+        const char* ciphertext;
+        const char* tag;
+    };
+    static const Case cases[] = {
+        { "00000000000000000000000000000000",
+          "000000000000000000000000",
+          "",
+          "00000000000000000000000000000000",
+          "0388dace60b6a392f328c2b971b2fe78",
+          "ab6e47d42cec13bdf53a67b21257bddf" },
+        { "feffe9928665731c6d6a8f9467308308",
+          "cafebabefacedbaddecaf888",
+          "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+          "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+          "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091",
+          "5bc94fbc3221a5db94fae95ae7121a47" },
+        { "feffe9928665731c6d6a8f9467308308",
+          "9313225df88406e555909c5aff5269aa6a7a9538534f7da1e4c303d2a318a728c3c0c95156809539fcf0e2429a6b525416aedbf5a0de6a57a637b39b",
+          "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+          "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+          "8ce24998625615b603a033aca13fb894be9112a5c3a211a8ba262a3cca7e2ca701e4a9a4fba43c90ccdcb281d48c7c6fd62875d2aca417034c34aee5",
+          "619cc5aefffe0bfa462af43c1699d050" },
+        { "0000000000000000000000000000000000000000000000000000000000000000",
+          "000000000000000000000000",
+          "",
+          "00000000000000000000000000000000",
+          "cea7403d4d606b6e074ec5d3baf39d18",
+          "d0d1c8a799996bf0265b98b5d48ab919" },
+    };
+
+    for (const Case& test : cases) {
+        const std::vector<unsigned char> key = _bytes(test.key);
+        const std::vector<unsigned char> iv = _bytes(test.iv);
+        const std::vector<unsigned char> aData = _bytes(test.aData);
+        std::vector<unsigned char> data = _bytes(test.plaintext);
+        unsigned char tag[16];
+        ASSERT_EQ(kCCSuccess,
+                  CCCryptorGCMOneshotEncrypt(kCCAlgorithmAES,
+                                             key.data(),
+                                             key.size(),
+                                             iv.data(),
+                                             iv.size(),
+                                             aData.data(),
+                                             aData.size(),
+                                             data.data(),
+                                             data.size(),
+                                             data.data(),
+                                             tag,
+                                             sizeof(tag)));
+        EXPECT_EQ(test.ciphertext, _hex(data.data(), data.size()));
+        EXPECT_EQ(test.tag, _hex(tag, sizeof(tag)));
+
+        ASSERT_EQ(kCCSuccess,
+                  CCCryptorGCMOneshotDecrypt(kCCAlgorithmAES,
+                                             key.data(),
+                                             key.size(),
+                                             iv.data(),
+                                             iv.size(),
+                                             aData.data(),
+                                             aData.size(),
+                                             data.data(),
+                                             data.size(),
+                                             data.data(),
+                                             tag,
+                                             sizeof(tag)));
+        EXPECT_EQ(test.plaintext, _hex(data.data(), data.size()));
+    }
+}
+
+TEST(CommonCryptor, AESGCMRejectsWrongTag) {
+    const std::vector<unsigned char> key = _bytes("feffe9928665731c6d6a8f9467308308");
+    const std::vector<unsigned char> iv = _bytes("cafebabefacedbaddecaf888");
+    const std::vector<unsigned char> ciphertext = _bytes("42831ec2217774244b7221b784d0d49c");
+    std::vector<unsigned char> tag = _bytes("5bc94fbc3221a5db94fae95ae7121a47");
+    std::vector<unsigned char> output(ciphertext.size(), 0xcc);
+
+    tag[15] ^= 1;
+    EXPECT_EQ(kCCDecodeError,
+              CCCryptorGCMOneshotDecrypt(kCCAlgorithmAES,
+                                         key.data(),
+                                         key.size(),
+                                         iv.data(),
+                                         iv.size(),
+                                         nullptr,
+                                         0,
+                                         ciphertext.data(),
+                                         ciphertext.size(),
+                                         output.data(),
+                                         tag.data(),
+                                         tag.size()));
+    EXPECT_EQ(std::vector<unsigned char>(ciphertext.size(), 0xcc), output);
+
+    EXPECT_EQ(kCCParamError,
+              CCCryptorGCMOneshotDecrypt(kCCAlgorithmDES,
+                                         key.data(),
+                                         key.size(),
+                                         iv.data(),
+                                         iv.size(),
+                                         nullptr,
+                                         0,
+                                         ciphertext.data(),
+                                         ciphertext.size(),
+                                         output.data(),
+                                         tag.data(),
+                                         tag.size()));
+}
+
+static std::vector<unsigned char> _cryptInPieces(
+    CCOperation op, CCMode mode, CCPadding padding, const std::vector<unsigned char>& input, size_t piece, bool inPlace) {
+    static const unsigned char iv[kCCBlockSizeAES128] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+    CCCryptorRef cryptor;
+    EXPECT_EQ(kCCSuccess,
+              CCCryptorCreateWithMode(op, mode, kCCAlgorithmAES, padding, iv, longKey, kCCKeySizeAES256, nullptr, 0, 0, 0, &cryptor));
+
+    // In place, the output is written over the input as it is consumed.
+    std::vector<unsigned char> buffer(input);
+    buffer.resize(input.size() + kCCBlockSizeAES128);
+    std::vector<unsigned char> separate(buffer.size());
+    unsigned char* out = inPlace ? buffer.data() : separate.data();
+
+    size_t written = 0;
+    for (size_t i = 0; i < input.size(); i += piece) {
+        const size_t length = std::min(piece, input.size() - i);
+        size_t moved = 0;
+        EXPECT_EQ(kCCSuccess, CCCryptorUpdate(cryptor, buffer.data() + i, length, out + written, buffer.size() - written, &moved));
+        written += moved;
+    }
+
+    size_t moved = 0;
+    EXPECT_EQ(kCCSuccess, CCCryptorFinal(cryptor, out + written, buffer.size() - written, &moved));
+    written += moved;
+    CCCryptorRelease(cryptor);
+    return std::vector<unsigned char>(out, out + written);
+}
+
+TEST(CommonCryptor, AESPiecesYieldSameResult) {
+    static const CCMode modes[] = { kCCModeECB, kCCModeCBC, kCCModeCTR };
+    static const size_t pieces[] = { 1, 5, 15, 16, 17, 33, 64, 129, 1000 };
+
+    for (size_t length = 0; length <= 600; length += (length < 70) ? 1 : 37) {
+        const std::vector<unsigned char> message = _message(length, 3);
+        for (CCMode mode : modes) {
+            for (CCPadding padding = ccNoPadding; padding <= ccPKCS7Padding; ++padding) {
+                if (mode != kCCModeCTR && padding == ccNoPadding && length % kCCBlockSizeAES128 != 0) {
+                    continue;
+                }
+
+                const std::vector<unsigned char> encrypted = _cryptInPieces(kCCEncrypt, mode, padding, message, length + 1, false);
+                const std::vector<unsigned char> decrypted = _cryptInPieces(kCCDecrypt, mode, padding, encrypted, encrypted.size() + 1, false);
+                ASSERT_TRUE_MSG(message == decrypted, "FAILED: mode %u, padding %u, %u bytes", mode, padding, length);
+
+                for (size_t piece : pieces) {
+                    for (bool inPlace : { false, true }) {
+                        ASSERT_TRUE_MSG(encrypted == _cryptInPieces(kCCEncrypt, mode, padding, message, piece, inPlace),
+                                        "FAILED: encrypting, mode %u, padding %u, %u bytes in pieces of %u, in place %d",
+                                        mode,
+                                        padding,
+                                        length,
+                                        piece,
+                                        inPlace);
+                        ASSERT_TRUE_MSG(message == _cryptInPieces(kCCDecrypt, mode, padding, encrypted, piece, inPlace),
+                                        "FAILED: decrypting, mode %u, padding %u, %u bytes in pieces of %u, in place %d",
+                                        mode,
+                                        padding,
+                                        length,
+                                        piece,
+                                        inPlace);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(CommonCryptor, AESResetKeepsKey) {
+    static const unsigned char iv1[kCCBlockSizeAES128] = { 1 };
+    static const unsigned char iv2[kCCBlockSizeAES128] = { 2 };
+    const std::vector<unsigned char> message = _message(100, 5);
+
+    for (CCMode mode : { kCCModeCBC, kCCModeCTR }) {
+        CCCryptorRef fresh;
+        ASSERT_EQ(kCCSuccess,
+                  CCCryptorCreateWithMode(
+                      kCCEncrypt, mode, kCCAlgorithmAES, ccPKCS7Padding, iv2, longKey, kCCKeySizeAES128, nullptr, 0, 0, 0, &fresh));
+        CCCryptorRef reset;
+        ASSERT_EQ(kCCSuccess,
+                  CCCryptorCreateWithMode(
+                      kCCEncrypt, mode, kCCAlgorithmAES, ccPKCS7Padding, iv1, longKey, kCCKeySizeAES128, nullptr, 0, 0, 0, &reset));
+
+        // Left part way through, with a partial block buffered
+        std::vector<unsigned char> output(message.size() + kCCBlockSizeAES128);
+        size_t moved;
+        ASSERT_EQ(kCCSuccess, CCCryptorUpdate(reset, message.data(), 21, output.data(), output.size(), &moved));
+        ASSERT_EQ(kCCSuccess, CCCryptorReset(reset, iv2));
+
+        std::vector<unsigned char> expected(output.size());
+        size_t expectedMoved;
+        ASSERT_EQ(kCCSuccess, CCCryptorUpdate(fresh, message.data(), message.size(), expected.data(), expected.size(), &expectedMoved));
+        ASSERT_EQ(kCCSuccess, CCCryptorUpdate(reset, message.data(), message.size(), output.data(), output.size(), &moved));
+        ASSERT_EQ(expectedMoved, moved);
+        ASSERT_TRUE(equalsBytes(expected.data(), output.data(), moved));
+
+        CCCryptorRelease(fresh);
+        CCCryptorRelease(reset);
+    }
+}
+
+TEST(CommonCryptor, AESBadPaddingIsRejected) {
+    const std::vector<unsigned char> message = _message(32, 7);
+    std::vector<unsigned char> output(message.size());
+    size_t moved;
+
+    // Decrypting plaintext with a padding option leaves garbage where the padding should be.
+    EXPECT_EQ(kCCDecodeError,
+              CCCrypt(kCCDecrypt,
+                      kCCAlgorithmAES,
+                      kCCOptionPKCS7Padding | kCCOptionECBMode,
+                      longKey,
+                      kCCKeySizeAES128,
+                      nullptr,
+                      _bytes("000102030405060708090a0b0c0d0e0f").data(),
+                      kCCBlockSizeAES128,
+                      output.data(),
+                      output.size(),
+                      &moved));
+
+    EXPECT_EQ(kCCAlignmentError,
+              CCCrypt(kCCEncrypt, kCCAlgorithmAES, 0, longKey, kCCKeySizeAES128, nullptr, message.data(), 31, output.data(), output.size(), &moved));
+    EXPECT_EQ(kCCBufferTooSmall,
+              CCCrypt(kCCEncrypt, kCCAlgorithmAES, 0, longKey, kCCKeySizeAES128, nullptr, message.data(), 32, output.data(), 16, &moved));
+    EXPECT_EQ(kCCParamError,
+              CCCrypt(kCCEncrypt, kCCAlgorithmAES, 0, longKey, 17, nullptr, message.data(), 32, output.data(), output.size(), &moved));
+}
+
+/* CommonKeyDerivation tests */
+
+static std::string _pbkdf2Hex(CCPseudoRandomAlgorithm prf, const std::string& password, const std::string& salt, unsigned rounds, size_t length) {
+    std::vector<uint8_t> derivedKey(length);
+    EXPECT_EQ(kCCSuccess,
+              CCKeyDerivationPBKDF(kCCPBKDF2,
+                                   password.data(),
+                                   password.size(),
+                                   reinterpret_cast<const uint8_t*>(salt.data()),
+                                   salt.size(),
+                                   prf,
+                                   rounds,
+                                   derivedKey.data(),
+                                   derivedKey.size()));
+    return _hex(derivedKey.data(), derivedKey.size());
+}
+
+// PBKDF2 the long way, with CCHmac for every round
+static std::string _pbkdf2WithHmac(CCHmacAlgorithm algorithm,
+                                   size_t digestLength,
+                                   const std::string& password,
+                                   const std::string& salt,
+                                   unsigned rounds,
+                                   size_t length) {
+    std::vector<unsigned char> derivedKey;
+    for (uint32_t index = 1; derivedKey.size() < length; ++index) {
+        std::vector<unsigned char> message(salt.begin(), salt.end());
+        message.push_back(static_cast<unsigned char>(index >> 24));
+        message.push_back(static_cast<unsigned char>(index >> 16));
+        message.push_back(static_cast<unsigned char>(index >> 8));
+        message.push_back(static_cast<unsigned char>(index));
+
+        std::vector<unsigned char> u(digestLength);
+        CCHmac(algorithm, password.data(), password.size(), message.data(), message.size(), u.data());
+        std::vector<unsigned char> t(u);
+        for (unsigned round = 1; round < rounds; ++round) {
+            std::vector<unsigned char> next(digestLength);
+            CCHmac(algorithm, password.data(), password.size(), u.data(), u.size(), next.data());
+            u = next;
+            for (size_t i = 0; i < digestLength; ++i) {
+                t[i] ^= u[i];
+            }
+        }
+        derivedKey.insert(derivedKey.end(), t.begin(), t.end());
+    }
+    return _hex(derivedKey.data(), length);
+}
+
+TEST(CommonKeyDerivation, PBKDF2KnownAnswers) {
+    // RFC 6070
+    EXPECT_EQ("0c60c80f961f0e71f3a9b524af6012062fe037a6", _pbkdf2Hex(kCCPRFHmacAlgSHA1, "password", "salt", 1, 20));
+    EXPECT_EQ("ea6c014dc72d6f8ccd1ed92ace1d41f0d8de8957", _pbkdf2Hex(kCCPRFHmacAlgSHA1, "password", "salt", 2, 20));
+    EXPECT_EQ("4b007901b765489abead49d926f721d065a429c1", _pbkdf2Hex(kCCPRFHmacAlgSHA1, "password", "salt", 4096, 20));
+    EXPECT_EQ("3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038",
+              _pbkdf2Hex(kCCPRFHmacAlgSHA1, "passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096, 25));
+    EXPECT_EQ("56fa6aa75548099dcc37d7f03425e0c3",
+              _pbkdf2Hex(kCCPRFHmacAlgSHA1, std::string("pass\0word", 9), std::string("sa\0lt", 5), 4096, 16));
+
+    EXPECT_EQ("d3bcf320fd918908eafcaa460faf40e201f6508d4e6f3d9c1c0abd30", _pbkdf2Hex(kCCPRFHmacAlgSHA224, "password", "salt", 1000, 28));
+    EXPECT_EQ("c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a",
+              _pbkdf2Hex(kCCPRFHmacAlgSHA256, "password", "salt", 4096, 32));
+    EXPECT_EQ("348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c4e2a1fb8dd53e1c635518c7dac47e9",
+              _pbkdf2Hex(kCCPRFHmacAlgSHA256, "passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096, 40));
+    EXPECT_EQ("cbcb9f1a1b9906574eb6e2b91097efa7b03a77cb25939c7f18bcc9be8ab4808f409003c2ed1eafa1aaf0974686ef5558e2826249fd01fb721f1"
+              "79d9a19d2e2fdb155566d03f2a791a0acf3d784804a3fc30a339f1a44a49ef8c8dce33420a7b5c1c0dc4f",
+              _pbkdf2Hex(kCCPRFHmacAlgSHA384, "password", "salt", 3000, 100));
+    EXPECT_EQ("867f70cf1ade02cff3752599a3a53dc4af34c7a669815ae5d513554e1c8cf252c02d470a285a0501bad999bfe943c08f050235d7d68b1da55e63f"
+              "73b60a57fce",
+              _pbkdf2Hex(kCCPRFHmacAlgSHA512, "password", "salt", 1, 64));
+}
+
+TEST(CommonKeyDerivation, PBKDF2MatchesHmac) {
+    // Keys of several blocks, with enough rounds for the blocks to be shared out across threads
+    static const struct {
+        CCPseudoRandomAlgorithm prf;
+        CCHmacAlgorithm algorithm;
+        size_t digestLength;
+    } prfs[] = {
+        { kCCPRFHmacAlgSHA1, kCCHmacAlgSHA1, CC_SHA1_DIGEST_LENGTH },
+        { kCCPRFHmacAlgSHA224, kCCHmacAlgSHA224, CC_SHA224_DIGEST_LENGTH },
+        { kCCPRFHmacAlgSHA256, kCCHmacAlgSHA256, CC_SHA256_DIGEST_LENGTH },
+        { kCCPRFHmacAlgSHA384, kCCHmacAlgSHA384, CC_SHA384_DIGEST_LENGTH },
+        { kCCPRFHmacAlgSHA512, kCCHmacAlgSHA512, CC_SHA512_DIGEST_LENGTH },
+    };
+
+    const std::string longPassword(200, 'p');
+    for (const auto& prf : prfs) {
+        for (unsigned rounds : { 1u, 3u, 2500u }) {
+            const size_t length = 5 * prf.digestLength - 3;
+            ASSERT_EQ(_pbkdf2WithHmac(prf.algorithm, prf.digestLength, secret2, "NaCl", rounds, length),
+                      _pbkdf2Hex(prf.prf, secret2, "NaCl", rounds, length));
+            ASSERT_EQ(_pbkdf2WithHmac(prf.algorithm, prf.digestLength, longPassword, "", rounds, length),
+                      _pbkdf2Hex(prf.prf, longPassword, "", rounds, length));
+        }
+    }
+}
+
+TEST(CommonKeyDerivation, PBKDF2RejectsBadParameters) {
+    uint8_t derivedKey[32];
+    const uint8_t salt[] = { 's' };
+    EXPECT_EQ(kCCParamError, CCKeyDerivationPBKDF(kCCPBKDF2 + 1, "p", 1, salt, 1, kCCPRFHmacAlgSHA256, 1, derivedKey, sizeof(derivedKey)));
+    EXPECT_EQ(kCCParamError, CCKeyDerivationPBKDF(kCCPBKDF2, "p", 1, salt, 1, 0, 1, derivedKey, sizeof(derivedKey)));
+    EXPECT_EQ(kCCParamError, CCKeyDerivationPBKDF(kCCPBKDF2, "p", 1, salt, 1, kCCPRFHmacAlgSHA256, 0, derivedKey, sizeof(derivedKey)));
+    EXPECT_EQ(kCCParamError, CCKeyDerivationPBKDF(kCCPBKDF2, "p", 1, salt, 1, kCCPRFHmacAlgSHA256, 1, derivedKey, 0));
+    EXPECT_EQ(kCCParamError, CCKeyDerivationPBKDF(kCCPBKDF2, nullptr, 1, salt, 1, kCCPRFHmacAlgSHA256, 1, derivedKey, sizeof(derivedKey)));
+    EXPECT_EQ(kCCSuccess, CCKeyDerivationPBKDF(kCCPBKDF2, nullptr, 0, nullptr, 0, kCCPRFHmacAlgSHA256, 1, derivedKey, sizeof(derivedKey)));
+}
+
+TEST(CommonKeyDerivation, CalibratePBKDF) {
+    const unsigned rounds = CCCalibratePBKDF(kCCPBKDF2, 12, 16, kCCPRFHmacAlgSHA256, 32, 50);
+    EXPECT_LT(0u, rounds);
+    EXPECT_NE(static_cast<unsigned>(-1), rounds);
+
+    EXPECT_EQ(static_cast<unsigned>(-1), CCCalibratePBKDF(kCCPBKDF2, 12, 16, kCCPRFHmacAlgSHA512 + 1, 32, 50));
+    EXPECT_EQ(static_cast<unsigned>(-1), CCCalibratePBKDF(kCCPBKDF2, 12, 16, kCCPRFHmacAlgSHA256, 0, 50));
+}
+
+static std::string _hkdfHex(CCDigestAlgorithm digest, const char* inputKey, const char* salt, const char* info, size_t length) {
+    const std::vector<unsigned char> inputKeyBytes = _bytes(inputKey);
+    const std::vector<unsigned char> saltBytes = _bytes(salt);
+    const std::vector<unsigned char> infoBytes = _bytes(info);
+    std::vector<unsigned char> derivedKey(length);
+    EXPECT_EQ(kCCSuccess,
+              CCKeyDerivationHMac(kCCKDFAlgorithmHKDF,
+                                  digest,
+                                  0,
+                                  inputKeyBytes.data(),
+                                  inputKeyBytes.size(),
+                                  nullptr,
+                                  0,
+                                  infoBytes.empty() ? nullptr : infoBytes.data(),
+                                  infoBytes.size(),
+                                  nullptr,
+                                  0,
+                                  saltBytes.empty() ? nullptr : saltBytes.data(),
+                                  saltBytes.size(),
+                                  derivedKey.data(),
+                                  derivedKey.size()));
+    return _hex(derivedKey.data(), derivedKey.size());
+}
+
+TEST(CommonKeyDerivation, HKDFKnownAnswers) {
+    // RFC 5869 test cases 1, 3 and 4
+    static const char inputKey[] = "0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b";
+    EXPECT_EQ("3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf34007208d5b887185865",
+              _hkdfHex(kCCDigestSHA256, inputKey, "000102030405060708090a0b0c", "f0f1f2f3f4f5f6f7f8f9", 42));
+    EXPECT_EQ("8da4e775a563c18f715f802a063c5a31b8a11f5c5ee1879ec3454e5f3c738d2d9d201395faa4b61a96c8",
+              _hkdfHex(kCCDigestSHA256, inputKey, "", "", 42));
+    EXPECT_EQ("085a01ea1b10f36933068b56efa5ad81a4f14b822f5b091568a9cdd4f155fda2c22e422478d305f3f896",
+              _hkdfHex(kCCDigestSHA1, "0b0b0b0b0b0b0b0b0b0b0b", "000102030405060708090a0b0c", "f0f1f2f3f4f5f6f7f8f9", 42));
+}
+
+TEST(CommonKeyDerivation, HKDFRejectsBadParameters) {
+    std::vector<unsigned char> derivedKey(255 * CC_SHA256_DIGEST_LENGTH + 1);
+    EXPECT_EQ(kCCParamError,
+              CCKeyDerivationHMac(kCCKDFAlgorithmHKDF,
+                                  kCCDigestSHA256,
+                                  0,
+                                  longKey,
+                                  16,
+                                  nullptr,
+                                  0,
+                                  nullptr,
+                                  0,
+                                  nullptr,
+                                  0,
+                                  nullptr,
+                                  0,
+                                  derivedKey.data(),
+                                  derivedKey.size()));
+    EXPECT_EQ(kCCParamError,
+              CCKeyDerivationHMac(
+                  kCCKDFAlgorithmHKDF, kCCDigestNone, 0, longKey, 16, nullptr, 0, nullptr, 0, nullptr, 0, nullptr, 0, derivedKey.data(), 32));
+    EXPECT_EQ(kCCUnimplemented,
+              CCKeyDerivationHMac(
+                  kCCKDFAlgorithmCTR_HMAC, kCCDigestSHA256, 0, longKey, 16, nullptr, 0, nullptr, 0, nullptr, 0, nullptr, 0, derivedKey.data(), 32));
+}
@@ -0,0 +1,183 @@
+//******************************************************************************
+//
+// Copyright (c) 2016 Microsoft Corporation. All rights reserved.
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+//******************************************************************************
+
+// Builds memory-mappable CFBurstTrie files from key/value lists, and queries them.
+//
+//   cfbursttrie [-p | -s] [-b] -o <trie> [<input>]
+//       Reads one "key<TAB>payload" line per entry from <input>, or stdin. Payloads are non-zero 32-bit integers and
+//       default to the line number. -p (the default) stores pages with prefix compression, -s sorted by key, and -b
+//       adds bitmap compression to the trie levels.
+//
+//   cfbursttrie -q <trie> <key>...
+//       Prints the payload of each key, or "-" for keys that are not in the trie.
+//
+//   cfbursttrie -e <trie> <prefix>
+//       Prints every key starting with <prefix>, with its payload.
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <CoreFoundation/CFBurstTrie.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LINE_LENGTH 4096
+
+static void printUsage(const char* execName) {
+    fprintf(stderr,
+            "usage: %s [-p | -s] [-b] -o <trie> [<input>]\n"
+            "       %s -q <trie> <key>...\n"
+            "       %s -e <trie> <prefix>\n",
+            execName,
+            execName,
+            execName);
+    exit(2);
+}
+
+static CFBurstTrieRef openTrie(const char* path) {
+    CFStringRef string = CFStringCreateWithFileSystemRepresentation(kCFAllocatorDefault, path);
+    CFBurstTrieRef trie = CFBurstTrieCreateFromFile(string);
+    CFRelease(string);
+    if (!trie) {
+        fprintf(stderr, "cfbursttrie: %s is not a burst trie file\n", path);
+        exit(1);
+    }
+    return trie;
+}
+
+static int build(const char* output, const char* input, CFBurstTrieOpts opts) {
+    FILE* file = input ? fopen(input, "rb") : stdin;
+    if (!file) {
+        fprintf(stderr, "cfbursttrie: cannot open %s\n", input);
+        return 1;
+    }
+
+    CFBurstTrieRef trie = CFBurstTrieCreate();
+    char line[MAX_LINE_LENGTH];
+    unsigned long lineNumber = 0;
+    unsigned long count = 0;
+    while (fgets(line, sizeof(line), file)) {
+        ++lineNumber;
+        size_t length = strcspn(line, "\r\n");
+        if (line[length] == 0 && !feof(file)) {
+            // Unless the buffer ended right at the line break, the line didn't fit. Skip the rest of it rather than
+            // reading it as lines of its own.
+            int ch = fgetc(file);
+            if (ch != '\n' && ch != EOF) {
+                while ((ch = fgetc(file)) != EOF && ch != '\n') {
+                }
+                fprintf(stderr, "cfbursttrie: line %lu: longer than %d bytes, skipped\n", lineNumber, MAX_LINE_LENGTH - 1);
+                continue;
+            }
+        }
+        line[length] = 0;
+
+        uint32_t payload = (uint32_t)lineNumber;
+        char* tab = strchr(line, '\t');
+        if (tab) {
+            *tab = 0;
+            length = tab - line;
+            payload = (uint32_t)strtoul(tab + 1, NULL, 0);
+        }
+
+        if (length == 0) {
+            continue;
+        }
+        if (payload == 0) {
+            fprintf(stderr, "cfbursttrie: line %lu: payloads must be non-zero\n", lineNumber);
+            continue;
+        }
+        if (CFBurstTrieAddUTF8String(trie, (UInt8*)line, (CFIndex)length, payload)) {
+            ++count;
+        } else {
+            fprintf(stderr, "cfbursttrie: line %lu: cannot add \"%s\"\n", lineNumber, line);
+        }
+    }
+    if (file != stdin) {
+        fclose(file);
+    }
+
+    CFStringRef path = CFStringCreateWithFileSystemRepresentation(kCFAllocatorDefault, output);
+    Boolean success = CFBurstTrieSerialize(trie, path, kCFBurstTrieReadOnly | opts);
+    CFRelease(path);
+    CFBurstTrieRelease(trie);
+
+    if (!success) {
+        fprintf(stderr, "cfbursttrie: cannot write %s\n", output);
+        return 1;
+    }
+    fprintf(stderr, "cfbursttrie: wrote %lu keys to %s\n", count, output);
+    return 0;
+}
+
+static int query(const char* path, char** keys, int count) {
+    CFBurstTrieRef trie = openTrie(path);
+    int missing = 0;
+    for (int i = 0; i < count; ++i) {
+        uint32_t payload = 0;
+        if (CFBurstTrieContainsUTF8String(trie, (UInt8*)keys[i], (CFIndex)strlen(keys[i]), &payload)) {
+            printf("%s\t%u\n", keys[i], payload);
+        } else {
+            printf("%s\t-\n", keys[i]);
+            ++missing;
+        }
+    }
+    CFBurstTrieRelease(trie);
+    return missing ? 1 : 0;
+}
+
+static void printKey(void* context, const UInt8* key, uint32_t keyLength, uint32_t payload, Boolean* stop) {
+    printf("%.*s\t%u\n", (int)keyLength, (const char*)key, payload);
+}
+
+static int enumerate(const char* path, const char* prefix) {
+    CFBurstTrieRef trie = openTrie(path);
+    CFBurstTrieTraverseWithPrefix(trie, (const UInt8*)prefix, (CFIndex)strlen(prefix), NULL, printKey);
+    CFBurstTrieRelease(trie);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    CFBurstTrieOpts opts = 0;
+    const char* output = NULL;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != 0; ++i) {
+        const char* option = argv[i];
+        if (strcmp(option, "-p") == 0) {
+            opts = (opts & ~kCFBurstTrieSortByKey) | kCFBurstTriePrefixCompression;
+        } else if (strcmp(option, "-s") == 0) {
+            opts = (opts & ~kCFBurstTriePrefixCompression) | kCFBurstTrieSortByKey;
+        } else if (strcmp(option, "-b") == 0) {
+            opts |= kCFBurstTrieBitmapCompression;
+        } else if (strcmp(option, "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(option, "-q") == 0 && i + 2 < argc) {
+            return query(argv[i + 1], argv + i + 2, argc - i - 2);
+        } else if (strcmp(option, "-e") == 0 && i + 2 == argc - 1) {
+            return enumerate(argv[i + 1], argv[i + 2]);
+        } else {
+            printUsage(argv[0]);
+        }
+    }
+
+    if (!output || argc - i > 1) {
+        printUsage(argv[0]);
+    }
+    if (!(opts & (kCFBurstTriePrefixCompression | kCFBurstTrieSortByKey))) {
+        opts |= kCFBurstTriePrefixCompression;
+    }
+    return build(output, i < argc ? argv[i] : NULL, opts);
+}